@@ -59,6 +59,31 @@ test_suites=(
     "State Machine:test/test_state_machine.cpp"
     "Error Handler:test/test_error_handler.cpp"
     "Sensor Framework:test/test_sensor_framework.cpp"
+    "Frame Codec:test/test_frame_codec.cpp"
+    "RX Engine:test/test_rx_engine.cpp"
+    "TX Scheduler:test/test_tx_scheduler.cpp"
+    "Frame Pool:test/test_frame_pool.cpp"
+    "Frame Dispatcher:test/test_frame_dispatcher.cpp"
+    "OTA Receiver:test/test_ota_receiver.cpp"
+    "OTA ARQ:test/test_ota_arq.cpp"
+    "OTA FEC:test/test_ota_fec.cpp"
+    "Delta Patch:test/test_delta_patch.cpp"
+    "LZSS:test/test_lzss.cpp"
+    "Firmware Store:test/test_firmware_store.cpp"
+    "ADR:test/test_adr.cpp"
+    "Airtime:test/test_airtime.cpp"
+    "Config Commit:test/test_config_commit.cpp"
+    "Radio Profile:test/test_radio_profile.cpp"
+    "Link Table:test/test_link_table.cpp"
+    "Dedup Cache:test/test_dedup_cache.cpp"
+    "TDMA:test/test_tdma.cpp"
+    "Listen Before Talk:test/test_listen_before_talk.cpp"
+    "RX Power:test/test_rx_power.cpp"
+    "Deep Sleep:test/test_deep_sleep.cpp"
+    "Network Sim:test/test_net_sim.cpp"
+    "Link Layer:test/test_link_layer.cpp"
+    "Capture:test/test_capture.cpp"
+    "Fragmentation:test/test_fragment.cpp"
 )
 
 for suite in "${test_suites[@]}"; do
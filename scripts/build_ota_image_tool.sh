@@ -0,0 +1,18 @@
+#!/bin/bash
+
+# Compiles the host-side OTA image tool (delta patches, LZSS) with g++.
+# Usage: scripts/build_ota_image_tool.sh <output binary>
+
+set -e
+
+ROOT="$(cd "$(dirname "$0")/.." && pwd)"
+TOOL="$1"
+
+mkdir -p "$(dirname "$TOOL")"
+g++ -std=c++17 -O2 -o "$TOOL" \
+    "$ROOT/scripts/ota_image_tool.cpp" \
+    "$ROOT/src/lora/delta_encoder.cpp" \
+    "$ROOT/src/lora/delta_patch.cpp" \
+    "$ROOT/src/lora/lzss.cpp" \
+    "$ROOT/src/lora/ota_receiver.cpp" \
+    "$ROOT/src/lora/sha256.cpp"
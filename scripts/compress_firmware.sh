@@ -0,0 +1,24 @@
+#!/bin/bash
+
+# LZSS-compresses a firmware image or delta patch for LoRa OTA.
+# Usage: scripts/compress_firmware.sh [in.bin] [out.lzs]
+#
+# Distribute the output in place of the input. The receiver recognises the
+# stream and flags it in OTA_START; transmitters decompress it into the
+# update partition after the transfer and check the image hash.
+
+set -e
+
+ROOT="$(cd "$(dirname "$0")/.." && pwd)"
+IN="${1:-$ROOT/.pio/build/sender/firmware.bin}"
+OUT="${2:-$IN.lzs}"
+TOOL="$ROOT/.pio/build/ota_image_tool"
+
+if [ ! -f "$IN" ]; then
+    echo "Missing $IN (run 'pio run' first)" >&2
+    exit 1
+fi
+
+"$ROOT/scripts/build_ota_image_tool.sh" "$TOOL"
+"$TOOL" lzss "$IN" "$OUT"
+echo "Compressed stream written to $OUT"
@@ -0,0 +1,29 @@
+#!/bin/bash
+
+# Builds a LoRa OTA delta patch from two firmware images.
+# Usage: scripts/make_delta_patch.sh [base.bin] [target.bin] [patch.bin]
+#
+# Defaults diff the sender and receiver builds, which is a quick way to see
+# how well two real images compress against each other. For an update, pass
+# the image the nodes are running and the new one; distribute the patch like
+# any firmware image and the receiver flags it as a delta automatically.
+# scripts/compress_firmware.sh shrinks the patch further.
+
+set -e
+
+ROOT="$(cd "$(dirname "$0")/.." && pwd)"
+BASE="${1:-$ROOT/.pio/build/sender/firmware.bin}"
+TARGET="${2:-$ROOT/.pio/build/receiver/firmware.bin}"
+PATCH="${3:-$ROOT/.pio/build/firmware.ldp}"
+TOOL="$ROOT/.pio/build/ota_image_tool"
+
+for f in "$BASE" "$TARGET"; do
+    if [ ! -f "$f" ]; then
+        echo "Missing $f (run 'pio run' first)" >&2
+        exit 1
+    fi
+done
+
+"$ROOT/scripts/build_ota_image_tool.sh" "$TOOL"
+"$TOOL" delta "$BASE" "$TARGET" "$PATCH"
+echo "Patch written to $PATCH"
@@ -0,0 +1,102 @@
+// Host CLI for LoRa OTA transfers, built and run by scripts/make_delta_patch.sh
+// and scripts/compress_firmware.sh
+//
+//   ota_image_tool delta <base.bin> <target.bin> <patch.ldp>
+//   ota_image_tool lzss <in.bin> <out.lzs>
+#include "../src/lora/delta_encoder.h"
+#include "../src/lora/frame_codec.h"
+#include "../src/lora/lzss.h"
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <vector>
+
+static bool readFile(const char* path, std::vector<uint8_t>& out) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in) {
+        return false;
+    }
+    out.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    return true;
+}
+
+static bool writeFile(const char* path, const std::vector<uint8_t>& data) {
+    std::ofstream out(path, std::ios::binary);
+    out.write(reinterpret_cast<const char*>(data.data()), static_cast<std::streamsize>(data.size()));
+    return static_cast<bool>(out);
+}
+
+// SF9, BW125, CR4/5 with 200-byte OTA_DATA chunks, the LoRa OTA defaults
+static double airtimeSeconds(size_t bytes) {
+    const double chunk = 200;
+    const double frame = LoRaLink::FRAME_OVERHEAD + LoRaLink::OTA_CHUNK_HEADER_SIZE + chunk;
+    const double bits = 8.0 * frame - 4 * 9 + 28 + 16;
+    const double symbols = 8 + 4.25 + 8 + std::ceil(bits / (4 * 9)) * 5;
+    return std::ceil(bytes / chunk) * symbols * 4.096e-3;
+}
+
+static void printAirtime(size_t sent, size_t image) {
+    printf("LoRa airtime at SF9: %.0f s sent vs %.0f s for the plain image\n",
+           airtimeSeconds(sent), airtimeSeconds(image));
+}
+
+static int makeDelta(const char* basePath, const char* targetPath, const char* outPath) {
+    std::vector<uint8_t> base;
+    std::vector<uint8_t> target;
+    if (!readFile(basePath, base) || !readFile(targetPath, target)) {
+        fprintf(stderr, "Cannot read %s or %s\n", basePath, targetPath);
+        return 1;
+    }
+
+    LoRaLink::DeltaEncoder encoder;
+    const std::vector<uint8_t> patch = encoder.encode(base.data(), base.size(), target.data(), target.size());
+    if (!writeFile(outPath, patch)) {
+        fprintf(stderr, "Cannot write %s\n", outPath);
+        return 1;
+    }
+
+    const LoRaLink::DeltaEncodeStats& st = encoder.getStats();
+    printf("base   %zu bytes\n", base.size());
+    printf("target %zu bytes\n", target.size());
+    printf("patch  %zu bytes (%.1f%% of target)\n", patch.size(), 100.0 * patch.size() / target.size());
+    printf("ops    %u: copy %u, add %u, insert %u bytes\n", st.ops, st.copyBytes, st.addBytes, st.insertBytes);
+    printAirtime(patch.size(), target.size());
+    return 0;
+}
+
+static int makeLzss(const char* inPath, const char* outPath) {
+    std::vector<uint8_t> data;
+    if (!readFile(inPath, data) || data.empty()) {
+        fprintf(stderr, "Cannot read %s\n", inPath);
+        return 1;
+    }
+
+    LoRaLink::LzssEncoder encoder;
+    const std::vector<uint8_t> packed = encoder.compress(data.data(), data.size());
+    if (!writeFile(outPath, packed)) {
+        fprintf(stderr, "Cannot write %s\n", outPath);
+        return 1;
+    }
+
+    printf("input  %zu bytes%s\n", data.size(), LoRaLink::isDeltaPatch(data.data(), data.size()) ? " (delta patch)" : "");
+    printf("lzss   %zu bytes (%.1f%%)\n", packed.size(), 100.0 * packed.size() / data.size());
+    printAirtime(packed.size(), data.size());
+    if (packed.size() >= data.size()) {
+        printf("Input does not compress; send it as is\n");
+    }
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    if (argc == 5 && strcmp(argv[1], "delta") == 0) {
+        return makeDelta(argv[2], argv[3], argv[4]);
+    }
+    if (argc == 4 && strcmp(argv[1], "lzss") == 0) {
+        return makeLzss(argv[2], argv[3]);
+    }
+    fprintf(stderr, "Usage: %s delta <base.bin> <target.bin> <patch.ldp>\n", argv[0]);
+    fprintf(stderr, "       %s lzss <in.bin> <out.lzs>\n", argv[0]);
+    return 2;
+}
@@ -13,6 +13,7 @@
 #include <freertos/FreeRTOS.h>
 #include <freertos/task.h>
 #include <esp_task_wdt.h>
+#include <driver/gpio.h>
 #include <driver/ledc.h>
 #include <driver/adc.h>
 #include <esp_adc_cal.h>
@@ -26,6 +27,18 @@ namespace HardwareAbstraction {
     static bool g_i2c_initialized = false;
     static bool g_spi_initialized = false;
     static bool g_adc_initialized = false;
+
+    // Light-sleep wake pins, armed only while asleep
+    struct WakePin {
+        uint8_t pin;
+        GPIO::Level level;
+        int interruptMode;
+    };
+    static constexpr size_t MAX_WAKE_PINS = 4;
+    static WakePin g_wake_pins[MAX_WAKE_PINS];
+    static size_t g_wake_pin_count = 0;
+    static bool g_wake_armed = false;
+
     #ifdef ARDUINO
     static nvs_handle_t g_nvs_handle = 0;
     #else
@@ -98,6 +111,7 @@ namespace HardwareAbstraction {
         g_i2c_initialized = false;
         g_spi_initialized = false;
         g_adc_initialized = false;
+        g_wake_pin_count = 0;
         
         // Reset Timer subsystem
         Timer::reset();
@@ -836,6 +850,37 @@ namespace HardwareAbstraction {
             return Result::SUCCESS;
         }
 
+        // Light sleep only supports level wake-up on GPIOs
+        static bool armWakeupPins() {
+            g_wake_armed = g_wake_pin_count > 0;
+            #ifdef ARDUINO
+            for (size_t i = 0; i < g_wake_pin_count; ++i) {
+                const gpio_int_type_t type =
+                    g_wake_pins[i].level == GPIO::Level::LEVEL_HIGH ? GPIO_INTR_HIGH_LEVEL : GPIO_INTR_LOW_LEVEL;
+                if (gpio_wakeup_enable(static_cast<gpio_num_t>(g_wake_pins[i].pin), type) != ESP_OK) {
+                    return false;
+                }
+            }
+            if (g_wake_armed && esp_sleep_enable_gpio_wakeup() != ESP_OK) {
+                return false;
+            }
+            #endif
+            return true;
+        }
+
+        // Back to the edge ISRs before anything else runs
+        static void disarmWakeupPins() {
+            #ifdef ARDUINO
+            for (size_t i = 0; i < g_wake_pin_count; ++i) {
+                const gpio_num_t pin = static_cast<gpio_num_t>(g_wake_pins[i].pin);
+                gpio_wakeup_disable(pin);
+                // Arduino-ESP32 interrupt modes are gpio_int_type_t values (RISING = GPIO_INTR_POSEDGE)
+                gpio_set_intr_type(pin, static_cast<gpio_int_type_t>(g_wake_pins[i].interruptMode));
+            }
+            #endif
+            g_wake_armed = false;
+        }
+
         Result sleep(Mode mode, uint32_t timeMs) {
             if (!g_initialized) {
                 return Result::ERROR_NOT_INITIALIZED;
@@ -847,7 +892,12 @@ namespace HardwareAbstraction {
                     if (timeMs > 0) {
                         esp_sleep_enable_timer_wakeup(timeMs * 1000); // Convert to microseconds
                     }
+                    if (!armWakeupPins()) {
+                        disarmWakeupPins();
+                        return Result::ERROR_HARDWARE_FAULT;
+                    }
                     esp_light_sleep_start();
+                    disarmWakeupPins();
                     break;
 
                 case Mode::DEEP_SLEEP:
@@ -864,16 +914,68 @@ namespace HardwareAbstraction {
                     }
                     break;
             }
+            #else
+            if (mode == Mode::LIGHT_SLEEP) {
+                armWakeupPins();
+                disarmWakeupPins();
+            }
             #endif
 
             return Result::SUCCESS;
         }
 
+        Result setWakeupPin(uint8_t pin, GPIO::Level level, int interruptMode) {
+            if (!g_initialized) {
+                return Result::ERROR_NOT_INITIALIZED;
+            }
+
+            if (pin > 48) { // ESP32-S3 max GPIO
+                return Result::ERROR_INVALID_PARAMETER;
+            }
+
+            // Nothing touches the pin until sleep(LIGHT_SLEEP)
+            for (size_t i = 0; i < g_wake_pin_count; ++i) {
+                if (g_wake_pins[i].pin == pin) {
+                    g_wake_pins[i] = { pin, level, interruptMode };
+                    return Result::SUCCESS;
+                }
+            }
+            if (g_wake_pin_count == MAX_WAKE_PINS) {
+                return Result::ERROR_INVALID_PARAMETER;
+            }
+            g_wake_pins[g_wake_pin_count++] = { pin, level, interruptMode };
+            return Result::SUCCESS;
+        }
+
+        bool isWakeupArmed(uint8_t pin) {
+            for (size_t i = 0; i < g_wake_pin_count; ++i) {
+                if (g_wake_pins[i].pin == pin) {
+                    return g_wake_armed;
+                }
+            }
+            return false;
+        }
+
         Result wakeup() {
             // ESP32 wakes up automatically, nothing to do
             return Result::SUCCESS;
         }
 
+        WakeCause getWakeCause() {
+            #ifdef ARDUINO
+            switch (esp_sleep_get_wakeup_cause()) {
+                case ESP_SLEEP_WAKEUP_UNDEFINED: return WakeCause::POWER_ON;
+                case ESP_SLEEP_WAKEUP_TIMER: return WakeCause::TIMER;
+                case ESP_SLEEP_WAKEUP_EXT0:
+                case ESP_SLEEP_WAKEUP_EXT1:
+                case ESP_SLEEP_WAKEUP_GPIO: return WakeCause::GPIO;
+                default: return WakeCause::OTHER;
+            }
+            #else
+            return WakeCause::POWER_ON;
+            #endif
+        }
+
         float getBatteryVoltage() {
             #ifdef ARDUINO
             // Heltec V3 has battery voltage divider on ADC pin
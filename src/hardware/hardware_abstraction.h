@@ -109,10 +109,27 @@ namespace HardwareAbstraction {
             DEEP_SLEEP
         };
 
+        enum class WakeCause {
+            POWER_ON,             // Reset or first boot
+            TIMER,
+            GPIO,
+            OTHER
+        };
+
         Result enableVext();      // Enable external power rail
         Result disableVext();     // Disable external power rail
         Result sleep(Mode mode, uint32_t timeMs = 0);
+        // Wake from light sleep while the pin is at the given level. The
+        // level wake replaces the pin's interrupt type, so an edge ISR on the
+        // same pin would fire nonstop while the level holds; it is therefore
+        // armed only inside sleep(LIGHT_SLEEP), and on waking the pin gets
+        // back interruptMode (the attachInterrupt() mode, 0 for none).
+        Result setWakeupPin(uint8_t pin, GPIO::Level level, int interruptMode = 0);
+        // True while sleep(LIGHT_SLEEP) holds the pin's level wake
+        bool isWakeupArmed(uint8_t pin);
         Result wakeup();
+        // Why the chip last left sleep; POWER_ON when it did not
+        WakeCause getWakeCause();
         float getBatteryVoltage();
         uint8_t getBatteryPercent();
     }
@@ -0,0 +1,307 @@
+#include "adr.h"
+#include <cmath>
+#include <cstring>
+
+namespace LoRaLink {
+
+    namespace {
+        const int DEFAULT_SF[] = { 7, 8, 9, 10, 11, 12 };
+        const float DEFAULT_BW[] = { 62.5f, 125.0f, 250.0f, 500.0f };
+        const int DEFAULT_TX_POWER[] = { 2, 3, 5, 8, 10, 12, 15, 17, 20, 22 };
+
+        // The SX126x SNR reading flattens out around here; RSSI takes over above it
+        constexpr float SNR_SATURATION_DB = 8.0f;
+        constexpr float RECEIVER_NOISE_FIGURE_DB = 6.0f;
+
+        inline bool sameBandwidth(float a, float b) {
+            return std::fabs(a - b) < 0.01f;
+        }
+    }
+
+    AdrConfig AdrEngine::defaultConfig() {
+        AdrConfig config;
+        config.sfValues = DEFAULT_SF;
+        config.sfCount = sizeof(DEFAULT_SF) / sizeof(DEFAULT_SF[0]);
+        config.bwValues = DEFAULT_BW;
+        config.bwCount = sizeof(DEFAULT_BW) / sizeof(DEFAULT_BW[0]);
+        config.txPowerValues = DEFAULT_TX_POWER;
+        config.txPowerCount = sizeof(DEFAULT_TX_POWER) / sizeof(DEFAULT_TX_POWER[0]);
+        config.marginDb = 8.0f;
+        config.hysteresisDb = 2.0f;
+        config.minSamples = 8;
+        config.maxLossPct = 20;
+        config.lossPenaltyDb = 3.0f;
+        config.ratePowerDbm = 17;
+        config.staleMs = 300000;
+        config.holdoffMs = 30000;
+        return config;
+    }
+
+    AdrEngine::AdrEngine() : AdrEngine(defaultConfig()) {}
+
+    AdrEngine::AdrEngine(const AdrConfig& config)
+        : config_(config)
+        , links_{}
+        , candidates_{}
+        , candidateCount_(0)
+        , holding_(false)
+        , lastRecommendMs_(0)
+        , stats_{}
+    {
+        buildCandidates();
+    }
+
+    // All SF x BW pairs, fastest first
+    void AdrEngine::buildCandidates() {
+        candidateCount_ = 0;
+        for (size_t s = 0; s < config_.sfCount; ++s) {
+            for (size_t b = 0; b < config_.bwCount && candidateCount_ < ADR_MAX_CANDIDATES; ++b) {
+                Candidate c;
+                c.sf = static_cast<uint8_t>(config_.sfValues[s]);
+                c.bwKHz = config_.bwValues[b];
+                c.bitRate = bitRate(c.sf, c.bwKHz, 5);
+                size_t i = candidateCount_++;
+                while (i > 0 && candidates_[i - 1].bitRate < c.bitRate) {
+                    candidates_[i] = candidates_[i - 1];
+                    i--;
+                }
+                candidates_[i] = c;
+            }
+        }
+    }
+
+    void AdrEngine::onFrame(uint16_t nodeId, uint16_t sequence, float rssi, float snr, uint32_t nowMs) {
+        Link* link = findLink(nodeId, nowMs);
+        uint8_t missed = 0;
+        if (link->count > 0) {
+            const uint16_t gap = static_cast<uint16_t>(sequence - link->lastSeq);
+            if (gap == 0) {
+                return;     // Repeat of a frame already counted
+            }
+            // A jump backwards is a reboot, not 65k lost frames
+            if (gap < 0x8000) {
+                missed = gap - 1 > 255 ? 255 : static_cast<uint8_t>(gap - 1);
+            }
+        }
+        link->lastSeq = sequence;
+        link->lastSeenMs = nowMs;
+        link->snr[link->head] = snr;
+        link->rssi[link->head] = rssi;
+        link->missed[link->head] = missed;
+        link->head = static_cast<uint8_t>((link->head + 1) % ADR_HISTORY);
+        if (link->count < ADR_HISTORY) {
+            link->count++;
+        }
+        stats_.samples++;
+    }
+
+    AdrEngine::Link* AdrEngine::findLink(uint16_t nodeId, uint32_t nowMs) {
+        Link* free = nullptr;
+        Link* oldest = &links_[0];
+        for (Link& link : links_) {
+            if (link.used && link.nodeId == nodeId) {
+                return &link;
+            }
+            if (!link.used && free == nullptr) {
+                free = &link;
+            }
+            if (nowMs - link.lastSeenMs > nowMs - oldest->lastSeenMs) {
+                oldest = &link;
+            }
+        }
+        if (free == nullptr) {
+            free = oldest;
+            stats_.linksEvicted++;
+        }
+        memset(free, 0, sizeof(*free));
+        free->used = true;
+        free->nodeId = nodeId;
+        free->lastSeenMs = nowMs;
+        return free;
+    }
+
+    void AdrEngine::summarize(const Link& link, AdrLinkSummary& summary) const {
+        float snr = 0.0f;
+        float rssi = 0.0f;
+        uint32_t missed = 0;
+        for (uint8_t i = 0; i < link.count; ++i) {
+            snr += link.snr[i];
+            rssi += link.rssi[i];
+            missed += link.missed[i];
+        }
+        summary.nodeId = link.nodeId;
+        summary.samples = link.count;
+        summary.meanSnr = link.count ? snr / link.count : 0.0f;
+        summary.meanRssi = link.count ? rssi / link.count : 0.0f;
+        summary.lossPct = link.count ? static_cast<uint8_t>(missed * 100 / (missed + link.count)) : 0;
+        summary.lastSeenMs = link.lastSeenMs;
+    }
+
+    // SNR the link would show at the current settings, after the loss penalty
+    float AdrEngine::effectiveSnr(const Link& link, float bwKHz) const {
+        AdrLinkSummary summary;
+        summarize(link, summary);
+        float snr = summary.meanSnr;
+        if (snr > SNR_SATURATION_DB) {
+            const float fromRssi = summary.meanRssi - noiseFloorDbm(bwKHz);
+            if (fromRssi > snr) {
+                snr = fromRssi;
+            }
+        }
+        if (summary.lossPct > config_.maxLossPct) {
+            snr -= config_.lossPenaltyDb;
+        }
+        return snr;
+    }
+
+    size_t AdrEngine::currentCandidate(const ConfigPayload& current) const {
+        const float rate = bitRate(current.sf, current.bwKHz, 5);
+        size_t slower = candidateCount_ - 1;
+        for (size_t i = 0; i < candidateCount_; ++i) {
+            if (candidates_[i].sf == current.sf && sameBandwidth(candidates_[i].bwKHz, current.bwKHz)) {
+                return i;
+            }
+            if (candidates_[i].bitRate <= rate && slower == candidateCount_ - 1) {
+                slower = i;
+            }
+        }
+        return slower;
+    }
+
+    bool AdrEngine::evaluate(const ConfigPayload& current, uint32_t nowMs, ConfigPayload& next) {
+        if (candidateCount_ == 0 || config_.txPowerCount == 0 ||
+            (holding_ && nowMs - lastRecommendMs_ < config_.holdoffMs)) {
+            return false;
+        }
+
+        float snr[ADR_MAX_LINKS];
+        size_t active = 0;
+        for (const Link& link : links_) {
+            if (link.used && link.count >= config_.minSamples && nowMs - link.lastSeenMs <= config_.staleMs) {
+                snr[active++] = effectiveSnr(link, current.bwKHz);
+            }
+        }
+        if (active == 0) {
+            return false;
+        }
+        stats_.evaluations++;
+
+        // TX power a candidate needs for the weakest link
+        auto neededPower = [&](const Candidate& c) {
+            const float bwGain = 10.0f * std::log10(current.bwKHz / c.bwKHz);
+            float power = -1000.0f;
+            for (size_t l = 0; l < active; ++l) {
+                const float p = requiredSnr(c.sf) + config_.marginDb - (snr[l] + bwGain - current.txPower);
+                if (p > power) {
+                    power = p;
+                }
+            }
+            return power;
+        };
+
+        // The data rate is picked at ratePowerDbm, so the choice depends on the
+        // links alone and power cannot ratchet up one speed-up at a time. Only
+        // when no rate closes the link there does it go to full power.
+        const size_t now = currentCandidate(current);
+        const int maxPower = config_.txPowerValues[config_.txPowerCount - 1];
+        const int limits[] = { config_.ratePowerDbm < maxPower ? config_.ratePowerDbm : maxPower, maxPower };
+        size_t chosen = candidateCount_ - 1;
+        float needed = static_cast<float>(maxPower);
+        bool found = false;
+        for (size_t pass = 0; pass < 2 && !found; ++pass) {
+            for (size_t i = now > 0 ? now - 1 : 0; i < candidateCount_; ++i) {
+                const float power = neededPower(candidates_[i]) + (i < now ? config_.hysteresisDb : 0.0f);
+                if (power <= limits[pass]) {
+                    chosen = i;
+                    needed = power;
+                    found = true;
+                    break;
+                }
+            }
+        }
+
+        auto lowestAtLeast = [this, maxPower](float dbm) {
+            for (size_t i = 0; i < config_.txPowerCount; ++i) {
+                if (config_.txPowerValues[i] >= dbm) {
+                    return config_.txPowerValues[i];
+                }
+            }
+            return maxPower;
+        };
+        int power = lowestAtLeast(needed);
+        if (chosen == now && power < current.txPower) {
+            // Power cuts need the hysteresis too, and go one table step at a time
+            power = lowestAtLeast(needed + config_.hysteresisDb);
+            int stepDown = current.txPower;
+            for (size_t i = 0; i < config_.txPowerCount && config_.txPowerValues[i] < current.txPower; ++i) {
+                stepDown = config_.txPowerValues[i];
+            }
+            if (power < stepDown) {
+                power = stepDown;
+            }
+            if (power > current.txPower) {
+                power = current.txPower;
+            }
+        }
+
+        next = current;
+        next.sf = candidates_[chosen].sf;
+        next.bwKHz = candidates_[chosen].bwKHz;
+        next.txPower = static_cast<int8_t>(power);
+        if (chosen == now && next.sf == current.sf && sameBandwidth(next.bwKHz, current.bwKHz) &&
+            next.txPower == current.txPower) {
+            return false;
+        }
+
+        if (chosen < now || (chosen == now && next.txPower < current.txPower)) {
+            stats_.speedUps++;
+        } else {
+            stats_.slowDowns++;
+        }
+        holding_ = true;
+        lastRecommendMs_ = nowMs;
+        return true;
+    }
+
+    void AdrEngine::reset() {
+        memset(links_, 0, sizeof(links_));
+        holding_ = false;
+    }
+
+    size_t AdrEngine::linkCount() const {
+        size_t count = 0;
+        for (const Link& link : links_) {
+            if (link.used) {
+                count++;
+            }
+        }
+        return count;
+    }
+
+    bool AdrEngine::getLink(size_t index, AdrLinkSummary& summary) const {
+        for (const Link& link : links_) {
+            if (link.used && index-- == 0) {
+                summarize(link, summary);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void AdrEngine::resetStats() {
+        stats_ = {};
+    }
+
+    float AdrEngine::requiredSnr(int sf) {
+        // SX1261/2 datasheet: -7.5 dB at SF7, 2.5 dB lower per SF step
+        return -7.5f - 2.5f * static_cast<float>(sf - 7);
+    }
+
+    float AdrEngine::noiseFloorDbm(float bwKHz) {
+        return -174.0f + 10.0f * std::log10(bwKHz * 1000.0f) + RECEIVER_NOISE_FIGURE_DB;
+    }
+
+    float AdrEngine::bitRate(int sf, float bwKHz, int cr) {
+        return static_cast<float>(sf) * bwKHz * 1000.0f / static_cast<float>(1u << sf) * 4.0f / static_cast<float>(cr);
+    }
+}
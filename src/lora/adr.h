@@ -0,0 +1,119 @@
+#pragma once
+
+#include "frame_codec.h"
+#include <stdint.h>
+#include <cstddef>
+
+// Adaptive data rate for the sender -> receiver links
+//
+// The receiver hears every sender's PINGs, so it keeps the history: per node,
+// the last ADR_HISTORY SNR/RSSI samples and the PING sequence gaps in front
+// of each, which give the loss rate. evaluate() carries each link's mean SNR
+// over to every SF/BW/TX power candidate (SNR moves dB for dB with TX power
+// and with the noise floor, i.e. 10*log10 of the bandwidth ratio) and picks
+// the fastest data rate that keeps every link marginDb above the SX126x
+// demodulation floor for its SF at ratePowerDbm, then the lowest power that
+// still does. Speed-ups and power cuts need hysteresisDb on top and move one
+// step per decision; slow-downs go straight to the answer. The result
+// travels to the sender as an ADR_REQUEST, and the sender switches both ends
+// with the usual CONFIG broadcast, so one radio profile still serves every
+// node.
+namespace LoRaLink {
+
+    constexpr size_t ADR_HISTORY = 16;
+    constexpr size_t ADR_MAX_LINKS = 8;
+    constexpr size_t ADR_MAX_CANDIDATES = 32;   // SF x BW combinations
+
+    struct AdrConfig {
+        const int* sfValues;            // Choices, in any order
+        size_t sfCount;
+        const float* bwValues;
+        size_t bwCount;
+        const int* txPowerValues;       // Ascending
+        size_t txPowerCount;
+        float marginDb;                 // Above the demodulation floor
+        float hysteresisDb;             // Extra margin to speed up or cut power
+        uint8_t minSamples;             // Per link before it counts
+        uint8_t maxLossPct;             // Loss above this costs lossPenaltyDb
+        float lossPenaltyDb;
+        int ratePowerDbm;               // Data rate is chosen as if sending at this power
+        uint32_t staleMs;               // Links silent this long are ignored
+        uint32_t holdoffMs;             // Between recommendations for one profile
+    };
+
+    struct AdrLinkSummary {
+        uint16_t nodeId;
+        uint8_t samples;
+        float meanSnr;
+        float meanRssi;
+        uint8_t lossPct;
+        uint32_t lastSeenMs;
+    };
+
+    struct AdrStats {
+        uint32_t samples;
+        uint32_t evaluations;
+        uint32_t speedUps;              // Faster data rate or lower power
+        uint32_t slowDowns;
+        uint32_t linksEvicted;
+    };
+
+    class AdrEngine {
+    public:
+        static AdrConfig defaultConfig();
+
+        AdrEngine();
+        explicit AdrEngine(const AdrConfig& config);
+
+        // One frame from nodeId; sequence must count every frame the node sent
+        void onFrame(uint16_t nodeId, uint16_t sequence, float rssi, float snr, uint32_t nowMs);
+        // Settings to switch to; false while current is right or history is short
+        bool evaluate(const ConfigPayload& current, uint32_t nowMs, ConfigPayload& next);
+        // Samples describe the old profile after a switch
+        void reset();
+
+        size_t linkCount() const;
+        bool getLink(size_t index, AdrLinkSummary& summary) const;
+        const AdrStats& getStats() const { return stats_; }
+        void resetStats();
+
+        // SX126x demodulation floor (dB SNR) for a spreading factor
+        static float requiredSnr(int sf);
+        // Thermal noise over the bandwidth plus a 6 dB receiver noise figure
+        static float noiseFloorDbm(float bwKHz);
+        static float bitRate(int sf, float bwKHz, int cr);
+
+    private:
+        struct Link {
+            bool used;
+            uint16_t nodeId;
+            uint16_t lastSeq;
+            uint8_t head;
+            uint8_t count;
+            float snr[ADR_HISTORY];
+            float rssi[ADR_HISTORY];
+            uint8_t missed[ADR_HISTORY];    // Sequence gap in front of each sample
+            uint32_t lastSeenMs;
+        };
+
+        struct Candidate {
+            uint8_t sf;
+            float bwKHz;
+            float bitRate;
+        };
+
+        AdrConfig config_;
+        Link links_[ADR_MAX_LINKS];
+        Candidate candidates_[ADR_MAX_CANDIDATES];
+        size_t candidateCount_;
+        bool holding_;
+        uint32_t lastRecommendMs_;
+        AdrStats stats_;
+
+        void buildCandidates();
+        Link* findLink(uint16_t nodeId, uint32_t nowMs);
+        void summarize(const Link& link, AdrLinkSummary& summary) const;
+        float effectiveSnr(const Link& link, float bwKHz) const;
+        size_t currentCandidate(const ConfigPayload& current) const;
+    };
+}
@@ -0,0 +1,114 @@
+#include "airtime.h"
+#include <cmath>
+
+namespace LoRaLink {
+
+    namespace {
+        constexpr uint32_t ETSI_WINDOW_MS = 3600000;    // Duty cycle is per hour in EN 300 220
+    }
+
+    const AirtimeProfile* findAirtimeProfile(uint8_t sf, float bwKHz) {
+        const uint32_t bwHz = static_cast<uint32_t>(std::lround(bwKHz * 1000.0f));
+        for (const AirtimeProfile& profile : AIRTIME_TABLE) {
+            if (profile.sf == sf && profile.bwHz == bwHz) {
+                return &profile;
+            }
+        }
+        return nullptr;
+    }
+
+    LoRaModulation modulationFor(int sf, float bwKHz, int cr, uint16_t preamble) {
+        return loraModulation(static_cast<uint8_t>(sf), static_cast<uint32_t>(std::lround(bwKHz * 1000.0f)),
+                              static_cast<uint8_t>(cr), preamble);
+    }
+
+    AirtimeBudgetConfig AirtimeBudget::defaultConfig() {
+        AirtimeBudgetConfig config;
+        config.dutyCyclePermille = 1000;
+        config.windowMs = ETSI_WINDOW_MS;
+        return config;
+    }
+
+    AirtimeBudget::AirtimeBudget() : AirtimeBudget(defaultConfig()) {}
+
+    AirtimeBudget::AirtimeBudget(const AirtimeBudgetConfig& config)
+        : config_(config)
+        , modulation_(loraModulation(9, 125000))
+        , tokensUs_(0)
+        , refillUs_(0)
+        , stats_{}
+    {
+        tokensUs_ = capacityUs();
+    }
+
+    int64_t AirtimeBudget::capacityUs() const {
+        return static_cast<int64_t>(config_.windowMs) * config_.dutyCyclePermille;
+    }
+
+    void AirtimeBudget::refill(uint32_t nowUs) {
+        const uint32_t elapsed = nowUs - refillUs_;
+        refillUs_ = nowUs;
+        tokensUs_ += static_cast<int64_t>(elapsed) * config_.dutyCyclePermille / 1000;
+        if (tokensUs_ > capacityUs()) {
+            tokensUs_ = capacityUs();
+        }
+    }
+
+    uint32_t AirtimeBudget::waitUs(size_t frameBytes, uint32_t nowUs) {
+        if (!limited()) {
+            return 0;
+        }
+        refill(nowUs);
+        // A frame longer than the whole bucket waits for a full one
+        int64_t need = static_cast<int64_t>(airtimeUs(frameBytes));
+        if (need > capacityUs()) {
+            need = capacityUs();
+        }
+        if (tokensUs_ >= need) {
+            return 0;
+        }
+        const int64_t untilEnough = config_.dutyCyclePermille == 0 ? INT32_MAX :
+            (need - tokensUs_) * 1000 / config_.dutyCyclePermille + 1;
+        const uint32_t wait = untilEnough > INT32_MAX ? INT32_MAX : static_cast<uint32_t>(untilEnough);
+        stats_.deferrals++;
+        if (wait > stats_.maxWaitUs) {
+            stats_.maxWaitUs = wait;
+        }
+        return wait;
+    }
+
+    void AirtimeBudget::onStart(size_t frameBytes, uint32_t nowUs) {
+        const uint32_t airtime = airtimeUs(frameBytes);
+        if (limited()) {
+            refill(nowUs);
+            tokensUs_ -= airtime;
+        }
+        stats_.frames++;
+        stats_.airtimeUs += airtime;
+    }
+
+    void AirtimeBudget::restore(int64_t tokensUs, uint64_t offUs, uint32_t nowUs) {
+        tokensUs_ = tokensUs + static_cast<int64_t>(offUs) * config_.dutyCyclePermille / 1000;
+        if (tokensUs_ > capacityUs()) {
+            tokensUs_ = capacityUs();
+        }
+        refillUs_ = nowUs;
+    }
+
+    uint32_t AirtimeBudget::intervalMs(size_t frameBytes, uint16_t sharePermille, uint32_t floorMs) const {
+        uint16_t share = sharePermille;
+        if (limited() && config_.dutyCyclePermille < share) {
+            share = config_.dutyCyclePermille;
+        }
+        if (share == 0) {
+            share = 1;
+        }
+        const uint64_t periodUs = static_cast<uint64_t>(airtimeUs(frameBytes)) * 1000 / share;
+        const uint32_t period = static_cast<uint32_t>((periodUs + 999) / 1000);
+        return period > floorMs ? period : floorMs;
+    }
+
+    void AirtimeBudget::resetStats() {
+        stats_ = {};
+    }
+}
@@ -0,0 +1,178 @@
+#pragma once
+
+#include "frame_codec.h"
+#include <stdint.h>
+#include <cstddef>
+
+// Time on air of SX126x LoRa packets, and an airtime budget that paces TX
+//
+// timeOnAirUs() is the datasheet formula (SX1261/2 rev 2.1, 6.1.4) in whole
+// quarter symbols, so it is exact, integer-only and usable in constant
+// expressions:
+//   SF7..12: Npre + 4.25 + 8 + ceil(max(8N + 16CRC - 4SF + 8 + 20IH, 0)
+//                                   / (4(SF - 2DE))) * (CR + 4)
+//   SF5/6:   Npre + 6.25 + 8 + ceil(max(8N + 16CRC - 4SF + 20IH, 0)
+//                                   / (4SF)) * (CR + 4)
+// with CR + 4 the coding rate denominator (LoRaModulation::cr), IH = 1 for
+// the explicit header (the term it costs) and DE the low data rate
+// optimisation, which RadioLib switches on once a symbol lasts 16 ms.
+// AIRTIME_TABLE holds the figures for every SF/BW profile the firmware can
+// cycle through, computed at compile time.
+//
+// AirtimeBudget turns those figures into pacing: a token bucket in airtime
+// microseconds enforces a duty cycle (the ETSI 1 % for EU868, or nothing)
+// on every frame the TxScheduler starts, and periodic traffic sizes its
+// interval from the frame's airtime instead of a fixed number of
+// milliseconds, so it gets faster at SF7 and backs off at SF12.
+namespace LoRaLink {
+
+    enum class LdroMode : uint8_t {
+        AUTO,       // On when a symbol lasts 16 ms or more (RadioLib's rule)
+        OFF,
+        ON
+    };
+
+    struct LoRaModulation {
+        uint8_t sf;                 // 5..12
+        uint32_t bwHz;
+        uint8_t cr;                 // Coding rate denominator, 5..8 (4/5..4/8)
+        uint16_t preamble;          // Programmed preamble length in symbols
+        bool explicitHeader;
+        bool crc;
+        LdroMode ldro;
+    };
+
+    // Link defaults: RadioLib's 8-symbol preamble, explicit header, CRC on
+    constexpr uint16_t DEFAULT_PREAMBLE = 8;
+
+    constexpr LoRaModulation loraModulation(uint8_t sf, uint32_t bwHz, uint8_t cr = 5,
+                                            uint16_t preamble = DEFAULT_PREAMBLE) {
+        return LoRaModulation{ sf, bwHz, cr, preamble, true, true, LdroMode::AUTO };
+    }
+
+    constexpr uint32_t symbolTimeUs(uint8_t sf, uint32_t bwHz) {
+        return static_cast<uint32_t>((static_cast<uint64_t>(1) << sf) * 1000000u / bwHz);
+    }
+
+    constexpr bool lowDataRateOptimize(const LoRaModulation& m) {
+        return m.ldro == LdroMode::ON ||
+               (m.ldro == LdroMode::AUTO && symbolTimeUs(m.sf, m.bwHz) >= 16000);
+    }
+
+    namespace detail {
+        constexpr int32_t payloadBits(const LoRaModulation& m, size_t bytes) {
+            return 8 * static_cast<int32_t>(bytes) + (m.crc ? 16 : 0) - 4 * m.sf +
+                   (m.sf >= 7 ? 8 : 0) + (m.explicitHeader ? 20 : 0);
+        }
+
+        constexpr int32_t bitsPerBlock(const LoRaModulation& m) {
+            return 4 * (m.sf >= 7 && lowDataRateOptimize(m) ? m.sf - 2 : m.sf);
+        }
+
+        constexpr uint32_t payloadBlocks(int32_t bits, int32_t perBlock) {
+            return bits > 0 ? static_cast<uint32_t>((bits + perBlock - 1) / perBlock) : 0;
+        }
+
+        // Whole packet in quarter symbols
+        constexpr uint64_t quarterSymbols(const LoRaModulation& m, size_t bytes) {
+            return 4u * (m.preamble + 8u) + (m.sf >= 7 ? 17u : 25u) +
+                   4u * payloadBlocks(payloadBits(m, bytes), bitsPerBlock(m)) * m.cr;
+        }
+    }
+
+    // Packet duration in microseconds (rounded down), preamble to last CRC bit
+    constexpr uint32_t timeOnAirUs(const LoRaModulation& m, size_t payloadBytes) {
+        return static_cast<uint32_t>(detail::quarterSymbols(m, payloadBytes) *
+                                     (static_cast<uint64_t>(1) << m.sf) * 1000000u / (4u * m.bwHz));
+    }
+
+    // Frame sizes the link sends most
+    constexpr size_t PING_FRAME_BYTES = FRAME_OVERHEAD;
+    constexpr size_t CONFIG_FRAME_BYTES = FRAME_OVERHEAD + CONFIG_PAYLOAD_SIZE;
+
+    struct AirtimeProfile {
+        uint8_t sf;
+        uint32_t bwHz;
+        uint32_t symbolUs;
+        uint32_t pingUs;
+        uint32_t configUs;
+        uint32_t maxFrameUs;        // MAX_FRAME_SIZE
+    };
+
+    constexpr AirtimeProfile airtimeProfile(uint8_t sf, uint32_t bwHz) {
+        return AirtimeProfile{ sf, bwHz, symbolTimeUs(sf, bwHz),
+                               timeOnAirUs(loraModulation(sf, bwHz), PING_FRAME_BYTES),
+                               timeOnAirUs(loraModulation(sf, bwHz), CONFIG_FRAME_BYTES),
+                               timeOnAirUs(loraModulation(sf, bwHz), MAX_FRAME_SIZE) };
+    }
+
+    // SF7..12 x 62.5/125/250/500 kHz at CR 4/5, the firmware's sfValues/bwValues
+    constexpr AirtimeProfile AIRTIME_TABLE[] = {
+        airtimeProfile(7, 62500), airtimeProfile(7, 125000), airtimeProfile(7, 250000), airtimeProfile(7, 500000),
+        airtimeProfile(8, 62500), airtimeProfile(8, 125000), airtimeProfile(8, 250000), airtimeProfile(8, 500000),
+        airtimeProfile(9, 62500), airtimeProfile(9, 125000), airtimeProfile(9, 250000), airtimeProfile(9, 500000),
+        airtimeProfile(10, 62500), airtimeProfile(10, 125000), airtimeProfile(10, 250000), airtimeProfile(10, 500000),
+        airtimeProfile(11, 62500), airtimeProfile(11, 125000), airtimeProfile(11, 250000), airtimeProfile(11, 500000),
+        airtimeProfile(12, 62500), airtimeProfile(12, 125000), airtimeProfile(12, 250000), airtimeProfile(12, 500000),
+    };
+    constexpr size_t AIRTIME_TABLE_SIZE = sizeof(AIRTIME_TABLE) / sizeof(AIRTIME_TABLE[0]);
+
+    // Table row for a profile; nullptr when it is not one of the table's
+    const AirtimeProfile* findAirtimeProfile(uint8_t sf, float bwKHz);
+
+    // Modulation for settings held as in ConfigPayload
+    LoRaModulation modulationFor(int sf, float bwKHz, int cr, uint16_t preamble = DEFAULT_PREAMBLE);
+
+    struct AirtimeBudgetConfig {
+        uint16_t dutyCyclePermille;     // 1000 = no duty-cycle limit
+        uint32_t windowMs;              // Duty cycle is averaged over this (bucket size)
+    };
+
+    struct AirtimeStats {
+        uint32_t frames;
+        uint64_t airtimeUs;             // Total charged
+        uint32_t deferrals;             // waitUs() answers other than 0
+        uint32_t maxWaitUs;
+    };
+
+    class AirtimeBudget {
+    public:
+        static AirtimeBudgetConfig defaultConfig();
+
+        AirtimeBudget();
+        explicit AirtimeBudget(const AirtimeBudgetConfig& config);
+
+        void setModulation(const LoRaModulation& modulation) { modulation_ = modulation; }
+        const LoRaModulation& modulation() const { return modulation_; }
+        uint32_t airtimeUs(size_t frameBytes) const { return timeOnAirUs(modulation_, frameBytes); }
+
+        // Microseconds until a frame of this size may start; 0 = now
+        uint32_t waitUs(size_t frameBytes, uint32_t nowUs);
+        // The frame went on air at nowUs: charge its airtime
+        void onStart(size_t frameBytes, uint32_t nowUs);
+
+        // Deep sleep: the level to keep, and to restore on waking after
+        // offUs without a clock (refilled at the duty-cycle rate)
+        int64_t tokensUs() const { return tokensUs_; }
+        void restore(int64_t tokensUs, uint64_t offUs, uint32_t nowUs);
+
+        // Period that keeps frames of this size within sharePermille of the
+        // channel (and the duty cycle), never shorter than floorMs
+        uint32_t intervalMs(size_t frameBytes, uint16_t sharePermille, uint32_t floorMs = 0) const;
+
+        const AirtimeBudgetConfig& config() const { return config_; }
+        const AirtimeStats& getStats() const { return stats_; }
+        void resetStats();
+
+    private:
+        AirtimeBudgetConfig config_;
+        LoRaModulation modulation_;
+        int64_t tokensUs_;              // Airtime available; negative after an oversize frame
+        uint32_t refillUs_;             // Last refill
+        AirtimeStats stats_;
+
+        bool limited() const { return config_.dutyCyclePermille < 1000; }
+        int64_t capacityUs() const;
+        void refill(uint32_t nowUs);
+    };
+}
@@ -0,0 +1,150 @@
+#include "capture.h"
+#include <cstring>
+#include <cmath>
+
+namespace LoRaLink {
+
+    size_t encodeCaptureRecord(const RxFrame& frame, const ConfigPayload& profile, uint8_t* out, size_t outSize) {
+        if (out == nullptr || frame.length == 0 || frame.length > MAX_FRAME_SIZE) {
+            return 0;
+        }
+        const size_t total = CAPTURE_OVERHEAD + frame.length;
+        if (outSize < total) {
+            return 0;
+        }
+
+        out[0] = CAPTURE_SYNC0;
+        out[1] = CAPTURE_SYNC1;
+        out[2] = CAPTURE_VERSION;
+        out[3] = static_cast<uint8_t>(frame.length);
+        Wire::putU32(out + 4, frame.timestampUs);
+        Wire::putU16(out + 8, static_cast<uint16_t>(static_cast<int16_t>(lroundf(frame.rssi * 10.0f))));
+        Wire::putU16(out + 10, static_cast<uint16_t>(static_cast<int16_t>(lroundf(frame.snr * 10.0f))));
+        encodeConfig(profile, out + 12, CONFIG_PAYLOAD_SIZE);
+        memcpy(out + CAPTURE_HEADER_SIZE, frame.data, frame.length);
+        const size_t crcAt = CAPTURE_HEADER_SIZE + frame.length;
+        Wire::putU16(out + crcAt, crc16(out + 2, crcAt - 2));
+        return total;
+    }
+
+    size_t decodeCaptureRecord(const uint8_t* data, size_t length, CaptureRecord& record) {
+        if (data == nullptr || length < CAPTURE_OVERHEAD) {
+            return 0;
+        }
+        if (data[0] != CAPTURE_SYNC0 || data[1] != CAPTURE_SYNC1 || data[2] != CAPTURE_VERSION) {
+            return 0;
+        }
+        const size_t frameLength = data[3];
+        if (frameLength == 0 || frameLength > MAX_FRAME_SIZE || length < CAPTURE_OVERHEAD + frameLength) {
+            return 0;
+        }
+        const size_t crcAt = CAPTURE_HEADER_SIZE + frameLength;
+        if (Wire::getU16(data + crcAt) != crc16(data + 2, crcAt - 2)) {
+            return 0;
+        }
+        if (!decodeConfig(data + 12, CONFIG_PAYLOAD_SIZE, record.profile)) {
+            return 0;
+        }
+
+        record.frame.length = frameLength;
+        record.frame.timestampUs = Wire::getU32(data + 4);
+        record.frame.rssi = static_cast<int16_t>(Wire::getU16(data + 8)) / 10.0f;
+        record.frame.snr = static_cast<int16_t>(Wire::getU16(data + 10)) / 10.0f;
+        memcpy(record.frame.data, data + CAPTURE_HEADER_SIZE, frameLength);
+        return crcAt + CRC_SIZE;
+    }
+
+    CaptureRing::CaptureRing()
+        : buffer_{}
+        , head_(0)
+        , tail_(0)
+        , used_(0)
+        , stats_{}
+    {
+    }
+
+    void CaptureRing::record(const RxFrame& frame, const ConfigPayload& profile) {
+        uint8_t encoded[CAPTURE_MAX_RECORD];
+        const size_t len = encodeCaptureRecord(frame, profile, encoded, sizeof(encoded));
+        if (len == 0) {
+            return;
+        }
+        // Oldest records make room
+        while (CAPACITY - used_ < len) {
+            drop(recordSizeAt(tail_));
+            stats_.overwritten++;
+        }
+
+        const size_t first = (len < CAPACITY - head_) ? len : CAPACITY - head_;
+        memcpy(buffer_ + head_, encoded, first);
+        memcpy(buffer_, encoded + first, len - first);
+        head_ = (head_ + len) % CAPACITY;
+        used_ += len;
+        stats_.records++;
+        stats_.bytes += len;
+    }
+
+    size_t CaptureRing::read(uint8_t* out, size_t maxBytes) {
+        if (out == nullptr) {
+            return 0;
+        }
+        size_t copied = 0;
+        while (used_ > 0) {
+            const size_t len = recordSizeAt(tail_);
+            if (len > maxBytes - copied) {
+                break;
+            }
+            const size_t first = (len < CAPACITY - tail_) ? len : CAPACITY - tail_;
+            memcpy(out + copied, buffer_ + tail_, first);
+            memcpy(out + copied + first, buffer_, len - first);
+            copied += len;
+            drop(len);
+            stats_.streamed++;
+        }
+        return copied;
+    }
+
+    void CaptureRing::clear() {
+        head_ = 0;
+        tail_ = 0;
+        used_ = 0;
+    }
+
+    size_t CaptureRing::recordSizeAt(size_t index) const {
+        return CAPTURE_OVERHEAD + buffer_[(index + 3) % CAPACITY];
+    }
+
+    void CaptureRing::drop(size_t bytes) {
+        tail_ = (tail_ + bytes) % CAPACITY;
+        used_ -= bytes;
+    }
+
+    CaptureReader::CaptureReader(const uint8_t* data, size_t length)
+        : data_(data)
+        , length_(data != nullptr ? length : 0)
+        , pos_(0)
+        , stats_{}
+    {
+    }
+
+    bool CaptureReader::next(CaptureRecord& record) {
+        while (pos_ < length_) {
+            if (data_[pos_] == CAPTURE_SYNC0) {
+                const size_t used = decodeCaptureRecord(data_ + pos_, length_ - pos_, record);
+                if (used > 0) {
+                    pos_ += used;
+                    stats_.records++;
+                    return true;
+                }
+            }
+            pos_++;
+            stats_.skippedBytes++;
+        }
+        return false;
+    }
+
+    void CaptureReader::rewind() {
+        pos_ = 0;
+        stats_ = {};
+    }
+}
@@ -0,0 +1,107 @@
+#pragma once
+
+#include "frame_codec.h"
+#include "frame_pool.h"
+#include <stdint.h>
+#include <cstddef>
+
+// Binary capture of received frames, for field debugging and replay
+//
+// Every frame the RX engine hands up is recorded raw, before decode, with
+// its DIO1 timestamp, RSSI, SNR and the radio profile it was heard on.
+// Records go into a fixed RAM ring; the firmware drains the ring to the
+// serial port between its text log lines, so each record starts with a sync
+// word no log text contains and ends with a CRC. CaptureReader finds the
+// records again in such a mixed stream, and capture_replay.h feeds them back
+// through a node's receive path on the host.
+//
+// Record layout (little-endian):
+//   [0..2)   sync        0xA5 0xE3
+//   [2]      version     CAPTURE_VERSION
+//   [3]      length      frame bytes, 1..MAX_FRAME_SIZE
+//   [4..8)   timestampUs DIO1 edge, micros()
+//   [8..10)  rssi        int16, 0.1 dBm
+//   [10..12) snr         int16, 0.1 dB
+//   [12..20) profile     encodeConfig()
+//   [20..n)  frame       as read from the radio FIFO
+//   [n..n+2) crc16       CRC-16/CCITT-FALSE over [2..n)
+namespace LoRaLink {
+
+    constexpr uint8_t CAPTURE_SYNC0 = 0xA5;
+    constexpr uint8_t CAPTURE_SYNC1 = 0xE3;
+    constexpr uint8_t CAPTURE_VERSION = 1;
+    constexpr size_t CAPTURE_HEADER_SIZE = 12 + CONFIG_PAYLOAD_SIZE;
+    constexpr size_t CAPTURE_OVERHEAD = CAPTURE_HEADER_SIZE + CRC_SIZE;
+    constexpr size_t CAPTURE_MAX_RECORD = CAPTURE_OVERHEAD + MAX_FRAME_SIZE;
+
+    struct CaptureRecord {
+        RxFrame frame;
+        ConfigPayload profile;
+    };
+
+    // Returns bytes written, 0 if the frame is empty, too long or out is too small
+    size_t encodeCaptureRecord(const RxFrame& frame, const ConfigPayload& profile, uint8_t* out, size_t outSize);
+    // One record at the start of data; returns its size, 0 if the bytes there
+    // are not a complete record with a good CRC
+    size_t decodeCaptureRecord(const uint8_t* data, size_t length, CaptureRecord& record);
+
+    struct CaptureStats {
+        uint32_t records;           // Recorded
+        uint32_t bytes;             // Encoded bytes recorded
+        uint32_t overwritten;       // Oldest records dropped to make room
+        uint32_t streamed;          // Records handed out by read()
+    };
+
+    // Fixed RAM ring of encoded records. A full ring drops its oldest
+    // records. read() hands out whole records only, so log lines printed
+    // between two drains never land inside a record.
+    class CaptureRing {
+    public:
+        static constexpr size_t CAPACITY = 4096;    // About 130 PINGs
+
+        CaptureRing();
+
+        void record(const RxFrame& frame, const ConfigPayload& profile);
+        // Drain the oldest records that fit in maxBytes; returns bytes copied,
+        // 0 when empty or when the oldest does not fit
+        size_t read(uint8_t* out, size_t maxBytes);
+        void clear();
+
+        size_t size() const { return used_; }
+        const CaptureStats& getStats() const { return stats_; }
+        void resetStats() { stats_ = {}; }
+
+    private:
+        uint8_t buffer_[CAPACITY];
+        size_t head_;               // Next byte written
+        size_t tail_;               // Next byte read
+        size_t used_;
+        CaptureStats stats_;
+
+        size_t recordSizeAt(size_t index) const;
+        void drop(size_t bytes);
+    };
+
+    struct CaptureReaderStats {
+        uint32_t records;
+        uint32_t skippedBytes;      // Log text and damaged records between records
+    };
+
+    // Walks a captured byte stream (serial dump or read() output) record by record
+    class CaptureReader {
+    public:
+        CaptureReader(const uint8_t* data, size_t length);
+
+        // Next good record; false at the end of the data
+        bool next(CaptureRecord& record);
+        void rewind();
+
+        const CaptureReaderStats& getStats() const { return stats_; }
+
+    private:
+        const uint8_t* data_;
+        size_t length_;
+        size_t pos_;
+        CaptureReaderStats stats_;
+    };
+}
@@ -0,0 +1,72 @@
+#include "capture_replay.h"
+
+namespace LoRaLink {
+
+    static bool sameProfile(const ConfigPayload& a, const ConfigPayload& b) {
+        return a.freqMHz == b.freqMHz && a.bwKHz == b.bwKHz && a.sf == b.sf && a.cr == b.cr &&
+               a.txPower == b.txPower;
+    }
+
+    CaptureReplay::CaptureReplay(MockRadio& radio, LinkLayer& link, ClockSetter setTimeUs)
+        : radio_(radio)
+        , link_(link)
+        , setTimeUs_(setTimeUs)
+        , stats_{}
+    {
+    }
+
+    const ReplayStats& CaptureReplay::run(CaptureReader& reader, ReplayTiming timing, uint32_t startUs) {
+        CaptureRecord record;
+        bool first = true;
+        uint32_t firstUs = 0;
+        uint32_t lastUs = startUs;
+        while (reader.next(record)) {
+            if (first) {
+                firstUs = record.frame.timestampUs;
+                first = false;
+            }
+            // Offsets from the first record survive a micros() wrap in the capture
+            const uint32_t atUs = startUs + (record.frame.timestampUs - firstUs);
+            if (timing == ReplayTiming::RECORDED) {
+                for (uint32_t t = lastUs + LOOP_PERIOD_US; static_cast<int32_t>(atUs - t) > 0; t += LOOP_PERIOD_US) {
+                    poll(t);
+                }
+            }
+            setTimeUs_(atUs);
+            lastUs = atUs;
+            stats_.records++;
+            stats_.spanUs = record.frame.timestampUs - firstUs;
+
+            if (!sameProfile(record.profile, link_.profile())) {
+                link_.setProfile(record.profile);
+                stats_.profileChanges++;
+            }
+            if (radio_.deliver(record.frame.data, record.frame.length, atUs, record.frame.rssi, record.frame.snr)) {
+                stats_.delivered++;
+            } else {
+                stats_.missed++;
+            }
+            poll(atUs);
+        }
+        return stats_;
+    }
+
+    void CaptureReplay::poll(uint32_t nowUs) {
+        setTimeUs_(nowUs);
+        link_.poll();
+        stats_.polls++;
+        // Answers go out at once into a clear channel; nobody is listening to them
+        for (int i = 0; i < MAX_ANSWERS_PER_POLL; i++) {
+            if (radio_.getMode() == RadioMode::TRANSMIT) {
+                radio_.completeTransmit(nowUs);
+                stats_.transmits++;
+            } else if (radio_.getMode() == RadioMode::CAD) {
+                radio_.completeChannelScan(false, nowUs);
+            } else {
+                break;
+            }
+            link_.poll();
+            stats_.polls++;
+        }
+    }
+}
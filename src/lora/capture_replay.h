@@ -0,0 +1,65 @@
+#pragma once
+
+#include "capture.h"
+#include "link_layer.h"
+#include "mock_radio.h"
+#include <stdint.h>
+#include <cstddef>
+#include <functional>
+
+// Host-side replay of a capture through a node's receive path
+//
+// Each record is delivered to a MockRadio at its recorded time, RSSI and
+// SNR, and the LinkLayer behind it polls as the firmware loop would. The
+// caller wires the radio's DIO1 to LinkLayer::onDio1() and owns the clock
+// the link layer reads; the replay sets that clock through setTimeUs, with
+// the first record at startUs. A recorded profile the node is not on is
+// taken with setProfile(). Whatever the node transmits in answer is
+// completed at once (LBT scans find the channel clear), so the radio is
+// back in RX for the next record. Replay nodes run without CAD wake.
+//
+// FULL_SPEED jumps the clock from record to record and polls once per
+// frame: decode, dispatch and link bookkeeping as fast as the host runs
+// them. RECORDED also polls every loop period in between, so timeouts, ACK
+// slots and ADR evaluation fire where they did in the field.
+namespace LoRaLink {
+
+    enum class ReplayTiming : uint8_t {
+        FULL_SPEED,
+        RECORDED
+    };
+
+    struct ReplayStats {
+        uint32_t records;           // Records read from the capture
+        uint32_t delivered;         // Reached the radio FIFO
+        uint32_t missed;            // Radio not listening (transmitting or asleep)
+        uint32_t profileChanges;    // Recorded profile differed from the node's
+        uint32_t transmits;         // Frames the node sent in answer
+        uint32_t polls;
+        uint32_t spanUs;            // First to last record timestamp
+    };
+
+    class CaptureReplay {
+    public:
+        typedef std::function<void(uint32_t nowUs)> ClockSetter;
+        static constexpr uint32_t LOOP_PERIOD_US = 10000;   // delay(10) in loop()
+
+        CaptureReplay(MockRadio& radio, LinkLayer& link, ClockSetter setTimeUs);
+
+        // Replay the rest of the capture; the node ends at the last record's time
+        const ReplayStats& run(CaptureReader& reader, ReplayTiming timing, uint32_t startUs = 0);
+
+        const ReplayStats& getStats() const { return stats_; }
+        void resetStats() { stats_ = {}; }
+
+    private:
+        MockRadio& radio_;
+        LinkLayer& link_;
+        ClockSetter setTimeUs_;
+        ReplayStats stats_;
+
+        static constexpr int MAX_ANSWERS_PER_POLL = 64;     // LBT scans and frames
+
+        void poll(uint32_t nowUs);
+    };
+}
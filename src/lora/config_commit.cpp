@@ -0,0 +1,430 @@
+#include "config_commit.h"
+
+namespace LoRaLink {
+
+    namespace {
+        // Signed distance handles millis() wrap
+        inline bool reached(uint32_t nowMs, uint32_t atMs) {
+            return static_cast<int32_t>(nowMs - atMs) >= 0;
+        }
+
+        // Relative times on the wire count from the end of the frame
+        inline uint32_t timeLeft(uint32_t frameEndMs, uint32_t atMs) {
+            return reached(frameEndMs, atMs) ? 0 : atMs - frameEndMs;
+        }
+    }
+
+    // --- Wire format ---------------------------------------------------------
+
+    bool decodeConfigPrepare(const uint8_t* payload, size_t length, ConfigPrepare& prepare) {
+        if (payload == nullptr || length < CONFIG_PREPARE_HEADER_SIZE) {
+            return false;
+        }
+        prepare.epoch = Wire::getU16(payload);
+        prepare.round = payload[2];
+        prepare.ackSlots = payload[3];
+        prepare.ackSlotMs = Wire::getU16(payload + 4);
+        prepare.deadlineMs = Wire::getU32(payload + 6);
+        if (!decodeConfig(payload + 10, CONFIG_PAYLOAD_SIZE, prepare.config)) {
+            return false;
+        }
+        prepare.ackedCount = payload[10 + CONFIG_PAYLOAD_SIZE];
+        prepare.acked = payload + CONFIG_PREPARE_HEADER_SIZE;
+        return prepare.ackSlots > 0 && prepare.ackedCount <= CONFIG_COMMIT_MAX_ACKED &&
+               length == CONFIG_PREPARE_HEADER_SIZE + 2u * prepare.ackedCount;
+    }
+
+    bool preparedAcked(const ConfigPrepare& prepare, uint16_t nodeId) {
+        for (uint8_t i = 0; i < prepare.ackedCount; ++i) {
+            if (Wire::getU16(prepare.acked + 2 * i) == nodeId) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    size_t encodeConfigAck(uint16_t epoch, uint16_t coordinator, uint8_t* out, size_t outSize) {
+        if (out == nullptr || outSize < CONFIG_ACK_SIZE) {
+            return 0;
+        }
+        Wire::putU16(out, epoch);
+        Wire::putU16(out + 2, coordinator);
+        return CONFIG_ACK_SIZE;
+    }
+
+    bool decodeConfigAck(const uint8_t* payload, size_t length, uint16_t& epoch, uint16_t& coordinator) {
+        if (payload == nullptr || length != CONFIG_ACK_SIZE) {
+            return false;
+        }
+        epoch = Wire::getU16(payload);
+        coordinator = Wire::getU16(payload + 2);
+        return true;
+    }
+
+    size_t encodeConfigCommit(const ConfigCommitMessage& commit, uint8_t* out, size_t outSize) {
+        if (out == nullptr || outSize < CONFIG_COMMIT_SIZE) {
+            return 0;
+        }
+        Wire::putU16(out, commit.epoch);
+        out[2] = static_cast<uint8_t>(commit.decision);
+        Wire::putU32(out + 3, commit.switchInMs);
+        return CONFIG_COMMIT_SIZE;
+    }
+
+    bool decodeConfigCommit(const uint8_t* payload, size_t length, ConfigCommitMessage& commit) {
+        if (payload == nullptr || length != CONFIG_COMMIT_SIZE || payload[2] > 1) {
+            return false;
+        }
+        commit.epoch = Wire::getU16(payload);
+        commit.decision = static_cast<CommitDecision>(payload[2]);
+        commit.switchInMs = Wire::getU32(payload + 3);
+        return true;
+    }
+
+    uint8_t configAckSlot(uint16_t nodeId, uint16_t epoch, uint8_t round, uint8_t slots) {
+        uint32_t x = nodeId | (static_cast<uint32_t>(epoch) << 16);
+        x ^= round * 0x9E3779B9u;
+        x ^= x >> 16;
+        x *= 0x85EBCA6Bu;
+        x ^= x >> 13;
+        return slots > 0 ? static_cast<uint8_t>(x % slots) : 0;
+    }
+
+    // --- Coordinator -----------------------------------------------------------
+
+    ConfigCommitConfig ConfigCoordinator::defaultConfig() {
+        ConfigCommitConfig config;
+        config.minPrepareRounds = 2;
+        config.maxPrepareRounds = 5;
+        config.commitRepeats = 3;
+        config.ackSlots = 8;
+        config.switchMarginMs = 200;
+        config.rosterStaleMs = 600000;
+        config.requireAll = false;
+        return config;
+    }
+
+    ConfigCoordinator::ConfigCoordinator() : ConfigCoordinator(defaultConfig()) {}
+
+    ConfigCoordinator::ConfigCoordinator(const ConfigCommitConfig& config)
+        : config_(config)
+        , timing_{}
+        , phase_(Phase::IDLE)
+        , nodeId_(0)
+        , epoch_(0)
+        , pending_{}
+        , round_(0)
+        , roundSlots_(0)
+        , repeats_(0)
+        , beginMs_(0)
+        , nextSendMs_(0)
+        , deadlineMs_(0)
+        , switchAtMs_(0)
+        , acked_{}
+        , ackedCount_(0)
+        , roster_{}
+        , stats_{}
+    {
+    }
+
+    void ConfigCoordinator::noteNode(uint16_t nodeId, uint32_t nowMs) {
+        RosterEntry* slot = nullptr;
+        for (RosterEntry& entry : roster_) {
+            if (entry.used && entry.nodeId == nodeId) {
+                entry.lastSeenMs = nowMs;
+                return;
+            }
+            if (slot == nullptr && !entry.used) {
+                slot = &entry;
+            }
+        }
+        if (slot == nullptr) {
+            slot = &roster_[0];
+            for (RosterEntry& entry : roster_) {
+                if (nowMs - entry.lastSeenMs > nowMs - slot->lastSeenMs) {
+                    slot = &entry;
+                }
+            }
+        }
+        slot->used = true;
+        slot->nodeId = nodeId;
+        slot->lastSeenMs = nowMs;
+    }
+
+    size_t ConfigCoordinator::rosterSize(uint32_t nowMs) const {
+        size_t count = 0;
+        for (const RosterEntry& entry : roster_) {
+            if (entry.used && nowMs - entry.lastSeenMs <= config_.rosterStaleMs) {
+                count++;
+            }
+        }
+        return count;
+    }
+
+    size_t ConfigCoordinator::pendingKnown(uint32_t nowMs) const {
+        size_t count = 0;
+        for (const RosterEntry& entry : roster_) {
+            if (entry.used && nowMs - entry.lastSeenMs <= config_.rosterStaleMs && !hasAcked(entry.nodeId)) {
+                count++;
+            }
+        }
+        return count;
+    }
+
+    bool ConfigCoordinator::hasAcked(uint16_t nodeId) const {
+        for (size_t i = 0; i < ackedCount_; ++i) {
+            if (acked_[i] == nodeId) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Half again as many slots as nodes still to ack keeps most acks clear of each other
+    uint8_t ConfigCoordinator::slotsFor(size_t missing) const {
+        const size_t slots = missing + missing / 2;
+        if (slots < config_.ackSlots) {
+            return config_.ackSlots;
+        }
+        return static_cast<uint8_t>(slots < CONFIG_COMMIT_MAX_ACK_SLOTS ? slots : CONFIG_COMMIT_MAX_ACK_SLOTS);
+    }
+
+    // PREPARE on air, then every ack slot, then one slot of slack
+    uint32_t ConfigCoordinator::roundMs() const {
+        return timing_.prepareAirMs + (roundSlots_ + 1u) * timing_.ackSlotMs;
+    }
+
+    uint32_t ConfigCoordinator::commitGapMs() const {
+        return timing_.prepareAirMs + timing_.ackSlotMs;
+    }
+
+    bool ConfigCoordinator::begin(const ConfigPayload& next, const ConfigCommitTiming& timing, uint32_t nowMs) {
+        if (isActive() || config_.maxPrepareRounds == 0 || config_.ackSlots == 0) {
+            return false;
+        }
+        timing_ = timing;
+        pending_ = next;
+        epoch_++;
+        round_ = 0;
+        repeats_ = 0;
+        ackedCount_ = 0;
+        beginMs_ = nowMs;
+        nextSendMs_ = nowMs;
+        // Rounds only shrink from here, so the deadline covers the longest
+        roundSlots_ = slotsFor(rosterSize(nowMs));
+        deadlineMs_ = nowMs + config_.maxPrepareRounds * roundMs() + config_.commitRepeats * commitGapMs() +
+                      config_.switchMarginMs;
+        phase_ = Phase::PREPARING;
+        stats_.changes++;
+        return true;
+    }
+
+    void ConfigCoordinator::cancel() {
+        phase_ = Phase::IDLE;
+    }
+
+    bool ConfigCoordinator::onAck(uint16_t nodeId, const uint8_t* payload, size_t length, uint32_t nowMs) {
+        uint16_t epoch;
+        uint16_t coordinator;
+        if (!decodeConfigAck(payload, length, epoch, coordinator)) {
+            return false;
+        }
+        noteNode(nodeId, nowMs);
+        if (phase_ == Phase::IDLE || epoch != epoch_ || coordinator != nodeId_ || hasAcked(nodeId) ||
+            ackedCount_ >= CONFIG_COMMIT_MAX_ROSTER) {
+            return true;
+        }
+        acked_[ackedCount_++] = nodeId;
+        stats_.acks++;
+        return true;
+    }
+
+    void ConfigCoordinator::decide(uint32_t nowMs) {
+        const size_t roster = rosterSize(nowMs);
+        const size_t missing = pendingKnown(nowMs);
+        repeats_ = 0;
+        nextSendMs_ = nowMs;
+        if ((roster > 0 && ackedCount_ == 0) || (config_.requireAll && missing > 0)) {
+            phase_ = Phase::ABORTING;
+            stats_.aborts++;
+            return;
+        }
+        switchAtMs_ = nowMs + config_.commitRepeats * commitGapMs() + config_.switchMarginMs;
+        phase_ = Phase::COMMITTING;
+        stats_.commits++;
+        stats_.stragglers += static_cast<uint32_t>(missing);
+    }
+
+    CommitAction ConfigCoordinator::poll(uint32_t nowMs) {
+        if (phase_ == Phase::PREPARING) {
+            const bool roundOver = reached(nowMs, nextSendMs_);
+            const size_t roster = rosterSize(nowMs);
+            const bool rosterAcked = roster > 0 && pendingKnown(nowMs) == 0;
+            if ((round_ >= config_.minPrepareRounds && (rosterAcked || (roster == 0 && roundOver))) ||
+                (round_ >= config_.maxPrepareRounds && roundOver)) {
+                decide(nowMs);
+            } else if (!roundOver) {
+                return CommitAction::NONE;
+            } else {
+                round_++;
+                const uint8_t slots = slotsFor(pendingKnown(nowMs));
+                roundSlots_ = slots < roundSlots_ ? slots : roundSlots_;
+                nextSendMs_ = nowMs + roundMs();
+                stats_.prepares++;
+                return CommitAction::SEND_PREPARE;
+            }
+        }
+
+        if (phase_ == Phase::COMMITTING || phase_ == Phase::ABORTING) {
+            if (repeats_ < config_.commitRepeats) {
+                if (!reached(nowMs, nextSendMs_)) {
+                    return CommitAction::NONE;
+                }
+                repeats_++;
+                nextSendMs_ = nowMs + commitGapMs();
+                return CommitAction::SEND_COMMIT;
+            }
+            phase_ = phase_ == Phase::COMMITTING ? Phase::SWITCHING : Phase::IDLE;
+        }
+
+        if (phase_ == Phase::SWITCHING && reached(nowMs, switchAtMs_)) {
+            phase_ = Phase::IDLE;
+            stats_.lastSwitchoverMs = nowMs - beginMs_;
+            return CommitAction::SWITCH;
+        }
+        return CommitAction::NONE;
+    }
+
+    size_t ConfigCoordinator::encodePrepare(uint32_t nowMs, uint8_t* out, size_t outSize) const {
+        const size_t listed = ackedCount_ < CONFIG_COMMIT_MAX_ACKED ? ackedCount_ : CONFIG_COMMIT_MAX_ACKED;
+        const size_t length = CONFIG_PREPARE_HEADER_SIZE + 2 * listed;
+        if (out == nullptr || outSize < length) {
+            return 0;
+        }
+        Wire::putU16(out, epoch_);
+        out[2] = static_cast<uint8_t>(round_ > 0 ? round_ - 1 : 0);
+        out[3] = roundSlots_;
+        Wire::putU16(out + 4, static_cast<uint16_t>(timing_.ackSlotMs > 0xFFFF ? 0xFFFF : timing_.ackSlotMs));
+        Wire::putU32(out + 6, timeLeft(nowMs + timing_.prepareAirMs, deadlineMs_));
+        encodeConfig(pending_, out + 10, CONFIG_PAYLOAD_SIZE);
+        out[10 + CONFIG_PAYLOAD_SIZE] = static_cast<uint8_t>(listed);
+        for (size_t i = 0; i < listed; ++i) {
+            Wire::putU16(out + CONFIG_PREPARE_HEADER_SIZE + 2 * i, acked_[i]);
+        }
+        return length;
+    }
+
+    size_t ConfigCoordinator::encodeCommit(uint32_t nowMs, uint8_t* out, size_t outSize) const {
+        ConfigCommitMessage commit;
+        commit.epoch = epoch_;
+        commit.decision = phase_ == Phase::ABORTING ? CommitDecision::ABORT : CommitDecision::COMMIT;
+        commit.switchInMs = commit.decision == CommitDecision::COMMIT ?
+                            timeLeft(nowMs + timing_.commitAirMs, switchAtMs_) : 0;
+        return encodeConfigCommit(commit, out, outSize);
+    }
+
+    void ConfigCoordinator::resetStats() {
+        stats_ = {};
+    }
+
+    // --- Participant -----------------------------------------------------------
+
+    ConfigParticipant::ConfigParticipant()
+        : state_(State::IDLE)
+        , nodeId_(0)
+        , coordinator_(0)
+        , epoch_(0)
+        , applied_(0)
+        , appliedFrom_(0)
+        , haveApplied_(false)
+        , pending_{}
+        , ackDue_(false)
+        , ackAtMs_(0)
+        , switchAtMs_(0)
+        , stats_{}
+    {
+    }
+
+    bool ConfigParticipant::onPrepare(uint16_t coordinator, const uint8_t* payload, size_t length, uint32_t rxMs) {
+        ConfigPrepare prepare;
+        if (!decodeConfigPrepare(payload, length, prepare)) {
+            return false;
+        }
+        // Epochs are per coordinator; while one change runs, others wait their turn
+        if ((state_ != State::IDLE && coordinator != coordinator_) ||
+            (haveApplied_ && coordinator == appliedFrom_ && !epochNewer(prepare.epoch, applied_)) ||
+            (state_ != State::IDLE && epochNewer(epoch_, prepare.epoch))) {
+            stats_.staleIgnored++;
+            return true;
+        }
+        stats_.prepares++;
+        if (state_ == State::IDLE || prepare.epoch != epoch_ || coordinator != coordinator_) {
+            state_ = State::PREPARED;
+            epoch_ = prepare.epoch;
+            coordinator_ = coordinator;
+        }
+        pending_ = prepare.config;
+        if (state_ == State::PREPARED) {
+            switchAtMs_ = rxMs + prepare.deadlineMs;
+        }
+        if (!preparedAcked(prepare, nodeId_)) {
+            ackDue_ = true;
+            ackAtMs_ = rxMs + configAckSlot(nodeId_, prepare.epoch, prepare.round, prepare.ackSlots) *
+                              static_cast<uint32_t>(prepare.ackSlotMs);
+        } else {
+            ackDue_ = false;
+        }
+        return true;
+    }
+
+    bool ConfigParticipant::onCommit(uint16_t coordinator, const uint8_t* payload, size_t length, uint32_t rxMs) {
+        ConfigCommitMessage commit;
+        if (!decodeConfigCommit(payload, length, commit)) {
+            return false;
+        }
+        // Without the PREPARE the settings are unknown; the next change catches up
+        if (state_ == State::IDLE || commit.epoch != epoch_ || coordinator != coordinator_) {
+            return true;
+        }
+        if (commit.decision == CommitDecision::ABORT) {
+            state_ = State::IDLE;
+            ackDue_ = false;
+            stats_.aborts++;
+            return true;
+        }
+        if (state_ == State::PREPARED) {
+            stats_.commits++;
+        }
+        state_ = State::COMMITTED;
+        switchAtMs_ = rxMs + commit.switchInMs;
+        return true;
+    }
+
+    CommitAction ConfigParticipant::poll(uint32_t nowMs) {
+        if (ackDue_ && reached(nowMs, ackAtMs_)) {
+            ackDue_ = false;
+            stats_.acksSent++;
+            return CommitAction::SEND_ACK;
+        }
+        if (state_ != State::IDLE && reached(nowMs, switchAtMs_)) {
+            if (state_ == State::PREPARED) {
+                stats_.presumedCommits++;
+            }
+            state_ = State::IDLE;
+            ackDue_ = false;
+            applied_ = epoch_;
+            appliedFrom_ = coordinator_;
+            haveApplied_ = true;
+            return CommitAction::SWITCH;
+        }
+        return CommitAction::NONE;
+    }
+
+    size_t ConfigParticipant::encodeAck(uint8_t* out, size_t outSize) const {
+        return encodeConfigAck(epoch_, coordinator_, out, outSize);
+    }
+
+    void ConfigParticipant::resetStats() {
+        stats_ = {};
+    }
+}
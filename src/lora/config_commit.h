@@ -0,0 +1,238 @@
+#pragma once
+
+#include "frame_codec.h"
+#include <stdint.h>
+#include <cstddef>
+
+// Acknowledged two-phase switch of the radio profile
+//
+// The node that changes the profile (the coordinator, the sender role) bumps
+// a config epoch and broadcasts CONFIG_PREPARE rounds. Each one carries the
+// new settings, a deadline, ack slot timing and the nodes already acked;
+// every other node that hears it answers CONFIG_ACK in a slot picked from
+// its id and the round. The round has half again as many slots as nodes
+// still to ack, so acks rarely collide, and nodes already counted stay
+// quiet. Rounds stop once every node in the roster (nodes heard lately plus
+// earlier ackers) has acked, or after maxPrepareRounds. The coordinator then
+// repeats CONFIG_COMMIT with the time left to the switch, and every node
+// changes profile at that instant.
+//
+// A prepared node that misses every COMMIT still switches at the PREPARE
+// deadline (presumed commit), so a lost COMMIT costs a short outage instead
+// of a stranded node. CONFIG_COMMIT with decision ABORT cancels: sent when
+// nobody known acked, or with requireAll when anyone in the roster did not.
+// Times on the wire are relative ("switch in N ms") and taken against each
+// node's own receive time, so no shared clock is needed.
+namespace LoRaLink {
+
+    constexpr size_t CONFIG_COMMIT_MAX_ACKED = 32;      // Acked ids carried per PREPARE
+    constexpr size_t CONFIG_COMMIT_MAX_ROSTER = 32;
+    constexpr uint8_t CONFIG_COMMIT_MAX_ACK_SLOTS = 48;
+
+    // CONFIG_PREPARE: u16 epoch, u8 round, u8 ack slots, u16 ack slot ms,
+    // u32 deadline ms, CONFIG payload, u8 acked count, u16 acked ids
+    constexpr size_t CONFIG_PREPARE_HEADER_SIZE = 10 + CONFIG_PAYLOAD_SIZE + 1;
+    // CONFIG_ACK: u16 epoch, u16 coordinator id
+    constexpr size_t CONFIG_ACK_SIZE = 4;
+    // CONFIG_COMMIT: u16 epoch, u8 decision, u32 switch in ms
+    constexpr size_t CONFIG_COMMIT_SIZE = 7;
+
+    enum class CommitDecision : uint8_t {
+        ABORT  = 0,
+        COMMIT = 1
+    };
+
+    struct ConfigPrepare {
+        uint16_t epoch;
+        uint8_t round;
+        uint8_t ackSlots;
+        uint16_t ackSlotMs;
+        uint32_t deadlineMs;        // Presumed-commit switch, from receipt
+        ConfigPayload config;
+        uint8_t ackedCount;
+        const uint8_t* acked;       // Points into the payload, u16 ids
+    };
+
+    struct ConfigCommitMessage {
+        uint16_t epoch;
+        CommitDecision decision;
+        uint32_t switchInMs;
+    };
+
+    bool decodeConfigPrepare(const uint8_t* payload, size_t length, ConfigPrepare& prepare);
+    bool preparedAcked(const ConfigPrepare& prepare, uint16_t nodeId);
+    size_t encodeConfigAck(uint16_t epoch, uint16_t coordinator, uint8_t* out, size_t outSize);
+    bool decodeConfigAck(const uint8_t* payload, size_t length, uint16_t& epoch, uint16_t& coordinator);
+    size_t encodeConfigCommit(const ConfigCommitMessage& commit, uint8_t* out, size_t outSize);
+    bool decodeConfigCommit(const uint8_t* payload, size_t length, ConfigCommitMessage& commit);
+
+    // Epochs wrap; a is newer when it is less than half the space ahead
+    inline bool epochNewer(uint16_t a, uint16_t b) {
+        return static_cast<int16_t>(a - b) > 0;
+    }
+
+    enum class CommitAction {
+        NONE,
+        SEND_PREPARE,       // Coordinator: encodePrepare()
+        SEND_COMMIT,        // Coordinator: encodeCommit() (COMMIT or ABORT)
+        SEND_ACK,           // Participant: encodeAck()
+        SWITCH              // Apply pending() now
+    };
+
+    struct ConfigCommitConfig {
+        uint8_t minPrepareRounds;   // Even when the whole roster acked, for unknown nodes
+        uint8_t maxPrepareRounds;
+        uint8_t commitRepeats;
+        uint8_t ackSlots;           // Minimum; rounds widen to 1.5x the nodes yet to ack
+        uint32_t switchMarginMs;    // After the last COMMIT, for queues to drain
+        uint32_t rosterStaleMs;     // Nodes silent this long leave the roster
+        bool requireAll;            // Abort unless the whole roster acked
+    };
+
+    // Airtime-derived spacing, set per change from the current profile
+    struct ConfigCommitTiming {
+        uint32_t prepareAirMs;      // Time on air of a PREPARE frame
+        uint32_t commitAirMs;
+        uint32_t ackSlotMs;         // ACK time on air plus turnaround
+    };
+
+    struct ConfigCommitStats {
+        uint32_t changes;
+        uint32_t prepares;
+        uint32_t acks;              // Distinct ackers, summed over changes
+        uint32_t commits;
+        uint32_t aborts;
+        uint32_t stragglers;        // Roster nodes that never acked a committed change
+        uint32_t lastSwitchoverMs;  // begin() -> switch
+    };
+
+    class ConfigCoordinator {
+    public:
+        static ConfigCommitConfig defaultConfig();
+
+        ConfigCoordinator();
+        explicit ConfigCoordinator(const ConfigCommitConfig& config);
+
+        // Restore the epoch kept across reboots; begin() uses the next one
+        void setEpoch(uint16_t epoch) { epoch_ = epoch; }
+        uint16_t epoch() const { return epoch_; }
+        void setNodeId(uint16_t nodeId) { nodeId_ = nodeId; }
+
+        // A frame from a node that takes part (receiver role) keeps it in the roster
+        void noteNode(uint16_t nodeId, uint32_t nowMs);
+
+        bool begin(const ConfigPayload& next, const ConfigCommitTiming& timing, uint32_t nowMs);
+        void cancel();
+        bool onAck(uint16_t nodeId, const uint8_t* payload, size_t length, uint32_t nowMs);
+
+        CommitAction poll(uint32_t nowMs);
+        size_t encodePrepare(uint32_t nowMs, uint8_t* out, size_t outSize) const;
+        size_t encodeCommit(uint32_t nowMs, uint8_t* out, size_t outSize) const;
+
+        bool isActive() const { return phase_ != Phase::IDLE; }
+        bool committing() const { return phase_ == Phase::COMMITTING; }
+        const ConfigPayload& pending() const { return pending_; }
+        size_t ackedCount() const { return ackedCount_; }
+        size_t rosterSize(uint32_t nowMs) const;
+        const ConfigCommitStats& getStats() const { return stats_; }
+        void resetStats();
+
+    private:
+        enum class Phase {
+            IDLE,
+            PREPARING,
+            COMMITTING,
+            ABORTING,
+            SWITCHING       // Last COMMIT out, waiting for the instant
+        };
+
+        struct RosterEntry {
+            uint16_t nodeId;
+            uint32_t lastSeenMs;
+            bool used;
+        };
+
+        ConfigCommitConfig config_;
+        ConfigCommitTiming timing_;
+        Phase phase_;
+        uint16_t nodeId_;
+        uint16_t epoch_;
+        ConfigPayload pending_;
+        uint8_t round_;
+        uint8_t roundSlots_;
+        uint8_t repeats_;
+        uint32_t beginMs_;
+        uint32_t nextSendMs_;
+        uint32_t deadlineMs_;       // Presumed-commit instant announced in PREPAREs
+        uint32_t switchAtMs_;
+        uint16_t acked_[CONFIG_COMMIT_MAX_ROSTER];
+        size_t ackedCount_;
+        RosterEntry roster_[CONFIG_COMMIT_MAX_ROSTER];
+        ConfigCommitStats stats_;
+
+        bool hasAcked(uint16_t nodeId) const;
+        size_t pendingKnown(uint32_t nowMs) const;
+        uint8_t slotsFor(size_t missing) const;
+        uint32_t roundMs() const;
+        uint32_t commitGapMs() const;
+        void decide(uint32_t nowMs);
+    };
+
+    struct ParticipantStats {
+        uint32_t prepares;
+        uint32_t acksSent;
+        uint32_t commits;
+        uint32_t aborts;
+        uint32_t presumedCommits;   // Switched at the deadline without a COMMIT
+        uint32_t staleIgnored;      // Epochs at or behind the applied one
+    };
+
+    class ConfigParticipant {
+    public:
+        ConfigParticipant();
+
+        void setNodeId(uint16_t nodeId) { nodeId_ = nodeId; }
+        // Last epoch applied from a coordinator; older and repeated ones from it are ignored
+        void setApplied(uint16_t coordinator, uint16_t epoch) {
+            appliedFrom_ = coordinator;
+            applied_ = epoch;
+            haveApplied_ = true;
+        }
+        uint16_t appliedEpoch() const { return applied_; }
+
+        // rxMs: local time the frame was received
+        bool onPrepare(uint16_t coordinator, const uint8_t* payload, size_t length, uint32_t rxMs);
+        bool onCommit(uint16_t coordinator, const uint8_t* payload, size_t length, uint32_t rxMs);
+
+        CommitAction poll(uint32_t nowMs);
+        size_t encodeAck(uint8_t* out, size_t outSize) const;
+
+        bool isPrepared() const { return state_ != State::IDLE; }
+        const ConfigPayload& pending() const { return pending_; }
+        const ParticipantStats& getStats() const { return stats_; }
+        void resetStats();
+
+    private:
+        enum class State {
+            IDLE,
+            PREPARED,
+            COMMITTED
+        };
+
+        State state_;
+        uint16_t nodeId_;
+        uint16_t coordinator_;
+        uint16_t epoch_;
+        uint16_t applied_;
+        uint16_t appliedFrom_;
+        bool haveApplied_;
+        ConfigPayload pending_;
+        bool ackDue_;
+        uint32_t ackAtMs_;
+        uint32_t switchAtMs_;
+        ParticipantStats stats_;
+    };
+
+    // Ack slot for a node in a round; differs per round so a collision does not repeat
+    uint8_t configAckSlot(uint16_t nodeId, uint16_t epoch, uint8_t round, uint8_t slots);
+}
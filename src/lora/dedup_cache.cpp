@@ -0,0 +1,48 @@
+#include "dedup_cache.h"
+
+namespace LoRaLink {
+
+    DedupCache::DedupCache(uint32_t ttlMs)
+        : ring_{}
+        , head_(0)
+        , count_(0)
+        , ttlMs_(ttlMs)
+        , stats_{}
+    {
+    }
+
+    bool DedupCache::isRepeat(uint16_t nodeId, uint16_t sequence, FrameType type, uint32_t nowMs) {
+        for (size_t i = 0; i < count_; ++i) {
+            Entry& entry = ring_[i];
+            if (entry.nodeId != nodeId || entry.sequence != sequence || entry.type != type) {
+                continue;
+            }
+            if (nowMs - entry.seenMs <= ttlMs_) {
+                stats_.hits++;
+                return true;
+            }
+            // Same key from an earlier life of the sender; refresh in place
+            entry.seenMs = nowMs;
+            stats_.expired++;
+            stats_.misses++;
+            return false;
+        }
+
+        Entry& slot = ring_[head_];
+        slot.nodeId = nodeId;
+        slot.sequence = sequence;
+        slot.type = type;
+        slot.seenMs = nowMs;
+        head_ = (head_ + 1) % CAPACITY;
+        if (count_ < CAPACITY) {
+            count_++;
+        }
+        stats_.misses++;
+        return false;
+    }
+
+    void DedupCache::clear() {
+        head_ = 0;
+        count_ = 0;
+    }
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include "frame_codec.h"
+#include <stdint.h>
+#include <cstddef>
+
+// Duplicate-frame suppression before dispatch
+//
+// Notifications are sent several times under one sequence number (CONFIG on
+// the control channel, FW_UPDATE_AVAILABLE / FW_VERSION / UPDATE_NOW), and
+// every other frame gets a fresh number. A ring of the last CAPACITY
+// (source, sequence, type) keys therefore recognises the repeats, so the
+// handler runs once per logical message. Keys older than the TTL no longer
+// match, so a sender that reboots and reuses low sequence numbers is not
+// suppressed for long.
+namespace LoRaLink {
+
+    struct DedupStats {
+        uint32_t hits;          // Repeats dropped
+        uint32_t misses;        // New keys recorded
+        uint32_t expired;       // Key present but older than the TTL; counted as a miss too
+    };
+
+    class DedupCache {
+    public:
+        // A repeat burst is at most a few seconds; the ring only has to outlast it
+        static constexpr size_t CAPACITY = 16;
+        static constexpr uint32_t DEFAULT_TTL_MS = 30000;
+
+        explicit DedupCache(uint32_t ttlMs = DEFAULT_TTL_MS);
+
+        // True if this key was seen within the TTL; otherwise records it and returns false
+        bool isRepeat(uint16_t nodeId, uint16_t sequence, FrameType type, uint32_t nowMs);
+        bool isRepeat(const FrameHeader& header, uint32_t nowMs) {
+            return isRepeat(header.nodeId, header.sequence, header.type, nowMs);
+        }
+        void clear();
+
+        size_t size() const { return count_; }
+        const DedupStats& getStats() const { return stats_; }
+        void resetStats() { stats_ = {}; }
+
+    private:
+        struct Entry {
+            uint16_t nodeId;
+            uint16_t sequence;
+            uint32_t seenMs;
+            FrameType type;
+        };
+
+        Entry ring_[CAPACITY];
+        size_t head_;           // Next slot to overwrite
+        size_t count_;
+        uint32_t ttlMs_;
+        DedupStats stats_;
+    };
+}
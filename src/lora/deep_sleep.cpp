@@ -0,0 +1,37 @@
+#include "deep_sleep.h"
+
+namespace LoRaLink {
+
+    namespace {
+        uint16_t stateCrc(const SenderRtcState& state) {
+            return crc16(reinterpret_cast<const uint8_t*>(&state), offsetof(SenderRtcState, crc));
+        }
+    }
+
+    void sealRtcState(SenderRtcState& state) {
+        state.magic = RTC_STATE_MAGIC;
+        state.version = RTC_STATE_VERSION;
+        state.crc = stateCrc(state);
+    }
+
+    bool rtcStateValid(const SenderRtcState& state) {
+        return state.magic == RTC_STATE_MAGIC && state.version == RTC_STATE_VERSION &&
+               state.crc == stateCrc(state);
+    }
+
+    SenderCycleReport senderCycleReport(const SenderCycle& cycle, const PowerProfile& profile) {
+        SenderCycleReport report;
+        report.wakeToTxUs = cycle.bootUs + cycle.setupUs + cycle.radioInitUs + cycle.preTxUs + cycle.preTxAirUs;
+        report.awakeUs = report.wakeToTxUs + cycle.txUs + cycle.afterTxUs;
+
+        // mA x us = nC
+        const float awakeNc = report.awakeUs * (profile.mcuActiveMa + profile.boardMa) +
+                              (static_cast<float>(cycle.preTxAirUs) + cycle.txUs) * profile.radioTxMa;
+        const float sleepUs = cycle.sleepMs * 1000.0f;
+        const float sleepNc = sleepUs * (profile.mcuDeepSleepMa + profile.radioSleepMa + profile.boardMa);
+        report.chargeUc = (awakeNc + sleepNc) / 1000.0f;
+        report.energyMj = report.chargeUc * profile.supplyV / 1000.0f;
+        report.averageUa = report.chargeUc / ((report.awakeUs + sleepUs) / 1000000.0f);
+        return report;
+    }
+}
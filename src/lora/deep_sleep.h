@@ -0,0 +1,69 @@
+#pragma once
+
+#include "frame_codec.h"
+#include "rx_power.h"
+#include <stdint.h>
+#include <cstddef>
+
+// Deep-sleep sender: state kept in RTC memory, and the cost of one cycle
+//
+// A deep-sleep sender wakes on the RTC timer and restores SenderRtcState. It
+// brings the radio back from warm sleep with setter calls only
+// (RadioProfileManager::restore(): no reset, TCXO start or calibration),
+// sends one frame and sleeps again. The display, the boot delays and the
+// control-channel broadcast only run on a cold boot.
+//
+// RTC slow memory survives deep sleep but not a power cycle or a reflash.
+// The state therefore carries a magic, a layout version and a CRC, and
+// anything that fails the check means a cold boot.
+//
+// senderCycleReport() adds up one cycle on the PowerProfile currents:
+// wake-to-TX latency, awake time, and the charge and energy per cycle with
+// the sleep included. The firmware feeds it measured times. The native test
+// feeds it modelled ones (MockRadio busy times, airtime).
+namespace LoRaLink {
+
+    constexpr uint32_t RTC_STATE_MAGIC = 0x4C525443;   // "LRTC"
+    constexpr uint8_t RTC_STATE_VERSION = 1;
+
+    struct SenderRtcState {
+        uint32_t magic;
+        uint8_t version;
+        uint8_t radioWarm;          // Radio went to warm sleep holding profile
+        uint16_t frameSeq;          // Non-PING frames
+        uint32_t pingSeq;
+        ConfigPayload profile;
+        int64_t airtimeTokensUs;    // AirtimeBudget level at sleep
+        uint32_t wakes;
+        uint16_t crc;               // crc16() over everything before it
+    };
+
+    // Stamp magic, version and CRC after filling the fields
+    void sealRtcState(SenderRtcState& state);
+    bool rtcStateValid(const SenderRtcState& state);
+
+    struct SenderCycle {
+        uint32_t bootUs;            // Timer wake to setup()
+        uint32_t setupUs;           // setup() to the first radio call
+        uint32_t radioInitUs;       // Warm restore, or begin() after a cold boot
+        uint32_t preTxUs;           // Other time awake before the frame (boot delays)
+        uint32_t preTxAirUs;        // Frames sent before it (boot broadcasts)
+        uint32_t txUs;              // Frame airtime
+        uint32_t afterTxUs;         // TxDone to deep sleep: save state, radio to sleep
+        uint32_t sleepMs;
+    };
+
+    struct SenderCycleReport {
+        uint32_t wakeToTxUs;
+        uint32_t awakeUs;
+        float chargeUc;             // Per cycle, sleep included
+        float energyMj;             // At PowerProfile::supplyV
+        float averageUa;
+
+        float batteryDays(float capacityMah) const {
+            return averageUa > 0.0f ? capacityMah * 1000.0f / averageUa / 24.0f : 0.0f;
+        }
+    };
+
+    SenderCycleReport senderCycleReport(const SenderCycle& cycle, const PowerProfile& profile);
+}
@@ -0,0 +1,262 @@
+#include "delta_encoder.h"
+#include <cstring>
+
+namespace LoRaLink {
+
+    namespace {
+        constexpr size_t WINDOW = 8;
+        constexpr uint32_t HASH_BITS = 20;
+
+        inline uint32_t windowHash(const uint8_t* p) {
+            uint64_t v;
+            memcpy(&v, p, sizeof(v));
+            return static_cast<uint32_t>((v * 0x9E3779B97F4A7C15ull) >> (64 - HASH_BITS));
+        }
+
+        inline uint32_t zigzag(int64_t v) {
+            return static_cast<uint32_t>(v < 0 ? ((-v - 1) << 1) | 1 : v << 1);
+        }
+    }
+
+    std::vector<uint8_t> DeltaEncoder::encode(const uint8_t* base, size_t baseSize,
+                                              const uint8_t* target, size_t targetSize) {
+        base_ = base;
+        baseSize_ = baseSize;
+        target_ = target;
+        targetSize_ = targetSize;
+        baseCursor_ = 0;
+        stats_ = {};
+        out_.assign(DELTA_HEADER_SIZE, 0);
+
+        DeltaHeader header;
+        header.baseSize = static_cast<uint32_t>(baseSize);
+        header.targetSize = static_cast<uint32_t>(targetSize);
+        Sha256::hash(base, baseSize, header.baseSha256);
+        Sha256::hash(target, targetSize, header.targetSha256);
+        encodeDeltaHeader(header, out_.data(), out_.size());
+
+        const std::vector<Match> matches = findMatches();
+        stats_.matches = static_cast<uint32_t>(matches.size());
+
+        size_t pendingStart = 0;        // Start of the region still to emit at alignment
+        int64_t alignment = 0;
+        size_t matchEnd = 0;
+        for (const Match& m : matches) {
+            const int64_t next = static_cast<int64_t>(m.base) - static_cast<int64_t>(m.target);
+            if (next == alignment) {
+                // Same alignment on both sides: the gap is changed bytes in
+                // place (a patched address), one ADD spans it
+                matchEnd = m.target + m.length;
+                continue;
+            }
+
+            // Stretch the previous alignment forward while it scores positive
+            size_t lenF = 0;
+            int64_t score = 0, best = 0;
+            for (size_t t = matchEnd; t < m.target; ++t) {
+                const int64_t b = static_cast<int64_t>(t) + alignment;
+                if (b < 0 || b >= static_cast<int64_t>(baseSize_)) {
+                    break;
+                }
+                score += sameAt(t, alignment) ? 1 : -1;
+                if (score > best) {
+                    best = score;
+                    lenF = t + 1 - matchEnd;
+                }
+            }
+            // And the next match backward
+            size_t lenB = 0;
+            score = 0;
+            best = 0;
+            for (size_t t = m.target; t > matchEnd; --t) {
+                const int64_t b = static_cast<int64_t>(t - 1) + next;
+                if (b < 0 || b >= static_cast<int64_t>(baseSize_)) {
+                    break;
+                }
+                score += sameAt(t - 1, next) ? 1 : -1;
+                if (score > best) {
+                    best = score;
+                    lenB = m.target - (t - 1);
+                }
+            }
+            // Overlap: split where the two alignments agree best with the target
+            if (lenF + lenB > m.target - matchEnd) {
+                const size_t lo = m.target - lenB;
+                const size_t hi = matchEnd + lenF;
+                int64_t agree = 0;
+                for (size_t t = lo; t < m.target; ++t) {
+                    agree += sameAt(t, next) ? 1 : 0;
+                }
+                int64_t bestAgree = agree;
+                size_t split = lo;
+                for (size_t t = lo; t < hi; ++t) {
+                    agree += (sameAt(t, alignment) ? 1 : 0) - (sameAt(t, next) ? 1 : 0);
+                    if (agree > bestAgree) {
+                        bestAgree = agree;
+                        split = t + 1;
+                    }
+                }
+                lenF = split - matchEnd;
+                lenB = m.target - split;
+            }
+
+            emitAligned(pendingStart, matchEnd + lenF, alignment);
+            emitInsert(matchEnd + lenF, m.target - lenB);
+            pendingStart = m.target - lenB;
+            alignment = next;
+            matchEnd = m.target + m.length;
+        }
+
+        size_t lenF = 0;
+        int64_t score = 0, best = 0;
+        for (size_t t = matchEnd; t < targetSize_; ++t) {
+            const int64_t b = static_cast<int64_t>(t) + alignment;
+            if (b < 0 || b >= static_cast<int64_t>(baseSize_)) {
+                break;
+            }
+            score += sameAt(t, alignment) ? 1 : -1;
+            if (score > best) {
+                best = score;
+                lenF = t + 1 - matchEnd;
+            }
+        }
+        emitAligned(pendingStart, matchEnd + lenF, alignment);
+        emitInsert(matchEnd + lenF, targetSize_);
+        out_.push_back(static_cast<uint8_t>(DeltaOp::END));
+        stats_.ops++;
+        return out_;
+    }
+
+    std::vector<DeltaEncoder::Match> DeltaEncoder::findMatches() {
+        std::vector<Match> matches;
+        if (baseSize_ < WINDOW || targetSize_ < WINDOW) {
+            return matches;
+        }
+
+        // Hash chains over every window of the base, newest first
+        std::vector<int32_t> head(static_cast<size_t>(1) << HASH_BITS, -1);
+        std::vector<int32_t> chain(baseSize_, -1);
+        for (size_t p = 0; p + WINDOW <= baseSize_; ++p) {
+            const uint32_t h = windowHash(base_ + p);
+            chain[p] = head[h];
+            head[h] = static_cast<int32_t>(p);
+        }
+
+        int64_t alignment = 0;
+        size_t t = 0;
+        while (t + WINDOW <= targetSize_) {
+            size_t bestLength = 0;
+            size_t bestBase = 0;
+            auto consider = [&](size_t b) {
+                size_t n = 0;
+                while (b + n < baseSize_ && t + n < targetSize_ && base_[b + n] == target_[t + n]) {
+                    n++;
+                }
+                if (n > bestLength) {
+                    bestLength = n;
+                    bestBase = b;
+                }
+            };
+
+            // The current alignment first: after an insertion it usually resumes
+            const int64_t same = static_cast<int64_t>(t) + alignment;
+            if (same >= 0 && same < static_cast<int64_t>(baseSize_)) {
+                consider(static_cast<size_t>(same));
+            }
+            int32_t p = head[windowHash(target_ + t)];
+            for (size_t tries = 0; p >= 0 && tries < MAX_CHAIN; ++tries, p = chain[p]) {
+                consider(static_cast<size_t>(p));
+            }
+
+            if (bestLength >= MIN_MATCH) {
+                matches.push_back({ t, bestBase, bestLength });
+                alignment = static_cast<int64_t>(bestBase) - static_cast<int64_t>(t);
+                t += bestLength;
+            } else {
+                t++;
+            }
+        }
+        return matches;
+    }
+
+    bool DeltaEncoder::sameAt(size_t targetPos, int64_t alignment) const {
+        const int64_t b = static_cast<int64_t>(targetPos) + alignment;
+        return b >= 0 && b < static_cast<int64_t>(baseSize_) && base_[b] == target_[targetPos];
+    }
+
+    void DeltaEncoder::emitAligned(size_t from, size_t to, int64_t alignment) {
+        if (from >= to) {
+            return;
+        }
+        const size_t basePos = static_cast<size_t>(static_cast<int64_t>(from) + alignment);
+        const size_t length = to - from;
+        bool exact = true;
+        for (size_t t = from; t < to && exact; ++t) {
+            exact = base_[basePos + (t - from)] == target_[t];
+        }
+
+        out_.push_back(static_cast<uint8_t>(exact ? DeltaOp::COPY : DeltaOp::ADD));
+        putVarint(static_cast<uint32_t>(length));
+        putVarint(zigzag(static_cast<int64_t>(basePos) - static_cast<int64_t>(baseCursor_)));
+        baseCursor_ = basePos + length;
+        stats_.ops++;
+        if (exact) {
+            stats_.copyBytes += static_cast<uint32_t>(length);
+            return;
+        }
+        stats_.addBytes += static_cast<uint32_t>(length);
+
+        // (zero run, literal run) groups; zero gaps shorter than 3 stay literal
+        auto diff = [&](size_t t) {
+            return static_cast<uint8_t>(target_[t] - base_[basePos + (t - from)]);
+        };
+        size_t t = from;
+        while (t < to) {
+            size_t zeros = 0;
+            while (t + zeros < to && diff(t + zeros) == 0) {
+                zeros++;
+            }
+            const size_t literalStart = t + zeros;
+            size_t end = literalStart;
+            while (end < to) {
+                if (diff(end) != 0) {
+                    end++;
+                    continue;
+                }
+                size_t run = 0;
+                while (end + run < to && diff(end + run) == 0) {
+                    run++;
+                }
+                if (run >= 3 || end + run >= to) {
+                    break;
+                }
+                end += run;
+            }
+            putVarint(static_cast<uint32_t>(zeros));
+            putVarint(static_cast<uint32_t>(end - literalStart));
+            for (size_t i = literalStart; i < end; ++i) {
+                out_.push_back(diff(i));
+            }
+            t = end;
+        }
+    }
+
+    void DeltaEncoder::emitInsert(size_t from, size_t to) {
+        if (from >= to) {
+            return;
+        }
+        out_.push_back(static_cast<uint8_t>(DeltaOp::INSERT));
+        putVarint(static_cast<uint32_t>(to - from));
+        out_.insert(out_.end(), target_ + from, target_ + to);
+        stats_.insertBytes += static_cast<uint32_t>(to - from);
+        stats_.ops++;
+    }
+
+    void DeltaEncoder::putVarint(uint32_t value) {
+        while (value >= 0x80) {
+            out_.push_back(static_cast<uint8_t>(value | 0x80));
+            value >>= 7;
+        }
+        out_.push_back(static_cast<uint8_t>(value));
+    }
+}
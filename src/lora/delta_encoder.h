@@ -0,0 +1,56 @@
+#pragma once
+
+#include "delta_patch.h"
+#include <stdint.h>
+#include <cstddef>
+#include <vector>
+
+// Host-side patch generator for DeltaApplier (scripts/make_delta_patch.sh, native tests)
+//
+// Exact matches of at least MIN_MATCH bytes are found through a hash chain
+// over every 8-byte window of the base. As in bsdiff, each match is then
+// stretched forward and backward while more than half the bytes still agree
+// at the same alignment. The stretched regions become ADD ops. Whatever no
+// alignment covers becomes INSERT.
+namespace LoRaLink {
+
+    struct DeltaEncodeStats {
+        uint32_t matches;
+        uint32_t copyBytes;
+        uint32_t addBytes;
+        uint32_t insertBytes;
+        uint32_t ops;
+    };
+
+    class DeltaEncoder {
+    public:
+        static constexpr size_t MIN_MATCH = 16;
+        static constexpr size_t MAX_CHAIN = 64;     // Candidates tried per position
+
+        std::vector<uint8_t> encode(const uint8_t* base, size_t baseSize,
+                                    const uint8_t* target, size_t targetSize);
+
+        const DeltaEncodeStats& getStats() const { return stats_; }
+
+    private:
+        struct Match {
+            size_t target;
+            size_t base;
+            size_t length;
+        };
+
+        const uint8_t* base_;
+        size_t baseSize_;
+        const uint8_t* target_;
+        size_t targetSize_;
+        size_t baseCursor_;
+        std::vector<uint8_t> out_;
+        DeltaEncodeStats stats_;
+
+        std::vector<Match> findMatches();
+        void emitAligned(size_t from, size_t to, int64_t alignment);
+        void emitInsert(size_t from, size_t to);
+        void putVarint(uint32_t value);
+        bool sameAt(size_t targetPos, int64_t alignment) const;
+    };
+}
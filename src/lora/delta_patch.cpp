@@ -0,0 +1,285 @@
+#include "delta_patch.h"
+#include "frame_codec.h"
+#include <cstring>
+
+namespace LoRaLink {
+
+    size_t encodeDeltaHeader(const DeltaHeader& header, uint8_t* out, size_t outSize) {
+        if (out == nullptr || outSize < DELTA_HEADER_SIZE) {
+            return 0;
+        }
+        memcpy(out, DELTA_MAGIC, sizeof(DELTA_MAGIC));
+        Wire::putU32(out + 4, header.baseSize);
+        Wire::putU32(out + 8, header.targetSize);
+        memcpy(out + 12, header.baseSha256, Sha256::DIGEST_SIZE);
+        memcpy(out + 12 + Sha256::DIGEST_SIZE, header.targetSha256, Sha256::DIGEST_SIZE);
+        return DELTA_HEADER_SIZE;
+    }
+
+    bool decodeDeltaHeader(const uint8_t* data, size_t length, DeltaHeader& header) {
+        if (!isDeltaPatch(data, length) || length < DELTA_HEADER_SIZE) {
+            return false;
+        }
+        header.baseSize = Wire::getU32(data + 4);
+        header.targetSize = Wire::getU32(data + 8);
+        memcpy(header.baseSha256, data + 12, Sha256::DIGEST_SIZE);
+        memcpy(header.targetSha256, data + 12 + Sha256::DIGEST_SIZE, Sha256::DIGEST_SIZE);
+        return true;
+    }
+
+    bool isDeltaPatch(const uint8_t* data, size_t length) {
+        return data != nullptr && length >= sizeof(DELTA_MAGIC) &&
+               memcmp(data, DELTA_MAGIC, sizeof(DELTA_MAGIC)) == 0;
+    }
+
+    DeltaApplier::DeltaApplier()
+        : patch_(nullptr)
+        , target_(nullptr)
+        , written_(0)
+        , pending_(0)
+        , outBuffer_{}
+        , baseBuffer_{}
+        , header_{}
+        , stats_{}
+    {
+    }
+
+    DeltaResult DeltaApplier::apply(IByteSource& patch, IImageSource& base, IUpdateBackend& target, size_t targetLimit) {
+        patch_ = &patch;
+        target_ = &target;
+        written_ = 0;
+        pending_ = 0;
+        header_ = {};
+        stats_ = {};
+
+        uint8_t raw[DELTA_HEADER_SIZE];
+        if (!readPatch(raw, sizeof(raw)) || !decodeDeltaHeader(raw, sizeof(raw), header_)) {
+            return DeltaResult::BAD_HEADER;
+        }
+        if (header_.targetSize == 0 || header_.targetSize > targetLimit) {
+            return DeltaResult::TOO_LARGE;
+        }
+
+        DeltaResult result = verifyBase(base);
+        if (result != DeltaResult::OK) {
+            return result;
+        }
+        result = runOps(base);
+        if (result != DeltaResult::OK) {
+            return result;
+        }
+        return verifyTarget();
+    }
+
+    bool DeltaApplier::readPatch(uint8_t* data, size_t length) {
+        if (!patch_->read(data, length)) {
+            return false;
+        }
+        stats_.patchBytes += static_cast<uint32_t>(length);
+        return true;
+    }
+
+    bool DeltaApplier::readByte(uint8_t& value) {
+        return readPatch(&value, 1);
+    }
+
+    bool DeltaApplier::readVarint(uint32_t& value) {
+        value = 0;
+        for (uint32_t shift = 0; shift < 35; shift += 7) {
+            uint8_t byte;
+            if (!readByte(byte)) {
+                return false;
+            }
+            value |= static_cast<uint32_t>(byte & 0x7F) << shift;
+            if ((byte & 0x80) == 0) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool DeltaApplier::emit(const uint8_t* data, size_t length) {
+        while (length > 0) {
+            size_t n = sizeof(outBuffer_) - pending_;
+            if (n > length) {
+                n = length;
+            }
+            memcpy(outBuffer_ + pending_, data, n);
+            pending_ += n;
+            data += n;
+            length -= n;
+            if (pending_ == sizeof(outBuffer_) && !flush()) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    bool DeltaApplier::flush() {
+        if (pending_ == 0) {
+            return true;
+        }
+        if (written_ + pending_ > header_.targetSize || !target_->write(written_, outBuffer_, pending_)) {
+            return false;
+        }
+        written_ += pending_;
+        pending_ = 0;
+        return true;
+    }
+
+    DeltaResult DeltaApplier::verifyBase(IImageSource& base) {
+        if (header_.baseSize > base.size()) {
+            return DeltaResult::BASE_MISMATCH;
+        }
+        Sha256 sha;
+        for (size_t offset = 0; offset < header_.baseSize; offset += sizeof(baseBuffer_)) {
+            size_t n = header_.baseSize - offset;
+            if (n > sizeof(baseBuffer_)) {
+                n = sizeof(baseBuffer_);
+            }
+            if (!base.read(offset, baseBuffer_, n)) {
+                return DeltaResult::READ_ERROR;
+            }
+            sha.update(baseBuffer_, n);
+        }
+        uint8_t digest[Sha256::DIGEST_SIZE];
+        sha.finish(digest);
+        return memcmp(digest, header_.baseSha256, sizeof(digest)) == 0 ? DeltaResult::OK : DeltaResult::BASE_MISMATCH;
+    }
+
+    DeltaResult DeltaApplier::runOps(IImageSource& base) {
+        uint32_t basePos = 0;
+        for (;;) {
+            uint8_t op;
+            if (!readByte(op)) {
+                return DeltaResult::CORRUPT;
+            }
+            stats_.ops++;
+            if (op == static_cast<uint8_t>(DeltaOp::END)) {
+                break;
+            }
+
+            uint32_t length;
+            if (!readVarint(length) || written_ + pending_ + length > header_.targetSize) {
+                return DeltaResult::CORRUPT;
+            }
+
+            if (op == static_cast<uint8_t>(DeltaOp::INSERT)) {
+                stats_.inserted += length;
+                while (length > 0) {
+                    const uint32_t n = length < sizeof(baseBuffer_) ? length : sizeof(baseBuffer_);
+                    if (!readPatch(baseBuffer_, n)) {
+                        return DeltaResult::CORRUPT;
+                    }
+                    if (!emit(baseBuffer_, n)) {
+                        return DeltaResult::WRITE_ERROR;
+                    }
+                    length -= n;
+                }
+                continue;
+            }
+            if (op != static_cast<uint8_t>(DeltaOp::COPY) && op != static_cast<uint8_t>(DeltaOp::ADD)) {
+                return DeltaResult::CORRUPT;
+            }
+
+            uint32_t zigzag;
+            if (!readVarint(zigzag)) {
+                return DeltaResult::CORRUPT;
+            }
+            const int64_t moved = static_cast<int64_t>(basePos) +
+                                  ((zigzag & 1) ? -static_cast<int64_t>(zigzag >> 1) - 1 : static_cast<int64_t>(zigzag >> 1));
+            if (moved < 0 || moved + length > header_.baseSize) {
+                return DeltaResult::CORRUPT;
+            }
+            basePos = static_cast<uint32_t>(moved);
+
+            const bool add = op == static_cast<uint8_t>(DeltaOp::ADD);
+            DeltaResult result = fromBase(base, basePos, length, add);
+            if (result != DeltaResult::OK) {
+                return result;
+            }
+            basePos += length;
+            if (add) {
+                stats_.added += length;
+            } else {
+                stats_.copied += length;
+            }
+        }
+
+        if (patch_->remaining() != 0 || written_ + pending_ != header_.targetSize) {
+            return DeltaResult::CORRUPT;
+        }
+        return flush() ? DeltaResult::OK : DeltaResult::WRITE_ERROR;
+    }
+
+    // COPY, or ADD with its (zero run, literal run) groups applied on the fly
+    DeltaResult DeltaApplier::fromBase(IImageSource& base, uint32_t basePos, uint32_t length, bool add) {
+        uint32_t zeros = 0;         // Left in the current zero run
+        uint32_t literals = 0;      // Left in the current literal run
+        uint32_t done = 0;
+        while (done < length) {
+            uint32_t n = length - done;
+            if (n > sizeof(baseBuffer_)) {
+                n = sizeof(baseBuffer_);
+            }
+            if (!base.read(basePos + done, baseBuffer_, n)) {
+                return DeltaResult::READ_ERROR;
+            }
+            for (uint32_t i = 0; add && i < n; ++i) {
+                while (zeros == 0 && literals == 0) {
+                    if (!readVarint(zeros) || !readVarint(literals) ||
+                        zeros + literals == 0 || zeros + literals > length - done - i) {
+                        return DeltaResult::CORRUPT;
+                    }
+                }
+                if (zeros > 0) {
+                    zeros--;
+                    continue;
+                }
+                uint8_t diff;
+                if (!readByte(diff)) {
+                    return DeltaResult::CORRUPT;
+                }
+                baseBuffer_[i] = static_cast<uint8_t>(baseBuffer_[i] + diff);
+                literals--;
+            }
+            if (!emit(baseBuffer_, n)) {
+                return DeltaResult::WRITE_ERROR;
+            }
+            done += n;
+        }
+        return zeros == 0 && literals == 0 ? DeltaResult::OK : DeltaResult::CORRUPT;
+    }
+
+    // Hash what actually landed in flash, as OtaReceiver::finish() does
+    DeltaResult DeltaApplier::verifyTarget() {
+        Sha256 sha;
+        for (size_t offset = 0; offset < header_.targetSize; offset += sizeof(baseBuffer_)) {
+            size_t n = header_.targetSize - offset;
+            if (n > sizeof(baseBuffer_)) {
+                n = sizeof(baseBuffer_);
+            }
+            if (!target_->read(offset, baseBuffer_, n)) {
+                return DeltaResult::READ_ERROR;
+            }
+            sha.update(baseBuffer_, n);
+        }
+        uint8_t digest[Sha256::DIGEST_SIZE];
+        sha.finish(digest);
+        return memcmp(digest, header_.targetSha256, sizeof(digest)) == 0 ? DeltaResult::OK : DeltaResult::TARGET_MISMATCH;
+    }
+
+    const char* DeltaApplier::resultToString(DeltaResult result) {
+        switch (result) {
+            case DeltaResult::OK: return "OK";
+            case DeltaResult::BAD_HEADER: return "BAD_HEADER";
+            case DeltaResult::BASE_MISMATCH: return "BASE_MISMATCH";
+            case DeltaResult::TOO_LARGE: return "TOO_LARGE";
+            case DeltaResult::CORRUPT: return "CORRUPT";
+            case DeltaResult::READ_ERROR: return "READ_ERROR";
+            case DeltaResult::WRITE_ERROR: return "WRITE_ERROR";
+            case DeltaResult::TARGET_MISMATCH: return "TARGET_MISMATCH";
+            default: return "UNKNOWN";
+        }
+    }
+}
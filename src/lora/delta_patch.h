@@ -0,0 +1,109 @@
+#pragma once
+
+#include "ota_receiver.h"
+#include <stdint.h>
+#include <cstddef>
+
+// Delta firmware updates: rebuild a new image from the running one plus a patch
+//
+// A patch is a header followed by a stream of ops that produce the target
+// image front to back:
+//
+//   COPY   len, base delta          target bytes = base bytes
+//   ADD    len, base delta, runs    target bytes = base bytes + diff (mod 256)
+//   INSERT len, bytes               target bytes = literal bytes
+//   END
+//
+// Lengths are LEB128 varints. The base delta is a zigzag varint that moves
+// the base cursor before the op; the cursor then advances by len. ADD is
+// what keeps patches small for relinked code. A moved function changes only
+// the addresses inside it, so its diff against the old copy is mostly zero.
+// The diff is stored as (zero run, literal run, literal bytes) groups.
+//
+// The header carries both image sizes and SHA-256 digests. The applier checks
+// the base before it writes anything and the target once it is written.
+// It reads the base and writes the target through 256-byte buffers, so RAM
+// use does not depend on image or patch size. StagedUpdateBackend
+// (staged_update.h) stores the patch and runs the applier.
+namespace LoRaLink {
+
+    constexpr uint8_t DELTA_MAGIC[4] = { 'L', 'D', 'P', '1' };
+    constexpr size_t DELTA_HEADER_SIZE = 4 + 4 + 4 + Sha256::DIGEST_SIZE * 2;
+    constexpr size_t DELTA_IO_BLOCK = 256;
+
+    enum class DeltaOp : uint8_t {
+        END    = 0x00,
+        COPY   = 0x01,
+        ADD    = 0x02,
+        INSERT = 0x03
+    };
+
+    struct DeltaHeader {
+        uint32_t baseSize;
+        uint32_t targetSize;
+        uint8_t baseSha256[Sha256::DIGEST_SIZE];
+        uint8_t targetSha256[Sha256::DIGEST_SIZE];
+    };
+
+    size_t encodeDeltaHeader(const DeltaHeader& header, uint8_t* out, size_t outSize);
+    bool decodeDeltaHeader(const uint8_t* data, size_t length, DeltaHeader& header);
+    // True if data starts with the patch magic
+    bool isDeltaPatch(const uint8_t* data, size_t length);
+
+    enum class DeltaResult {
+        OK,
+        BAD_HEADER,         // Not a patch, or truncated header
+        BASE_MISMATCH,      // Running image is not the one the patch was made against
+        TOO_LARGE,          // Target does not fit in front of the staged patch
+        CORRUPT,            // Op stream out of bounds or inconsistent
+        READ_ERROR,
+        WRITE_ERROR,
+        TARGET_MISMATCH     // Rebuilt image hash differs from the header
+    };
+
+    struct DeltaStats {
+        uint32_t ops;
+        uint32_t copied;        // Target bytes from COPY
+        uint32_t added;         // Target bytes from ADD
+        uint32_t inserted;      // Target bytes from INSERT
+        uint32_t patchBytes;    // Patch bytes consumed
+    };
+
+    // Applies a patch read front to back from a source (staged in flash, or
+    // decompressed on the fly). The target is written from offset 0 and must
+    // end at or before targetLimit.
+    class DeltaApplier {
+    public:
+        DeltaApplier();
+
+        DeltaResult apply(IByteSource& patch, IImageSource& base, IUpdateBackend& target, size_t targetLimit);
+
+        const DeltaHeader& getHeader() const { return header_; }
+        const DeltaStats& getStats() const { return stats_; }
+
+        static const char* resultToString(DeltaResult result);
+
+    private:
+        IByteSource* patch_;
+
+        // Buffered sequential writer for the target
+        IUpdateBackend* target_;
+        size_t written_;
+        size_t pending_;
+        uint8_t outBuffer_[DELTA_IO_BLOCK];
+
+        uint8_t baseBuffer_[DELTA_IO_BLOCK];
+        DeltaHeader header_;
+        DeltaStats stats_;
+
+        bool readPatch(uint8_t* data, size_t length);
+        bool readByte(uint8_t& value);
+        bool readVarint(uint32_t& value);
+        bool emit(const uint8_t* data, size_t length);
+        bool flush();
+        DeltaResult verifyBase(IImageSource& base);
+        DeltaResult verifyTarget();
+        DeltaResult runOps(IImageSource& base);
+        DeltaResult fromBase(IImageSource& base, uint32_t basePos, uint32_t length, bool add);
+    };
+}
@@ -0,0 +1,107 @@
+#include "esp_ota_backend.h"
+
+namespace LoRaLink {
+
+    bool EspOtaBackend::begin(size_t imageSize) {
+        abort();
+        partition_ = esp_ota_get_next_update_partition(nullptr);
+        if (partition_ == nullptr || imageSize > partition_->size) {
+            return false;
+        }
+        // Erases only the sectors the image will occupy
+        if (esp_ota_begin(partition_, imageSize, &handle_) != ESP_OK) {
+            return false;
+        }
+        open_ = true;
+        return true;
+    }
+
+    bool EspOtaBackend::write(size_t offset, const uint8_t* data, size_t length) {
+        if (!open_) {
+            return false;
+        }
+        return esp_ota_write_with_offset(handle_, data, length, offset) == ESP_OK;
+    }
+
+    bool EspOtaBackend::read(size_t offset, uint8_t* data, size_t length) {
+        if (!open_) {
+            return false;
+        }
+        return esp_partition_read(partition_, offset, data, length) == ESP_OK;
+    }
+
+    bool EspOtaBackend::finish() {
+        if (!open_) {
+            return false;
+        }
+        open_ = false;
+        // esp_ota_end() also validates the app image header and its appended digest
+        if (esp_ota_end(handle_) != ESP_OK) {
+            return false;
+        }
+        return esp_ota_set_boot_partition(partition_) == ESP_OK;
+    }
+
+    size_t EspOtaBackend::capacity() const {
+        const esp_partition_t* partition = esp_ota_get_next_update_partition(nullptr);
+        return partition != nullptr ? partition->size : 0;
+    }
+
+    void EspOtaBackend::abort() {
+        if (open_) {
+            esp_ota_abort(handle_);
+            open_ = false;
+        }
+    }
+
+    size_t EspRunningImage::size() const {
+        const esp_partition_t* partition = esp_ota_get_running_partition();
+        return partition != nullptr ? partition->size : 0;
+    }
+
+    bool EspRunningImage::read(size_t offset, uint8_t* data, size_t length) {
+        const esp_partition_t* partition = esp_ota_get_running_partition();
+        return partition != nullptr && esp_partition_read(partition, offset, data, length) == ESP_OK;
+    }
+
+    EspPartitionImage::EspPartitionImage(const esp_partition_t* partition, size_t size)
+        : partition_(partition)
+        , size_(partition != nullptr && size <= partition->size ? size : 0)
+    {
+    }
+
+    bool EspPartitionImage::read(size_t offset, uint8_t* data, size_t length) {
+        return partition_ != nullptr && offset + length <= size_ &&
+               esp_partition_read(partition_, offset, data, length) == ESP_OK;
+    }
+
+    const esp_partition_t* EspPartitionRegion::find() const {
+        if (partition_ == nullptr) {
+            partition_ = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, label_);
+        }
+        if (partition_ == nullptr && fallbackLabel_ != nullptr) {
+            partition_ = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, fallbackLabel_);
+        }
+        return partition_;
+    }
+
+    size_t EspPartitionRegion::size() const {
+        const esp_partition_t* partition = find();
+        return partition != nullptr ? partition->size : 0;
+    }
+
+    bool EspPartitionRegion::erase(size_t offset, size_t length) {
+        const esp_partition_t* partition = find();
+        return partition != nullptr && esp_partition_erase_range(partition, offset, length) == ESP_OK;
+    }
+
+    bool EspPartitionRegion::write(size_t offset, const uint8_t* data, size_t length) {
+        const esp_partition_t* partition = find();
+        return partition != nullptr && esp_partition_write(partition, offset, data, length) == ESP_OK;
+    }
+
+    bool EspPartitionRegion::read(size_t offset, uint8_t* data, size_t length) {
+        const esp_partition_t* partition = find();
+        return partition != nullptr && esp_partition_read(partition, offset, data, length) == ESP_OK;
+    }
+}
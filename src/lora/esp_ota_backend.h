@@ -0,0 +1,73 @@
+#pragma once
+
+#include "ota_receiver.h"
+#include "delta_patch.h"
+#include "firmware_store.h"
+#include <esp_ota_ops.h>
+#include <esp_partition.h>
+
+// IUpdateBackend on the ESP-IDF OTA API (firmware builds only)
+//
+// Arduino's Update class only appends, so it cannot take chunks out of order;
+// esp_ota_write_with_offset() can, once esp_ota_begin() has erased the range.
+namespace LoRaLink {
+
+    class EspOtaBackend : public IUpdateBackend {
+    public:
+        EspOtaBackend() : partition_(nullptr), handle_(0), open_(false) {}
+
+        bool begin(size_t imageSize) override;
+        bool write(size_t offset, const uint8_t* data, size_t length) override;
+        bool read(size_t offset, uint8_t* data, size_t length) override;
+        bool finish() override;
+        void abort() override;
+        size_t capacity() const override;
+
+    private:
+        const esp_partition_t* partition_;
+        esp_ota_handle_t handle_;
+        bool open_;
+    };
+
+    // The running app partition, read as the base of a delta update
+    class EspRunningImage : public IImageSource {
+    public:
+        size_t size() const override;
+        bool read(size_t offset, uint8_t* data, size_t length) override;
+    };
+
+    // The first size bytes of an app partition, e.g. the image ArduinoOTA just wrote
+    class EspPartitionImage : public IImageSource {
+    public:
+        EspPartitionImage(const esp_partition_t* partition, size_t size);
+
+        size_t size() const override { return size_; }
+        bool read(size_t offset, uint8_t* data, size_t length) override;
+
+    private:
+        const esp_partition_t* partition_;
+        size_t size_;
+    };
+
+    // IFlashRegion on a data partition found by label (see partitions_lora.csv);
+    // the fallback label covers boards still on the stock table
+    class EspPartitionRegion : public IFlashRegion {
+    public:
+        explicit EspPartitionRegion(const char* label, const char* fallbackLabel = nullptr)
+            : label_(label), fallbackLabel_(fallbackLabel), partition_(nullptr) {}
+
+        bool isPresent() const { return find() != nullptr; }
+
+        size_t size() const override;
+        bool erase(size_t offset, size_t length) override;
+        bool write(size_t offset, const uint8_t* data, size_t length) override;
+        bool read(size_t offset, uint8_t* data, size_t length) override;
+
+    private:
+        const char* label_;
+        const char* fallbackLabel_;
+        mutable const esp_partition_t* partition_;     // Looked up on first use
+
+        const esp_partition_t* find() const;
+    };
+}
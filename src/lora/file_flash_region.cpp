@@ -0,0 +1,81 @@
+#include "file_flash_region.h"
+#include <cstring>
+
+namespace LoRaLink {
+
+    FileFlashRegion::FileFlashRegion(const char* path, size_t size)
+        : file_(fopen(path, "r+b"))
+        , size_(size)
+        , failWriteAt_(0)
+        , stats_{}
+    {
+        if (file_ == nullptr) {
+            file_ = fopen(path, "w+b");
+            uint8_t erased[FLASH_SECTOR_SIZE];
+            memset(erased, 0xFF, sizeof(erased));
+            for (size_t offset = 0; file_ != nullptr && offset < size_; offset += sizeof(erased)) {
+                const size_t n = size_ - offset < sizeof(erased) ? size_ - offset : sizeof(erased);
+                fwrite(erased, 1, n, file_);
+            }
+        }
+    }
+
+    FileFlashRegion::~FileFlashRegion() {
+        if (file_ != nullptr) {
+            fclose(file_);
+        }
+    }
+
+    bool FileFlashRegion::erase(size_t offset, size_t length) {
+        stats_.erases++;
+        if (file_ == nullptr || offset % FLASH_SECTOR_SIZE != 0 || length % FLASH_SECTOR_SIZE != 0 ||
+            offset > size_ || length > size_ - offset) {
+            return false;
+        }
+        uint8_t erased[FLASH_SECTOR_SIZE];
+        memset(erased, 0xFF, sizeof(erased));
+        for (size_t done = 0; done < length; done += sizeof(erased)) {
+            if (fseek(file_, static_cast<long>(offset + done), SEEK_SET) != 0 ||
+                fwrite(erased, 1, sizeof(erased), file_) != sizeof(erased)) {
+                return false;
+            }
+        }
+        return fflush(file_) == 0;
+    }
+
+    bool FileFlashRegion::write(size_t offset, const uint8_t* data, size_t length) {
+        stats_.writes++;
+        if (file_ == nullptr || data == nullptr || offset > size_ || length > size_ - offset) {
+            return false;
+        }
+        if (failWriteAt_ != 0 && stats_.writes == failWriteAt_) {
+            failWriteAt_ = 0;
+            return false;
+        }
+
+        uint8_t current[256];
+        for (size_t done = 0; done < length; done += sizeof(current)) {
+            const size_t n = length - done < sizeof(current) ? length - done : sizeof(current);
+            if (fseek(file_, static_cast<long>(offset + done), SEEK_SET) != 0 ||
+                fread(current, 1, n, file_) != n) {
+                return false;
+            }
+            for (size_t i = 0; i < n; ++i) {
+                current[i] &= data[done + i];   // NOR flash: program clears bits only
+            }
+            if (fseek(file_, static_cast<long>(offset + done), SEEK_SET) != 0 ||
+                fwrite(current, 1, n, file_) != n) {
+                return false;
+            }
+        }
+        return fflush(file_) == 0;
+    }
+
+    bool FileFlashRegion::read(size_t offset, uint8_t* data, size_t length) {
+        stats_.reads++;
+        if (file_ == nullptr || data == nullptr || offset > size_ || length > size_ - offset) {
+            return false;
+        }
+        return fseek(file_, static_cast<long>(offset), SEEK_SET) == 0 && fread(data, 1, length, file_) == length;
+    }
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include "firmware_store.h"
+#include <stdint.h>
+#include <cstddef>
+#include <cstdio>
+
+// IFlashRegion backed by a file (native tests and host tools)
+//
+// The file is created at the region size, filled with 0xFF, if it does not
+// exist yet, and it persists between instances, so a test can "reboot" by
+// opening it again. Writes behave like NOR flash: they can only clear bits,
+// so writing over unerased data shows up in the contents.
+namespace LoRaLink {
+
+    struct FileFlashStats {
+        uint32_t erases;
+        uint32_t writes;
+        uint32_t reads;
+    };
+
+    class FileFlashRegion : public IFlashRegion {
+    public:
+        FileFlashRegion(const char* path, size_t size);
+        ~FileFlashRegion() override;
+
+        FileFlashRegion(const FileFlashRegion&) = delete;
+        FileFlashRegion& operator=(const FileFlashRegion&) = delete;
+
+        bool isOpen() const { return file_ != nullptr; }
+        // Fail the n-th write (1-based) from now; 0 disables
+        void failWriteAfter(uint32_t writes) { failWriteAt_ = writes ? stats_.writes + writes : 0; }
+        const FileFlashStats& getStats() const { return stats_; }
+
+        size_t size() const override { return size_; }
+        bool erase(size_t offset, size_t length) override;
+        bool write(size_t offset, const uint8_t* data, size_t length) override;
+        bool read(size_t offset, uint8_t* data, size_t length) override;
+
+    private:
+        FILE* file_;
+        size_t size_;
+        uint32_t failWriteAt_;
+        FileFlashStats stats_;
+    };
+}
@@ -0,0 +1,239 @@
+#include "firmware_store.h"
+#include "frame_codec.h"
+#include <cstring>
+
+namespace LoRaLink {
+
+    uint32_t appImageVersion(IImageSource& image) {
+        uint8_t head[ESP_APP_VERSION_OFFSET + ESP_APP_VERSION_SIZE];
+        if (image.size() < sizeof(head) || !image.read(0, head, sizeof(head)) || head[0] != ESP_IMAGE_MAGIC ||
+            Wire::getU32(head + ESP_APP_DESC_OFFSET) != ESP_APP_DESC_MAGIC) {
+            return 0;
+        }
+        const char* text = reinterpret_cast<const char*>(head + ESP_APP_VERSION_OFFSET);
+        const char* end = text + ESP_APP_VERSION_SIZE;
+        if (text < end && (*text == 'v' || *text == 'V')) {
+            text++;
+        }
+        // Up to three numeric parts, 0..255 each; anything after the last is a suffix
+        uint32_t version = 0;
+        int parts = 0;
+        while (parts < 3 && text < end && *text >= '0' && *text <= '9') {
+            uint32_t part = 0;
+            while (text < end && *text >= '0' && *text <= '9') {
+                part = part * 10 + static_cast<uint32_t>(*text++ - '0');
+                if (part > 255) {
+                    return 0;
+                }
+            }
+            version |= part << (8 * (2 - parts));
+            parts++;
+            if (text < end && *text == '.') {
+                text++;
+            } else {
+                break;
+            }
+        }
+        // A git hash starting with digits ("1a2b3c4") is not a version
+        const bool ended = text == end || *text == '\0' || *text == '-' || *text == '+' || *text == ' ';
+        return parts > 0 && ended ? version : 0;
+    }
+
+    FirmwareStore::FirmwareStore(IFlashRegion& region)
+        : region_(region)
+        , info_{}
+        , valid_(false)
+        , capturing_(false)
+        , expected_(0)
+        , written_(0)
+        , erasedEnd_(0)
+        , sha_()
+        , stats_{}
+    {
+    }
+
+    bool FirmwareStore::load() {
+        valid_ = false;
+        info_ = {};
+        uint8_t record[FIRMWARE_RECORD_SIZE];
+        if (region_.size() <= IMAGE_OFFSET || !region_.read(0, record, sizeof(record)) ||
+            memcmp(record, FIRMWARE_STORE_MAGIC, sizeof(FIRMWARE_STORE_MAGIC)) != 0) {
+            return false;
+        }
+        StoredFirmwareInfo info;
+        info.size = Wire::getU32(record + 4);
+        info.version = Wire::getU32(record + 8);
+        memcpy(info.sha256, record + 12, Sha256::DIGEST_SIZE);
+        if (info.size == 0 || info.size > capacity()) {
+            return false;
+        }
+
+        uint8_t digest[Sha256::DIGEST_SIZE];
+        if (!hashImage(info.size, digest) || memcmp(digest, info.sha256, sizeof(digest)) != 0) {
+            return false;
+        }
+        info_ = info;
+        valid_ = true;
+        return true;
+    }
+
+    size_t FirmwareStore::capacity() const {
+        const size_t regionSize = region_.size();
+        return regionSize > IMAGE_OFFSET ? regionSize - IMAGE_OFFSET : 0;
+    }
+
+    StoreResult FirmwareStore::begin(size_t imageSize) {
+        abort();
+        if (imageSize == 0 || imageSize > capacity()) {
+            return fail(StoreResult::TOO_LARGE);
+        }
+        // The old image is gone from here on: drop its record first
+        valid_ = false;
+        info_ = {};
+        if (!region_.erase(0, FLASH_SECTOR_SIZE)) {
+            return fail(StoreResult::FLASH_ERROR);
+        }
+        stats_.sectorsErased++;
+        capturing_ = true;
+        expected_ = imageSize;
+        written_ = 0;
+        erasedEnd_ = IMAGE_OFFSET;
+        sha_.reset();
+        return StoreResult::OK;
+    }
+
+    // Sectors are erased just ahead of the data, so a capture costs one pass
+    StoreResult FirmwareStore::append(const uint8_t* data, size_t length) {
+        if (!capturing_) {
+            return StoreResult::NOT_CAPTURING;
+        }
+        if (length > expected_ - written_) {
+            abort();
+            return fail(StoreResult::SIZE_MISMATCH);
+        }
+        const size_t end = IMAGE_OFFSET + written_ + length;
+        while (erasedEnd_ < end) {
+            if (!region_.erase(erasedEnd_, FLASH_SECTOR_SIZE)) {
+                abort();
+                return fail(StoreResult::FLASH_ERROR);
+            }
+            erasedEnd_ += FLASH_SECTOR_SIZE;
+            stats_.sectorsErased++;
+        }
+        if (!region_.write(IMAGE_OFFSET + written_, data, length)) {
+            abort();
+            return fail(StoreResult::FLASH_ERROR);
+        }
+        sha_.update(data, length);
+        written_ += length;
+        stats_.bytesWritten += static_cast<uint32_t>(length);
+        return StoreResult::OK;
+    }
+
+    StoreResult FirmwareStore::commit(uint32_t version) {
+        if (!capturing_) {
+            return StoreResult::NOT_CAPTURING;
+        }
+        capturing_ = false;
+        if (written_ != expected_) {
+            return fail(StoreResult::SIZE_MISMATCH);
+        }
+
+        StoredFirmwareInfo info;
+        info.size = static_cast<uint32_t>(written_);
+        info.version = version;
+        sha_.finish(info.sha256);
+        uint8_t digest[Sha256::DIGEST_SIZE];
+        if (!hashImage(info.size, digest)) {
+            return fail(StoreResult::FLASH_ERROR);
+        }
+        if (memcmp(digest, info.sha256, sizeof(digest)) != 0) {
+            return fail(StoreResult::HASH_MISMATCH);
+        }
+
+        uint8_t record[FIRMWARE_RECORD_SIZE];
+        memcpy(record, FIRMWARE_STORE_MAGIC, sizeof(FIRMWARE_STORE_MAGIC));
+        Wire::putU32(record + 4, info.size);
+        Wire::putU32(record + 8, info.version);
+        memcpy(record + 12, info.sha256, Sha256::DIGEST_SIZE);
+        if (!region_.write(0, record, sizeof(record))) {
+            return fail(StoreResult::FLASH_ERROR);
+        }
+        info_ = info;
+        valid_ = true;
+        stats_.captures++;
+        return StoreResult::OK;
+    }
+
+    void FirmwareStore::abort() {
+        capturing_ = false;
+        expected_ = 0;
+        written_ = 0;
+    }
+
+    StoreResult FirmwareStore::capture(IImageSource& source, uint32_t version) {
+        StoreResult result = begin(source.size());
+        uint8_t buffer[256];
+        for (size_t offset = 0; result == StoreResult::OK && offset < source.size(); offset += sizeof(buffer)) {
+            size_t n = source.size() - offset;
+            if (n > sizeof(buffer)) {
+                n = sizeof(buffer);
+            }
+            if (!source.read(offset, buffer, n)) {
+                abort();
+                return fail(StoreResult::FLASH_ERROR);
+            }
+            result = append(buffer, n);
+        }
+        return result == StoreResult::OK ? commit(version) : result;
+    }
+
+    bool FirmwareStore::read(size_t offset, uint8_t* data, size_t length) {
+        if (!valid_ || offset > info_.size || length > info_.size - offset) {
+            return false;
+        }
+        if (!region_.read(IMAGE_OFFSET + offset, data, length)) {
+            return false;
+        }
+        stats_.bytesRead += static_cast<uint32_t>(length);
+        return true;
+    }
+
+    void FirmwareStore::resetStats() {
+        stats_ = {};
+    }
+
+    bool FirmwareStore::hashImage(size_t size, uint8_t* digest) {
+        Sha256 sha;
+        uint8_t buffer[256];
+        for (size_t offset = 0; offset < size; offset += sizeof(buffer)) {
+            size_t n = size - offset;
+            if (n > sizeof(buffer)) {
+                n = sizeof(buffer);
+            }
+            if (!region_.read(IMAGE_OFFSET + offset, buffer, n)) {
+                return false;
+            }
+            sha.update(buffer, n);
+        }
+        sha.finish(digest);
+        return true;
+    }
+
+    StoreResult FirmwareStore::fail(StoreResult result) {
+        stats_.failures++;
+        return result;
+    }
+
+    const char* FirmwareStore::resultToString(StoreResult result) {
+        switch (result) {
+            case StoreResult::OK: return "OK";
+            case StoreResult::NOT_CAPTURING: return "NOT_CAPTURING";
+            case StoreResult::TOO_LARGE: return "TOO_LARGE";
+            case StoreResult::SIZE_MISMATCH: return "SIZE_MISMATCH";
+            case StoreResult::FLASH_ERROR: return "FLASH_ERROR";
+            case StoreResult::HASH_MISMATCH: return "HASH_MISMATCH";
+            default: return "UNKNOWN";
+        }
+    }
+}
@@ -0,0 +1,116 @@
+#pragma once
+
+#include "ota_receiver.h"
+#include <stdint.h>
+#include <cstddef>
+
+// Firmware image kept in flash for LoRa distribution (receiver role)
+//
+// The store owns a flash region: an ESP data partition on the device, a file
+// in native tests. Its first sector holds a small record (magic, size,
+// version, SHA-256) and the image follows from the second sector. Capture
+// erases the record first and writes it last, after the image has been read
+// back and hashed, so a reset mid-capture leaves an empty store rather than
+// a truncated image. Readers take chunks straight from flash, so RAM use does
+// not depend on image size.
+namespace LoRaLink {
+
+    constexpr size_t FLASH_SECTOR_SIZE = 4096;
+
+    // Erase-before-write flash area
+    class IFlashRegion {
+    public:
+        virtual ~IFlashRegion() = default;
+
+        virtual size_t size() const = 0;
+        // Offset and length are sector-aligned; erased bytes read 0xFF
+        virtual bool erase(size_t offset, size_t length) = 0;
+        virtual bool write(size_t offset, const uint8_t* data, size_t length) = 0;
+        virtual bool read(size_t offset, uint8_t* data, size_t length) = 0;
+    };
+
+    constexpr uint8_t FIRMWARE_STORE_MAGIC[4] = { 'L', 'F', 'W', '1' };
+    constexpr size_t FIRMWARE_RECORD_SIZE = 4 + 4 + 4 + Sha256::DIGEST_SIZE;
+
+    // ESP32 app image: esp_app_desc_t follows the 24-byte image header and
+    // the first 8-byte segment header; its version string is 16 bytes in
+    constexpr uint8_t ESP_IMAGE_MAGIC = 0xE9;
+    constexpr uint32_t ESP_APP_DESC_MAGIC = 0xABCD5432;
+    constexpr size_t ESP_APP_DESC_OFFSET = 24 + 8;
+    constexpr size_t ESP_APP_VERSION_OFFSET = ESP_APP_DESC_OFFSET + 16;
+    constexpr size_t ESP_APP_VERSION_SIZE = 32;
+
+    // Version the image was built as, from its app description: "1.2.3" or
+    // "v1.2.3-rc1" is 0x010203; 0 if the image has no description or the
+    // version is not numeric (a git hash)
+    uint32_t appImageVersion(IImageSource& image);
+
+    struct StoredFirmwareInfo {
+        uint32_t size;
+        uint32_t version;           // appImageVersion(); 0: unknown
+        uint8_t sha256[Sha256::DIGEST_SIZE];
+    };
+
+    enum class StoreResult {
+        OK,
+        NOT_CAPTURING,
+        TOO_LARGE,          // Image does not fit behind the record sector
+        SIZE_MISMATCH,      // Fewer or more bytes than begin() announced
+        FLASH_ERROR,
+        HASH_MISMATCH       // Read-back differs from what was appended
+    };
+
+    struct FirmwareStoreStats {
+        uint32_t captures;
+        uint32_t sectorsErased;
+        uint32_t bytesWritten;
+        uint32_t bytesRead;
+        uint32_t failures;
+    };
+
+    class FirmwareStore : public IImageSource {
+    public:
+        static constexpr size_t IMAGE_OFFSET = FLASH_SECTOR_SIZE;
+
+        explicit FirmwareStore(IFlashRegion& region);
+
+        // Reads the record and checks the stored image against its hash
+        bool load();
+        size_t capacity() const;
+
+        // Streaming capture: begin, append in order, commit
+        StoreResult begin(size_t imageSize);
+        StoreResult append(const uint8_t* data, size_t length);
+        StoreResult commit(uint32_t version);
+        void abort();
+        // Whole capture from another image (e.g. the partition ArduinoOTA just wrote)
+        StoreResult capture(IImageSource& source, uint32_t version);
+
+        bool hasImage() const { return valid_; }
+        bool isCapturing() const { return capturing_; }
+        const StoredFirmwareInfo& info() const { return info_; }
+
+        // IImageSource over the stored image; size() is 0 when empty
+        size_t size() const override { return valid_ ? info_.size : 0; }
+        bool read(size_t offset, uint8_t* data, size_t length) override;
+
+        const FirmwareStoreStats& getStats() const { return stats_; }
+        void resetStats();
+
+        static const char* resultToString(StoreResult result);
+
+    private:
+        IFlashRegion& region_;
+        StoredFirmwareInfo info_;
+        bool valid_;
+        bool capturing_;
+        size_t expected_;
+        size_t written_;
+        size_t erasedEnd_;      // Region offset up to which sectors are erased
+        Sha256 sha_;
+        FirmwareStoreStats stats_;
+
+        bool hashImage(size_t size, uint8_t* digest);
+        StoreResult fail(StoreResult result);
+    };
+}
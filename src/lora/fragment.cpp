@@ -0,0 +1,313 @@
+#include "fragment.h"
+#include <cstring>
+
+namespace LoRaLink {
+
+    namespace {
+        constexpr size_t FRAGMENT_FRAME_OVERHEAD = FRAME_OVERHEAD + FRAGMENT_HEADER_SIZE;
+
+        uint32_t fragmentAirUs(const LoRaModulation& modulation, size_t dataSize) {
+            return timeOnAirUs(modulation, FRAGMENT_FRAME_OVERHEAD + dataSize);
+        }
+
+        size_t lastData(const FragmentPlan& plan, size_t length) {
+            return length - static_cast<size_t>(plan.count - 1) * plan.size;
+        }
+    }
+
+    size_t fragmentStride(const FragmentHeader& header, size_t dataSize) {
+        const size_t total = header.totalLength;
+        if (header.count == 0 || header.index >= header.count || total == 0 || dataSize == 0 ||
+            dataSize > FRAGMENT_MAX_DATA) {
+            return 0;
+        }
+        const size_t others = header.count - 1;
+        if (others == 0) {
+            return dataSize == total ? dataSize : 0;
+        }
+        if (header.index < others) {
+            // The last fragment holds what is left: at least one byte, at most a stride
+            const size_t before = others * dataSize;
+            return before < total && total - before <= dataSize ? dataSize : 0;
+        }
+        if (dataSize >= total || (total - dataSize) % others != 0) {
+            return 0;
+        }
+        const size_t stride = (total - dataSize) / others;
+        return stride >= dataSize && stride <= FRAGMENT_MAX_DATA ? stride : 0;
+    }
+
+    size_t encodeFragment(const FragmentHeader& header, const uint8_t* data, size_t dataSize,
+                          uint8_t* out, size_t outSize) {
+        if (data == nullptr || out == nullptr || fragmentStride(header, dataSize) == 0) {
+            return 0;
+        }
+        const size_t total = FRAGMENT_HEADER_SIZE + dataSize;
+        if (outSize < total) {
+            return 0;
+        }
+        Wire::putU16(out, header.messageId);
+        out[2] = header.kind;
+        out[3] = header.index;
+        out[4] = header.count;
+        Wire::putU16(out + 5, header.totalLength);
+        memcpy(out + FRAGMENT_HEADER_SIZE, data, dataSize);
+        return total;
+    }
+
+    bool decodeFragment(const uint8_t* payload, size_t payloadSize, FragmentHeader& header,
+                        const uint8_t*& data, size_t& dataSize) {
+        if (payload == nullptr || payloadSize <= FRAGMENT_HEADER_SIZE) {
+            return false;
+        }
+        header.messageId = Wire::getU16(payload);
+        header.kind = payload[2];
+        header.index = payload[3];
+        header.count = payload[4];
+        header.totalLength = Wire::getU16(payload + 5);
+        if (fragmentStride(header, payloadSize - FRAGMENT_HEADER_SIZE) == 0) {
+            return false;
+        }
+        data = payload + FRAGMENT_HEADER_SIZE;
+        dataSize = payloadSize - FRAGMENT_HEADER_SIZE;
+        return true;
+    }
+
+    size_t fragmentDataFor(const LoRaModulation& modulation, uint32_t maxFrameAirUs) {
+        if (maxFrameAirUs == 0 || fragmentAirUs(modulation, FRAGMENT_MAX_DATA) <= maxFrameAirUs) {
+            return FRAGMENT_MAX_DATA;
+        }
+        if (fragmentAirUs(modulation, 1) > maxFrameAirUs) {
+            return 0;
+        }
+        // Airtime only grows with length: largest data still under the cap
+        size_t fits = 1;
+        size_t tooLong = FRAGMENT_MAX_DATA;
+        while (tooLong - fits > 1) {
+            const size_t mid = fits + (tooLong - fits) / 2;
+            if (fragmentAirUs(modulation, mid) <= maxFrameAirUs) {
+                fits = mid;
+            } else {
+                tooLong = mid;
+            }
+        }
+        return fits;
+    }
+
+    bool planFragments(size_t length, size_t maxData, const LoRaModulation& modulation, FragmentPlan& plan) {
+        if (length == 0 || length > FRAGMENT_MAX_MESSAGE || maxData == 0) {
+            return false;
+        }
+        if (maxData > FRAGMENT_MAX_DATA) {
+            maxData = FRAGMENT_MAX_DATA;
+        }
+        const size_t fewest = (length + maxData - 1) / maxData;
+        if (fewest > FRAGMENT_MAX_COUNT) {
+            return false;
+        }
+
+        // Every size from an even split up to maxData, on the fewest fragments
+        // and one more: what rounding to symbol blocks saves can outweigh the
+        // fixed cost of another frame
+        plan.airUs = UINT32_MAX;
+        const size_t most = fewest < FRAGMENT_MAX_COUNT ? fewest + 1 : fewest;
+        for (size_t count = fewest; count <= most && count <= length; count++) {
+            for (size_t size = (length + count - 1) / count; size <= maxData; size++) {
+                const size_t before = (count - 1) * size;
+                if (before >= length) {
+                    break;
+                }
+                const uint32_t airUs = static_cast<uint32_t>(count - 1) * fragmentAirUs(modulation, size) +
+                                       fragmentAirUs(modulation, length - before);
+                if (airUs < plan.airUs) {
+                    plan.count = static_cast<uint8_t>(count);
+                    plan.size = static_cast<uint16_t>(size);
+                    plan.airUs = airUs;
+                }
+                if (count == 1) {
+                    break;
+                }
+            }
+        }
+        return true;
+    }
+
+    FragmentSender::FragmentSender()
+        : buffer_{}
+        , header_{}
+        , plan_{}
+        , next_(0)
+        , active_(false)
+    {
+    }
+
+    bool FragmentSender::begin(uint16_t messageId, uint8_t kind, const uint8_t* data, size_t length,
+                               const FragmentPlan& plan) {
+        if (active_ || data == nullptr || length == 0 || length > FRAGMENT_MAX_MESSAGE || plan.count == 0 ||
+            plan.size == 0 || plan.size > FRAGMENT_MAX_DATA || static_cast<size_t>(plan.count - 1) * plan.size >= length ||
+            lastData(plan, length) > plan.size) {
+            return false;
+        }
+        memcpy(buffer_, data, length);
+        header_.messageId = messageId;
+        header_.kind = kind;
+        header_.index = 0;
+        header_.count = plan.count;
+        header_.totalLength = static_cast<uint16_t>(length);
+        plan_ = plan;
+        next_ = 0;
+        active_ = true;
+        return true;
+    }
+
+    size_t FragmentSender::next(uint8_t* out, size_t outSize) {
+        if (!active_) {
+            return 0;
+        }
+        header_.index = next_;
+        const size_t offset = static_cast<size_t>(next_) * plan_.size;
+        const size_t dataSize = next_ + 1 < plan_.count ? plan_.size : lastData(plan_, header_.totalLength);
+        const size_t written = encodeFragment(header_, buffer_ + offset, dataSize, out, outSize);
+        if (written == 0) {
+            return 0;
+        }
+        if (++next_ == plan_.count) {
+            active_ = false;
+        }
+        return written;
+    }
+
+    FragmentReassembler::FragmentReassembler(uint32_t timeoutMs)
+        : slots_{}
+        , timeoutMs_(timeoutMs)
+        , done_(nullptr)
+        , stats_{}
+    {
+    }
+
+    FragmentResult FragmentReassembler::onFragment(uint16_t source, const uint8_t* payload, size_t payloadSize,
+                                                   uint32_t nowMs) {
+        done_ = nullptr;
+        expire(nowMs);
+
+        FragmentHeader header;
+        const uint8_t* data = nullptr;
+        size_t dataSize = 0;
+        if (!decodeFragment(payload, payloadSize, header, data, dataSize) ||
+            header.totalLength > FRAGMENT_MAX_MESSAGE) {
+            stats_.invalid++;
+            return FragmentResult::INVALID;
+        }
+
+        const size_t stride = fragmentStride(header, dataSize);
+        Slot* slot = find(source, header.messageId);
+        if (slot != nullptr &&
+            (slot->header.count != header.count || slot->header.totalLength != header.totalLength ||
+             slot->header.kind != header.kind || slot->stride != stride)) {
+            // Message id reused for a different message: the old one is stale
+            if (slot->state == SlotState::ASSEMBLING) {
+                stats_.evicted++;
+            }
+            slot->state = SlotState::FREE;
+            slot = nullptr;
+        }
+        if (slot != nullptr && slot->state == SlotState::DONE) {
+            stats_.duplicates++;
+            return FragmentResult::DUPLICATE;
+        }
+        if (slot == nullptr) {
+            slot = allocate();
+            slot->state = SlotState::ASSEMBLING;
+            slot->source = source;
+            slot->header = header;
+            memset(slot->received, 0, sizeof(slot->received));
+            slot->missing = header.count;
+            slot->stride = static_cast<uint16_t>(stride);
+        }
+
+        slot->lastMs = nowMs;
+        const uint8_t bit = static_cast<uint8_t>(1u << (header.index & 7));
+        uint8_t& mask = slot->received[header.index >> 3];
+        if (mask & bit) {
+            stats_.duplicates++;
+            return FragmentResult::DUPLICATE;
+        }
+        mask |= bit;
+        memcpy(slot->buffer + static_cast<size_t>(header.index) * stride, data, dataSize);
+        stats_.fragments++;
+        if (--slot->missing > 0) {
+            return FragmentResult::INCOMPLETE;
+        }
+        slot->state = SlotState::DONE;
+        stats_.completed++;
+        done_ = slot;
+        return FragmentResult::COMPLETE;
+    }
+
+    size_t FragmentReassembler::expire(uint32_t nowMs) {
+        size_t dropped = 0;
+        for (size_t i = 0; i < SLOTS; i++) {
+            Slot& slot = slots_[i];
+            if (slot.state == SlotState::FREE || nowMs - slot.lastMs < timeoutMs_) {
+                continue;
+            }
+            if (slot.state == SlotState::ASSEMBLING) {
+                stats_.timedOut++;
+                dropped++;
+            }
+            if (done_ == &slot) {
+                done_ = nullptr;
+            }
+            slot.state = SlotState::FREE;
+        }
+        return dropped;
+    }
+
+    void FragmentReassembler::clear() {
+        for (size_t i = 0; i < SLOTS; i++) {
+            slots_[i].state = SlotState::FREE;
+        }
+        done_ = nullptr;
+    }
+
+    size_t FragmentReassembler::pending() const {
+        size_t count = 0;
+        for (size_t i = 0; i < SLOTS; i++) {
+            if (slots_[i].state == SlotState::ASSEMBLING) {
+                count++;
+            }
+        }
+        return count;
+    }
+
+    FragmentReassembler::Slot* FragmentReassembler::find(uint16_t source, uint16_t messageId) {
+        for (size_t i = 0; i < SLOTS; i++) {
+            Slot& slot = slots_[i];
+            if (slot.state != SlotState::FREE && slot.source == source && slot.header.messageId == messageId) {
+                return &slot;
+            }
+        }
+        return nullptr;
+    }
+
+    FragmentReassembler::Slot* FragmentReassembler::allocate() {
+        // Free slot, else the oldest finished one, else the oldest incomplete one
+        Slot* oldestDone = nullptr;
+        Slot* oldestBusy = nullptr;
+        for (size_t i = 0; i < SLOTS; i++) {
+            Slot& slot = slots_[i];
+            if (slot.state == SlotState::FREE) {
+                return &slot;
+            }
+            Slot*& oldest = slot.state == SlotState::DONE ? oldestDone : oldestBusy;
+            if (oldest == nullptr || static_cast<int32_t>(slot.lastMs - oldest->lastMs) < 0) {
+                oldest = &slot;
+            }
+        }
+        if (oldestDone != nullptr) {
+            return oldestDone;
+        }
+        stats_.evicted++;
+        return oldestBusy;
+    }
+}
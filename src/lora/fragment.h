@@ -0,0 +1,162 @@
+#pragma once
+
+#include "airtime.h"
+#include "frame_codec.h"
+#include <stdint.h>
+#include <cstddef>
+
+// Messages larger than one LoRa frame, split into FRAGMENT frames
+//
+// A message of up to FRAGMENT_MAX_MESSAGE bytes goes out as count fragments
+// of one size (the last one no longer), each carrying the message id, an
+// application-defined kind, its index, the count and the total length:
+//
+//   [0..2) u16 message id   per sender, wraps
+//   [2]    u8  kind         what the message is (application-defined)
+//   [3]    u8  index        0..count-1
+//   [4]    u8  count
+//   [5..7) u16 total length
+//   [7..)      data         bytes [index * size, ...)
+//
+// The size is not sent: a receiver reads it off any fragment but the last,
+// or works it out from the last as (total - last) / (count - 1).
+//
+// Every frame costs the preamble, LoRa header, frame header and CRC, so
+// goodput is best with few fragments. fragmentDataFor() gives the largest
+// fragment a profile allows: the frame limit, or less where each frame has
+// to stay under an airtime cap (a dwell-time rule). Time on air grows in
+// whole symbol blocks, so planFragments() then picks the count and size
+// with the least airtime on the profile; a full-size split with a runt at
+// the end and an even split each lose on some spreading factors.
+//
+// FragmentReassembler rebuilds messages in a fixed pool of slots, in any
+// fragment order and with duplicates ignored. A message that stops
+// receiving fragments for the timeout is dropped; with every slot busy the
+// least recently active one is given up for a new message. A completed
+// message keeps its slot until the timeout so late duplicates (a sender
+// repeating the message) are not delivered twice.
+namespace LoRaLink {
+
+    constexpr size_t FRAGMENT_HEADER_SIZE = 7;
+    constexpr size_t FRAGMENT_MAX_DATA = MAX_PAYLOAD_SIZE - FRAGMENT_HEADER_SIZE;
+    constexpr size_t FRAGMENT_MAX_MESSAGE = 2048;
+    constexpr size_t FRAGMENT_MAX_COUNT = 255;
+
+    struct FragmentHeader {
+        uint16_t messageId;
+        uint8_t kind;
+        uint8_t index;
+        uint8_t count;
+        uint16_t totalLength;
+    };
+
+    // Returns payload bytes written, 0 if the header is inconsistent or out is too small
+    size_t encodeFragment(const FragmentHeader& header, const uint8_t* data, size_t dataSize,
+                          uint8_t* out, size_t outSize);
+    // data points into payload; false if no fragment size fits the header
+    bool decodeFragment(const uint8_t* payload, size_t payloadSize, FragmentHeader& header,
+                        const uint8_t*& data, size_t& dataSize);
+    // Size of every fragment but the last, from one fragment's data size; 0 if inconsistent
+    size_t fragmentStride(const FragmentHeader& header, size_t dataSize);
+
+    // Largest fragment data whose frame lasts at most maxFrameAirUs on this
+    // modulation (0: no cap); 0 if not even one byte fits
+    size_t fragmentDataFor(const LoRaModulation& modulation, uint32_t maxFrameAirUs = 0);
+
+    struct FragmentPlan {
+        uint8_t count;
+        uint16_t size;              // Every fragment but the last
+        uint32_t airUs;             // Whole message on air, frame overhead included
+    };
+    // Least airtime with fragments of at most maxData bytes; false if the
+    // message is empty, too long, or maxData is 0
+    bool planFragments(size_t length, size_t maxData, const LoRaModulation& modulation, FragmentPlan& plan);
+
+    // Sender: one message at a time, handed out fragment by fragment
+    class FragmentSender {
+    public:
+        FragmentSender();
+
+        // Copies the message; false while one is in progress or if the plan does not fit it
+        bool begin(uint16_t messageId, uint8_t kind, const uint8_t* data, size_t length, const FragmentPlan& plan);
+        // Next fragment payload into out; 0 when every fragment is out
+        size_t next(uint8_t* out, size_t outSize);
+        void cancel() { active_ = false; }
+
+        bool isActive() const { return active_; }
+        const FragmentPlan& plan() const { return plan_; }
+        uint8_t nextIndex() const { return next_; }
+
+    private:
+        uint8_t buffer_[FRAGMENT_MAX_MESSAGE];
+        FragmentHeader header_;
+        FragmentPlan plan_;
+        uint8_t next_;
+        bool active_;
+    };
+
+    enum class FragmentResult : uint8_t {
+        INCOMPLETE,                 // Stored, more to come
+        COMPLETE,                   // message() holds the whole message
+        DUPLICATE,                  // Already had this fragment (or the whole message)
+        INVALID                     // Malformed, or longer than FRAGMENT_MAX_MESSAGE
+    };
+
+    struct ReassemblyStats {
+        uint32_t fragments;         // Accepted and stored
+        uint32_t duplicates;
+        uint32_t invalid;
+        uint32_t completed;
+        uint32_t timedOut;          // Incomplete messages dropped after the timeout
+        uint32_t evicted;           // Incomplete messages given up for a new one
+    };
+
+    class FragmentReassembler {
+    public:
+        static constexpr size_t SLOTS = 4;                  // 8 KB of message buffers
+        static constexpr uint32_t DEFAULT_TIMEOUT_MS = 10000;
+
+        explicit FragmentReassembler(uint32_t timeoutMs = DEFAULT_TIMEOUT_MS);
+
+        FragmentResult onFragment(uint16_t source, const uint8_t* payload, size_t payloadSize, uint32_t nowMs);
+        // Drop messages idle for the timeout; returns incomplete ones dropped
+        size_t expire(uint32_t nowMs);
+        // Inactivity before a message is dropped; follows the radio profile
+        void setTimeoutMs(uint32_t timeoutMs) { timeoutMs_ = timeoutMs; }
+        uint32_t timeoutMs() const { return timeoutMs_; }
+        void clear();
+
+        // The message of the last COMPLETE result, valid until the next call
+        uint16_t messageSource() const { return done_ != nullptr ? done_->source : 0; }
+        uint8_t messageKind() const { return done_ != nullptr ? done_->header.kind : 0; }
+        const uint8_t* message() const { return done_ != nullptr ? done_->buffer : nullptr; }
+        size_t messageLength() const { return done_ != nullptr ? done_->header.totalLength : 0; }
+
+        // Messages being rebuilt
+        size_t pending() const;
+        const ReassemblyStats& getStats() const { return stats_; }
+        void resetStats() { stats_ = {}; }
+
+    private:
+        enum class SlotState : uint8_t { FREE, ASSEMBLING, DONE };
+
+        struct Slot {
+            SlotState state;
+            uint16_t source;
+            FragmentHeader header;
+            uint8_t received[(FRAGMENT_MAX_COUNT + 7) / 8];
+            uint8_t missing;
+            uint16_t stride;
+            uint32_t lastMs;
+            uint8_t buffer[FRAGMENT_MAX_MESSAGE];
+        };
+
+        Slot slots_[SLOTS];
+        uint32_t timeoutMs_;
+        const Slot* done_;
+        ReassemblyStats stats_;
+
+        Slot* find(uint16_t source, uint16_t messageId);
+        Slot* allocate();
+    };
+}
@@ -0,0 +1,134 @@
+#include "frame_codec.h"
+#include <cstring>
+#include <cmath>
+
+namespace LoRaLink {
+
+    uint16_t crc16(const uint8_t* data, size_t length, uint16_t crc) {
+        for (size_t i = 0; i < length; ++i) {
+            crc ^= static_cast<uint16_t>(data[i]) << 8;
+            for (int bit = 0; bit < 8; ++bit) {
+                crc = (crc & 0x8000) ? static_cast<uint16_t>((crc << 1) ^ 0x1021)
+                                     : static_cast<uint16_t>(crc << 1);
+            }
+        }
+        return crc;
+    }
+
+    size_t encodeFrame(FrameType type, uint16_t nodeId, uint16_t sequence,
+                       const uint8_t* payload, size_t payloadSize,
+                       uint8_t* out, size_t outSize) {
+        if (out == nullptr || payloadSize > MAX_PAYLOAD_SIZE) {
+            return 0;
+        }
+        if (payloadSize > 0 && payload == nullptr) {
+            return 0;
+        }
+
+        const size_t total = FRAME_OVERHEAD + payloadSize;
+        if (outSize < total) {
+            return 0;
+        }
+
+        out[0] = WIRE_VERSION;
+        out[1] = static_cast<uint8_t>(type);
+        Wire::putU16(out + 2, nodeId);
+        Wire::putU16(out + 4, sequence);
+        if (payloadSize > 0) {
+            memcpy(out + HEADER_SIZE, payload, payloadSize);
+        }
+
+        const uint16_t crc = crc16(out, HEADER_SIZE + payloadSize);
+        Wire::putU16(out + HEADER_SIZE + payloadSize, crc);
+        return total;
+    }
+
+    DecodeResult decodeFrame(const uint8_t* data, size_t length, FrameView& frame) {
+        if (data == nullptr || length < FRAME_OVERHEAD) {
+            return DecodeResult::TOO_SHORT;
+        }
+        if (data[0] != WIRE_VERSION) {
+            return DecodeResult::BAD_VERSION;
+        }
+
+        const size_t crcOffset = length - CRC_SIZE;
+        if (crc16(data, crcOffset) != Wire::getU16(data + crcOffset)) {
+            return DecodeResult::BAD_CRC;
+        }
+
+        frame.header.version = data[0];
+        frame.header.type = static_cast<FrameType>(data[1]);
+        frame.header.nodeId = Wire::getU16(data + 2);
+        frame.header.sequence = Wire::getU16(data + 4);
+        frame.payload = data + HEADER_SIZE;
+        frame.payloadSize = crcOffset - HEADER_SIZE;
+        return DecodeResult::OK;
+    }
+
+    size_t encodeConfig(const ConfigPayload& config, uint8_t* out, size_t outSize) {
+        if (out == nullptr || outSize < CONFIG_PAYLOAD_SIZE) {
+            return 0;
+        }
+
+        const uint32_t freqKHz = static_cast<uint32_t>(lroundf(config.freqMHz * 1000.0f));
+        const uint16_t bw100Hz = static_cast<uint16_t>(lroundf(config.bwKHz * 10.0f));
+
+        Wire::putU32(out, freqKHz);
+        Wire::putU16(out + 4, bw100Hz);
+        out[6] = static_cast<uint8_t>((config.sf << 4) | (config.cr & 0x0F));
+        out[7] = static_cast<uint8_t>(config.txPower);
+        return CONFIG_PAYLOAD_SIZE;
+    }
+
+    bool decodeConfig(const uint8_t* payload, size_t payloadSize, ConfigPayload& config) {
+        if (payload == nullptr || payloadSize != CONFIG_PAYLOAD_SIZE) {
+            return false;
+        }
+
+        config.freqMHz = static_cast<float>(Wire::getU32(payload)) / 1000.0f;
+        config.bwKHz = static_cast<float>(Wire::getU16(payload + 4)) / 10.0f;
+        config.sf = payload[6] >> 4;
+        config.cr = payload[6] & 0x0F;
+        config.txPower = static_cast<int8_t>(payload[7]);
+        return true;
+    }
+
+    const char* frameTypeToString(FrameType type) {
+        switch (type) {
+            case FrameType::PING: return "PING";
+            case FrameType::CONFIG: return "CFG";
+            case FrameType::ADR_REQUEST: return "ADR_REQUEST";
+            case FrameType::CONFIG_PREPARE: return "CONFIG_PREPARE";
+            case FrameType::CONFIG_ACK: return "CONFIG_ACK";
+            case FrameType::CONFIG_COMMIT: return "CONFIG_COMMIT";
+            case FrameType::TDMA_BEACON: return "TDMA_BEACON";
+            case FrameType::TDMA_JOIN: return "TDMA_JOIN";
+            case FrameType::FW_UPDATE_AVAILABLE: return "FW_UPDATE_AVAILABLE";
+            case FrameType::FW_VERSION: return "FW_VERSION";
+            case FrameType::UPDATE_NOW: return "UPDATE_NOW";
+            case FrameType::REQUEST_UPDATE: return "REQUEST_UPDATE";
+            case FrameType::UPDATE_ACK: return "UPDATE_ACK";
+            case FrameType::NO_FIRMWARE: return "NO_FIRMWARE";
+            case FrameType::OTA_START: return "OTA_START";
+            case FrameType::OTA_DATA: return "OTA_DATA";
+            case FrameType::OTA_END: return "OTA_END";
+            case FrameType::OTA_NACK: return "OTA_NACK";
+            case FrameType::OTA_CODED_START: return "OTA_CODED_START";
+            case FrameType::OTA_CODED: return "OTA_CODED";
+            case FrameType::OTA_BLOCK_POLL: return "OTA_BLOCK_POLL";
+            case FrameType::OTA_BLOCK_NEED: return "OTA_BLOCK_NEED";
+            case FrameType::FRAGMENT: return "FRAGMENT";
+            default: return "UNKNOWN";
+        }
+    }
+
+    const char* decodeResultToString(DecodeResult result) {
+        switch (result) {
+            case DecodeResult::OK: return "OK";
+            case DecodeResult::TOO_SHORT: return "TOO_SHORT";
+            case DecodeResult::BAD_VERSION: return "BAD_VERSION";
+            case DecodeResult::BAD_CRC: return "BAD_CRC";
+            default: return "UNKNOWN";
+        }
+    }
+}
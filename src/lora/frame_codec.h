@@ -0,0 +1,128 @@
+#pragma once
+
+#include <stdint.h>
+#include <cstddef>
+
+// Compact binary wire format shared by the sender and receiver roles
+//
+// Frame layout (little-endian):
+//   [0]     version     WIRE_VERSION
+//   [1]     type        FrameType
+//   [2..3]  node id     source node
+//   [4..5]  sequence    per-node sequence number (repeats of one message reuse it)
+//   [6..n]  payload     type-specific packed fields
+//   [n..+2] crc16       CRC-16/CCITT-FALSE over everything before it
+namespace LoRaLink {
+
+    constexpr uint8_t WIRE_VERSION = 1;
+    constexpr size_t MAX_FRAME_SIZE = 255;      // SX1262 FIFO limit
+    constexpr size_t HEADER_SIZE = 6;
+    constexpr size_t CRC_SIZE = 2;
+    constexpr size_t FRAME_OVERHEAD = HEADER_SIZE + CRC_SIZE;
+    constexpr size_t MAX_PAYLOAD_SIZE = MAX_FRAME_SIZE - FRAME_OVERHEAD;
+    constexpr uint16_t BROADCAST_NODE = 0xFFFF;
+
+    // Frame types (one byte on the wire)
+    enum class FrameType : uint8_t {
+        PING                = 0x01,     // Heartbeat, sequence in header
+        CONFIG              = 0x02,     // Radio parameters (ConfigPayload)
+        ADR_REQUEST         = 0x03,     // Receiver asks senders to switch (ConfigPayload)
+        CONFIG_PREPARE      = 0x04,     // Proposed profile for a config epoch (config_commit.h)
+        CONFIG_ACK          = 0x05,     // u16 epoch, u16 coordinator
+        CONFIG_COMMIT       = 0x06,     // u16 epoch, u8 commit/abort, u32 switch in ms
+        TDMA_BEACON         = 0x07,     // Superframe timing and slot grants (tdma.h)
+        TDMA_JOIN           = 0x08,     // Sender asks for a slot
+
+        FW_UPDATE_AVAILABLE = 0x10,     // Receiver has firmware to distribute
+        FW_VERSION          = 0x11,     // u32 firmware version
+        UPDATE_NOW          = 0x12,     // Receiver asks senders to update
+        REQUEST_UPDATE      = 0x13,     // Sender asks for the firmware image
+        UPDATE_ACK          = 0x14,     // Receiver acknowledges REQUEST_UPDATE
+        NO_FIRMWARE         = 0x15,     // Receiver has nothing to send
+
+        OTA_START           = 0x20,     // u32 image size, u32 timeout ms, u16 chunk size, SHA-256
+        OTA_DATA            = 0x21,     // u16 chunk index, chunk bytes
+        OTA_END             = 0x22,     // End of a send round; asks for OTA_NACK
+        OTA_NACK            = 0x23,     // u16 base, u16 missing, u8 status, missing-chunk bitmap
+        OTA_CODED_START     = 0x24,     // OTA_START payload; coded broadcast, never answered
+        OTA_CODED           = 0x25,     // u16 block, u32 coefficient mask, coded chunk
+        OTA_BLOCK_POLL      = 0x26,     // u16 block (0xFFFF: any block)
+        OTA_BLOCK_NEED      = 0x27,     // u16 block, u8 packets still needed
+
+        FRAGMENT            = 0x30      // One piece of a multi-frame message (fragment.h)
+    };
+
+    // Decode results
+    enum class DecodeResult {
+        OK = 0,
+        TOO_SHORT,
+        BAD_VERSION,
+        BAD_CRC
+    };
+
+    struct FrameHeader {
+        uint8_t version;
+        FrameType type;
+        uint16_t nodeId;
+        uint16_t sequence;
+    };
+
+    // Decoded frame; payload points into the caller's receive buffer
+    struct FrameView {
+        FrameHeader header;
+        const uint8_t* payload;
+        size_t payloadSize;
+    };
+
+    // Radio parameters carried by CONFIG frames
+    struct ConfigPayload {
+        float freqMHz;
+        float bwKHz;
+        uint8_t sf;
+        uint8_t cr;
+        int8_t txPower;
+    };
+
+    // CONFIG payload: u32 freq kHz, u16 bw in 100 Hz units, (sf << 4 | cr), i8 tx dBm
+    constexpr size_t CONFIG_PAYLOAD_SIZE = 8;
+
+    // Frame encode/decode
+    size_t encodeFrame(FrameType type, uint16_t nodeId, uint16_t sequence,
+                       const uint8_t* payload, size_t payloadSize,
+                       uint8_t* out, size_t outSize);
+    DecodeResult decodeFrame(const uint8_t* data, size_t length, FrameView& frame);
+
+    // Typed payload helpers
+    size_t encodeConfig(const ConfigPayload& config, uint8_t* out, size_t outSize);
+    bool decodeConfig(const uint8_t* payload, size_t payloadSize, ConfigPayload& config);
+
+    // CRC-16/CCITT-FALSE (poly 0x1021, init 0xFFFF)
+    uint16_t crc16(const uint8_t* data, size_t length, uint16_t crc = 0xFFFF);
+
+    const char* frameTypeToString(FrameType type);
+    const char* decodeResultToString(DecodeResult result);
+
+    // Little-endian field helpers shared by payload codecs
+    namespace Wire {
+        inline void putU16(uint8_t* p, uint16_t v) {
+            p[0] = static_cast<uint8_t>(v);
+            p[1] = static_cast<uint8_t>(v >> 8);
+        }
+
+        inline void putU32(uint8_t* p, uint32_t v) {
+            p[0] = static_cast<uint8_t>(v);
+            p[1] = static_cast<uint8_t>(v >> 8);
+            p[2] = static_cast<uint8_t>(v >> 16);
+            p[3] = static_cast<uint8_t>(v >> 24);
+        }
+
+        inline uint16_t getU16(const uint8_t* p) {
+            return static_cast<uint16_t>(p[0] | (p[1] << 8));
+        }
+
+        inline uint32_t getU32(const uint8_t* p) {
+            return static_cast<uint32_t>(p[0]) | (static_cast<uint32_t>(p[1]) << 8) |
+                   (static_cast<uint32_t>(p[2]) << 16) | (static_cast<uint32_t>(p[3]) << 24);
+        }
+    }
+}
@@ -0,0 +1,59 @@
+#include "frame_dispatcher.h"
+
+namespace LoRaLink {
+
+    FrameDispatcher::FrameDispatcher()
+        : table_{}
+        , fallback_{}
+        , stats_{}
+    {
+    }
+
+    void FrameDispatcher::on(FrameType type, Handler handler, void* context) {
+        Entry& entry = table_[static_cast<uint8_t>(type)];
+        entry.handler = handler;
+        entry.context = context;
+    }
+
+    void FrameDispatcher::off(FrameType type) {
+        table_[static_cast<uint8_t>(type)] = {};
+    }
+
+    void FrameDispatcher::setFallback(Handler handler, void* context) {
+        fallback_.handler = handler;
+        fallback_.context = context;
+    }
+
+    void FrameDispatcher::clear() {
+        for (size_t i = 0; i < TABLE_SIZE; ++i) {
+            table_[i] = {};
+        }
+        fallback_ = {};
+    }
+
+    size_t FrameDispatcher::registeredCount() const {
+        size_t count = 0;
+        for (size_t i = 0; i < TABLE_SIZE; ++i) {
+            if (table_[i].handler != nullptr) {
+                count++;
+            }
+        }
+        return count;
+    }
+
+    bool FrameDispatcher::dispatch(const FrameView& frame, const RxFrame& rx) {
+        const Entry& entry = table_[static_cast<uint8_t>(frame.header.type)];
+        if (entry.handler != nullptr) {
+            stats_.dispatched++;
+            entry.handler(frame, rx, entry.context);
+            return true;
+        }
+        if (fallback_.handler != nullptr) {
+            stats_.fallback++;
+            fallback_.handler(frame, rx, fallback_.context);
+            return true;
+        }
+        stats_.unhandled++;
+        return false;
+    }
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include "frame_codec.h"
+#include "frame_pool.h"
+#include <stdint.h>
+#include <cstddef>
+
+// Table-driven frame dispatch
+//
+// Handlers are registered against the frame-type byte; dispatch() is a single
+// indexed load into a 256-entry table, so adding message types does not add
+// work per frame. Role-specific handlers are registered at startup (and again
+// when the role changes) instead of being checked inside each handler.
+namespace LoRaLink {
+
+    struct DispatchStats {
+        uint32_t dispatched;    // Frames delivered to a registered handler
+        uint32_t fallback;      // Frames delivered to the fallback handler
+        uint32_t unhandled;     // Frames with no handler at all
+    };
+
+    class FrameDispatcher {
+    public:
+        // frame is the decoded view into rx.data; context is the registration cookie
+        typedef void (*Handler)(const FrameView& frame, const RxFrame& rx, void* context);
+
+        static constexpr size_t TABLE_SIZE = 256;
+
+        FrameDispatcher();
+
+        // Register (or replace) the handler for a frame type
+        void on(FrameType type, Handler handler, void* context = nullptr);
+        void off(FrameType type);
+        // Called for types without a handler (e.g. logging); optional
+        void setFallback(Handler handler, void* context = nullptr);
+        // Drop every registration (used before re-registering for a new role)
+        void clear();
+
+        bool has(FrameType type) const { return table_[static_cast<uint8_t>(type)].handler != nullptr; }
+        size_t registeredCount() const;
+
+        // Route an already decoded frame; false if nothing handled it
+        bool dispatch(const FrameView& frame, const RxFrame& rx);
+
+        const DispatchStats& getStats() const { return stats_; }
+        void resetStats() { stats_ = {}; }
+
+    private:
+        struct Entry {
+            Handler handler;
+            void* context;
+        };
+
+        Entry table_[TABLE_SIZE];
+        Entry fallback_;
+        DispatchStats stats_;
+    };
+}
@@ -0,0 +1,55 @@
+#include "frame_pool.h"
+
+namespace LoRaLink {
+
+    FramePool::FramePool()
+        : checkedOut_{}
+        , freeCount_(CAPACITY)
+        , stats_{}
+    {
+        for (size_t i = 0; i < CAPACITY; ++i) {
+            free_[i] = &frames_[CAPACITY - 1 - i];
+        }
+    }
+
+    RxFrame* FramePool::acquire() {
+        if (freeCount_ == 0) {
+            stats_.exhausted++;
+            return nullptr;
+        }
+
+        RxFrame* frame = free_[--freeCount_];
+        checkedOut_[frame - frames_] = true;
+        frame->length = 0;
+        stats_.acquired++;
+        if (inUse() > stats_.highWater) {
+            stats_.highWater = inUse();
+        }
+        return frame;
+    }
+
+    void FramePool::release(RxFrame* frame) {
+        if (!owns(frame)) {
+            return;
+        }
+        // A second release would put the buffer on the free list twice and
+        // hand it to two acquire() calls
+        bool& checkedOut = checkedOut_[frame - frames_];
+        if (!checkedOut) {
+            stats_.doubleReleases++;
+            return;
+        }
+        checkedOut = false;
+        free_[freeCount_++] = frame;
+        stats_.released++;
+    }
+
+    bool FramePool::owns(const RxFrame* frame) const {
+        return frame >= frames_ && frame < frames_ + CAPACITY;
+    }
+
+    void FramePool::resetStats() {
+        stats_ = {};
+        stats_.highWater = inUse();
+    }
+}
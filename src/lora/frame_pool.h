@@ -0,0 +1,58 @@
+#pragma once
+
+#include "frame_codec.h"
+#include <stdint.h>
+#include <cstddef>
+
+// Fixed pool of receive buffers
+//
+// All frame storage on the receive path is reserved statically: the radio
+// reads straight into a pooled RxFrame, the frame is queued and handed to
+// handlers by reference, and the buffer returns to the pool on release().
+// Nothing on this path touches the heap.
+namespace LoRaLink {
+
+    struct RxFrame {
+        uint8_t data[MAX_FRAME_SIZE];
+        size_t length;
+        uint32_t timestampUs;   // DIO1 edge time
+        float rssi;
+        float snr;
+    };
+
+    struct FramePoolStats {
+        uint32_t acquired;
+        uint32_t released;
+        uint32_t exhausted;     // acquire() calls that found no free buffer
+        uint32_t doubleReleases; // release() of a buffer already in the pool, ignored
+        size_t highWater;       // Maximum buffers in use at once
+    };
+
+    class FramePool {
+    public:
+        // Receive queue depth plus buffers held by handlers or blocking receives
+        static constexpr size_t CAPACITY = 10;
+
+        FramePool();
+
+        // Borrow a buffer; nullptr when the pool is exhausted
+        RxFrame* acquire();
+        // Return a buffer obtained from acquire(); foreign pointers and
+        // buffers already returned are ignored
+        void release(RxFrame* frame);
+
+        bool owns(const RxFrame* frame) const;
+        size_t available() const { return freeCount_; }
+        size_t inUse() const { return CAPACITY - freeCount_; }
+
+        const FramePoolStats& getStats() const { return stats_; }
+        void resetStats();
+
+    private:
+        RxFrame frames_[CAPACITY];
+        RxFrame* free_[CAPACITY];
+        bool checkedOut_[CAPACITY];
+        size_t freeCount_;
+        FramePoolStats stats_;
+    };
+}
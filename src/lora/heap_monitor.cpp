@@ -0,0 +1,48 @@
+#include "heap_monitor.h"
+#include "../hardware/hardware_abstraction.h"
+
+namespace LoRaLink {
+
+    HeapMonitor::HeapMonitor()
+        : last_{}
+        , stats_{}
+    {
+    }
+
+    HeapSnapshot HeapMonitor::sample() {
+        using namespace HardwareAbstraction;
+        return record(Memory::getFreeHeap(), Memory::getMinFreeHeap(), Memory::getMaxAllocHeap());
+    }
+
+    HeapSnapshot HeapMonitor::record(size_t freeHeap, size_t minFreeHeap, size_t maxAllocHeap) {
+        HeapSnapshot snap;
+        snap.freeHeap = freeHeap;
+        snap.minFreeHeap = minFreeHeap;
+        snap.maxAllocHeap = maxAllocHeap;
+        snap.fragmentationPct = 0;
+        if (freeHeap > 0 && maxAllocHeap < freeHeap) {
+            snap.fragmentationPct = static_cast<uint8_t>(100 - (maxAllocHeap * 100) / freeHeap);
+        }
+
+        if (stats_.samples == 0) {
+            stats_.baselineMaxAlloc = maxAllocHeap;
+            stats_.lowestMaxAlloc = maxAllocHeap;
+        } else if (maxAllocHeap < last_.maxAllocHeap) {
+            stats_.largestBlockDrops++;
+        }
+        if (maxAllocHeap < stats_.lowestMaxAlloc) {
+            stats_.lowestMaxAlloc = maxAllocHeap;
+        }
+        if (snap.fragmentationPct > stats_.worstFragmentationPct) {
+            stats_.worstFragmentationPct = snap.fragmentationPct;
+        }
+        stats_.samples++;
+        last_ = snap;
+        return snap;
+    }
+
+    void HeapMonitor::reset() {
+        last_ = {};
+        stats_ = {};
+    }
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <stdint.h>
+#include <cstddef>
+
+// Heap fragmentation counters for the link hot path
+//
+// Samples HardwareAbstraction::Memory (free heap, low-water mark and largest
+// allocatable block). Fragmentation is the share of free heap that is not
+// available as one contiguous block; a hot path that does not allocate keeps
+// the largest block steady across samples.
+namespace LoRaLink {
+
+    struct HeapSnapshot {
+        size_t freeHeap;
+        size_t minFreeHeap;
+        size_t maxAllocHeap;        // Largest contiguous free block
+        uint8_t fragmentationPct;
+    };
+
+    struct HeapStats {
+        uint32_t samples;
+        uint32_t largestBlockDrops; // Samples where the largest block shrank
+        size_t baselineMaxAlloc;    // Largest block at the first sample
+        size_t lowestMaxAlloc;
+        uint8_t worstFragmentationPct;
+    };
+
+    class HeapMonitor {
+    public:
+        HeapMonitor();
+
+        // Read HardwareAbstraction::Memory and record the result
+        HeapSnapshot sample();
+        // Record externally measured values (used by sample() and tests)
+        HeapSnapshot record(size_t freeHeap, size_t minFreeHeap, size_t maxAllocHeap);
+
+        const HeapSnapshot& last() const { return last_; }
+        const HeapStats& getStats() const { return stats_; }
+        void reset();
+
+    private:
+        HeapSnapshot last_;
+        HeapStats stats_;
+    };
+}
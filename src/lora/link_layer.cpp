@@ -0,0 +1,935 @@
+#include "link_layer.h"
+#include "ota_arq.h"
+#include "rx_power.h"
+#include <cstring>
+
+namespace LoRaLink {
+
+    namespace {
+        // A message is given up after this many fragment gaps without one
+        constexpr uint32_t REASSEMBLY_TIMEOUT_FRAMES = 4;
+        // Fragments leave this much of the TX queue to control frames
+        constexpr size_t FRAGMENT_QUEUE_RESERVE = TxScheduler::CAPACITY / 2;
+
+        // Frames only receivers send; their sources make up the config roster
+        bool fromReceiverRole(FrameType type) {
+            switch (type) {
+                case FrameType::PING:
+                case FrameType::CONFIG:
+                case FrameType::CONFIG_PREPARE:
+                case FrameType::CONFIG_COMMIT:
+                case FrameType::REQUEST_UPDATE:
+                case FrameType::OTA_NACK:
+                case FrameType::OTA_BLOCK_NEED:
+                case FrameType::TDMA_JOIN:
+                case FrameType::FRAGMENT:       // Either role
+                    return false;
+                default:
+                    return true;
+            }
+        }
+    }
+
+    LinkLayerConfig LinkLayerConfig::defaultConfig() {
+        LinkLayerConfig config;
+        config.nodeId = 0;
+        config.sender = true;
+        config.preamble = DEFAULT_PREAMBLE;
+        config.dutyCyclePermille = 1000;
+        config.listenBeforeTalk = false;
+        config.rxDutyCycle = false;
+        config.adr = false;
+        config.adrConfig = AdrEngine::defaultConfig();
+        config.pings = true;
+        config.pingSharePermille = 62;      // 2 s at SF9/125 kHz
+        config.pingMinIntervalMs = 500;
+        config.tdmaListenMs = 60000;        // Longer than the largest superframe
+        config.adrEvalMs = 10000;
+        config.configAckTurnaroundMs = 20;
+        config.otaNackIdleMs = 5000;
+        config.otaNeedBackoffMs = 1500;
+        config.updateRetryMs = 3000;
+        config.updateAttempts = 8;
+        config.fragmentMaxAirMs = 0;
+        config.reassemblyMinMs = 5000;
+        return config;
+    }
+
+    LinkLayer::LinkLayer(IRadioDriver& radio, IRadioConfig& radioConfig, StagedUpdateBackend& update,
+                         const LinkLayerConfig& config, Clock clockUs, Clock clockMs)
+        : update_(update)
+        , config_(config)
+        , clockUs_(clockUs)
+        , clockMs_(clockMs)
+        , listener_(nullptr)
+        , tdmaCoord_(nullptr)
+        , tdmaNode_(nullptr)
+        , cadWake_(nullptr)
+        , capture_(nullptr)
+        , rx_(radio, pool_)
+        , tx_(radio)
+        , airtime_({ config.dutyCyclePermille, 3600000 })
+        , radioProfile_(radioConfig, clockUs)
+        , adr_(config.adrConfig)
+        , linkSlots_{}
+        , links_(linkSlots_, LINK_TABLE_SLOTS)
+        , ota_(update)
+        , fec_(ota_, update)
+        , profile_{}
+        , pingSeq_(0)
+        , frameSeq_(0)
+        , lastPingMs_(0)
+        , tdmaListenFromMs_(0)
+        , lastAdrMs_(0)
+        , lastReadErrors_(0)
+        , switchPending_(false)
+        , switchProfile_{}
+        , switchSource_(ProfileSource::APPLICATION)
+        , transferActive_(false)
+        , lastRssi_(-999.0f)
+        , lastSnr_(-999.0f)
+        , lastFrameMs_(0)
+        , otaBroadcast_(false)
+        , otaLastPercent_(0)
+        , otaLastNackMs_(0)
+        , needBlock_(0)
+        , needDueMs_(0)
+        , needPending_(false)
+        , requestsLeft_(0)
+        , requestSeq_(0)
+        , requestDueMs_(0)
+        , messageId_(0)
+        , fragmentData_(FRAGMENT_MAX_DATA)
+        , rng_(1)
+        , stats_{}
+    {
+        coordinator_.setNodeId(config.nodeId);
+        participant_.setNodeId(config.nodeId);
+        tx_.attachReceiver(&rx_);
+        tx_.attachBudget(&airtime_);
+        if (config.listenBeforeTalk) {
+            tx_.attachListenBeforeTalk(&lbt_);
+        }
+        tx_.setCompletionCallback([this](const TxResult& result) { onTxDone(result); });
+    }
+
+    void LinkLayer::attachTdma(TdmaCoordinator* coordinator, TdmaNode* node) {
+        tdmaCoord_ = coordinator;
+        tdmaNode_ = node;
+        if (tdmaNode_ != nullptr) {
+            tdmaNode_->setNodeId(config_.nodeId);
+        }
+    }
+
+    void LinkLayer::setIdentity(uint16_t nodeId, bool sender) {
+        config_.nodeId = nodeId;
+        config_.sender = sender;
+        coordinator_.setNodeId(nodeId);
+        participant_.setNodeId(nodeId);
+        if (tdmaNode_ != nullptr) {
+            tdmaNode_->setNodeId(nodeId);
+        }
+    }
+
+    void LinkLayer::seed(uint32_t seed) {
+        lbt_.seed(seed);
+        rng_.seed(seed * 2654435761u + 1);
+    }
+
+    void LinkLayer::begin(const ConfigPayload& profile) {
+        tdmaListenFromMs_ = clockMs_();
+        radioProfile_.assume(profile);
+        setProfile(profile);
+        registerHandlers();
+    }
+
+    bool LinkLayer::listen() {
+        rx_.begin();
+        if (cadWake_ == nullptr) {
+            return true;
+        }
+        if (config_.sender) {
+            cadWake_->end();
+            return true;
+        }
+        return cadWake_->begin(clockUs_());
+    }
+
+    void LinkLayer::setRole(bool sender) {
+        coordinator_.cancel();
+        links_.clear();
+        switchPending_ = false;
+        if (tdmaCoord_ != nullptr) {
+            tdmaCoord_->reset();
+        }
+        if (tdmaNode_ != nullptr) {
+            *tdmaNode_ = TdmaNode();
+            tdmaNode_->setNodeId(config_.nodeId);
+        }
+        tdmaListenFromMs_ = clockMs_();
+        config_.sender = sender;
+        pingSeq_ = 0;
+        requestsLeft_ = 0;
+        fragments_.cancel();
+        reassembler_.clear();
+        syncModulation();       // RX duty cycle and TDMA timing follow the role
+        registerHandlers();
+        listen();
+    }
+
+    void LinkLayer::setProfile(const ConfigPayload& profile) {
+        profile_ = profile;
+        syncModulation();
+    }
+
+    void LinkLayer::syncModulation() {
+        const LoRaModulation modulation = modulationFor(profile_.sf, profile_.bwKHz, profile_.cr, config_.preamble);
+        airtime_.setModulation(modulation);
+        lbt_.setModulation(modulation);
+        if (cadWake_ != nullptr) {
+            cadWake_->setModulation(modulation);
+        }
+        if (config_.rxDutyCycle) {
+            // Windows follow the profile; senders stay in continuous RX
+            const RxDutyCycle cycle = config_.sender ? RxDutyCycle{ 0, 0 } : rxDutyCycleFor(modulation);
+            rx_.setDutyCycle(cycle.rxUs, cycle.sleepUs);
+        }
+        if (tdmaCoord_ != nullptr) {
+            tdmaCoord_->setModulation(modulation);
+        }
+        if (tdmaNode_ != nullptr) {
+            tdmaNode_->setModulation(modulation);
+        }
+
+        // Largest fragment the profile allows; a message waits for its next
+        // fragment as long as the duty cycle spaces them, and then some
+        fragmentData_ = fragmentDataFor(modulation, config_.fragmentMaxAirMs * 1000);
+        const size_t fragmentFrame = FRAME_OVERHEAD + FRAGMENT_HEADER_SIZE + (fragmentData_ > 0 ? fragmentData_ : 1);
+        const uint32_t permille = config_.dutyCyclePermille > 0 ? config_.dutyCyclePermille : 1000;
+        const uint64_t gapUs = static_cast<uint64_t>(timeOnAirUs(modulation, fragmentFrame)) * 1000 / permille;
+        const uint64_t timeoutMs = gapUs * REASSEMBLY_TIMEOUT_FRAMES / 1000;
+        reassembler_.setTimeoutMs(timeoutMs > config_.reassemblyMinMs ? static_cast<uint32_t>(timeoutMs)
+                                                                       : config_.reassemblyMinMs);
+    }
+
+    int LinkLayer::applyProfile(const ConfigPayload& profile) {
+        const bool resume = rx_.isActive();
+        if (resume) {
+            rx_.suspend();
+        }
+        const int status = radioProfile_.apply(profile);
+        profile_ = profile;
+        adr_.reset();           // History was measured on the old profile
+        stats_.profileChanges++;
+        if (status == RadioStatus::OK) {
+            syncModulation();
+        }
+        if (resume) {
+            rx_.resume();
+        }
+        return status;
+    }
+
+    // Frames on air finish on the old profile; the switch waits for the queue
+    void LinkLayer::switchTo(const ConfigPayload& profile, ProfileSource source) {
+        switchProfile_ = profile;
+        switchSource_ = source;
+        switchPending_ = true;
+        if (!tx_.isBusy()) {
+            finishSwitch();
+        }
+    }
+
+    void LinkLayer::finishSwitch() {
+        switchPending_ = false;
+        const int status = applyProfile(switchProfile_);
+        if (switchSource_ == ProfileSource::COMMIT) {
+            lastPingMs_ = clockMs_();   // PINGs restart on the new profile
+        }
+        if (listener_ != nullptr) {
+            listener_->onProfileChanged(switchProfile_, switchSource_, status);
+        }
+    }
+
+    uint32_t LinkLayer::frameAirMs(size_t payloadSize) const {
+        return (airtime_.airtimeUs(FRAME_OVERHEAD + payloadSize) + 999) / 1000;
+    }
+
+    bool LinkLayer::queueFrame(FrameType type, uint16_t sequence, Priority priority,
+                               const uint8_t* payload, size_t payloadSize) {
+        uint8_t frame[MAX_FRAME_SIZE];
+        const size_t len = encodeFrame(type, config_.nodeId, sequence, payload, payloadSize, frame, sizeof(frame));
+        if (len == 0) {
+            return false;
+        }
+        return tx_.enqueue(frame, len, priority, clockUs_());
+    }
+
+    bool LinkLayer::queueOwn(FrameType type, uint16_t sequence, Priority priority,
+                             const uint8_t* payload, size_t payloadSize) {
+        if (queueFrame(type, sequence, priority, payload, payloadSize)) {
+            return true;
+        }
+        stats_.queueFull++;
+        if (listener_ != nullptr) {
+            listener_->onQueueFull(type, sequence);
+        }
+        return false;
+    }
+
+    bool LinkLayer::sendMessage(uint8_t kind, const uint8_t* data, size_t length) {
+        // fragmentData_ is 0 when not even a one-byte fragment fits the airtime cap
+        FragmentPlan plan;
+        if (fragments_.isActive() || !planFragments(length, fragmentData_, airtime_.modulation(), plan) ||
+            !fragments_.begin(messageId_, kind, data, length, plan)) {
+            return false;
+        }
+        messageId_++;
+        return true;
+    }
+
+    bool LinkLayer::startConfigChange(const ConfigPayload& next) {
+        const uint32_t nowMs = clockMs_();
+        size_t listed = coordinator_.rosterSize(nowMs);
+        if (listed > CONFIG_COMMIT_MAX_ACKED) {
+            listed = CONFIG_COMMIT_MAX_ACKED;
+        }
+        // Rounds are timed on the profile they are sent with
+        ConfigCommitTiming timing;
+        timing.prepareAirMs = frameAirMs(CONFIG_PREPARE_HEADER_SIZE + 2 * listed);
+        timing.commitAirMs = frameAirMs(CONFIG_COMMIT_SIZE);
+        timing.ackSlotMs = frameAirMs(CONFIG_ACK_SIZE) + config_.configAckTurnaroundMs;
+        if (!coordinator_.begin(next, timing, nowMs)) {
+            return false;
+        }
+        if (listener_ != nullptr) {
+            listener_->onConfigStarted(next, coordinator_.epoch());
+        }
+        return true;
+    }
+
+    void LinkLayer::onTxDone(const TxResult& result) {
+        if (tdmaCoord_ != nullptr && result.type == FrameType::TDMA_BEACON && result.status == RadioStatus::OK) {
+            tdmaCoord_->onBeaconSent(result.doneUs);    // Slots count from the TxDone edge
+        }
+        if (listener_ != nullptr) {
+            listener_->onTxComplete(result);
+        }
+    }
+
+    void LinkLayer::poll() {
+        const uint32_t nowMs = clockMs_();
+
+        // Finish the frame on air (TxDone latched by the ISR) and start the next one
+        tx_.poll(clockUs_());
+        if (switchPending_ && !tx_.isBusy()) {
+            finishSwitch();
+        }
+        if (config_.sender) {
+            pollSender(nowMs);
+        }
+
+        // Handlers get the pool buffer the radio was read into; no copies, no heap
+        rx_.poll();
+        RxFrame* frame;
+        while ((frame = rx_.pop()) != nullptr) {
+            if (capture_ != nullptr) {
+                capture_->record(*frame, profile_);
+            }
+            handleFrame(*frame);
+            rx_.release(frame);
+        }
+        if (!config_.sender) {
+            pollParticipant(nowMs);
+            pollTdmaCoordinator();
+        }
+
+        const RxStats& rxStats = rx_.getStats();
+        if (rxStats.readErrors != lastReadErrors_) {
+            stats_.readErrors += rxStats.readErrors - lastReadErrors_;
+            lastReadErrors_ = rxStats.readErrors;
+            if (!config_.sender && tdmaCoord_ != nullptr) {
+                tdmaCoord_->onCorruptFrame(clockUs_());     // In the join window: joins collided
+            }
+            if (listener_ != nullptr) {
+                listener_->onReadError();
+            }
+        }
+
+        // The transmit path owns the radio while it has frames
+        if (cadWake_ != nullptr && !config_.sender && !tx_.isBusy()) {
+            cadWake_->poll(clockUs_());
+        }
+        pollOta(nowMs);
+        if (config_.sender) {
+            pollUpdateRequest(nowMs);
+        }
+        pollFragments(nowMs);
+        if (!config_.sender && config_.adr) {
+            pollAdr(nowMs);
+        }
+    }
+
+    void LinkLayer::pollSender(uint32_t nowMs) {
+        if (coordinator_.isActive()) {
+            // No PINGs while the profile is changing; they restart on the new one
+            pollCommit(nowMs);
+            return;
+        }
+        if (pollTdmaNode() || !config_.pings || switchPending_) {
+            return;
+        }
+        // Paced from the PING's airtime; the result comes back through onTxComplete()
+        if (nowMs - lastPingMs_ >= airtime_.intervalMs(PING_FRAME_BYTES, config_.pingSharePermille,
+                                                       config_.pingMinIntervalMs)) {
+            if (queueOwn(FrameType::PING, static_cast<uint16_t>(pingSeq_++), TX_NORMAL)) {
+                stats_.pings++;
+            }
+            lastPingMs_ = nowMs;
+        }
+    }
+
+    // Sender: JOIN or PING at the instant tdma.h picks; false while unsynced,
+    // when PINGs are paced instead. Until the first beacon the sender only
+    // listens, so senders booting together do not drown it.
+    bool LinkLayer::pollTdmaNode() {
+        if (tdmaNode_ == nullptr) {
+            return false;
+        }
+        const uint32_t nowUs = clockUs_();
+        switch (tdmaNode_->poll(nowUs)) {
+            case TdmaAction::SEND_JOIN:
+                queueOwn(FrameType::TDMA_JOIN, nextSequence(), TX_CRITICAL);
+                break;
+            case TdmaAction::SEND_DATA:
+                // A frame that cannot start now would spill into the next slot
+                if (tx_.isBusy() || airtime_.waitUs(PING_FRAME_BYTES, nowUs) > 0) {
+                    stats_.slotsSkipped++;
+                } else if (queueOwn(FrameType::PING, static_cast<uint16_t>(pingSeq_++), TX_CRITICAL)) {
+                    stats_.pings++;
+                }
+                break;
+            default:
+                break;
+        }
+        if (tdmaNode_->getStats().beacons == 0 && clockMs_() - tdmaListenFromMs_ < config_.tdmaListenMs) {
+            return true;
+        }
+        return tdmaNode_->state() != TdmaState::UNSYNCED;
+    }
+
+    // Receiver: queue the beacon once the superframe is over and the radio is free
+    void LinkLayer::pollTdmaCoordinator() {
+        if (tdmaCoord_ == nullptr || !tdmaCoord_->beaconDue(clockUs_()) || tx_.isBusy()) {
+            return;
+        }
+        uint8_t payload[TDMA_BEACON_MAX_SIZE];
+        const size_t len = tdmaCoord_->encodeBeacon(payload, sizeof(payload));
+        queueOwn(FrameType::TDMA_BEACON, nextSequence(), TX_CRITICAL, payload, len);
+    }
+
+    // Coordinator: PREPARE rounds, then COMMITs, then the switch
+    void LinkLayer::pollCommit(uint32_t nowMs) {
+        uint8_t payload[MAX_PAYLOAD_SIZE];
+        size_t len;
+        bool queued;
+        const CommitAction action = coordinator_.poll(nowMs);
+        switch (action) {
+            case CommitAction::SEND_PREPARE:
+            case CommitAction::SEND_COMMIT:
+                len = action == CommitAction::SEND_PREPARE ? coordinator_.encodePrepare(nowMs, payload, sizeof(payload))
+                                                           : coordinator_.encodeCommit(nowMs, payload, sizeof(payload));
+                queued = queueFrame(action == CommitAction::SEND_PREPARE ? FrameType::CONFIG_PREPARE
+                                                                         : FrameType::CONFIG_COMMIT,
+                                    nextSequence(), TX_HIGH, payload, len);
+                if (!queued) {
+                    stats_.queueFull++;
+                }
+                if (listener_ != nullptr) {
+                    listener_->onConfigRound(action, queued);
+                }
+                break;
+            case CommitAction::SWITCH:
+                switchTo(coordinator_.pending(), ProfileSource::COMMIT);
+                break;
+            default:
+                break;
+        }
+    }
+
+    // Participant: ack in our slot, then switch at the committed instant
+    void LinkLayer::pollParticipant(uint32_t nowMs) {
+        uint8_t payload[CONFIG_ACK_SIZE];
+        switch (participant_.poll(nowMs)) {
+            case CommitAction::SEND_ACK:
+                queueOwn(FrameType::CONFIG_ACK, nextSequence(), TX_HIGH, payload,
+                         participant_.encodeAck(payload, sizeof(payload)));
+                break;
+            case CommitAction::SWITCH:
+                switchTo(participant_.pending(), ProfileSource::PARTICIPANT);
+                break;
+            default:
+                break;
+        }
+    }
+
+    // Receiver: ask the sender for the profile the link history supports
+    void LinkLayer::pollAdr(uint32_t nowMs) {
+        if (nowMs - lastAdrMs_ < config_.adrEvalMs) {
+            return;
+        }
+        lastAdrMs_ = nowMs;
+        if (ota_.isActive() || transferActive_) {
+            return;
+        }
+        ConfigPayload next;
+        if (!adr_.evaluate(profile_, nowMs, next)) {
+            return;
+        }
+        uint8_t payload[CONFIG_PAYLOAD_SIZE];
+        const size_t len = encodeConfig(next, payload, sizeof(payload));
+        const bool queued = queueFrame(FrameType::ADR_REQUEST, nextSequence(), TX_HIGH, payload, len);
+        if (!queued) {
+            stats_.queueFull++;
+        }
+        if (listener_ != nullptr) {
+            listener_->onAdrRequest(next, queued);
+        }
+    }
+
+    void LinkLayer::handleFrame(const RxFrame& rx) {
+        FrameView frame;
+        const DecodeResult result = decodeFrame(rx.data, rx.length, frame);
+        if (result != DecodeResult::OK) {
+            stats_.dropped++;
+            if (listener_ != nullptr) {
+                listener_->onDropped(result, rx.length);
+            }
+            return;
+        }
+
+        const uint32_t nowMs = clockMs_();
+        lastRssi_ = rx.rssi;
+        lastSnr_ = rx.snr;
+        lastFrameMs_ = nowMs;
+        stats_.frames++;
+
+        if (config_.sender && fromReceiverRole(frame.header.type)) {
+            coordinator_.noteNode(frame.header.nodeId, nowMs);
+        }
+        if (!config_.sender) {
+            LinkEntry* link = links_.onFrame(frame.header.nodeId, rx.rssi, rx.snr, rx.length, nowMs);
+            // Only PINGs use the sender's every-transmission counter
+            if (link != nullptr && frame.header.type == FrameType::PING) {
+                links_.onSequence(*link, frame.header.sequence);
+            }
+            if (tdmaCoord_ != nullptr) {
+                tdmaCoord_->onFrame(frame.header.nodeId, rx.timestampUs);
+            }
+        }
+        // Deliberate repeats share a sequence number; PINGs never repeat and
+        // would only flush the ring
+        if (frame.header.type != FrameType::PING && dedup_.isRepeat(frame.header, nowMs)) {
+            stats_.repeats++;
+            return;
+        }
+        const bool handled = dispatcher_.dispatch(frame, rx);
+        if (!handled) {
+            stats_.unhandled++;
+        }
+        if (listener_ != nullptr) {
+            listener_->onFrame(frame, rx, handled);
+        }
+    }
+
+    // Build the dispatch table for the current role
+    void LinkLayer::registerHandlers() {
+        dispatcher_.clear();
+        dispatcher_.on(FrameType::CONFIG, onConfig, this);
+        dispatcher_.on(FrameType::OTA_START, onOtaFrame, this);
+        dispatcher_.on(FrameType::OTA_DATA, onOtaFrame, this);
+        dispatcher_.on(FrameType::OTA_END, onOtaFrame, this);
+        dispatcher_.on(FrameType::PING, onPing, this);
+        dispatcher_.on(FrameType::FRAGMENT, onFragment, this);
+        if (config_.sender) {
+            dispatcher_.on(FrameType::FW_UPDATE_AVAILABLE, onUpdateNotice, this);
+            dispatcher_.on(FrameType::UPDATE_NOW, onUpdateNotice, this);
+            dispatcher_.on(FrameType::UPDATE_ACK, onUpdateReply, this);
+            dispatcher_.on(FrameType::NO_FIRMWARE, onUpdateReply, this);
+            dispatcher_.on(FrameType::OTA_CODED_START, onOtaCoded, this);
+            dispatcher_.on(FrameType::OTA_CODED, onOtaCoded, this);
+            dispatcher_.on(FrameType::OTA_BLOCK_POLL, onOtaCoded, this);
+            dispatcher_.on(FrameType::ADR_REQUEST, onAdrRequest, this);
+            dispatcher_.on(FrameType::CONFIG_ACK, onConfigAck, this);
+            if (tdmaNode_ != nullptr) {
+                dispatcher_.on(FrameType::TDMA_BEACON, onTdmaBeacon, this);
+            }
+        } else {
+            dispatcher_.on(FrameType::CONFIG_PREPARE, onConfigPrepare, this);
+            dispatcher_.on(FrameType::CONFIG_COMMIT, onConfigCommit, this);
+            dispatcher_.on(FrameType::REQUEST_UPDATE, onUpdateRequest, this);
+            if (tdmaCoord_ != nullptr) {
+                dispatcher_.on(FrameType::TDMA_JOIN, onTdmaJoin, this);
+            }
+        }
+    }
+
+    // Single CONFIG frame: control-channel sync and senders without the two-phase change
+    void LinkLayer::onConfig(const FrameView& frame, const RxFrame&, void* context) {
+        LinkLayer& self = *static_cast<LinkLayer*>(context);
+        ConfigPayload config;
+        if (!decodeConfig(frame.payload, frame.payloadSize, config)) {
+            self.stats_.malformed++;
+            if (self.listener_ != nullptr) {
+                self.listener_->onMalformed(frame);
+            }
+            return;
+        }
+        self.switchTo(config, ProfileSource::CONFIG);
+    }
+
+    // Participant: the coordinator proposes a profile; the ack slot is
+    // timed from when the frame finished arriving
+    void LinkLayer::onConfigPrepare(const FrameView& frame, const RxFrame& rx, void* context) {
+        LinkLayer& self = *static_cast<LinkLayer*>(context);
+        const uint32_t rxMs = self.clockMs_() - (self.clockUs_() - rx.timestampUs) / 1000;
+        if (!self.participant_.onPrepare(frame.header.nodeId, frame.payload, frame.payloadSize, rxMs)) {
+            ConfigPrepare prepare;
+            if (!decodeConfigPrepare(frame.payload, frame.payloadSize, prepare)) {
+                self.stats_.malformed++;
+                if (self.listener_ != nullptr) {
+                    self.listener_->onMalformed(frame);
+                }
+            }
+        }
+    }
+
+    void LinkLayer::onConfigCommit(const FrameView& frame, const RxFrame& rx, void* context) {
+        LinkLayer& self = *static_cast<LinkLayer*>(context);
+        const uint32_t rxMs = self.clockMs_() - (self.clockUs_() - rx.timestampUs) / 1000;
+        if (!self.participant_.onCommit(frame.header.nodeId, frame.payload, frame.payloadSize, rxMs)) {
+            ConfigCommitMessage commit;
+            if (!decodeConfigCommit(frame.payload, frame.payloadSize, commit)) {
+                self.stats_.malformed++;
+                if (self.listener_ != nullptr) {
+                    self.listener_->onMalformed(frame);
+                }
+            }
+        }
+    }
+
+    // Coordinator: a participant holds the proposed profile
+    void LinkLayer::onConfigAck(const FrameView& frame, const RxFrame&, void* context) {
+        LinkLayer& self = *static_cast<LinkLayer*>(context);
+        self.coordinator_.onAck(frame.header.nodeId, frame.payload, frame.payloadSize, self.clockMs_());
+    }
+
+    void LinkLayer::onPing(const FrameView& frame, const RxFrame& rx, void* context) {
+        LinkLayer& self = *static_cast<LinkLayer*>(context);
+        if (!self.config_.sender && self.config_.adr) {
+            self.adr_.onFrame(frame.header.nodeId, frame.header.sequence, rx.rssi, rx.snr, self.clockMs_());
+        }
+    }
+
+    // Sender: the receiver's ADR picked a new profile; switch both ends
+    void LinkLayer::onAdrRequest(const FrameView& frame, const RxFrame&, void* context) {
+        LinkLayer& self = *static_cast<LinkLayer*>(context);
+        ConfigPayload config;
+        if (!decodeConfig(frame.payload, frame.payloadSize, config) || self.coordinator_.isActive() ||
+            self.ota_.isActive()) {
+            return;
+        }
+        const ConfigPayload& current = self.profile_;
+        if (config.sf == current.sf && config.bwKHz == current.bwKHz && config.txPower == current.txPower) {
+            return;
+        }
+        ConfigPayload next = current;
+        next.sf = config.sf;
+        next.bwKHz = config.bwKHz;
+        next.txPower = config.txPower;
+        self.startConfigChange(next);
+    }
+
+    // Sender: request the update when notified. The receiver sends its
+    // notices blind and may not be listening yet, so the request is repeated
+    // until it is answered or the transfer starts
+    void LinkLayer::onUpdateNotice(const FrameView&, const RxFrame&, void* context) {
+        LinkLayer& self = *static_cast<LinkLayer*>(context);
+        if (self.requestsLeft_ > 0 || self.ota_.isActive() || self.config_.updateAttempts == 0) {
+            return;
+        }
+        self.requestsLeft_ = self.config_.updateAttempts;
+        self.sendUpdateRequest(self.clockMs_());
+    }
+
+    // Sender: UPDATE_ACK for our last request, or NO_FIRMWARE; either way
+    // the receiver heard us
+    void LinkLayer::onUpdateReply(const FrameView& frame, const RxFrame&, void* context) {
+        LinkLayer& self = *static_cast<LinkLayer*>(context);
+        if (frame.header.type == FrameType::NO_FIRMWARE || frame.header.sequence == self.requestSeq_) {
+            self.requestsLeft_ = 0;
+        }
+    }
+
+    void LinkLayer::sendUpdateRequest(uint32_t nowMs) {
+        requestsLeft_--;
+        requestSeq_ = nextSequence();
+        // Several senders hear the same notice; jitter spreads their retries
+        const uint32_t retryMs = config_.updateRetryMs;
+        requestDueMs_ = nowMs + retryMs + (retryMs > 0 ? rng_.next() % retryMs : 0);
+        if (queueOwn(FrameType::REQUEST_UPDATE, requestSeq_, TX_HIGH)) {
+            stats_.updateRequests++;
+        }
+    }
+
+    void LinkLayer::pollUpdateRequest(uint32_t nowMs) {
+        if (requestsLeft_ == 0) {
+            return;
+        }
+        if (ota_.isActive()) {
+            requestsLeft_ = 0;      // OTA_START or OTA_CODED_START arrived
+            return;
+        }
+        if (static_cast<int32_t>(nowMs - requestDueMs_) >= 0) {
+            sendUpdateRequest(nowMs);
+        }
+    }
+
+    // Receiver: acknowledge, then the application sends its image if it has one
+    void LinkLayer::onUpdateRequest(const FrameView& frame, const RxFrame&, void* context) {
+        LinkLayer& self = *static_cast<LinkLayer*>(context);
+        self.queueOwn(FrameType::UPDATE_ACK, frame.header.sequence, TX_HIGH);
+        if (self.listener_ == nullptr || !self.listener_->onUpdateRequest(frame.header.nodeId)) {
+            self.queueOwn(FrameType::NO_FIRMWARE, self.nextSequence(), TX_HIGH);
+        }
+    }
+
+    // Sender: superframe timing and maybe our grant; RxDone is the time origin
+    void LinkLayer::onTdmaBeacon(const FrameView& frame, const RxFrame& rx, void* context) {
+        LinkLayer& self = *static_cast<LinkLayer*>(context);
+        self.tdmaNode_->onBeacon(frame.payload, frame.payloadSize, rx.timestampUs);
+    }
+
+    // Receiver: a sender asks for a slot; the grant goes out in the next beacons
+    void LinkLayer::onTdmaJoin(const FrameView& frame, const RxFrame&, void* context) {
+        static_cast<LinkLayer*>(context)->tdmaCoord_->onJoin(frame.header.nodeId);
+    }
+
+    bool LinkLayer::sameImage(const OtaStartInfo& info) const {
+        return ota_.isActive() && info.imageSize == ota_.getInfo().imageSize &&
+               memcmp(info.sha256, ota_.getInfo().sha256, sizeof(info.sha256)) == 0;
+    }
+
+    void LinkLayer::reportOtaProgress() {
+        const uint8_t percent = ota_.percent();
+        if (percent != otaLastPercent_) {
+            otaLastPercent_ = percent;
+            if (listener_ != nullptr) {
+                listener_->onOta(OtaEvent::PROGRESS, OtaResult::OK);
+            }
+        }
+    }
+
+    // Tell the OTA source which chunks are still missing (or that we are done)
+    void LinkLayer::sendOtaNack() {
+        uint8_t payload[MAX_PAYLOAD_SIZE];
+        const size_t len = encodeOtaNack(ota_, payload, sizeof(payload));
+        if (len == 0) {
+            return;
+        }
+        otaLastNackMs_ = clockMs_();
+        queueOwn(FrameType::OTA_NACK, nextSequence(), TX_HIGH, payload, len);
+    }
+
+    // Every chunk is in flash: verify and report; the application reboots
+    void LinkLayer::completeOta() {
+        const OtaResult result = ota_.finish();
+        // The final NACK is not re-polled after a reboot, so send it a few times;
+        // a coded broadcast learns about completion from silence instead
+        for (int i = 0; i < 3 && !otaBroadcast_; i++) {
+            sendOtaNack();
+        }
+        if (listener_ != nullptr) {
+            listener_->onOta(OtaEvent::FINISHED, result);
+        }
+    }
+
+    // Selective-repeat transfer (both roles)
+    void LinkLayer::onOtaFrame(const FrameView& frame, const RxFrame&, void* context) {
+        LinkLayer& self = *static_cast<LinkLayer*>(context);
+        OtaReceiver& ota = self.ota_;
+        const uint32_t nowMs = self.clockMs_();
+        if (frame.header.type == FrameType::OTA_START) {
+            OtaStartInfo info;
+            if (!decodeOtaStart(frame.payload, frame.payloadSize, info)) {
+                self.stats_.malformed++;
+                if (self.listener_ != nullptr) {
+                    self.listener_->onMalformed(frame);
+                }
+                return;
+            }
+            // A repeated start for the image already in progress is not a
+            // restart; the source just missed our answer
+            if (self.sameImage(info)) {
+                self.sendOtaNack();
+                return;
+            }
+            self.update_.setFlags(info.flags);
+            const OtaResult result = ota.start(info, nowMs);
+            if (result != OtaResult::OK) {
+                if (self.listener_ != nullptr) {
+                    self.listener_->onOta(OtaEvent::START_FAILED, result);
+                }
+                return;
+            }
+            self.otaBroadcast_ = false;
+            self.otaLastPercent_ = 0;
+            if (self.listener_ != nullptr) {
+                self.listener_->onOta(OtaEvent::STARTED, result);
+            }
+            self.sendOtaNack();
+        } else if (frame.header.type == FrameType::OTA_DATA) {
+            if (!ota.isActive() || frame.payloadSize <= OTA_CHUNK_HEADER_SIZE) {
+                return;
+            }
+            // Payload: u16 chunk index, raw chunk bytes (CRC already checked by decodeFrame)
+            const uint16_t index = Wire::getU16(frame.payload);
+            const OtaResult result = ota.onChunk(index, frame.payload + OTA_CHUNK_HEADER_SIZE,
+                                                 frame.payloadSize - OTA_CHUNK_HEADER_SIZE, nowMs);
+            if ((result == OtaResult::BAD_CHUNK || result == OtaResult::BACKEND_ERROR) && self.listener_ != nullptr) {
+                self.listener_->onOta(OtaEvent::CHUNK_FAILED, result);
+            }
+            self.reportOtaProgress();
+            if (result == OtaResult::OK && ota.missingChunks() == 0) {
+                self.completeOta();
+            }
+        } else if (frame.header.type == FrameType::OTA_END) {
+            // End of a send round: answer with what is still missing
+            if (ota.isActive() && ota.missingChunks() == 0) {
+                self.completeOta();
+            } else if (ota.getState() != OtaState::IDLE) {
+                if (ota.isActive() && self.listener_ != nullptr) {
+                    self.listener_->onOta(OtaEvent::ROUND_DONE, OtaResult::INCOMPLETE);
+                }
+                self.sendOtaNack();
+            }
+        }
+    }
+
+    // Erasure-coded broadcast (senders): any large enough set of OTA_CODED
+    // packets rebuilds a block, so nothing is acknowledged per chunk
+    void LinkLayer::onOtaCoded(const FrameView& frame, const RxFrame&, void* context) {
+        LinkLayer& self = *static_cast<LinkLayer*>(context);
+        OtaReceiver& ota = self.ota_;
+        const uint32_t nowMs = self.clockMs_();
+        if (frame.header.type == FrameType::OTA_CODED_START) {
+            OtaStartInfo info;
+            if (!decodeOtaStart(frame.payload, frame.payloadSize, info)) {
+                self.stats_.malformed++;
+                if (self.listener_ != nullptr) {
+                    self.listener_->onMalformed(frame);
+                }
+                return;
+            }
+            // Repeated before every sweep; only a new image restarts
+            if (self.sameImage(info)) {
+                return;
+            }
+            self.update_.setFlags(info.flags);
+            const OtaResult result = ota.start(info, nowMs);
+            if (result != OtaResult::OK) {
+                if (self.listener_ != nullptr) {
+                    self.listener_->onOta(OtaEvent::START_FAILED, result);
+                }
+                return;
+            }
+            self.otaBroadcast_ = true;
+            self.otaLastPercent_ = 0;
+            self.needPending_ = false;
+            self.fec_.resetStats();
+            if (self.listener_ != nullptr) {
+                self.listener_->onOta(OtaEvent::STARTED, result);
+            }
+        } else if (frame.header.type == FrameType::OTA_CODED) {
+            if (!self.otaBroadcast_) {
+                return;
+            }
+            const OtaResult result = self.fec_.onCoded(frame.payload, frame.payloadSize, nowMs);
+            if ((result == OtaResult::BAD_CHUNK || result == OtaResult::BACKEND_ERROR) && self.listener_ != nullptr) {
+                self.listener_->onOta(OtaEvent::CHUNK_FAILED, result);
+            }
+            self.reportOtaProgress();
+            if (result == OtaResult::OK && ota.isActive() && ota.missingChunks() == 0) {
+                self.completeOta();
+            }
+        } else if (frame.header.type == FrameType::OTA_BLOCK_POLL) {
+            if (!self.otaBroadcast_ || !ota.isActive() || frame.payloadSize != OTA_BLOCK_POLL_SIZE) {
+                return;
+            }
+            // Every short listener answers the same poll; a random delay keeps
+            // most of the answers from colliding
+            self.needBlock_ = Wire::getU16(frame.payload);
+            const uint32_t backoffMs = self.config_.otaNeedBackoffMs;
+            self.needDueMs_ = nowMs + (backoffMs > 0 ? self.rng_.next() % backoffMs : 0);
+            self.needPending_ = true;
+        }
+    }
+
+    void LinkLayer::pollOta(uint32_t nowMs) {
+        if (ota_.checkTimeout(nowMs)) {
+            if (listener_ != nullptr) {
+                listener_->onOta(OtaEvent::TIMEOUT, OtaResult::INCOMPLETE);
+            }
+            return;
+        }
+        // Answer the last block poll once the backoff has passed; what is still
+        // needed is read now, not when the poll arrived
+        if (needPending_ && static_cast<int32_t>(nowMs - needDueMs_) >= 0) {
+            needPending_ = false;
+            uint8_t need[OTA_BLOCK_NEED_SIZE];
+            const size_t len = fec_.encodeNeed(needBlock_, need, sizeof(need));
+            if (len > 0) {
+                queueOwn(FrameType::OTA_BLOCK_NEED, nextSequence(), TX_HIGH, need, len);
+            }
+        }
+        // Lost polls are covered by an unprompted NACK once the source goes quiet
+        if (ota_.isActive() && !otaBroadcast_ && nowMs - ota_.lastActivityMs() >= config_.otaNackIdleMs &&
+            nowMs - otaLastNackMs_ >= config_.otaNackIdleMs) {
+            sendOtaNack();
+        }
+    }
+
+    // Fragments trickle into the queue behind control traffic; none go out
+    // while the profile is changing, since the far end would miss them
+    void LinkLayer::pollFragments(uint32_t nowMs) {
+        reassembler_.expire(nowMs);
+        if (switchPending_ || coordinator_.isActive()) {
+            return;
+        }
+        while (fragments_.isActive() && tx_.freeSlots() > FRAGMENT_QUEUE_RESERVE) {
+            uint8_t payload[MAX_PAYLOAD_SIZE];
+            const size_t len = fragments_.next(payload, sizeof(payload));
+            // A refused fragment loses the message; the sender is free for the next
+            if (len == 0 || !queueOwn(FrameType::FRAGMENT, nextSequence(), TX_LOW, payload, len)) {
+                fragments_.cancel();
+                return;
+            }
+        }
+    }
+
+    void LinkLayer::onFragment(const FrameView& frame, const RxFrame&, void* context) {
+        LinkLayer& self = *static_cast<LinkLayer*>(context);
+        FragmentReassembler& reassembler = self.reassembler_;
+        const FragmentResult result =
+            reassembler.onFragment(frame.header.nodeId, frame.payload, frame.payloadSize, self.clockMs_());
+        if (result == FragmentResult::INVALID) {
+            self.stats_.malformed++;
+            if (self.listener_ != nullptr) {
+                self.listener_->onMalformed(frame);
+            }
+        } else if (result == FragmentResult::COMPLETE && self.listener_ != nullptr) {
+            self.listener_->onMessage(reassembler.messageSource(), reassembler.messageKind(),
+                                      reassembler.message(), reassembler.messageLength());
+        }
+    }
+}
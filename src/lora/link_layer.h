@@ -0,0 +1,333 @@
+#pragma once
+
+#include "adr.h"
+#include "airtime.h"
+#include "capture.h"
+#include "config_commit.h"
+#include "dedup_cache.h"
+#include "frame_codec.h"
+#include "frame_dispatcher.h"
+#include "fragment.h"
+#include "frame_pool.h"
+#include "link_table.h"
+#include "listen_before_talk.h"
+#include "ota_fec.h"
+#include "ota_receiver.h"
+#include "radio_driver.h"
+#include "radio_profile.h"
+#include "rx_engine.h"
+#include "staged_update.h"
+#include "tdma.h"
+#include "tx_scheduler.h"
+#include "xorshift.h"
+#include <stdint.h>
+#include <cstddef>
+
+// The node's side of the LoRa protocol, independent of the board
+//
+// LinkLayer owns everything between the radio driver and the application:
+// the receive engine and frame pool, the TX queue with its airtime budget and
+// listen-before-talk, decode, repeat filtering and dispatch, the radio
+// profile and its two-phase change (coordinator on senders, participant on
+// receivers), ADR and the link table on receivers, sender PINGs, and the
+// receiving end of a LoRa OTA transfer, selective-repeat or coded broadcast,
+// and messages larger than one frame in both directions (fragment.h).
+//
+// The radio comes in through IRadioDriver and IRadioConfig (RadioLibDriver
+// in the firmware, MockRadio on the host), the update partition through
+// StagedUpdateBackend, and time through two clock functions. Nothing here
+// blocks, prints or touches the board, so the native build runs the same
+// frame path the firmware ships. What the application shows or stores is
+// reported to an ILinkListener.
+//
+// TDMA, CAD wake and frame capture are compile-time options of the firmware;
+// attach their objects to have the link layer drive them.
+namespace LoRaLink {
+
+    struct LinkLayerConfig {
+        uint16_t nodeId;
+        bool sender;
+        uint16_t preamble;              // Symbols, as set on the radio
+        uint16_t dutyCyclePermille;     // 1000: no limit
+        bool listenBeforeTalk;
+        bool rxDutyCycle;               // Receivers listen in RX duty cycle (rx_power.h)
+        bool adr;                       // Receivers recommend profiles from PING history
+        AdrConfig adrConfig;
+        bool pings;                     // Senders queue their own PINGs
+        uint16_t pingSharePermille;     // PING pacing: share of airtime
+        uint32_t pingMinIntervalMs;
+        uint32_t tdmaListenMs;          // TDMA sender: wait this long for a first beacon before paced PINGs
+        uint32_t adrEvalMs;
+        uint32_t configAckTurnaroundMs; // RX->TX and loop latency per ack slot
+        uint32_t otaNackIdleMs;         // Unprompted OTA_NACK after this much silence
+        uint32_t otaNeedBackoffMs;      // OTA_BLOCK_NEED spread over the poll slot
+        uint32_t updateRetryMs;         // REQUEST_UPDATE again after this plus up to as much jitter
+        uint8_t updateAttempts;         // REQUEST_UPDATE frames per notice, first one included
+        uint32_t fragmentMaxAirMs;      // Airtime cap per FRAGMENT frame (dwell time); 0: none
+        uint32_t reassemblyMinMs;       // Shortest reassembly timeout on fast profiles
+
+        static LinkLayerConfig defaultConfig();
+    };
+
+    struct LinkStats {
+        uint32_t frames;            // Decoded frames
+        uint32_t dropped;           // Failed decode
+        uint32_t readErrors;        // RxEngine read failures
+        uint32_t repeats;           // Deliberate repeats filtered before dispatch
+        uint32_t unhandled;         // No handler for the role
+        uint32_t malformed;         // Payload a handler could not parse
+        uint32_t pings;             // PINGs queued by the sender
+        uint32_t updateRequests;    // REQUEST_UPDATE frames queued, retries included
+        uint32_t queueFull;         // Frames of the link layer's own the TX queue refused
+        uint32_t slotsSkipped;      // TDMA slots missed with the radio busy
+        uint32_t profileChanges;
+    };
+
+    // Where a profile change came from
+    enum class ProfileSource : uint8_t {
+        CONFIG,                     // Single CONFIG frame
+        COMMIT,                     // Coordinator: the change it ran reached its switch
+        PARTICIPANT,                // Committed change from the coordinator
+        APPLICATION                 // applyProfile()
+    };
+
+    enum class OtaEvent : uint8_t {
+        STARTED,
+        START_FAILED,
+        PROGRESS,                   // Percent changed
+        CHUNK_FAILED,
+        ROUND_DONE,                 // OTA_END with chunks still missing
+        FINISHED,                   // Verified and bootable when result is OK
+        TIMEOUT
+    };
+
+    // Application side: display, logs, persistence. Every call comes from
+    // LinkLayer::poll() or a LinkLayer method, never from the ISR.
+    class ILinkListener {
+    public:
+        virtual ~ILinkListener() = default;
+
+        // After dispatch; handled is false when no handler took the frame
+        virtual void onFrame(const FrameView&, const RxFrame&, bool /*handled*/) {}
+        virtual void onDropped(DecodeResult, size_t /*length*/) {}
+        virtual void onMalformed(const FrameView&) {}
+        virtual void onReadError() {}
+        virtual void onTxComplete(const TxResult&) {}
+        // A frame of the link layer's own did not fit the TX queue
+        virtual void onQueueFull(FrameType, uint16_t /*sequence*/) {}
+        // status is the radio's; the profile is current only when it is OK
+        virtual void onProfileChanged(const ConfigPayload&, ProfileSource, int /*status*/) {}
+        // Coordinator: a change started with this epoch (persist it)
+        virtual void onConfigStarted(const ConfigPayload&, uint16_t /*epoch*/) {}
+        virtual void onConfigRound(CommitAction, bool /*queued*/) {}
+        virtual void onAdrRequest(const ConfigPayload& /*next*/, bool /*queued*/) {}
+        virtual void onOta(OtaEvent, OtaResult) {}
+        // Receiver: a node asked for firmware; true when the application sends it
+        virtual bool onUpdateRequest(uint16_t /*nodeId*/) { return false; }
+        // A whole message from sendMessage() on another node; data is valid for the call
+        virtual void onMessage(uint16_t /*nodeId*/, uint8_t /*kind*/, const uint8_t* /*data*/, size_t /*length*/) {}
+    };
+
+    class LinkLayer {
+    public:
+        typedef uint32_t (*Clock)();
+        static constexpr size_t LINK_TABLE_SLOTS = 64;     // 1.8 KB, fixed
+
+        LinkLayer(IRadioDriver& radio, IRadioConfig& radioConfig, StagedUpdateBackend& update,
+                  const LinkLayerConfig& config, Clock clockUs, Clock clockMs);
+
+        void setListener(ILinkListener* listener) { listener_ = listener; }
+        // Optional, owned by the caller; attach before begin()
+        void attachTdma(TdmaCoordinator* coordinator, TdmaNode* node);
+        void attachCadWake(CadWake* cadWake) { cadWake_ = cadWake; }
+        // Record every frame read from the radio, before decode
+        void attachCapture(CaptureRing* capture) { capture_ = capture; }
+        // Backoff and OTA_BLOCK_NEED jitter; differs per node
+        void seed(uint32_t seed);
+        // Node id and role known only at boot (eFuse MAC, saved role); call before begin()
+        void setIdentity(uint16_t nodeId, bool sender);
+
+        // The radio was just initialised with this profile (radio.begin());
+        // registers the role's handlers
+        void begin(const ConfigPayload& profile);
+        // Continuous RX (or CAD wake / RX duty cycle on receivers); false
+        // when CAD wake could not start
+        bool listen();
+        // Role change: drops in-flight changes, links and TDMA state, then listens
+        void setRole(bool sender);
+
+        // ISR context: DIO1 edge
+        void onDio1(uint32_t timestampUs) {
+            tx_.onDio1(timestampUs);
+            rx_.onDio1(timestampUs);
+            if (cadWake_ != nullptr) {
+                cadWake_->onDio1(timestampUs);
+            }
+        }
+
+        // Main loop: TX completions, PINGs, received frames, config change,
+        // TDMA, OTA timeouts and ADR
+        void poll();
+
+        // Encode with this node's id and queue; false if invalid or the queue is full
+        bool queueFrame(FrameType type, uint16_t sequence, Priority priority,
+                        const uint8_t* payload = nullptr, size_t payloadSize = 0);
+        // Sequence for the next non-PING frame
+        uint16_t nextSequence() { return frameSeq_++; }
+        // Up to FRAGMENT_MAX_MESSAGE bytes as FRAGMENT frames, queued by poll()
+        // at low priority while the TX queue has room; false while the last
+        // message is still going out or if it cannot be split
+        bool sendMessage(uint8_t kind, const uint8_t* data, size_t length);
+        bool isSendingMessage() const { return fragments_.isActive(); }
+
+        // Coordinator: run a two-phase change to next; false while one is running
+        bool startConfigChange(const ConfigPayload& next);
+        // Switch the radio with the TX queue idle (RX paused around the
+        // setters). The profile is taken even if a setter fails; the next
+        // apply writes the failed ones again.
+        int applyProfile(const ConfigPayload& profile);
+        // Take the profile without writing the radio (warm wake, control-channel
+        // sync); time on air, CAD and slot timing follow it
+        void setProfile(const ConfigPayload& profile);
+        // An outgoing transfer owns the channel: no ADR meanwhile
+        void setTransferActive(bool active) { transferActive_ = active; }
+
+        // Deep-sleep senders carry the sequences across wakes
+        void setSequences(uint32_t pingSeq, uint16_t frameSeq) { pingSeq_ = pingSeq; frameSeq_ = frameSeq; }
+        uint32_t pingSequence() const { return pingSeq_; }
+        uint32_t takePingSequence() { return pingSeq_++; }
+        uint16_t frameSequence() const { return frameSeq_; }
+
+        uint16_t nodeId() const { return config_.nodeId; }
+        bool isSender() const { return config_.sender; }
+        const ConfigPayload& profile() const { return profile_; }
+        const LinkLayerConfig& config() const { return config_; }
+        // Signal of the last decoded frame; lastRssi() is -999 before the first
+        float lastRssi() const { return lastRssi_; }
+        float lastSnr() const { return lastSnr_; }
+        uint32_t lastFrameMs() const { return lastFrameMs_; }
+
+        FramePool& framePool() { return pool_; }
+        RxEngine& rxEngine() { return rx_; }
+        TxScheduler& txScheduler() { return tx_; }
+        FrameDispatcher& dispatcher() { return dispatcher_; }
+        AirtimeBudget& airtime() { return airtime_; }
+        ListenBeforeTalk& listenBeforeTalk() { return lbt_; }
+        RadioProfileManager& radioProfile() { return radioProfile_; }
+        ConfigCoordinator& coordinator() { return coordinator_; }
+        ConfigParticipant& participant() { return participant_; }
+        OtaReceiver& ota() { return ota_; }
+        StagedUpdateBackend& update() { return update_; }
+        const DedupCache& dedup() const { return dedup_; }
+        const AdrEngine& adr() const { return adr_; }
+        const LinkTable& linkTable() const { return links_; }
+        const FecReceiveStats& fecStats() const { return fec_.getStats(); }
+        bool isOtaBroadcast() const { return otaBroadcast_; }
+        // Fragment data per frame on the current profile
+        size_t fragmentData() const { return fragmentData_; }
+        const FragmentReassembler& reassembler() const { return reassembler_; }
+
+        const LinkStats& getStats() const { return stats_; }
+        void resetStats() { stats_ = {}; }
+
+    private:
+        StagedUpdateBackend& update_;
+        LinkLayerConfig config_;
+        Clock clockUs_;
+        Clock clockMs_;
+        ILinkListener* listener_;
+        TdmaCoordinator* tdmaCoord_;
+        TdmaNode* tdmaNode_;
+        CadWake* cadWake_;
+        CaptureRing* capture_;
+
+        FramePool pool_;
+        RxEngine rx_;
+        TxScheduler tx_;
+        FrameDispatcher dispatcher_;
+        DedupCache dedup_;
+        AirtimeBudget airtime_;
+        ListenBeforeTalk lbt_;
+        RadioProfileManager radioProfile_;
+        ConfigCoordinator coordinator_;
+        ConfigParticipant participant_;
+        AdrEngine adr_;
+        LinkEntry linkSlots_[LINK_TABLE_SLOTS];
+        LinkTable links_;
+        OtaReceiver ota_;
+        FecReceiver fec_;
+        FragmentSender fragments_;
+        FragmentReassembler reassembler_;
+
+        ConfigPayload profile_;
+        uint32_t pingSeq_;
+        uint16_t frameSeq_;
+        uint32_t lastPingMs_;
+        uint32_t tdmaListenFromMs_;
+        uint32_t lastAdrMs_;
+        uint32_t lastReadErrors_;
+        bool switchPending_;        // Profile change waits for the TX queue to drain
+        ConfigPayload switchProfile_;
+        ProfileSource switchSource_;
+        bool transferActive_;
+        float lastRssi_;
+        float lastSnr_;
+        uint32_t lastFrameMs_;
+        // OTA receive
+        bool otaBroadcast_;
+        uint8_t otaLastPercent_;
+        uint32_t otaLastNackMs_;
+        uint16_t needBlock_;
+        uint32_t needDueMs_;
+        bool needPending_;
+        // Update request (senders)
+        uint8_t requestsLeft_;
+        uint16_t requestSeq_;
+        uint32_t requestDueMs_;
+        uint16_t messageId_;
+        size_t fragmentData_;
+        Xorshift32 rng_;
+        LinkStats stats_;
+
+        void registerHandlers();
+        void syncModulation();
+        uint32_t frameAirMs(size_t payloadSize) const;
+        bool queueOwn(FrameType type, uint16_t sequence, Priority priority,
+                      const uint8_t* payload = nullptr, size_t payloadSize = 0);
+        void handleFrame(const RxFrame& rx);
+        void onTxDone(const TxResult& result);
+        void switchTo(const ConfigPayload& profile, ProfileSource source);
+        void finishSwitch();
+
+        void pollSender(uint32_t nowMs);
+        bool pollTdmaNode();
+        void pollTdmaCoordinator();
+        void pollCommit(uint32_t nowMs);
+        void pollParticipant(uint32_t nowMs);
+        void pollAdr(uint32_t nowMs);
+        void pollOta(uint32_t nowMs);
+        void pollUpdateRequest(uint32_t nowMs);
+        void sendUpdateRequest(uint32_t nowMs);
+        void pollFragments(uint32_t nowMs);
+
+        void sendOtaNack();
+        void completeOta();
+        void reportOtaProgress();
+        bool sameImage(const OtaStartInfo& info) const;
+
+        static void onConfig(const FrameView& frame, const RxFrame& rx, void* context);
+        static void onConfigPrepare(const FrameView& frame, const RxFrame& rx, void* context);
+        static void onConfigCommit(const FrameView& frame, const RxFrame& rx, void* context);
+        static void onConfigAck(const FrameView& frame, const RxFrame& rx, void* context);
+        static void onPing(const FrameView& frame, const RxFrame& rx, void* context);
+        static void onAdrRequest(const FrameView& frame, const RxFrame& rx, void* context);
+        static void onUpdateNotice(const FrameView& frame, const RxFrame& rx, void* context);
+        static void onUpdateRequest(const FrameView& frame, const RxFrame& rx, void* context);
+        static void onUpdateReply(const FrameView& frame, const RxFrame& rx, void* context);
+        static void onTdmaBeacon(const FrameView& frame, const RxFrame& rx, void* context);
+        static void onTdmaJoin(const FrameView& frame, const RxFrame& rx, void* context);
+        static void onOtaFrame(const FrameView& frame, const RxFrame& rx, void* context);
+        static void onOtaCoded(const FrameView& frame, const RxFrame& rx, void* context);
+        static void onFragment(const FrameView& frame, const RxFrame& rx, void* context);
+    };
+}
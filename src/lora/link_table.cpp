@@ -0,0 +1,157 @@
+#include "link_table.h"
+#include <cstring>
+
+namespace LoRaLink {
+
+    namespace {
+        constexpr uint8_t EWMA_SHIFT = 3;       // Weight 1/8 per sample
+        constexpr uint8_t LOSS_GAP_CAP = 64;    // (7/8)^64: further misses change nothing
+
+        int16_t toQ7(float value) {
+            const float scaled = value * 128.0f;
+            if (scaled > 32767.0f) {
+                return 32767;
+            }
+            if (scaled < -32768.0f) {
+                return -32768;
+            }
+            return static_cast<int16_t>(scaled);
+        }
+
+        int16_t ewma(int16_t average, int16_t sample) {
+            return static_cast<int16_t>(average + ((sample - average) >> EWMA_SHIFT));
+        }
+    }
+
+    LinkTable::LinkTable(LinkEntry* slots, size_t capacity)
+        : slots_(slots)
+        , capacity_(capacity)
+        , mask_(capacity - 1)
+        , size_(0)
+        , stats_{}
+    {
+        clear();
+    }
+
+    size_t LinkTable::home(uint16_t nodeId) const {
+        // Multiply-xorshift mix; ids from MAC addresses often differ in few bits
+        uint32_t x = nodeId * 0x9E3779B1u;
+        x ^= x >> 15;
+        x *= 0x85EBCA77u;
+        x ^= x >> 13;
+        return static_cast<size_t>(x) & mask_;
+    }
+
+    LinkEntry* LinkTable::onFrame(uint16_t nodeId, float rssi, float snr, size_t bytes, uint32_t nowMs) {
+        if (slots_ == nullptr || capacity_ == 0) {
+            return nullptr;
+        }
+        stats_.updates++;
+
+        const size_t start = home(nodeId);
+        const size_t window = capacity_ < LINK_PROBE_LIMIT ? capacity_ : LINK_PROBE_LIMIT;
+        LinkEntry* entry = nullptr;
+        LinkEntry* stalest = nullptr;
+        uint32_t probes = 0;
+        for (size_t i = 0; i < window; ++i) {
+            LinkEntry& candidate = slots_[(start + i) & mask_];
+            probes++;
+            if (!candidate.used || candidate.nodeId == nodeId) {
+                entry = &candidate;
+                break;
+            }
+            if (stalest == nullptr || nowMs - candidate.lastSeenMs > nowMs - stalest->lastSeenMs) {
+                stalest = &candidate;
+            }
+        }
+        stats_.probes += probes;
+        if (probes > stats_.maxProbe) {
+            stats_.maxProbe = probes;
+        }
+
+        if (entry == nullptr) {
+            entry = stalest;
+            entry->used = 0;
+            size_--;
+            stats_.evictions++;
+        }
+        if (!entry->used) {
+            memset(entry, 0, sizeof(*entry));
+            entry->used = 1;
+            entry->nodeId = nodeId;
+            entry->rssiQ7 = toQ7(rssi);
+            entry->snrQ7 = toQ7(snr);
+            size_++;
+            stats_.inserts++;
+        } else {
+            entry->rssiQ7 = ewma(entry->rssiQ7, toQ7(rssi));
+            entry->snrQ7 = ewma(entry->snrQ7, toQ7(snr));
+        }
+        entry->lastSeenMs = nowMs;
+        entry->frames++;
+        entry->bytes += static_cast<uint32_t>(bytes);
+        return entry;
+    }
+
+    void LinkTable::onSequence(LinkEntry& entry, uint16_t sequence) {
+        if (!entry.haveSeq) {
+            entry.haveSeq = 1;
+            entry.lastSeq = sequence;
+            return;
+        }
+        const uint16_t step = static_cast<uint16_t>(sequence - entry.lastSeq);
+        if (step == 0) {
+            return;     // Repeat of the last frame
+        }
+        entry.lastSeq = sequence;
+        if (step > LINK_MAX_GAP) {
+            return;     // Sender restarted or a reordered old frame
+        }
+
+        // gap misses then one hit, each moving the EWMA 1/8 of the way:
+        // loss' = (1 - (1 - loss) * (7/8)^gap) * 7/8
+        const uint16_t gap = static_cast<uint16_t>(step - 1);
+        entry.missed += gap;
+        uint32_t keep = 65536u - entry.lossQ16;
+        const uint16_t decay = gap < LOSS_GAP_CAP ? gap : LOSS_GAP_CAP;
+        for (uint16_t i = 0; i < decay; ++i) {
+            keep -= keep >> EWMA_SHIFT;
+        }
+        const uint32_t lost = 65536u - keep;
+        const uint32_t loss = lost - (lost >> EWMA_SHIFT);
+        entry.lossQ16 = static_cast<uint16_t>(loss > 65535u ? 65535u : loss);
+    }
+
+    const LinkEntry* LinkTable::find(uint16_t nodeId) const {
+        if (slots_ == nullptr || capacity_ == 0) {
+            return nullptr;
+        }
+        const size_t start = home(nodeId);
+        const size_t window = capacity_ < LINK_PROBE_LIMIT ? capacity_ : LINK_PROBE_LIMIT;
+        for (size_t i = 0; i < window; ++i) {
+            const LinkEntry& candidate = slots_[(start + i) & mask_];
+            if (!candidate.used) {
+                return nullptr;
+            }
+            if (candidate.nodeId == nodeId) {
+                return &candidate;
+            }
+        }
+        return nullptr;
+    }
+
+    const LinkEntry* LinkTable::slot(size_t index) const {
+        return index < capacity_ && slots_[index].used ? &slots_[index] : nullptr;
+    }
+
+    void LinkTable::clear() {
+        if (slots_ != nullptr) {
+            memset(slots_, 0, capacity_ * sizeof(LinkEntry));
+        }
+        size_ = 0;
+    }
+
+    void LinkTable::resetStats() {
+        stats_ = {};
+    }
+}
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <stdint.h>
+#include <cstddef>
+
+// Per-node link statistics on the receiver
+//
+// One entry per sender, kept in caller-provided slots so the footprint is
+// fixed at build time. Node ids hash to a home slot; collisions
+// probe linearly for up to LINK_PROBE_LIMIT slots. Entries are never moved
+// or deleted. When the probe window is full, the entry heard least recently
+// in it is replaced. A lookup can therefore stop at the first empty slot,
+// and every update touches at most LINK_PROBE_LIMIT slots.
+//
+// Per node: last-seen time, frames and bytes received, EWMA RSSI/SNR, and a
+// loss estimate from sequence gaps. The loss is an EWMA of the
+// per-sequence-number loss fraction plus lifetime counts. Only frames that
+// count every transmission (PINGs) feed onSequence().
+namespace LoRaLink {
+
+    constexpr size_t LINK_PROBE_LIMIT = 8;
+    constexpr uint16_t LINK_MAX_GAP = 1000;     // Larger jumps are a reboot, not loss
+
+    struct LinkEntry {
+        uint16_t nodeId;
+        uint16_t lastSeq;
+        uint32_t lastSeenMs;
+        uint32_t frames;
+        uint32_t missed;            // Sequence numbers never heard
+        uint32_t bytes;
+        int16_t rssiQ7;             // EWMA, dB * 128
+        int16_t snrQ7;
+        uint16_t lossQ16;           // EWMA loss fraction, 65535 = everything lost
+        uint8_t used;
+        uint8_t haveSeq;
+
+        float rssi() const { return rssiQ7 / 128.0f; }
+        float snr() const { return snrQ7 / 128.0f; }
+        float loss() const { return lossQ16 / 65536.0f; }
+    };
+
+    struct LinkTableStats {
+        uint32_t updates;
+        uint32_t inserts;
+        uint32_t evictions;         // Entries replaced to make room
+        uint32_t probes;            // Slots examined, over all lookups
+        uint32_t maxProbe;
+    };
+
+    class LinkTable {
+    public:
+        // slots: capacity entries, capacity a power of two
+        LinkTable(LinkEntry* slots, size_t capacity);
+
+        // One frame from nodeId; creates the entry on first contact
+        LinkEntry* onFrame(uint16_t nodeId, float rssi, float snr, size_t bytes, uint32_t nowMs);
+        // Sequence number of a frame that counts every transmission
+        void onSequence(LinkEntry& entry, uint16_t sequence);
+
+        const LinkEntry* find(uint16_t nodeId) const;
+        // Occupied slots in table order; nullptr for an empty one
+        const LinkEntry* slot(size_t index) const;
+        void clear();
+
+        size_t size() const { return size_; }
+        size_t capacity() const { return capacity_; }
+        // Slot storage plus the table itself
+        size_t memoryBytes() const { return capacity_ * sizeof(LinkEntry) + sizeof(*this); }
+        const LinkTableStats& getStats() const { return stats_; }
+        void resetStats();
+
+    private:
+        LinkEntry* slots_;
+        size_t capacity_;
+        size_t mask_;
+        size_t size_;
+        LinkTableStats stats_;
+
+        size_t home(uint16_t nodeId) const;
+    };
+}
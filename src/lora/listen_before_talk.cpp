@@ -0,0 +1,225 @@
+#include "listen_before_talk.h"
+
+namespace LoRaLink {
+
+    namespace {
+        // Signed distance handles micros() wrap
+        inline bool reached(uint32_t nowUs, uint32_t atUs) {
+            return static_cast<int32_t>(nowUs - atUs) >= 0;
+        }
+    }
+
+    // --- Listen before talk --------------------------------------------------
+
+    LbtConfig ListenBeforeTalk::defaultConfig() {
+        LbtConfig config;
+        config.minWindowExp = 3;    // 8 slots, about 90 ms at SF9/125 kHz
+        config.maxWindowExp = 7;    // 128 slots, about 1.4 s
+        config.maxAttempts = 8;
+        config.turnaroundUs = 1000;
+        return config;
+    }
+
+    ListenBeforeTalk::ListenBeforeTalk()
+        : ListenBeforeTalk(defaultConfig())
+    {
+    }
+
+    ListenBeforeTalk::ListenBeforeTalk(const LbtConfig& config)
+        : config_(config)
+        , cadUs_(cadTimeUs(loraModulation(9, 125000)))
+        , readyUs_(0)
+        , windowExp_(config.minWindowExp)
+        , attempts_(0)
+        , rng_(1)
+        , stats_{}
+    {
+    }
+
+    void ListenBeforeTalk::setModulation(const LoRaModulation& modulation) {
+        cadUs_ = cadTimeUs(modulation);
+    }
+
+    void ListenBeforeTalk::onClear() {
+        stats_.scans++;
+        stats_.clear++;
+        windowExp_ = config_.minWindowExp;
+        attempts_ = 0;
+    }
+
+    bool ListenBeforeTalk::onBusy(uint32_t nowUs) {
+        stats_.scans++;
+        stats_.busy++;
+        if (++attempts_ >= config_.maxAttempts) {
+            stats_.forced++;
+            attempts_ = 0;
+            windowExp_ = config_.minWindowExp;
+            return false;
+        }
+        const uint32_t window = 1u << windowExp_;
+        const uint32_t waitUs = (1u + rng_.next() % window) * slotUs();
+        readyUs_ = nowUs + waitUs;
+        stats_.backoffUs += waitUs;
+        if (windowExp_ < config_.maxWindowExp) {
+            windowExp_++;
+        }
+        return true;
+    }
+
+    // --- CAD wake ------------------------------------------------------------
+
+    CadWakeConfig CadWake::defaultConfig() {
+        CadWakeConfig config;
+        config.lockSymbols = 4;
+        config.latencyUs = 12000;   // loop() runs every 10 ms
+        return config;
+    }
+
+    CadWake::CadWake(IRadioDriver& radio, RxEngine& receiver)
+        : CadWake(radio, receiver, defaultConfig())
+    {
+    }
+
+    CadWake::CadWake(IRadioDriver& radio, RxEngine& receiver, const CadWakeConfig& config)
+        : radio_(radio)
+        , receiver_(receiver)
+        , config_(config)
+        , cadUs_(0)
+        , periodUs_(0)
+        , listenUs_(0)
+        , state_(CadWakeState::OFF)
+        , sinceUs_(0)
+        , nextScanUs_(0)
+        , untilUs_(0)
+        , lastReceived_(0)
+        , heardFrame_(false)
+        , scanning_(false)
+        , cadDone_(false)
+        , stats_{}
+    {
+        setModulation(loraModulation(9, 125000));
+    }
+
+    void CadWake::setModulation(const LoRaModulation& modulation) {
+        const uint64_t symbolUs = symbolTimeUs(modulation.sf, modulation.bwHz);
+        const uint64_t preambleUs = symbolUs * modulation.preamble;
+        cadUs_ = cadTimeUs(modulation);
+        const uint64_t needUs = cadUs_ + symbolUs * config_.lockSymbols + config_.latencyUs;
+        periodUs_ = preambleUs > needUs ? static_cast<uint32_t>(preambleUs - needUs) : 0;
+        listenUs_ = timeOnAirUs(modulation, MAX_FRAME_SIZE) + config_.latencyUs;
+    }
+
+    bool CadWake::begin(uint32_t nowUs) {
+        if (periodUs_ == 0) {
+            end();
+            return false;
+        }
+        receiver_.suspend();
+        sleepUntil(nowUs, nowUs);
+        return true;
+    }
+
+    void CadWake::end() {
+        scanning_.store(false, std::memory_order_release);
+        state_ = CadWakeState::OFF;
+        if (!receiver_.isActive()) {
+            receiver_.resume();
+        }
+    }
+
+    void CadWake::enter(CadWakeState state, uint32_t nowUs) {
+        const uint32_t spentUs = nowUs - sinceUs_;
+        switch (state_) {
+            case CadWakeState::SLEEP: stats_.sleepUs += spentUs; break;
+            case CadWakeState::SCAN: stats_.scanUs += spentUs; break;
+            case CadWakeState::LISTEN: stats_.listenUs += spentUs; break;
+            default: break;
+        }
+        state_ = state;
+        sinceUs_ = nowUs;
+    }
+
+    void CadWake::sleepUntil(uint32_t scanUs, uint32_t nowUs) {
+        nextScanUs_ = scanUs;
+        enter(CadWakeState::SLEEP, nowUs);
+        radio_.sleep();
+    }
+
+    void CadWake::listen(uint32_t nowUs) {
+        enter(CadWakeState::LISTEN, nowUs);
+        untilUs_ = nowUs + listenUs_;
+        lastReceived_ = receiver_.getStats().received;
+        heardFrame_ = false;
+    }
+
+    void CadWake::poll(uint32_t nowUs) {
+        if ((state_ == CadWakeState::SLEEP || state_ == CadWakeState::SCAN) && receiver_.isActive()) {
+            // The transmit path resumed RX after a frame: hold it for a reply
+            scanning_.store(false, std::memory_order_release);
+            listen(nowUs);
+            return;
+        }
+        switch (state_) {
+            case CadWakeState::SLEEP:
+                if (!reached(nowUs, nextScanUs_)) {
+                    return;
+                }
+                cadDone_.store(false, std::memory_order_relaxed);
+                scanning_.store(true, std::memory_order_release);
+                enter(CadWakeState::SCAN, nowUs);
+                stats_.scans++;
+                if (radio_.startChannelScan() != RadioStatus::OK) {
+                    // Count it as a missed scan and keep the rhythm
+                    scanning_.store(false, std::memory_order_release);
+                    stats_.scanTimeouts++;
+                    sleepUntil(nextScanUs_ + periodUs_, nowUs);
+                }
+                return;
+
+            case CadWakeState::SCAN: {
+                const bool done = cadDone_.load(std::memory_order_acquire);
+                if (!done && nowUs - sinceUs_ < 4 * cadUs_ + config_.latencyUs) {
+                    return;
+                }
+                scanning_.store(false, std::memory_order_release);
+                if (!done) {
+                    stats_.scanTimeouts++;
+                } else if (radio_.getChannelScanResult() == RadioStatus::LORA_DETECTED) {
+                    stats_.wakes++;
+                    listen(nowUs);
+                    receiver_.resume();
+                    return;
+                }
+                // Scans stay on the grid so the worst-case gap is one period
+                uint32_t next = nextScanUs_ + periodUs_;
+                while (reached(nowUs, next)) {
+                    next += periodUs_;
+                }
+                sleepUntil(next, nowUs);
+                return;
+            }
+
+            case CadWakeState::LISTEN: {
+                const uint32_t received = receiver_.getStats().received;
+                if (received != lastReceived_) {
+                    stats_.frames += received - lastReceived_;
+                    lastReceived_ = received;
+                    heardFrame_ = true;
+                }
+                // The next frame has a long preamble too, so a scan catches it
+                if ((!heardFrame_ && !reached(nowUs, untilUs_)) || receiver_.available()) {
+                    return;     // Let the caller drain before the radio sleeps
+                }
+                if (!heardFrame_) {
+                    stats_.idleWakes++;
+                }
+                receiver_.suspend();
+                sleepUntil(nowUs + periodUs_, nowUs);
+                return;
+            }
+
+            default:
+                return;
+        }
+    }
+}
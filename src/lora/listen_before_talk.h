@@ -0,0 +1,176 @@
+#pragma once
+
+#include "airtime.h"
+#include "radio_driver.h"
+#include "rx_engine.h"
+#include "xorshift.h"
+#include <stdint.h>
+#include <cstddef>
+#include <atomic>
+
+// Channel activity detection (CAD) on the SX1262: listen-before-talk for
+// the transmit path and a low-power wake mode for receivers
+//
+// A CAD listens for LoRa chirps for CAD_SYMBOLS symbols and raises CadDone
+// on DIO1. It takes about half a symbol more to process. It picks up a
+// preamble reliably and the payload less so (AN1200.85).
+//
+// ListenBeforeTalk is the backoff policy TxScheduler runs before each frame.
+// A clear scan sends at once. A busy scan draws a backoff of 1..2^e slots,
+// where a slot is one CAD plus the CAD-to-TX turnaround. e starts at
+// minWindowExp, grows by one per busy scan up to maxWindowExp, and drops
+// back after a clear scan. After maxAttempts busy scans in a row the frame
+// goes out anyway, so a jammed channel delays frames but never wedges the
+// queue. The radio listens while it waits, so the frame that made the
+// channel busy is still received.
+//
+// CadWake lets a receiver keep the radio asleep instead of in continuous RX.
+// It wakes for one CAD every periodUs(). Senders must use a preamble longer
+// than the period, so every preamble spans a whole scan. After the scan
+// there still has to be enough preamble for RX to sync:
+//
+//   period = preamble - CAD - lockSymbols symbols - latencyUs
+//
+// When a scan hears chirps, the receiver switches to continuous RX until a
+// frame arrives, or for listenUs() (the longest frame) if none does. Then it
+// goes back to sleep: the next frame has a long preamble too, so the next
+// scans catch it. A preamble too short for any period leaves the receiver
+// in continuous RX. When the transmit path resumes RX after a frame of its
+// own, the receiver holds a listen window too, for the reply.
+namespace LoRaLink {
+
+    constexpr uint8_t CAD_SYMBOLS = 2;          // RadioLib's default CAD length
+
+    // One CAD: its symbols plus about half a symbol of processing
+    constexpr uint32_t cadTimeUs(const LoRaModulation& modulation) {
+        return symbolTimeUs(modulation.sf, modulation.bwHz) * (2u * CAD_SYMBOLS + 1u) / 2u;
+    }
+
+    struct LbtConfig {
+        uint8_t minWindowExp;       // Backoff window after the first busy scan: 2^exp slots
+        uint8_t maxWindowExp;
+        uint8_t maxAttempts;        // Busy scans in a row before sending regardless
+        uint32_t turnaroundUs;      // CadDone to the first TX symbol
+    };
+
+    struct LbtStats {
+        uint32_t scans;
+        uint32_t clear;
+        uint32_t busy;
+        uint32_t forced;            // Sent after maxAttempts busy scans
+        uint64_t backoffUs;         // Total backoff drawn
+    };
+
+    class ListenBeforeTalk {
+    public:
+        static LbtConfig defaultConfig();
+
+        ListenBeforeTalk();
+        explicit ListenBeforeTalk(const LbtConfig& config);
+
+        void setModulation(const LoRaModulation& modulation);
+        // Backoff draws differ per node; nodes seeded alike back off in step
+        void seed(uint32_t seed) { rng_.seed(seed); }
+
+        // Channel clear: transmit now
+        void onClear();
+        // Chirps heard: scan again after a random backoff. False after
+        // maxAttempts busy scans in a row: transmit now.
+        bool onBusy(uint32_t nowUs);
+
+        // The backoff is over
+        bool ready(uint32_t nowUs) const { return static_cast<int32_t>(nowUs - readyUs_) >= 0; }
+        uint32_t readyUs() const { return readyUs_; }
+        uint32_t cadUs() const { return cadUs_; }
+        uint32_t slotUs() const { return cadUs_ + config_.turnaroundUs; }
+
+        const LbtStats& getStats() const { return stats_; }
+        void resetStats() { stats_ = {}; }
+
+    private:
+        LbtConfig config_;
+        uint32_t cadUs_;
+        uint32_t readyUs_;
+        uint8_t windowExp_;
+        uint8_t attempts_;          // Busy scans for the frame at hand
+        Xorshift32 rng_;
+        LbtStats stats_;
+    };
+
+    enum class CadWakeState {
+        OFF,            // Continuous RX (not started, or preamble too short)
+        SLEEP,
+        SCAN,
+        LISTEN          // Continuous RX after a scan heard chirps
+    };
+
+    struct CadWakeConfig {
+        uint8_t lockSymbols;        // Preamble RX still needs after the switch
+        uint32_t latencyUs;         // CadDone to RX, main loop pass included
+    };
+
+    struct CadWakeStats {
+        uint32_t scans;
+        uint32_t wakes;             // Scans that heard chirps
+        uint32_t idleWakes;         // Listen windows that ended without a frame
+        uint32_t frames;            // Frames received while awake
+        uint32_t scanTimeouts;      // No CadDone (TX took the radio, or a lost edge)
+        uint64_t sleepUs;           // Radio time per state, for the power estimate
+        uint64_t scanUs;
+        uint64_t listenUs;
+    };
+
+    class CadWake {
+    public:
+        static CadWakeConfig defaultConfig();
+
+        CadWake(IRadioDriver& radio, RxEngine& receiver);
+        CadWake(IRadioDriver& radio, RxEngine& receiver, const CadWakeConfig& config);
+
+        // Period and listen window follow the preamble length in the modulation
+        void setModulation(const LoRaModulation& modulation);
+
+        // Start duty cycling; false, and continuous RX, when the preamble is too short
+        bool begin(uint32_t nowUs);
+        // Back to continuous RX
+        void end();
+
+        // ISR context: latch CadDone while a scan is running
+        void onDio1(uint32_t /*timestampUs*/) {
+            if (scanning_.load(std::memory_order_relaxed)) {
+                cadDone_.store(true, std::memory_order_release);
+            }
+        }
+
+        // Main loop; not while the transmit path holds the radio
+        void poll(uint32_t nowUs);
+
+        CadWakeState state() const { return state_; }
+        uint32_t periodUs() const { return periodUs_; }
+        uint32_t listenUs() const { return listenUs_; }
+        const CadWakeStats& getStats() const { return stats_; }
+        void resetStats() { stats_ = {}; }
+
+    private:
+        IRadioDriver& radio_;
+        RxEngine& receiver_;
+        CadWakeConfig config_;
+        uint32_t cadUs_;
+        uint32_t periodUs_;
+        uint32_t listenUs_;
+
+        CadWakeState state_;
+        uint32_t sinceUs_;          // Entered the current state
+        uint32_t nextScanUs_;
+        uint32_t untilUs_;          // End of the listen window
+        uint32_t lastReceived_;     // RxEngine frame count when the window (re)started
+        bool heardFrame_;
+        std::atomic<bool> scanning_;
+        std::atomic<bool> cadDone_;
+        CadWakeStats stats_;
+
+        void enter(CadWakeState state, uint32_t nowUs);
+        void listen(uint32_t nowUs);
+        void sleepUntil(uint32_t scanUs, uint32_t nowUs);
+    };
+}
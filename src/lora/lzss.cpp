@@ -0,0 +1,278 @@
+#include "lzss.h"
+#include "frame_codec.h"
+#include <cstring>
+
+namespace LoRaLink {
+
+    namespace {
+        constexpr uint32_t HASH_BITS = 14;
+        constexpr uint16_t WINDOW_MASK = LZSS_WINDOW_SIZE - 1;
+
+        inline uint32_t prefixHash(const uint8_t* p) {
+            const uint32_t v = static_cast<uint32_t>(p[0]) << 16 | static_cast<uint32_t>(p[1]) << 8 | p[2];
+            return (v * 2654435761u) >> (32 - HASH_BITS);
+        }
+    }
+
+    size_t encodeLzssHeader(const LzssHeader& header, uint8_t* out, size_t outSize) {
+        if (out == nullptr || outSize < LZSS_HEADER_SIZE) {
+            return 0;
+        }
+        memcpy(out, LZSS_MAGIC, sizeof(LZSS_MAGIC));
+        Wire::putU32(out + 4, header.size);
+        memcpy(out + 8, header.sha256, Sha256::DIGEST_SIZE);
+        return LZSS_HEADER_SIZE;
+    }
+
+    bool decodeLzssHeader(const uint8_t* data, size_t length, LzssHeader& header) {
+        if (!isLzssStream(data, length) || length < LZSS_HEADER_SIZE) {
+            return false;
+        }
+        header.size = Wire::getU32(data + 4);
+        memcpy(header.sha256, data + 8, Sha256::DIGEST_SIZE);
+        return true;
+    }
+
+    bool isLzssStream(const uint8_t* data, size_t length) {
+        return data != nullptr && length >= sizeof(LZSS_MAGIC) &&
+               memcmp(data, LZSS_MAGIC, sizeof(LZSS_MAGIC)) == 0;
+    }
+
+    std::vector<uint8_t> LzssEncoder::compress(const uint8_t* data, size_t size) {
+        out_.assign(LZSS_HEADER_SIZE, 0);
+        bits_ = 0;
+        bitCount_ = 0;
+
+        LzssHeader header;
+        header.size = static_cast<uint32_t>(size);
+        Sha256::hash(data, size, header.sha256);
+        encodeLzssHeader(header, out_.data(), out_.size());
+
+        std::vector<int32_t> head(static_cast<size_t>(1) << HASH_BITS, -1);
+        std::vector<int32_t> chain(size, -1);
+        auto insert = [&](size_t p) {
+            if (p + LZSS_MIN_MATCH <= size) {
+                const uint32_t h = prefixHash(data + p);
+                chain[p] = head[h];
+                head[h] = static_cast<int32_t>(p);
+            }
+        };
+
+        size_t pos = 0;
+        while (pos < size) {
+            size_t bestLength = 0;
+            size_t bestDistance = 0;
+            if (pos + LZSS_MIN_MATCH <= size) {
+                int32_t p = head[prefixHash(data + pos)];
+                for (size_t tries = 0; p >= 0 && tries < MAX_CHAIN; ++tries, p = chain[p]) {
+                    const size_t distance = pos - static_cast<size_t>(p);
+                    if (distance > LZSS_WINDOW_SIZE) {
+                        break;
+                    }
+                    size_t n = 0;
+                    while (n < LZSS_MAX_MATCH && pos + n < size && data[p + n] == data[pos + n]) {
+                        n++;
+                    }
+                    if (n > bestLength) {
+                        bestLength = n;
+                        bestDistance = distance;
+                        if (n == LZSS_MAX_MATCH) {
+                            break;
+                        }
+                    }
+                }
+            }
+
+            if (bestLength >= LZSS_MIN_MATCH) {
+                putBits(0, 1);
+                putBits(static_cast<uint32_t>(bestDistance - 1), LZSS_WINDOW_BITS);
+                putBits(static_cast<uint32_t>(bestLength - LZSS_MIN_MATCH), LZSS_LENGTH_BITS);
+                for (size_t i = 0; i < bestLength; ++i) {
+                    insert(pos + i);
+                }
+                pos += bestLength;
+            } else {
+                putBits(1, 1);
+                putBits(data[pos], 8);
+                insert(pos);
+                pos++;
+            }
+        }
+        if (bitCount_ > 0) {
+            out_.push_back(static_cast<uint8_t>(bits_ << (8 - bitCount_)));
+        }
+        return out_;
+    }
+
+    void LzssEncoder::putBits(uint32_t value, uint8_t count) {
+        bits_ = (bits_ << count) | (value & ((1u << count) - 1));
+        bitCount_ += count;
+        while (bitCount_ >= 8) {
+            bitCount_ -= 8;
+            out_.push_back(static_cast<uint8_t>(bits_ >> bitCount_));
+        }
+        bits_ &= (1u << bitCount_) - 1;
+    }
+
+    LzssDecoder::LzssDecoder() {
+        reset();
+    }
+
+    void LzssDecoder::reset() {
+        memset(window_, 0, sizeof(window_));
+        head_ = 0;
+        bits_ = 0;
+        bitCount_ = 0;
+        state_ = State::TAG;
+        copyDistance_ = 0;
+        copyLeft_ = 0;
+    }
+
+    size_t LzssDecoder::decode(const uint8_t* in, size_t inSize, size_t& consumed, uint8_t* out, size_t outSize) {
+        size_t written = 0;
+        consumed = 0;
+        for (;;) {
+            while (copyLeft_ > 0 && written < outSize) {
+                put(window_[(head_ - copyDistance_) & WINDOW_MASK], out, written);
+                copyLeft_--;
+            }
+            if (written == outSize) {
+                return written;
+            }
+
+            const uint8_t need = state_ == State::TAG ? 1
+                               : state_ == State::LITERAL ? 8
+                               : LZSS_WINDOW_BITS + LZSS_LENGTH_BITS;
+            while (bitCount_ < need && consumed < inSize) {
+                bits_ = (bits_ << 8) | in[consumed++];
+                bitCount_ += 8;
+            }
+            if (bitCount_ < need) {
+                return written;
+            }
+            bitCount_ -= need;
+            const uint32_t value = (bits_ >> bitCount_) & ((1u << need) - 1);
+            bits_ &= (1u << bitCount_) - 1;
+
+            switch (state_) {
+                case State::TAG:
+                    state_ = value ? State::LITERAL : State::COPY;
+                    break;
+                case State::LITERAL:
+                    put(static_cast<uint8_t>(value), out, written);
+                    state_ = State::TAG;
+                    break;
+                case State::COPY:
+                    copyDistance_ = static_cast<uint16_t>((value >> LZSS_LENGTH_BITS) + 1);
+                    copyLeft_ = static_cast<uint8_t>((value & ((1u << LZSS_LENGTH_BITS) - 1)) + LZSS_MIN_MATCH);
+                    state_ = State::TAG;
+                    break;
+            }
+        }
+    }
+
+    void LzssDecoder::put(uint8_t value, uint8_t* out, size_t& written) {
+        window_[head_] = value;
+        head_ = (head_ + 1) & WINDOW_MASK;
+        out[written++] = value;
+    }
+
+    LzssSource::LzssSource(IByteSource& compressed, LzssDecoder& decoder)
+        : in_(compressed)
+        , decoder_(decoder)
+        , header_{}
+        , produced_(0)
+        , inPos_(0)
+        , inLength_(0)
+        , inBuffer_{}
+    {
+    }
+
+    LzssResult LzssSource::begin() {
+        uint8_t raw[LZSS_HEADER_SIZE];
+        header_ = {};
+        produced_ = 0;
+        inPos_ = 0;
+        inLength_ = 0;
+        decoder_.reset();
+        if (!in_.read(raw, sizeof(raw))) {
+            return LzssResult::READ_ERROR;
+        }
+        return decodeLzssHeader(raw, sizeof(raw), header_) ? LzssResult::OK : LzssResult::BAD_HEADER;
+    }
+
+    bool LzssSource::read(uint8_t* data, size_t length) {
+        if (length > remaining()) {
+            return false;
+        }
+        while (length > 0) {
+            if (inPos_ == inLength_) {
+                size_t n = in_.remaining();
+                if (n > sizeof(inBuffer_)) {
+                    n = sizeof(inBuffer_);
+                }
+                if (n == 0 || !in_.read(inBuffer_, n)) {
+                    return false;
+                }
+                inPos_ = 0;
+                inLength_ = n;
+            }
+            size_t consumed;
+            const size_t n = decoder_.decode(inBuffer_ + inPos_, inLength_ - inPos_, consumed, data, length);
+            inPos_ += consumed;
+            produced_ += n;
+            data += n;
+            length -= n;
+        }
+        return true;
+    }
+
+    LzssResult LzssInflater::inflate(LzssSource& source, IUpdateBackend& target, size_t targetLimit) {
+        const LzssHeader header = source.getHeader();
+        if (header.size == 0 || header.size > targetLimit) {
+            return LzssResult::TOO_LARGE;
+        }
+
+        for (size_t offset = 0; offset < header.size; offset += sizeof(buffer_)) {
+            size_t n = header.size - offset;
+            if (n > sizeof(buffer_)) {
+                n = sizeof(buffer_);
+            }
+            if (!source.read(buffer_, n)) {
+                return LzssResult::CORRUPT;
+            }
+            if (!target.write(offset, buffer_, n)) {
+                return LzssResult::WRITE_ERROR;
+            }
+        }
+
+        // Hash what actually landed in flash, as OtaReceiver::finish() does
+        Sha256 sha;
+        for (size_t offset = 0; offset < header.size; offset += sizeof(buffer_)) {
+            size_t n = header.size - offset;
+            if (n > sizeof(buffer_)) {
+                n = sizeof(buffer_);
+            }
+            if (!target.read(offset, buffer_, n)) {
+                return LzssResult::READ_ERROR;
+            }
+            sha.update(buffer_, n);
+        }
+        uint8_t digest[Sha256::DIGEST_SIZE];
+        sha.finish(digest);
+        return memcmp(digest, header.sha256, sizeof(digest)) == 0 ? LzssResult::OK : LzssResult::TARGET_MISMATCH;
+    }
+
+    const char* LzssInflater::resultToString(LzssResult result) {
+        switch (result) {
+            case LzssResult::OK: return "OK";
+            case LzssResult::BAD_HEADER: return "BAD_HEADER";
+            case LzssResult::TOO_LARGE: return "TOO_LARGE";
+            case LzssResult::CORRUPT: return "CORRUPT";
+            case LzssResult::READ_ERROR: return "READ_ERROR";
+            case LzssResult::WRITE_ERROR: return "WRITE_ERROR";
+            case LzssResult::TARGET_MISMATCH: return "TARGET_MISMATCH";
+            default: return "UNKNOWN";
+        }
+    }
+}
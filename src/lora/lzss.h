@@ -0,0 +1,124 @@
+#pragma once
+
+#include "ota_receiver.h"
+#include <stdint.h>
+#include <cstddef>
+#include <vector>
+
+// LZSS compression for OTA transfers (heatshrink-style bit stream)
+//
+// The stream is a header followed by tokens packed MSB first:
+//
+//   1 + 8 bits                  literal byte
+//   0 + WINDOW_BITS + LENGTH_BITS  copy (length - MIN_MATCH) bytes from
+//                               (distance - 1) back in the output
+//
+// The header carries the uncompressed size and SHA-256, so the decoder
+// knows where to stop (the last byte is zero-padded) and the result can be
+// checked once written. The decoder keeps only the 2 KB window and its bit
+// state. It takes any amount of input per call and stops when the output
+// buffer is full, so it decodes straight into 256-byte flash writes.
+namespace LoRaLink {
+
+    constexpr uint8_t LZSS_MAGIC[4] = { 'L', 'Z', 'S', '1' };
+    constexpr size_t LZSS_HEADER_SIZE = 4 + 4 + Sha256::DIGEST_SIZE;
+    constexpr uint8_t LZSS_WINDOW_BITS = 11;
+    constexpr uint8_t LZSS_LENGTH_BITS = 4;
+    constexpr size_t LZSS_WINDOW_SIZE = static_cast<size_t>(1) << LZSS_WINDOW_BITS;
+    constexpr size_t LZSS_MIN_MATCH = 3;
+    constexpr size_t LZSS_MAX_MATCH = LZSS_MIN_MATCH + (1u << LZSS_LENGTH_BITS) - 1;
+
+    struct LzssHeader {
+        uint32_t size;          // Uncompressed bytes
+        uint8_t sha256[Sha256::DIGEST_SIZE];
+    };
+
+    size_t encodeLzssHeader(const LzssHeader& header, uint8_t* out, size_t outSize);
+    bool decodeLzssHeader(const uint8_t* data, size_t length, LzssHeader& header);
+    // True if data starts with the LZSS magic
+    bool isLzssStream(const uint8_t* data, size_t length);
+
+    // Host side (scripts, tests): greedy matching over hash chains
+    class LzssEncoder {
+    public:
+        static constexpr size_t MAX_CHAIN = 128;    // Candidates tried per position
+
+        std::vector<uint8_t> compress(const uint8_t* data, size_t size);
+
+    private:
+        std::vector<uint8_t> out_;
+        uint32_t bits_;
+        uint8_t bitCount_;
+
+        void putBits(uint32_t value, uint8_t count);
+    };
+
+    // Streaming decoder; knows nothing about the header
+    class LzssDecoder {
+    public:
+        LzssDecoder();
+
+        void reset();
+        // Decodes from in until out holds outSize bytes or the input runs out.
+        // consumed is set to the input bytes used; returns the bytes written.
+        size_t decode(const uint8_t* in, size_t inSize, size_t& consumed, uint8_t* out, size_t outSize);
+
+    private:
+        enum class State : uint8_t { TAG, LITERAL, COPY };
+
+        uint8_t window_[LZSS_WINDOW_SIZE];
+        uint16_t head_;
+        uint32_t bits_;
+        uint8_t bitCount_;
+        State state_;
+        uint16_t copyDistance_;
+        uint8_t copyLeft_;
+
+        void put(uint8_t value, uint8_t* out, size_t& written);
+    };
+
+    enum class LzssResult {
+        OK,
+        BAD_HEADER,         // Not an LZSS stream, or truncated header
+        TOO_LARGE,          // Output does not fit in front of the staged stream
+        CORRUPT,            // Ran out of input before the header size
+        READ_ERROR,
+        WRITE_ERROR,
+        TARGET_MISMATCH     // Decompressed image hash differs from the header
+    };
+
+    // IByteSource that decompresses another source. begin() reads the header;
+    // remaining() then counts uncompressed bytes. The decoder (and its window)
+    // is borrowed so the source itself can live on the stack.
+    class LzssSource : public IByteSource {
+    public:
+        LzssSource(IByteSource& compressed, LzssDecoder& decoder);
+
+        LzssResult begin();
+        const LzssHeader& getHeader() const { return header_; }
+
+        bool read(uint8_t* data, size_t length) override;
+        size_t remaining() const override { return header_.size - produced_; }
+
+    private:
+        IByteSource& in_;
+        LzssDecoder& decoder_;
+        LzssHeader header_;
+        size_t produced_;
+        size_t inPos_;
+        size_t inLength_;
+        uint8_t inBuffer_[64];
+    };
+
+    // Writes a whole decompressed image (source already begun) into a backend
+    // from offset 0, then reads it back and checks the header hash
+    class LzssInflater {
+    public:
+        LzssResult inflate(LzssSource& source, IUpdateBackend& target, size_t targetLimit);
+
+        static const char* resultToString(LzssResult result);
+
+    private:
+        uint8_t buffer_[256];
+    };
+}
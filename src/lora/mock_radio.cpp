@@ -0,0 +1,225 @@
+#include "mock_radio.h"
+#include <cstring>
+
+namespace LoRaLink {
+
+    namespace {
+        // SX1262 costs behind the config calls (datasheet, RadioLib 6.x call sequences)
+        constexpr uint32_t COMMAND_US = 20;             // SPI transfer plus BUSY at 8 MHz
+        constexpr uint32_t RESET_US = 4500;             // NRESET pulse and cold start
+        constexpr uint32_t TCXO_START_US = 5000;        // DIO3 TCXO start-up delay
+        constexpr uint32_t CALIBRATE_ALL_US = 3500;     // Calibrate(0x7F): RC, PLL, ADC, image
+        constexpr uint32_t CALIBRATE_IMAGE_US = 1000;   // CalibrateImage for one band
+        // begin(): standby, packet type, buffer base, fallback mode, CAD params,
+        // IRQ clear and mask, calibrate, TCXO control, clear errors, calibrate,
+        // modulation x3, sync word, OCP, packet params, DIO2, image calibration,
+        // RF frequency, output power x4; then setDio2AsRfSwitch() and setCRC()
+        constexpr uint32_t BEGIN_COMMANDS = 29;
+        constexpr uint32_t POWER_COMMANDS = 4;          // Read OCP, PA config, TX params, restore OCP
+    }
+
+    MockRadio::MockRadio()
+        : mode_(RadioMode::STANDBY)
+        , fifo_{}
+        , fifoLength_(0)
+        , unread_(false)
+        , crcError_(false)
+        , rssi_(0.0f)
+        , snr_(0.0f)
+        , txFrame_{}
+        , txLength_(0)
+        , nextTxStatus_(RadioStatus::OK)
+        , cadResult_(RadioStatus::CHANNEL_FREE)
+        , dutyRxUs_(0)
+        , dutySleepUs_(0)
+        , profile_{}
+        , nextConfigStatus_(RadioStatus::OK)
+        , stats_{}
+    {
+    }
+
+    bool MockRadio::deliver(const uint8_t* data, size_t length, uint32_t timestampUs,
+                            float rssi, float snr, bool crcError) {
+        const bool listening = mode_ == RadioMode::RECEIVE || mode_ == RadioMode::RECEIVE_DUTY_CYCLE;
+        if (!listening || data == nullptr || length == 0 || length > MAX_FRAME_SIZE) {
+            stats_.missedNotListening++;
+            return false;
+        }
+        if (mode_ == RadioMode::RECEIVE_DUTY_CYCLE) {
+            mode_ = RadioMode::STANDBY;
+        }
+
+        if (unread_) {
+            stats_.overwritten++;
+        }
+        memcpy(fifo_, data, length);
+        fifoLength_ = length;
+        unread_ = true;
+        crcError_ = crcError;
+        rssi_ = rssi;
+        snr_ = snr;
+        stats_.delivered++;
+
+        if (dio1_) {
+            dio1_(timestampUs);
+        }
+        return true;
+    }
+
+    int MockRadio::startReceive() {
+        mode_ = RadioMode::RECEIVE;
+        stats_.startReceiveCalls++;
+        return RadioStatus::OK;
+    }
+
+    int MockRadio::readPacket(uint8_t* buffer, size_t bufferSize, size_t& length) {
+        stats_.reads++;
+        length = 0;
+        if (!unread_ || buffer == nullptr) {
+            return RadioStatus::ERR_RX_TIMEOUT;
+        }
+
+        unread_ = false;
+        length = fifoLength_ < bufferSize ? fifoLength_ : bufferSize;
+        memcpy(buffer, fifo_, length);
+        return crcError_ ? RadioStatus::ERR_CRC_MISMATCH : RadioStatus::OK;
+    }
+
+    int MockRadio::startTransmit(const uint8_t* data, size_t length) {
+        if (nextTxStatus_ != RadioStatus::OK) {
+            int st = nextTxStatus_;
+            nextTxStatus_ = RadioStatus::OK;
+            return st;
+        }
+        if (data == nullptr || length == 0 || length > MAX_FRAME_SIZE) {
+            return RadioStatus::ERR_PACKET_TOO_LONG;
+        }
+
+        memcpy(txFrame_, data, length);
+        txLength_ = length;
+        mode_ = RadioMode::TRANSMIT;
+        stats_.transmits++;
+        if (onTransmit_) {
+            onTransmit_(txFrame_, txLength_);
+        }
+        return RadioStatus::OK;
+    }
+
+    bool MockRadio::completeTransmit(uint32_t timestampUs) {
+        if (mode_ != RadioMode::TRANSMIT) {
+            return false;
+        }
+        if (dio1_) {
+            dio1_(timestampUs);
+        }
+        return true;
+    }
+
+    int MockRadio::finishTransmit() {
+        mode_ = RadioMode::STANDBY;
+        return RadioStatus::OK;
+    }
+
+    int MockRadio::standby() {
+        mode_ = RadioMode::STANDBY;
+        stats_.standbyCalls++;
+        return RadioStatus::OK;
+    }
+
+    int MockRadio::startChannelScan() {
+        mode_ = RadioMode::CAD;
+        stats_.scans++;
+        if (onScan_) {
+            onScan_();
+        }
+        return RadioStatus::OK;
+    }
+
+    bool MockRadio::completeChannelScan(bool detected, uint32_t timestampUs) {
+        if (mode_ != RadioMode::CAD) {
+            return false;
+        }
+        // The SX1262 drops back to standby after CadDone
+        mode_ = RadioMode::STANDBY;
+        cadResult_ = detected ? RadioStatus::LORA_DETECTED : RadioStatus::CHANNEL_FREE;
+        if (dio1_) {
+            dio1_(timestampUs);
+        }
+        return true;
+    }
+
+    int MockRadio::sleep() {
+        mode_ = RadioMode::SLEEP;
+        stats_.sleepCalls++;
+        return RadioStatus::OK;
+    }
+
+    int MockRadio::startReceiveDutyCycle(uint32_t rxUs, uint32_t sleepUs) {
+        mode_ = RadioMode::RECEIVE_DUTY_CYCLE;
+        dutyRxUs_ = rxUs;
+        dutySleepUs_ = sleepUs;
+        stats_.dutyCycleCalls++;
+        return RadioStatus::OK;
+    }
+
+    int MockRadio::config(uint32_t commands, uint32_t busyUs) {
+        stats_.spiCommands += commands;
+        stats_.busyUs += commands * COMMAND_US + busyUs;
+        const int st = nextConfigStatus_;
+        nextConfigStatus_ = RadioStatus::OK;
+        return st;
+    }
+
+    int MockRadio::reinit(const ConfigPayload& profile) {
+        stats_.resets++;
+        stats_.calibrations += 3;   // Twice all blocks, then the image for the band
+        const int st = config(BEGIN_COMMANDS, RESET_US + TCXO_START_US + 2 * CALIBRATE_ALL_US + CALIBRATE_IMAGE_US);
+        if (st == RadioStatus::OK) {
+            profile_ = profile;
+            mode_ = RadioMode::STANDBY;
+        }
+        return st;
+    }
+
+    int MockRadio::setFrequency(float freqMHz, bool calibrateImage) {
+        stats_.calibrations += calibrateImage ? 1 : 0;
+        const int st = config(calibrateImage ? 2 : 1, calibrateImage ? CALIBRATE_IMAGE_US : 0);
+        if (st == RadioStatus::OK) {
+            profile_.freqMHz = freqMHz;
+        }
+        return st;
+    }
+
+    // Each modulation setter resends SetModulationParams with all three values
+    int MockRadio::setBandwidth(float bwKHz) {
+        const int st = config(1, 0);
+        if (st == RadioStatus::OK) {
+            profile_.bwKHz = bwKHz;
+        }
+        return st;
+    }
+
+    int MockRadio::setSpreadingFactor(uint8_t sf) {
+        const int st = config(1, 0);
+        if (st == RadioStatus::OK) {
+            profile_.sf = sf;
+        }
+        return st;
+    }
+
+    int MockRadio::setCodingRate(uint8_t cr) {
+        const int st = config(1, 0);
+        if (st == RadioStatus::OK) {
+            profile_.cr = cr;
+        }
+        return st;
+    }
+
+    int MockRadio::setOutputPower(int8_t dBm) {
+        const int st = config(POWER_COMMANDS, 0);
+        if (st == RadioStatus::OK) {
+            profile_.txPower = dBm;
+        }
+        return st;
+    }
+}
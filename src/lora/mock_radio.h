@@ -0,0 +1,139 @@
+#pragma once
+
+#include "radio_driver.h"
+#include "frame_codec.h"
+#include <stdint.h>
+#include <cstddef>
+#include <functional>
+
+// Host-side SX1262 stand-in for native tests and simulations
+//
+// Models the parts of the radio the link engines depend on: a single-packet
+// FIFO that the next reception overwrites, a DIO1 line that fires on RxDone,
+// TxDone and CadDone, and the fact that nothing is heard outside receive mode.
+// In RX duty cycle every packet is assumed to meet an RX window (the preamble
+// rule in rx_power.h), and the radio stops listening after it.
+//
+// The IRadioConfig side counts the SPI commands each RadioLib 6.x setter
+// sends to the SX1262 and adds up a modelled busy time: SPI transfer per
+// command plus the datasheet reset, TCXO and calibration times. reinit()
+// stands in for radio.begin() followed by setDio2AsRfSwitch() and setCRC().
+namespace LoRaLink {
+
+    enum class RadioMode {
+        STANDBY,
+        RECEIVE,
+        TRANSMIT,
+        CAD,                        // Channel scan until completeChannelScan()
+        SLEEP,
+        RECEIVE_DUTY_CYCLE          // Hears one packet, then standby
+    };
+
+    struct MockRadioStats {
+        uint32_t delivered;         // Frames that reached the FIFO
+        uint32_t missedNotListening;// Frames that arrived outside receive mode
+        uint32_t overwritten;       // FIFO contents replaced before being read
+        uint32_t reads;             // readPacket() calls
+        uint32_t startReceiveCalls;
+        uint32_t standbyCalls;
+        uint32_t transmits;         // startTransmit() calls accepted
+        uint32_t scans;             // startChannelScan() calls
+        uint32_t sleepCalls;
+        uint32_t dutyCycleCalls;    // startReceiveDutyCycle() calls
+        uint32_t spiCommands;       // SX1262 commands sent by config calls
+        uint32_t calibrations;      // Image and full calibrations
+        uint32_t resets;            // reinit() calls
+        uint64_t busyUs;            // Modelled time spent in config calls
+    };
+
+    class MockRadio : public IRadioDriver, public IRadioConfig {
+    public:
+        typedef std::function<void(uint32_t timestampUs)> Dio1Handler;
+        typedef std::function<void(const uint8_t* data, size_t length)> TransmitHandler;
+        typedef std::function<void()> ChannelScanHandler;
+
+        MockRadio();
+
+        // Wire the simulated DIO1 line (plays the role of setDio1Action)
+        void setDio1Handler(Dio1Handler handler) { dio1_ = handler; }
+        // Observe frames handed to startTransmit()
+        void setTransmitHandler(TransmitHandler handler) { onTransmit_ = handler; }
+        // Observe startChannelScan() (a channel model answers with completeChannelScan())
+        void setChannelScanHandler(ChannelScanHandler handler) { onScan_ = handler; }
+
+        // Simulate a frame finishing reception at timestampUs; returns false if unheard
+        bool deliver(const uint8_t* data, size_t length, uint32_t timestampUs,
+                     float rssi = -80.0f, float snr = 8.0f, bool crcError = false);
+
+        // Simulate TxDone for the frame in flight; returns false if not transmitting
+        bool completeTransmit(uint32_t timestampUs);
+        // Make the next startTransmit() fail with the given status
+        void failNextTransmit(int status) { nextTxStatus_ = status; }
+
+        // Simulate CadDone for the scan in progress; returns false if not scanning
+        bool completeChannelScan(bool detected, uint32_t timestampUs);
+
+        const uint8_t* lastTransmit() const { return txFrame_; }
+        size_t lastTransmitLength() const { return txLength_; }
+
+        // Full reset and reconfiguration, as radio.begin() does
+        int reinit(const ConfigPayload& profile);
+        // Make the next config call fail with the given status
+        void failNextConfig(int status) { nextConfigStatus_ = status; }
+        const ConfigPayload& profile() const { return profile_; }
+
+        RadioMode getMode() const { return mode_; }
+        bool hasUnreadPacket() const { return unread_; }
+        const MockRadioStats& getStats() const { return stats_; }
+        void resetStats() { stats_ = {}; }
+
+        // IRadioDriver
+        int startReceive() override;
+        int readPacket(uint8_t* buffer, size_t bufferSize, size_t& length) override;
+        float getRSSI() override { return rssi_; }
+        float getSNR() override { return snr_; }
+        int startTransmit(const uint8_t* data, size_t length) override;
+        int finishTransmit() override;
+        int standby() override;
+        int startChannelScan() override;
+        int getChannelScanResult() override { return cadResult_; }
+        int sleep() override;
+        int startReceiveDutyCycle(uint32_t rxUs, uint32_t sleepUs) override;
+        uint32_t dutyCycleRxUs() const { return dutyRxUs_; }
+        uint32_t dutyCycleSleepUs() const { return dutySleepUs_; }
+
+        // IRadioConfig
+        int setFrequency(float freqMHz, bool calibrateImage) override;
+        int setBandwidth(float bwKHz) override;
+        int setSpreadingFactor(uint8_t sf) override;
+        int setCodingRate(uint8_t cr) override;
+        int setOutputPower(int8_t dBm) override;
+
+    private:
+        RadioMode mode_;
+        Dio1Handler dio1_;
+        TransmitHandler onTransmit_;
+        ChannelScanHandler onScan_;
+
+        uint8_t fifo_[MAX_FRAME_SIZE];
+        size_t fifoLength_;
+        bool unread_;
+        bool crcError_;
+        float rssi_;
+        float snr_;
+
+        uint8_t txFrame_[MAX_FRAME_SIZE];
+        size_t txLength_;
+        int nextTxStatus_;
+        int cadResult_;
+        uint32_t dutyRxUs_;
+        uint32_t dutySleepUs_;
+
+        ConfigPayload profile_;
+        int nextConfigStatus_;
+
+        MockRadioStats stats_;
+        // Count commands and busy time; returns the status set by failNextConfig()
+        int config(uint32_t commands, uint32_t busyUs);
+    };
+}
@@ -0,0 +1,73 @@
+#include "mock_update_backend.h"
+#include <cstring>
+
+namespace LoRaLink {
+
+    MockUpdateBackend::MockUpdateBackend(size_t partitionSize)
+        : partitionSize_(partitionSize)
+        , open_(false)
+        , bootable_(false)
+        , failWriteAt_(0)
+        , stats_{}
+    {
+    }
+
+    bool MockUpdateBackend::begin(size_t imageSize) {
+        stats_.begins++;
+        if (imageSize == 0 || imageSize > partitionSize_) {
+            return false;
+        }
+        image_.assign(imageSize, 0xFF);
+        written_.assign(imageSize, false);
+        open_ = true;
+        bootable_ = false;
+        return true;
+    }
+
+    bool MockUpdateBackend::write(size_t offset, const uint8_t* data, size_t length) {
+        stats_.writes++;
+        if (!open_ || data == nullptr || offset + length > image_.size()) {
+            return false;
+        }
+        if (failWriteAt_ != 0 && stats_.writes == failWriteAt_) {
+            failWriteAt_ = 0;
+            return false;
+        }
+
+        bool rewrite = false;
+        for (size_t i = 0; i < length; ++i) {
+            rewrite = rewrite || written_[offset + i];
+            image_[offset + i] &= data[i];      // NOR flash: program clears bits only
+            written_[offset + i] = true;
+        }
+        if (rewrite) {
+            stats_.rewrites++;
+        }
+        return true;
+    }
+
+    bool MockUpdateBackend::read(size_t offset, uint8_t* data, size_t length) {
+        stats_.reads++;
+        if (!open_ || data == nullptr || offset + length > image_.size()) {
+            return false;
+        }
+        memcpy(data, image_.data() + offset, length);
+        return true;
+    }
+
+    bool MockUpdateBackend::finish() {
+        stats_.finishes++;
+        if (!open_) {
+            return false;
+        }
+        open_ = false;
+        bootable_ = true;
+        return true;
+    }
+
+    void MockUpdateBackend::abort() {
+        stats_.aborts++;
+        open_ = false;
+        bootable_ = false;
+    }
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include "ota_receiver.h"
+#include <stdint.h>
+#include <cstddef>
+#include <vector>
+
+// Host-side stand-in for the update partition (native tests and simulations)
+//
+// Behaves like NOR flash: begin() erases to 0xFF and writes can only clear
+// bits, so writing the same region twice with different data is visible.
+namespace LoRaLink {
+
+    struct MockUpdateStats {
+        uint32_t begins;
+        uint32_t writes;
+        uint32_t reads;
+        uint32_t rewrites;      // Writes that touched already programmed bytes
+        uint32_t finishes;
+        uint32_t aborts;
+    };
+
+    class MockUpdateBackend : public IUpdateBackend {
+    public:
+        explicit MockUpdateBackend(size_t partitionSize = 0x300000);
+
+        // Fail the n-th write (1-based) from now; 0 disables
+        void failWriteAfter(uint32_t writes) { failWriteAt_ = writes ? stats_.writes + writes : 0; }
+        // Flip a stored byte as a flash bit error would
+        void corrupt(size_t offset) { if (offset < image_.size()) image_[offset] ^= 0x01; }
+
+        const std::vector<uint8_t>& image() const { return image_; }
+        bool isOpen() const { return open_; }
+        bool isBootable() const { return bootable_; }
+        const MockUpdateStats& getStats() const { return stats_; }
+
+        bool begin(size_t imageSize) override;
+        bool write(size_t offset, const uint8_t* data, size_t length) override;
+        bool read(size_t offset, uint8_t* data, size_t length) override;
+        bool finish() override;
+        void abort() override;
+        size_t capacity() const override { return partitionSize_; }
+
+    private:
+        size_t partitionSize_;
+        std::vector<uint8_t> image_;
+        std::vector<bool> written_;
+        bool open_;
+        bool bootable_;
+        uint32_t failWriteAt_;
+        MockUpdateStats stats_;
+    };
+}
@@ -0,0 +1,508 @@
+#include "net_sim.h"
+#include "link_layer.h"
+#include "mock_radio.h"
+#include "mock_update_backend.h"
+#include <algorithm>
+#include <cmath>
+
+namespace LoRaLink {
+
+    namespace {
+        enum EventType : uint8_t {
+            EVENT_LOOP,
+            EVENT_TX_END,
+            EVENT_CAD_END,
+            EVENT_WARMUP
+        };
+
+        constexpr uint16_t SIM_NODE_ID_BASE = 0x0100;
+        constexpr uint64_t RECENT_KEEP_US = 2000000;   // Longer than any CAD
+        constexpr size_t SIM_PARTITION_BYTES = 4096;    // No OTA runs in the simulation
+
+        // The link layers' clock, set by NetSim::run()
+        uint64_t g_simNowUs = 0;
+        uint32_t simClockUs() { return static_cast<uint32_t>(g_simNowUs); }
+        uint32_t simClockMs() { return static_cast<uint32_t>(g_simNowUs / 1000); }
+
+        float toMw(float dBm) { return std::pow(10.0f, dBm / 10.0f); }
+    }
+
+    // One virtual board: radio, update partition and link layer, as main.cpp
+    // wires them, plus what the air knows about the node
+    struct SimNode : public ILinkListener {
+        NetSim& sim;
+        SimNodeConfig config;
+        MockRadio radio;
+        MockUpdateBackend flash;
+        uint8_t running[64];
+        MemoryImage base;
+        StagedUpdateBackend update;
+        LinkLayer link;
+        TdmaCoordinator tdmaCoordinator;
+        TdmaNode tdmaNode;
+
+        bool booted;
+        bool synced;                // Holds a TDMA slot
+        uint64_t nextPingUs;
+        uint64_t scanStartUs;
+        // Frame being received
+        bool locked;
+        bool lockPing;
+        uint32_t lockTxId;
+        float lockPowerDbm;
+        float interferenceMw;
+
+        SimNode(NetSim& owner, const SimNodeConfig& node, const LinkLayerConfig& linkConfig)
+            : sim(owner)
+            , config(node)
+            , flash(SIM_PARTITION_BYTES)
+            , running{}
+            , base(running, sizeof(running))
+            , update(flash, base)
+            , link(radio, radio, update, linkConfig, simClockUs, simClockMs)
+            , booted(false)
+            , synced(false)
+            , nextPingUs(0)
+            , scanStartUs(0)
+            , locked(false)
+            , lockPing(false)
+            , lockTxId(0)
+            , lockPowerDbm(0.0f)
+            , interferenceMw(0.0f)
+        {
+        }
+
+        bool isSender() const { return config.role == SimRole::SENDER; }
+
+        void onFrame(const FrameView& frame, const RxFrame&, bool) override { sim.onFrame(*this, frame); }
+        void onTxComplete(const TxResult& result) override { sim.onTxComplete(*this, result); }
+        void onQueueFull(FrameType type, uint16_t) override { sim.onQueueFull(*this, type); }
+    };
+
+    float noiseFloorDbm(uint32_t bwHz, float noiseFigureDb) {
+        return -174.0f + 10.0f * std::log10(static_cast<float>(bwHz)) + noiseFigureDb;
+    }
+
+    float demodulationSnrDb(uint8_t sf) {
+        // SX1262 datasheet: -2.5 dB at SF5, 2.5 dB lower per SF step
+        return -2.5f - 2.5f * (static_cast<int>(sf) - 5);
+    }
+
+    NetSimConfig NetSimConfig::defaultConfig() {
+        NetSimConfig config;
+        config.seed = 1;
+        config.profile = { 915.0f, 125.0f, 9, 5, 17 };
+        config.preamble = DEFAULT_PREAMBLE;
+        config.refLossDb = 127.41f;         // LoRaSim (Bor et al.), 868 MHz urban
+        config.refDistanceM = 40.0f;
+        config.pathLossExponent = 2.08f;
+        config.shadowingDb = 0.0f;
+        config.noiseFigureDb = 6.0f;
+        config.captureDb = 6.0f;
+        config.cadPreambleDetect = 0.99f;
+        config.cadPayloadDetect = 0.80f;
+        config.loopUs = 10000;
+        config.lbt = true;
+        config.dutyCyclePermille = 1000;
+        config.tdma = false;
+        return config;
+    }
+
+    NetSim::NetSim(const NetSimConfig& config)
+        : config_(config)
+        , modulation_(loraModulation(config.profile.sf, static_cast<uint32_t>(config.profile.bwKHz * 1000.0f),
+                                     config.profile.cr, config.preamble))
+        , rng_(config.seed * 2654435761u + 1)
+        , order_(0)
+        , nowUs_(0)
+        , nextTxId_(1)
+        , report_{}
+        , warmupUs_(0)
+        , lastBeaconUs_(0)
+        , senders_(0)
+        , synced_(0)
+        , syncedUs_(0)
+        , deferredBase_(0)
+        , forcedBase_(0)
+        , outOfSlotBase_(0)
+    {
+    }
+
+    NetSim::~NetSim() = default;
+
+    uint32_t NetSim::random() {
+        return rng_.next();
+    }
+
+    float NetSim::uniform() {
+        return ((random() & 0xFFFFFF) + 0.5f) / 16777216.0f;
+    }
+
+    float NetSim::gaussian() {
+        // Box-Muller
+        const float u1 = uniform();
+        const float u2 = uniform();
+        return std::sqrt(-2.0f * std::log(u1)) * std::cos(6.2831853f * u2);
+    }
+
+    size_t NetSim::addNode(const SimNodeConfig& node) {
+        LinkLayerConfig link = LinkLayerConfig::defaultConfig();
+        link.nodeId = static_cast<uint16_t>(SIM_NODE_ID_BASE + nodes_.size());
+        link.sender = node.role == SimRole::SENDER;
+        link.preamble = config_.preamble;
+        link.dutyCyclePermille = config_.dutyCyclePermille;
+        link.listenBeforeTalk = config_.lbt;
+        link.pings = node.intervalMs == 0;      // Otherwise runLoop() queues them
+        nodes_.emplace_back(new SimNode(*this, node, link));
+        senders_ += link.sender ? 1 : 0;
+        return nodes_.size() - 1;
+    }
+
+    void NetSim::addSenders(size_t count, float radiusM, uint32_t intervalMs, bool poisson, uint32_t bootSpreadMs) {
+        for (size_t i = 0; i < count; i++) {
+            // Uniform over the area, not the radius
+            const float r = radiusM * std::sqrt(uniform());
+            const float angle = 6.2831853f * uniform();
+            const uint32_t bootMs = bootSpreadMs > 0 ? static_cast<uint32_t>(uniform() * bootSpreadMs) : 0;
+            const SimNodeConfig node = { SimRole::SENDER, r * std::cos(angle), r * std::sin(angle), intervalMs,
+                                         poisson, bootMs };
+            addNode(node);
+        }
+    }
+
+    void NetSim::computePathLoss() {
+        const size_t n = nodes_.size();
+        lossDb_.assign(n * n, 0.0f);
+        for (size_t a = 0; a < n; a++) {
+            for (size_t b = a + 1; b < n; b++) {
+                const float dx = nodes_[a]->config.xM - nodes_[b]->config.xM;
+                const float dy = nodes_[a]->config.yM - nodes_[b]->config.yM;
+                const float d = std::max(std::sqrt(dx * dx + dy * dy), 1.0f);
+                float loss = config_.refLossDb + 10.0f * config_.pathLossExponent * std::log10(d / config_.refDistanceM);
+                if (config_.shadowingDb > 0.0f) {
+                    loss += config_.shadowingDb * gaussian();
+                }
+                lossDb_[a * n + b] = loss;
+                lossDb_[b * n + a] = loss;
+            }
+        }
+    }
+
+    float NetSim::pathLossDb(size_t from, size_t to) const {
+        return lossDb_.empty() ? 0.0f : lossDb_[from * nodes_.size() + to];
+    }
+
+    float NetSim::rxPowerDbm(uint32_t from, uint32_t to) const {
+        return config_.profile.txPower - lossDb_[from * nodes_.size() + to];
+    }
+
+    float NetSim::sensitivityDbm() const {
+        return noiseFloorDbm(modulation_.bwHz, config_.noiseFigureDb) + demodulationSnrDb(modulation_.sf);
+    }
+
+    const LinkTable& NetSim::linkTable(size_t node) const {
+        return nodes_[node]->link.linkTable();
+    }
+
+    void NetSim::schedule(uint64_t timeUs, uint8_t type, uint32_t node, uint32_t txId) {
+        events_.push(Event{ timeUs, order_++, type, node, txId });
+    }
+
+    bool NetSim::isListening(uint32_t index) const {
+        const RadioMode mode = nodes_[index]->radio.getMode();
+        return mode == RadioMode::RECEIVE || mode == RadioMode::RECEIVE_DUTY_CYCLE;
+    }
+
+    void NetSim::abortReception(uint32_t index) {
+        SimNode& node = *nodes_[index];
+        if (node.locked) {
+            node.locked = false;
+            if (node.config.role == SimRole::RECEIVER && node.lockPing) {
+                report_.aborted++;
+            }
+        }
+    }
+
+    void NetSim::onTransmitStart(uint32_t index, const uint8_t* data, size_t length) {
+        abortReception(index);
+
+        Transmission tx;
+        tx.id = nextTxId_++;
+        tx.node = index;
+        tx.startUs = nowUs_;
+        tx.preambleEndUs = nowUs_ + static_cast<uint64_t>(modulation_.preamble) *
+                                        symbolTimeUs(modulation_.sf, modulation_.bwHz);
+        tx.endUs = nowUs_ + timeOnAirUs(modulation_, length);
+        std::copy(data, data + length, tx.data);
+        tx.length = length;
+        FrameView frame;
+        const FrameType type = decodeFrame(data, length, frame) == DecodeResult::OK ? frame.header.type
+                                                                                    : FrameType::PING;
+        tx.ping = type == FrameType::PING;
+        report_.airtimeUs += tx.endUs - tx.startUs;
+        if (!tx.ping) {
+            report_.overheadAirtimeUs += tx.endUs - tx.startUs;
+        }
+        if (type == FrameType::TDMA_BEACON) {
+            report_.superframeUs = lastBeaconUs_ > 0 ? static_cast<uint32_t>(nowUs_ - lastBeaconUs_) : 0;
+            lastBeaconUs_ = nowUs_;
+        }
+
+        const float sensitivity = sensitivityDbm();
+        for (uint32_t j = 0; j < nodes_.size(); j++) {
+            if (j == index) {
+                continue;
+            }
+            SimNode& node = *nodes_[j];
+            const float power = rxPowerDbm(index, j);
+            const bool counted = node.config.role == SimRole::RECEIVER && tx.ping;
+            if (node.locked) {
+                node.interferenceMw += toMw(power);
+            }
+            if (power < sensitivity) {
+                report_.weak += counted ? 1 : 0;
+            } else if (node.locked) {
+                report_.busy += counted ? 1 : 0;
+            } else if (!isListening(j)) {
+                report_.notListening += counted ? 1 : 0;
+            } else {
+                // Frames already on air interfere with this one from the start
+                node.locked = true;
+                node.lockPing = tx.ping;
+                node.lockTxId = tx.id;
+                node.lockPowerDbm = power;
+                node.interferenceMw = 0.0f;
+                for (const Transmission& other : onAir_) {
+                    if (other.node != j) {
+                        node.interferenceMw += toMw(rxPowerDbm(other.node, j));
+                    }
+                }
+            }
+        }
+        onAir_.push_back(tx);
+        schedule(tx.endUs, EVENT_TX_END, index, tx.id);
+    }
+
+    void NetSim::onTransmitEnd(uint32_t txId) {
+        auto it = std::find_if(onAir_.begin(), onAir_.end(),
+                               [txId](const Transmission& tx) { return tx.id == txId; });
+        if (it == onAir_.end()) {
+            return;
+        }
+        const Transmission tx = *it;
+        onAir_.erase(it);
+        recent_.push_back(tx);
+        recent_.erase(std::remove_if(recent_.begin(), recent_.end(),
+                                     [this](const Transmission& old) { return old.endUs + RECENT_KEEP_US < nowUs_; }),
+                      recent_.end());
+
+        const uint32_t nowUs = static_cast<uint32_t>(nowUs_);
+        nodes_[tx.node]->radio.completeTransmit(nowUs);
+
+        const float noise = noiseFloorDbm(modulation_.bwHz, config_.noiseFigureDb);
+        for (uint32_t j = 0; j < nodes_.size(); j++) {
+            SimNode& node = *nodes_[j];
+            if (!node.locked || node.lockTxId != txId) {
+                continue;
+            }
+            node.locked = false;
+            const bool counted = node.config.role == SimRole::RECEIVER && tx.ping;
+            if (!isListening(j)) {
+                report_.aborted += counted ? 1 : 0;
+                continue;
+            }
+            const bool collided = node.interferenceMw > 0.0f &&
+                                  node.lockPowerDbm - 10.0f * std::log10(node.interferenceMw) < config_.captureDb;
+            report_.collided += collided && counted ? 1 : 0;
+            const float snr = std::min(node.lockPowerDbm - noise, 12.0f);
+            node.radio.deliver(tx.data, tx.length, nowUs, node.lockPowerDbm, snr, collided);
+        }
+    }
+
+    void NetSim::onScanStart(uint32_t index) {
+        abortReception(index);
+        nodes_[index]->scanStartUs = nowUs_;
+        schedule(nowUs_ + cadTimeUs(modulation_), EVENT_CAD_END, index);
+    }
+
+    void NetSim::onScanEnd(uint32_t index) {
+        SimNode& node = *nodes_[index];
+        if (node.radio.getMode() != RadioMode::CAD) {
+            return;
+        }
+        const float sensitivity = sensitivityDbm();
+        bool detected = false;
+        for (const std::vector<Transmission>* list : { &onAir_, &recent_ }) {
+            for (const Transmission& tx : *list) {
+                if (tx.node == index || tx.endUs <= node.scanStartUs || tx.startUs >= nowUs_ ||
+                    rxPowerDbm(tx.node, index) < sensitivity) {
+                    continue;
+                }
+                const float p = node.scanStartUs < tx.preambleEndUs ? config_.cadPreambleDetect
+                                                                    : config_.cadPayloadDetect;
+                detected = uniform() < p || detected;
+            }
+        }
+        node.radio.completeChannelScan(detected, static_cast<uint32_t>(nowUs_));
+    }
+
+    void NetSim::runLoop(uint32_t index) {
+        SimNode& node = *nodes_[index];
+        if (!node.booted) {
+            node.booted = true;
+            node.link.listen();
+        }
+        const uint32_t pings = node.link.getStats().pings;
+        node.link.poll();
+        if (node.link.getStats().pings != pings) {
+            // Paced by the link layer, or in the node's TDMA slot
+            notePing(node, static_cast<uint16_t>(node.link.pingSequence() - 1));
+        }
+
+        if (node.isSender() && node.config.intervalMs > 0 && nowUs_ >= node.nextPingUs) {
+            const uint16_t seq = static_cast<uint16_t>(node.link.takePingSequence());
+            notePing(node, seq);
+            if (!node.link.queueFrame(FrameType::PING, seq, TX_NORMAL)) {
+                report_.queueDrops++;
+            }
+            const float meanUs = node.config.intervalMs * 1000.0f;
+            const float gapUs = node.config.poisson ? -meanUs * std::log(uniform()) : meanUs;
+            node.nextPingUs = nowUs_ + static_cast<uint64_t>(gapUs);
+        }
+
+        if (config_.tdma && node.isSender()) {
+            const bool synced = node.tdmaNode.state() == TdmaState::SYNCED;
+            if (synced != node.synced) {
+                node.synced = synced;
+                synced_ = synced ? synced_ + 1 : synced_ - 1;
+            }
+            if (synced_ == senders_ && syncedUs_ == 0) {
+                syncedUs_ = nowUs_;
+            }
+        }
+        schedule(nowUs_ + config_.loopUs, EVENT_LOOP, index);
+    }
+
+    void NetSim::notePing(const SimNode& node, uint16_t sequence) {
+        report_.offered++;
+        pending_[static_cast<uint32_t>(node.link.nodeId()) << 16 | sequence] = nowUs_;
+    }
+
+    void NetSim::onQueueFull(const SimNode&, FrameType type) {
+        if (type == FrameType::PING) {
+            report_.offered++;
+            report_.queueDrops++;
+        }
+    }
+
+    void NetSim::onFrame(const SimNode& node, const FrameView& frame) {
+        if (node.isSender() || frame.header.type != FrameType::PING) {
+            return;
+        }
+        auto it = pending_.find(static_cast<uint32_t>(frame.header.nodeId) << 16 | frame.header.sequence);
+        if (it == pending_.end()) {
+            return;     // Heard by another receiver first, or queued before the warm-up ended
+        }
+        latencies_.push_back(static_cast<uint32_t>(nowUs_ - it->second));
+        pending_.erase(it);
+        report_.delivered++;
+    }
+
+    void NetSim::onTxComplete(const SimNode& node, const TxResult& result) {
+        if (node.isSender() && result.type == FrameType::PING && result.status == RadioStatus::OK) {
+            report_.sent++;
+        }
+    }
+
+    NetSimReport NetSim::run(uint32_t durationMs, uint32_t warmupMs) {
+        g_simNowUs = nowUs_;
+        computePathLoss();
+        for (uint32_t i = 0; i < nodes_.size(); i++) {
+            SimNode& node = *nodes_[i];
+            node.radio.reinit(config_.profile);
+            node.radio.setDio1Handler([&node](uint32_t ts) { node.link.onDio1(ts); });
+            node.radio.setTransmitHandler([this, i](const uint8_t* data, size_t length) {
+                onTransmitStart(i, data, length);
+            });
+            node.radio.setChannelScanHandler([this, i]() { onScanStart(i); });
+            if (config_.tdma) {
+                node.link.attachTdma(node.isSender() ? nullptr : &node.tdmaCoordinator,
+                                     node.isSender() ? &node.tdmaNode : nullptr);
+            }
+            node.link.setListener(&node);
+            node.link.seed(random());
+            node.link.begin(config_.profile);
+
+            const uint64_t bootUs = static_cast<uint64_t>(node.config.bootMs) * 1000;
+            const uint64_t phaseUs = random() % config_.loopUs;
+            node.nextPingUs = bootUs;
+            if (node.config.poisson && node.config.intervalMs > 0) {
+                node.nextPingUs += static_cast<uint64_t>(-1000.0f * node.config.intervalMs * std::log(uniform()));
+            }
+            schedule(bootUs + phaseUs, EVENT_LOOP, i);
+        }
+        warmupUs_ = static_cast<uint64_t>(warmupMs) * 1000;
+        if (warmupUs_ > 0) {
+            schedule(warmupUs_, EVENT_WARMUP, 0);
+        }
+
+        const uint64_t endUs = static_cast<uint64_t>(durationMs) * 1000;
+        while (!events_.empty() && events_.top().timeUs < endUs) {
+            const Event event = events_.top();
+            events_.pop();
+            nowUs_ = event.timeUs;
+            g_simNowUs = nowUs_;
+            switch (event.type) {
+                case EVENT_LOOP: runLoop(event.node); break;
+                case EVENT_TX_END: onTransmitEnd(event.txId); break;
+                case EVENT_CAD_END: onScanEnd(event.node); break;
+                case EVENT_WARMUP: startMeasuring(); break;
+                default: break;
+            }
+        }
+        nowUs_ = endUs;
+        g_simNowUs = nowUs_;
+        finishReport();
+        return report_;
+    }
+
+    // Counts restart; the link layers' own counters are read against this point
+    void NetSim::startMeasuring() {
+        report_ = NetSimReport{};
+        latencies_.clear();
+        pending_.clear();
+        deferredBase_ = 0;
+        forcedBase_ = 0;
+        outOfSlotBase_ = 0;
+        for (const std::unique_ptr<SimNode>& node : nodes_) {
+            deferredBase_ += node->link.txScheduler().getStats().deferred;
+            forcedBase_ += node->link.listenBeforeTalk().getStats().forced;
+            outOfSlotBase_ += node->tdmaCoordinator.getStats().outOfSlot;
+        }
+    }
+
+    void NetSim::finishReport() {
+        report_.durationUs = nowUs_ - warmupUs_;
+        report_.syncedUs = syncedUs_;
+        for (const std::unique_ptr<SimNode>& node : nodes_) {
+            report_.lbtDeferred += node->link.txScheduler().getStats().deferred;
+            report_.lbtForced += node->link.listenBeforeTalk().getStats().forced;
+            report_.outOfSlot += node->tdmaCoordinator.getStats().outOfSlot;
+        }
+        report_.lbtDeferred -= deferredBase_;
+        report_.lbtForced -= forcedBase_;
+        report_.outOfSlot -= outOfSlotBase_;
+        if (latencies_.empty()) {
+            return;
+        }
+        uint64_t total = 0;
+        for (uint32_t latency : latencies_) {
+            total += latency;
+        }
+        report_.latencyAvgUs = static_cast<uint32_t>(total / latencies_.size());
+        std::sort(latencies_.begin(), latencies_.end());
+        report_.latencyP50Us = latencies_[latencies_.size() / 2];
+        report_.latencyP95Us = latencies_[latencies_.size() * 95 / 100];
+        report_.latencyMaxUs = latencies_.back();
+    }
+}
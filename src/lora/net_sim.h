@@ -0,0 +1,226 @@
+#pragma once
+
+#include "airtime.h"
+#include "frame_codec.h"
+#include "link_table.h"
+#include "xorshift.h"
+#include <stdint.h>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <queue>
+#include <unordered_map>
+#include <vector>
+
+// Discrete-event simulation of many nodes sharing one LoRa channel (native only)
+//
+// Every virtual node is a LinkLayer on its own MockRadio and
+// MockUpdateBackend, wired as main.cpp wires the board: the same TX queue,
+// airtime budget and listen-before-talk, RxEngine, dispatch and LinkTable,
+// and with tdma set the same TdmaCoordinator (receivers) and TdmaNode
+// (senders). The simulator stands in for the air between the radios:
+//
+// - Path loss: log-distance, PL(d) = refLossDb + 10 n log10(d / refDistanceM),
+//   plus a fixed Gaussian shadowing term per link. The defaults are LoRaSim's
+//   urban fit (127.41 dB at 40 m, n = 2.08).
+// - Sensitivity: noise floor -174 + 10 log10(BW) + noise figure, plus the
+//   SX1262 demodulation SNR limit for the SF (-7.5 dB at SF7 to -20 dB at SF12).
+// - Time on air: timeOnAirUs() for the profile and frame length.
+// - Collisions and capture: a receiver locks onto the first frame it hears
+//   while in RX. Every other frame that overlaps it adds interference. The
+//   locked frame survives when it is captureDb above all of it together.
+//   Otherwise it reaches RxEngine as a CRC error. A receiver does not move
+//   to a later, stronger frame. All nodes share one frequency and SF.
+// - Half duplex: a node that transmits or scans loses the frame it was
+//   receiving. A frame that starts while the node is not in RX is not heard.
+// - CAD: a scan detects a frame it overlaps with cadPreambleDetect when it
+//   overlaps the preamble, cadPayloadDetect otherwise (AN1200.85).
+//
+// Nodes boot at bootMs and then run loop() every loopUs at a random phase,
+// like the firmware's delay(10). Senders with an interval queue PINGs at
+// fixed or Poisson intervals; without one the link layer paces its own, in
+// TDMA slots once it has one. Receivers time each PING from enqueue at the
+// sender to dispatch. Everything random (placement, shadowing, boot, loop
+// phase, traffic, CAD and backoff) comes from the seed, so a run is
+// repeatable.
+//
+// The link layer reads time through plain function pointers, so every node
+// shares the simulator's clock: there is no crystal error between nodes, and
+// only one NetSim may run at a time.
+namespace LoRaLink {
+
+    enum class SimRole : uint8_t {
+        SENDER,
+        RECEIVER
+    };
+
+    struct SimNodeConfig {
+        SimRole role;
+        float xM;
+        float yM;
+        uint32_t intervalMs;        // Sender: mean PING interval; 0: the link layer paces them
+        bool poisson;               // Exponential gaps; false: fixed interval
+        uint32_t bootMs;            // Loop and RX start here; no PING before
+    };
+
+    struct NetSimConfig {
+        uint32_t seed;
+        ConfigPayload profile;      // Every node (frequency, BW, SF, CR, TX power)
+        uint16_t preamble;
+        float refLossDb;
+        float refDistanceM;
+        float pathLossExponent;
+        float shadowingDb;          // Sigma of the per-link term, 0 for none
+        float noiseFigureDb;
+        float captureDb;
+        float cadPreambleDetect;
+        float cadPayloadDetect;
+        uint32_t loopUs;
+        bool lbt;
+        uint16_t dutyCyclePermille; // Per sender, as LORA_DUTY_CYCLE_PERMILLE
+        bool tdma;                  // As LORA_TDMA: receivers beacon, senders PING in their slots
+
+        static NetSimConfig defaultConfig();
+    };
+
+    // Counts cover the measured window, from the warm-up to the end
+    struct NetSimReport {
+        uint64_t durationUs;
+        uint32_t offered;           // PINGs the senders queued
+        uint32_t queueDrops;        // Sender queue full
+        uint32_t sent;              // PINGs the senders finished sending
+        uint32_t delivered;         // Distinct PINGs dispatched at a receiver
+        uint64_t airtimeUs;         // All frames sent
+        uint64_t overheadAirtimeUs; // Frames other than PINGs (TDMA beacons and joins)
+        // Per receiver and PING
+        uint32_t collided;          // Lost to interference (read as CRC errors)
+        uint32_t weak;              // Below sensitivity
+        uint32_t busy;              // Receiver already locked onto another frame
+        uint32_t notListening;      // Receiver transmitting or scanning at the preamble
+        uint32_t aborted;           // Receiver left RX mid-frame
+        uint32_t lbtDeferred;       // Busy CADs, all senders
+        uint32_t lbtForced;         // Sent after maxAttempts busy CADs
+        uint32_t latencyAvgUs;      // Enqueue at the sender to dispatch at the receiver
+        uint32_t latencyP50Us;
+        uint32_t latencyP95Us;
+        uint32_t latencyMaxUs;
+        // TDMA
+        uint32_t outOfSlot;         // Frames the coordinators heard outside their slot
+        uint32_t superframeUs;      // Between the last two beacons
+        uint64_t syncedUs;          // From time zero until every sender first held a slot (0: never)
+
+        float deliveryRatio() const { return offered > 0 ? static_cast<float>(delivered) / offered : 0.0f; }
+        // Offered load G: frame airtimes per airtime
+        float channelLoad() const { return durationUs > 0 ? static_cast<float>(airtimeUs) / durationUs : 0.0f; }
+        // Delivered PING airtime per airtime
+        float channelUse(uint32_t pingAirUs) const {
+            return durationUs > 0 ? static_cast<float>(delivered) * pingAirUs / durationUs : 0.0f;
+        }
+        // Delivered frame bits per second
+        float throughputBps() const {
+            return durationUs > 0 ? delivered * PING_FRAME_BYTES * 8.0f * 1000000.0f / durationUs : 0.0f;
+        }
+    };
+
+    // Receiver noise floor and demodulation limit
+    float noiseFloorDbm(uint32_t bwHz, float noiseFigureDb);
+    float demodulationSnrDb(uint8_t sf);
+
+    struct SimNode;
+    struct TxResult;
+
+    class NetSim {
+    public:
+        explicit NetSim(const NetSimConfig& config);
+        ~NetSim();
+
+        size_t addNode(const SimNodeConfig& node);
+        // Senders spread uniformly over a disc around the origin, booting
+        // uniformly over the first bootSpreadMs
+        void addSenders(size_t count, float radiusM, uint32_t intervalMs, bool poisson = true,
+                        uint32_t bootSpreadMs = 0);
+
+        // Run from time zero, counting from warmupMs on; call once
+        NetSimReport run(uint32_t durationMs, uint32_t warmupMs = 0);
+
+        size_t nodeCount() const { return nodes_.size(); }
+        float pathLossDb(size_t from, size_t to) const;
+        float sensitivityDbm() const;
+        // Receiver's view of every sender, as the firmware keeps it
+        const LinkTable& linkTable(size_t node) const;
+
+    private:
+        friend struct SimNode;
+
+        struct Event {
+            uint64_t timeUs;
+            uint64_t order;         // Ties run in the order they were scheduled
+            uint8_t type;
+            uint32_t node;
+            uint32_t txId;
+
+            bool operator>(const Event& other) const {
+                return timeUs != other.timeUs ? timeUs > other.timeUs : order > other.order;
+            }
+        };
+
+        struct Transmission {
+            uint32_t id;
+            uint32_t node;
+            uint64_t startUs;
+            uint64_t preambleEndUs;
+            uint64_t endUs;
+            bool ping;
+            uint8_t data[MAX_FRAME_SIZE];
+            size_t length;
+        };
+
+        NetSimConfig config_;
+        LoRaModulation modulation_;
+        Xorshift32 rng_;
+        std::vector<std::unique_ptr<SimNode>> nodes_;
+        std::vector<float> lossDb_;             // n x n, symmetric
+        std::priority_queue<Event, std::vector<Event>, std::greater<Event>> events_;
+        uint64_t order_;
+        uint64_t nowUs_;
+        uint32_t nextTxId_;
+        std::vector<Transmission> onAir_;
+        std::vector<Transmission> recent_;      // Ended, still inside a CAD window
+        std::unordered_map<uint32_t, uint64_t> pending_;   // nodeId << 16 | seq -> enqueue time
+        std::vector<uint32_t> latencies_;
+        NetSimReport report_;
+        uint64_t warmupUs_;
+        uint64_t lastBeaconUs_;
+        size_t senders_;
+        size_t synced_;                         // Senders holding a TDMA slot
+        uint64_t syncedUs_;
+        // Link layer counters at the warm-up
+        uint32_t deferredBase_;
+        uint32_t forcedBase_;
+        uint32_t outOfSlotBase_;
+
+        uint32_t random();
+        float uniform();
+        float gaussian();
+        void schedule(uint64_t timeUs, uint8_t type, uint32_t node, uint32_t txId = 0);
+        void computePathLoss();
+        float rxPowerDbm(uint32_t from, uint32_t to) const;
+
+        void boot(uint32_t index);
+        void runLoop(uint32_t index);
+        void notePing(const SimNode& node, uint16_t sequence);
+        void onTransmitStart(uint32_t index, const uint8_t* data, size_t length);
+        void onTransmitEnd(uint32_t txId);
+        void onScanStart(uint32_t index);
+        void onScanEnd(uint32_t index);
+        void abortReception(uint32_t index);
+        bool isListening(uint32_t index) const;
+        void startMeasuring();
+        void finishReport();
+
+        // From the nodes' link layers
+        void onFrame(const SimNode& node, const FrameView& frame);
+        void onTxComplete(const SimNode& node, const TxResult& result);
+        void onQueueFull(const SimNode& node, FrameType type);
+    };
+}
@@ -0,0 +1,344 @@
+#include "ota_arq.h"
+#include "frame_codec.h"
+#include <cstring>
+
+namespace LoRaLink {
+
+    namespace {
+        inline bool testBit(const uint8_t* bits, uint32_t index) {
+            return (bits[index >> 3] & (1u << (index & 7))) != 0;
+        }
+
+        inline void setBit(uint8_t* bits, uint32_t index) {
+            bits[index >> 3] |= static_cast<uint8_t>(1u << (index & 7));
+        }
+
+        inline void clearBit(uint8_t* bits, uint32_t index) {
+            bits[index >> 3] &= static_cast<uint8_t>(~(1u << (index & 7)));
+        }
+    }
+
+    size_t encodeOtaNack(const OtaReceiver& receiver, uint8_t* out, size_t outSize) {
+        if (out == nullptr || outSize < OTA_NACK_HEADER_SIZE || receiver.getState() == OtaState::IDLE) {
+            return 0;
+        }
+
+        const uint32_t chunks = receiver.chunkCount();
+        OtaNackStatus status = OtaNackStatus::RECEIVING;
+        if (receiver.getState() == OtaState::COMPLETE) {
+            status = OtaNackStatus::COMPLETE;
+        } else if (receiver.getState() == OtaState::FAILED) {
+            status = OtaNackStatus::FAILED;
+        }
+
+        const uint32_t base = receiver.nextMissing();
+        Wire::putU16(out, static_cast<uint16_t>(base));
+        Wire::putU16(out + 2, static_cast<uint16_t>(receiver.missingChunks()));
+        out[4] = static_cast<uint8_t>(status);
+        if (status != OtaNackStatus::RECEIVING) {
+            return OTA_NACK_HEADER_SIZE;
+        }
+
+        // Bits past the image end read as missing so they trim away below
+        size_t bitmapSize = (chunks - base + 7) / 8;
+        if (bitmapSize > OTA_NACK_MAX_BITMAP) {
+            bitmapSize = OTA_NACK_MAX_BITMAP;
+        }
+        if (bitmapSize > outSize - OTA_NACK_HEADER_SIZE) {
+            bitmapSize = outSize - OTA_NACK_HEADER_SIZE;
+        }
+        uint8_t* bitmap = out + OTA_NACK_HEADER_SIZE;
+        for (size_t i = 0; i < bitmapSize; ++i) {
+            uint8_t byte = 0;
+            for (uint32_t bit = 0; bit < 8; ++bit) {
+                const uint32_t index = base + static_cast<uint32_t>(i) * 8 + bit;
+                if (index >= chunks || !receiver.hasChunk(index)) {
+                    byte |= static_cast<uint8_t>(1u << bit);
+                }
+            }
+            bitmap[i] = byte;
+        }
+
+        // Anything past the bitmap is implicitly missing
+        while (bitmapSize > 0 && bitmap[bitmapSize - 1] == 0xFF) {
+            bitmapSize--;
+        }
+        return OTA_NACK_HEADER_SIZE + bitmapSize;
+    }
+
+    bool decodeOtaNack(const uint8_t* payload, size_t length, OtaNack& nack) {
+        if (payload == nullptr || length < OTA_NACK_HEADER_SIZE ||
+            length > OTA_NACK_HEADER_SIZE + OTA_NACK_MAX_BITMAP || payload[4] > 2) {
+            return false;
+        }
+        nack.base = Wire::getU16(payload);
+        nack.missing = Wire::getU16(payload + 2);
+        nack.status = static_cast<OtaNackStatus>(payload[4]);
+        nack.bitmap = payload + OTA_NACK_HEADER_SIZE;
+        nack.bitmapSize = length - OTA_NACK_HEADER_SIZE;
+        return true;
+    }
+
+    OtaSenderConfig OtaSender::defaultConfig() {
+        OtaSenderConfig config;
+        config.windowChunks = 256;
+        config.minGapMs = 0;
+        config.maxGapMs = 1000;
+        config.gapStepMs = 50;
+        config.highLossPct = 10;
+        config.lowLossPct = 3;
+        config.replyTimeoutMs = 3000;
+        config.maxRetries = 5;
+        return config;
+    }
+
+    OtaSender::OtaSender()
+        : OtaSender(defaultConfig())
+    {
+    }
+
+    OtaSender::OtaSender(const OtaSenderConfig& config)
+        : config_(config)
+        , state_(OtaSenderState::IDLE)
+        , chunkCount_(0)
+        , base_(0)
+        , cursor_(0)
+        , ackedCount_(0)
+        , lastSentMs_(0)
+        , waitStartMs_(0)
+        , retries_(0)
+        , gapMs_(config.minGapMs)
+        , lossPct_(0)
+        , awaitingSent_(false)
+        , acked_{}
+        , inFlight_{}
+        , sentOnce_{}
+        , stats_{}
+    {
+        if (config_.windowChunks == 0 || config_.windowChunks > OTA_NACK_WINDOW) {
+            config_.windowChunks = OTA_NACK_WINDOW;
+        }
+    }
+
+    bool OtaSender::begin(uint32_t imageSize, uint16_t chunkSize, uint32_t nowMs) {
+        if (imageSize == 0 || chunkSize == 0) {
+            return false;
+        }
+        const uint32_t chunks = (imageSize + chunkSize - 1) / chunkSize;
+        if (chunks > MAX_CHUNKS) {
+            return false;
+        }
+
+        chunkCount_ = chunks;
+        base_ = 0;
+        cursor_ = 0;
+        ackedCount_ = 0;
+        lastSentMs_ = nowMs;
+        waitStartMs_ = nowMs;
+        retries_ = 0;
+        gapMs_ = config_.minGapMs;
+        lossPct_ = 0;
+        awaitingSent_ = false;
+        memset(acked_, 0, sizeof(acked_));
+        memset(inFlight_, 0, sizeof(inFlight_));
+        memset(sentOnce_, 0, sizeof(sentOnce_));
+        stats_ = {};
+        state_ = OtaSenderState::STARTING;
+        return true;
+    }
+
+    void OtaSender::cancel() {
+        if (isActive()) {
+            state_ = OtaSenderState::FAILED;
+        }
+    }
+
+    bool OtaSender::isActive() const {
+        return state_ == OtaSenderState::STARTING || state_ == OtaSenderState::SENDING ||
+               state_ == OtaSenderState::POLLING;
+    }
+
+    OtaSendAction OtaSender::next(uint32_t nowMs, uint16_t& index) {
+        if (!isActive() || awaitingSent_) {
+            return OtaSendAction::NONE;
+        }
+
+        if (state_ == OtaSenderState::SENDING) {
+            if (nowMs - lastSentMs_ < gapMs_) {
+                return OtaSendAction::NONE;
+            }
+            uint32_t pending;
+            if (findPending(pending)) {
+                setBit(inFlight_, pending);
+                if (testBit(sentOnce_, pending)) {
+                    stats_.retransmits++;
+                }
+                setBit(sentOnce_, pending);
+                stats_.chunksSent++;
+                index = static_cast<uint16_t>(pending);
+                awaitingSent_ = true;
+                return OtaSendAction::CHUNK;
+            }
+            // Window drained: ask the receiver where it stands
+            state_ = OtaSenderState::POLLING;
+            retries_ = 0;
+        }
+
+        // STARTING / POLLING: (re)send once the previous request went unanswered
+        if (retries_ > 0 && nowMs - waitStartMs_ < config_.replyTimeoutMs) {
+            return OtaSendAction::NONE;
+        }
+        if (retries_ >= config_.maxRetries) {
+            state_ = OtaSenderState::FAILED;
+            return OtaSendAction::NONE;
+        }
+        retries_++;
+        awaitingSent_ = true;
+        if (state_ == OtaSenderState::STARTING) {
+            stats_.starts++;
+            return OtaSendAction::START;
+        }
+        stats_.polls++;
+        return OtaSendAction::POLL;
+    }
+
+    void OtaSender::onSent(uint32_t nowMs, uint32_t airtimeUs) {
+        if (!awaitingSent_) {
+            return;
+        }
+        awaitingSent_ = false;
+        lastSentMs_ = nowMs;
+        waitStartMs_ = nowMs;
+        stats_.framesSent++;
+        stats_.airtimeUs += airtimeUs;
+    }
+
+    bool OtaSender::onNack(const uint8_t* payload, size_t length, uint32_t nowMs) {
+        OtaNack nack;
+        if (!decodeOtaNack(payload, length, nack)) {
+            return false;
+        }
+        if (!isActive()) {
+            return true;
+        }
+        stats_.nacks++;
+
+        if (nack.status == OtaNackStatus::COMPLETE) {
+            for (uint32_t i = base_; i < chunkCount_; ++i) {
+                markAcked(i);
+            }
+            memset(inFlight_, 0, sizeof(inFlight_));
+            state_ = OtaSenderState::DONE;
+            return true;
+        }
+        if (nack.status == OtaNackStatus::FAILED) {
+            state_ = OtaSenderState::FAILED;
+            return true;
+        }
+
+        const uint32_t nackBase = nack.base < chunkCount_ ? nack.base : chunkCount_;
+        const uint32_t nackEnd = nackBase + static_cast<uint32_t>(nack.bitmapSize) * 8;
+        uint32_t scanEnd = base_ + config_.windowChunks;
+        if (nackEnd > scanEnd) {
+            scanEnd = nackEnd;
+        }
+        if (scanEnd > chunkCount_) {
+            scanEnd = chunkCount_;
+        }
+
+        uint32_t confirmed = 0;
+        uint32_t lost = 0;
+        for (uint32_t i = base_; i < scanEnd; ++i) {
+            const bool received = i < nackBase ||
+                                  (i < nackEnd && !testBit(nack.bitmap, i - nackBase));
+            const bool wasInFlight = testBit(inFlight_, i);
+            if (received) {
+                if (wasInFlight) {
+                    confirmed++;
+                }
+                markAcked(i);
+            } else if (wasInFlight) {
+                // Sent before this NACK was built and still missing: lost
+                clearBit(inFlight_, i);
+                lost++;
+            }
+        }
+        stats_.chunksConfirmed += confirmed;
+        stats_.chunksLost += lost;
+
+        while (base_ < chunkCount_ && testBit(acked_, base_)) {
+            base_++;
+        }
+        cursor_ = base_;
+        adaptPacing(lost, confirmed);
+
+        state_ = OtaSenderState::SENDING;
+        retries_ = 0;
+        waitStartMs_ = nowMs;
+        return true;
+    }
+
+    void OtaSender::markAcked(uint32_t index) {
+        clearBit(inFlight_, index);
+        if (!testBit(acked_, index)) {
+            setBit(acked_, index);
+            ackedCount_++;
+        }
+    }
+
+    void OtaSender::adaptPacing(uint32_t lost, uint32_t confirmed) {
+        const uint32_t total = lost + confirmed;
+        if (total == 0) {
+            return;
+        }
+        const uint32_t roundPct = (lost * 100) / total;
+        lossPct_ = static_cast<uint8_t>((lossPct_ * 3u + roundPct) / 4u);
+
+        if (roundPct > config_.highLossPct) {
+            uint32_t gap = gapMs_ * 2 + config_.gapStepMs;
+            gapMs_ = gap > config_.maxGapMs ? config_.maxGapMs : gap;
+        } else if (roundPct < config_.lowLossPct) {
+            uint32_t gap = gapMs_ / 2;
+            gapMs_ = gap < config_.minGapMs ? config_.minGapMs : gap;
+        }
+    }
+
+    bool OtaSender::findPending(uint32_t& index) {
+        uint32_t end = base_ + config_.windowChunks;
+        if (end > chunkCount_) {
+            end = chunkCount_;
+        }
+        for (uint32_t i = cursor_; i < end; ++i) {
+            if (!testBit(acked_, i) && !testBit(inFlight_, i)) {
+                cursor_ = i + 1;
+                index = i;
+                return true;
+            }
+        }
+        cursor_ = end;
+        return false;
+    }
+
+    void OtaSender::resetStats() {
+        stats_ = {};
+    }
+
+    uint8_t OtaSender::percent() const {
+        if (chunkCount_ == 0) {
+            return 0;
+        }
+        return static_cast<uint8_t>((static_cast<uint64_t>(ackedCount_) * 100) / chunkCount_);
+    }
+
+    const char* OtaSender::stateToString(OtaSenderState state) {
+        switch (state) {
+            case OtaSenderState::IDLE: return "IDLE";
+            case OtaSenderState::STARTING: return "STARTING";
+            case OtaSenderState::SENDING: return "SENDING";
+            case OtaSenderState::POLLING: return "POLLING";
+            case OtaSenderState::DONE: return "DONE";
+            case OtaSenderState::FAILED: return "FAILED";
+            default: return "UNKNOWN";
+        }
+    }
+}
@@ -0,0 +1,140 @@
+#pragma once
+
+#include "ota_receiver.h"
+#include <stdint.h>
+#include <cstddef>
+
+// Selective-repeat ARQ for LoRa firmware transfer
+//
+// The node receiving the image answers OTA_START, every OTA_END (used as a
+// poll) and long silences with an OTA_NACK: "everything below base arrived;
+// in the bitmap that follows a set bit means missing; anything past the
+// bitmap has not arrived". Trailing all-missing bytes are trimmed, so a
+// clean transfer is acknowledged with a 5-byte payload.
+//
+// OtaSender keeps an acked and an in-flight bitmap per chunk. It sends only
+// chunks that are neither, within a window the NACK bitmap can describe, and
+// polls once the window is drained. A NACK settles every in-flight chunk:
+// confirmed ones are acked, the rest are lost and queued again. The lost
+// fraction of each round drives the gap between chunks, so a receiver that
+// drops frames while busy writing flash gets slowed down instead of flooded.
+namespace LoRaLink {
+
+    // OTA_NACK payload: u16 base, u16 missing total, u8 status, bitmap bytes
+    constexpr size_t OTA_NACK_HEADER_SIZE = 5;
+    constexpr size_t OTA_NACK_MAX_BITMAP = 128;     // 1024 chunks past base
+    constexpr size_t OTA_NACK_WINDOW = OTA_NACK_MAX_BITMAP * 8;
+
+    enum class OtaNackStatus : uint8_t {
+        RECEIVING = 0,
+        COMPLETE  = 1,      // Image verified and accepted
+        FAILED    = 2       // Receiver gave up (hash mismatch, flash error)
+    };
+
+    struct OtaNack {
+        uint16_t base;              // Lowest missing chunk
+        uint16_t missing;           // Total chunks still missing
+        OtaNackStatus status;
+        const uint8_t* bitmap;      // Points into the payload; bit set = missing
+        size_t bitmapSize;
+    };
+
+    // Receiver side: describe the current reception state
+    size_t encodeOtaNack(const OtaReceiver& receiver, uint8_t* out, size_t outSize);
+    bool decodeOtaNack(const uint8_t* payload, size_t length, OtaNack& nack);
+
+    enum class OtaSendAction {
+        NONE,           // Nothing to send yet (pacing, waiting for a NACK)
+        START,          // (Re)send OTA_START
+        CHUNK,          // Send OTA_DATA for the returned index
+        POLL            // Send OTA_END to ask for a NACK
+    };
+
+    enum class OtaSenderState {
+        IDLE,
+        STARTING,       // OTA_START sent, waiting for the first NACK
+        SENDING,
+        POLLING,        // Window drained, waiting for a NACK
+        DONE,
+        FAILED
+    };
+
+    struct OtaSenderConfig {
+        uint16_t windowChunks;      // Chunks in flight past base (<= OTA_NACK_WINDOW)
+        uint32_t minGapMs;
+        uint32_t maxGapMs;
+        uint32_t gapStepMs;         // Additive part of a gap increase
+        uint8_t highLossPct;        // Round loss above this widens the gap
+        uint8_t lowLossPct;         // Round loss below this narrows it
+        uint32_t replyTimeoutMs;    // Wait for a NACK before re-polling
+        uint8_t maxRetries;         // Unanswered START/POLL frames before giving up
+    };
+
+    struct OtaSenderStats {
+        uint32_t starts;
+        uint32_t chunksSent;
+        uint32_t retransmits;       // Chunks sent more than once
+        uint32_t polls;
+        uint32_t nacks;
+        uint32_t chunksLost;        // In flight when a NACK said missing
+        uint32_t chunksConfirmed;
+        uint32_t framesSent;
+        uint32_t airtimeUs;         // Sum reported through onSent()
+    };
+
+    class OtaSender {
+    public:
+        static constexpr size_t MAX_CHUNKS = OtaReceiver::MAX_CHUNKS;
+
+        static OtaSenderConfig defaultConfig();
+
+        OtaSender();
+        explicit OtaSender(const OtaSenderConfig& config);
+
+        // Starts a transfer; stats cover one transfer
+        bool begin(uint32_t imageSize, uint16_t chunkSize, uint32_t nowMs);
+        void cancel();
+
+        // What to put on air next; index is set for CHUNK
+        OtaSendAction next(uint32_t nowMs, uint16_t& index);
+        // The frame from next() finished transmitting; pacing counts from here
+        void onSent(uint32_t nowMs, uint32_t airtimeUs = 0);
+        // Returns false for a payload that does not decode
+        bool onNack(const uint8_t* payload, size_t length, uint32_t nowMs);
+
+        OtaSenderState getState() const { return state_; }
+        bool isActive() const;
+        const OtaSenderStats& getStats() const { return stats_; }
+        void resetStats();
+
+        uint32_t chunkCount() const { return chunkCount_; }
+        uint32_t chunksAcked() const { return ackedCount_; }
+        uint32_t gapMs() const { return gapMs_; }
+        uint8_t lossPct() const { return lossPct_; }
+        uint8_t percent() const;
+
+        static const char* stateToString(OtaSenderState state);
+
+    private:
+        OtaSenderConfig config_;
+        OtaSenderState state_;
+        uint32_t chunkCount_;
+        uint32_t base_;             // All chunks below are acked
+        uint32_t cursor_;           // Scan position inside the window
+        uint32_t ackedCount_;
+        uint32_t lastSentMs_;
+        uint32_t waitStartMs_;
+        uint8_t retries_;
+        uint32_t gapMs_;
+        uint8_t lossPct_;           // Smoothed loss
+        bool awaitingSent_;
+        uint8_t acked_[MAX_CHUNKS / 8];
+        uint8_t inFlight_[MAX_CHUNKS / 8];
+        uint8_t sentOnce_[MAX_CHUNKS / 8];
+        OtaSenderStats stats_;
+
+        void markAcked(uint32_t index);
+        void adaptPacing(uint32_t lost, uint32_t confirmed);
+        bool findPending(uint32_t& index);
+    };
+}
@@ -0,0 +1,581 @@
+#include "ota_fec.h"
+#include "xorshift.h"
+#include <cstring>
+
+namespace LoRaLink {
+
+    namespace {
+        inline uint8_t lowestBit(uint32_t mask) {
+            return static_cast<uint8_t>(__builtin_ctz(mask));
+        }
+
+        inline uint32_t blockMask(uint8_t chunks) {
+            return chunks >= 32 ? 0xFFFFFFFFu : ((1u << chunks) - 1);
+        }
+
+        inline void xorInto(uint8_t* dst, const uint8_t* src, size_t length) {
+            for (size_t i = 0; i < length; ++i) {
+                dst[i] ^= src[i];
+            }
+        }
+    }
+
+    FecLayout::FecLayout()
+        : imageSize(0)
+        , chunkSize(0)
+        , chunkCount(0)
+        , blockCount(0)
+    {
+    }
+
+    FecLayout::FecLayout(uint32_t imageSize, uint16_t chunkSize)
+        : imageSize(imageSize)
+        , chunkSize(chunkSize)
+        , chunkCount(chunkSize == 0 ? 0 : (imageSize + chunkSize - 1) / chunkSize)
+        , blockCount(static_cast<uint16_t>((chunkCount + FEC_BLOCK_CHUNKS - 1) / FEC_BLOCK_CHUNKS))
+    {
+    }
+
+    uint8_t FecLayout::chunksInBlock(uint16_t block) const {
+        if (block >= blockCount) {
+            return 0;
+        }
+        const uint32_t left = chunkCount - firstChunk(block);
+        return static_cast<uint8_t>(left < FEC_BLOCK_CHUNKS ? left : FEC_BLOCK_CHUNKS);
+    }
+
+    size_t FecLayout::chunkLength(uint32_t chunk) const {
+        const size_t offset = static_cast<size_t>(chunk) * chunkSize;
+        return imageSize - offset < chunkSize ? imageSize - offset : chunkSize;
+    }
+
+    uint32_t fecRepairMask(uint16_t block, uint16_t seq, uint8_t chunks) {
+        // The mask travels in the packet, so nothing on the far side depends
+        // on this sequence; it only has to differ per (block, seq)
+        Xorshift32 rng((static_cast<uint32_t>(block) * 0x9E3779B1u) ^ (static_cast<uint32_t>(seq) * 0x85EBCA77u) ^
+                       0xC2B2AE3Du);
+        const uint32_t valid = blockMask(chunks);
+        for (;;) {
+            const uint32_t x = rng.next();
+            if ((x & valid) != 0) {
+                return x & valid;
+            }
+        }
+    }
+
+    size_t encodeCodedPacket(const FecLayout& layout, const uint8_t* image, uint16_t block,
+                             uint32_t mask, uint8_t* out, size_t outSize) {
+        if (image == nullptr) {
+            return 0;
+        }
+        MemoryImage source(image, layout.imageSize);
+        return encodeCodedPacket(layout, source, block, mask, out, outSize);
+    }
+
+    size_t encodeCodedPacket(const FecLayout& layout, IImageSource& image, uint16_t block,
+                             uint32_t mask, uint8_t* out, size_t outSize) {
+        const uint8_t chunks = layout.chunksInBlock(block);
+        if (out == nullptr || chunks == 0 || (mask & ~blockMask(chunks)) != 0 ||
+            layout.chunkSize > FEC_MAX_CHUNK || outSize < OTA_CODED_HEADER_SIZE + layout.chunkSize) {
+            return 0;
+        }
+
+        Wire::putU16(out, block);
+        Wire::putU32(out + 2, mask);
+        uint8_t* data = out + OTA_CODED_HEADER_SIZE;
+        memset(data, 0, layout.chunkSize);
+        uint8_t chunkData[FEC_MAX_CHUNK];
+        while (mask != 0) {
+            const uint32_t chunk = layout.firstChunk(block) + lowestBit(mask);
+            mask &= mask - 1;
+            const size_t length = layout.chunkLength(chunk);
+            if (!image.read(static_cast<size_t>(chunk) * layout.chunkSize, chunkData, length)) {
+                return 0;
+            }
+            xorInto(data, chunkData, length);
+        }
+        return OTA_CODED_HEADER_SIZE + layout.chunkSize;
+    }
+
+    FecDecoder::FecDecoder()
+        : block_(0)
+        , chunks_(0)
+        , chunkSize_(0)
+        , rank_(0)
+        , solved_(false)
+        , masks_{}
+        , rows_{}
+        , scratch_{}
+    {
+    }
+
+    void FecDecoder::begin(uint16_t block, uint8_t chunks, uint16_t chunkSize) {
+        reset();
+        if (chunks > FEC_BLOCK_CHUNKS || chunkSize > FEC_MAX_CHUNK) {
+            return;
+        }
+        block_ = block;
+        chunks_ = chunks;
+        chunkSize_ = chunkSize;
+    }
+
+    void FecDecoder::reset() {
+        block_ = 0;
+        chunks_ = 0;
+        chunkSize_ = 0;
+        rank_ = 0;
+        solved_ = false;
+        memset(masks_, 0, sizeof(masks_));
+    }
+
+    FecAddResult FecDecoder::add(uint32_t mask, const uint8_t* data) {
+        if (!isActive() || data == nullptr || mask == 0 || (mask & ~blockMask(chunks_)) != 0) {
+            return FecAddResult::INVALID;
+        }
+        if (isComplete()) {
+            return FecAddResult::REDUNDANT;
+        }
+
+        // Eliminate against the rows we hold, lowest pivot first
+        memcpy(scratch_, data, chunkSize_);
+        while (mask != 0) {
+            const uint8_t pivot = lowestBit(mask);
+            if (masks_[pivot] == 0) {
+                break;
+            }
+            mask ^= masks_[pivot];
+            xorInto(scratch_, rows_[pivot], chunkSize_);
+        }
+        if (mask == 0) {
+            return FecAddResult::REDUNDANT;
+        }
+
+        const uint8_t pivot = lowestBit(mask);
+        masks_[pivot] = mask;
+        memcpy(rows_[pivot], scratch_, chunkSize_);
+        rank_++;
+        if (isComplete()) {
+            solve();
+        }
+        return FecAddResult::INNOVATIVE;
+    }
+
+    // Back-substitution: rows above are already unit rows when row p is cleared
+    void FecDecoder::solve() {
+        for (int p = chunks_ - 1; p >= 0; --p) {
+            uint32_t rest = masks_[p] & ~(1u << p);
+            while (rest != 0) {
+                const uint8_t q = lowestBit(rest);
+                rest &= rest - 1;
+                xorInto(rows_[p], rows_[q], chunkSize_);
+            }
+            masks_[p] = 1u << p;
+        }
+        solved_ = true;
+    }
+
+    const uint8_t* FecDecoder::chunk(uint8_t i) {
+        if (!solved_ || i >= chunks_) {
+            return nullptr;
+        }
+        return rows_[i];
+    }
+
+    FecReceiver::FecReceiver(OtaReceiver& ota, IUpdateBackend& backend)
+        : ota_(ota)
+        , backend_(backend)
+        , decoder_()
+        , stats_{}
+    {
+    }
+
+    bool FecReceiver::blockWritten(const FecLayout& layout, uint16_t block) const {
+        const uint32_t first = layout.firstChunk(block);
+        const uint8_t chunks = layout.chunksInBlock(block);
+        for (uint8_t i = 0; i < chunks; ++i) {
+            if (!ota_.hasChunk(first + i)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    void FecReceiver::beginBlock(const FecLayout& layout, uint16_t block) {
+        const uint8_t chunks = layout.chunksInBlock(block);
+        decoder_.begin(block, chunks, layout.chunkSize);
+
+        uint8_t known[FEC_MAX_CHUNK];
+        const uint32_t first = layout.firstChunk(block);
+        for (uint8_t i = 0; i < chunks; ++i) {
+            const uint32_t chunk = first + i;
+            if (!ota_.hasChunk(chunk)) {
+                continue;
+            }
+            const size_t length = layout.chunkLength(chunk);
+            memset(known, 0, layout.chunkSize);
+            if (backend_.read(static_cast<size_t>(chunk) * layout.chunkSize, known, length)) {
+                decoder_.add(1u << i, known);
+            }
+        }
+    }
+
+    OtaResult FecReceiver::onCoded(const uint8_t* payload, size_t length, uint32_t nowMs) {
+        if (!ota_.isActive()) {
+            return OtaResult::NOT_ACTIVE;
+        }
+        const FecLayout layout(ota_.getInfo().imageSize, ota_.getInfo().chunkSize);
+        if (payload == nullptr || length != OTA_CODED_HEADER_SIZE + layout.chunkSize) {
+            return OtaResult::BAD_CHUNK;
+        }
+        const uint16_t block = Wire::getU16(payload);
+        const uint32_t mask = Wire::getU32(payload + 2);
+        const uint8_t* data = payload + OTA_CODED_HEADER_SIZE;
+        const uint8_t chunks = layout.chunksInBlock(block);
+        if (chunks == 0) {
+            return OtaResult::BAD_CHUNK;
+        }
+
+        stats_.packets++;
+        if (blockWritten(layout, block)) {
+            stats_.redundant++;
+            return OtaResult::DUPLICATE;
+        }
+        if (!decoder_.isActive() || decoder_.block() != block) {
+            if (decoder_.isActive() && !decoder_.isComplete()) {
+                stats_.blocksAbandoned++;
+            }
+            beginBlock(layout, block);
+        }
+
+        const FecAddResult added = decoder_.add(mask, data);
+        if (added == FecAddResult::INVALID) {
+            return OtaResult::BAD_CHUNK;
+        }
+        if (added == FecAddResult::REDUNDANT) {
+            stats_.redundant++;
+            return OtaResult::DUPLICATE;
+        }
+        stats_.innovative++;
+
+        const uint32_t first = layout.firstChunk(block);
+        OtaResult result = OtaResult::OK;
+        if ((mask & (mask - 1)) == 0 && !decoder_.isComplete()) {
+            // Source packet: straight to flash, no decoding needed
+            const uint32_t chunk = first + lowestBit(mask);
+            result = ota_.onChunk(static_cast<uint16_t>(chunk), data, layout.chunkLength(chunk), nowMs);
+        } else if (decoder_.isComplete()) {
+            for (uint8_t i = 0; i < chunks; ++i) {
+                if (!ota_.hasChunk(first + i)) {
+                    OtaResult r = ota_.onChunk(static_cast<uint16_t>(first + i), decoder_.chunk(i),
+                                               layout.chunkLength(first + i), nowMs);
+                    if (r != OtaResult::OK) {
+                        result = r;
+                    }
+                }
+            }
+            stats_.blocksDecoded++;
+        }
+        return result == OtaResult::DUPLICATE ? OtaResult::OK : result;
+    }
+
+    uint8_t FecReceiver::neededFor(uint16_t block) const {
+        if (!ota_.isActive()) {
+            return 0;
+        }
+        const FecLayout layout(ota_.getInfo().imageSize, ota_.getInfo().chunkSize);
+        const uint8_t chunks = layout.chunksInBlock(block);
+        if (chunks == 0 || blockWritten(layout, block)) {
+            return 0;
+        }
+        if (decoder_.isActive() && decoder_.block() == block) {
+            return decoder_.needed();
+        }
+        uint8_t missing = 0;
+        for (uint8_t i = 0; i < chunks; ++i) {
+            if (!ota_.hasChunk(layout.firstChunk(block) + i)) {
+                missing++;
+            }
+        }
+        return missing;
+    }
+
+    size_t FecReceiver::encodeNeed(uint16_t block, uint8_t* out, size_t outSize) const {
+        if (out == nullptr || outSize < OTA_BLOCK_NEED_SIZE) {
+            return 0;
+        }
+        if (block == FEC_SWEEP_BLOCK) {
+            if (!ota_.isActive() || ota_.missingChunks() == 0) {
+                return 0;
+            }
+            block = static_cast<uint16_t>(ota_.nextMissing() / FEC_BLOCK_CHUNKS);
+        }
+        const uint8_t needed = neededFor(block);
+        if (needed == 0) {
+            return 0;
+        }
+        Wire::putU16(out, block);
+        out[2] = needed;
+        return OTA_BLOCK_NEED_SIZE;
+    }
+
+    void FecReceiver::resetStats() {
+        stats_ = {};
+    }
+
+    FecBroadcastConfig FecBroadcaster::defaultConfig() {
+        FecBroadcastConfig config;
+        config.startRepeats = 3;
+        config.redundancyPct = 10;
+        config.maxRedundancyPct = 100;
+        config.pollSlotMs = 2000;
+        config.maxPolls = 8;
+        config.quietSweeps = 6;
+        config.gapMs = 0;
+        return config;
+    }
+
+    FecBroadcaster::FecBroadcaster()
+        : FecBroadcaster(defaultConfig())
+    {
+    }
+
+    FecBroadcaster::FecBroadcaster(const FecBroadcastConfig& config)
+        : config_(config)
+        , state_(FecBroadcastState::IDLE)
+        , layout_()
+        , block_(0)
+        , seq_(0)
+        , remaining_(0)
+        , polls_(0)
+        , maxNeed_(0)
+        , startsSent_(0)
+        , redundancyPct_(config.redundancyPct)
+        , lastSentMs_(0)
+        , awaitingSent_(false)
+        , revisiting_(false)
+        , quietSweeps_(0)
+        , sweepBlock_(FEC_SWEEP_BLOCK)
+        , sweepNeed_(0)
+        , sweepPollDue_(false)
+        , stats_{}
+    {
+    }
+
+    bool FecBroadcaster::begin(uint32_t imageSize, uint16_t chunkSize, uint32_t nowMs) {
+        const FecLayout layout(imageSize, chunkSize);
+        if (imageSize == 0 || chunkSize == 0 || chunkSize > FEC_MAX_CHUNK ||
+            layout.chunkCount > OtaReceiver::MAX_CHUNKS) {
+            return false;
+        }
+        layout_ = layout;
+        block_ = 0;
+        seq_ = 0;
+        remaining_ = 0;
+        polls_ = 0;
+        maxNeed_ = 0;
+        startsSent_ = 0;
+        redundancyPct_ = config_.redundancyPct;
+        lastSentMs_ = nowMs;
+        awaitingSent_ = false;
+        revisiting_ = false;
+        quietSweeps_ = 0;
+        sweepBlock_ = FEC_SWEEP_BLOCK;
+        sweepNeed_ = 0;
+        sweepPollDue_ = false;
+        stats_ = {};
+        state_ = FecBroadcastState::STARTING;
+        return true;
+    }
+
+    void FecBroadcaster::cancel() {
+        state_ = FecBroadcastState::IDLE;
+    }
+
+    bool FecBroadcaster::isActive() const {
+        return state_ == FecBroadcastState::STARTING || state_ == FecBroadcastState::SENDING ||
+               state_ == FecBroadcastState::POLLING || state_ == FecBroadcastState::SWEEPING;
+    }
+
+    void FecBroadcaster::startBlock(uint16_t block) {
+        const uint8_t chunks = layout_.chunksInBlock(block);
+        block_ = block;
+        seq_ = 0;
+        remaining_ = static_cast<uint16_t>(chunks + (chunks * redundancyPct_ + 99) / 100);
+        polls_ = 0;
+        maxNeed_ = 0;
+        stats_.blocksSent++;
+        state_ = FecBroadcastState::SENDING;
+    }
+
+    // The first poll of a block shows whether the up-front repairs were right
+    void FecBroadcaster::finishBlock(bool firstPollClean) {
+        if (firstPollClean && !revisiting_ && redundancyPct_ >= 5) {
+            redundancyPct_ -= 5;
+        }
+        if (!revisiting_ && block_ + 1u < layout_.blockCount) {
+            startBlock(block_ + 1);
+            return;
+        }
+        revisiting_ = false;
+        quietSweeps_ = 0;
+        state_ = FecBroadcastState::SWEEPING;
+    }
+
+    FecAction FecBroadcaster::sendPoll(uint16_t& block) {
+        block = state_ == FecBroadcastState::SWEEPING ? FEC_SWEEP_BLOCK : block_;
+        maxNeed_ = 0;
+        sweepBlock_ = FEC_SWEEP_BLOCK;
+        sweepNeed_ = 0;
+        stats_.polls++;
+        awaitingSent_ = true;
+        return FecAction::POLL;
+    }
+
+    // Each sweep repeats OTA_CODED_START first so a listener that missed it can join late
+    FecAction FecBroadcaster::sendSweepStart() {
+        sweepPollDue_ = true;
+        awaitingSent_ = true;
+        return FecAction::START;
+    }
+
+    FecAction FecBroadcaster::next(uint32_t nowMs, uint16_t& block, uint32_t& mask) {
+        if (!isActive() || awaitingSent_) {
+            return FecAction::NONE;
+        }
+
+        if (state_ == FecBroadcastState::POLLING) {
+            if (nowMs - lastSentMs_ < config_.pollSlotMs) {
+                return FecAction::NONE;
+            }
+            const uint8_t chunks = layout_.chunksInBlock(block_);
+            if (maxNeed_ == 0) {
+                finishBlock(polls_ == 1);
+            } else if (polls_ >= config_.maxPolls) {
+                stats_.blocksGivenUp++;
+                finishBlock(false);
+            } else {
+                if (polls_ == 1 && !revisiting_) {
+                    const uint32_t raised = redundancyPct_ + (maxNeed_ * 100u + chunks - 1) / chunks;
+                    redundancyPct_ = static_cast<uint8_t>(raised > config_.maxRedundancyPct ? config_.maxRedundancyPct : raised);
+                }
+                remaining_ = maxNeed_;
+                state_ = FecBroadcastState::SENDING;
+            }
+            if (state_ == FecBroadcastState::SWEEPING) {
+                return sendSweepStart();
+            }
+        } else if (state_ == FecBroadcastState::SWEEPING) {
+            if (sweepPollDue_) {
+                sweepPollDue_ = false;
+                return sendPoll(block);
+            }
+            if (nowMs - lastSentMs_ < config_.pollSlotMs) {
+                return FecAction::NONE;
+            }
+            if (sweepNeed_ == 0) {
+                if (++quietSweeps_ >= config_.quietSweeps) {
+                    state_ = FecBroadcastState::DONE;
+                    return FecAction::NONE;
+                }
+                return sendSweepStart();
+            }
+            // Someone is still short: repairs only, with masks not sent before
+            block_ = sweepBlock_;
+            seq_ = static_cast<uint16_t>(0x8000u | (stats_.repairPackets & 0x7FFFu));
+            remaining_ = sweepNeed_;
+            polls_ = 0;
+            revisiting_ = true;
+            stats_.blocksRevisited++;
+            state_ = FecBroadcastState::SENDING;
+        }
+
+        if (nowMs - lastSentMs_ < config_.gapMs) {
+            return FecAction::NONE;
+        }
+
+        if (state_ == FecBroadcastState::STARTING) {
+            if (startsSent_ < config_.startRepeats) {
+                startsSent_++;
+                awaitingSent_ = true;
+                return FecAction::START;
+            }
+            startBlock(0);
+        }
+
+        if (remaining_ > 0) {
+            const uint8_t chunks = layout_.chunksInBlock(block_);
+            if (seq_ < chunks) {
+                mask = 1u << seq_;
+                stats_.sourcePackets++;
+            } else {
+                mask = fecRepairMask(block_, seq_, chunks);
+                stats_.repairPackets++;
+            }
+            block = block_;
+            seq_++;
+            remaining_--;
+            awaitingSent_ = true;
+            return FecAction::CODED;
+        }
+
+        state_ = FecBroadcastState::POLLING;
+        polls_++;
+        return sendPoll(block);
+    }
+
+    void FecBroadcaster::onSent(uint32_t nowMs, uint32_t airtimeUs) {
+        if (!awaitingSent_) {
+            return;
+        }
+        awaitingSent_ = false;
+        lastSentMs_ = nowMs;
+        stats_.framesSent++;
+        stats_.airtimeUs += airtimeUs;
+    }
+
+    bool FecBroadcaster::onNeed(const uint8_t* payload, size_t length) {
+        if (payload == nullptr || length != OTA_BLOCK_NEED_SIZE) {
+            return false;
+        }
+        stats_.needs++;
+        const uint16_t block = Wire::getU16(payload);
+        const uint8_t needed = payload[2];
+        if (needed == 0 || block >= layout_.blockCount) {
+            return true;
+        }
+        if (state_ == FecBroadcastState::POLLING && block == block_ && needed > maxNeed_) {
+            maxNeed_ = needed;
+        } else if (state_ == FecBroadcastState::SWEEPING) {
+            // Serve the lowest block first; several listeners may share it
+            if (block < sweepBlock_) {
+                sweepBlock_ = block;
+                sweepNeed_ = needed;
+            } else if (block == sweepBlock_ && needed > sweepNeed_) {
+                sweepNeed_ = needed;
+            }
+        }
+        return true;
+    }
+
+    uint8_t FecBroadcaster::percent() const {
+        if (layout_.blockCount == 0) {
+            return 0;
+        }
+        if (state_ == FecBroadcastState::DONE || state_ == FecBroadcastState::SWEEPING) {
+            return 100;
+        }
+        return static_cast<uint8_t>((static_cast<uint32_t>(block_) * 100) / layout_.blockCount);
+    }
+
+    const char* FecBroadcaster::stateToString(FecBroadcastState state) {
+        switch (state) {
+            case FecBroadcastState::IDLE: return "IDLE";
+            case FecBroadcastState::STARTING: return "STARTING";
+            case FecBroadcastState::SENDING: return "SENDING";
+            case FecBroadcastState::POLLING: return "POLLING";
+            case FecBroadcastState::SWEEPING: return "SWEEPING";
+            case FecBroadcastState::DONE: return "DONE";
+            default: return "UNKNOWN";
+        }
+    }
+}
@@ -0,0 +1,219 @@
+#pragma once
+
+#include "ota_receiver.h"
+#include "frame_codec.h"
+#include <stdint.h>
+#include <cstddef>
+
+// Erasure-coded firmware broadcast (one source, many listeners)
+//
+// The image is cut into blocks of up to 32 chunks. For each block the source
+// first sends the chunks themselves, then repair packets that XOR a random
+// subset of them. A listener can rebuild a block from any set of packets
+// that spans it. That is k packets with no loss, and about k + 2 once
+// repairs are involved, no matter which packets it missed. Coefficients are
+// a 32-bit mask in each packet; decoding is incremental Gaussian
+// elimination over GF(2) on one block at a time.
+//
+// After each block the source sends OTA_BLOCK_POLL. Listeners that cannot
+// decode yet answer, after a random backoff, with OTA_BLOCK_NEED carrying
+// their rank deficit. The source sends the largest deficit as fresh repair
+// packets, and each one helps every listener at once. Airtime per block
+// therefore follows the worst link rather than the node count. After the
+// last block, sweep polls (block 0xFFFF) ask for the lowest block any
+// listener still lacks, so a lost OTA_BLOCK_NEED costs a revisit, not the
+// image. Each sweep is preceded by OTA_CODED_START so a listener that missed every
+// earlier copy still joins and is served block by block.
+namespace LoRaLink {
+
+    constexpr size_t FEC_BLOCK_CHUNKS = 32;
+    constexpr size_t OTA_CODED_HEADER_SIZE = 6;     // u16 block, u32 coefficient mask
+    constexpr size_t FEC_MAX_CHUNK = MAX_PAYLOAD_SIZE - OTA_CODED_HEADER_SIZE;
+    constexpr size_t OTA_BLOCK_POLL_SIZE = 2;       // u16 block
+    constexpr size_t OTA_BLOCK_NEED_SIZE = 3;       // u16 block, u8 packets still needed
+    constexpr uint16_t FEC_SWEEP_BLOCK = 0xFFFF;    // Poll for "any block still short"
+
+    // Layout of an image split into coding blocks
+    struct FecLayout {
+        uint32_t imageSize;
+        uint16_t chunkSize;
+        uint32_t chunkCount;
+        uint16_t blockCount;
+
+        FecLayout();
+        FecLayout(uint32_t imageSize, uint16_t chunkSize);
+        uint8_t chunksInBlock(uint16_t block) const;
+        uint32_t firstChunk(uint16_t block) const { return static_cast<uint32_t>(block) * FEC_BLOCK_CHUNKS; }
+        size_t chunkLength(uint32_t chunk) const;
+    };
+
+    // Mask for repair packet seq (>= chunks) of a block; never zero
+    uint32_t fecRepairMask(uint16_t block, uint16_t seq, uint8_t chunks);
+
+    // Build an OTA_CODED payload: header plus the XOR of the masked chunks,
+    // short chunks zero-padded to chunkSize
+    size_t encodeCodedPacket(const FecLayout& layout, const uint8_t* image, uint16_t block,
+                             uint32_t mask, uint8_t* out, size_t outSize);
+    // Same, reading the chunks from flash or wherever the image is kept; 0 on a read error
+    size_t encodeCodedPacket(const FecLayout& layout, IImageSource& image, uint16_t block,
+                             uint32_t mask, uint8_t* out, size_t outSize);
+
+    enum class FecAddResult {
+        INNOVATIVE,     // Rank went up
+        REDUNDANT,      // Already spanned; dropped
+        INVALID         // Mask outside the block
+    };
+
+    // Incremental GF(2) decoder for one block
+    class FecDecoder {
+    public:
+        FecDecoder();
+
+        void begin(uint16_t block, uint8_t chunks, uint16_t chunkSize);
+        void reset();
+        FecAddResult add(uint32_t mask, const uint8_t* data);
+
+        bool isActive() const { return chunks_ > 0; }
+        uint16_t block() const { return block_; }
+        uint8_t chunks() const { return chunks_; }
+        uint8_t rank() const { return rank_; }
+        uint8_t needed() const { return static_cast<uint8_t>(chunks_ - rank_); }
+        bool isComplete() const { return chunks_ > 0 && rank_ == chunks_; }
+        // Source chunk i of the block; valid once isComplete()
+        const uint8_t* chunk(uint8_t i);
+
+    private:
+        uint16_t block_;
+        uint8_t chunks_;
+        uint16_t chunkSize_;
+        uint8_t rank_;
+        bool solved_;
+        uint32_t masks_[FEC_BLOCK_CHUNKS];          // Row with lowest set bit i lives at i
+        uint8_t rows_[FEC_BLOCK_CHUNKS][FEC_MAX_CHUNK];
+        uint8_t scratch_[FEC_MAX_CHUNK];
+
+        void solve();
+    };
+
+    struct FecReceiveStats {
+        uint32_t packets;
+        uint32_t innovative;
+        uint32_t redundant;
+        uint32_t blocksDecoded;
+        uint32_t blocksAbandoned;   // Left undecoded when a later block started
+    };
+
+    // Listener side: feeds OTA_CODED payloads through a decoder into an OtaReceiver.
+    // Chunks already in flash are read back into a new block's decoder, so a
+    // block only ever needs as many packets as it has missing chunks
+    class FecReceiver {
+    public:
+        FecReceiver(OtaReceiver& ota, IUpdateBackend& backend);
+
+        OtaResult onCoded(const uint8_t* payload, size_t length, uint32_t nowMs);
+        // Packets still needed for a block (0 when all its chunks are written)
+        uint8_t neededFor(uint16_t block) const;
+        // Answer to OTA_BLOCK_POLL; 0 when there is nothing to ask for
+        size_t encodeNeed(uint16_t block, uint8_t* out, size_t outSize) const;
+
+        const FecReceiveStats& getStats() const { return stats_; }
+        void resetStats();
+
+    private:
+        OtaReceiver& ota_;
+        IUpdateBackend& backend_;
+        FecDecoder decoder_;
+        FecReceiveStats stats_;
+
+        bool blockWritten(const FecLayout& layout, uint16_t block) const;
+        void beginBlock(const FecLayout& layout, uint16_t block);
+    };
+
+    enum class FecAction {
+        NONE,           // Pacing, or waiting out a poll slot
+        START,          // OTA_CODED_START (repeated, and again before each sweep)
+        CODED,          // OTA_CODED for block/mask
+        POLL            // OTA_BLOCK_POLL for block
+    };
+
+    enum class FecBroadcastState {
+        IDLE,
+        STARTING,
+        SENDING,
+        POLLING,        // Waiting out the answer slot of a block poll
+        SWEEPING,       // All blocks sent; asking who is still short
+        DONE
+    };
+
+    struct FecBroadcastConfig {
+        uint8_t startRepeats;       // OTA_CODED_START copies before the first block
+        uint8_t redundancyPct;      // Initial repairs per block, % of its chunks
+        uint8_t maxRedundancyPct;
+        uint32_t pollSlotMs;        // Window for OTA_BLOCK_NEED answers
+        uint8_t maxPolls;           // Per block before moving on
+        uint8_t quietSweeps;        // Unanswered sweeps that end the broadcast
+        uint32_t gapMs;             // Idle time between frames
+    };
+
+    struct FecBroadcastStats {
+        uint32_t sourcePackets;
+        uint32_t repairPackets;
+        uint32_t polls;
+        uint32_t needs;
+        uint32_t blocksSent;
+        uint32_t blocksRevisited;   // Sent again after a sweep
+        uint32_t blocksGivenUp;     // maxPolls reached with listeners still short
+        uint32_t framesSent;
+        uint32_t airtimeUs;
+    };
+
+    class FecBroadcaster {
+    public:
+        static FecBroadcastConfig defaultConfig();
+
+        FecBroadcaster();
+        explicit FecBroadcaster(const FecBroadcastConfig& config);
+
+        bool begin(uint32_t imageSize, uint16_t chunkSize, uint32_t nowMs);
+        void cancel();
+
+        FecAction next(uint32_t nowMs, uint16_t& block, uint32_t& mask);
+        void onSent(uint32_t nowMs, uint32_t airtimeUs = 0);
+        bool onNeed(const uint8_t* payload, size_t length);
+
+        FecBroadcastState getState() const { return state_; }
+        bool isActive() const;
+        const FecLayout& layout() const { return layout_; }
+        const FecBroadcastStats& getStats() const { return stats_; }
+        uint8_t redundancyPct() const { return redundancyPct_; }
+        uint16_t currentBlock() const { return block_; }
+        uint8_t percent() const;
+
+        static const char* stateToString(FecBroadcastState state);
+
+    private:
+        FecBroadcastConfig config_;
+        FecBroadcastState state_;
+        FecLayout layout_;
+        uint16_t block_;
+        uint16_t seq_;              // Next packet of the block; < chunks is systematic
+        uint16_t remaining_;        // Packets left in the current burst
+        uint8_t polls_;
+        uint8_t maxNeed_;
+        uint8_t startsSent_;
+        uint8_t redundancyPct_;
+        uint32_t lastSentMs_;
+        bool awaitingSent_;
+        bool revisiting_;
+        uint8_t quietSweeps_;
+        uint16_t sweepBlock_;       // Lowest block reported short in this sweep
+        uint8_t sweepNeed_;
+        bool sweepPollDue_;         // OTA_CODED_START went out; the sweep poll follows
+        FecBroadcastStats stats_;
+
+        void startBlock(uint16_t block);
+        void finishBlock(bool firstPollClean);
+        FecAction sendPoll(uint16_t& block);
+        FecAction sendSweepStart();
+    };
+}
@@ -0,0 +1,253 @@
+#include "ota_receiver.h"
+#include "frame_codec.h"
+#include <cstring>
+
+namespace LoRaLink {
+
+    size_t encodeOtaStart(const OtaStartInfo& info, uint8_t* out, size_t outSize) {
+        const size_t length = OTA_START_PAYLOAD_SIZE + (info.flags != 0 ? 1 : 0);
+        if (out == nullptr || outSize < length) {
+            return 0;
+        }
+        Wire::putU32(out, info.imageSize);
+        Wire::putU32(out + 4, info.timeoutMs);
+        Wire::putU16(out + 8, info.chunkSize);
+        memcpy(out + 10, info.sha256, Sha256::DIGEST_SIZE);
+        if (info.flags != 0) {
+            out[OTA_START_PAYLOAD_SIZE] = info.flags;
+        }
+        return length;
+    }
+
+    bool decodeOtaStart(const uint8_t* payload, size_t length, OtaStartInfo& info) {
+        if (payload == nullptr || (length != OTA_START_PAYLOAD_SIZE && length != OTA_START_PAYLOAD_SIZE + 1)) {
+            return false;
+        }
+        info.imageSize = Wire::getU32(payload);
+        info.timeoutMs = Wire::getU32(payload + 4);
+        info.chunkSize = Wire::getU16(payload + 8);
+        memcpy(info.sha256, payload + 10, Sha256::DIGEST_SIZE);
+        info.flags = length > OTA_START_PAYLOAD_SIZE ? payload[OTA_START_PAYLOAD_SIZE] : 0;
+        return true;
+    }
+
+    OtaReceiver::OtaReceiver(IUpdateBackend& backend)
+        : backend_(backend)
+        , state_(OtaState::IDLE)
+        , info_{}
+        , chunkCount_(0)
+        , lastActivityMs_(0)
+        , bitmap_{}
+        , stats_{}
+    {
+    }
+
+    OtaResult OtaReceiver::start(const OtaStartInfo& info, uint32_t nowMs) {
+        if (isActive()) {
+            backend_.abort();
+        }
+        state_ = OtaState::IDLE;
+
+        const size_t maxChunkData = MAX_PAYLOAD_SIZE - OTA_CHUNK_HEADER_SIZE;
+        if (info.imageSize == 0 || info.chunkSize == 0 || info.chunkSize > maxChunkData) {
+            return OtaResult::BAD_START;
+        }
+        const uint32_t chunks = (info.imageSize + info.chunkSize - 1) / info.chunkSize;
+        if (chunks > MAX_CHUNKS) {
+            return OtaResult::BAD_START;
+        }
+        if (!backend_.begin(info.imageSize)) {
+            state_ = OtaState::FAILED;
+            return OtaResult::BACKEND_ERROR;
+        }
+
+        info_ = info;
+        chunkCount_ = chunks;
+        lastActivityMs_ = nowMs;
+        memset(bitmap_, 0, sizeof(bitmap_));
+        stats_ = {};
+        state_ = OtaState::RECEIVING;
+        return OtaResult::OK;
+    }
+
+    size_t OtaReceiver::expectedLength(uint32_t index) const {
+        if (index + 1 < chunkCount_) {
+            return info_.chunkSize;
+        }
+        return info_.imageSize - static_cast<size_t>(index) * info_.chunkSize;
+    }
+
+    OtaResult OtaReceiver::onChunk(uint16_t index, const uint8_t* data, size_t length, uint32_t nowMs) {
+        if (!isActive()) {
+            return OtaResult::NOT_ACTIVE;
+        }
+        if (index >= chunkCount_ || data == nullptr || length != expectedLength(index)) {
+            stats_.rejected++;
+            return OtaResult::BAD_CHUNK;
+        }
+
+        lastActivityMs_ = nowMs;
+        if (hasChunk(index)) {
+            stats_.duplicates++;
+            return OtaResult::DUPLICATE;
+        }
+
+        if (!backend_.write(static_cast<size_t>(index) * info_.chunkSize, data, length)) {
+            return OtaResult::BACKEND_ERROR;
+        }
+        bitmap_[index >> 3] |= static_cast<uint8_t>(1u << (index & 7));
+        stats_.chunksWritten++;
+        stats_.bytesWritten += length;
+        return OtaResult::OK;
+    }
+
+    OtaResult OtaReceiver::finish() {
+        if (!isActive()) {
+            return OtaResult::NOT_ACTIVE;
+        }
+        if (missingChunks() > 0) {
+            return OtaResult::INCOMPLETE;
+        }
+
+        // Hash what actually landed in flash, in bounded blocks
+        Sha256 sha;
+        uint8_t block[VERIFY_BLOCK];
+        for (size_t offset = 0; offset < info_.imageSize; offset += sizeof(block)) {
+            size_t n = info_.imageSize - offset;
+            if (n > sizeof(block)) {
+                n = sizeof(block);
+            }
+            if (!backend_.read(offset, block, n)) {
+                abort();
+                return OtaResult::BACKEND_ERROR;
+            }
+            sha.update(block, n);
+        }
+        uint8_t digest[Sha256::DIGEST_SIZE];
+        sha.finish(digest);
+
+        if (memcmp(digest, info_.sha256, sizeof(digest)) != 0) {
+            abort();
+            return OtaResult::HASH_MISMATCH;
+        }
+        if (!backend_.finish()) {
+            state_ = OtaState::FAILED;
+            return OtaResult::BACKEND_ERROR;
+        }
+        state_ = OtaState::COMPLETE;
+        return OtaResult::OK;
+    }
+
+    void OtaReceiver::abort() {
+        if (isActive()) {
+            backend_.abort();
+        }
+        state_ = OtaState::FAILED;
+    }
+
+    bool OtaReceiver::checkTimeout(uint32_t nowMs) {
+        if (isActive() && nowMs - lastActivityMs_ > info_.timeoutMs) {
+            abort();
+            return true;
+        }
+        return false;
+    }
+
+    bool OtaReceiver::hasChunk(uint32_t index) const {
+        return index < chunkCount_ && (bitmap_[index >> 3] & (1u << (index & 7))) != 0;
+    }
+
+    uint32_t OtaReceiver::nextMissing(uint32_t from) const {
+        for (uint32_t i = from; i < chunkCount_; ++i) {
+            if (!hasChunk(i)) {
+                return i;
+            }
+        }
+        return chunkCount_;
+    }
+
+    uint8_t OtaReceiver::percent() const {
+        if (chunkCount_ == 0) {
+            return 0;
+        }
+        return static_cast<uint8_t>((static_cast<uint64_t>(stats_.chunksWritten) * 100) / chunkCount_);
+    }
+
+    const char* OtaReceiver::resultToString(OtaResult result) {
+        switch (result) {
+            case OtaResult::OK: return "OK";
+            case OtaResult::DUPLICATE: return "DUPLICATE";
+            case OtaResult::NOT_ACTIVE: return "NOT_ACTIVE";
+            case OtaResult::BAD_START: return "BAD_START";
+            case OtaResult::BAD_CHUNK: return "BAD_CHUNK";
+            case OtaResult::BACKEND_ERROR: return "BACKEND_ERROR";
+            case OtaResult::INCOMPLETE: return "INCOMPLETE";
+            case OtaResult::HASH_MISMATCH: return "HASH_MISMATCH";
+            default: return "UNKNOWN";
+        }
+    }
+
+    bool hashImage(IImageSource& image, uint8_t digest[Sha256::DIGEST_SIZE]) {
+        Sha256 sha;
+        uint8_t buffer[256];
+        for (size_t offset = 0; offset < image.size(); offset += sizeof(buffer)) {
+            size_t n = image.size() - offset;
+            if (n > sizeof(buffer)) {
+                n = sizeof(buffer);
+            }
+            if (!image.read(offset, buffer, n)) {
+                return false;
+            }
+            sha.update(buffer, n);
+        }
+        sha.finish(digest);
+        return true;
+    }
+
+    bool MemoryImage::read(size_t offset, uint8_t* data, size_t length) {
+        if (data_ == nullptr || offset > size_ || length > size_ - offset) {
+            return false;
+        }
+        memcpy(data, data_ + offset, length);
+        return true;
+    }
+
+    BackendReader::BackendReader(IUpdateBackend& backend, size_t offset, size_t size)
+        : backend_(backend)
+        , offset_(offset)
+        , size_(size)
+        , pos_(0)
+        , bufferStart_(0)
+        , bufferLength_(0)
+        , buffer_{}
+    {
+    }
+
+    bool BackendReader::read(uint8_t* data, size_t length) {
+        if (length > size_ - pos_) {
+            return false;
+        }
+        while (length > 0) {
+            if (pos_ >= bufferStart_ + bufferLength_) {
+                bufferStart_ = pos_;
+                bufferLength_ = size_ - pos_;
+                if (bufferLength_ > sizeof(buffer_)) {
+                    bufferLength_ = sizeof(buffer_);
+                }
+                if (!backend_.read(offset_ + bufferStart_, buffer_, bufferLength_)) {
+                    bufferLength_ = 0;
+                    return false;
+                }
+            }
+            size_t n = bufferStart_ + bufferLength_ - pos_;
+            if (n > length) {
+                n = length;
+            }
+            memcpy(data, buffer_ + (pos_ - bufferStart_), n);
+            pos_ += n;
+            data += n;
+            length -= n;
+        }
+        return true;
+    }
+}
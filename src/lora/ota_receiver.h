@@ -0,0 +1,179 @@
+#pragma once
+
+#include "sha256.h"
+#include <stdint.h>
+#include <cstddef>
+
+// Streaming LoRa OTA receiver
+//
+// OTA_START announces the image size, chunk size and SHA-256; each OTA_DATA
+// chunk (already CRC-checked by the frame codec) is written straight to the
+// update partition at chunkIndex * chunkSize, so RAM use is bounded by the
+// chunk bitmap regardless of image size. Progress is tracked per chunk index,
+// which makes duplicates harmless and tells a sender exactly what is missing.
+// finish() reads the written image back and checks the whole-image hash
+// before the backend is asked to make it bootable.
+namespace LoRaLink {
+
+    // Flash writer used by OtaReceiver; ESP-IDF OTA API on the device, RAM in tests
+    class IUpdateBackend {
+    public:
+        virtual ~IUpdateBackend() = default;
+
+        // Prepare (erase) space for an image of imageSize bytes
+        virtual bool begin(size_t imageSize) = 0;
+        // Write at an absolute offset; chunks may arrive in any order
+        virtual bool write(size_t offset, const uint8_t* data, size_t length) = 0;
+        // Read back written data for verification
+        virtual bool read(size_t offset, uint8_t* data, size_t length) = 0;
+        // Image verified: make it the next boot target
+        virtual bool finish() = 0;
+        // Discard a partial image
+        virtual void abort() = 0;
+        // Bytes the update partition can hold
+        virtual size_t capacity() const = 0;
+    };
+
+    // Read-only random access to a whole image: the running app (delta base),
+    // a stored firmware image (distribution)
+    class IImageSource {
+    public:
+        virtual ~IImageSource() = default;
+
+        virtual size_t size() const = 0;
+        virtual bool read(size_t offset, uint8_t* data, size_t length) = 0;
+    };
+
+    // SHA-256 of a whole image, read through a small buffer; false on a read error
+    bool hashImage(IImageSource& image, uint8_t digest[Sha256::DIGEST_SIZE]);
+
+    // IImageSource over an image already in memory
+    class MemoryImage : public IImageSource {
+    public:
+        MemoryImage(const uint8_t* data, size_t size) : data_(data), size_(size) {}
+
+        size_t size() const override { return size_; }
+        bool read(size_t offset, uint8_t* data, size_t length) override;
+
+    private:
+        const uint8_t* data_;
+        size_t size_;
+    };
+
+    // Sequential reader over a staged transfer (delta patch, compressed stream)
+    class IByteSource {
+    public:
+        virtual ~IByteSource() = default;
+
+        // Fills data completely; false if fewer than length bytes are left or a read fails
+        virtual bool read(uint8_t* data, size_t length) = 0;
+        virtual size_t remaining() const = 0;
+    };
+
+    // IByteSource over a region of a backend, read through a small buffer
+    class BackendReader : public IByteSource {
+    public:
+        static constexpr size_t BUFFER_SIZE = 256;
+
+        BackendReader(IUpdateBackend& backend, size_t offset, size_t size);
+
+        bool read(uint8_t* data, size_t length) override;
+        size_t remaining() const override { return size_ - pos_; }
+
+    private:
+        IUpdateBackend& backend_;
+        size_t offset_;
+        size_t size_;
+        size_t pos_;
+        size_t bufferStart_;
+        size_t bufferLength_;
+        uint8_t buffer_[BUFFER_SIZE];
+    };
+
+    // OTA_START payload: u32 size, u32 timeout ms, u16 chunk size, 32-byte SHA-256,
+    // then an optional u8 flags byte (omitted when zero)
+    struct OtaStartInfo {
+        uint32_t imageSize;
+        uint32_t timeoutMs;     // Inactivity timeout
+        uint16_t chunkSize;
+        uint8_t sha256[Sha256::DIGEST_SIZE];
+        uint8_t flags = 0;      // OTA_START_FLAG_*
+    };
+
+    constexpr size_t OTA_START_PAYLOAD_SIZE = 4 + 4 + 2 + Sha256::DIGEST_SIZE;
+    constexpr uint8_t OTA_START_FLAG_DELTA = 0x01;  // Transfer is a patch against the running image
+    constexpr uint8_t OTA_START_FLAG_LZSS = 0x02;   // Transfer is LZSS-compressed
+    constexpr size_t OTA_CHUNK_HEADER_SIZE = 2;     // u16 chunk index
+
+    size_t encodeOtaStart(const OtaStartInfo& info, uint8_t* out, size_t outSize);
+    bool decodeOtaStart(const uint8_t* payload, size_t length, OtaStartInfo& info);
+
+    enum class OtaResult {
+        OK,
+        DUPLICATE,          // Chunk already written (not an error)
+        NOT_ACTIVE,
+        BAD_START,          // Size/chunk size out of range
+        BAD_CHUNK,          // Index out of range or wrong length
+        BACKEND_ERROR,
+        INCOMPLETE,         // finish() with chunks still missing
+        HASH_MISMATCH
+    };
+
+    enum class OtaState {
+        IDLE,
+        RECEIVING,
+        COMPLETE,
+        FAILED
+    };
+
+    struct OtaStats {
+        uint32_t chunksWritten;
+        uint32_t duplicates;
+        uint32_t rejected;
+        uint32_t bytesWritten;
+    };
+
+    class OtaReceiver {
+    public:
+        // 2 KB bitmap: 16384 chunks, >3 MB at 200-byte chunks
+        static constexpr size_t MAX_CHUNKS = 16384;
+        static constexpr size_t VERIFY_BLOCK = 256;
+
+        explicit OtaReceiver(IUpdateBackend& backend);
+
+        OtaResult start(const OtaStartInfo& info, uint32_t nowMs);
+        OtaResult onChunk(uint16_t index, const uint8_t* data, size_t length, uint32_t nowMs);
+        // All chunks present: verify the image hash and hand over to the backend
+        OtaResult finish();
+        void abort();
+        // True (and the session aborted) if no chunk arrived within the timeout
+        bool checkTimeout(uint32_t nowMs);
+
+        OtaState getState() const { return state_; }
+        bool isActive() const { return state_ == OtaState::RECEIVING; }
+        const OtaStartInfo& getInfo() const { return info_; }
+        const OtaStats& getStats() const { return stats_; }
+        uint32_t lastActivityMs() const { return lastActivityMs_; }
+
+        uint32_t chunkCount() const { return chunkCount_; }
+        uint32_t chunksReceived() const { return stats_.chunksWritten; }
+        uint32_t missingChunks() const { return chunkCount_ - stats_.chunksWritten; }
+        bool hasChunk(uint32_t index) const;
+        // Lowest missing chunk index at or after from; chunkCount() when none
+        uint32_t nextMissing(uint32_t from = 0) const;
+        uint8_t percent() const;
+
+        static const char* resultToString(OtaResult result);
+
+    private:
+        IUpdateBackend& backend_;
+        OtaState state_;
+        OtaStartInfo info_;
+        uint32_t chunkCount_;
+        uint32_t lastActivityMs_;
+        uint8_t bitmap_[MAX_CHUNKS / 8];
+        OtaStats stats_;
+
+        size_t expectedLength(uint32_t index) const;
+    };
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <stdint.h>
+#include <cstddef>
+
+// Minimal radio driver interface used by the LoRa link engines
+// The firmware wraps RadioLib's SX1262; the native build uses MockRadio
+namespace LoRaLink {
+
+    // Status codes mirror RadioLib so drivers can pass them straight through
+    namespace RadioStatus {
+        constexpr int OK = 0;
+        constexpr int ERR_UNKNOWN = -1;
+        constexpr int ERR_PACKET_TOO_LONG = -4;
+        constexpr int ERR_RX_TIMEOUT = -6;
+        constexpr int ERR_CRC_MISMATCH = -7;
+        // Channel activity detection results (not errors)
+        constexpr int CHANNEL_FREE = -15;
+        constexpr int LORA_DETECTED = 1;
+    }
+
+    class IRadioDriver {
+    public:
+        virtual ~IRadioDriver() = default;
+
+        // Enter continuous receive; DIO1 fires on every RxDone
+        virtual int startReceive() = 0;
+
+        // Copy the packet currently held in the radio FIFO
+        virtual int readPacket(uint8_t* buffer, size_t bufferSize, size_t& length) = 0;
+
+        // Signal quality of the last packet read
+        virtual float getRSSI() = 0;
+        virtual float getSNR() = 0;
+
+        // Begin a non-blocking transmission; DIO1 fires on TxDone
+        virtual int startTransmit(const uint8_t* data, size_t length) = 0;
+        // Clean up after TxDone (clears IRQ flags, returns to standby)
+        virtual int finishTransmit() = 0;
+
+        // Leave receive/transmit mode
+        virtual int standby() = 0;
+
+        // Channel activity detection; DIO1 fires on CadDone
+        virtual int startChannelScan() = 0;
+        // After CadDone: LORA_DETECTED when chirps were heard, else CHANNEL_FREE
+        virtual int getChannelScanResult() = 0;
+        // Lowest-power mode that keeps the configuration (warm start on the next command)
+        virtual int sleep() = 0;
+        // Alternate rxUs of receive and sleepUs of warm sleep until a packet
+        // arrives; DIO1 fires on its RxDone and the radio drops to standby
+        virtual int startReceiveDutyCycle(uint32_t rxUs, uint32_t sleepUs) = 0;
+    };
+
+    // Modulation setters, one per SX1262 parameter (RadioLib's setters on the
+    // device). RadioProfileManager only calls the ones whose value changed.
+    class IRadioConfig {
+    public:
+        virtual ~IRadioConfig() = default;
+
+        // calibrateImage: rerun image calibration, needed when the band changes
+        virtual int setFrequency(float freqMHz, bool calibrateImage) = 0;
+        virtual int setBandwidth(float bwKHz) = 0;
+        virtual int setSpreadingFactor(uint8_t sf) = 0;
+        virtual int setCodingRate(uint8_t cr) = 0;
+        virtual int setOutputPower(int8_t dBm) = 0;
+    };
+}
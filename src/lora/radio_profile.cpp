@@ -0,0 +1,114 @@
+#include "radio_profile.h"
+
+namespace LoRaLink {
+
+    uint8_t imageCalibrationBand(float freqMHz) {
+        if (freqMHz > 900.0f) {
+            return 4;   // 902-928 MHz
+        }
+        if (freqMHz > 850.0f) {
+            return 3;   // 863-870 MHz
+        }
+        if (freqMHz > 770.0f) {
+            return 2;   // 779-787 MHz
+        }
+        if (freqMHz > 460.0f) {
+            return 1;   // 470-510 MHz
+        }
+        return 0;       // 430-440 MHz
+    }
+
+    RadioProfileManager::RadioProfileManager(IRadioConfig& radio, ClockUs clock)
+        : radio_(radio)
+        , clock_(clock)
+        , current_{}
+        , band_(0)
+        , known_(0)
+        , stats_{}
+    {
+    }
+
+    void RadioProfileManager::assume(const ConfigPayload& profile) {
+        current_ = profile;
+        band_ = imageCalibrationBand(profile.freqMHz);
+        known_ = ALL_FIELDS;
+    }
+
+    void RadioProfileManager::invalidate() {
+        known_ = 0;
+    }
+
+    int RadioProfileManager::restore(const ConfigPayload& profile) {
+        band_ = imageCalibrationBand(profile.freqMHz);
+        known_ = FIELD_BAND;
+        return apply(profile);
+    }
+
+    bool RadioProfileManager::wrote(Field field, int status, int& result) {
+        stats_.writes++;
+        if (status != RadioStatus::OK) {
+            known_ &= static_cast<uint8_t>(~field);
+            stats_.failures++;
+            result = status;
+            return false;
+        }
+        known_ |= field;
+        return true;
+    }
+
+    int RadioProfileManager::apply(const ConfigPayload& target) {
+        const uint32_t startUs = clock_ != nullptr ? clock_() : 0;
+        const uint32_t writesBefore = stats_.writes;
+        int result = RadioStatus::OK;
+        stats_.applies++;
+
+        // Frequency first: a failed hop must not leave new modulation on the old channel
+        const uint8_t band = imageCalibrationBand(target.freqMHz);
+        const bool calibrate = needs(FIELD_BAND, band != band_);
+        bool ok = true;
+        if (needs(FIELD_FREQ, target.freqMHz != current_.freqMHz) || calibrate) {
+            // Until the write succeeds neither the channel nor the calibration is known
+            known_ &= static_cast<uint8_t>(~FIELD_BAND);
+            ok = wrote(FIELD_FREQ, radio_.setFrequency(target.freqMHz, calibrate), result);
+            if (ok) {
+                current_.freqMHz = target.freqMHz;
+                band_ = band;
+                known_ |= FIELD_BAND;
+                stats_.calibrations += calibrate ? 1 : 0;
+            }
+        }
+        if (ok && needs(FIELD_BW, target.bwKHz != current_.bwKHz)) {
+            ok = wrote(FIELD_BW, radio_.setBandwidth(target.bwKHz), result);
+            current_.bwKHz = target.bwKHz;
+        }
+        if (ok && needs(FIELD_SF, target.sf != current_.sf)) {
+            ok = wrote(FIELD_SF, radio_.setSpreadingFactor(target.sf), result);
+            current_.sf = target.sf;
+        }
+        if (ok && needs(FIELD_CR, target.cr != current_.cr)) {
+            ok = wrote(FIELD_CR, radio_.setCodingRate(target.cr), result);
+            current_.cr = target.cr;
+        }
+        if (ok && needs(FIELD_POWER, target.txPower != current_.txPower)) {
+            ok = wrote(FIELD_POWER, radio_.setOutputPower(target.txPower), result);
+            current_.txPower = target.txPower;
+        }
+
+        const uint32_t writes = stats_.writes - writesBefore;
+        if (ok) {
+            stats_.skipped += 5 - writes;
+            stats_.unchanged += writes == 0 ? 1 : 0;
+        }
+        const uint32_t elapsed = clock_ != nullptr ? clock_() - startUs : 0;
+        stats_.lastUs = elapsed;
+        stats_.totalUs += elapsed;
+        if (elapsed > stats_.maxUs) {
+            stats_.maxUs = elapsed;
+        }
+        return result;
+    }
+
+    void RadioProfileManager::resetStats() {
+        stats_ = {};
+    }
+}
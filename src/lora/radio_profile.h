@@ -0,0 +1,87 @@
+#pragma once
+
+#include "radio_driver.h"
+#include "frame_codec.h"
+#include <stdint.h>
+#include <cstddef>
+
+// Incremental SX1262 reconfiguration
+//
+// radio.begin() resets the chip, recalibrates every block and rewrites every
+// setting. That is needed once at boot, but hopping between the data and
+// control channels or changing one parameter only needs the setters whose
+// value differs. RadioProfileManager remembers what the radio was last set
+// to and diffs each requested profile against it. It only reruns image
+// calibration when the frequency leaves the calibrated band. RF switch, CRC,
+// sync word and preamble survive setter calls, so they stay as begin() left
+// them.
+//
+// After a warm sleep restore() rewrites every setter so a fresh driver knows
+// the settings again, without resetting or recalibrating the chip.
+//
+// A setter that fails leaves its parameter unknown, so the next apply()
+// writes it again. Every apply() is timed with the supplied clock.
+namespace LoRaLink {
+
+    // Image calibration bands used by RadioLib's SX126x::calibrateImage()
+    uint8_t imageCalibrationBand(float freqMHz);
+
+    struct RadioSwitchStats {
+        uint32_t applies;           // apply() calls
+        uint32_t unchanged;         // Calls that found nothing to write
+        uint32_t writes;            // Setter calls issued
+        uint32_t skipped;           // Setter calls the diff saved
+        uint32_t calibrations;      // Frequency writes that recalibrated the image
+        uint32_t failures;
+        uint32_t lastUs;            // Duration of the last apply()
+        uint32_t maxUs;
+        uint64_t totalUs;
+    };
+
+    class RadioProfileManager {
+    public:
+        typedef uint32_t (*ClockUs)();
+
+        RadioProfileManager(IRadioConfig& radio, ClockUs clock);
+
+        // The radio was just initialised with this profile (radio.begin())
+        void assume(const ConfigPayload& profile);
+        // Radio state unknown (reset, sleep without retention); next apply() writes everything
+        void invalidate();
+        // Warm wake: the chip kept its registers and image calibration through
+        // sleep but the driver starts from scratch, so write every setter
+        // once more without calibrating
+        int restore(const ConfigPayload& profile);
+
+        // Bring the radio to target with only the setters that changed;
+        // returns the first failing status or RadioStatus::OK
+        int apply(const ConfigPayload& target);
+
+        bool isKnown() const { return known_ == ALL_FIELDS; }
+        const ConfigPayload& current() const { return current_; }
+        const RadioSwitchStats& getStats() const { return stats_; }
+        void resetStats();
+
+    private:
+        enum Field : uint8_t {
+            FIELD_FREQ  = 1 << 0,
+            FIELD_BW    = 1 << 1,
+            FIELD_SF    = 1 << 2,
+            FIELD_CR    = 1 << 3,
+            FIELD_POWER = 1 << 4,
+            FIELD_BAND  = 1 << 5,   // Image calibrated for band_
+            ALL_FIELDS  = 0x3F
+        };
+
+        IRadioConfig& radio_;
+        ClockUs clock_;
+        ConfigPayload current_;
+        uint8_t band_;
+        uint8_t known_;
+        RadioSwitchStats stats_;
+
+        bool needs(Field field, bool differs) const { return !(known_ & field) || differs; }
+        // Record a setter's outcome; false stops the apply()
+        bool wrote(Field field, int status, int& result);
+    };
+}
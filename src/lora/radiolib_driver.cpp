@@ -0,0 +1,29 @@
+#include "radiolib_driver.h"
+
+namespace LoRaLink {
+
+    int RadioLibDriver::startReceive() {
+        // No timeout: the SX1262 stays in RX after each RxDone
+        return radio_.startReceive();
+    }
+
+    int RadioLibDriver::readPacket(uint8_t* buffer, size_t bufferSize, size_t& length) {
+        length = radio_.getPacketLength();
+        if (length > bufferSize) {
+            length = bufferSize;
+        }
+        int st = radio_.readData(buffer, length);
+        if (st != RADIOLIB_ERR_NONE) {
+            length = 0;
+        }
+        return st;
+    }
+
+    int RadioLibDriver::getChannelScanResult() {
+        const int st = radio_.getChannelScanResult();
+        if (st == RADIOLIB_LORA_DETECTED) {
+            return RadioStatus::LORA_DETECTED;
+        }
+        return st == RADIOLIB_CHANNEL_FREE ? RadioStatus::CHANNEL_FREE : st;
+    }
+}
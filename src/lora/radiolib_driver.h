@@ -0,0 +1,45 @@
+#pragma once
+
+#include "radio_driver.h"
+#include <RadioLib.h>
+
+// IRadioDriver and IRadioConfig backed by RadioLib's SX1262 (firmware builds only)
+namespace LoRaLink {
+
+    class RadioLibDriver : public IRadioDriver, public IRadioConfig {
+    public:
+        explicit RadioLibDriver(SX1262& radio) : radio_(radio) {}
+
+        // Route DIO1 (RxDone/TxDone) to an ISR
+        void setDio1Action(void (*isr)(void)) { radio_.setDio1Action(isr); }
+
+        int startReceive() override;
+        int readPacket(uint8_t* buffer, size_t bufferSize, size_t& length) override;
+        float getRSSI() override { return radio_.getRSSI(); }
+        float getSNR() override { return radio_.getSNR(); }
+        int startTransmit(const uint8_t* data, size_t length) override {
+            // RadioLib 6.x takes a non-const buffer but does not modify it
+            return radio_.startTransmit(const_cast<uint8_t*>(data), length);
+        }
+        int finishTransmit() override { return radio_.finishTransmit(); }
+        int standby() override { return radio_.standby(); }
+        int startChannelScan() override { return radio_.startChannelScan(); }
+        int getChannelScanResult() override;
+        int sleep() override { return radio_.sleep(true); }
+        int startReceiveDutyCycle(uint32_t rxUs, uint32_t sleepUs) override {
+            return radio_.startReceiveDutyCycle(rxUs, sleepUs);
+        }
+
+        // IRadioConfig
+        int setFrequency(float freqMHz, bool calibrateImage) override {
+            return radio_.setFrequency(freqMHz, calibrateImage);
+        }
+        int setBandwidth(float bwKHz) override { return radio_.setBandwidth(bwKHz); }
+        int setSpreadingFactor(uint8_t sf) override { return radio_.setSpreadingFactor(sf); }
+        int setCodingRate(uint8_t cr) override { return radio_.setCodingRate(cr); }
+        int setOutputPower(int8_t dBm) override { return radio_.setOutputPower(dBm); }
+
+    private:
+        SX1262& radio_;
+    };
+}
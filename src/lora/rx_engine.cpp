@@ -0,0 +1,145 @@
+#include "rx_engine.h"
+#include <cstring>
+
+namespace LoRaLink {
+
+    RxEngine::RxEngine(IRadioDriver& radio, FramePool& pool)
+        : radio_(radio)
+        , pool_(pool)
+        , active_(false)
+        , irqStamps_{}
+        , irqHead_(0)
+        , irqTail_(0)
+        , irqOverflow_(0)
+        , queue_{}
+        , head_(0)
+        , count_(0)
+        , dutyRxUs_(0)
+        , dutySleepUs_(0)
+        , stats_{}
+    {
+    }
+
+    int RxEngine::begin() {
+        while (count_ > 0) {
+            pool_.release(pop());
+        }
+        head_ = 0;
+        resetStats();
+        return resume();
+    }
+
+    void RxEngine::suspend() {
+        active_.store(false, std::memory_order_release);
+        radio_.standby();
+        clearPendingIrqs();
+    }
+
+    int RxEngine::resume() {
+        clearPendingIrqs();
+        active_.store(true, std::memory_order_release);
+        return listen();
+    }
+
+    int RxEngine::listen() {
+        if (dutySleepUs_ > 0) {
+            return radio_.startReceiveDutyCycle(dutyRxUs_, dutySleepUs_);
+        }
+        return radio_.startReceive();
+    }
+
+    void RxEngine::clearPendingIrqs() {
+        irqTail_.store(irqHead_.load(std::memory_order_acquire), std::memory_order_release);
+        irqOverflow_.store(0, std::memory_order_relaxed);
+    }
+
+    size_t RxEngine::poll() {
+        const uint8_t head = irqHead_.load(std::memory_order_acquire);
+        uint8_t tail = irqTail_.load(std::memory_order_relaxed);
+        if (head == tail) {
+            return 0;
+        }
+
+        const size_t pending = (head + IRQ_DEPTH - tail) % IRQ_DEPTH;
+        const uint32_t lost = irqOverflow_.exchange(0, std::memory_order_relaxed);
+        stats_.interrupts += pending + lost;
+
+        // Only the newest frame is still in the radio FIFO
+        stats_.overruns += (pending - 1) + lost;
+        const uint8_t newest = static_cast<uint8_t>((head + IRQ_DEPTH - 1) % IRQ_DEPTH);
+        const uint32_t timestampUs = irqStamps_[newest];
+        irqTail_.store(head, std::memory_order_release);
+
+        const size_t queued = readNewest(timestampUs);
+        // RX duty cycle ends with the packet; continuous RX carries on by itself
+        if (dutySleepUs_ > 0 && active_.load(std::memory_order_acquire)) {
+            listen();
+        }
+        return queued;
+    }
+
+    size_t RxEngine::readNewest(uint32_t timestampUs) {
+        RxFrame* slot = count_ < QUEUE_DEPTH ? pool_.acquire() : nullptr;
+        if (slot == nullptr) {
+            // Drain the FIFO anyway so the radio keeps a clean IRQ state
+            uint8_t scratch[MAX_FRAME_SIZE];
+            size_t len = 0;
+            radio_.readPacket(scratch, sizeof(scratch), len);
+            stats_.queueDrops++;
+            return 0;
+        }
+
+        // The radio reads straight into the pooled buffer
+        size_t len = 0;
+        int st = radio_.readPacket(slot->data, sizeof(slot->data), len);
+        if (st != RadioStatus::OK || len == 0) {
+            pool_.release(slot);
+            stats_.readErrors++;
+            return 0;
+        }
+
+        slot->length = len;
+        slot->timestampUs = timestampUs;
+        slot->rssi = radio_.getRSSI();
+        slot->snr = radio_.getSNR();
+        queue_[(head_ + count_) % QUEUE_DEPTH] = slot;
+        count_++;
+        stats_.received++;
+        if (count_ > stats_.highWater) {
+            stats_.highWater = count_;
+        }
+        return 1;
+    }
+
+    RxFrame* RxEngine::pop() {
+        if (count_ == 0) {
+            return nullptr;
+        }
+
+        RxFrame* slot = queue_[head_];
+        queue_[head_] = nullptr;
+        head_ = (head_ + 1) % QUEUE_DEPTH;
+        count_--;
+        return slot;
+    }
+
+    bool RxEngine::pop(RxFrame& frame) {
+        RxFrame* slot = pop();
+        if (slot == nullptr) {
+            return false;
+        }
+
+        memcpy(frame.data, slot->data, slot->length);
+        frame.length = slot->length;
+        frame.timestampUs = slot->timestampUs;
+        frame.rssi = slot->rssi;
+        frame.snr = slot->snr;
+        pool_.release(slot);
+        return true;
+    }
+
+    void RxEngine::resetStats() {
+        stats_ = {};
+        stats_.highWater = count_;
+    }
+}
@@ -0,0 +1,122 @@
+#pragma once
+
+#include "frame_codec.h"
+#include "frame_pool.h"
+#include "radio_driver.h"
+#include <stdint.h>
+#include <cstddef>
+#include <atomic>
+
+// Interrupt-driven receive path
+//
+// The radio sits in continuous RX. The DIO1 ISR only timestamps the RxDone
+// edge into a bounded event ring (SPI is not ISR-safe on the ESP32); poll()
+// runs from the main loop, reads the radio FIFO straight into a FramePool
+// buffer and queues it with the ISR timestamp; pop() hands that buffer to the
+// caller without copying. The SX1262 FIFO holds a single packet, so when
+// several edges are pending only the newest frame can still be read and the
+// older ones are counted as overruns.
+//
+// With setDutyCycle() the radio listens in RX duty cycle instead of
+// continuous RX (see rx_power.h). It stops after each packet, so poll()
+// re-arms it once the FIFO has been read.
+namespace LoRaLink {
+
+    struct RxStats {
+        uint32_t interrupts;    // DIO1 edges seen while active
+        uint32_t received;      // Frames queued
+        uint32_t overruns;      // Frames overwritten in the radio FIFO before poll()
+        uint32_t queueDrops;    // Frames lost because the queue or the pool was full
+        uint32_t readErrors;    // CRC or SPI errors while reading the FIFO
+        size_t highWater;       // Maximum queue depth observed
+    };
+
+    class RxEngine {
+    public:
+        static constexpr size_t QUEUE_DEPTH = 8;
+        static constexpr size_t IRQ_DEPTH = 16;
+
+        RxEngine(IRadioDriver& radio, FramePool& pool);
+
+        // Release queued frames, reset statistics and enter continuous receive
+        int begin();
+
+        // Stop listening (e.g. before a blocking transmit); ISR edges are ignored
+        void suspend();
+        // Drop stale edges and re-enter continuous receive
+        int resume();
+        bool isActive() const { return active_.load(std::memory_order_acquire); }
+
+        // RX duty cycle from the next resume(); sleepUs 0 means continuous RX
+        void setDutyCycle(uint32_t rxUs, uint32_t sleepUs) { dutyRxUs_ = rxUs; dutySleepUs_ = sleepUs; }
+        bool isDutyCycled() const { return dutySleepUs_ > 0; }
+        // An edge is latched and not yet polled
+        bool hasPendingIrq() const {
+            return irqHead_.load(std::memory_order_acquire) != irqTail_.load(std::memory_order_acquire);
+        }
+
+        // ISR context: latch the edge only
+        void onDio1(uint32_t timestampUs) {
+            if (!active_.load(std::memory_order_relaxed)) {
+                return;
+            }
+            const uint8_t head = irqHead_.load(std::memory_order_relaxed);
+            const uint8_t next = static_cast<uint8_t>((head + 1) % IRQ_DEPTH);
+            if (next == irqTail_.load(std::memory_order_acquire)) {
+                irqOverflow_.fetch_add(1, std::memory_order_relaxed);
+                return;
+            }
+            irqStamps_[head] = timestampUs;
+            irqHead_.store(next, std::memory_order_release);
+        }
+
+        // Main loop, after light sleep: DIO1 still high with no edge latched
+        // means RxDone rose while the pin was a level wake source, which
+        // swallows the edge. Latches it once; repeat calls add nothing.
+        void onWake(bool dio1High, uint32_t timestampUs) {
+            if (dio1High && !hasPendingIrq()) {
+                onDio1(timestampUs);
+            }
+        }
+
+        // Main loop: move latched frames into the queue; returns frames queued
+        size_t poll();
+
+        // Queue access
+        bool available() const { return count_ > 0; }
+        size_t depth() const { return count_; }
+        // Zero-copy: the returned buffer belongs to the caller until release()
+        RxFrame* pop();
+        void release(RxFrame* frame) { pool_.release(frame); }
+        // Copying variant for callers that keep the frame
+        bool pop(RxFrame& frame);
+
+        const RxStats& getStats() const { return stats_; }
+        void resetStats();
+
+    private:
+        IRadioDriver& radio_;
+        FramePool& pool_;
+        std::atomic<bool> active_;
+
+        // ISR -> poll() event ring (single producer, single consumer)
+        uint32_t irqStamps_[IRQ_DEPTH];
+        std::atomic<uint8_t> irqHead_;
+        std::atomic<uint8_t> irqTail_;
+        std::atomic<uint32_t> irqOverflow_;
+
+        // Frame queue of pool buffers (main loop only)
+        RxFrame* queue_[QUEUE_DEPTH];
+        size_t head_;
+        size_t count_;
+
+        uint32_t dutyRxUs_;
+        uint32_t dutySleepUs_;
+
+        RxStats stats_;
+
+        void clearPendingIrqs();
+        int listen();
+        size_t readNewest(uint32_t timestampUs);
+    };
+}
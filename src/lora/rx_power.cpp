@@ -0,0 +1,100 @@
+#include "rx_power.h"
+
+namespace LoRaLink {
+
+    namespace {
+        constexpr float US_PER_HOUR = 3600.0f * 1000000.0f;
+    }
+
+    RxDutyCycle rxDutyCycleFor(const LoRaModulation& modulation, uint8_t minSymbols) {
+        const uint32_t symbolUs = symbolTimeUs(modulation.sf, modulation.bwHz);
+        RxDutyCycle cycle = { 0, 0 };
+        const int64_t sleepUs = static_cast<int64_t>(symbolUs) * (modulation.preamble - 2 * minSymbols) -
+                                RADIO_WAKE_US;
+        if (sleepUs <= 0) {
+            return cycle;
+        }
+        cycle.sleepUs = static_cast<uint32_t>(sleepUs);
+        const uint32_t minRxUs = symbolUs * (minSymbols + 1u);
+        const int64_t syncRxUs = (static_cast<int64_t>(symbolUs) * (modulation.preamble + 2u) - sleepUs + 1) / 2;
+        cycle.rxUs = syncRxUs > minRxUs ? static_cast<uint32_t>(syncRxUs) : minRxUs;
+        return cycle;
+    }
+
+    PowerProfile RxPowerModel::defaultProfile() {
+        PowerProfile profile;
+        profile.mcuActiveMa = 40.0f;        // ESP32-S3 at 240 MHz, mostly in delay()
+        profile.mcuLightSleepMa = 0.24f;    // ESP32-S3 datasheet, RTC timer and GPIO wake
+        profile.radioRxMa = 4.6f;           // SX1262 LoRa 125 kHz, DC-DC
+        profile.radioSleepMa = 0.0006f;     // SX1262 warm sleep
+        profile.boardMa = 0.0f;
+        profile.radioTxMa = 90.0f;          // SX1262 high-power PA near +17 dBm
+        profile.mcuDeepSleepMa = 0.008f;    // ESP32-S3 datasheet, RTC timer
+        profile.supplyV = 3.7f;
+        profile.mcuWakeUs = 1000;
+        profile.frameWorkUs = 2000;
+        profile.timerWakeMs = 1000;
+        profile.timerWorkUs = 500;
+        profile.loopLatencyUs = 10000;
+        profile.mcuBootUs = 40000;          // No image check on wake; measure per build
+        return profile;
+    }
+
+    RxPowerModel::RxPowerModel()
+        : RxPowerModel(defaultProfile())
+    {
+    }
+
+    RxPowerModel::RxPowerModel(const PowerProfile& profile)
+        : profile_(profile)
+    {
+    }
+
+    RxPowerReport RxPowerModel::continuous(const LoRaModulation& modulation, size_t frameBytes,
+                                           float /*framesPerHour*/) const {
+        RxPowerReport report;
+        report.frameAirtimeUs = timeOnAirUs(modulation, frameBytes);
+        report.radioMa = profile_.radioRxMa;
+        report.mcuMa = profile_.mcuActiveMa + profile_.boardMa;
+        report.averageMa = report.radioMa + report.mcuMa;
+        report.worstLatencyUs = report.frameAirtimeUs + profile_.loopLatencyUs + profile_.frameWorkUs;
+        return report;
+    }
+
+    RxPowerReport RxPowerModel::dutyCycled(const LoRaModulation& modulation, size_t frameBytes,
+                                           float framesPerHour, uint8_t minSymbols) const {
+        const RxDutyCycle cycle = rxDutyCycleFor(modulation, minSymbols);
+        if (cycle.sleepUs == 0) {
+            return continuous(modulation, frameBytes, framesPerHour);
+        }
+
+        RxPowerReport report;
+        report.frameAirtimeUs = timeOnAirUs(modulation, frameBytes);
+
+        // Radio between frames: windows and warm sleep
+        const float periodUs = static_cast<float>(cycle.periodUs());
+        const float gapUs = static_cast<float>(cycle.sleepUs + RADIO_WAKE_US);
+        const float idleMa = (cycle.rxUs * profile_.radioRxMa + gapUs * profile_.radioSleepMa) / periodUs;
+
+        // A frame holds RX from the window that hears it until the MCU has
+        // re-armed the cycle. A preamble starting in a gap waits for the next
+        // window, gap / 2 on average, so gap^2 / (2 period) over all phases.
+        const float waitUs = gapUs * gapUs / (2.0f * periodUs);
+        const float frameRxUs = report.frameAirtimeUs - waitUs + profile_.mcuWakeUs + profile_.frameWorkUs;
+        const float frameShare = framesPerHour * frameRxUs / US_PER_HOUR;
+        report.radioMa = idleMa + frameShare * (profile_.radioRxMa - idleMa);
+
+        // MCU: light sleep apart from frames and housekeeping passes
+        const float timerWakes = 3600000.0f / profile_.timerWakeMs;
+        const float activeUs = framesPerHour * (profile_.mcuWakeUs + profile_.frameWorkUs) +
+                               timerWakes * (profile_.mcuWakeUs + profile_.timerWorkUs);
+        report.mcuMa = profile_.mcuLightSleepMa +
+                       activeUs / US_PER_HOUR * (profile_.mcuActiveMa - profile_.mcuLightSleepMa) +
+                       profile_.boardMa;
+
+        report.averageMa = report.radioMa + report.mcuMa;
+        // The frame ends at the same time whenever a window catches it
+        report.worstLatencyUs = report.frameAirtimeUs + profile_.mcuWakeUs + profile_.frameWorkUs;
+        return report;
+    }
+}
@@ -0,0 +1,98 @@
+#pragma once
+
+#include "airtime.h"
+#include <stdint.h>
+#include <cstddef>
+
+// Receiver power: the SX1262 RX duty cycle and a current/latency model
+//
+// In RX duty cycle the radio runs its own timer: rxUs of receive, sleepUs of
+// warm sleep, about RADIO_WAKE_US to start up again, repeat. A window that
+// finds a preamble stays in RX for the packet, DIO1 fires on RxDone and the
+// radio drops to standby until RxEngine re-arms it. Meanwhile the ESP32 can
+// sit in light sleep and wake on DIO1.
+//
+// A window needs minSymbols of preamble to detect it, so senders use a long
+// preamble (P symbols) and the gap between windows is sized so every
+// preamble gives some window that many:
+//
+//   sleep = (P - 2 * minSymbols) symbols - RADIO_WAKE_US
+//   rx    = the larger of minSymbols + 1 symbols and half of
+//           (P + 2 symbols - sleep), so that sleep + 2 rx, the time a
+//           window waits for the sync word once it hears a preamble,
+//           reaches the end of it
+//
+// This is RadioLib's startReceiveDutyCycleAuto() rule with the radio start-up
+// time taken out of the gap. It lives here so the firmware and the native
+// model use the same windows.
+//
+// RxPowerModel turns a schedule into average current and worst-case
+// delivery latency (TX start to frame handled), for continuous RX with the
+// MCU awake and for RX duty cycle with the MCU in light sleep. The currents
+// in defaultProfile() are datasheet typicals; measure the board for real
+// battery estimates.
+namespace LoRaLink {
+
+    constexpr uint8_t RX_MIN_SYMBOLS = 8;
+    constexpr uint32_t RADIO_WAKE_US = 1000;    // Warm sleep to RX, with margin
+
+    struct RxDutyCycle {
+        uint32_t rxUs;
+        uint32_t sleepUs;           // 0: preamble too short, use continuous RX
+
+        uint32_t periodUs() const { return rxUs + sleepUs + RADIO_WAKE_US; }
+    };
+
+    // Windows that catch every preamble of the modulation's length
+    RxDutyCycle rxDutyCycleFor(const LoRaModulation& modulation, uint8_t minSymbols = RX_MIN_SYMBOLS);
+
+    struct PowerProfile {
+        float mcuActiveMa;          // ESP32-S3 running loop(), radio idle, WiFi off
+        float mcuLightSleepMa;
+        float radioRxMa;
+        float radioSleepMa;         // Warm sleep, configuration kept
+        float boardMa;              // Regulator, LED, display: always drawn
+        float radioTxMa;            // At the configured output power
+        float mcuDeepSleepMa;       // RTC timer and RTC memory on
+        float supplyV;
+        uint32_t mcuWakeUs;         // Light sleep to running code
+        uint32_t frameWorkUs;       // Read the FIFO, dispatch, re-arm
+        uint32_t timerWakeMs;       // Longest light sleep (loop() housekeeping)
+        uint32_t timerWorkUs;
+        uint32_t loopLatencyUs;     // Continuous RX: RxDone to poll(), the loop's delay()
+        uint32_t mcuBootUs;         // Deep-sleep wake to setup(): ROM, bootloader, runtime
+    };
+
+    struct RxPowerReport {
+        float averageMa;
+        float radioMa;
+        float mcuMa;                // Board current included
+        uint32_t worstLatencyUs;    // Sender TX start to frame handled
+        uint32_t frameAirtimeUs;    // Per frame, with the preamble used
+
+        float batteryHours(float capacityMah) const {
+            return averageMa > 0.0f ? capacityMah / averageMa : 0.0f;
+        }
+    };
+
+    class RxPowerModel {
+    public:
+        static PowerProfile defaultProfile();
+
+        RxPowerModel();
+        explicit RxPowerModel(const PowerProfile& profile);
+
+        // Continuous RX with the MCU awake (the receiver's default)
+        RxPowerReport continuous(const LoRaModulation& modulation, size_t frameBytes,
+                                 float framesPerHour) const;
+        // RX duty cycle for the modulation's preamble, MCU in light sleep
+        // between frames; continuous() when the preamble is too short
+        RxPowerReport dutyCycled(const LoRaModulation& modulation, size_t frameBytes, float framesPerHour,
+                                 uint8_t minSymbols = RX_MIN_SYMBOLS) const;
+
+        const PowerProfile& profile() const { return profile_; }
+
+    private:
+        PowerProfile profile_;
+    };
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <stdint.h>
+#include <cstddef>
+
+// Portable SHA-256 (FIPS 180-4) for whole-image checks on both the ESP32
+// and the native build; incremental so images never need to fit in RAM
+namespace LoRaLink {
+
+    class Sha256 {
+    public:
+        static constexpr size_t DIGEST_SIZE = 32;
+        static constexpr size_t BLOCK_SIZE = 64;
+
+        Sha256() { reset(); }
+
+        void reset();
+        void update(const uint8_t* data, size_t length);
+        void finish(uint8_t digest[DIGEST_SIZE]);
+
+        // One-shot helper
+        static void hash(const uint8_t* data, size_t length, uint8_t digest[DIGEST_SIZE]);
+
+    private:
+        uint32_t state_[8];
+        uint64_t totalBytes_;
+        uint8_t block_[BLOCK_SIZE];
+        size_t blockLength_;
+
+        void compress(const uint8_t* block);
+    };
+}
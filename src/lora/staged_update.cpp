@@ -0,0 +1,106 @@
+#include "staged_update.h"
+
+namespace LoRaLink {
+
+    namespace {
+        constexpr size_t STAGING_ALIGN = 4096;     // Flash sector
+    }
+
+    uint8_t transferFlags(const uint8_t* data, size_t length) {
+        if (isDeltaPatch(data, length)) {
+            return OTA_START_FLAG_DELTA;
+        }
+        if (!isLzssStream(data, length) || length < LZSS_HEADER_SIZE) {
+            return 0;
+        }
+        LzssDecoder decoder;
+        uint8_t magic[sizeof(DELTA_MAGIC)];
+        size_t consumed;
+        const size_t n = decoder.decode(data + LZSS_HEADER_SIZE, length - LZSS_HEADER_SIZE, consumed,
+                                        magic, sizeof(magic));
+        return OTA_START_FLAG_LZSS | (isDeltaPatch(magic, n) ? OTA_START_FLAG_DELTA : 0);
+    }
+
+    StagedUpdateBackend::StagedUpdateBackend(IUpdateBackend& target, IImageSource& base)
+        : target_(target)
+        , base_(base)
+        , applier_()
+        , decoder_()
+        , inflater_()
+        , flags_(0)
+        , stagingOffset_(0)
+        , stagedSize_(0)
+        , deltaResult_(DeltaResult::OK)
+        , lzssResult_(LzssResult::OK)
+    {
+    }
+
+    const char* StagedUpdateBackend::failureReason() const {
+        if (lzssResult_ != LzssResult::OK) {
+            return LzssInflater::resultToString(lzssResult_);
+        }
+        if (deltaResult_ != DeltaResult::OK) {
+            return DeltaApplier::resultToString(deltaResult_);
+        }
+        return nullptr;
+    }
+
+    bool StagedUpdateBackend::begin(size_t imageSize) {
+        deltaResult_ = DeltaResult::OK;
+        lzssResult_ = LzssResult::OK;
+        if (!isStaged()) {
+            return target_.begin(imageSize);
+        }
+        const size_t capacity = target_.capacity();
+        if (imageSize == 0 || imageSize > capacity) {
+            return false;
+        }
+        stagingOffset_ = (capacity - imageSize) & ~(STAGING_ALIGN - 1);
+        stagedSize_ = imageSize;
+        return target_.begin(capacity);
+    }
+
+    bool StagedUpdateBackend::write(size_t offset, const uint8_t* data, size_t length) {
+        return target_.write(isStaged() ? stagingOffset_ + offset : offset, data, length);
+    }
+
+    bool StagedUpdateBackend::read(size_t offset, uint8_t* data, size_t length) {
+        return target_.read(isStaged() ? stagingOffset_ + offset : offset, data, length);
+    }
+
+    // Called once the staged transfer itself has passed the OTA_START hash
+    bool StagedUpdateBackend::finish() {
+        if (!isStaged()) {
+            return target_.finish();
+        }
+
+        BackendReader staged(target_, stagingOffset_, stagedSize_);
+        LzssSource decompressed(staged, decoder_);
+        const bool lzss = (flags_ & OTA_START_FLAG_LZSS) != 0;
+        if (lzss) {
+            lzssResult_ = decompressed.begin();
+        }
+        if (lzssResult_ == LzssResult::OK) {
+            if (flags_ & OTA_START_FLAG_DELTA) {
+                deltaResult_ = applier_.apply(lzss ? static_cast<IByteSource&>(decompressed) : staged,
+                                              base_, target_, stagingOffset_);
+            } else {
+                lzssResult_ = inflater_.inflate(decompressed, target_, stagingOffset_);
+            }
+        }
+
+        if (lzssResult_ != LzssResult::OK || deltaResult_ != DeltaResult::OK) {
+            target_.abort();
+            return false;
+        }
+        return target_.finish();
+    }
+
+    void StagedUpdateBackend::abort() {
+        target_.abort();
+    }
+
+    size_t StagedUpdateBackend::capacity() const {
+        return target_.capacity();
+    }
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include "delta_patch.h"
+#include "lzss.h"
+#include "ota_receiver.h"
+#include <stdint.h>
+#include <cstddef>
+
+// IUpdateBackend that stages an encoded transfer at the end of the update partition
+//
+// A plain image goes straight through to the real backend. A delta patch
+// or an LZSS stream cannot be written in place as it arrives, because the
+// chunks come in any order. Instead begin() erases the whole partition and
+// the transfer lands in its last bytes. finish() runs once OtaReceiver has
+// checked the transfer hash. It decodes front to back into offset 0, checks
+// the image hash, and only then lets the real backend make it bootable.
+// A compressed patch is decompressed on the fly while it is applied.
+namespace LoRaLink {
+
+    // OTA_START flags for a firmware blob, from its magic: a compressed
+    // stream is peeked at to tell a compressed patch from a compressed image
+    uint8_t transferFlags(const uint8_t* data, size_t length);
+
+    class StagedUpdateBackend : public IUpdateBackend {
+    public:
+        StagedUpdateBackend(IUpdateBackend& target, IImageSource& base);
+
+        // OTA_START_FLAG_* of the next transfer
+        void setFlags(uint8_t flags) { flags_ = flags; }
+        uint8_t getFlags() const { return flags_; }
+        bool isStaged() const { return flags_ != 0; }
+
+        DeltaResult lastDeltaResult() const { return deltaResult_; }
+        LzssResult lastLzssResult() const { return lzssResult_; }
+        // Why the last finish() failed to decode, or nullptr
+        const char* failureReason() const;
+        const DeltaApplier& applier() const { return applier_; }
+
+        bool begin(size_t imageSize) override;
+        bool write(size_t offset, const uint8_t* data, size_t length) override;
+        bool read(size_t offset, uint8_t* data, size_t length) override;
+        bool finish() override;
+        void abort() override;
+        size_t capacity() const override;
+
+    private:
+        IUpdateBackend& target_;
+        IImageSource& base_;
+        DeltaApplier applier_;
+        LzssDecoder decoder_;
+        LzssInflater inflater_;
+        uint8_t flags_;
+        size_t stagingOffset_;
+        size_t stagedSize_;
+        DeltaResult deltaResult_;
+        LzssResult lzssResult_;
+    };
+}
@@ -0,0 +1,414 @@
+#include "tdma.h"
+
+namespace LoRaLink {
+
+    namespace {
+        // Signed distance handles micros() wrap
+        inline bool reached(uint32_t nowUs, uint32_t atUs) {
+            return static_cast<int32_t>(nowUs - atUs) >= 0;
+        }
+
+        constexpr uint8_t JOIN_BACKOFF_MAX = 4;     // Up to 16 superframes between joins
+    }
+
+    // --- Wire format and timing ----------------------------------------------
+
+    bool decodeTdmaBeacon(const uint8_t* payload, size_t length, TdmaBeacon& beacon) {
+        if (payload == nullptr || length < TDMA_BEACON_HEADER_SIZE) {
+            return false;
+        }
+        beacon.cycle = Wire::getU16(payload);
+        beacon.slots = Wire::getU16(payload + 2);
+        beacon.joinSlots = payload[4];
+        beacon.slotUs = Wire::getU32(payload + 5);
+        beacon.guardUs = Wire::getU32(payload + 9);
+        beacon.grantCount = payload[13];
+        beacon.grants = payload + TDMA_BEACON_HEADER_SIZE;
+        return beacon.slots <= TDMA_MAX_SLOTS && beacon.slotUs > 2 * beacon.guardUs &&
+               beacon.grantCount <= TDMA_MAX_GRANTS &&
+               length == TDMA_BEACON_HEADER_SIZE + 4u * beacon.grantCount;
+    }
+
+    bool tdmaGrantFor(const TdmaBeacon& beacon, uint16_t nodeId, uint16_t& slot) {
+        for (uint8_t i = 0; i < beacon.grantCount; ++i) {
+            if (Wire::getU16(beacon.grants + 4 * i) == nodeId) {
+                slot = Wire::getU16(beacon.grants + 4 * i + 2);
+                return slot < beacon.slots;
+            }
+        }
+        return false;
+    }
+
+    TdmaTiming tdmaTiming(const LoRaModulation& modulation, const TdmaConfig& config,
+                          uint16_t slots, uint8_t joinSlots) {
+        TdmaTiming timing;
+        timing.frameUs = timeOnAirUs(modulation, config.frameBytes);
+        timing.slots = slots;
+        timing.joinSlots = joinSlots;
+
+        // guard = jitter + turnaround + relative drift over the superframe,
+        // and the superframe itself has 2 guards per slot:
+        //   g = c + k (B + n f + 2 n g)   =>   g = (c + k (B + n f)) / (1 - 2 k n)
+        // with k = 2 driftPpm / 1e6 and B the longest beacon
+        const uint64_t n = static_cast<uint64_t>(slots) + joinSlots;
+        const uint64_t k = 2u * static_cast<uint64_t>(config.driftPpm);
+        const uint64_t beaconUs = timeOnAirUs(modulation, FRAME_OVERHEAD + TDMA_BEACON_MAX_SIZE);
+        const uint64_t fixedUs = static_cast<uint64_t>(config.jitterUs) + config.turnaroundUs;
+        const uint64_t numerator = fixedUs * 1000000u + k * (beaconUs + n * timing.frameUs);
+        uint64_t denominator = 1000000u - (2 * k * n < 500000u ? 2 * k * n : 500000u);
+        timing.guardUs = static_cast<uint32_t>((numerator + denominator - 1) / denominator);
+        timing.slotUs = timing.frameUs + 2 * timing.guardUs;
+        return timing;
+    }
+
+    uint8_t tdmaJoinSlot(uint16_t nodeId, uint16_t cycle, uint8_t joinSlots) {
+        uint32_t x = nodeId | (static_cast<uint32_t>(cycle) << 16);
+        x ^= x >> 16;
+        x *= 0x85EBCA6Bu;
+        x ^= x >> 13;
+        x *= 0xC2B2AE35u;
+        x ^= x >> 16;
+        return joinSlots > 0 ? static_cast<uint8_t>(x % joinSlots) : 0;
+    }
+
+    // --- Coordinator -----------------------------------------------------------
+
+    TdmaConfig TdmaCoordinator::defaultConfig() {
+        TdmaConfig config;
+        config.frameBytes = PING_FRAME_BYTES;
+        config.minSlots = 8;
+        config.spareSlots = 2;
+        config.minJoinSlots = 2;
+        config.maxJoinSlots = 64;
+        config.idleCycles = 8;
+        config.maxMissedBeacons = 3;
+        config.grantRepeats = 3;
+        config.driftPpm = 20;           // ESP32 and SX1262 TCXO are both better
+        config.jitterUs = 12000;        // loop() ends in delay(10)
+        config.turnaroundUs = 1000;
+        return config;
+    }
+
+    TdmaCoordinator::TdmaCoordinator()
+        : TdmaCoordinator(defaultConfig())
+    {
+    }
+
+    TdmaCoordinator::TdmaCoordinator(const TdmaConfig& config)
+        : config_(config)
+        , modulation_(loraModulation(9, 125000))
+        , stats_{}
+    {
+        reset();
+    }
+
+    void TdmaCoordinator::setModulation(const LoRaModulation& modulation) {
+        modulation_ = modulation;
+        timing_ = tdmaTiming(modulation_, config_, slotsNeeded(), joinSlots_);
+    }
+
+    void TdmaCoordinator::reset() {
+        for (size_t i = 0; i < TDMA_MAX_SLOTS; ++i) {
+            slots_[i] = SlotEntry{};
+        }
+        assigned_ = 0;
+        cycle_ = 0;
+        anchorUs_ = 0;
+        anchored_ = false;
+        joinsThisCycle_ = 0;
+        joinCollision_ = false;
+        joinSlots_ = config_.minJoinSlots;
+        grantCursor_ = 0;
+        timing_ = tdmaTiming(modulation_, config_, slotsNeeded(), joinSlots_);
+    }
+
+    uint16_t TdmaCoordinator::slotsNeeded() const {
+        uint32_t highest = 0;
+        for (size_t i = TDMA_MAX_SLOTS; i > 0; --i) {
+            if (slots_[i - 1].used) {
+                highest = static_cast<uint32_t>(i);
+                break;
+            }
+        }
+        uint32_t needed = highest + config_.spareSlots;
+        if (needed < config_.minSlots) {
+            needed = config_.minSlots;
+        }
+        return static_cast<uint16_t>(needed > TDMA_MAX_SLOTS ? TDMA_MAX_SLOTS : needed);
+    }
+
+    bool TdmaCoordinator::beaconDue(uint32_t nowUs) const {
+        return !anchored_ || reached(nowUs, anchorUs_ + timing_.spanUs());
+    }
+
+    size_t TdmaCoordinator::encodeBeacon(uint8_t* out, size_t outSize) {
+        if (out == nullptr || outSize < TDMA_BEACON_HEADER_SIZE) {
+            return 0;
+        }
+        cycle_++;
+
+        for (size_t i = 0; i < TDMA_MAX_SLOTS; ++i) {
+            SlotEntry& entry = slots_[i];
+            if (entry.used && static_cast<uint16_t>(cycle_ - entry.lastCycle) > config_.idleCycles) {
+                entry = SlotEntry{};
+                assigned_--;
+                stats_.released++;
+            }
+        }
+
+        // Joins heard or collided: widen the window; a quiet superframe: narrow it
+        if (joinsThisCycle_ > 0 || joinCollision_) {
+            const uint16_t wider = static_cast<uint16_t>(joinSlots_) * 2;
+            joinSlots_ = static_cast<uint8_t>(wider < config_.maxJoinSlots ? wider : config_.maxJoinSlots);
+        } else if (joinSlots_ / 2 >= config_.minJoinSlots) {
+            joinSlots_ /= 2;
+        } else {
+            joinSlots_ = config_.minJoinSlots;
+        }
+        joinsThisCycle_ = 0;
+        joinCollision_ = false;
+        timing_ = tdmaTiming(modulation_, config_, slotsNeeded(), joinSlots_);
+
+        Wire::putU16(out, cycle_);
+        Wire::putU16(out + 2, timing_.slots);
+        out[4] = timing_.joinSlots;
+        Wire::putU32(out + 5, timing_.slotUs);
+        Wire::putU32(out + 9, timing_.guardUs);
+
+        // Outstanding grants, round robin so a long list cannot starve the tail
+        const size_t room = (outSize - TDMA_BEACON_HEADER_SIZE) / 4;
+        const size_t limit = room < TDMA_MAX_GRANTS ? room : TDMA_MAX_GRANTS;
+        const size_t first = grantCursor_;
+        uint8_t count = 0;
+        for (size_t n = 0; n < TDMA_MAX_SLOTS && count < limit; ++n) {
+            const size_t i = (first + n) % TDMA_MAX_SLOTS;
+            SlotEntry& entry = slots_[i];
+            if (!entry.used || entry.grantsLeft == 0) {
+                continue;
+            }
+            uint8_t* grant = out + TDMA_BEACON_HEADER_SIZE + 4 * count;
+            Wire::putU16(grant, entry.nodeId);
+            Wire::putU16(grant + 2, static_cast<uint16_t>(i));
+            entry.grantsLeft--;
+            count++;
+            grantCursor_ = (i + 1) % TDMA_MAX_SLOTS;
+        }
+        out[13] = count;
+        stats_.beacons++;
+        return TDMA_BEACON_HEADER_SIZE + 4u * count;
+    }
+
+    void TdmaCoordinator::onBeaconSent(uint32_t endUs) {
+        anchorUs_ = endUs;
+        anchored_ = true;
+    }
+
+    void TdmaCoordinator::onJoin(uint16_t nodeId) {
+        stats_.joins++;
+        joinsThisCycle_++;
+
+        int freeSlot = -1;
+        for (size_t i = 0; i < TDMA_MAX_SLOTS; ++i) {
+            SlotEntry& entry = slots_[i];
+            if (entry.used && entry.nodeId == nodeId) {
+                // Lost sync and came back: same slot, announced again
+                entry.grantsLeft = config_.grantRepeats;
+                entry.lastCycle = cycle_;
+                return;
+            }
+            if (!entry.used && freeSlot < 0) {
+                freeSlot = static_cast<int>(i);
+            }
+        }
+        if (freeSlot < 0) {
+            stats_.full++;
+            return;
+        }
+        SlotEntry& entry = slots_[freeSlot];
+        entry.used = true;
+        entry.nodeId = nodeId;
+        entry.lastCycle = cycle_;
+        entry.grantsLeft = config_.grantRepeats;
+        assigned_++;
+        stats_.grants++;
+    }
+
+    void TdmaCoordinator::onCorruptFrame(uint32_t endUs) {
+        if (anchored_ && timing_.slotUs > 0 && (endUs - anchorUs_) / timing_.slotUs >= timing_.slots) {
+            joinCollision_ = true;
+        }
+    }
+
+    void TdmaCoordinator::onFrame(uint16_t nodeId, uint32_t endUs) {
+        const int slot = slotOf(nodeId);
+        if (slot < 0) {
+            return;
+        }
+        SlotEntry& entry = slots_[slot];
+        entry.lastCycle = cycle_;
+        entry.grantsLeft = 0;       // Heard, so it has the grant
+
+        if (!anchored_ || timing_.slotUs == 0) {
+            return;
+        }
+        const uint32_t offset = endUs - anchorUs_;
+        const uint32_t index = offset / timing_.slotUs;
+        if (index >= timing_.slots) {
+            return;                 // Join window or outside this superframe
+        }
+        if (index == static_cast<uint32_t>(slot)) {
+            stats_.inSlot++;
+        } else {
+            stats_.outOfSlot++;
+        }
+    }
+
+    int TdmaCoordinator::slotOf(uint16_t nodeId) const {
+        for (size_t i = 0; i < TDMA_MAX_SLOTS; ++i) {
+            if (slots_[i].used && slots_[i].nodeId == nodeId) {
+                return static_cast<int>(i);
+            }
+        }
+        return -1;
+    }
+
+    void TdmaCoordinator::resetStats() {
+        stats_ = {};
+    }
+
+    // --- Node ----------------------------------------------------------------
+
+    TdmaNode::TdmaNode()
+        : TdmaNode(TdmaCoordinator::defaultConfig())
+    {
+    }
+
+    TdmaNode::TdmaNode(const TdmaConfig& config)
+        : config_(config)
+        , modulation_(loraModulation(9, 125000))
+        , nodeId_(0)
+        , state_(TdmaState::UNSYNCED)
+        , slot_(0)
+        , beacon_{}
+        , beaconUs_(0)
+        , anchorUs_(0)
+        , missed_(0)
+        , joinBackoff_(0)
+        , joinWait_(0)
+        , joinSent_(false)
+        , pending_(TdmaAction::NONE)
+        , txAtUs_(0)
+        , stats_{}
+    {
+    }
+
+    bool TdmaNode::onBeacon(const uint8_t* payload, size_t length, uint32_t rxEndUs) {
+        TdmaBeacon beacon;
+        if (!decodeTdmaBeacon(payload, length, beacon)) {
+            return false;
+        }
+        stats_.beacons++;
+        missed_ = 0;
+        beaconUs_ = timeOnAirUs(modulation_, FRAME_OVERHEAD + length);
+
+        uint16_t granted = 0;
+        if (tdmaGrantFor(beacon, nodeId_, granted)) {
+            if (state_ != TdmaState::SYNCED || granted != slot_) {
+                stats_.grants++;
+            }
+            slot_ = granted;
+            state_ = TdmaState::SYNCED;
+            joinBackoff_ = 0;
+            joinWait_ = 0;
+            joinSent_ = false;
+        } else if (state_ == TdmaState::SYNCED && slot_ >= beacon.slots) {
+            state_ = TdmaState::JOINING;        // Coordinator no longer has our slot
+        } else if (state_ == TdmaState::UNSYNCED) {
+            state_ = TdmaState::JOINING;
+        }
+
+        if (state_ == TdmaState::JOINING && joinSent_) {
+            // Asked last superframe and not granted: back off
+            joinSent_ = false;
+            if (joinBackoff_ < JOIN_BACKOFF_MAX) {
+                joinBackoff_++;
+            }
+            joinWait_ = tdmaJoinSlot(nodeId_, static_cast<uint16_t>(~beacon.cycle), 1u << joinBackoff_);
+        }
+
+        beacon_ = beacon;
+        beacon_.grantCount = 0;
+        beacon_.grants = nullptr;
+        anchorUs_ = rxEndUs;
+        planSuperframe();
+        return true;
+    }
+
+    void TdmaNode::planSuperframe() {
+        pending_ = TdmaAction::NONE;
+        if (state_ == TdmaState::SYNCED) {
+            pending_ = TdmaAction::SEND_DATA;
+            txAtUs_ = anchorUs_ + slot_ * beacon_.slotUs + beacon_.guardUs;
+        } else if (state_ == TdmaState::JOINING && beacon_.joinSlots > 0) {
+            if (joinWait_ > 0) {
+                joinWait_--;
+                return;
+            }
+            const uint32_t join = tdmaJoinSlot(nodeId_, beacon_.cycle, beacon_.joinSlots);
+            pending_ = TdmaAction::SEND_JOIN;
+            txAtUs_ = anchorUs_ + (beacon_.slots + join) * beacon_.slotUs + beacon_.guardUs;
+        }
+    }
+
+    TdmaAction TdmaNode::poll(uint32_t nowUs) {
+        if (pending_ != TdmaAction::NONE && reached(nowUs, txAtUs_)) {
+            const TdmaAction action = pending_;
+            pending_ = TdmaAction::NONE;
+            const uint32_t lateUs = nowUs - txAtUs_;
+            if (lateUs > config_.jitterUs || lateUs > beacon_.guardUs) {
+                stats_.lateSlots++;     // Would run into the next slot
+                return TdmaAction::NONE;
+            }
+            if (action == TdmaAction::SEND_JOIN) {
+                joinSent_ = true;
+                stats_.joins++;
+            } else {
+                stats_.slotsUsed++;
+            }
+            return action;
+        }
+
+        if (state_ != TdmaState::UNSYNCED && reached(nowUs, nextWakeUs()) && pending_ == TdmaAction::NONE) {
+            missed_++;
+            stats_.missedBeacons++;
+            if (missed_ >= config_.maxMissedBeacons) {
+                state_ = TdmaState::UNSYNCED;
+                stats_.syncLosses++;
+                joinSent_ = false;
+                joinBackoff_ = 0;
+                joinWait_ = 0;
+            }
+        }
+        return TdmaAction::NONE;
+    }
+
+    uint32_t TdmaNode::nextWakeUs() const {
+        if (pending_ != TdmaAction::NONE) {
+            return txAtUs_;
+        }
+        // The next beacon starts one span after this one ended; allow for
+        // the longest beacon and the coordinator's own jitter
+        const uint32_t slackUs = timeOnAirUs(modulation_, FRAME_OVERHEAD + TDMA_BEACON_MAX_SIZE) +
+                                 beacon_.guardUs;
+        const uint32_t spanUs = (static_cast<uint32_t>(beacon_.slots) + beacon_.joinSlots) * beacon_.slotUs;
+        return anchorUs_ + (missed_ + 1u) * (spanUs + slackUs);
+    }
+
+    uint32_t TdmaNode::superframeUs() const {
+        return periodUs();
+    }
+
+    void TdmaNode::resetStats() {
+        stats_ = {};
+    }
+}
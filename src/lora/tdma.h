@@ -0,0 +1,220 @@
+#pragma once
+
+#include "frame_codec.h"
+#include "airtime.h"
+#include <stdint.h>
+#include <cstddef>
+
+// Beacon-synchronised TDMA for dense sender networks
+//
+// The receiver (coordinator) sends TDMA_BEACON once per superframe. Slot
+// times count from the end of the beacon, which both ends take from DIO1:
+// TxDone at the coordinator, RxDone at a sender. After the beacon come the
+// data slots and then the join slots, all slotUs long:
+//
+//   | beacon | slot 0 | slot 1 | ... | slot n-1 | join 0 | ... | beacon
+//
+// A slot is [guard | frame | guard], and a sender starts its frame guardUs
+// into the slot. The guard is worked out from the frame's time on air. It
+// covers TX start jitter (main loop latency), RX/TX turnaround, and crystal
+// drift at both ends over one superframe. So two neighbours can each be off
+// by a whole guard without overlapping. A sender only transmits in a
+// superframe whose beacon it heard, so drift never adds up over more than
+// one superframe.
+//
+// A sender without a slot sends TDMA_JOIN in a join slot picked from its id
+// and the cycle. After a join that is not answered, it waits up to twice as
+// many superframes each time. The coordinator gives the joiner the lowest
+// free slot and lists the grant in the next grantRepeats beacons or until the
+// sender is heard. It doubles the join window after a superframe in which
+// joins arrived or collided (a CRC error in the window), and halves it after
+// a quiet one. A slot
+// is freed after idleCycles superframes without a frame from its owner. A
+// sender that misses maxMissedBeacons beacons in a row drops its slot and
+// listens again (UNSYNCED). Main then falls back to unslotted PINGs.
+namespace LoRaLink {
+
+    constexpr uint16_t TDMA_MAX_SLOTS = 256;
+    constexpr size_t TDMA_MAX_GRANTS = 16;              // Per beacon
+
+    // TDMA_BEACON: u16 cycle, u16 data slots, u8 join slots, u32 slot us,
+    // u32 guard us, u8 grant count, grants as u16 node id + u16 slot
+    constexpr size_t TDMA_BEACON_HEADER_SIZE = 14;
+    constexpr size_t TDMA_BEACON_MAX_SIZE = TDMA_BEACON_HEADER_SIZE + 4 * TDMA_MAX_GRANTS;
+
+    struct TdmaBeacon {
+        uint16_t cycle;
+        uint16_t slots;
+        uint8_t joinSlots;
+        uint32_t slotUs;
+        uint32_t guardUs;
+        uint8_t grantCount;
+        const uint8_t* grants;      // Points into the payload
+    };
+
+    bool decodeTdmaBeacon(const uint8_t* payload, size_t length, TdmaBeacon& beacon);
+    // Slot granted to nodeId in this beacon; false when it is not listed
+    bool tdmaGrantFor(const TdmaBeacon& beacon, uint16_t nodeId, uint16_t& slot);
+
+    struct TdmaConfig {
+        size_t frameBytes;          // Largest frame a slot carries
+        uint16_t minSlots;          // Data slots even with few senders
+        uint16_t spareSlots;        // Beyond the highest assigned, for joiners
+        uint8_t minJoinSlots;
+        uint8_t maxJoinSlots;       // Join window while joins keep arriving
+        uint16_t idleCycles;        // Silent superframes before a slot is freed
+        uint8_t maxMissedBeacons;   // Sender drops its slot after this many in a row
+        uint8_t grantRepeats;       // Beacons a grant is listed in unless the sender is heard
+        uint16_t driftPpm;          // Crystal tolerance at each end
+        uint32_t jitterUs;          // TX start uncertainty (main loop latency)
+        uint32_t turnaroundUs;      // RX <-> TX switch
+    };
+
+    struct TdmaTiming {
+        uint32_t frameUs;           // Time on air of frameBytes
+        uint32_t guardUs;           // Each side of the frame
+        uint32_t slotUs;
+        uint16_t slots;
+        uint8_t joinSlots;
+
+        // Beacon end to the start of the next beacon
+        uint32_t spanUs() const { return (static_cast<uint32_t>(slots) + joinSlots) * slotUs; }
+    };
+
+    TdmaTiming tdmaTiming(const LoRaModulation& modulation, const TdmaConfig& config,
+                          uint16_t slots, uint8_t joinSlots);
+
+    struct TdmaCoordinatorStats {
+        uint32_t beacons;
+        uint32_t joins;
+        uint32_t grants;            // Slots handed out (first grant per node)
+        uint32_t released;          // Slots freed after idleCycles
+        uint32_t full;              // Joins refused: every slot taken
+        uint32_t inSlot;            // Frames from slot owners that ended in their slot
+        uint32_t outOfSlot;
+    };
+
+    class TdmaCoordinator {
+    public:
+        static TdmaConfig defaultConfig();
+
+        TdmaCoordinator();
+        explicit TdmaCoordinator(const TdmaConfig& config);
+
+        void setModulation(const LoRaModulation& modulation);
+
+        // The next beacon should start now; the first one is due at once
+        bool beaconDue(uint32_t nowUs) const;
+        // Next superframe's beacon; fixes its timing and counts down grant repeats
+        size_t encodeBeacon(uint8_t* out, size_t outSize);
+        // TxDone of the beacon: the superframe's time origin
+        void onBeaconSent(uint32_t endUs);
+        void onJoin(uint16_t nodeId);
+        // A frame lost to a CRC error; in the join window that means joins collided
+        void onCorruptFrame(uint32_t endUs);
+        // Any frame; endUs is its RxDone stamp, used to check slot discipline
+        void onFrame(uint16_t nodeId, uint32_t endUs);
+        // Forget every assignment (role or profile change)
+        void reset();
+
+        int slotOf(uint16_t nodeId) const;
+        uint16_t assigned() const { return assigned_; }
+        const TdmaTiming& timing() const { return timing_; }
+        uint16_t cycle() const { return cycle_; }
+        const TdmaCoordinatorStats& getStats() const { return stats_; }
+        void resetStats();
+
+    private:
+        struct SlotEntry {
+            uint16_t nodeId;
+            uint16_t lastCycle;     // Cycle the owner was last heard or granted in
+            uint8_t grantsLeft;
+            bool used;
+        };
+
+        TdmaConfig config_;
+        LoRaModulation modulation_;
+        TdmaTiming timing_;         // Of the superframe after the last beacon
+        SlotEntry slots_[TDMA_MAX_SLOTS];
+        uint16_t assigned_;
+        uint16_t cycle_;
+        uint32_t anchorUs_;
+        bool anchored_;
+        uint16_t joinsThisCycle_;
+        bool joinCollision_;
+        uint8_t joinSlots_;
+        size_t grantCursor_;
+        TdmaCoordinatorStats stats_;
+
+        uint16_t slotsNeeded() const;
+    };
+
+    enum class TdmaState {
+        UNSYNCED,       // No beacon lately: not slotted
+        JOINING,        // Hearing beacons, no slot yet
+        SYNCED          // Own slot in every superframe whose beacon was heard
+    };
+
+    enum class TdmaAction {
+        NONE,
+        SEND_JOIN,      // TDMA_JOIN, now
+        SEND_DATA       // The frame for this superframe, now
+    };
+
+    struct TdmaNodeStats {
+        uint32_t beacons;
+        uint32_t missedBeacons;
+        uint32_t syncLosses;
+        uint32_t joins;             // TDMA_JOIN sent
+        uint32_t grants;
+        uint32_t slotsUsed;         // SEND_DATA answers
+        uint32_t lateSlots;         // Polled after the slot's guard: skipped
+    };
+
+    class TdmaNode {
+    public:
+        TdmaNode();
+        explicit TdmaNode(const TdmaConfig& config);
+
+        void setNodeId(uint16_t nodeId) { nodeId_ = nodeId; }
+        // For beacon airtime, to tell a missed beacon from a late one
+        void setModulation(const LoRaModulation& modulation) { modulation_ = modulation; }
+
+        // rxEndUs: RxDone stamp of the beacon
+        bool onBeacon(const uint8_t* payload, size_t length, uint32_t rxEndUs);
+        // Call often; answers SEND_* once per superframe, at the start instant
+        TdmaAction poll(uint32_t nowUs);
+        // When poll() next has something to do (TX instant or missed-beacon check)
+        uint32_t nextWakeUs() const;
+
+        TdmaState state() const { return state_; }
+        int slot() const { return state_ == TdmaState::SYNCED ? slot_ : -1; }
+        // Beacon to beacon, as last announced
+        uint32_t superframeUs() const;
+        const TdmaNodeStats& getStats() const { return stats_; }
+        void resetStats();
+
+    private:
+        TdmaConfig config_;
+        LoRaModulation modulation_;
+        uint16_t nodeId_;
+        TdmaState state_;
+        uint16_t slot_;
+        TdmaBeacon beacon_;         // Timing fields only; grants are not kept
+        uint32_t beaconUs_;         // Air time of the last beacon
+        uint32_t anchorUs_;
+        uint8_t missed_;
+        uint8_t joinBackoff_;       // Log2 of the join retry window, in superframes
+        uint16_t joinWait_;         // Superframes to sit out before the next join
+        bool joinSent_;
+        TdmaAction pending_;
+        uint32_t txAtUs_;
+        TdmaNodeStats stats_;
+
+        uint32_t periodUs() const { return beaconUs_ + (static_cast<uint32_t>(beacon_.slots) + beacon_.joinSlots) * beacon_.slotUs; }
+        void planSuperframe();
+    };
+
+    // Join slot for a node in a cycle; differs per cycle so a collision does not repeat
+    uint8_t tdmaJoinSlot(uint16_t nodeId, uint16_t cycle, uint8_t joinSlots);
+}
@@ -0,0 +1,214 @@
+#include "tx_scheduler.h"
+#include <cstring>
+
+namespace LoRaLink {
+
+    TxScheduler::TxScheduler(IRadioDriver& radio)
+        : radio_(radio)
+        , receiver_(nullptr)
+        , budget_(nullptr)
+        , lbt_(nullptr)
+        , resumeReceiver_(false)
+        , freeCount_(CAPACITY)
+        , lanes_{}
+        , queued_(0)
+        , inFlight_(-1)
+        , startedUs_(0)
+        , transmitting_(false)
+        , txDone_(false)
+        , doneUs_(0)
+        , scanning_(false)
+        , cadDone_(false)
+        , scanStartUs_(0)
+        , clearToSend_(false)
+        , stats_{}
+    {
+        for (size_t i = 0; i < CAPACITY; ++i) {
+            freeList_[i] = static_cast<uint8_t>(i);
+        }
+    }
+
+    bool TxScheduler::enqueue(const uint8_t* frame, size_t length, Priority priority, uint32_t nowUs) {
+        const size_t level = static_cast<size_t>(priority);
+        if (frame == nullptr || length == 0 || length > MAX_FRAME_SIZE || level >= PRIORITY_LEVELS) {
+            return false;
+        }
+        if (freeCount_ == 0) {
+            stats_.dropped++;
+            return false;
+        }
+
+        const uint8_t index = freeList_[--freeCount_];
+        Slot& slot = slots_[index];
+        memcpy(slot.data, frame, length);
+        slot.length = length;
+        slot.priority = priority;
+        slot.enqueuedUs = nowUs;
+        slot.paced = false;
+
+        Lane& lane = lanes_[level];
+        lane.slots[(lane.head + lane.count) % CAPACITY] = index;
+        lane.count++;
+        queued_++;
+
+        stats_.enqueued++;
+        stats_.depth = queued_;
+        if (queued_ > stats_.maxDepth) {
+            stats_.maxDepth = queued_;
+        }
+
+        if (!isTransmitting() && !isScanning()) {
+            startNext(nowUs);
+        }
+        return true;
+    }
+
+    void TxScheduler::poll(uint32_t nowUs) {
+        if (isTransmitting()) {
+            if (txDone_.load(std::memory_order_acquire)) {
+                radio_.finishTransmit();
+                complete(RadioStatus::OK, doneUs_);
+            } else if (nowUs - startedUs_ > TX_TIMEOUT_US) {
+                radio_.finishTransmit();
+                complete(RadioStatus::ERR_UNKNOWN, nowUs);
+            } else {
+                return;
+            }
+        } else if (isScanning()) {
+            if (cadDone_.load(std::memory_order_acquire)) {
+                finishScan(radio_.getChannelScanResult(), nowUs);
+            } else if (nowUs - scanStartUs_ > 4 * lbt_->cadUs() + 10000) {
+                finishScan(RadioStatus::ERR_UNKNOWN, nowUs);
+            } else {
+                return;
+            }
+        }
+
+        startNext(nowUs);
+    }
+
+    void TxScheduler::finishScan(int result, uint32_t nowUs) {
+        scanning_.store(false, std::memory_order_release);
+        cadDone_.store(false, std::memory_order_relaxed);
+        if (result == RadioStatus::LORA_DETECTED) {
+            if (lbt_->onBusy(nowUs)) {
+                stats_.deferred++;
+                return;     // startNext() hands the radio back for the backoff
+            }
+        } else if (result == RadioStatus::CHANNEL_FREE) {
+            lbt_->onClear();
+        }
+        // Clear, out of attempts, or no CAD result: send rather than stall
+        clearToSend_ = true;
+    }
+
+    void TxScheduler::startNext(uint32_t nowUs) {
+        while (queued_ > 0) {
+            // Highest priority lane first
+            Lane* next = nullptr;
+            for (size_t level = PRIORITY_LEVELS; level-- > 0;) {
+                if (lanes_[level].count > 0) {
+                    next = &lanes_[level];
+                    break;
+                }
+            }
+            const int index = next->slots[next->head];
+            if (budget_ != nullptr && budget_->waitUs(slots_[index].length, nowUs) > 0) {
+                if (!slots_[index].paced) {
+                    slots_[index].paced = true;
+                    stats_.paced++;
+                }
+                break;  // poll() retries; the receiver listens meanwhile
+            }
+            if (lbt_ != nullptr && slots_[index].priority != Priority::CRITICAL && !clearToSend_) {
+                if (!lbt_->ready(nowUs)) {
+                    break;  // Backing off; the receiver listens meanwhile
+                }
+                if (receiver_ != nullptr && receiver_->isActive()) {
+                    receiver_->suspend();
+                    resumeReceiver_ = true;
+                }
+                cadDone_.store(false, std::memory_order_relaxed);
+                scanning_.store(true, std::memory_order_release);
+                scanStartUs_ = nowUs;
+                if (radio_.startChannelScan() == RadioStatus::OK) {
+                    return;     // poll() picks up CadDone
+                }
+                scanning_.store(false, std::memory_order_release);
+            }
+            clearToSend_ = false;
+            next->head = (next->head + 1) % CAPACITY;
+            next->count--;
+            queued_--;
+            stats_.depth = queued_;
+
+            if (receiver_ != nullptr && receiver_->isActive()) {
+                receiver_->suspend();
+                resumeReceiver_ = true;
+            }
+
+            inFlight_ = index;
+            startedUs_ = nowUs;
+            txDone_.store(false, std::memory_order_relaxed);
+            transmitting_.store(true, std::memory_order_release);
+
+            const Slot& slot = slots_[index];
+            int st = radio_.startTransmit(slot.data, slot.length);
+            if (st == RadioStatus::OK) {
+                if (budget_ != nullptr) {
+                    budget_->onStart(slot.length, nowUs);
+                }
+                return;
+            }
+            complete(st, nowUs);
+        }
+
+        // Queue drained or paced: hand the radio back to the receiver
+        if (resumeReceiver_ && !isTransmitting()) {
+            resumeReceiver_ = false;
+            receiver_->resume();
+        }
+    }
+
+    void TxScheduler::complete(int status, uint32_t doneUs) {
+        transmitting_.store(false, std::memory_order_release);
+        txDone_.store(false, std::memory_order_relaxed);
+
+        const Slot& slot = slots_[inFlight_];
+        TxResult result;
+        result.type = static_cast<FrameType>(slot.length > 1 ? slot.data[1] : 0);
+        result.sequence = slot.length >= HEADER_SIZE ? Wire::getU16(slot.data + 4) : 0;
+        result.priority = slot.priority;
+        result.status = status;
+        result.latencyUs = doneUs - slot.enqueuedUs;
+        result.doneUs = doneUs;
+
+        if (status == RadioStatus::OK) {
+            stats_.sent++;
+            stats_.lastLatencyUs = result.latencyUs;
+            stats_.totalLatencyUs += result.latencyUs;
+            if (result.latencyUs > stats_.maxLatencyUs) {
+                stats_.maxLatencyUs = result.latencyUs;
+            }
+        } else {
+            stats_.failed++;
+        }
+
+        releaseSlot(inFlight_);
+        inFlight_ = -1;
+
+        if (onComplete_) {
+            onComplete_(result);
+        }
+    }
+
+    void TxScheduler::releaseSlot(int index) {
+        freeList_[freeCount_++] = static_cast<uint8_t>(index);
+    }
+
+    void TxScheduler::resetStats() {
+        stats_ = {};
+        stats_.depth = queued_;
+        stats_.maxDepth = queued_;
+    }
+}
@@ -0,0 +1,155 @@
+#pragma once
+
+#include "frame_codec.h"
+#include "radio_driver.h"
+#include "rx_engine.h"
+#include "airtime.h"
+#include "listen_before_talk.h"
+#include "../communication/communication_interface.h"
+#include <stdint.h>
+#include <cstddef>
+#include <atomic>
+#include <functional>
+
+// Non-blocking transmit path
+//
+// Frames are queued by CommunicationSystem::Priority (FIFO within a level)
+// and sent with startTransmit(); the DIO1 TxDone edge is latched by the ISR
+// and poll() finishes the frame and starts the next one, so the main loop
+// never waits out a frame's time on air. When an RxEngine is attached it is
+// suspended for the duration of a burst and resumed once the queue drains.
+// With an AirtimeBudget attached, the head frame waits in the queue (radio
+// listening) until the duty cycle has room for its time on air. With a
+// ListenBeforeTalk attached, each frame starts with a CAD and waits out the
+// backoff (radio listening) while the channel is busy. CRITICAL frames skip
+// the CAD: they are the scheduled ones that already own the channel (TDMA
+// beacons and slots).
+namespace LoRaLink {
+
+    using CommunicationSystem::Priority;
+
+    // Arduino.h defines HIGH and LOW as macros; firmware code that includes it
+    // (after this header) names the levels through these instead
+    constexpr Priority TX_LOW = Priority::LOW;
+    constexpr Priority TX_NORMAL = Priority::NORMAL;
+    constexpr Priority TX_HIGH = Priority::HIGH;
+    constexpr Priority TX_CRITICAL = Priority::CRITICAL;
+
+    struct TxResult {
+        FrameType type;
+        uint16_t sequence;
+        Priority priority;
+        int status;             // RadioStatus / RadioLib code
+        uint32_t latencyUs;     // enqueue -> TxDone
+        uint32_t doneUs;        // TxDone edge (or when the failure was noticed)
+    };
+
+    struct TxStats {
+        uint32_t enqueued;
+        uint32_t sent;
+        uint32_t failed;        // startTransmit() errors and TxDone timeouts
+        uint32_t dropped;       // Rejected because the queue was full
+        uint32_t paced;         // Frames the airtime budget held back
+        uint32_t deferred;      // Busy CADs that sent the head frame into backoff
+        size_t depth;           // Frames waiting (excluding the one in flight)
+        size_t maxDepth;
+        uint32_t lastLatencyUs;
+        uint32_t maxLatencyUs;
+        uint64_t totalLatencyUs;
+
+        uint32_t averageLatencyUs() const {
+            return sent > 0 ? static_cast<uint32_t>(totalLatencyUs / sent) : 0;
+        }
+    };
+
+    class TxScheduler {
+    public:
+        static constexpr size_t CAPACITY = 16;
+        static constexpr size_t PRIORITY_LEVELS = 4;
+        static constexpr uint32_t TX_TIMEOUT_US = 20000000;  // Longer than any SF12 frame
+
+        typedef std::function<void(const TxResult&)> CompletionCallback;
+
+        explicit TxScheduler(IRadioDriver& radio);
+
+        // Receiver to pause while transmitting (optional)
+        void attachReceiver(RxEngine* receiver) { receiver_ = receiver; }
+        // Duty-cycle budget every frame is charged against (optional)
+        void attachBudget(AirtimeBudget* budget) { budget_ = budget; }
+        // CAD before each frame, with its backoff policy (optional)
+        void attachListenBeforeTalk(ListenBeforeTalk* lbt) { lbt_ = lbt; }
+        void setCompletionCallback(CompletionCallback callback) { onComplete_ = callback; }
+
+        // Copy an encoded frame into the queue; false if full or invalid
+        bool enqueue(const uint8_t* frame, size_t length, Priority priority, uint32_t nowUs);
+
+        // ISR context: latch TxDone while a frame is in flight, CadDone while scanning
+        void onDio1(uint32_t timestampUs) {
+            if (transmitting_.load(std::memory_order_relaxed)) {
+                doneUs_ = timestampUs;
+                txDone_.store(true, std::memory_order_release);
+            } else if (scanning_.load(std::memory_order_relaxed)) {
+                cadDone_.store(true, std::memory_order_release);
+            }
+        }
+
+        // Main loop: finish completed frames and start the next one
+        void poll(uint32_t nowUs);
+
+        bool isTransmitting() const { return transmitting_.load(std::memory_order_acquire); }
+        bool isScanning() const { return scanning_.load(std::memory_order_acquire); }
+        bool isBusy() const { return isTransmitting() || queued_ > 0; }
+        size_t depth() const { return queued_; }
+        size_t freeSlots() const { return CAPACITY - queued_ - (isTransmitting() ? 1 : 0); }
+
+        const TxStats& getStats() const { return stats_; }
+        void resetStats();
+
+    private:
+        struct Slot {
+            uint8_t data[MAX_FRAME_SIZE];
+            size_t length;
+            Priority priority;
+            uint32_t enqueuedUs;
+            bool paced;
+        };
+
+        // Per-priority FIFO of slot indices
+        struct Lane {
+            uint8_t slots[CAPACITY];
+            size_t head;
+            size_t count;
+        };
+
+        IRadioDriver& radio_;
+        RxEngine* receiver_;
+        AirtimeBudget* budget_;
+        ListenBeforeTalk* lbt_;
+        bool resumeReceiver_;
+        CompletionCallback onComplete_;
+
+        Slot slots_[CAPACITY];
+        uint8_t freeList_[CAPACITY];
+        size_t freeCount_;
+        Lane lanes_[PRIORITY_LEVELS];
+        size_t queued_;
+
+        int inFlight_;              // Slot index being transmitted, -1 when idle
+        uint32_t startedUs_;
+        std::atomic<bool> transmitting_;
+        std::atomic<bool> txDone_;
+        volatile uint32_t doneUs_;
+
+        std::atomic<bool> scanning_;
+        std::atomic<bool> cadDone_;
+        uint32_t scanStartUs_;
+        bool clearToSend_;          // CAD done for the head frame: send without another
+
+        TxStats stats_;
+
+        void startNext(uint32_t nowUs);
+        void finishScan(int result, uint32_t nowUs);
+        void complete(int status, uint32_t doneUs);
+        void releaseSlot(int index);
+    };
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <stdint.h>
+
+// xorshift32 (Marsaglia, shifts 13/17/5): cheap pseudo-random numbers for
+// backoff, jitter, FEC repair masks and the simulator. Deterministic for a
+// seed, so native tests replay exactly; not for anything that must be
+// unpredictable. The all-zero state never leaves zero, so it is never used.
+namespace LoRaLink {
+
+    class Xorshift32 {
+    public:
+        explicit Xorshift32(uint32_t seed = 1) : state_(seed != 0 ? seed : 1) {}
+
+        void seed(uint32_t seed) { state_ = seed != 0 ? seed : 1; }
+        uint32_t next() {
+            state_ ^= state_ << 13;
+            state_ ^= state_ >> 17;
+            state_ ^= state_ << 5;
+            return state_;
+        }
+
+    private:
+        uint32_t state_;
+    };
+}
@@ -1,3 +1,6 @@
+// Pulls in CommunicationSystem::Priority, whose HIGH/LOW clash with Arduino.h macros
+#include "lora/tx_scheduler.h"
+
 #include <Arduino.h>
 #include <Wire.h>
 #include <U8g2lib.h>
@@ -5,15 +8,23 @@
 #include <RadioLib.h>
 #include <Preferences.h>
 
+#include "lora/capture.h"
+#include "lora/deep_sleep.h"
+#include "lora/esp_ota_backend.h"
+#include "lora/firmware_store.h"
+#include "lora/heap_monitor.h"
+#include "lora/link_layer.h"
+#include "lora/ota_arq.h"
+#include "lora/ota_fec.h"
+#include "lora/radiolib_driver.h"
+#include "lora/rx_power.h"
+#include "hardware/hardware_abstraction.h"
+
 #ifdef ENABLE_WIFI_OTA
 #include <WiFi.h>
 #include <ArduinoOTA.h>
 #include <Update.h>
 #endif
-// Allow sender to flash firmware received over LoRa
-#if defined(ROLE_SENDER) && !defined(ENABLE_WIFI_OTA)
-#include <Update.h>
-#endif
 
 // Vext power control and OLED reset (Heltec V3)
 #define VEXT_PIN 36        // Vext control: LOW = ON
@@ -51,6 +62,39 @@ U8G2_SSD1306_128X64_NONAME_F_HW_I2C u8g2(U8G2_R0, U8X8_PIN_NONE);
 #ifndef LORA_TX_DBM
   #define LORA_TX_DBM    17
 #endif
+#ifndef LORA_ADR
+  #define LORA_ADR       0     // Receiver picks SF/BW/TX power from link history
+#endif
+#ifndef LORA_TDMA
+  #define LORA_TDMA      0     // Receiver beacons and grants PING slots (tdma.h)
+#endif
+#ifndef LORA_LBT
+  #define LORA_LBT       0     // CAD before each frame, random backoff while busy
+#endif
+#ifndef LORA_PREAMBLE
+  #define LORA_PREAMBLE  8     // Symbols; CAD wake and RX duty cycle need a long one on every node
+#endif
+#ifndef LORA_CAD_WAKE
+  #define LORA_CAD_WAKE  0     // Receiver sleeps between CADs (set LORA_PREAMBLE to 64+)
+#endif
+#ifndef LORA_RX_DUTY_CYCLE
+  #define LORA_RX_DUTY_CYCLE 0 // Receiver in radio RX duty cycle, ESP32 in light sleep (rx_power.h)
+#endif
+#if LORA_RX_DUTY_CYCLE && (LORA_CAD_WAKE || LORA_TDMA)
+  #error "LORA_RX_DUTY_CYCLE cannot be combined with LORA_CAD_WAKE or LORA_TDMA"
+#endif
+#ifndef LORA_DEEP_SLEEP_MS
+  #define LORA_DEEP_SLEEP_MS 0 // Sender: one PING per timer wake, deep sleep in between (deep_sleep.h)
+#endif
+#if LORA_DEEP_SLEEP_MS && (defined(ROLE_RECEIVER) || LORA_TDMA)
+  #error "LORA_DEEP_SLEEP_MS is for senders without LORA_TDMA"
+#endif
+#ifndef LORA_CAPTURE
+  #define LORA_CAPTURE   0     // Binary capture of received frames, streamed on Serial (capture.h)
+#endif
+#ifndef LORA_DUTY_CYCLE_PERMILLE
+  #define LORA_DUTY_CYCLE_PERMILLE 1000  // 10 for the 1 % EU868 sub-bands
+#endif
 
 // Control channel used for discovery/sync at boot
 #ifndef CTRL_FREQ_MHZ
@@ -70,29 +114,33 @@ U8G2_SSD1306_128X64_NONAME_F_HW_I2C u8g2(U8G2_R0, U8X8_PIN_NONE);
 #ifdef ENABLE_WIFI_OTA
 #include "wifi_manager.h"
 
-// Firmware storage for LoRa OTA cascade updates
-static uint8_t storedFirmware[64 * 1024]; // 64KB buffer for firmware storage (reduced for DRAM)
-static size_t storedFirmwareSize = 0;
-static bool hasStoredFirmware = false;
-static uint32_t firmwareVersion = 0x010000; // Version 1.0.0
+// Firmware storage for LoRa OTA cascade updates: a flash partition, streamed
+// chunk by chunk, so no image buffer in DRAM
+static LoRaLink::EspPartitionRegion firmwareStoreRegion("fwstore", "spiffs"); // Stock table: unused SPIFFS area
+static LoRaLink::FirmwareStore firmwareStore(firmwareStoreRegion);
+static size_t wifiOtaImageSize = 0;         // Total from ArduinoOTA progress
+// What the next distribution sends: the store, or the OTA partition itself
+// when the image did not fit the store (a board on the stock table)
+static LoRaLink::EspPartitionImage receivedFirmware(nullptr, 0);
+static LoRaLink::IImageSource* distributionImage = &firmwareStore;
 #endif
 
 SX1262 radio = new Module(PIN_LORA_NSS, PIN_LORA_DIO1, PIN_LORA_RST, PIN_LORA_BUSY);
 static Preferences prefs;
 
 static bool isSender = true;
-static uint32_t seq = 0;
+static uint16_t nodeId = 0;        // Low bytes of the eFuse MAC
 static uint32_t lastButtonMs = 0;
 static int lastButtonState = HIGH;
 static uint32_t buttonPressMs = 0;
 static bool buttonPressed = false;
 
-// LoRa parameters that can be changed at runtime
-static float currentFreq = LORA_FREQ_MHZ;
-static float currentBW = LORA_BW_KHZ;
-static int currentSF = LORA_SF;
-static int currentCR = LORA_CR;
-static int currentTxPower = LORA_TX_DBM;
+static LoRaLink::RadioLibDriver radioDriver(radio);
+static uint32_t clockUs() { return micros(); }
+static uint32_t clockMs() { return millis(); }
+static LoRaLink::HeapMonitor heapMonitor;
+static uint8_t rxPauseDepth = 0;
+static bool rxResumeAfterPause = false;
 
 // LoRa parameter arrays for cycling through values
 static const int sfValues[] = {7, 8, 9, 10, 11, 12};
@@ -104,25 +152,92 @@ static size_t currentSfIndex = 2;  // Default to SF9
 static size_t currentBwIndex = 1;  // Default to 125kHz
 static size_t currentTxIndex = 7;  // Default to 17dBm
 
-// Signal quality tracking
-static float lastRSSI = -999.0;
-static float lastSNR = -999.0;
-static uint32_t lastPacketTime = 0;
-static uint32_t packetCount = 0;
-static uint32_t errorCount = 0;
-
-// Available values for cycling
-// Old arrays removed - using new arrays defined above
-
-// Config broadcast state (sender)
-static bool pendingConfigBroadcast = false;
-static float pendingFreq = 0;
-static float pendingBW = 0;
-static int pendingSF = 0;
-static int pendingCR = 0;
-static int pendingTxPower = 0;
-static uint32_t cfgLastTxMs = 0;
-static int cfgRemaining = 0;
+// Adaptive data rate (receiver): PING history picks the profile, the sender
+// switches both ends with the two-phase config change
+static LoRaLink::AdrConfig makeAdrConfig() {
+  LoRaLink::AdrConfig config = LoRaLink::AdrEngine::defaultConfig();
+  config.sfValues = sfValues;
+  config.sfCount = sizeof(sfValues) / sizeof(sfValues[0]);
+  config.bwValues = bwValues;
+  config.bwCount = sizeof(bwValues) / sizeof(bwValues[0]);
+  config.txPowerValues = txPowerValues;
+  config.txPowerCount = sizeof(txPowerValues) / sizeof(txPowerValues[0]);
+  config.ratePowerDbm = LORA_TX_DBM;
+  return config;
+}
+
+// LoRa OTA receive (both roles); chunks stream straight to the OTA partition
+static uint32_t loraOtaTimeout = 30000; // 30 seconds without a chunk
+static LoRaLink::EspOtaBackend loraOtaBackend;
+// Delta and compressed starts stage the transfer at the partition tail and decode it at finish
+static LoRaLink::EspRunningImage loraOtaBase;
+static LoRaLink::StagedUpdateBackend loraOtaStaged(loraOtaBackend, loraOtaBase);
+
+static LoRaLink::LinkLayerConfig makeLinkConfig() {
+  LoRaLink::LinkLayerConfig config = LoRaLink::LinkLayerConfig::defaultConfig();
+  config.preamble = LORA_PREAMBLE;
+  config.dutyCyclePermille = LORA_DUTY_CYCLE_PERMILLE;
+  config.listenBeforeTalk = LORA_LBT;
+  config.rxDutyCycle = LORA_RX_DUTY_CYCLE;
+  config.adr = LORA_ADR;
+  config.adrConfig = makeAdrConfig();
+  return config;
+}
+
+// The protocol side of the node (link_layer.h): RX engine and frame pool, TX
+// queue with airtime budget and LBT, dispatch, config change, ADR, link
+// table and OTA receive. This file keeps the board, display and user input.
+static LoRaLink::LinkLayer loraLink(radioDriver, radioDriver, loraOtaStaged, makeLinkConfig(), clockUs, clockMs);
+static const uint16_t REPEAT_SHARE_PERMILLE = 500;  // Blocking repeats leave half the channel free
+static const uint32_t LINK_REPORT_MS = 60000;
+
+// Receivers can CAD every period instead of continuous RX
+#if LORA_CAD_WAKE
+static LoRaLink::CadWake cadWake(radioDriver, loraLink.rxEngine());
+#endif
+#if LORA_TDMA
+// Slotted PINGs: the receiver beacons once per superframe and grants slots;
+// a sender PINGs in its slot and falls back to paced PINGs while unsynced
+static LoRaLink::TdmaCoordinator tdmaCoord;
+static LoRaLink::TdmaNode tdmaNode;
+#endif
+#if LORA_CAPTURE
+// Received frames with timestamp, signal and profile, drained to Serial from loop()
+static LoRaLink::CaptureRing captureRing;
+#endif
+#if LORA_DEEP_SLEEP_MS
+// Survives deep sleep; a power cycle or reflash fails rtcStateValid()
+RTC_DATA_ATTR static LoRaLink::SenderRtcState rtcState;
+#endif
+static bool displayReady = false;  // Timer wakes of a deep-sleep sender leave the OLED off
+
+// DIO1 is shared: TxDone and CadDone go to the scheduler, RxDone to the RX engine
+static void IRAM_ATTR onRadioDio1() {
+  loraLink.onDio1(micros());
+}
+
+// Let queued frames finish before a blocking radio operation takes over
+static void waitForTxIdle() {
+  LoRaLink::TxScheduler& tx = loraLink.txScheduler();
+  while (tx.isBusy()) {
+    tx.poll(micros());
+    delay(1);
+  }
+}
+
+// Blocking radio operations must not race continuous RX; nests safely
+struct ReceiverPause {
+  ReceiverPause() {
+    if (rxPauseDepth++ == 0) {
+      waitForTxIdle();
+      rxResumeAfterPause = loraLink.rxEngine().isActive();
+      if (rxResumeAfterPause) loraLink.rxEngine().suspend();
+    }
+  }
+  ~ReceiverPause() {
+    if (--rxPauseDepth == 0 && rxResumeAfterPause) loraLink.rxEngine().resume();
+  }
+};
 
 // OTA Update state
 #ifdef ENABLE_WIFI_OTA
@@ -131,21 +246,44 @@ static bool otaActive = false;
 static uint32_t lastOtaCheck = 0;
 #endif
 
-// LoRa OTA state (both sender and receiver)
-static bool loraOtaActive = false;
-static uint32_t loraOtaStartTime = 0;
-static uint32_t loraOtaTimeout = 30000; // 30 seconds timeout
-static uint8_t loraOtaBuffer[1024]; // Buffer for OTA data
-static size_t loraOtaBufferSize = 0;
-static uint32_t loraOtaExpectedSize = 0;
-static uint32_t loraOtaReceivedSize = 0;
+#ifdef ENABLE_WIFI_OTA
+// Selective-repeat transfer to one peer (receiver only); the OtaSender picks
+// the next frame and the peer's OTA_NACKs steer it
+static const size_t OTA_CHUNK_SIZE = 200;
+static LoRaLink::OtaSender otaSender;
+static struct {
+  LoRaLink::IImageSource* firmware;  // Read chunk by chunk (firmware store)
+  size_t size;
+  LoRaLink::OtaStartInfo info;
+  uint16_t peer;            // Node whose NACKs drive the transfer
+  uint32_t pendingAirUs;    // Time on air of the OTA frame in the TX queue
+  int lastPercent;
+} otaStream = {};
+// Coded broadcast to every node that asked; shares otaStream with the ARQ
+static LoRaLink::FecBroadcaster loraFecTx;
+static const uint32_t OTA_BROADCAST_TIMEOUT_MS = 120000; // Listeners may sit out other blocks' repairs
+
+// A WiFi OTA image goes out over LoRa before the receiver reboots into it:
+// notices, then REQUEST_UPDATEs collected through the link layer, then one
+// transfer; ArduinoOTA's own reboot is off so loop() can run all three
+enum class Distribution : uint8_t { IDLE, NOTIFY, COLLECT, SEND };
+static Distribution distribution = Distribution::IDLE;
+static const uint32_t UPDATE_REQUEST_WINDOW_MS = 15000;
+static uint32_t collectStartMs = 0;
+static uint16_t requesters[16];
+static size_t requesterCount = 0;
+static bool moreRequesters = false;
+#endif
 
 // Persistence helpers
 static void savePersistedSettings();
 static void savePersistedRole();
-static void loadPersistedSettingsAndRole();
+static void savePersistedEpoch();
+static void loadPersistedSettingsAndRole(LoRaLink::ConfigPayload& profile);
 static void computeIndicesFromCurrent();
-static void broadcastConfigOnControlChannel(uint8_t times = 8, uint32_t intervalMs = 300);
+static void updateRadioSettings(const LoRaLink::ConfigPayload& profile);
+static void broadcastConfigOnControlChannel(uint8_t times = 8);
+static void registerAppHandlers();
 static void tryReceiveConfigOnControlChannel(uint32_t durationMs = 4000);
 
 // Draw status bar at the bottom of the screen
@@ -174,7 +312,7 @@ static void drawStatusBar() {
     }
 
     // LoRa OTA status
-    if (loraOtaActive) {
+    if (loraLink.ota().isActive()) {
       u8g2.drawStr(xPos, yPos, "LoRaOTA");
     }
   }
@@ -182,6 +320,7 @@ static void drawStatusBar() {
 }
 
 static void oledMsg(const char* l1, const char* l2 = nullptr, const char* l3 = nullptr) {
+  if (!displayReady) return;
   u8g2.clearBuffer();
   u8g2.setFont(u8g2_font_6x10_tr);
 
@@ -194,22 +333,23 @@ static void oledMsg(const char* l1, const char* l2 = nullptr, const char* l3 = n
   if (l2) u8g2.drawStr(2, 32, l2);
 
   // Middle section - signal quality for receiver mode
-  if (!isSender && lastRSSI > -999.0) {
+  if (!isSender && loraLink.lastRssi() > -999.0) {
     char rssiStr[12], snrStr[12];
-    snprintf(rssiStr, sizeof(rssiStr), "RSSI: %.0f", lastRSSI);
-    snprintf(snrStr, sizeof(snrStr), "SNR: %.1f", lastSNR);
+    snprintf(rssiStr, sizeof(rssiStr), "RSSI: %.0f", loraLink.lastRssi());
+    snprintf(snrStr, sizeof(snrStr), "SNR: %.1f", loraLink.lastSnr());
 
     u8g2.drawStr(2, 51, rssiStr);
     u8g2.drawStr(2, 65, snrStr);
   }
 
   // Bottom section - settings (moved up to make room for status bar)
+  const LoRaLink::ConfigPayload& profile = loraLink.profile();
   char settings[32];
-  snprintf(settings, sizeof(settings), "SF%d BW%.0f", currentSF, currentBW);
+  snprintf(settings, sizeof(settings), "SF%d BW%.0f", profile.sf, profile.bwKHz);
   u8g2.drawStr(2, 81, settings);
 
   char modeStr[16];
-  snprintf(modeStr, sizeof(modeStr), "%s %.1fMHz", isSender ? "TX" : "RX", currentFreq);
+  snprintf(modeStr, sizeof(modeStr), "%s %.1fMHz", isSender ? "TX" : "RX", profile.freqMHz);
   u8g2.drawStr(2, 95, modeStr);
 
   // Status bar at the bottom - WiFi and OTA status
@@ -226,37 +366,98 @@ static void oledSettings() {
   oledMsg("Settings", "Updated");
 }
 
-static void startConfigBroadcast(float newFreq, float newBW, int newSF, int newCR, int newTxPower) {
-  pendingConfigBroadcast = true;
-  pendingFreq = newFreq;
-  pendingBW = newBW;
-  pendingSF = newSF;
-  pendingCR = newCR;
-  pendingTxPower = newTxPower;
-  cfgLastTxMs = 0;
-  cfgRemaining = 8; // send several times for reliability
-  oledMsg("Syncing...", "Sending config");
-}
-
-static void computeIndicesFromCurrent() {
-      for (size_t i = 0; i < (sizeof(sfValues) / sizeof(sfValues[0])); i++) {
-      if (sfValues[i] == currentSF) { currentSfIndex = i; break; }
+// Encode and transmit one binary frame (blocking)
+static int transmitFrame(LoRaLink::FrameType type, uint16_t sequence,
+                         const uint8_t* payload = nullptr, size_t payloadSize = 0) {
+  ReceiverPause pause;
+  uint8_t frame[LoRaLink::MAX_FRAME_SIZE];
+  size_t len = LoRaLink::encodeFrame(type, nodeId, sequence, payload, payloadSize, frame, sizeof(frame));
+  if (len == 0) {
+    return RADIOLIB_ERR_PACKET_TOO_LONG;
+  }
+  // Blocking sends are charged to the same duty-cycle budget as queued ones
+  LoRaLink::AirtimeBudget& airtime = loraLink.airtime();
+  uint32_t waitUs;
+  while ((waitUs = airtime.waitUs(len, micros())) > 0) {
+    delay(waitUs / 1000 + 1);
+  }
+#if LORA_LBT
+  // Same backoff as queued frames; after maxAttempts busy scans it goes out anyway
+  LoRaLink::ListenBeforeTalk& lbt = loraLink.listenBeforeTalk();
+  for (;;) {
+    const int cad = radio.scanChannel();
+    if (cad == RADIOLIB_CHANNEL_FREE) {
+      lbt.onClear();
+      break;
     }
-    for (size_t i = 0; i < (sizeof(bwValues) / sizeof(bwValues[0])); i++) {
-      if (bwValues[i] == currentBW) { currentBwIndex = i; break; }
+    if (cad != RADIOLIB_LORA_DETECTED || !lbt.onBusy(micros())) {
+      break;  // A failed scan does not hold the frame back
     }
-    for (size_t i = 0; i < (sizeof(txPowerValues) / sizeof(txPowerValues[0])); i++) {
-      if (txPowerValues[i] == currentTxPower) { currentTxIndex = i; break; }
+    while (!lbt.ready(micros())) {
+      delay(1);
     }
+  }
+#endif
+  airtime.onStart(len, micros());
+  return radio.transmit(frame, len);
+}
+
+// Idle time after a blocking repeat of this frame size
+static uint32_t repeatGapMs(size_t frameBytes) {
+  const LoRaLink::AirtimeBudget& airtime = loraLink.airtime();
+  return airtime.intervalMs(frameBytes, REPEAT_SHARE_PERMILLE) - airtime.airtimeUs(frameBytes) / 1000;
+}
+
+static int transmitConfigFrame(uint16_t sequence, const LoRaLink::ConfigPayload& cfg) {
+  uint8_t payload[LoRaLink::CONFIG_PAYLOAD_SIZE];
+  size_t len = LoRaLink::encodeConfig(cfg, payload, sizeof(payload));
+  return transmitFrame(LoRaLink::FrameType::CONFIG, sequence, payload, len);
+}
+
+// Blocking receive straight into a pool buffer; frame is valid when RADIOLIB_ERR_NONE is returned
+static int receiveFrame(LoRaLink::RxFrame& frame) {
+  int st = radio.receive(frame.data, sizeof(frame.data));
+  frame.length = (st == RADIOLIB_ERR_NONE) ? radio.getPacketLength() : 0;
+  frame.timestampUs = micros();
+  frame.rssi = radio.getRSSI();
+  frame.snr = radio.getSNR();
+  return st;
+}
+
+// Sender: propose new settings; the link layer runs the exchange
+static void startConfigBroadcast(const LoRaLink::ConfigPayload& next) {
+  if (!loraLink.startConfigChange(next)) {
+    Serial.println("[CFG] change already in progress");
+  }
+}
+
+static void computeIndicesFromCurrent() {
+  const LoRaLink::ConfigPayload& profile = loraLink.profile();
+  for (size_t i = 0; i < (sizeof(sfValues) / sizeof(sfValues[0])); i++) {
+    if (sfValues[i] == profile.sf) { currentSfIndex = i; break; }
+  }
+  for (size_t i = 0; i < (sizeof(bwValues) / sizeof(bwValues[0])); i++) {
+    if (bwValues[i] == profile.bwKHz) { currentBwIndex = i; break; }
+  }
+  for (size_t i = 0; i < (sizeof(txPowerValues) / sizeof(txPowerValues[0])); i++) {
+    if (txPowerValues[i] == profile.txPower) { currentTxIndex = i; break; }
+  }
 }
 
 static void savePersistedSettings() {
+  const LoRaLink::ConfigPayload& profile = loraLink.profile();
+  prefs.begin("LtngDet", false);
+  prefs.putFloat("freq", profile.freqMHz);
+  prefs.putFloat("bw", profile.bwKHz);
+  prefs.putInt("sf", profile.sf);
+  prefs.putInt("cr", profile.cr);
+  prefs.putInt("tx", profile.txPower);
+  prefs.end();
+}
+
+static void savePersistedEpoch() {
   prefs.begin("LtngDet", false);
-  prefs.putFloat("freq", currentFreq);
-  prefs.putFloat("bw", currentBW);
-  prefs.putInt("sf", currentSF);
-  prefs.putInt("cr", currentCR);
-  prefs.putInt("tx", currentTxPower);
+  prefs.putUShort("epoch", loraLink.coordinator().epoch());
   prefs.end();
 }
 
@@ -266,7 +467,7 @@ static void savePersistedRole() {
   prefs.end();
 }
 
-static void loadPersistedSettingsAndRole() {
+static void loadPersistedSettingsAndRole(LoRaLink::ConfigPayload& profile) {
   prefs.begin("LtngDet", true);
   bool haveFreq = prefs.isKey("freq");
   bool haveBW = prefs.isKey("bw");
@@ -275,12 +476,14 @@ static void loadPersistedSettingsAndRole() {
   bool haveTX = prefs.isKey("tx");
   bool haveRole = prefs.isKey("sender");
 
-  if (haveFreq) currentFreq = prefs.getFloat("freq", currentFreq);
-  if (haveBW) currentBW = prefs.getFloat("bw", currentBW);
-  if (haveSF) currentSF = prefs.getInt("sf", currentSF);
-  if (haveCR) currentCR = prefs.getInt("cr", currentCR);
-  if (haveTX) currentTxPower = prefs.getInt("tx", currentTxPower);
+  if (haveFreq) profile.freqMHz = prefs.getFloat("freq", profile.freqMHz);
+  if (haveBW) profile.bwKHz = prefs.getFloat("bw", profile.bwKHz);
+  if (haveSF) profile.sf = prefs.getInt("sf", profile.sf);
+  if (haveCR) profile.cr = prefs.getInt("cr", profile.cr);
+  if (haveTX) profile.txPower = prefs.getInt("tx", profile.txPower);
   if (haveRole) isSender = prefs.getBool("sender", isSender);
+  // Receivers ignore epochs they already applied, so a rebooted sender continues from its last one
+  if (prefs.isKey("epoch")) loraLink.coordinator().setEpoch(prefs.getUShort("epoch", 0));
   prefs.end();
 }
 
@@ -318,36 +521,54 @@ static void initDisplay() {
 
   // Rotate display 90 degrees for portrait orientation
   u8g2.setDisplayRotation(U8G2_R1);
+  displayReady = true;
 }
 
-static void updateRadioSettings() {
-  int st = radio.setFrequency(currentFreq);
-  if (st == RADIOLIB_ERR_NONE) {
-    st = radio.setBandwidth(currentBW);
-  }
-  if (st == RADIOLIB_ERR_NONE) {
-    st = radio.setSpreadingFactor(currentSF);
-  }
-  if (st == RADIOLIB_ERR_NONE) {
-    st = radio.setCodingRate(currentCR);
-  }
-  if (st == RADIOLIB_ERR_NONE) {
-    st = radio.setOutputPower(currentTxPower);
+static LoRaLink::ConfigPayload controlProfile() {
+  const LoRaLink::ConfigPayload profile = { CTRL_FREQ_MHZ, CTRL_BW_KHZ, CTRL_SF, CTRL_CR, loraLink.profile().txPower };
+  return profile;
+}
+
+// Move the radio between profiles without a reset; logs what it cost
+static int switchRadioProfile(const LoRaLink::ConfigPayload& profile, const char* tag) {
+  LoRaLink::RadioProfileManager& radioProfile = loraLink.radioProfile();
+  const uint32_t writesBefore = radioProfile.getStats().writes;
+  const int st = radioProfile.apply(profile);
+  if (st != RADIOLIB_ERR_NONE) {
+    Serial.printf("%s profile fail %d\n", tag, st);
+  } else {
+    Serial.printf("%s profile SF%d BW%.0f %.1fMHz: %lu writes, %lu us\n", tag, profile.sf, profile.bwKHz,
+                  profile.freqMHz, (unsigned long)(radioProfile.getStats().writes - writesBefore),
+                  (unsigned long)radioProfile.getStats().lastUs);
   }
+  return st;
+}
 
+// Outcome of a data-channel profile change, from the button or the link layer
+static void reportRadioUpdate(int st) {
+  const LoRaLink::ConfigPayload& profile = loraLink.profile();
   if (st != RADIOLIB_ERR_NONE) {
     Serial.printf("Failed to update radio settings: %d\n", st);
     char errBuf[16]; snprintf(errBuf, sizeof(errBuf), "Settings fail %d", st);
     oledMsg("Settings fail", errBuf);
   } else {
-    Serial.printf("Radio updated: SF%d BW%.0f Tx%ddBm\n", currentSF, currentBW, currentTxPower);
+    Serial.printf("[RADIO] profile SF%d BW%.0f %.1fMHz: %lu us\n", profile.sf, profile.bwKHz, profile.freqMHz,
+                  (unsigned long)loraLink.radioProfile().getStats().lastUs);
+    Serial.printf("Radio updated: SF%d BW%.0f Tx%ddBm\n", profile.sf, profile.bwKHz, profile.txPower);
     oledSettings();
   }
+  computeIndicesFromCurrent();
+  savePersistedSettings();
+}
+
+static void updateRadioSettings(const LoRaLink::ConfigPayload& profile) {
+  waitForTxIdle();
+  reportRadioUpdate(loraLink.applyProfile(profile));
 }
 
-static void initRadioOrHalt() {
+static void initRadioOrHalt(const LoRaLink::ConfigPayload& profile) {
   Serial.println("Initializing LoRa radio...");
-  int st = radio.begin(currentFreq, currentBW, currentSF, currentCR, 0x34, currentTxPower);
+  int st = radio.begin(profile.freqMHz, profile.bwKHz, profile.sf, profile.cr, 0x34, profile.txPower, LORA_PREAMBLE);
   if (st != RADIOLIB_ERR_NONE) {
     char buf[48]; snprintf(buf, sizeof(buf), "Radio fail %d", st);
     oledMsg("Radio init", buf);
@@ -355,83 +576,145 @@ static void initRadioOrHalt() {
   }
   radio.setDio2AsRfSwitch(true);
   radio.setCRC(true);
+  loraLink.begin(profile);
+  registerAppHandlers();
   oledSettings();
 }
 
-static void broadcastConfigOnControlChannel(uint8_t times, uint32_t intervalMs) {
-  // Switch to control channel
-  int st = radio.begin(CTRL_FREQ_MHZ, CTRL_BW_KHZ, CTRL_SF, CTRL_CR, 0x34, currentTxPower);
+#if LORA_DEEP_SLEEP_MS
+// Radio left in warm sleep still holds its configuration: wake it with the
+// setters only, no reset, TCXO start or calibration (RadioProfileManager::restore)
+static int wakeRadioWarm(const LoRaLink::ConfigPayload& profile) {
+  radio.getMod()->init();
+  int st = radio.standby();
+  if (st == RADIOLIB_ERR_NONE) st = loraLink.radioProfile().restore(profile);
+  // Packet parameters RadioLib keeps on its side as well as in the chip
+  if (st == RADIOLIB_ERR_NONE) st = radio.setPreambleLength(LORA_PREAMBLE);
+  if (st == RADIOLIB_ERR_NONE) st = radio.setCRC(true);
+  if (st == RADIOLIB_ERR_NONE) st = radio.explicitHeader();
+  if (st == RADIOLIB_ERR_NONE) st = radio.autoLDRO();
+  return st;
+}
+
+// Save what the next wake needs, put the radio in warm sleep and power down
+static void enterDeepSleep() {
+  waitForTxIdle();
+  if (loraLink.rxEngine().isActive()) loraLink.rxEngine().suspend();
+  if (displayReady) {
+    u8g2.setPowerSave(1);
+    digitalWrite(VEXT_PIN, HIGH);
+  }
+  rtcState.frameSeq = loraLink.frameSequence();
+  rtcState.pingSeq = loraLink.pingSequence();
+  rtcState.profile = loraLink.profile();
+  rtcState.airtimeTokensUs = loraLink.airtime().tokensUs();
+  rtcState.radioWarm = radio.sleep(true) == RADIOLIB_ERR_NONE ? 1 : 0;
+  LoRaLink::sealRtcState(rtcState);
+  Serial.flush();
+  HardwareAbstraction::Power::sleep(HardwareAbstraction::Power::Mode::DEEP_SLEEP, LORA_DEEP_SLEEP_MS);
+}
+
+// Timer wake: one PING from the saved state, then back to sleep. The display,
+// boot delays and control-channel broadcast ran on the cold boot only.
+static void runSleepCycle() {
+  const uint32_t setupUs = micros();
+  rtcState.wakes++;
+  nodeId = static_cast<uint16_t>(ESP.getEfuseMac() >> 32);
+  loraLink.setIdentity(nodeId, true);
+  loraLink.setSequences(rtcState.pingSeq, rtcState.frameSeq);
+  loraLink.setProfile(rtcState.profile);
+  computeIndicesFromCurrent();
+  loraLink.airtime().restore(rtcState.airtimeTokensUs, LORA_DEEP_SLEEP_MS * 1000ull, micros());
+
+  const uint32_t radioStartUs = micros();
+  const int st = rtcState.radioWarm ? wakeRadioWarm(rtcState.profile) : RADIOLIB_ERR_UNKNOWN;
   if (st != RADIOLIB_ERR_NONE) {
-    Serial.printf("[CTRL] begin fail %d\n", st);
-    return;
+    Serial.printf("[SLEEP] warm radio wake failed %d, full init\n", st);
+    initRadioOrHalt(rtcState.profile);
   }
-  radio.setDio2AsRfSwitch(true);
-  radio.setCRC(true);
+  radioDriver.setDio1Action(onRadioDio1);
+  loraLink.seed(static_cast<uint32_t>(ESP.getEfuseMac()) ^ micros());
+
+  // Over budget: skip this wake rather than stay awake waiting for it
+  const uint32_t txStartUs = micros();
+  const uint32_t pingSeq = loraLink.pingSequence();
+  int tx = RADIOLIB_ERR_NONE;
+  const bool send = loraLink.airtime().waitUs(LoRaLink::PING_FRAME_BYTES, txStartUs) == 0;
+  if (send) {
+    tx = transmitFrame(LoRaLink::FrameType::PING, static_cast<uint16_t>(loraLink.takePingSequence()));
+  }
+  const uint32_t txEndUs = micros();
+
+  const LoRaLink::SenderCycle cycle = { LoRaLink::RxPowerModel::defaultProfile().mcuBootUs, radioStartUs - setupUs,
+                                        txStartUs - radioStartUs, 0, 0, txEndUs - txStartUs, 1000,
+                                        LORA_DEEP_SLEEP_MS };
+  const LoRaLink::SenderCycleReport report =
+      LoRaLink::senderCycleReport(cycle, LoRaLink::RxPowerModel::defaultProfile());
+  Serial.printf("[SLEEP] wake %lu PING seq=%lu %s | wake->TX %lu us (radio %lu us%s) | %.0f uC/cycle %.1f uA\n",
+                (unsigned long)rtcState.wakes, (unsigned long)pingSeq,
+                !send ? "SKIP budget" : tx == RADIOLIB_ERR_NONE ? "OK" : "FAIL",
+                (unsigned long)report.wakeToTxUs, (unsigned long)cycle.radioInitUs, st == RADIOLIB_ERR_NONE ? " warm" : "",
+                report.chargeUc, report.averageUa);
+  enterDeepSleep();
+}
+#endif
 
-  char msg[64];
-  snprintf(msg, sizeof(msg), "CFG F=%.1f BW=%.0f SF=%d CR=%d TX=%d",
-           currentFreq, currentBW, currentSF, currentCR, currentTxPower);
+static void broadcastConfigOnControlChannel(uint8_t times) {
+  ReceiverPause pause;
+  const LoRaLink::ConfigPayload profile = loraLink.profile();
+  // Switch to control channel
+  if (switchRadioProfile(controlProfile(), "[CTRL]") != RADIOLIB_ERR_NONE) {
+    switchRadioProfile(profile, "[CTRL] restore");
+    return;
+  }
+  loraLink.airtime().setModulation(LoRaLink::modulationFor(CTRL_SF, CTRL_BW_KHZ, CTRL_CR, LORA_PREAMBLE));
+  const uint32_t gapMs = repeatGapMs(LoRaLink::CONFIG_FRAME_BYTES);
 
+  const uint16_t ctrlSeq = loraLink.nextSequence();
   for (uint8_t i = 0; i < times; i++) {
-    int tx = radio.transmit(msg);
-    Serial.printf("[CTRL][TX] %s %s\n", msg, tx == RADIOLIB_ERR_NONE ? "OK" : "FAIL");
-    delay(intervalMs);
+    int tx = transmitConfigFrame(ctrlSeq, profile);
+    Serial.printf("[CTRL][TX] CFG F=%.1f BW=%.0f SF=%d CR=%d TX=%d %s\n",
+                  profile.freqMHz, profile.bwKHz, profile.sf, profile.cr, profile.txPower,
+                  tx == RADIOLIB_ERR_NONE ? "OK" : "FAIL");
+    delay(gapMs);
   }
 
   // Restore operational settings
-  st = radio.begin(currentFreq, currentBW, currentSF, currentCR, 0x34, currentTxPower);
-  if (st != RADIOLIB_ERR_NONE) {
-    Serial.printf("[CTRL] restore begin fail %d\n", st);
-  } else {
-    radio.setDio2AsRfSwitch(true);
-    radio.setCRC(true);
-  }
+  loraLink.setProfile(profile);
+  switchRadioProfile(profile, "[CTRL] restore");
 }
 
 static void tryReceiveConfigOnControlChannel(uint32_t durationMs) {
+  ReceiverPause pause;
   // Switch to control channel
-  int st = radio.begin(CTRL_FREQ_MHZ, CTRL_BW_KHZ, CTRL_SF, CTRL_CR, 0x34, currentTxPower);
-  if (st != RADIOLIB_ERR_NONE) {
-    Serial.printf("[CTRL] begin fail %d\n", st);
+  if (switchRadioProfile(controlProfile(), "[CTRL]") != RADIOLIB_ERR_NONE) {
+    switchRadioProfile(loraLink.profile(), "[CTRL] restore");
     return;
   }
-  radio.setDio2AsRfSwitch(true);
-  radio.setCRC(true);
 
+  LoRaLink::RxFrame* rx = loraLink.framePool().acquire();
   uint32_t start = millis();
-  while (millis() - start < durationMs) {
-    String rx;
-    int r = radio.receive(rx);
-    if (r == RADIOLIB_ERR_NONE && rx.startsWith("CFG ")) {
-      float nf = currentFreq;
-      float nb = currentBW;
-      int nsf = currentSF;
-      int ncr = currentCR;
-      int ntx = currentTxPower;
-      int parsed = sscanf(rx.c_str(), "CFG F=%f BW=%f SF=%d CR=%d TX=%d", &nf, &nb, &nsf, &ncr, &ntx);
-      if (parsed == 5) {
-        currentFreq = nf;
-        currentBW = nb;
-        currentSF = nsf;
-        currentCR = ncr;
-        currentTxPower = ntx;
-        computeIndicesFromCurrent();
-        savePersistedSettings();
-        Serial.printf("[CTRL][RX] applied %s\n", rx.c_str());
-        break;
-      }
+  while (rx != nullptr && millis() - start < durationMs) {
+    LoRaLink::FrameView frame;
+    LoRaLink::ConfigPayload cfg;
+    int r = receiveFrame(*rx);
+    if (r == RADIOLIB_ERR_NONE &&
+        LoRaLink::decodeFrame(rx->data, rx->length, frame) == LoRaLink::DecodeResult::OK &&
+        frame.header.type == LoRaLink::FrameType::CONFIG &&
+        LoRaLink::decodeConfig(frame.payload, frame.payloadSize, cfg)) {
+      loraLink.setProfile(cfg);
+      computeIndicesFromCurrent();
+      savePersistedSettings();
+      Serial.printf("[CTRL][RX] applied CFG F=%.1f BW=%.0f SF=%d CR=%d TX=%d from %04X\n",
+                    cfg.freqMHz, cfg.bwKHz, cfg.sf, cfg.cr, cfg.txPower, frame.header.nodeId);
+      break;
     }
     delay(50);
   }
+  loraLink.framePool().release(rx);
 
   // Restore operational settings (applied ones if updated)
-  st = radio.begin(currentFreq, currentBW, currentSF, currentCR, 0x34, currentTxPower);
-  if (st != RADIOLIB_ERR_NONE) {
-    Serial.printf("[CTRL] restore begin fail %d\n", st);
-  } else {
-    radio.setDio2AsRfSwitch(true);
-    radio.setCRC(true);
-  }
+  switchRadioProfile(loraLink.profile(), "[CTRL] restore");
 }
 
 static void updateButton() {
@@ -452,19 +735,21 @@ static void updateButton() {
     if (pressDuration < 100) {
       // Very short press - ignore (debounce)
     } else if (pressDuration < 1000) {
-      // Short press - toggle mode
+      // Short press - toggle mode; both roles listen between transmissions
+      waitForTxIdle();
       isSender = !isSender;
-      seq = 0;
+      loraLink.setRole(isSender);
+      registerAppHandlers();
       savePersistedRole();
       oledRole();
       Serial.printf("Switched mode -> %s\n", isSender ? "Sender" : "Receiver");
     } else if (pressDuration < 3000) {
       // Medium press - cycle SF (sender) or network mode (receiver)
+      LoRaLink::ConfigPayload next = loraLink.profile();
+      next.sf = sfValues[(currentSfIndex + 1) % (sizeof(sfValues) / sizeof(sfValues[0]))];
       if (isSender) {
-            const int nextIndex = (currentSfIndex + 1) % (sizeof(sfValues) / sizeof(sfValues[0]));
-    const int nextSF = sfValues[nextIndex];
-        startConfigBroadcast(currentFreq, currentBW, nextSF, currentCR, currentTxPower);
-        Serial.printf("SF change requested -> %d (broadcasting to receiver)\n", nextSF);
+        startConfigBroadcast(next);
+        Serial.printf("SF change requested -> %d (broadcasting to receiver)\n", next.sf);
       } else {
 #ifdef ENABLE_WIFI_OTA
         // Cycle through network modes for receiver
@@ -520,26 +805,20 @@ static void updateButton() {
         }
 #else
         // For non-WiFi receivers, cycle SF instead
-        currentSfIndex = (currentSfIndex + 1) % (sizeof(sfValues) / sizeof(sfValues[0]));
-        currentSF = sfValues[currentSfIndex];
-        updateRadioSettings();
-        savePersistedSettings();
-        Serial.printf("SF changed to %d\n", currentSF);
+        updateRadioSettings(next);
+        Serial.printf("SF changed to %d\n", next.sf);
 #endif
       }
     } else {
       // Long press - cycle BW
+      LoRaLink::ConfigPayload next = loraLink.profile();
+      next.bwKHz = bwValues[(currentBwIndex + 1) % (sizeof(bwValues) / sizeof(bwValues[0]))];
       if (isSender) {
-        const int nextIndex = (currentBwIndex + 1) % (sizeof(bwValues) / sizeof(bwValues[0]));
-        const float nextBW = bwValues[nextIndex];
-        startConfigBroadcast(currentFreq, nextBW, currentSF, currentCR, currentTxPower);
-        Serial.printf("BW change requested -> %.0f kHz (broadcasting to receiver)\n", nextBW);
+        startConfigBroadcast(next);
+        Serial.printf("BW change requested -> %.0f kHz (broadcasting to receiver)\n", next.bwKHz);
       } else {
-        currentBwIndex = (currentBwIndex + 1) % (sizeof(bwValues) / sizeof(bwValues[0]));
-        currentBW = bwValues[currentBwIndex];
-        updateRadioSettings();
-        savePersistedSettings();
-        Serial.printf("BW changed to %.0f kHz\n", currentBW);
+        updateRadioSettings(next);
+        Serial.printf("BW changed to %.0f kHz\n", next.bwKHz);
       }
     }
 
@@ -555,30 +834,318 @@ static void initWiFi();
 static void initOTA();
 static void triggerLoraFirmwareUpdates();
 static bool storeCurrentFirmware();
+static void serviceLoraDistribution();
 #endif
-static void handleLoraOtaPacket(const String& packet);
-static void checkLoraOtaTimeout();
 // Only receivers send firmware out
 #ifdef ENABLE_WIFI_OTA
-static void sendLoraOtaUpdate(const uint8_t* firmware, size_t firmwareSize);
+static void sendLoraOtaUpdate(LoRaLink::IImageSource& firmware);
+static void serviceLoraOtaStream();
+static void onOtaNack(const LoRaLink::FrameView& frame, const LoRaLink::RxFrame& rx, void* context);
+static void sendLoraFecBroadcast(LoRaLink::IImageSource& firmware);
+static void serviceLoraFecBroadcast();
+static void onOtaBlockNeed(const LoRaLink::FrameView& frame, const LoRaLink::RxFrame& rx, void* context);
 #endif
 
 // OLED Display Functions
 static void drawStatusBar();
 
+// What the link layer reports: serial log, OLED and persistence
+class LinkEvents : public LoRaLink::ILinkListener {
+public:
+  void onFrame(const LoRaLink::FrameView& frame, const LoRaLink::RxFrame& rx, bool handled) override {
+    const LoRaLink::FrameHeader& h = frame.header;
+    if (!handled) {
+      // Anything without a handler for the current role is just logged
+      const char* name = LoRaLink::frameTypeToString(h.type);
+      char l2[20]; snprintf(l2, sizeof(l2), "RSSI %.1f", rx.rssi);
+      Serial.printf("[RX] %s from %04X | %s | SNR %.1f | PKT:%lu\n",
+                    name, h.nodeId, l2, rx.snr, (unsigned long)loraLink.getStats().frames);
+      oledMsg("RX", name, l2);
+      return;
+    }
+    switch (h.type) {
+      case LoRaLink::FrameType::PING: {
+        char seqStr[20]; snprintf(seqStr, sizeof(seqStr), "seq=%u", (unsigned)h.sequence);
+        oledMsg("PING", seqStr);
+        break;
+      }
+      case LoRaLink::FrameType::CONFIG_PREPARE: {
+        LoRaLink::ConfigPrepare prepare;
+        if (LoRaLink::decodeConfigPrepare(frame.payload, frame.payloadSize, prepare)) {
+          Serial.printf("[CFG] PREPARE epoch %u round %u from %04X: SF%d BW%.0f TX%d | %u acked\n",
+                        (unsigned)prepare.epoch, (unsigned)prepare.round, h.nodeId, prepare.config.sf,
+                        prepare.config.bwKHz, prepare.config.txPower, (unsigned)prepare.ackedCount);
+        }
+        break;
+      }
+      case LoRaLink::FrameType::CONFIG_COMMIT: {
+        LoRaLink::ConfigCommitMessage commit;
+        if (LoRaLink::decodeConfigCommit(frame.payload, frame.payloadSize, commit)) {
+          Serial.printf("[CFG] %s epoch %u from %04X, switch in %lu ms\n",
+                        commit.decision == LoRaLink::CommitDecision::COMMIT ? "COMMIT" : "ABORT",
+                        (unsigned)commit.epoch, h.nodeId, (unsigned long)commit.switchInMs);
+        }
+        break;
+      }
+      case LoRaLink::FrameType::CONFIG_ACK:
+        Serial.printf("[CFG] ACK from %04X | %u acked\n", h.nodeId,
+                      (unsigned)loraLink.coordinator().ackedCount());
+        break;
+      case LoRaLink::FrameType::FW_UPDATE_AVAILABLE:
+      case LoRaLink::FrameType::UPDATE_NOW:
+        Serial.println("FW update notice received; requesting update...");
+        break;
+#if LORA_TDMA
+      case LoRaLink::FrameType::TDMA_BEACON:
+        if (tdmaNode.slot() != tdmaSlot_ && tdmaNode.slot() >= 0) {
+          char l2[20]; snprintf(l2, sizeof(l2), "slot %d", tdmaNode.slot());
+          Serial.printf("[TDMA] %s | superframe %lu ms\n", l2, (unsigned long)(tdmaNode.superframeUs() / 1000));
+          oledMsg("TDMA", l2);
+        }
+        tdmaSlot_ = tdmaNode.slot();
+        break;
+#endif
+      default:
+        break;
+    }
+  }
+
+  void onDropped(LoRaLink::DecodeResult result, size_t length) override {
+    Serial.printf("[RX] DROP %s (%u bytes) | ERR:%lu\n", LoRaLink::decodeResultToString(result),
+                  (unsigned)length, (unsigned long)errorCount());
+  }
+
+  void onMalformed(const LoRaLink::FrameView& frame) override {
+    Serial.printf("[RX] %s PARSE FAIL | %u bytes\n", LoRaLink::frameTypeToString(frame.header.type),
+                  (unsigned)frame.payloadSize);
+    oledMsg("RX", "bad payload");
+  }
+
+  void onReadError() override {
+    Serial.printf("[RX] FAIL read | ERR:%lu\n", (unsigned long)errorCount());
+    oledMsg("RX FAIL", "read");
+  }
+
+  // Completion report for every frame that left the TX queue
+  void onTxComplete(const LoRaLink::TxResult& result) override {
+#ifdef ENABLE_WIFI_OTA
+    if (result.type == LoRaLink::FrameType::OTA_START || result.type == LoRaLink::FrameType::OTA_DATA ||
+        result.type == LoRaLink::FrameType::OTA_END) {
+      otaSender.onSent(millis(), otaStream.pendingAirUs); // A failed send is just a lost frame to the ARQ
+    } else if (result.type == LoRaLink::FrameType::OTA_CODED_START ||
+               result.type == LoRaLink::FrameType::OTA_CODED || result.type == LoRaLink::FrameType::OTA_BLOCK_POLL) {
+      loraFecTx.onSent(millis(), otaStream.pendingAirUs);
+    }
+#endif
+    const char* name = LoRaLink::frameTypeToString(result.type);
+    const unsigned long latencyMs = result.latencyUs / 1000;
+    if (result.status != RADIOLIB_ERR_NONE) {
+      char e[24]; snprintf(e, sizeof(e), "err %d", result.status);
+      Serial.printf("[TX] %s seq=%u FAIL %s\n", name, (unsigned)result.sequence, e);
+      oledMsg("TX FAIL", name, e);
+      return;
+    }
+    if (result.type == LoRaLink::FrameType::OTA_DATA) {
+      return; // Progress is reported as NACKs confirm chunks
+    }
+    Serial.printf("[TX] %s seq=%u OK %lums | Q:%u\n", name, (unsigned)result.sequence,
+                  latencyMs, (unsigned)loraLink.txScheduler().depth());
+    if (result.type == LoRaLink::FrameType::PING) {
+      // Show ping on two lines
+      char seqLine[20]; snprintf(seqLine, sizeof(seqLine), "seq=%u", (unsigned)result.sequence);
+      oledMsg("PING", seqLine);
+    }
+  }
+
+  void onQueueFull(LoRaLink::FrameType type, uint16_t sequence) override {
+    char msg[48];
+    snprintf(msg, sizeof(msg), "%s seq=%u", LoRaLink::frameTypeToString(type), (unsigned)sequence);
+    Serial.printf("[TX] %s FAIL queue full\n", msg);
+    oledMsg("TX FAIL", msg, "queue full");
+  }
+
+  void onProfileChanged(const LoRaLink::ConfigPayload& profile, LoRaLink::ProfileSource source, int status) override {
+    reportRadioUpdate(status);
+    char l1[24]; snprintf(l1, sizeof(l1), "SF%d BW%.0f", profile.sf, profile.bwKHz);
+    switch (source) {
+      case LoRaLink::ProfileSource::CONFIG:
+        Serial.printf("[RX] APPLIED CFG F=%.1f BW=%.0f SF=%d CR=%d TX=%d | PKT:%lu\n", profile.freqMHz,
+                      profile.bwKHz, profile.sf, profile.cr, profile.txPower,
+                      (unsigned long)loraLink.getStats().frames);
+        oledMsg("SYNC", l1);
+        break;
+      case LoRaLink::ProfileSource::COMMIT:
+        Serial.printf("[CFG] epoch %u switched after %lu ms\n", (unsigned)loraLink.coordinator().epoch(),
+                      (unsigned long)loraLink.coordinator().getStats().lastSwitchoverMs);
+        oledMsg("Sync complete", "TX switched");
+        break;
+      case LoRaLink::ProfileSource::PARTICIPANT:
+        Serial.printf("[CFG] epoch %u applied F=%.1f BW=%.0f SF=%d CR=%d TX=%d\n",
+                      (unsigned)loraLink.participant().appliedEpoch(), profile.freqMHz, profile.bwKHz, profile.sf,
+                      profile.cr, profile.txPower);
+        oledMsg("SYNC", l1);
+        break;
+      default:
+        break;
+    }
+  }
+
+  void onConfigStarted(const LoRaLink::ConfigPayload& next, uint16_t epoch) override {
+    savePersistedEpoch();
+    Serial.printf("[CFG] epoch %u: F=%.1f BW=%.0f SF=%d CR=%d TX=%d, %u known nodes\n", (unsigned)epoch,
+                  next.freqMHz, next.bwKHz, next.sf, next.cr, next.txPower,
+                  (unsigned)loraLink.coordinator().rosterSize(millis()));
+    oledMsg("Syncing...", "Sending config");
+  }
+
+  void onConfigRound(LoRaLink::CommitAction action, bool queued) override {
+    const LoRaLink::ConfigCoordinator& commit = loraLink.coordinator();
+    const bool prepare = action == LoRaLink::CommitAction::SEND_PREPARE;
+    Serial.printf("[CFG] %s epoch %u | %u/%u acked%s\n", prepare ? "PREPARE" : commit.committing() ? "COMMIT" : "ABORT",
+                  (unsigned)commit.epoch(), (unsigned)commit.ackedCount(), (unsigned)commit.rosterSize(millis()),
+                  queued ? "" : " FAIL queue full");
+    if (!prepare && !commit.committing()) {
+      oledMsg("Sync aborted", "No acks");
+    }
+  }
+
+  void onAdrRequest(const LoRaLink::ConfigPayload& next, bool queued) override {
+    const LoRaLink::ConfigPayload& current = loraLink.profile();
+    Serial.printf("[ADR] SF%d BW%.0f TX%d -> SF%d BW%.0f TX%d (%u links)%s\n", current.sf, current.bwKHz,
+                  current.txPower, next.sf, next.bwKHz, next.txPower, (unsigned)loraLink.adr().linkCount(),
+                  queued ? "" : " FAIL queue full");
+  }
+
+  void onOta(LoRaLink::OtaEvent event, LoRaLink::OtaResult result) override {
+    LoRaLink::OtaReceiver& ota = loraLink.ota();
+    const char* reason = LoRaLink::OtaReceiver::resultToString(result);
+    switch (event) {
+      case LoRaLink::OtaEvent::STARTED:
+        if (loraLink.isOtaBroadcast()) {
+          Serial.printf("LoRa OTA broadcast starting: %lu bytes in %lu chunks\n",
+                        (unsigned long)ota.getInfo().imageSize, (unsigned long)ota.chunkCount());
+          oledMsg("LoRa OTA", "Broadcast...");
+        } else {
+          Serial.printf("LoRa OTA starting: %lu bytes in %lu chunks (flags 0x%02x)\n",
+                        (unsigned long)ota.getInfo().imageSize, (unsigned long)ota.chunkCount(),
+                        (unsigned)ota.getInfo().flags);
+          oledMsg("LoRa OTA", "Starting...");
+        }
+        break;
+      case LoRaLink::OtaEvent::START_FAILED:
+        Serial.printf("LoRa OTA start failed: %s\n", reason);
+        oledMsg("OTA Error", "Begin failed!");
+        break;
+      case LoRaLink::OtaEvent::PROGRESS: {
+        char progressStr[20];
+        snprintf(progressStr, sizeof(progressStr), "%d%%", ota.percent());
+        oledMsg("LoRa OTA", progressStr);
+        break;
+      }
+      case LoRaLink::OtaEvent::CHUNK_FAILED:
+        Serial.printf("LoRa OTA chunk: %s\n", reason);
+        break;
+      case LoRaLink::OtaEvent::ROUND_DONE:
+        Serial.printf("LoRa OTA round done, %lu chunks missing (first %lu)\n",
+                      (unsigned long)ota.missingChunks(), (unsigned long)ota.nextMissing());
+        break;
+      case LoRaLink::OtaEvent::FINISHED:
+        if (loraLink.isOtaBroadcast()) {
+          const LoRaLink::FecReceiveStats& st = loraLink.fecStats();
+          Serial.printf("LoRa OTA broadcast: %lu packets, %lu innovative, %lu blocks decoded\n",
+                        (unsigned long)st.packets, (unsigned long)st.innovative, (unsigned long)st.blocksDecoded);
+        }
+        if (result == LoRaLink::OtaResult::OK) {
+          Serial.println("Firmware flashed successfully!");
+          oledMsg("OTA Complete", "Rebooting...");
+          waitForTxIdle();
+          delay(2000);
+          ESP.restart();
+        } else if (loraOtaStaged.failureReason() != nullptr) {
+          Serial.printf("Firmware decode failed: %s\n", loraOtaStaged.failureReason());
+          oledMsg("OTA Error", loraOtaStaged.failureReason());
+        } else {
+          Serial.printf("Firmware flash failed: %s\n", reason);
+          oledMsg("OTA Error", reason);
+        }
+        break;
+      case LoRaLink::OtaEvent::TIMEOUT:
+        Serial.printf("LoRa OTA timeout! %lu/%lu chunks\n", (unsigned long)ota.chunksReceived(),
+                      (unsigned long)ota.chunkCount());
+        oledMsg("LoRa OTA", "Timeout!");
+        break;
+    }
+  }
+
+  // Receiver: send the stored firmware if there is one, or list the node
+  // while a distribution collects requests
+  bool onUpdateRequest(uint16_t nodeId) override {
+    Serial.println("Transmitter requested firmware update!");
+    oledMsg("Update Req", "Received");
+#ifdef ENABLE_WIFI_OTA
+    if (distribution == Distribution::COLLECT) {
+      // Counted now, served when the window closes; retries repeat the node
+      bool known = false;
+      for (size_t i = 0; i < requesterCount; i++) {
+        known = known || requesters[i] == nodeId;
+      }
+      if (!known && requesterCount < sizeof(requesters) / sizeof(requesters[0])) {
+        requesters[requesterCount++] = nodeId;
+        Serial.printf("Transmitter %04X requested update!\n", nodeId);
+      } else if (!known) {
+        moreRequesters = true;
+      }
+      return true;
+    }
+    if (firmwareStore.hasImage()) {
+      Serial.printf("Sending stored firmware (%lu bytes) to transmitter\n", (unsigned long)firmwareStore.size());
+      oledMsg("Sending FW", "To TX");
+      sendLoraOtaUpdate(firmwareStore);
+      return true;
+    }
+    Serial.println("No firmware stored to send!");
+    oledMsg("No FW", "Stored");
+#endif
+    return false;
+  }
+
+  // Multi-frame message from sendMessage() on another node
+  void onMessage(uint16_t nodeId, uint8_t kind, const uint8_t*, size_t length) override {
+    const LoRaLink::ReassemblyStats& st = loraLink.reassembler().getStats();
+    Serial.printf("[RX] MESSAGE from %04X kind 0x%02x, %u bytes | timed out %lu evicted %lu\n", nodeId,
+                  (unsigned)kind, (unsigned)length, (unsigned long)st.timedOut, (unsigned long)st.evicted);
+  }
+
+private:
+#if LORA_TDMA
+  int tdmaSlot_ = -1;
+#endif
+
+  static uint32_t errorCount() {
+    return loraLink.getStats().dropped + loraLink.getStats().readErrors;
+  }
+};
+
+static LinkEvents linkEvents;
+
 void setup() {
   Serial.begin(115200);
+  loraLink.setListener(&linkEvents);
+#if LORA_DEEP_SLEEP_MS
+  HardwareAbstraction::initialize();
+  if (HardwareAbstraction::Power::getWakeCause() == HardwareAbstraction::Power::WakeCause::TIMER &&
+      LoRaLink::rtcStateValid(rtcState)) {
+    runSleepCycle();  // Does not return
+  }
+  rtcState.wakes = 0;
+#endif
   delay(500);
   Serial.println("\n=== LtngDet LoRa + OLED (Heltec V3) ===");
 
   pinMode(BUTTON_PIN, INPUT_PULLUP);
 
   // Initialize current values
-  currentFreq = LORA_FREQ_MHZ;
-  currentBW = LORA_BW_KHZ;
-  currentSF = LORA_SF;
-  currentCR = LORA_CR;
-  currentTxPower = LORA_TX_DBM;
+  LoRaLink::ConfigPayload profile = { LORA_FREQ_MHZ, LORA_BW_KHZ, LORA_SF, LORA_CR, LORA_TX_DBM };
 
   // initial role from build flags
 #ifdef ROLE_SENDER
@@ -589,19 +1156,50 @@ void setup() {
   isSender = true;
 #endif
 
+  nodeId = static_cast<uint16_t>(ESP.getEfuseMac() >> 32);
+#if LORA_TDMA
+  loraLink.attachTdma(&tdmaCoord, &tdmaNode);
+#endif
+#if LORA_CAD_WAKE
+  loraLink.attachCadWake(&cadWake);
+#endif
+#if LORA_CAPTURE
+  loraLink.attachCapture(&captureRing);
+#endif
+
   // Load persisted settings/role (overrides defaults when present)
-  loadPersistedSettingsAndRole();
+  loadPersistedSettingsAndRole(profile);
+  loraLink.setIdentity(nodeId, isSender);
+  loraLink.setProfile(profile);
   computeIndicesFromCurrent();
 
   initDisplay();
   oledMsg("Booting...", "Heltec V3");
   oledRole();
 
-  initRadioOrHalt();
+  initRadioOrHalt(profile);
+  radioDriver.setDio1Action(onRadioDio1);
+#if LORA_RX_DUTY_CYCLE
+  // Light sleep between frames: RxDone on DIO1 or the button wakes the chip.
+  // DIO1 goes back to setDio1Action's RISING edge after every sleep
+  HardwareAbstraction::initialize();
+  HardwareAbstraction::Power::setWakeupPin(PIN_LORA_DIO1, HardwareAbstraction::GPIO::Level::LEVEL_HIGH, RISING);
+  HardwareAbstraction::Power::setWakeupPin(BUTTON_PIN, HardwareAbstraction::GPIO::Level::LEVEL_LOW);
+  if (!isSender && !loraLink.rxEngine().isDutyCycled()) {
+    Serial.printf("[RX] preamble of %d symbols too short for RX duty cycle, staying in RX\n", LORA_PREAMBLE);
+  }
+#endif
+  loraLink.seed(static_cast<uint32_t>(ESP.getEfuseMac()) ^ micros());
 
   // Initialize WiFi and OTA for receivers
 #ifdef ENABLE_WIFI_OTA
   if (!isSender) {
+    if (firmwareStore.load()) {
+      Serial.printf("Stored firmware: %lu bytes, version %06lx\n", (unsigned long)firmwareStore.size(),
+                    (unsigned long)firmwareStore.info().version);
+    } else if (!firmwareStoreRegion.isPresent()) {
+      Serial.println("No fwstore/spiffs partition; LoRa firmware distribution disabled");
+    }
     initWiFi();
     if (wifiConnected) {
       initOTA();
@@ -615,188 +1213,103 @@ void setup() {
     // Give receivers time to enter control-channel listen
     delay(750);
     // Also use the control channel to reach mismatched receivers
-    broadcastConfigOnControlChannel(6, 250);
-    startConfigBroadcast(currentFreq, currentBW, currentSF, currentCR, currentTxPower);
+    broadcastConfigOnControlChannel(6);
+    startConfigBroadcast(loraLink.profile());
   }
   // Try to catch a control-channel config at boot if receiver
   if (!isSender) {
     tryReceiveConfigOnControlChannel(6000);
   }
+  // Both roles listen between transmissions; senders need it for OTA
+  if (!loraLink.listen()) {
+    Serial.printf("[CAD] preamble of %d symbols too short for CAD wake, staying in RX\n", LORA_PREAMBLE);
+  }
+}
+
+// Handlers of the application's own on top of the link layer's; called
+// after begin() and every role change, which rebuild the table
+static void registerAppHandlers() {
+#ifdef ENABLE_WIFI_OTA
+  if (!isSender) {
+    loraLink.dispatcher().on(LoRaLink::FrameType::OTA_NACK, onOtaNack);
+    loraLink.dispatcher().on(LoRaLink::FrameType::OTA_BLOCK_NEED, onOtaBlockNeed);
+  }
+#endif
+}
+
+// Receiver: one line per sender heard, in table order
+static void serviceLinkReport(uint32_t now) {
+  static uint32_t lastReportMs = 0;
+  const LoRaLink::LinkTable& linkTable = loraLink.linkTable();
+  if (now - lastReportMs < LINK_REPORT_MS || linkTable.size() == 0) return;
+  lastReportMs = now;
+  const LoRaLink::LinkTableStats& ls = linkTable.getStats();
+  Serial.printf("[LINK] %u nodes | evictions=%lu\n", (unsigned)linkTable.size(), (unsigned long)ls.evictions);
+  for (size_t i = 0; i < linkTable.capacity(); ++i) {
+    const LoRaLink::LinkEntry* e = linkTable.slot(i);
+    if (e == nullptr) continue;
+    Serial.printf("[LINK] %04X seen %lus ago | RSSI %.1f SNR %.1f | loss %.1f%% (%lu missed) | %lu pkts %lu B\n",
+                  e->nodeId, (unsigned long)((now - e->lastSeenMs) / 1000), e->rssi(), e->snr(),
+                  e->loss() * 100.0f, (unsigned long)e->missed, (unsigned long)e->frames,
+                  (unsigned long)e->bytes);
+  }
+}
+
+#if LORA_CAPTURE
+// Whole records per write, so log lines fall between them; stops while the UART is backed up
+static void serviceCapture() {
+  uint8_t chunk[LoRaLink::CAPTURE_MAX_RECORD];
+  size_t n;
+  while (Serial.availableForWrite() >= 64 && (n = captureRing.read(chunk, sizeof(chunk))) > 0) {
+    Serial.write(chunk, n);
+  }
+}
+#endif
+
+#if LORA_RX_DUTY_CYCLE
+static const uint32_t RX_SLEEP_MAX_MS = 1000;  // Housekeeping pass at least this often
+
+// Receiver with nothing queued: light-sleep until RxDone, the button or the
+// next housekeeping pass. False when it has to stay awake.
+static bool lightSleepReceiver() {
+  LoRaLink::RxEngine& rxEngine = loraLink.rxEngine();
+  if (isSender || !rxEngine.isDutyCycled() || buttonPressed || loraLink.txScheduler().isBusy() ||
+      rxEngine.available() || rxEngine.hasPendingIrq() || loraLink.participant().isPrepared()) {
+    return false;
+  }
+#ifdef ENABLE_WIFI_OTA
+  if (wifiConnected) {
+    return false;  // WiFi does not survive light sleep
+  }
+#endif
+  Serial.flush();
+  HardwareAbstraction::Power::sleep(HardwareAbstraction::Power::Mode::LIGHT_SLEEP, RX_SLEEP_MAX_MS);
+  rxEngine.onWake(digitalRead(PIN_LORA_DIO1) == HIGH, micros());
+  return true;
 }
+#endif
 
 void loop() {
-  static uint32_t lastTxMs = 0;
-  static uint32_t lastRxMs = 0;
   uint32_t now = millis();
 
   // Check button more frequently
   updateButton();
 
-  if (isSender) {
-    if (pendingConfigBroadcast) {
-      if (now - lastTxMs >= 50 && now - cfgLastTxMs >= 300) {
-        char msg[64];
-        snprintf(msg, sizeof(msg), "CFG F=%.1f BW=%.0f SF=%d CR=%d TX=%d",
-                 pendingFreq, pendingBW, pendingSF, pendingCR, pendingTxPower);
-        int st = radio.transmit(msg);
-        if (st == RADIOLIB_ERR_NONE) {
-          Serial.printf("[TX] %s OK\n", msg);
-        } else {
-          Serial.printf("[TX] %s FAIL %d\n", msg, st);
-        }
-        cfgLastTxMs = now;
-        cfgRemaining--;
-        if (cfgRemaining <= 0) {
-          // Apply the new settings on the transmitter after broadcasting
-          currentFreq = pendingFreq;
-          currentBW = pendingBW;
-          currentSF = pendingSF;
-          currentCR = pendingCR;
-          currentTxPower = pendingTxPower;
-
-          // Update index trackers to reflect applied settings
-          for (size_t i = 0; i < (sizeof(sfValues) / sizeof(sfValues[0])); i++) {
-            if (sfValues[i] == currentSF) { currentSfIndex = i; break; }
-          }
-          for (size_t i = 0; i < (sizeof(bwValues) / sizeof(bwValues[0])); i++) {
-            if (bwValues[i] == currentBW) { currentBwIndex = i; break; }
-          }
-          for (size_t i = 0; i < (sizeof(txPowerValues) / sizeof(txPowerValues[0])); i++) {
-            if (txPowerValues[i] == currentTxPower) { currentTxIndex = i; break; }
-          }
-
-          updateRadioSettings();
-          savePersistedSettings();
-          oledMsg("Sync complete", "TX switched");
-          pendingConfigBroadcast = false;
-          lastTxMs = now; // reset TX timer
-        }
-      }
-    } else {
-      // Non-blocking TX every 2 seconds
-      if (now - lastTxMs >= 2000) {
-        char msg[48];
-        snprintf(msg, sizeof(msg), "PING seq=%lu", (unsigned long)seq++);
-        int st = radio.transmit(msg);
-        if (st == RADIOLIB_ERR_NONE) {
-          Serial.printf("[TX] %s OK\n", msg);
-          // Show ping on two lines
-          unsigned long usedSeq = (unsigned long)(seq - 1);
-          char seqLine[20]; snprintf(seqLine, sizeof(seqLine), "seq=%lu", usedSeq);
-          oledMsg("PING", seqLine);
-        } else {
-          char e[24]; snprintf(e, sizeof(e), "err %d", st);
-          Serial.printf("[TX] %s FAIL %s\n", msg, e);
-          oledMsg("TX FAIL", msg, e);
-        }
-        lastTxMs = now;
-      }
-    }
-  } else {
-    // Non-blocking RX every 50ms
-    if (now - lastRxMs >= 50) {
-      String rx;
-      int st = radio.receive(rx);
-      if (st == RADIOLIB_ERR_NONE) {
-        float rssi = radio.getRSSI();
-        float snr  = radio.getSNR();
-
-        // Update signal quality tracking
-        lastRSSI = rssi;
-        lastSNR = snr;
-        lastPacketTime = now;
-        packetCount++;
-
-        if (rx.startsWith("CFG ")) {
-          float nf = currentFreq;
-          float nb = currentBW;
-          int nsf = currentSF;
-          int ncr = currentCR;
-          int ntx = currentTxPower;
-          int parsed = sscanf(rx.c_str(), "CFG F=%f BW=%f SF=%d CR=%d TX=%d", &nf, &nb, &nsf, &ncr, &ntx);
-          if (parsed == 5) {
-            currentFreq = nf;
-            currentBW = nb;
-            currentSF = nsf;
-            currentCR = ncr;
-            currentTxPower = ntx;
-
-            // Update index trackers to reflect applied settings
-            for (size_t i = 0; i < (sizeof(sfValues) / sizeof(sfValues[0])); i++) {
-              if (sfValues[i] == currentSF) { currentSfIndex = i; break; }
-            }
-            for (size_t i = 0; i < (sizeof(bwValues) / sizeof(bwValues[0])); i++) {
-              if (bwValues[i] == currentBW) { currentBwIndex = i; break; }
-            }
-            for (size_t i = 0; i < (sizeof(txPowerValues) / sizeof(txPowerValues[0])); i++) {
-              if (txPowerValues[i] == currentTxPower) { currentTxIndex = i; break; }
-            }
-
-            updateRadioSettings();
-            savePersistedSettings();
-            char l2[20]; snprintf(l2, sizeof(l2), "RSSI %.1f", rssi);
-            Serial.printf("[RX] APPLIED %s | SNR %.1f | PKT:%lu\n", rx.c_str(), snr, packetCount);
-            oledMsg("SYNC", rx.c_str(), l2);
-          } else {
-            char l2[20]; snprintf(l2, sizeof(l2), "RSSI %.1f", rssi);
-            Serial.printf("[RX] CFG PARSE FAIL | %s | SNR %.1f | PKT:%lu\n", rx.c_str(), snr, packetCount);
-            oledMsg("RX", rx.c_str(), l2);
-          }
-        } else if (rx.startsWith("OTA_")) {
-          // Handle OTA packets (both roles)
-          handleLoraOtaPacket(rx);
-        } else if (rx.startsWith("FW_UPDATE_AVAILABLE") || rx.startsWith("UPDATE_NOW")) {
-          // Sender: request update when notified
-          if (isSender) {
-            Serial.println("FW update notice received; requesting update...");
-            radio.transmit("REQUEST_UPDATE");
-          }
-        } else if (rx.startsWith("REQUEST_UPDATE")) {
-          // Receiver only: handle update request from transmitter
-          if (!isSender) {
-            Serial.println("Transmitter requested firmware update!");
-            oledMsg("Update Req", "Received");
-
-            // Acknowledge the request
-            radio.transmit("UPDATE_ACK");
-            delay(100);
-
-            // Send the actual firmware if we have it stored
-            #ifdef ENABLE_WIFI_OTA
-            if (hasStoredFirmware && storedFirmwareSize > 0) {
-              Serial.printf("Sending stored firmware (%zu bytes) to transmitter\n", storedFirmwareSize);
-              oledMsg("Sending FW", "To TX");
-              sendLoraOtaUpdate(storedFirmware, storedFirmwareSize);
-            } else {
-              Serial.println("No firmware stored to send!");
-              oledMsg("No FW", "Stored");
-              radio.transmit("NO_FIRMWARE");
-            }
-            #else
-            radio.transmit("NO_FIRMWARE");
-            #endif
-          }
-        } else {
-          char l2[20]; snprintf(l2, sizeof(l2), "RSSI %.1f", rssi);
-          if (rx.startsWith("PING ")) {
-            // Extract seq part from message "PING seq=NNN"
-            const char* seqPtr = strstr(rx.c_str(), "seq=");
-            const char* seqStr = seqPtr ? seqPtr : rx.c_str();
-            oledMsg("PING", seqStr);
-          } else {
-            Serial.printf("[RX] %s | %s | SNR %.1f | PKT:%lu\n", rx.c_str(), l2, snr, packetCount);
-            oledMsg("RX", rx.c_str(), l2);
-          }
-        }
-      } else if (st != RADIOLIB_ERR_RX_TIMEOUT) {
-        errorCount++;
-        char e[24]; snprintf(e, sizeof(e), "err %d", st);
-        Serial.printf("[RX] FAIL %s | ERR:%lu\n", e, errorCount);
-        oledMsg("RX FAIL", e);
-      }
-      lastRxMs = now;
-    }
+  // TX completions, PINGs, received frames, config change, TDMA, OTA receive and ADR
+#ifdef ENABLE_WIFI_OTA
+  loraLink.setTransferActive(otaSender.isActive() || loraFecTx.isActive());
+#endif
+  loraLink.poll();
+#if LORA_CAPTURE
+  serviceCapture();
+#endif
+#ifdef ENABLE_WIFI_OTA
+  if (!isSender) {
+    serviceLoraOtaStream();
+    serviceLoraFecBroadcast();
+    serviceLoraDistribution();
   }
+#endif
 
   // Handle OTA updates (WiFi OTA only on receiver)
   #ifdef ENABLE_WIFI_OTA
@@ -818,8 +1331,59 @@ void loop() {
   }
   #endif
 
-  // Check LoRa OTA timeout (both roles)
-  checkLoraOtaTimeout();
+  // Heap fragmentation counters: with no allocation on the radio path the
+  // largest free block stays flat under sustained traffic
+  static uint32_t lastHeapMs = 0;
+  if (now - lastHeapMs >= 30000) {
+    const LoRaLink::HeapSnapshot heap = heapMonitor.sample();
+    const LoRaLink::HeapStats& hs = heapMonitor.getStats();
+    const LoRaLink::FramePool& framePool = loraLink.framePool();
+    const LoRaLink::FramePoolStats& ps = framePool.getStats();
+    Serial.printf("[MEM] free=%u min=%u largest=%u frag=%u%% drops=%lu | pool %u/%u hw=%u exhausted=%lu\n",
+                  (unsigned)heap.freeHeap, (unsigned)heap.minFreeHeap, (unsigned)heap.maxAllocHeap,
+                  (unsigned)heap.fragmentationPct, (unsigned long)hs.largestBlockDrops,
+                  (unsigned)framePool.inUse(), (unsigned)LoRaLink::FramePool::CAPACITY,
+                  (unsigned)ps.highWater, (unsigned long)ps.exhausted);
+    const LoRaLink::DedupStats& ds = loraLink.dedup().getStats();
+    Serial.printf("[RX] dedup hits=%lu misses=%lu expired=%lu\n", (unsigned long)ds.hits,
+                  (unsigned long)ds.misses, (unsigned long)ds.expired);
+    const LoRaLink::LbtStats& ls = loraLink.listenBeforeTalk().getStats();
+    Serial.printf("[LBT] scans=%lu busy=%lu forced=%lu backoff=%lums deferred=%lu\n",
+                  (unsigned long)ls.scans, (unsigned long)ls.busy, (unsigned long)ls.forced,
+                  (unsigned long)(ls.backoffUs / 1000), (unsigned long)loraLink.txScheduler().getStats().deferred);
+#if LORA_CAD_WAKE
+    const LoRaLink::CadWakeStats& cs = cadWake.getStats();
+    Serial.printf("[CAD] scans=%lu wakes=%lu idle=%lu frames=%lu timeouts=%lu\n",
+                  (unsigned long)cs.scans, (unsigned long)cs.wakes, (unsigned long)cs.idleWakes,
+                  (unsigned long)cs.frames, (unsigned long)cs.scanTimeouts);
+#endif
+#if LORA_TDMA
+    if (isSender) {
+      Serial.printf("[TDMA] slot %d | slots skipped with the radio busy=%lu\n", tdmaNode.slot(),
+                    (unsigned long)loraLink.getStats().slotsSkipped);
+    }
+#endif
+    lastHeapMs = now;
+  }
+
+  if (!isSender) {
+    serviceLinkReport(now);
+  }
+
+#if LORA_RX_DUTY_CYCLE
+  if (lightSleepReceiver()) {
+    return;
+  }
+#endif
+
+#if LORA_DEEP_SLEEP_MS
+  // Cold boot finished once the config broadcast and commit are done; timer wakes from here on
+  if (isSender && !loraLink.coordinator().isActive() && !loraLink.txScheduler().isBusy() &&
+      !loraLink.ota().isActive()) {
+    Serial.printf("[SLEEP] deep sleep, one PING every %lu ms\n", (unsigned long)LORA_DEEP_SLEEP_MS);
+    enterDeepSleep();
+  }
+#endif
 
   // Small delay to prevent overwhelming the system, but keep button responsive
   delay(10);
@@ -855,9 +1419,12 @@ static void initOTA() {
 
   ArduinoOTA.setHostname(OTA_HOSTNAME);
   ArduinoOTA.setPassword(OTA_PASSWORD);
+  // The new image goes out over LoRa first; loop() reboots once it has
+  ArduinoOTA.setRebootOnSuccess(false);
 
   ArduinoOTA.onStart([]() {
     otaActive = true;
+    wifiOtaImageSize = 0;
     Serial.println("OTA Update starting...");
     oledMsg("OTA", "Starting...");
   });
@@ -875,22 +1442,37 @@ static void initOTA() {
       if (storeCurrentFirmware()) {
         Serial.println("Firmware stored for LoRa OTA distribution");
         oledMsg("Firmware", "Stored");
-        delay(1000);
-
-        // Now trigger LoRa firmware updates
-        Serial.println("Triggering LoRa firmware updates...");
-        oledMsg("LoRa Update", "Triggering...");
-        triggerLoraFirmwareUpdates();
-      } else {
-        Serial.println("Failed to store firmware for LoRa OTA");
-        oledMsg("Firmware", "Store failed");
-        delay(1000);
+        distributionImage = &firmwareStore;
+        // Sent from loop(); returning here keeps WiFi and the radio serviced
+        distribution = Distribution::NOTIFY;
+        return;
+      }
+      if (wifiOtaImageSize > 0) {
+        // Gone after the reboot, but this round can still send it from the
+        // partition ArduinoOTA wrote
+        Serial.println("Firmware not stored; distributing from the OTA partition");
+        oledMsg("Firmware", "Not stored");
+        receivedFirmware = LoRaLink::EspPartitionImage(esp_ota_get_boot_partition(), wifiOtaImageSize);
+        distributionImage = &receivedFirmware;
+        distribution = Distribution::NOTIFY;
+        return;
       }
+      Serial.println("Failed to store firmware for LoRa OTA");
+      oledMsg("Firmware", "Store failed");
+      delay(1000);
     }
     #endif
+    ESP.restart(); // Nothing to distribute: boot the new image now
   });
 
   ArduinoOTA.onProgress([](unsigned int progress, unsigned int total) {
+    // First callback: say now, not after the upload, that the store can't keep it
+    if (wifiOtaImageSize == 0 && !isSender && total > firmwareStore.capacity()) {
+      Serial.printf("OTA image is %u bytes, firmware store holds %lu: it will not be kept for later LoRa updates\n",
+                    total, (unsigned long)firmwareStore.capacity());
+      oledMsg("OTA: too big", "for fwstore");
+    }
+    wifiOtaImageSize = total;
     int percent = (progress * 100) / total;
     char progressStr[20];
     snprintf(progressStr, sizeof(progressStr), "%d%%", percent);
@@ -910,240 +1492,325 @@ static void initOTA() {
 }
 #endif
 
-// LoRa OTA Functions (both sender and receiver)
-static void handleLoraOtaPacket(const String& packet) {
-  if (packet.startsWith("OTA_START:")) {
-    // Format: OTA_START:size:chunks
-    int parsed = sscanf(packet.c_str(), "OTA_START:%u:%u", &loraOtaExpectedSize, &loraOtaTimeout);
-    if (parsed == 2) {
-      loraOtaActive = true;
-      loraOtaStartTime = millis();
-      loraOtaReceivedSize = 0;
-      loraOtaBufferSize = 0;
-
-      Serial.printf("LoRa OTA starting: %lu bytes\n", loraOtaExpectedSize);
-      oledMsg("LoRa OTA", "Starting...");
-    }
-  } else if (packet.startsWith("OTA_DATA:")) {
-    if (!loraOtaActive) return;
-
-    // Format: OTA_DATA:chunk:data
-    int chunk;
-    char data[256];
-    int parsed = sscanf(packet.c_str(), "OTA_DATA:%d:%255s", &chunk, data);
-    if (parsed == 2) {
-      // Decode base64 data and add to buffer
-      // For simplicity, we'll use a basic approach
-      size_t dataLen = strlen(data);
-      if (loraOtaBufferSize + dataLen < sizeof(loraOtaBuffer)) {
-        memcpy(loraOtaBuffer + loraOtaBufferSize, data, dataLen);
-        loraOtaBufferSize += dataLen;
-        loraOtaReceivedSize += dataLen;
-
-        int percent = (loraOtaReceivedSize * 100) / loraOtaExpectedSize;
-        char progressStr[20];
-        snprintf(progressStr, sizeof(progressStr), "%d%%", percent);
-        oledMsg("LoRa OTA", progressStr);
-      }
-    }
-  } else if (packet.startsWith("OTA_END:")) {
-    if (!loraOtaActive) return;
-
-    // Verify we have all data
-    if (loraOtaReceivedSize >= loraOtaExpectedSize) {
-      Serial.println("LoRa OTA complete, flashing...");
-      oledMsg("LoRa OTA", "Flashing...");
-
-      // Flash the firmware
-      if (Update.begin(loraOtaExpectedSize)) {
-        (void)Update.write(loraOtaBuffer, loraOtaBufferSize); // Suppress unused variable warning
-        if (Update.end()) {
-          Serial.println("Firmware flashed successfully!");
-          oledMsg("OTA Complete", "Rebooting...");
-          delay(2000);
-          ESP.restart();
-        } else {
-          Serial.println("Firmware flash failed!");
-          oledMsg("OTA Error", "Flash failed!");
-        }
-      } else {
-        Serial.println("OTA begin failed!");
-        oledMsg("OTA Error", "Begin failed!");
-      }
-    }
-
-    loraOtaActive = false;
-  }
+// Function to send OTA update to transmitters (receiver only)
+#ifdef ENABLE_WIFI_OTA
+static void reportLoraOtaSend() {
+  const LoRaLink::OtaSenderStats& st = otaSender.getStats();
+  Serial.printf("LoRa OTA %s: %lu/%lu chunks acked, %lu sent (%lu retransmits), %lu polls, %lu NACKs, "
+                "loss %u%%, gap %lums, airtime %.1fs\n",
+                LoRaLink::OtaSender::stateToString(otaSender.getState()),
+                (unsigned long)otaSender.chunksAcked(), (unsigned long)otaSender.chunkCount(),
+                (unsigned long)st.chunksSent, (unsigned long)st.retransmits, (unsigned long)st.polls,
+                (unsigned long)st.nacks, (unsigned)otaSender.lossPct(), (unsigned long)otaSender.gapMs(),
+                st.airtimeUs / 1e6);
+  oledMsg("LoRa OTA", otaSender.getState() == LoRaLink::OtaSenderState::DONE ? "Delivered!" : "Failed!");
 }
 
-static void checkLoraOtaTimeout() {
-  if (loraOtaActive && (millis() - loraOtaStartTime > loraOtaTimeout)) {
-    Serial.println("LoRa OTA timeout!");
-    oledMsg("LoRa OTA", "Timeout!");
-    loraOtaActive = false;
+// OTA_START fields for an image read from flash: hash and transfer flags
+static bool describeFirmware(LoRaLink::IImageSource& firmware, uint32_t timeoutMs) {
+  uint8_t head[64];
+  const size_t headLen = min(sizeof(head), firmware.size());
+  if (!LoRaLink::hashImage(firmware, otaStream.info.sha256) || !firmware.read(0, head, headLen)) {
+    Serial.println("LoRa OTA image unreadable");
+    oledMsg("LoRa OTA", "Read failed");
+    return false;
   }
+  otaStream.info.imageSize = static_cast<uint32_t>(firmware.size());
+  otaStream.info.timeoutMs = timeoutMs;
+  otaStream.info.chunkSize = OTA_CHUNK_SIZE;
+  otaStream.info.flags = LoRaLink::transferFlags(head, headLen);
+  otaStream.firmware = &firmware;
+  otaStream.size = firmware.size();
+  otaStream.peer = LoRaLink::BROADCAST_NODE;
+  otaStream.lastPercent = -1;
+  return true;
 }
 
-// Function to send OTA update to transmitters (receiver only)
-#ifdef ENABLE_WIFI_OTA
-static void sendLoraOtaUpdate(const uint8_t* firmware, size_t firmwareSize) {
+static void sendLoraOtaUpdate(LoRaLink::IImageSource& firmware) {
   if (isSender) return; // Only receivers can send OTA updates
+  const size_t firmwareSize = firmware.size();
+  if (otaSender.isActive() || loraFecTx.isActive()) {
+    Serial.println("LoRa OTA already in progress");
+    return;
+  }
+  if (!describeFirmware(firmware, loraOtaTimeout)) return;
+  if (!otaSender.begin(static_cast<uint32_t>(firmwareSize), OTA_CHUNK_SIZE, millis())) {
+    Serial.printf("LoRa OTA image too large: %zu bytes\n", firmwareSize);
+    oledMsg("LoRa OTA", "Too large");
+    return;
+  }
 
   Serial.printf("Sending LoRa OTA update: %zu bytes\n", firmwareSize);
   oledMsg("LoRa OTA", "Sending...");
+}
 
-  // Send OTA start packet
-  char startMsg[64];
-  snprintf(startMsg, sizeof(startMsg), "OTA_START:%zu:%lu", firmwareSize, loraOtaTimeout);
-  radio.transmit(startMsg);
-  delay(100);
+// Queue the frame the ARQ asks for; one at a time so pacing and reply
+// timeouts are measured from the real end of transmission. Called every loop
+static void serviceLoraOtaStream() {
+  if (!otaSender.isActive() || loraLink.txScheduler().isBusy()) return;
+
+  uint16_t index = 0;
+  LoRaLink::OtaSendAction action = otaSender.next(millis(), index);
+  uint8_t payload[LoRaLink::MAX_PAYLOAD_SIZE];
+  size_t len = 0;
+  LoRaLink::FrameType type;
+  switch (action) {
+    case LoRaLink::OtaSendAction::START:
+      type = LoRaLink::FrameType::OTA_START;
+      len = LoRaLink::encodeOtaStart(otaStream.info, payload, sizeof(payload));
+      break;
+    case LoRaLink::OtaSendAction::CHUNK: {
+      // Chunk packet: u16 chunk index followed by raw bytes
+      const size_t offset = static_cast<size_t>(index) * OTA_CHUNK_SIZE;
+      const size_t chunkLen = min(OTA_CHUNK_SIZE, otaStream.size - offset);
+      type = LoRaLink::FrameType::OTA_DATA;
+      LoRaLink::Wire::putU16(payload, index);
+      if (!otaStream.firmware->read(offset, payload + LoRaLink::OTA_CHUNK_HEADER_SIZE, chunkLen)) {
+        otaSender.onSent(millis()); // Flash read failed: lost like any frame, resent later
+        return;
+      }
+      len = LoRaLink::OTA_CHUNK_HEADER_SIZE + chunkLen;
+      break;
+    }
+    case LoRaLink::OtaSendAction::POLL:
+      type = LoRaLink::FrameType::OTA_END;
+      break;
+    default:
+      if (otaSender.getState() == LoRaLink::OtaSenderState::FAILED) {
+        reportLoraOtaSend(); // Peer stopped answering
+      }
+      return;
+  }
+
+  otaStream.pendingAirUs = loraLink.airtime().airtimeUs(LoRaLink::FRAME_OVERHEAD + len);
+  if (!loraLink.queueFrame(type, loraLink.nextSequence(), LoRaLink::TX_LOW, payload, len)) {
+    otaSender.onSent(millis()); // Counted as lost; the next NACK recovers it
+  }
+}
 
-  // Break firmware into chunks and send
-  const size_t chunkSize = 200; // Max LoRa packet size
-  size_t sentBytes = 0;
-  int chunkNum = 0;
+// Peer progress report; drives the ARQ
+static void onOtaNack(const LoRaLink::FrameView& frame, const LoRaLink::RxFrame&, void*) {
+  if (!otaSender.isActive()) return;
+  // One transfer at a time: the first node to answer is the peer
+  if (otaStream.peer == LoRaLink::BROADCAST_NODE) {
+    otaStream.peer = frame.header.nodeId;
+  } else if (frame.header.nodeId != otaStream.peer) {
+    return;
+  }
+  if (!otaSender.onNack(frame.payload, frame.payloadSize, millis())) {
+    Serial.printf("LoRa OTA NACK malformed (%u bytes)\n", (unsigned)frame.payloadSize);
+    return;
+  }
 
-  while (sentBytes < firmwareSize) {
-    size_t currentChunkSize = min(chunkSize, firmwareSize - sentBytes);
+  if (!otaSender.isActive()) {
+    reportLoraOtaSend();
+    return;
+  }
+  const int percent = otaSender.percent();
+  if (percent != otaStream.lastPercent) {
+    otaStream.lastPercent = percent;
+    char progressStr[20];
+    snprintf(progressStr, sizeof(progressStr), "Sent %d%%", percent);
+    oledMsg("LoRa OTA", progressStr);
+  }
+}
 
-    // Create chunk packet
-    char chunkMsg[256];
-    snprintf(chunkMsg, sizeof(chunkMsg), "OTA_DATA:%d:", chunkNum);
+static void reportLoraFecBroadcast() {
+  const LoRaLink::FecBroadcastStats& st = loraFecTx.getStats();
+  Serial.printf("LoRa OTA broadcast done: %lu blocks, %lu source + %lu repair packets, %lu polls, "
+                "%lu NEEDs, %lu revisits, %lu given up, redundancy %u%%, airtime %.1fs\n",
+                (unsigned long)loraFecTx.layout().blockCount, (unsigned long)st.sourcePackets,
+                (unsigned long)st.repairPackets, (unsigned long)st.polls, (unsigned long)st.needs,
+                (unsigned long)st.blocksRevisited, (unsigned long)st.blocksGivenUp,
+                (unsigned)loraFecTx.redundancyPct(), st.airtimeUs / 1e6);
+  oledMsg("LoRa OTA", "Broadcast done");
+}
 
-    // Copy chunk data (simplified - in practice you'd want base64 encoding)
-    memcpy(chunkMsg + strlen(chunkMsg), firmware + sentBytes, currentChunkSize);
-    chunkMsg[strlen(chunkMsg) + currentChunkSize] = '\0';
+// Erasure-coded transfer to every listener at once
+static void sendLoraFecBroadcast(LoRaLink::IImageSource& firmware) {
+  if (isSender) return;
+  const size_t firmwareSize = firmware.size();
+  if (otaSender.isActive() || loraFecTx.isActive()) {
+    Serial.println("LoRa OTA already in progress");
+    return;
+  }
+  if (!describeFirmware(firmware, OTA_BROADCAST_TIMEOUT_MS)) return;
+  if (!loraFecTx.begin(static_cast<uint32_t>(firmwareSize), OTA_CHUNK_SIZE, millis())) {
+    Serial.printf("LoRa OTA image too large: %zu bytes\n", firmwareSize);
+    oledMsg("LoRa OTA", "Too large");
+    return;
+  }
 
-    // Send chunk
-    radio.transmit(chunkMsg);
-    delay(50);
+  Serial.printf("Broadcasting LoRa OTA update: %zu bytes in %u blocks\n",
+                firmwareSize, (unsigned)loraFecTx.layout().blockCount);
+  oledMsg("LoRa OTA", "Broadcasting...");
+}
 
-    sentBytes += currentChunkSize;
-    chunkNum++;
+// Same one-frame-at-a-time pacing as serviceLoraOtaStream(); poll slots are
+// timed from the end of the poll's transmission
+static void serviceLoraFecBroadcast() {
+  if (!loraFecTx.isActive() || loraLink.txScheduler().isBusy()) return;
+
+  uint16_t block = 0;
+  uint32_t mask = 0;
+  LoRaLink::FecAction action = loraFecTx.next(millis(), block, mask);
+  uint8_t payload[LoRaLink::MAX_PAYLOAD_SIZE];
+  size_t len = 0;
+  LoRaLink::FrameType type;
+  switch (action) {
+    case LoRaLink::FecAction::START:
+      type = LoRaLink::FrameType::OTA_CODED_START;
+      len = LoRaLink::encodeOtaStart(otaStream.info, payload, sizeof(payload));
+      break;
+    case LoRaLink::FecAction::CODED:
+      type = LoRaLink::FrameType::OTA_CODED;
+      len = LoRaLink::encodeCodedPacket(loraFecTx.layout(), *otaStream.firmware, block, mask, payload, sizeof(payload));
+      if (len == 0) {
+        loraFecTx.onSent(millis()); // Flash read failed: a lost packet to the listeners
+        return;
+      }
+      break;
+    case LoRaLink::FecAction::POLL:
+      type = LoRaLink::FrameType::OTA_BLOCK_POLL;
+      LoRaLink::Wire::putU16(payload, block);
+      len = LoRaLink::OTA_BLOCK_POLL_SIZE;
+      break;
+    default:
+      if (loraFecTx.getState() == LoRaLink::FecBroadcastState::DONE) {
+        reportLoraFecBroadcast();
+      }
+      return;
+  }
 
-    // Update progress
-    int percent = (sentBytes * 100) / firmwareSize;
+  const int percent = loraFecTx.percent();
+  if (percent != otaStream.lastPercent) {
+    otaStream.lastPercent = percent;
     char progressStr[20];
-    snprintf(progressStr, sizeof(progressStr), "Sending %d%%", percent);
+    snprintf(progressStr, sizeof(progressStr), "Sent %d%%", percent);
     oledMsg("LoRa OTA", progressStr);
   }
 
-  // Send OTA end packet
-  radio.transmit("OTA_END:");
-  delay(100);
+  otaStream.pendingAirUs = loraLink.airtime().airtimeUs(LoRaLink::FRAME_OVERHEAD + len);
+  if (!loraLink.queueFrame(type, loraLink.nextSequence(), LoRaLink::TX_LOW, payload, len)) {
+    loraFecTx.onSent(millis()); // Lost like any other broadcast frame; polls recover it
+  }
+}
 
-  Serial.println("LoRa OTA update sent!");
-  oledMsg("LoRa OTA", "Sent!");
+// A listener is still short of a block; the broadcaster keeps the largest deficit
+static void onOtaBlockNeed(const LoRaLink::FrameView& frame, const LoRaLink::RxFrame&, void*) {
+  if (!loraFecTx.isActive()) return;
+  if (!loraFecTx.onNeed(frame.payload, frame.payloadSize)) {
+    Serial.printf("LoRa OTA NEED malformed (%u bytes)\n", (unsigned)frame.payloadSize);
+  }
 }
 
 // NEW: Function to automatically trigger LoRa firmware updates after WiFi OTA
 static void triggerLoraFirmwareUpdates() {
   if (isSender) return; // Only receivers can trigger updates
+  ReceiverPause pause;
 
   Serial.println("Broadcasting firmware update notification...");
   oledMsg("LoRa Update", "Broadcasting...");
 
   // Proactively resync receivers to our current settings over control channel
   // to maximize the chance they can hear the update notifications
-  broadcastConfigOnControlChannel(8, 250);
-
-  // Send multiple notifications to ensure transmitters receive them
+  broadcastConfigOnControlChannel(8);
+
+  // Send multiple notifications to ensure transmitters receive them;
+  // repeats share a sequence number so receivers can recognise them
+  const uint16_t noticeSeq = loraLink.nextSequence();
+  // FW_VERSION only when the stored image says which version it is
+  const uint32_t storedVersion = firmwareStore.hasImage() ? firmwareStore.info().version : 0;
+  uint8_t versionPayload[4];
+  LoRaLink::Wire::putU32(versionPayload, storedVersion);
+  const uint32_t noticeGapMs = repeatGapMs(LoRaLink::FRAME_OVERHEAD + sizeof(versionPayload));
   for (int i = 0; i < 10; i++) {
     // Send firmware update available notification
-    radio.transmit("FW_UPDATE_AVAILABLE");
-    delay(200);
+    transmitFrame(LoRaLink::FrameType::FW_UPDATE_AVAILABLE, noticeSeq);
+    delay(noticeGapMs);
 
-          // Send version info from stored firmware
-      char versionMsg[64];
-      if (hasStoredFirmware) {
-        snprintf(versionMsg, sizeof(versionMsg), "FW_VERSION:%lu", firmwareVersion);
-      } else {
-        snprintf(versionMsg, sizeof(versionMsg), "FW_VERSION:0.0.0");
-      }
-      radio.transmit(versionMsg);
-      delay(200);
+    // Send version info from stored firmware
+    if (storedVersion != 0) {
+      transmitFrame(LoRaLink::FrameType::FW_VERSION, noticeSeq, versionPayload, sizeof(versionPayload));
+      delay(noticeGapMs);
+    }
 
     // Send update trigger command
-    radio.transmit("UPDATE_NOW");
-    delay(200);
+    transmitFrame(LoRaLink::FrameType::UPDATE_NOW, noticeSeq);
+    delay(noticeGapMs);
   }
 
   Serial.println("Firmware update notifications sent!");
   oledMsg("LoRa Update", "Notifications sent!");
+}
 
-  // Wait a bit for transmitters to process
-  delay(2000);
-
-  // Check if any transmitters requested updates
-  Serial.println("Checking for update requests...");
-  oledMsg("LoRa Update", "Checking...");
-
-  // Listen for update requests for longer to catch remote nodes
-  uint32_t startTime = millis();
-  while (millis() - startTime < 15000) { // Listen for 15 seconds
-    String rx;
-    int r = radio.receive(rx);
-    if (r == RADIOLIB_ERR_NONE) {
-      if (rx.startsWith("REQUEST_UPDATE")) {
-        Serial.println("Transmitter requested update!");
-        oledMsg("LoRa Update", "Request received!");
-
-        // Here you could implement logic to send the actual firmware
-        // For now, we'll just acknowledge the request
-        radio.transmit("UPDATE_ACK");
-        delay(100);
-
-        // You could call sendLoraOtaUpdate() here with the firmware data
-        // sendLoraOtaUpdate(firmwareData, firmwareSize);
+// Runs the distribution armed by ArduinoOTA.onEnd. Transmitters repeat
+// REQUEST_UPDATE until answered, so the ones sent during the blocking
+// notices are heard again in the window; the link layer acks them and
+// LinkEvents::onUpdateRequest() lists the nodes. Called every loop
+static void serviceLoraDistribution() {
+  switch (distribution) {
+    case Distribution::IDLE:
+      return;
+    case Distribution::NOTIFY:
+      Serial.println("Triggering LoRa firmware updates...");
+      oledMsg("LoRa Update", "Triggering...");
+      requesterCount = 0;
+      moreRequesters = false;
+      triggerLoraFirmwareUpdates();
+      Serial.println("Checking for update requests...");
+      oledMsg("LoRa Update", "Checking...");
+      collectStartMs = millis();
+      distribution = Distribution::COLLECT;
+      return;
+    case Distribution::COLLECT:
+      if (millis() - collectStartMs < UPDATE_REQUEST_WINDOW_MS) return;
+      // One requester gets the selective-repeat transfer; several share one
+      // coded broadcast whose airtime follows the worst link, not the node count
+      if (requesterCount > 0) {
+        Serial.printf("%u%s nodes requested the update\n", (unsigned)requesterCount, moreRequesters ? "+" : "");
+        if (requesterCount == 1 && !moreRequesters) {
+          sendLoraOtaUpdate(*distributionImage);
+        } else {
+          sendLoraFecBroadcast(*distributionImage);
+        }
       }
-    }
-    delay(100);
+      distribution = Distribution::SEND;
+      return;
+    case Distribution::SEND:
+      // Done, failed, or never started
+      if (otaSender.isActive() || loraFecTx.isActive()) return;
+      break;
   }
 
-  Serial.println("LoRa firmware update trigger complete!");
-  oledMsg("LoRa Update", "Complete!");
+  Serial.println("LoRa firmware update trigger complete! Rebooting...");
+  oledMsg("LoRa Update", "Rebooting...");
+  waitForTxIdle();
+  delay(1000);
+  ESP.restart();
 }
 
-// NEW: Function to store the current firmware for LoRa OTA distribution
+// Copy the image ArduinoOTA just wrote (now the boot partition) into the
+// firmware store, which survives the reboot into it
 static bool storeCurrentFirmware() {
   if (isSender) return false; // Only receivers can store firmware
 
-  // For now, we'll create a simple firmware representation
-  // In a real implementation, you'd read the actual firmware from flash
-  // or store it during the WiFi OTA process
-
-  // Create a simple firmware header
-  const char* firmwareHeader = "LtngDet_FW_v1.0.0";
-  size_t headerLen = strlen(firmwareHeader);
-
-  // Copy header to firmware buffer
-  memcpy(storedFirmware, firmwareHeader, headerLen);
-
-  // Add some dummy firmware data (in practice, this would be the actual firmware)
-  // For demonstration, we'll create a simple firmware representation
-  uint8_t dummyFirmware[] = {
-    0xAA, 0x55, 0xAA, 0x55, // Magic bytes
-    0x01, 0x00, 0x00,       // Version 1.0.0
-    0x00, 0x00, 0x00, 0x00, // Checksum placeholder
-    0x00, 0x00, 0x00, 0x00  // Size placeholder
-  };
-
-  size_t dummyLen = sizeof(dummyFirmware);
-  memcpy(storedFirmware + headerLen, dummyFirmware, dummyLen);
-
-  // Set the total firmware size
-  storedFirmwareSize = headerLen + dummyLen;
-  hasStoredFirmware = true;
-
-  Serial.printf("Firmware stored: %zu bytes (header: %zu, data: %zu)\n",
-                storedFirmwareSize, headerLen, dummyLen);
-
-  // TODO: In a real implementation, you would:
-  // 1. Read the actual firmware from flash memory
-  // 2. Calculate proper checksums
-  // 3. Store the complete firmware binary
-  // 4. Handle firmware versioning properly
+  LoRaLink::EspPartitionImage received(esp_ota_get_boot_partition(), wifiOtaImageSize);
+  if (received.size() == 0) {
+    Serial.println("No received image to store");
+    return false;
+  }
+  // Tagged with the version the new image was built as, not this build's
+  const uint32_t version = LoRaLink::appImageVersion(received);
+  LoRaLink::StoreResult r = firmwareStore.capture(received, version);
+  if (r != LoRaLink::StoreResult::OK) {
+    Serial.printf("Firmware store failed: %s\n", LoRaLink::FirmwareStore::resultToString(r));
+    return false;
+  }
 
+  Serial.printf("Firmware stored: %lu bytes, version %lu.%lu.%lu, %lu sectors erased\n",
+                (unsigned long)firmwareStore.size(), (unsigned long)(version >> 16), (unsigned long)((version >> 8) & 0xFF),
+                (unsigned long)(version & 0xFF), (unsigned long)firmwareStore.getStats().sectorsErased);
   return true;
 }
 #endif
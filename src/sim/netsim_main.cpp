@@ -0,0 +1,108 @@
+// Host CLI for the network simulator (src/lora/net_sim.h), built by the netsim env
+//
+//   pio run -e netsim -t exec
+//   .pio/build/netsim/program nodes=100 minutes=60 interval=10000 lbt=0 seed=3
+//
+// One gateway at the origin and `nodes` senders spread over `radius` metres.
+// interval=0 leaves PING pacing to the link layer, in slots with tdma=1.
+#include "../lora/net_sim.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+struct Options {
+    LoRaLink::NetSimConfig config;
+    unsigned nodes;
+    float radiusM;
+    unsigned intervalMs;
+    bool poisson;
+    unsigned minutes;
+};
+
+static bool parseOption(const char* arg, Options& options) {
+    const char* eq = strchr(arg, '=');
+    if (eq == nullptr) {
+        return false;
+    }
+    const size_t keyLen = static_cast<size_t>(eq - arg);
+    const char* value = eq + 1;
+    const double v = atof(value);
+    auto is = [&](const char* key) { return strlen(key) == keyLen && strncmp(arg, key, keyLen) == 0; };
+
+    LoRaLink::NetSimConfig& c = options.config;
+    if (is("nodes")) options.nodes = static_cast<unsigned>(v);
+    else if (is("radius")) options.radiusM = static_cast<float>(v);
+    else if (is("interval")) options.intervalMs = static_cast<unsigned>(v);
+    else if (is("poisson")) options.poisson = v != 0;
+    else if (is("minutes")) options.minutes = static_cast<unsigned>(v);
+    else if (is("seed")) c.seed = static_cast<uint32_t>(v);
+    else if (is("sf")) c.profile.sf = static_cast<uint8_t>(v);
+    else if (is("bw")) c.profile.bwKHz = static_cast<float>(v);
+    else if (is("cr")) c.profile.cr = static_cast<uint8_t>(v);
+    else if (is("power")) c.profile.txPower = static_cast<int8_t>(v);
+    else if (is("preamble")) c.preamble = static_cast<uint16_t>(v);
+    else if (is("lbt")) c.lbt = v != 0;
+    else if (is("tdma")) c.tdma = v != 0;
+    else if (is("dutycycle")) c.dutyCyclePermille = static_cast<uint16_t>(v);
+    else if (is("shadowing")) c.shadowingDb = static_cast<float>(v);
+    else if (is("capture")) c.captureDb = static_cast<float>(v);
+    else if (is("exponent")) c.pathLossExponent = static_cast<float>(v);
+    else return false;
+    return true;
+}
+
+int main(int argc, char** argv) {
+    Options options = { LoRaLink::NetSimConfig::defaultConfig(), 50, 300.0f, 10000, true, 10 };
+    for (int i = 1; i < argc; i++) {
+        if (!parseOption(argv[i], options)) {
+            fprintf(stderr, "Unknown option %s\n", argv[i]);
+            fprintf(stderr, "Usage: %s [nodes=50] [radius=300] [interval=10000] [poisson=1] [minutes=10] [seed=1]\n"
+                            "       [sf=9] [bw=125] [cr=5] [power=17] [preamble=8] [lbt=1] [tdma=0] [dutycycle=1000]\n"
+                            "       [shadowing=0] [capture=6] [exponent=2.08]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    LoRaLink::NetSim sim(options.config);
+    const LoRaLink::SimNodeConfig gateway = { LoRaLink::SimRole::RECEIVER, 0.0f, 0.0f, 0, false, 0 };
+    sim.addNode(gateway);
+    sim.addSenders(options.nodes, options.radiusM, options.intervalMs, options.poisson);
+    const LoRaLink::NetSimReport r = sim.run(options.minutes * 60000u);
+
+    const LoRaLink::NetSimConfig& c = options.config;
+    char pacing[48];
+    if (options.intervalMs > 0) {
+        snprintf(pacing, sizeof(pacing), "PING every %u ms%s", options.intervalMs, options.poisson ? " (Poisson)" : "");
+    } else {
+        snprintf(pacing, sizeof(pacing), "PINGs paced by the link layer");
+    }
+    printf("%u senders within %.0f m, %s, SF%u/%.0f kHz, %d dBm, LBT %s, TDMA %s, seed %u, %u min\n",
+           options.nodes, options.radiusM, pacing, c.profile.sf, c.profile.bwKHz, c.profile.txPower,
+           c.lbt ? "on" : "off", c.tdma ? "on" : "off", c.seed, options.minutes);
+    printf("sensitivity %.1f dBm\n", sim.sensitivityDbm());
+    printf("offered   %u PINGs, G = %.2f\n", r.offered, r.channelLoad());
+    printf("sent      %u (queue drops %u, LBT deferrals %u, forced %u)\n", r.sent, r.queueDrops, r.lbtDeferred,
+           r.lbtForced);
+    printf("delivered %u (%.1f%%), %.0f bit/s\n", r.delivered, r.deliveryRatio() * 100.0f, r.throughputBps());
+    printf("lost      collided %u, receiver busy %u, weak %u, not listening %u, aborted %u\n", r.collided, r.busy,
+           r.weak, r.notListening, r.aborted);
+    if (c.tdma) {
+        printf("tdma      superframe %.1f s, all slotted after %.1f s, out of slot %u, overhead %.1f%%\n",
+               r.superframeUs / 1e6, r.syncedUs / 1e6, r.outOfSlot, 100.0 * r.overheadAirtimeUs / r.durationUs);
+    }
+    printf("latency   avg %.1f ms, p50 %.1f ms, p95 %.1f ms, max %.1f ms\n", r.latencyAvgUs / 1000.0,
+           r.latencyP50Us / 1000.0, r.latencyP95Us / 1000.0, r.latencyMaxUs / 1000.0);
+
+    // The gateway's link table, as the firmware reports it
+    const LoRaLink::LinkTable& links = sim.linkTable(0);
+    float worstLoss = 0.0f;
+    for (size_t i = 0; i < links.capacity(); i++) {
+        const LoRaLink::LinkEntry* entry = links.slot(i);
+        if (entry != nullptr && entry->used && entry->loss() > worstLoss) {
+            worstLoss = entry->loss();
+        }
+    }
+    printf("links     %u of %u senders heard, worst loss %.0f%%\n", (unsigned)links.size(), options.nodes,
+           worstLoss * 100.0f);
+    return 0;
+}
@@ -0,0 +1,191 @@
+// Shared fixtures for the LoRa test suites
+//
+// Each suite is built on its own (run_tests.sh, pio test), so everything
+// here is header-only: a seeded random source, test images with their
+// OTA_START, and the LinkLayer harness of MockRadio nodes on a shared clock.
+#pragma once
+
+#include <unity.h>
+#include "../src/lora/airtime.h"
+#include "../src/lora/link_layer.h"
+#include "../src/lora/mock_radio.h"
+#include "../src/lora/mock_update_backend.h"
+#include "../src/lora/ota_receiver.h"
+#include "../src/lora/xorshift.h"
+#include <cmath>
+#include <functional>
+#include <vector>
+
+namespace LoRaTest {
+
+    using namespace LoRaLink;
+
+    // --- Random source -------------------------------------------------------
+
+    // Seeds 0, 1, 2... give unrelated streams
+    class TestRng {
+    public:
+        explicit TestRng(uint32_t seed) : rng_(seed * 2654435761u + 1) {}
+
+        uint32_t next() { return rng_.next(); }
+        // [0, 1)
+        double uniform() { return (next() & 0xFFFFFF) / 16777216.0; }
+        // Standard normal (Box-Muller)
+        double gaussian() {
+            const double u1 = ((next() & 0xFFFFFF) + 0.5) / 16777216.0;
+            return std::sqrt(-2.0 * std::log(u1)) * std::cos(6.283185307 * uniform());
+        }
+        // True with probability permille / 1000
+        bool chance(uint32_t permille) { return next() % 1000 < permille; }
+
+    private:
+        Xorshift32 rng_;
+    };
+
+    // --- Images --------------------------------------------------------------
+
+    static const uint16_t CHUNK = 200;
+
+    // Incompressible bytes, reproducible from the seed
+    inline std::vector<uint8_t> makeImage(size_t size, uint32_t seed) {
+        std::vector<uint8_t> image(size);
+        for (size_t i = 0; i < size; ++i) {
+            seed = seed * 1103515245u + 12345u;
+            image[i] = static_cast<uint8_t>(seed >> 16);
+        }
+        return image;
+    }
+
+    // OTA_START for sending the image in CHUNK-sized pieces
+    inline OtaStartInfo startFor(const std::vector<uint8_t>& image, uint8_t flags = 0) {
+        OtaStartInfo info;
+        info.imageSize = static_cast<uint32_t>(image.size());
+        info.timeoutMs = 30000;
+        info.chunkSize = CHUNK;
+        info.flags = flags;
+        Sha256::hash(image.data(), image.size(), info.sha256);
+        return info;
+    }
+
+    // Time on air on the default link: SF9, BW125, CR4/5, 8-symbol preamble
+    inline uint32_t airtimeUs(size_t frameLength) {
+        return timeOnAirUs(modulationFor(9, 125.0f, 5, DEFAULT_PREAMBLE), frameLength);
+    }
+
+    // --- LinkLayer harness ---------------------------------------------------
+
+    static const ConfigPayload SF9_125 = { 915.0f, 125.0f, 9, 5, 17 };
+    static const ConfigPayload SF7_250 = { 915.0f, 250.0f, 7, 5, 14 };
+    static const uint16_t SENDER_ID = 0x0101;
+    static const uint16_t RECEIVER_ID = 0x0001;
+
+    // Every node shares one clock
+    static uint32_t g_nowUs = 0;
+    inline uint32_t clockUs() { return g_nowUs; }
+    inline uint32_t clockMs() { return g_nowUs / 1000; }
+
+    // One node: radio, update partition and link layer, as main.cpp wires
+    // them, on SF9_125 and listening. Listen-before-talk is off so frames go
+    // out when the test expects them.
+    struct TestNode {
+        MockRadio radio;
+        MockUpdateBackend flash;
+        std::vector<uint8_t> running;
+        MemoryImage base;
+        StagedUpdateBackend update;
+        LinkLayer link;
+
+        TestNode(uint16_t nodeId, bool sender, LinkLayerConfig config = LinkLayerConfig::defaultConfig())
+            : flash(64 * 1024)
+            , running(1024, 0x5A)
+            , base(running.data(), running.size())
+            , update(flash, base)
+            , link(radio, radio, update, withIdentity(config, nodeId, sender), clockUs, clockMs)
+        {
+            radio.reinit(SF9_125);
+            radio.setDio1Handler([this](uint32_t timestampUs) { link.onDio1(timestampUs); });
+            link.seed(nodeId);
+            link.begin(SF9_125);
+            link.listen();
+        }
+
+        static LinkLayerConfig withIdentity(LinkLayerConfig config, uint16_t nodeId, bool sender) {
+            config.nodeId = nodeId;
+            config.sender = sender;
+            config.listenBeforeTalk = false;
+            return config;
+        }
+
+        // Frame from another node, received now
+        bool hear(FrameType type, uint16_t nodeId, uint16_t sequence, const uint8_t* payload = nullptr,
+                  size_t payloadSize = 0, float rssi = -80.0f) {
+            uint8_t frame[MAX_FRAME_SIZE];
+            const size_t len = encodeFrame(type, nodeId, sequence, payload, payloadSize, frame, sizeof(frame));
+            const bool heard = radio.deliver(frame, len, g_nowUs, rssi, 8.0f);
+            link.poll();
+            return heard;
+        }
+
+        // Finish whatever is on air and hand the link the TxDone
+        FrameType finishTransmit() {
+            FrameView frame;
+            TEST_ASSERT_EQUAL(RadioMode::TRANSMIT, radio.getMode());
+            TEST_ASSERT_EQUAL(DecodeResult::OK, decodeFrame(radio.lastTransmit(), radio.lastTransmitLength(), frame));
+            radio.completeTransmit(g_nowUs);
+            link.poll();
+            return frame.header.type;
+        }
+    };
+
+    // Two nodes on one channel in 1 ms steps. A frame reaches the other node
+    // when both radios are on the same SF and bandwidth, that node is not
+    // deaf (busy elsewhere, as a receiver sending blind notices is), and
+    // lose() does not pick it.
+    struct Air {
+        TestNode* nodes[2];
+        bool onAir[2] = { false, false };
+        uint32_t endUs[2] = { 0, 0 };
+        uint32_t frames[2] = { 0, 0 };
+        uint32_t deafUntilUs[2] = { 0, 0 };
+        uint32_t longestUs = 0;
+        std::function<bool(int from, uint32_t frame)> lose;
+
+        Air(TestNode& a, TestNode& b) : nodes{ &a, &b } {
+            for (int i = 0; i < 2; i++) {
+                nodes[i]->radio.setTransmitHandler([this, i](const uint8_t*, size_t length) {
+                    const ConfigPayload& p = nodes[i]->radio.profile();
+                    const uint32_t airUs = timeOnAirUs(modulationFor(p.sf, p.bwKHz, p.cr, DEFAULT_PREAMBLE), length);
+                    longestUs = airUs > longestUs ? airUs : longestUs;
+                    onAir[i] = true;
+                    endUs[i] = g_nowUs + airUs;
+                });
+            }
+        }
+
+        void run(uint32_t durationMs) {
+            for (uint32_t step = 0; step < durationMs; step++) {
+                g_nowUs += 1000;
+                for (int i = 0; i < 2; i++) {
+                    if (!onAir[i] || static_cast<int32_t>(g_nowUs - endUs[i]) < 0) {
+                        continue;
+                    }
+                    onAir[i] = false;
+                    MockRadio& from = nodes[i]->radio;
+                    MockRadio& to = nodes[1 - i]->radio;
+                    const bool deaf = static_cast<int32_t>(g_nowUs - deafUntilUs[1 - i]) < 0;
+                    const bool lost = lose && lose(i, frames[i]);
+                    if (!deaf && !lost && from.profile().sf == to.profile().sf &&
+                        from.profile().bwKHz == to.profile().bwKHz) {
+                        to.deliver(from.lastTransmit(), from.lastTransmitLength(), g_nowUs);
+                    }
+                    frames[i]++;
+                    from.completeTransmit(g_nowUs);
+                }
+                nodes[0]->link.poll();
+                nodes[1]->link.poll();
+            }
+        }
+    };
+}
+
+using namespace LoRaTest;
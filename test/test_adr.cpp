@@ -0,0 +1,260 @@
+// Tests for the adaptive data rate engine, with a path-loss simulation against fixed SF9
+#include <unity.h>
+#include "../src/lora/adr.h"
+#include "../src/lora/airtime.h"
+#include "../src/lora/frame_codec.h"
+#include "lora_test_support.h"
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
+using namespace LoRaLink;
+
+static void feed(AdrEngine& adr, uint16_t node, uint16_t& seq, int count, float rssi, float snr,
+                 uint32_t& nowMs, int skipEvery = 0) {
+    for (int i = 0; i < count; ++i) {
+        if (skipEvery > 0 && i % skipEvery == 0) {
+            seq++;      // Lost on air
+        }
+        adr.onFrame(node, seq++, rssi, snr, nowMs);
+        nowMs += 2000;
+    }
+}
+
+void test_link_history() {
+    AdrEngine adr;
+    uint16_t seq = 100;
+    uint32_t now = 0;
+    feed(adr, 0x1234, seq, 8, -100.0f, -2.0f, now);
+    adr.onFrame(0x1234, seq - 1, -100.0f, -2.0f, now);     // Repeat: not a sample
+    seq += 2;                                               // Two lost
+    adr.onFrame(0x1234, seq, -104.0f, -6.0f, now);
+
+    AdrLinkSummary link;
+    TEST_ASSERT_EQUAL(1, adr.linkCount());
+    TEST_ASSERT_TRUE(adr.getLink(0, link));
+    TEST_ASSERT_EQUAL_HEX16(0x1234, link.nodeId);
+    TEST_ASSERT_EQUAL(9, link.samples);
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, -2.444f, link.meanSnr);
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, -100.444f, link.meanRssi);
+    TEST_ASSERT_EQUAL(18, link.lossPct);       // 2 of 11
+    TEST_ASSERT_EQUAL(9, adr.getStats().samples);
+
+    // A reboot resets the sequence without counting 65k losses
+    adr.onFrame(0x1234, 0, -100.0f, -2.0f, now);
+    TEST_ASSERT_TRUE(adr.getLink(0, link));
+    TEST_ASSERT_EQUAL(16, link.lossPct);       // Still 2, now of 12
+
+    // The table is bounded; the stalest link makes room
+    for (uint16_t node = 1; node <= ADR_MAX_LINKS; ++node) {
+        adr.onFrame(node, 0, -90.0f, 0.0f, now += 1000);
+    }
+    TEST_ASSERT_EQUAL(ADR_MAX_LINKS, adr.linkCount());
+    TEST_ASSERT_EQUAL(1, adr.getStats().linksEvicted);
+}
+
+void test_floor_and_rates() {
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, -7.5f, AdrEngine::requiredSnr(7));
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, -20.0f, AdrEngine::requiredSnr(12));
+    TEST_ASSERT_FLOAT_WITHIN(0.1f, -117.0f, AdrEngine::noiseFloorDbm(125.0f));
+    TEST_ASSERT_FLOAT_WITHIN(1.0f, 1758.0f, AdrEngine::bitRate(9, 125.0f, 5));
+    TEST_ASSERT_EQUAL_STRING("ADR_REQUEST", frameTypeToString(FrameType::ADR_REQUEST));
+}
+
+void test_strong_link_steps_up() {
+    AdrEngine adr;
+    uint16_t seq = 0;
+    uint32_t now = 0;
+    ConfigPayload next;
+
+    feed(adr, 1, seq, 7, -70.0f, 9.0f, now);
+    TEST_ASSERT_FALSE(adr.evaluate(SF9_125, now, next));    // Too few samples
+    feed(adr, 1, seq, 1, -70.0f, 9.0f, now);
+
+    // Plenty of margin, but one data-rate step per decision
+    TEST_ASSERT_TRUE(adr.evaluate(SF9_125, now, next));
+    TEST_ASSERT_TRUE(AdrEngine::bitRate(next.sf, next.bwKHz, 5) > AdrEngine::bitRate(9, 125.0f, 5));
+    TEST_ASSERT_EQUAL(SF9_125.cr, next.cr);
+    TEST_ASSERT_EQUAL_FLOAT(SF9_125.freqMHz, next.freqMHz);
+    TEST_ASSERT_EQUAL(1, adr.getStats().speedUps);
+
+    // Held off until the switch lands or the holdoff runs out
+    TEST_ASSERT_FALSE(adr.evaluate(SF9_125, now + 1000, next));
+    TEST_ASSERT_TRUE(adr.evaluate(SF9_125, now + 30000, next));
+
+    // Walk the profile up as the sender would apply it
+    ConfigPayload current = SF9_125;
+    for (int step = 0; step < 40; ++step) {
+        adr.reset();
+        feed(adr, 1, seq, 8, -70.0f, 9.0f, now);
+        if (!adr.evaluate(current, now, next)) {
+            break;
+        }
+        current = next;
+    }
+    TEST_ASSERT_EQUAL(7, current.sf);
+    TEST_ASSERT_EQUAL_FLOAT(500.0f, current.bwKHz);
+    TEST_ASSERT_TRUE(current.txPower < 17);
+}
+
+void test_weak_link_slows_down_at_once() {
+    AdrEngine adr;
+    uint16_t seq = 0;
+    uint32_t now = 0;
+    ConfigPayload next;
+
+    // 3 dB above the SF9 floor: SF9 itself is short of the 8 dB margin
+    feed(adr, 1, seq, 10, -126.0f, -9.5f, now);
+    TEST_ASSERT_TRUE(adr.evaluate(SF9_125, now, next));
+    const float floorNeeded = AdrEngine::requiredSnr(9) + AdrEngine::defaultConfig().marginDb;
+    const float bwGain = 10.0f * std::log10(125.0f / next.bwKHz);
+    TEST_ASSERT_TRUE(-9.5f + bwGain + (next.txPower - 17) >= AdrEngine::requiredSnr(next.sf) +
+                     AdrEngine::defaultConfig().marginDb - 0.01f);
+    TEST_ASSERT_TRUE(-9.5f < floorNeeded);
+    TEST_ASSERT_EQUAL(1, adr.getStats().slowDowns);
+}
+
+void test_worst_link_and_loss_decide() {
+    AdrEngine adr;
+    uint16_t seqA = 0, seqB = 0;
+    uint32_t now = 0;
+    ConfigPayload withWeak;
+    ConfigPayload strongOnly;
+
+    // Node 2 is 5 dB short of the SF9 margin; node 1 alone would speed up
+    feed(adr, 1, seqA, 8, -70.0f, 9.0f, now);
+    feed(adr, 2, seqB, 8, -129.0f, -9.5f, now);
+    TEST_ASSERT_TRUE(adr.evaluate(SF9_125, now, withWeak));
+    AdrEngine strong;
+    uint16_t seqC = 0;
+    feed(strong, 1, seqC, 8, -70.0f, 9.0f, now);
+    TEST_ASSERT_TRUE(strong.evaluate(SF9_125, now, strongOnly));
+    TEST_ASSERT_TRUE(AdrEngine::bitRate(strongOnly.sf, strongOnly.bwKHz, 5) > AdrEngine::bitRate(9, 125.0f, 5));
+    TEST_ASSERT_TRUE(AdrEngine::bitRate(withWeak.sf, withWeak.bwKHz, 5) < AdrEngine::bitRate(9, 125.0f, 5));
+
+    // Same SNR, but more than a quarter of the PINGs missing: the loss penalty keeps it from speeding up
+    AdrEngine lossy;
+    uint16_t seqD = 0;
+    ConfigPayload next;
+    feed(lossy, 1, seqD, 12, -118.0f, 0.5f, now, 2);
+    AdrLinkSummary link;
+    TEST_ASSERT_TRUE(lossy.getLink(0, link));
+    TEST_ASSERT_TRUE(link.lossPct > 20);
+    const bool changed = lossy.evaluate(SF9_125, now, next);
+    TEST_ASSERT_TRUE(!changed || AdrEngine::bitRate(next.sf, next.bwKHz, 5) <= AdrEngine::bitRate(9, 125.0f, 5));
+
+    AdrEngine clean;
+    uint16_t seqE = 0;
+    feed(clean, 1, seqE, 12, -118.0f, 0.5f, now);
+    TEST_ASSERT_TRUE(clean.evaluate(SF9_125, now, next));
+    TEST_ASSERT_TRUE(AdrEngine::bitRate(next.sf, next.bwKHz, 5) > AdrEngine::bitRate(9, 125.0f, 5));
+}
+
+// --- Path-loss simulation -------------------------------------------------
+
+static double airtimeMs(int sf, float bwKHz, int cr, size_t payloadBytes) {
+    return timeOnAirUs(modulationFor(sf, bwKHz, cr), payloadBytes) / 1000.0;
+}
+
+// Rough SX1262 PA model at 3.3 V: fixed bias plus output power over efficiency
+static double txCurrentMa(int dbm) {
+    return 25.0 + std::pow(10.0, dbm / 10.0) / (0.4 * 3.3);
+}
+
+struct SimResult {
+    uint32_t sent;
+    uint32_t delivered;
+    double airtimeMs;
+    double energyMj;
+    ConfigPayload final;
+};
+
+// Log-distance path loss (915 MHz, exponent 3.5) with 4 dB per-packet fading
+static SimResult simulate(double distanceM, bool useAdr, uint32_t seed) {
+    const int packets = 600;
+    const size_t pingBytes = FRAME_OVERHEAD;
+    const size_t configBytes = FRAME_OVERHEAD + CONFIG_PAYLOAD_SIZE;
+    const double pathLossDb = 40.0 + 35.0 * std::log10(distanceM);
+
+    AdrEngine adr;
+    TestRng rng(seed);
+    ConfigPayload current = SF9_125;
+    SimResult result = {};
+    uint32_t nowMs = 0;
+    for (int i = 0; i < packets; ++i) {
+        const double toa = airtimeMs(current.sf, current.bwKHz, current.cr, pingBytes);
+        result.sent++;
+        result.airtimeMs += toa;
+        result.energyMj += toa * txCurrentMa(current.txPower) * 3.3 / 1000.0;
+        const double rssi = current.txPower - pathLossDb + 4.0 * rng.gaussian();
+        const double snr = rssi - AdrEngine::noiseFloorDbm(current.bwKHz);
+        if (snr >= AdrEngine::requiredSnr(current.sf)) {
+            result.delivered++;
+            // The SX126x reports SNR only up to about +10 dB
+            adr.onFrame(1, static_cast<uint16_t>(i), static_cast<float>(rssi),
+                        static_cast<float>(std::fmin(snr, 10.0)), nowMs);
+        }
+        nowMs += 2000;
+
+        ConfigPayload next;
+        if (useAdr && i % 5 == 4 && adr.evaluate(current, nowMs, next)) {
+            // ADR_REQUEST at the receiver, then about 8 config-exchange frames at the old profile
+            const double requestMs = airtimeMs(current.sf, current.bwKHz, current.cr, configBytes);
+            result.airtimeMs += 9 * requestMs;
+            result.energyMj += 9 * requestMs * txCurrentMa(current.txPower) * 3.3 / 1000.0;
+            current = next;
+            adr.reset();
+        }
+    }
+    result.final = current;
+    return result;
+}
+
+void test_adr_benchmark() {
+    const double distances[] = { 150.0, 400.0, 900.0, 1400.0 };
+    char msg[220];
+    for (double d : distances) {
+        const SimResult fixed = simulate(d, false, 7);
+        const SimResult adaptive = simulate(d, true, 7);
+        const double fixedGoodput = fixed.delivered * FRAME_OVERHEAD * 8 / (fixed.airtimeMs / 1000.0);
+        const double adrGoodput = adaptive.delivered * FRAME_OVERHEAD * 8 / (adaptive.airtimeMs / 1000.0);
+        snprintf(msg, sizeof(msg),
+                 "%4.0f m: SF9/125/17dBm %3u/%u delivered, %.0f bit/s, %.2f mJ/pkt | ADR -> SF%u/%.0f/%ddBm %3u/%u, %.0f bit/s, %.2f mJ/pkt",
+                 d, fixed.delivered, fixed.sent, fixedGoodput, fixed.energyMj / (fixed.delivered ? fixed.delivered : 1),
+                 adaptive.final.sf, adaptive.final.bwKHz, adaptive.final.txPower, adaptive.delivered, adaptive.sent,
+                 adrGoodput, adaptive.energyMj / (adaptive.delivered ? adaptive.delivered : 1));
+        TEST_MESSAGE(msg);
+
+        // ADR never delivers materially less, and on short links it costs far less airtime and energy
+        TEST_ASSERT_TRUE(adaptive.delivered + adaptive.sent / 50 >= fixed.delivered);
+        if (d <= 400.0) {
+            TEST_ASSERT_TRUE(adaptive.airtimeMs < fixed.airtimeMs / 2);
+            TEST_ASSERT_TRUE(adaptive.energyMj < fixed.energyMj / 2);
+        }
+    }
+    // Past the SF9 range, ADR keeps the link up
+    const SimResult fixedFar = simulate(1400.0, false, 7);
+    const SimResult adaptiveFar = simulate(1400.0, true, 7);
+    TEST_ASSERT_TRUE(adaptiveFar.delivered > fixedFar.delivered * 3 / 2);
+
+    snprintf(msg, sizeof(msg), "RAM: AdrEngine %zu bytes (%zu links x %zu samples)",
+             sizeof(AdrEngine), ADR_MAX_LINKS, ADR_HISTORY);
+    TEST_MESSAGE(msg);
+}
+
+void process() {
+    RUN_TEST(test_link_history);
+    RUN_TEST(test_floor_and_rates);
+    RUN_TEST(test_strong_link_steps_up);
+    RUN_TEST(test_weak_link_slows_down_at_once);
+    RUN_TEST(test_worst_link_and_loss_decide);
+    RUN_TEST(test_adr_benchmark);
+}
+
+#ifdef UNIT_TEST
+int main(int argc, char **argv) {
+    UNITY_BEGIN();
+    process();
+    return UNITY_END();
+}
+#endif
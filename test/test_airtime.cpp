@@ -0,0 +1,255 @@
+// Tests for the SX126x time-on-air model and the airtime budget that paces TX
+#include <unity.h>
+#include "../src/lora/airtime.h"
+#include "../src/lora/tx_scheduler.h"
+#include "../src/lora/mock_radio.h"
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+
+using namespace LoRaLink;
+
+// Semtech's formula (SX1261/2 datasheet 6.1.4, AN1200.13) in floating point,
+// written out independently of the integer model; cr is 1..4 as in the formula
+static double semtechAirtimeMs(int sf, double bwHz, int cr, int preamble, bool explicitHeader,
+                               bool crc, bool ldro, int payloadBytes) {
+    const double tSym = std::pow(2.0, sf) / bwHz * 1000.0;
+    double preambleSymbols;
+    double payloadSymbols;
+    if (sf >= 7) {
+        preambleSymbols = preamble + 4.25;
+        const double bits = 8.0 * payloadBytes - 4.0 * sf + 28.0 + 16.0 * crc - 20.0 * !explicitHeader;
+        payloadSymbols = 8.0 + std::max(std::ceil(bits / (4.0 * (sf - 2 * ldro))) * (cr + 4), 0.0);
+    } else {
+        preambleSymbols = preamble + 6.25;
+        const double bits = 8.0 * payloadBytes + 16.0 * crc - 4.0 * sf + 20.0 * explicitHeader;
+        payloadSymbols = 8.0 + std::ceil(std::max(bits, 0.0) / (4.0 * sf)) * (cr + 4);
+    }
+    return (preambleSymbols + payloadSymbols) * tSym;
+}
+
+// Known values from the Semtech LoRa calculator, checked at compile time
+static_assert(timeOnAirUs(loraModulation(7, 125000), 10) == 41216, "SF7/125 kHz, 10 bytes");
+static_assert(timeOnAirUs(loraModulation(12, 125000), 10) == 991232, "SF12/125 kHz, 10 bytes, LDRO");
+static_assert(symbolTimeUs(12, 125000) == 32768, "SF12 symbol");
+static_assert(lowDataRateOptimize(loraModulation(11, 125000)) && !lowDataRateOptimize(loraModulation(10, 125000)),
+              "LDRO from 16 ms symbols");
+
+void test_matches_semtech_formula() {
+    const uint32_t bandwidths[] = { 7810, 31250, 62500, 125000, 250000, 500000 };
+    const uint16_t preambles[] = { 6, 8, 12, 16 };
+    const LdroMode ldroModes[] = { LdroMode::AUTO, LdroMode::OFF, LdroMode::ON };
+    uint32_t checked = 0;
+    for (uint8_t sf = 5; sf <= 12; ++sf) {
+        for (uint32_t bw : bandwidths) {
+            for (uint8_t cr = 5; cr <= 8; ++cr) {
+                for (uint16_t preamble : preambles) {
+                    for (int flags = 0; flags < 4; ++flags) {
+                        for (LdroMode ldro : ldroModes) {
+                            LoRaModulation m = { sf, bw, cr, preamble, (flags & 1) != 0, (flags & 2) != 0, ldro };
+                            const bool de = ldro == LdroMode::ON ||
+                                            (ldro == LdroMode::AUTO && std::pow(2.0, sf) / bw >= 0.016);
+                            TEST_ASSERT_EQUAL(de, lowDataRateOptimize(m));
+                            for (int bytes = 0; bytes <= 255; bytes += 3) {
+                                const double expectedUs = semtechAirtimeMs(sf, bw, cr - 4, preamble, m.explicitHeader,
+                                                                           m.crc, de, bytes) * 1000.0;
+                                const double error = timeOnAirUs(m, bytes) - expectedUs;
+                                if (error > 0.0 || error <= -1.0) {
+                                    char msg[160];
+                                    snprintf(msg, sizeof(msg), "SF%u BW%u CR4/%u pre%u hdr%d crc%d ldro%d %d bytes: %u vs %.3f",
+                                             sf, bw, cr, preamble, m.explicitHeader, m.crc, de, bytes,
+                                             timeOnAirUs(m, bytes), expectedUs);
+                                    TEST_FAIL_MESSAGE(msg);
+                                }
+                                checked++;
+                            }
+                        }
+                    }
+                }
+            }
+        }
+    }
+    TEST_ASSERT_TRUE(checked > 100000);
+}
+
+void test_table_matches_model() {
+    TEST_ASSERT_EQUAL(24, AIRTIME_TABLE_SIZE);
+    for (const AirtimeProfile& row : AIRTIME_TABLE) {
+        const LoRaModulation m = loraModulation(row.sf, row.bwHz);
+        TEST_ASSERT_EQUAL_UINT32(timeOnAirUs(m, PING_FRAME_BYTES), row.pingUs);
+        TEST_ASSERT_EQUAL_UINT32(timeOnAirUs(m, CONFIG_FRAME_BYTES), row.configUs);
+        TEST_ASSERT_EQUAL_UINT32(timeOnAirUs(m, MAX_FRAME_SIZE), row.maxFrameUs);
+        TEST_ASSERT_TRUE(row.pingUs < row.configUs && row.configUs < row.maxFrameUs);
+    }
+
+    // Every step up in SF costs airtime, every step up in bandwidth saves it
+    for (size_t i = 0; i + 4 < AIRTIME_TABLE_SIZE; ++i) {
+        TEST_ASSERT_TRUE(AIRTIME_TABLE[i + 4].pingUs > AIRTIME_TABLE[i].pingUs);
+        if (i % 4 != 3) {
+            TEST_ASSERT_TRUE(AIRTIME_TABLE[i + 1].pingUs < AIRTIME_TABLE[i].pingUs);
+        }
+    }
+
+    const AirtimeProfile* row = findAirtimeProfile(9, 125.0f);
+    TEST_ASSERT_NOT_NULL(row);
+    TEST_ASSERT_EQUAL_UINT32(timeOnAirUs(modulationFor(9, 125.0f, 5), PING_FRAME_BYTES), row->pingUs);
+    TEST_ASSERT_NOT_NULL(findAirtimeProfile(7, 62.5f));
+    TEST_ASSERT_NULL(findAirtimeProfile(6, 125.0f));
+    TEST_ASSERT_NULL(findAirtimeProfile(9, 41.7f));
+}
+
+void test_duty_cycle_budget_holds_one_percent() {
+    AirtimeBudgetConfig config = AirtimeBudget::defaultConfig();
+    config.dutyCyclePermille = 10;
+    AirtimeBudget budget(config);
+    budget.setModulation(loraModulation(12, 125000));
+    const uint32_t frameUs = budget.airtimeUs(MAX_FRAME_SIZE);
+
+    // A greedy sender for three hours: a full bucket (36 s) up front, 1 % after
+    uint32_t now = 0;
+    uint64_t onAirUs = 0;
+    const uint64_t endUs = 3ull * 3600 * 1000000;
+    uint64_t t = 0;
+    while (t < endUs) {
+        const uint32_t wait = budget.waitUs(MAX_FRAME_SIZE, now);
+        if (wait > 0) {
+            t += wait;
+            now += wait;
+            continue;
+        }
+        budget.onStart(MAX_FRAME_SIZE, now);
+        onAirUs += frameUs;
+        t += frameUs;
+        now += frameUs;
+    }
+    const uint64_t allowedUs = endUs / 100 + 36000000ull + frameUs;
+    TEST_ASSERT_TRUE(onAirUs <= allowedUs);
+    TEST_ASSERT_TRUE(onAirUs >= endUs / 100);
+    TEST_ASSERT_EQUAL_UINT64(onAirUs, budget.getStats().airtimeUs);
+    TEST_ASSERT_TRUE(budget.getStats().deferrals > 0);
+
+    // Without a limit nothing ever waits
+    AirtimeBudget open;
+    for (int i = 0; i < 1000; ++i) {
+        TEST_ASSERT_EQUAL_UINT32(0, open.waitUs(MAX_FRAME_SIZE, i));
+        open.onStart(MAX_FRAME_SIZE, i);
+    }
+    TEST_ASSERT_EQUAL_UINT32(0, open.getStats().deferrals);
+}
+
+void test_interval_follows_airtime() {
+    AirtimeBudget budget;
+    budget.setModulation(loraModulation(9, 125000));
+    const uint32_t sf9 = budget.intervalMs(PING_FRAME_BYTES, 62);
+    TEST_ASSERT_UINT32_WITHIN(10, 2000, sf9);    // The old fixed interval
+    TEST_ASSERT_EQUAL_UINT32((budget.airtimeUs(PING_FRAME_BYTES) * 1000 / 62 + 999) / 1000, sf9);
+
+    budget.setModulation(loraModulation(7, 125000));
+    TEST_ASSERT_TRUE(budget.intervalMs(PING_FRAME_BYTES, 62) < sf9);
+    TEST_ASSERT_EQUAL_UINT32(1000, budget.intervalMs(PING_FRAME_BYTES, 62, 1000));
+    budget.setModulation(loraModulation(12, 125000));
+    TEST_ASSERT_TRUE(budget.intervalMs(PING_FRAME_BYTES, 62) > 7 * sf9);
+
+    // A repeat share of one half spaces frames by twice their airtime
+    const uint32_t configUs = budget.airtimeUs(CONFIG_FRAME_BYTES);
+    TEST_ASSERT_UINT32_WITHIN(1, 2 * configUs / 1000, budget.intervalMs(CONFIG_FRAME_BYTES, 500));
+
+    // The duty cycle caps any share asked for
+    AirtimeBudgetConfig config = AirtimeBudget::defaultConfig();
+    config.dutyCyclePermille = 10;
+    AirtimeBudget limited(config);
+    limited.setModulation(loraModulation(9, 125000));
+    TEST_ASSERT_UINT32_WITHIN(1, limited.airtimeUs(PING_FRAME_BYTES) / 10, limited.intervalMs(PING_FRAME_BYTES, 62));
+}
+
+void test_scheduler_holds_frames_for_budget() {
+    MockRadio radio;
+    TxScheduler tx(radio);
+    radio.setDio1Handler([&](uint32_t ts) { tx.onDio1(ts); });
+
+    // A 2.5 s window at 10 %: 250 ms of airtime in the bucket
+    AirtimeBudgetConfig config = { 100, 2500 };
+    AirtimeBudget budget(config);
+    budget.setModulation(loraModulation(9, 125000));
+    tx.attachBudget(&budget);
+    const uint32_t frameUs = budget.airtimeUs(PING_FRAME_BYTES);
+
+    uint8_t payload[1] = {};
+    uint8_t buf[MAX_FRAME_SIZE];
+    uint32_t now = 1000;
+    uint32_t sent = 0;
+    for (uint16_t seq = 0; seq < 4; ++seq) {
+        TEST_ASSERT_TRUE(tx.enqueue(buf, encodeFrame(FrameType::PING, 1, seq, payload, 0, buf, sizeof(buf)),
+                                    Priority::NORMAL, now));
+    }
+    // Only as many frames as the bucket holds go out back to back
+    while (tx.isTransmitting()) {
+        now += frameUs;
+        radio.completeTransmit(now);
+        tx.poll(now);
+        sent++;
+    }
+    TEST_ASSERT_EQUAL_UINT32(123904, frameUs);
+    TEST_ASSERT_EQUAL_UINT32(2, sent);     // Two 124 ms PINGs fit, the third waits
+    TEST_ASSERT_EQUAL(4 - sent, tx.depth());
+    TEST_ASSERT_EQUAL(1, tx.getStats().paced);
+
+    // The head frame starts once the bucket has refilled its airtime
+    const uint32_t wait = budget.waitUs(PING_FRAME_BYTES, now);
+    TEST_ASSERT_TRUE(wait > 0);
+    tx.poll(now + wait - 1000);
+    TEST_ASSERT_FALSE(tx.isTransmitting());
+    tx.poll(now + wait);
+    TEST_ASSERT_TRUE(tx.isTransmitting());
+    TEST_ASSERT_EQUAL(1, tx.getStats().paced);
+}
+
+void test_airtime_benchmark() {
+    // Fixed delays against airtime pacing on the 125 kHz profiles
+    char msg[200];
+    TEST_MESSAGE("profile    PING ToA  2 s share  paced every  CONFIG ToA  8 repeats @300 ms  paced");
+    AirtimeBudget budget;
+    for (uint8_t sf = 7; sf <= 12; ++sf) {
+        const AirtimeProfile* row = findAirtimeProfile(sf, 125.0f);
+        TEST_ASSERT_NOT_NULL(row);
+        budget.setModulation(loraModulation(sf, 125000));
+        const uint32_t pingEvery = budget.intervalMs(PING_FRAME_BYTES, 62, 500);
+        const uint32_t repeatEvery = budget.intervalMs(CONFIG_FRAME_BYTES, 500);
+        // Old repeats were queued every 300 ms whatever their airtime
+        const double fixedChannel = row->configUs / 1000.0 >= 300.0 ? 100.0 : row->configUs / 3000.0;
+        snprintf(msg, sizeof(msg), "SF%-2u/125  %7.1f ms  %7.1f %%  %8u ms  %8.1f ms  %5.0f%% of channel  %6u ms apart",
+                 sf, row->pingUs / 1000.0, row->pingUs / 20000.0, pingEvery, row->configUs / 1000.0,
+                 fixedChannel, repeatEvery);
+        TEST_MESSAGE(msg);
+        TEST_ASSERT_TRUE(repeatEvery * 1000 >= 2 * row->configUs);
+    }
+
+    // Cheap enough to run per frame
+    const int calls = 1000000;
+    volatile uint32_t sink = 0;
+    const auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < calls; ++i) {
+        const LoRaModulation m = loraModulation(static_cast<uint8_t>(7 + i % 6), 125000);
+        sink = sink + timeOnAirUs(m, static_cast<size_t>(i & 0xFF));
+    }
+    const double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / calls;
+    snprintf(msg, sizeof(msg), "timeOnAirUs(): %.1f ns per call; AirtimeBudget %zu bytes", ns, sizeof(AirtimeBudget));
+    TEST_MESSAGE(msg);
+}
+
+void process() {
+    RUN_TEST(test_matches_semtech_formula);
+    RUN_TEST(test_table_matches_model);
+    RUN_TEST(test_duty_cycle_budget_holds_one_percent);
+    RUN_TEST(test_interval_follows_airtime);
+    RUN_TEST(test_scheduler_holds_frames_for_budget);
+    RUN_TEST(test_airtime_benchmark);
+}
+
+#ifdef UNIT_TEST
+int main(int argc, char **argv) {
+    UNITY_BEGIN();
+    process();
+    return UNITY_END();
+}
+#endif
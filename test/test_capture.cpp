@@ -0,0 +1,322 @@
+// Tests for frame capture: record format, stream reader, RAM ring, and replay through the link layer
+#include <unity.h>
+#include "../src/lora/capture.h"
+#include "../src/lora/capture_replay.h"
+#include "lora_test_support.h"
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+using namespace LoRaLink;
+
+static const uint32_t START_US = 5000000;
+
+static RxFrame makeFrame(FrameType type, uint16_t nodeId, uint16_t sequence, uint32_t timestampUs,
+                         float rssi, float snr) {
+    RxFrame frame = {};
+    frame.length = encodeFrame(type, nodeId, sequence, nullptr, 0, frame.data, sizeof(frame.data));
+    frame.timestampUs = timestampUs;
+    frame.rssi = rssi;
+    frame.snr = snr;
+    return frame;
+}
+
+static void append(std::vector<uint8_t>& out, const std::string& text) {
+    out.insert(out.end(), text.begin(), text.end());
+}
+
+static void append(std::vector<uint8_t>& out, const RxFrame& frame, const ConfigPayload& profile) {
+    uint8_t record[CAPTURE_MAX_RECORD];
+    const size_t len = encodeCaptureRecord(frame, profile, record, sizeof(record));
+    TEST_ASSERT_TRUE(len > 0);
+    out.insert(out.end(), record, record + len);
+}
+
+// Receiver as main.cpp wires it, polled like the firmware loop
+struct Node : TestNode {
+    uint32_t transmits = 0;
+
+    explicit Node(LinkLayerConfig config) : TestNode(RECEIVER_ID, false, config) {}
+
+    // One loop pass; answers finish on air at once
+    void poll() {
+        link.poll();
+        while (radio.getMode() == RadioMode::TRANSMIT) {
+            radio.completeTransmit(g_nowUs);
+            transmits++;
+            link.poll();
+        }
+    }
+
+    // Loop passes every 10 ms up to atUs
+    void runUntil(uint32_t atUs) {
+        for (uint32_t t = g_nowUs + CaptureReplay::LOOP_PERIOD_US; static_cast<int32_t>(atUs - t) > 0;
+             t += CaptureReplay::LOOP_PERIOD_US) {
+            g_nowUs = t;
+            poll();
+        }
+        g_nowUs = atUs;
+    }
+
+    void hearAt(uint32_t atUs, const uint8_t* frame, size_t length, float rssi, float snr) {
+        runUntil(atUs);
+        radio.deliver(frame, length, atUs, rssi, snr);
+        poll();
+    }
+};
+
+void test_record_round_trip() {
+    RxFrame frame = makeFrame(FrameType::PING, 0x0102, 77, 0xFFFFFF00u, -117.3f, -12.25f);
+    uint8_t record[CAPTURE_MAX_RECORD];
+    const size_t len = encodeCaptureRecord(frame, SF7_250, record, sizeof(record));
+    TEST_ASSERT_EQUAL(CAPTURE_OVERHEAD + frame.length, len);
+    TEST_ASSERT_EQUAL_HEX8(CAPTURE_SYNC0, record[0]);
+
+    CaptureRecord decoded;
+    TEST_ASSERT_EQUAL(len, decodeCaptureRecord(record, len, decoded));
+    TEST_ASSERT_EQUAL(frame.length, decoded.frame.length);
+    TEST_ASSERT_EQUAL_MEMORY(frame.data, decoded.frame.data, frame.length);
+    TEST_ASSERT_EQUAL_UINT32(0xFFFFFF00u, decoded.frame.timestampUs);
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, -117.3f, decoded.frame.rssi);
+    TEST_ASSERT_FLOAT_WITHIN(0.051f, -12.25f, decoded.frame.snr);     // 0.1 dB steps
+    TEST_ASSERT_EQUAL(7, decoded.profile.sf);
+    TEST_ASSERT_EQUAL_FLOAT(250.0f, decoded.profile.bwKHz);
+    TEST_ASSERT_EQUAL(14, decoded.profile.txPower);
+
+    // Truncated, corrupted, or another version
+    TEST_ASSERT_EQUAL(0, decodeCaptureRecord(record, len - 1, decoded));
+    record[CAPTURE_HEADER_SIZE] ^= 0x01;
+    TEST_ASSERT_EQUAL(0, decodeCaptureRecord(record, len, decoded));
+    record[CAPTURE_HEADER_SIZE] ^= 0x01;
+    record[2] = CAPTURE_VERSION + 1;
+    TEST_ASSERT_EQUAL(0, decodeCaptureRecord(record, len, decoded));
+
+    // Nothing to record
+    frame.length = 0;
+    TEST_ASSERT_EQUAL(0, encodeCaptureRecord(frame, SF7_250, record, sizeof(record)));
+    frame.length = 8;
+    TEST_ASSERT_EQUAL(0, encodeCaptureRecord(frame, SF7_250, record, CAPTURE_OVERHEAD + 7));
+}
+
+void test_reader_skips_log_text() {
+    // Serial dump: log lines, a record, a record cut by a reset, another record
+    std::vector<uint8_t> stream;
+    const std::string boot = "\n=== LtngDet LoRa + OLED (Heltec V3) ===\n[RX] PING from 0102 | RSSI -80.0\n";
+    append(stream, boot);
+    append(stream, makeFrame(FrameType::PING, 0x0102, 1, 1000, -80.0f, 7.5f), SF9_125);
+    std::vector<uint8_t> cut;
+    append(cut, makeFrame(FrameType::PING, 0x0102, 2, 2000, -80.0f, 7.5f), SF9_125);
+    stream.insert(stream.end(), cut.begin(), cut.begin() + 15);
+    const std::string mem = "[MEM] free=180000 min=170000 largest=110000\n";
+    append(stream, mem);
+    append(stream, makeFrame(FrameType::CONFIG_ACK, 0x0103, 9, 3000, -95.5f, -2.0f), SF9_125);
+
+    CaptureReader reader(stream.data(), stream.size());
+    CaptureRecord record;
+    TEST_ASSERT_TRUE(reader.next(record));
+    TEST_ASSERT_EQUAL_UINT32(1000, record.frame.timestampUs);
+    TEST_ASSERT_TRUE(reader.next(record));
+    TEST_ASSERT_EQUAL_UINT32(3000, record.frame.timestampUs);
+    FrameView view;
+    TEST_ASSERT_EQUAL(DecodeResult::OK, decodeFrame(record.frame.data, record.frame.length, view));
+    TEST_ASSERT_EQUAL(FrameType::CONFIG_ACK, view.header.type);
+    TEST_ASSERT_FALSE(reader.next(record));
+
+    TEST_ASSERT_EQUAL_UINT32(2, reader.getStats().records);
+    TEST_ASSERT_EQUAL_UINT32(boot.size() + 15 + mem.size(), reader.getStats().skippedBytes);
+    reader.rewind();
+    TEST_ASSERT_TRUE(reader.next(record));
+    TEST_ASSERT_EQUAL_UINT32(1000, record.frame.timestampUs);
+}
+
+void test_ring_overwrite_and_stream() {
+    CaptureRing ring;
+    const size_t recordSize = CAPTURE_OVERHEAD + FRAME_OVERHEAD;
+    const uint32_t count = 400;     // About 3 ring's worth of PINGs
+    for (uint32_t i = 0; i < count; i++) {
+        ring.record(makeFrame(FrameType::PING, 0x0102, static_cast<uint16_t>(i), i * 1000, -80.0f, 7.5f), SF9_125);
+    }
+    const uint32_t kept = CaptureRing::CAPACITY / recordSize;
+    TEST_ASSERT_EQUAL_UINT32(count, ring.getStats().records);
+    TEST_ASSERT_EQUAL_UINT32(count - kept, ring.getStats().overwritten);
+    TEST_ASSERT_EQUAL(kept * recordSize, ring.size());
+
+    // Drained in serial-sized pieces, the newest records come out whole and in order
+    std::vector<uint8_t> stream;
+    uint8_t chunk[37];
+    size_t n;
+    while ((n = ring.read(chunk, sizeof(chunk))) > 0) {
+        stream.insert(stream.end(), chunk, chunk + n);
+    }
+    TEST_ASSERT_EQUAL(0, ring.size());
+    TEST_ASSERT_EQUAL_UINT32(kept, ring.getStats().streamed);
+    TEST_ASSERT_EQUAL(kept * recordSize, stream.size());
+    CaptureReader reader(stream.data(), stream.size());
+    CaptureRecord record;
+    uint32_t expected = count - kept;
+    while (reader.next(record)) {
+        TEST_ASSERT_EQUAL_UINT32(expected * 1000, record.frame.timestampUs);
+        expected++;
+    }
+    TEST_ASSERT_EQUAL_UINT32(count, expected);
+    TEST_ASSERT_EQUAL_UINT32(0, reader.getStats().skippedBytes);
+
+    // Only whole records come out: too small a buffer gets nothing
+    ring.resetStats();
+    ring.record(makeFrame(FrameType::PING, 0x0102, 1, 1000, -80.0f, 7.5f), SF9_125);
+    ring.record(makeFrame(FrameType::PING, 0x0102, 2, 2000, -80.0f, 7.5f), SF9_125);
+    TEST_ASSERT_EQUAL(0, ring.read(chunk, recordSize - 1));
+    TEST_ASSERT_EQUAL(recordSize, ring.read(chunk, sizeof(chunk)));
+    TEST_ASSERT_EQUAL(recordSize, ring.size());
+    TEST_ASSERT_EQUAL(recordSize, ring.read(chunk, sizeof(chunk)));
+    TEST_ASSERT_EQUAL(0, ring.read(chunk, sizeof(chunk)));
+    TEST_ASSERT_EQUAL_UINT32(2, ring.getStats().streamed);
+}
+
+void test_replay_matches_live_run() {
+    LinkLayerConfig config = LinkLayerConfig::defaultConfig();
+    config.adr = true;
+    g_nowUs = START_US;
+    Node live(config);
+    CaptureRing ring;
+    live.link.attachCapture(&ring);
+
+    // A minute of traffic: three senders PINGing with gaps, a repeated update
+    // request, a corrupted frame, then a profile switch
+    uint8_t frame[MAX_FRAME_SIZE];
+    size_t len;
+    uint32_t atUs = START_US;
+    for (uint32_t i = 0; i < 75; i++) {
+        const uint16_t sender = static_cast<uint16_t>(0x0101 + i % 3);
+        const uint16_t seq = static_cast<uint16_t>(i / 3);
+        if (i % 3 == 1 && seq % 5 == 3) {
+            continue;   // Lost on air
+        }
+        atUs += 731000 + (i % 7) * 10000;
+        if (i == 42) {
+            // Profiles are recorded per frame, so switch right before one
+            live.runUntil(atUs);
+            live.link.applyProfile(SF7_250);
+        }
+        len = encodeFrame(FrameType::PING, sender, seq, nullptr, 0, frame, sizeof(frame));
+        live.hearAt(atUs, frame, len, -97.5f - (i % 3) * 6.0f, 7.5f);
+        if (i == 20 || i == 21) {
+            len = encodeFrame(FrameType::REQUEST_UPDATE, 0x0102, 300, nullptr, 0, frame, sizeof(frame));
+            live.hearAt(atUs + 200000, frame, len, -101.5f, 4.0f);
+        } else if (i == 30) {
+            len = encodeFrame(FrameType::PING, 0x0103, 99, nullptr, 0, frame, sizeof(frame));
+            frame[len - 1] ^= 0x40;
+            live.hearAt(atUs + 200000, frame, len, -120.5f, -9.0f);
+        }
+    }
+    TEST_ASSERT_EQUAL_UINT32(0, ring.getStats().overwritten);
+    const LinkStats liveStats = live.link.getStats();
+    TEST_ASSERT_EQUAL_UINT32(1, liveStats.dropped);
+    TEST_ASSERT_EQUAL_UINT32(1, liveStats.repeats);
+    TEST_ASSERT_TRUE(live.transmits >= 2);      // UPDATE_ACK and NO_FIRMWARE
+
+    // Serial dump with log lines between the drained chunks
+    std::vector<uint8_t> dump;
+    uint8_t chunk[64];
+    size_t n;
+    while ((n = ring.read(chunk, sizeof(chunk))) > 0) {
+        dump.insert(dump.end(), chunk, chunk + n);
+        append(dump, "[RX] PING from 0101 | RSSI -97.5 | SNR 7.5\n");
+    }
+
+    // Recorded timing: same frames, same answers, same link table
+    g_nowUs = START_US;
+    Node replayed(config);
+    CaptureReader reader(dump.data(), dump.size());
+    CaptureReplay replay(replayed.radio, replayed.link, [](uint32_t nowUs) { g_nowUs = nowUs; });
+    const ReplayStats& rs = replay.run(reader, ReplayTiming::RECORDED, START_US + 731000);
+    TEST_ASSERT_EQUAL_UINT32(ring.getStats().records, rs.records);
+    TEST_ASSERT_EQUAL_UINT32(rs.records, rs.delivered);
+    TEST_ASSERT_EQUAL_UINT32(1, rs.profileChanges);
+    TEST_ASSERT_EQUAL_UINT32(live.transmits, rs.transmits);
+    TEST_ASSERT_EQUAL_UINT32(g_nowUs, atUs);
+
+    const LinkStats& stats = replayed.link.getStats();
+    TEST_ASSERT_EQUAL_UINT32(liveStats.frames, stats.frames);
+    TEST_ASSERT_EQUAL_UINT32(liveStats.dropped, stats.dropped);
+    TEST_ASSERT_EQUAL_UINT32(liveStats.repeats, stats.repeats);
+    TEST_ASSERT_EQUAL_UINT32(liveStats.unhandled, stats.unhandled);
+    TEST_ASSERT_EQUAL(live.link.linkTable().size(), replayed.link.linkTable().size());
+    for (uint16_t sender = 0x0101; sender <= 0x0103; sender++) {
+        const LinkEntry* a = live.link.linkTable().find(sender);
+        const LinkEntry* b = replayed.link.linkTable().find(sender);
+        TEST_ASSERT_NOT_NULL(a);
+        TEST_ASSERT_NOT_NULL(b);
+        TEST_ASSERT_EQUAL_UINT32(a->frames, b->frames);
+        TEST_ASSERT_EQUAL_UINT32(a->missed, b->missed);
+        TEST_ASSERT_EQUAL_FLOAT(a->rssi(), b->rssi());
+    }
+    TEST_ASSERT_EQUAL_UINT32(5, live.link.linkTable().find(0x0102)->missed);
+    TEST_ASSERT_EQUAL(7, replayed.link.profile().sf);
+
+    // Full speed: the frame path sees the same frames, without the loop passes in between
+    g_nowUs = START_US;
+    Node fast(config);
+    reader.rewind();
+    CaptureReplay fastReplay(fast.radio, fast.link, [](uint32_t nowUs) { g_nowUs = nowUs; });
+    const ReplayStats& fs = fastReplay.run(reader, ReplayTiming::FULL_SPEED, START_US + 731000);
+    TEST_ASSERT_EQUAL_UINT32(rs.records, fs.records);
+    TEST_ASSERT_EQUAL_UINT32(liveStats.frames, fast.link.getStats().frames);
+    TEST_ASSERT_EQUAL_UINT32(liveStats.dropped, fast.link.getStats().dropped);
+    TEST_ASSERT_TRUE(fs.polls < rs.polls / 10);
+}
+
+void test_replay_throughput() {
+    // 200k PINGs from 32 senders, as a serial dump would hold them
+    const uint32_t count = 200000;
+    std::vector<uint8_t> dump;
+    dump.reserve(count * (CAPTURE_OVERHEAD + FRAME_OVERHEAD));
+    CaptureRing ring;
+    auto start = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < count; i++) {
+        const RxFrame frame = makeFrame(FrameType::PING, static_cast<uint16_t>(0x0100 + i % 32),
+                                        static_cast<uint16_t>(i / 32), i * 1000, -90.0f, 5.0f);
+        ring.record(frame, SF9_125);
+        uint8_t chunk[CAPTURE_MAX_RECORD];
+        const size_t n = ring.read(chunk, sizeof(chunk));
+        dump.insert(dump.end(), chunk, chunk + n);
+    }
+    const double captureSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    LinkLayerConfig config = LinkLayerConfig::defaultConfig();
+    config.adr = false;
+    g_nowUs = START_US;
+    Node node(config);
+    CaptureReader reader(dump.data(), dump.size());
+    CaptureReplay replay(node.radio, node.link, [](uint32_t nowUs) { g_nowUs = nowUs; });
+    start = std::chrono::steady_clock::now();
+    const ReplayStats& rs = replay.run(reader, ReplayTiming::FULL_SPEED, START_US);
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    TEST_ASSERT_EQUAL_UINT32(count, rs.delivered);
+    TEST_ASSERT_EQUAL_UINT32(count, node.link.getStats().frames);
+    TEST_ASSERT_EQUAL(32, node.link.linkTable().size());
+    char msg[200];
+    snprintf(msg, sizeof(msg), "Capture: %.0f ns per record + drain; replay: %u frames in %.2f s, %.0f frames/s "
+             "(%.0f s of air at 1 frame/ms)", captureSeconds * 1e9 / count, count, seconds, count / seconds,
+             rs.spanUs / 1e6);
+    TEST_MESSAGE(msg);
+}
+
+void process() {
+    RUN_TEST(test_record_round_trip);
+    RUN_TEST(test_reader_skips_log_text);
+    RUN_TEST(test_ring_overwrite_and_stream);
+    RUN_TEST(test_replay_matches_live_run);
+    RUN_TEST(test_replay_throughput);
+}
+
+#ifdef UNIT_TEST
+int main(int argc, char **argv) {
+    UNITY_BEGIN();
+    process();
+    return UNITY_END();
+}
+#endif
@@ -0,0 +1,524 @@
+// Tests for the two-phase config commit, with a multi-node channel simulation
+#include <unity.h>
+#include "../src/lora/config_commit.h"
+#include "../src/lora/airtime.h"
+#include "lora_test_support.h"
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <vector>
+
+using namespace LoRaLink;
+
+static const uint16_t COORDINATOR = 0x0001;
+
+static uint32_t airMs(size_t payloadBytes) {
+    return (timeOnAirUs(loraModulation(9, 125000), FRAME_OVERHEAD + payloadBytes) + 999) / 1000;
+}
+
+static ConfigCommitTiming sf9Timing(size_t roster) {
+    ConfigCommitTiming timing;
+    timing.prepareAirMs = airMs(CONFIG_PREPARE_HEADER_SIZE + 2 * roster);
+    timing.commitAirMs = airMs(CONFIG_COMMIT_SIZE);
+    timing.ackSlotMs = airMs(CONFIG_ACK_SIZE) + 20;
+    return timing;
+}
+
+// --- Channel simulation ------------------------------------------------------
+//
+// One coordinator and n participants on a single channel, 1 ms steps. A
+// frame is lost to a receiver that is transmitting itself, when any other
+// frame overlaps it (no capture), or by the link's loss probability.
+
+struct SimFrame {
+    size_t from;
+    FrameType type;
+    uint8_t payload[MAX_PAYLOAD_SIZE];
+    size_t length;
+    uint32_t startMs;
+    uint32_t endMs;
+    bool collided;
+};
+
+struct SimResult {
+    bool committed;
+    uint32_t coordinatorSwitchMs;   // From begin, 0 if it did not switch
+    uint32_t lastSwitchMs;          // Last node to switch, from begin
+    uint32_t skewMs;                // Between the first and last node to switch
+    size_t stranded;                // Nodes on a different profile than the coordinator
+    uint32_t frames;
+    uint32_t airtimeMs;             // All nodes
+    uint32_t coordinatorAirMs;
+    uint32_t presumed;
+};
+
+class CommitSim {
+public:
+    typedef std::function<bool(const SimFrame&, size_t to)> DropRule;
+
+    CommitSim(size_t participants, double loss, uint32_t seed, const ConfigCommitConfig& config)
+        : coordinator_(config)
+        , parts_(participants)
+        , loss_(participants + 1, loss)
+        , fade_(participants + 1, 0)
+        , queues_(participants + 1)
+        , busyUntil_(participants + 1, 0)
+        , profile_(participants + 1, SF9_125)
+        , switchedAt_(participants + 1, 0)
+        , rng_(seed)
+        , now_(1000)
+        , beginMs_(0)
+        , frames_(0)
+        , airtime_(0)
+        , coordinatorAir_(0)
+    {
+        coordinator_.setNodeId(COORDINATOR);
+        for (size_t i = 0; i < participants; ++i) {
+            parts_[i].setNodeId(nodeId(i + 1));
+            parts_[i].setApplied(COORDINATOR, 0);
+        }
+    }
+
+    static uint16_t nodeId(size_t index) {
+        return index == 0 ? COORDINATOR : static_cast<uint16_t>(0x100 + index);
+    }
+
+    ConfigCoordinator& coordinator() { return coordinator_; }
+    ConfigParticipant& participant(size_t i) { return parts_[i]; }
+    void setLoss(size_t node, double loss) { loss_[node] = loss; }
+    // Node hears nothing and is not heard for the first ms of the change
+    void setFade(size_t node, uint32_t ms) { fade_[node] = ms; }
+    void setDropRule(DropRule rule) { drop_ = rule; }
+    void knowAll() {
+        for (size_t i = 1; i <= parts_.size(); ++i) {
+            coordinator_.noteNode(nodeId(i), now_);
+        }
+    }
+
+    SimResult run(const ConfigPayload& next, uint32_t limitMs = 120000) {
+        const uint32_t beginMs = now_;
+        beginMs_ = now_;
+        TEST_ASSERT_TRUE(coordinator_.begin(next, sf9Timing(parts_.size()), now_));
+        bool coordinatorSwitched = false;
+        for (; now_ - beginMs < limitMs; ++now_) {
+            deliver();
+            step(coordinatorSwitched);
+            if (!coordinator_.isActive() && air_.empty() && idle()) {
+                break;
+            }
+        }
+
+        SimResult result = {};
+        result.committed = coordinatorSwitched;
+        result.coordinatorSwitchMs = coordinatorSwitched ? switchedAt_[0] - beginMs : 0;
+        uint32_t first = UINT32_MAX;
+        uint32_t last = 0;
+        for (size_t i = 0; i <= parts_.size(); ++i) {
+            if (switchedAt_[i] != 0) {
+                first = std::min(first, switchedAt_[i]);
+                last = std::max(last, switchedAt_[i]);
+            }
+            if (i > 0) {
+                const bool same = profile_[i].sf == profile_[0].sf && profile_[i].bwKHz == profile_[0].bwKHz;
+                result.stranded += same ? 0 : 1;
+                result.presumed += parts_[i - 1].getStats().presumedCommits;
+            }
+        }
+        result.lastSwitchMs = last ? last - beginMs : 0;
+        result.skewMs = last ? last - first : 0;
+        result.frames = frames_;
+        result.airtimeMs = airtime_;
+        result.coordinatorAirMs = coordinatorAir_;
+        return result;
+    }
+
+    // The scheme this replaces: 8 CONFIG repeats at the airtime-paced gap (twice
+    // the frame's airtime), receivers switch on the first one heard and the
+    // coordinator after the last
+    SimResult runBlindRepeats() {
+        beginMs_ = now_;
+        const uint32_t frameMs = airMs(CONFIG_PAYLOAD_SIZE);
+        const uint32_t gapMs = 2 * frameMs;
+        std::vector<bool> heard(parts_.size() + 1, false);
+        SimResult result = {};
+        uint32_t first = UINT32_MAX;
+        for (uint32_t repeat = 0; repeat < 8; ++repeat) {
+            const uint32_t startMs = repeat * gapMs;
+            for (size_t i = 1; i <= parts_.size(); ++i) {
+                if (!heard[i] && startMs >= fade_[i] && rng_.uniform() >= loss_[i]) {
+                    heard[i] = true;
+                    first = std::min(first, startMs + frameMs);
+                }
+            }
+            result.frames++;
+            result.airtimeMs += frameMs;
+        }
+        const uint32_t switchMs = 7 * gapMs + frameMs;
+        for (size_t i = 1; i <= parts_.size(); ++i) {
+            result.stranded += heard[i] ? 0 : 1;
+        }
+        result.committed = true;
+        result.coordinatorAirMs = result.airtimeMs;
+        result.coordinatorSwitchMs = switchMs;
+        result.lastSwitchMs = switchMs;
+        result.skewMs = first != UINT32_MAX ? switchMs - first : 0;
+        return result;
+    }
+
+private:
+    ConfigCoordinator coordinator_;
+    std::vector<ConfigParticipant> parts_;
+    std::vector<double> loss_;
+    std::vector<uint32_t> fade_;
+    std::vector<std::deque<SimFrame>> queues_;
+    std::vector<uint32_t> busyUntil_;
+    std::vector<ConfigPayload> profile_;
+    std::vector<uint32_t> switchedAt_;
+    std::vector<SimFrame> air_;
+    DropRule drop_;
+    TestRng rng_;
+    uint32_t now_;
+    uint32_t beginMs_;
+    uint32_t frames_;
+    uint32_t airtime_;
+    uint32_t coordinatorAir_;
+
+    bool idle() const {
+        for (const std::deque<SimFrame>& q : queues_) {
+            if (!q.empty()) {
+                return false;
+            }
+        }
+        for (const ConfigParticipant& p : parts_) {
+            if (p.isPrepared()) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    void send(size_t from, FrameType type, const uint8_t* payload, size_t length) {
+        SimFrame frame = {};
+        frame.from = from;
+        frame.type = type;
+        memcpy(frame.payload, payload, length);
+        frame.length = length;
+        queues_[from].push_back(frame);
+    }
+
+    void step(bool& coordinatorSwitched) {
+        uint8_t payload[MAX_PAYLOAD_SIZE];
+        switch (coordinator_.poll(now_)) {
+            case CommitAction::SEND_PREPARE:
+                send(0, FrameType::CONFIG_PREPARE, payload, coordinator_.encodePrepare(now_, payload, sizeof(payload)));
+                break;
+            case CommitAction::SEND_COMMIT:
+                send(0, FrameType::CONFIG_COMMIT, payload, coordinator_.encodeCommit(now_, payload, sizeof(payload)));
+                break;
+            case CommitAction::SWITCH:
+                profile_[0] = coordinator_.pending();
+                switchedAt_[0] = now_;
+                coordinatorSwitched = true;
+                break;
+            default:
+                break;
+        }
+        for (size_t i = 0; i < parts_.size(); ++i) {
+            switch (parts_[i].poll(now_)) {
+                case CommitAction::SEND_ACK:
+                    send(i + 1, FrameType::CONFIG_ACK, payload, parts_[i].encodeAck(payload, sizeof(payload)));
+                    break;
+                case CommitAction::SWITCH:
+                    profile_[i + 1] = parts_[i].pending();
+                    switchedAt_[i + 1] = now_;
+                    break;
+                default:
+                    break;
+            }
+        }
+
+        // Start queued frames on idle radios
+        for (size_t n = 0; n < queues_.size(); ++n) {
+            if (queues_[n].empty() || busyUntil_[n] > now_) {
+                continue;
+            }
+            SimFrame frame = queues_[n].front();
+            queues_[n].pop_front();
+            frame.startMs = now_;
+            frame.endMs = now_ + airMs(frame.length);
+            frame.collided = false;
+            for (SimFrame& other : air_) {
+                other.collided = true;
+                frame.collided = true;
+            }
+            busyUntil_[n] = frame.endMs;
+            air_.push_back(frame);
+            frames_++;
+            airtime_ += frame.endMs - frame.startMs;
+            coordinatorAir_ += n == 0 ? frame.endMs - frame.startMs : 0;
+        }
+    }
+
+    void deliver() {
+        for (size_t f = 0; f < air_.size();) {
+            const SimFrame& frame = air_[f];
+            if (frame.endMs > now_) {
+                ++f;
+                continue;
+            }
+            for (size_t to = 0; to < queues_.size(); ++to) {
+                // Everything but the coordinator's own traffic goes to or from it
+                if (to == frame.from || (frame.from != 0 && to != 0)) {
+                    continue;
+                }
+                const size_t link = frame.from == 0 ? to : frame.from;
+                if (frame.collided || busyUntil_[to] > frame.startMs || frame.startMs - beginMs_ < fade_[link] ||
+                    rng_.uniform() < loss_[link] ||
+                    (drop_ && drop_(frame, to))) {
+                    continue;
+                }
+                if (to == 0) {
+                    coordinator_.onAck(nodeId(frame.from), frame.payload, frame.length, now_);
+                } else if (frame.type == FrameType::CONFIG_PREPARE) {
+                    parts_[to - 1].onPrepare(COORDINATOR, frame.payload, frame.length, now_);
+                } else {
+                    parts_[to - 1].onCommit(COORDINATOR, frame.payload, frame.length, now_);
+                }
+            }
+            air_.erase(air_.begin() + f);
+        }
+    }
+};
+
+// --- Tests ---------------------------------------------------------------------
+
+void test_wire_format_round_trips() {
+    ConfigCoordinator coordinator;
+    coordinator.setNodeId(COORDINATOR);
+    coordinator.setEpoch(41);
+    TEST_ASSERT_TRUE(coordinator.begin(SF7_250, sf9Timing(2), 0));
+    TEST_ASSERT_EQUAL(42, coordinator.epoch());
+    TEST_ASSERT_EQUAL(CommitAction::SEND_PREPARE, coordinator.poll(0));
+
+    uint8_t ack[CONFIG_ACK_SIZE];
+    TEST_ASSERT_EQUAL(CONFIG_ACK_SIZE, encodeConfigAck(42, COORDINATOR, ack, sizeof(ack)));
+    TEST_ASSERT_TRUE(coordinator.onAck(0x0200, ack, sizeof(ack), 10));
+    TEST_ASSERT_FALSE(coordinator.onAck(0x0200, ack, 3, 10));
+
+    uint8_t buf[MAX_PAYLOAD_SIZE];
+    const size_t length = coordinator.encodePrepare(100, buf, sizeof(buf));
+    TEST_ASSERT_EQUAL(CONFIG_PREPARE_HEADER_SIZE + 2, length);
+    ConfigPrepare prepare;
+    TEST_ASSERT_TRUE(decodeConfigPrepare(buf, length, prepare));
+    TEST_ASSERT_EQUAL(42, prepare.epoch);
+    TEST_ASSERT_EQUAL(0, prepare.round);
+    TEST_ASSERT_EQUAL(7, prepare.config.sf);
+    TEST_ASSERT_EQUAL_FLOAT(250.0f, prepare.config.bwKHz);
+    TEST_ASSERT_TRUE(preparedAcked(prepare, 0x0200));
+    TEST_ASSERT_FALSE(preparedAcked(prepare, 0x0201));
+    TEST_ASSERT_FALSE(decodeConfigPrepare(buf, length - 1, prepare));
+    TEST_ASSERT_EQUAL(0, coordinator.encodePrepare(100, buf, length - 1));
+
+    ConfigCommitMessage commit = { 42, CommitDecision::COMMIT, 1234 };
+    TEST_ASSERT_EQUAL(CONFIG_COMMIT_SIZE, encodeConfigCommit(commit, buf, sizeof(buf)));
+    ConfigCommitMessage back;
+    TEST_ASSERT_TRUE(decodeConfigCommit(buf, CONFIG_COMMIT_SIZE, back));
+    TEST_ASSERT_EQUAL(CommitDecision::COMMIT, back.decision);
+    TEST_ASSERT_EQUAL_UINT32(1234, back.switchInMs);
+    buf[2] = 7;
+    TEST_ASSERT_FALSE(decodeConfigCommit(buf, CONFIG_COMMIT_SIZE, back));
+
+    TEST_ASSERT_EQUAL_STRING("CONFIG_PREPARE", frameTypeToString(FrameType::CONFIG_PREPARE));
+    TEST_ASSERT_EQUAL_STRING("CONFIG_ACK", frameTypeToString(FrameType::CONFIG_ACK));
+    TEST_ASSERT_EQUAL_STRING("CONFIG_COMMIT", frameTypeToString(FrameType::CONFIG_COMMIT));
+}
+
+void test_clean_channel_switches_everyone_together() {
+    CommitSim sim(6, 0.0, 1, ConfigCoordinator::defaultConfig());
+    sim.knowAll();
+    const SimResult result = sim.run(SF7_250);
+
+    TEST_ASSERT_TRUE(result.committed);
+    TEST_ASSERT_EQUAL(0, result.stranded);
+    TEST_ASSERT_EQUAL(0, result.presumed);
+    // Nodes switch within a millisecond step of the coordinator
+    TEST_ASSERT_TRUE(result.skewMs <= 2);
+    TEST_ASSERT_EQUAL(6, sim.coordinator().getStats().acks);
+    TEST_ASSERT_EQUAL(1, sim.coordinator().getStats().commits);
+    for (size_t i = 0; i < 6; ++i) {
+        TEST_ASSERT_EQUAL(sim.coordinator().epoch(), sim.participant(i).appliedEpoch());
+    }
+}
+
+void test_retries_only_draw_missing_acks() {
+    ConfigCommitConfig config = ConfigCoordinator::defaultConfig();
+    CommitSim sim(4, 0.0, 2, config);
+    sim.knowAll();
+    // Node 3 misses the first PREPARE
+    sim.setDropRule([](const SimFrame& frame, size_t to) {
+        ConfigPrepare prepare;
+        return to == 3 && frame.type == FrameType::CONFIG_PREPARE &&
+               decodeConfigPrepare(frame.payload, frame.length, prepare) && prepare.round == 0;
+    });
+    const SimResult result = sim.run(SF7_250);
+
+    TEST_ASSERT_TRUE(result.committed);
+    TEST_ASSERT_EQUAL(0, result.stranded);
+    // Everyone acked exactly once: round two named the three that had
+    for (size_t i = 0; i < 4; ++i) {
+        TEST_ASSERT_EQUAL(1, sim.participant(i).getStats().acksSent);
+    }
+    TEST_ASSERT_EQUAL(2, sim.coordinator().getStats().prepares);
+}
+
+void test_abort_and_presumed_commit() {
+    // requireAll: an unreachable roster node cancels the change for everyone
+    ConfigCommitConfig strict = ConfigCoordinator::defaultConfig();
+    strict.requireAll = true;
+    CommitSim aborted(3, 0.0, 3, strict);
+    aborted.knowAll();
+    aborted.setLoss(2, 1.0);
+    const SimResult abortResult = aborted.run(SF7_250);
+    TEST_ASSERT_FALSE(abortResult.committed);
+    TEST_ASSERT_EQUAL(0, abortResult.stranded);
+    TEST_ASSERT_EQUAL(1, aborted.coordinator().getStats().aborts);
+    TEST_ASSERT_EQUAL(5, aborted.coordinator().getStats().prepares);
+
+    // Default: the others switch and the unreachable node is a straggler
+    CommitSim lenient(3, 0.0, 3, ConfigCoordinator::defaultConfig());
+    lenient.knowAll();
+    lenient.setLoss(2, 1.0);
+    const SimResult lenientResult = lenient.run(SF7_250);
+    TEST_ASSERT_TRUE(lenientResult.committed);
+    TEST_ASSERT_EQUAL(1, lenientResult.stranded);
+    TEST_ASSERT_EQUAL(1, lenient.coordinator().getStats().stragglers);
+
+    // Every COMMIT lost to one node: it still switches, at the PREPARE deadline
+    CommitSim presumed(3, 0.0, 4, ConfigCoordinator::defaultConfig());
+    presumed.knowAll();
+    presumed.setDropRule([](const SimFrame& frame, size_t to) {
+        return to == 1 && frame.type == FrameType::CONFIG_COMMIT;
+    });
+    const SimResult presumedResult = presumed.run(SF7_250);
+    TEST_ASSERT_TRUE(presumedResult.committed);
+    TEST_ASSERT_EQUAL(0, presumedResult.stranded);
+    TEST_ASSERT_EQUAL(1, presumedResult.presumed);
+    TEST_ASSERT_TRUE(presumedResult.lastSwitchMs > presumedResult.coordinatorSwitchMs);
+}
+
+void test_stale_and_repeated_epochs_are_ignored() {
+    ConfigCoordinator coordinator;
+    coordinator.setNodeId(COORDINATOR);
+    coordinator.setEpoch(0xFFFE);
+    TEST_ASSERT_TRUE(coordinator.begin(SF7_250, sf9Timing(1), 0));
+    TEST_ASSERT_EQUAL(CommitAction::SEND_PREPARE, coordinator.poll(0));
+    uint8_t buf[MAX_PAYLOAD_SIZE];
+    const size_t length = coordinator.encodePrepare(0, buf, sizeof(buf));
+
+    // Applied 0xFFFD before the wrap: 0xFFFF is newer
+    ConfigParticipant node;
+    node.setNodeId(0x0300);
+    node.setApplied(COORDINATOR, 0xFFFD);
+    TEST_ASSERT_TRUE(node.onPrepare(COORDINATOR, buf, length, 0));
+    TEST_ASSERT_TRUE(node.isPrepared());
+
+    // A node already on that epoch (a replay after it switched) stays put
+    ConfigParticipant done;
+    done.setNodeId(0x0301);
+    done.setApplied(COORDINATOR, 0xFFFF);
+    TEST_ASSERT_TRUE(done.onPrepare(COORDINATOR, buf, length, 0));
+    TEST_ASSERT_FALSE(done.isPrepared());
+    TEST_ASSERT_EQUAL(1, done.getStats().staleIgnored);
+
+    // Another coordinator's epochs are counted separately (a replaced sender starts low)
+    done.setApplied(0x0002, 0xFFFF);
+    TEST_ASSERT_TRUE(done.onPrepare(COORDINATOR, buf, length, 0));
+    TEST_ASSERT_TRUE(done.isPrepared());
+    TEST_ASSERT_TRUE(epochNewer(0x0001, 0xFFFF));
+    TEST_ASSERT_FALSE(epochNewer(0xFFFF, 0x0001));
+
+    // COMMIT for an epoch a node never prepared is not applied
+    ConfigParticipant stranger;
+    stranger.setNodeId(0x0302);
+    ConfigCommitMessage commit = { 0xFFFF, CommitDecision::COMMIT, 100 };
+    encodeConfigCommit(commit, buf, sizeof(buf));
+    TEST_ASSERT_TRUE(stranger.onCommit(COORDINATOR, buf, CONFIG_COMMIT_SIZE, 0));
+    TEST_ASSERT_EQUAL(CommitAction::NONE, stranger.poll(1000));
+}
+
+void test_switchover_simulation() {
+    struct Scenario {
+        const char* name;
+        size_t nodes;
+        double loss;
+        uint32_t fadeMs;            // Node 1 out of reach for this long, UINT32_MAX for good
+    };
+    const Scenario scenarios[] = {
+        { "5 nodes, 10% loss", 5, 0.10, 0 },
+        { "20 nodes, 10% loss", 20, 0.10, 0 },
+        { "20 nodes, 30% loss", 20, 0.30, 0 },
+        { "5 nodes, 1 faded 3 s", 5, 0.10, 3000 },
+        { "5 nodes, 1 out of range", 5, 0.10, UINT32_MAX },
+    };
+    const int trials = 100;
+    char msg[240];
+    TEST_MESSAGE("SF9/125 kHz, 100 seeded trials each; old = 8 blind CONFIG repeats");
+    TEST_MESSAGE("switchover ms | coordinator airtime ms (all nodes) | switch skew ms | stranded nodes");
+    for (const Scenario& s : scenarios) {
+        SimResult oldSum = {};
+        SimResult newSum = {};
+        for (int t = 0; t < trials; ++t) {
+            CommitSim blind(s.nodes, s.loss, 1000 + t, ConfigCoordinator::defaultConfig());
+            CommitSim twoPhase(s.nodes, s.loss, 1000 + t, ConfigCoordinator::defaultConfig());
+            twoPhase.knowAll();
+            blind.setFade(1, s.fadeMs);
+            twoPhase.setFade(1, s.fadeMs);
+            const SimResult a = blind.runBlindRepeats();
+            const SimResult b = twoPhase.run(SF7_250);
+            TEST_ASSERT_TRUE(b.committed);
+            oldSum.lastSwitchMs += a.lastSwitchMs;
+            oldSum.coordinatorAirMs += a.coordinatorAirMs;
+            oldSum.skewMs += a.skewMs;
+            oldSum.stranded += a.stranded;
+            newSum.lastSwitchMs += b.lastSwitchMs;
+            newSum.coordinatorAirMs += b.coordinatorAirMs;
+            newSum.airtimeMs += b.airtimeMs;
+            newSum.skewMs += b.skewMs;
+            newSum.stranded += b.stranded;
+            newSum.presumed += b.presumed;
+        }
+        snprintf(msg, sizeof(msg),
+                 "%-24s old: %5u | %4u | %4u | %.2f   2-phase: %5u | %4u (%5u) | %4u | %.2f, %.2f presumed",
+                 s.name, oldSum.lastSwitchMs / trials, oldSum.coordinatorAirMs / trials, oldSum.skewMs / trials,
+                 static_cast<double>(oldSum.stranded) / trials, newSum.lastSwitchMs / trials,
+                 newSum.coordinatorAirMs / trials, newSum.airtimeMs / trials, newSum.skewMs / trials,
+                 static_cast<double>(newSum.stranded) / trials, static_cast<double>(newSum.presumed) / trials);
+        TEST_MESSAGE(msg);
+        // At high loss some nodes miss every COMMIT and switch at the later deadline
+        if (s.loss <= 0.10) {
+            TEST_ASSERT_TRUE(newSum.skewMs < oldSum.skewMs);
+        }
+        if (s.fadeMs == 3000) {
+            TEST_ASSERT_EQUAL(trials, oldSum.stranded);
+            TEST_ASSERT_EQUAL(0, newSum.stranded);
+        }
+    }
+}
+
+void process() {
+    RUN_TEST(test_wire_format_round_trips);
+    RUN_TEST(test_clean_channel_switches_everyone_together);
+    RUN_TEST(test_retries_only_draw_missing_acks);
+    RUN_TEST(test_abort_and_presumed_commit);
+    RUN_TEST(test_stale_and_repeated_epochs_are_ignored);
+    RUN_TEST(test_switchover_simulation);
+}
+
+#ifdef UNIT_TEST
+int main(int argc, char **argv) {
+    UNITY_BEGIN();
+    process();
+    return UNITY_END();
+}
+#endif
@@ -0,0 +1,166 @@
+// Tests for duplicate-frame suppression ahead of the dispatcher
+#include <unity.h>
+#include "../src/lora/dedup_cache.h"
+#include <chrono>
+#include <cstdio>
+
+using namespace LoRaLink;
+
+void test_repeats_are_dropped_once_seen() {
+    DedupCache cache;
+
+    TEST_ASSERT_FALSE(cache.isRepeat(0x1111, 7, FrameType::CONFIG, 0));
+    TEST_ASSERT_TRUE(cache.isRepeat(0x1111, 7, FrameType::CONFIG, 200));
+    TEST_ASSERT_TRUE(cache.isRepeat(0x1111, 7, FrameType::CONFIG, 1400));
+
+    // Any field that differs is a different message
+    TEST_ASSERT_FALSE(cache.isRepeat(0x1111, 8, FrameType::CONFIG, 1500));
+    TEST_ASSERT_FALSE(cache.isRepeat(0x2222, 7, FrameType::CONFIG, 1500));
+    TEST_ASSERT_FALSE(cache.isRepeat(0x1111, 7, FrameType::UPDATE_NOW, 1500));
+
+    FrameHeader header = { WIRE_VERSION, FrameType::UPDATE_NOW, 0x1111, 7 };
+    TEST_ASSERT_TRUE(cache.isRepeat(header, 1600));
+
+    TEST_ASSERT_EQUAL_UINT32(3, cache.getStats().hits);
+    TEST_ASSERT_EQUAL_UINT32(4, cache.getStats().misses);
+    TEST_ASSERT_EQUAL(4, cache.size());
+}
+
+void test_keys_expire_after_ttl() {
+    DedupCache cache(5000);
+
+    TEST_ASSERT_FALSE(cache.isRepeat(0x0042, 0, FrameType::CONFIG, 1000));
+    TEST_ASSERT_TRUE(cache.isRepeat(0x0042, 0, FrameType::CONFIG, 6000));
+    // A rebooted sender starts again at sequence 0
+    TEST_ASSERT_FALSE(cache.isRepeat(0x0042, 0, FrameType::CONFIG, 6001));
+    TEST_ASSERT_EQUAL_UINT32(1, cache.getStats().expired);
+    TEST_ASSERT_EQUAL(1, cache.size());
+    // The refreshed key suppresses that message's own repeats
+    TEST_ASSERT_TRUE(cache.isRepeat(0x0042, 0, FrameType::CONFIG, 6200));
+
+    // Across the millis() wrap
+    TEST_ASSERT_FALSE(cache.isRepeat(0x0042, 9, FrameType::CONFIG, 0xFFFFFF00u));
+    TEST_ASSERT_TRUE(cache.isRepeat(0x0042, 9, FrameType::CONFIG, 0x00000100u));
+}
+
+void test_ring_forgets_oldest_key() {
+    DedupCache cache;
+
+    for (uint16_t i = 0; i < DedupCache::CAPACITY; ++i) {
+        TEST_ASSERT_FALSE(cache.isRepeat(0x0001, i, FrameType::OTA_DATA, i));
+    }
+    TEST_ASSERT_EQUAL(DedupCache::CAPACITY, cache.size());
+    TEST_ASSERT_TRUE(cache.isRepeat(0x0001, 0, FrameType::OTA_DATA, 100));
+
+    // One more key overwrites sequence 0
+    TEST_ASSERT_FALSE(cache.isRepeat(0x0001, 100, FrameType::OTA_DATA, 101));
+    TEST_ASSERT_FALSE(cache.isRepeat(0x0001, 0, FrameType::OTA_DATA, 102));
+    TEST_ASSERT_TRUE(cache.isRepeat(0x0001, 5, FrameType::OTA_DATA, 103));
+
+    cache.clear();
+    TEST_ASSERT_EQUAL(0, cache.size());
+    TEST_ASSERT_FALSE(cache.isRepeat(0x0001, 5, FrameType::OTA_DATA, 104));
+}
+
+// One triggerLoraFirmwareUpdates() burst as a sender hears it: 8 CONFIG copies,
+// then 10 rounds of FW_UPDATE_AVAILABLE / FW_VERSION / UPDATE_NOW, 10% loss,
+// with PINGs from other senders in between
+void test_update_burst_benchmark() {
+    const uint16_t receiver = 0xA001;
+    const uint16_t cfgSeq = 40, noticeSeq = 41;
+    char msg[200];
+
+    struct Outcome {
+        uint32_t configApplied;     // updateRadioSettings() + savePersistedSettings()
+        uint32_t updateRequests;    // REQUEST_UPDATE queued by onUpdateNotice()
+        uint32_t heard;
+    };
+    Outcome outcomes[2] = {};
+
+    for (int withCache = 0; withCache < 2; ++withCache) {
+        DedupCache cache;
+        Outcome& out = outcomes[withCache];
+        uint32_t lcg = 2024;
+        uint32_t now = 0;
+        uint16_t pingSeq[20] = {};
+
+        auto deliver = [&](uint16_t node, uint16_t seq, FrameType type) {
+            lcg = lcg * 1664525u + 1013904223u;
+            now += 180;
+            if ((lcg >> 24) < 26) {
+                return;     // Lost
+            }
+            if (type == FrameType::PING) {
+                return;     // Not passed through the cache
+            }
+            out.heard++;
+            if (withCache && cache.isRepeat(node, seq, type, now)) {
+                return;
+            }
+            if (type == FrameType::CONFIG) {
+                out.configApplied++;
+            } else if (type == FrameType::FW_UPDATE_AVAILABLE || type == FrameType::UPDATE_NOW) {
+                out.updateRequests++;
+            }
+        };
+        auto otherTraffic = [&](int i) {
+            const int node = i % 20;
+            deliver(static_cast<uint16_t>(0x2000 + node), pingSeq[node]++, FrameType::PING);
+        };
+
+        for (int i = 0; i < 8; ++i) {
+            deliver(receiver, cfgSeq, FrameType::CONFIG);
+            otherTraffic(i);
+        }
+        for (int i = 0; i < 10; ++i) {
+            deliver(receiver, noticeSeq, FrameType::FW_UPDATE_AVAILABLE);
+            deliver(receiver, noticeSeq, FrameType::FW_VERSION);
+            deliver(receiver, noticeSeq, FrameType::UPDATE_NOW);
+            otherTraffic(i);
+        }
+        if (withCache) {
+            TEST_ASSERT_EQUAL_UINT32(1, out.configApplied);
+            TEST_ASSERT_EQUAL_UINT32(2, out.updateRequests);
+            TEST_ASSERT_EQUAL_UINT32(4, cache.getStats().misses);    // One per type
+        }
+    }
+    snprintf(msg, sizeof(msg),
+             "Update burst, %lu of 38 frames heard: config applied %lu -> %lu times, REQUEST_UPDATE %lu -> %lu",
+             (unsigned long)outcomes[1].heard, (unsigned long)outcomes[0].configApplied,
+             (unsigned long)outcomes[1].configApplied, (unsigned long)outcomes[0].updateRequests,
+             (unsigned long)outcomes[1].updateRequests);
+    TEST_MESSAGE(msg);
+    TEST_ASSERT_TRUE(outcomes[0].configApplied > outcomes[1].configApplied);
+
+    // Lookup cost with a full ring; every key arrives twice, eight keys apart
+    DedupCache cache;
+    const uint32_t lookups = 1000000;
+    uint32_t repeats = 0;
+    const auto t0 = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < lookups; ++i) {
+        repeats += cache.isRepeat(static_cast<uint16_t>(i & 7), static_cast<uint16_t>(i >> 4),
+                                  FrameType::OTA_DATA, i) ? 1 : 0;
+    }
+    const auto t1 = std::chrono::steady_clock::now();
+    snprintf(msg, sizeof(msg), "%u-entry ring: %.1f ns/lookup, %u bytes, %lu hits of %lu",
+             (unsigned)DedupCache::CAPACITY, std::chrono::duration<double, std::nano>(t1 - t0).count() / lookups,
+             (unsigned)sizeof(DedupCache), (unsigned long)repeats, (unsigned long)lookups);
+    TEST_MESSAGE(msg);
+    TEST_ASSERT_EQUAL_UINT32(lookups / 2, repeats);
+    TEST_ASSERT_EQUAL_UINT32(repeats, cache.getStats().hits);
+}
+
+void process() {
+    RUN_TEST(test_repeats_are_dropped_once_seen);
+    RUN_TEST(test_keys_expire_after_ttl);
+    RUN_TEST(test_ring_forgets_oldest_key);
+    RUN_TEST(test_update_burst_benchmark);
+}
+
+#ifdef UNIT_TEST
+int main(int argc, char **argv) {
+    UNITY_BEGIN();
+    process();
+    return UNITY_END();
+}
+#endif
@@ -0,0 +1,188 @@
+// Tests for the deep-sleep sender: RTC state, warm radio restore, budget carry-over and cycle cost
+#include <unity.h>
+#include "../src/lora/deep_sleep.h"
+#include "../src/lora/radio_profile.h"
+#include "../src/lora/mock_radio.h"
+#include "../src/lora/airtime.h"
+#include <cstdio>
+#include <cstring>
+
+using namespace LoRaLink;
+
+static const ConfigPayload PROFILE = { 915.0f, 125.0f, 9, 5, 17 };
+
+static uint32_t fakeNowUs = 0;
+static uint32_t fakeClock() { return fakeNowUs; }
+
+static SenderRtcState makeState() {
+    SenderRtcState state;
+    memset(&state, 0, sizeof(state));   // Padding included: the CRC covers raw bytes
+    state.radioWarm = 1;
+    state.frameSeq = 812;
+    state.pingSeq = 70001;
+    state.profile = PROFILE;
+    state.airtimeTokensUs = -1234;
+    state.wakes = 42;
+    sealRtcState(state);
+    return state;
+}
+
+void test_rtc_state_seal_and_check() {
+    SenderRtcState state = makeState();
+    TEST_ASSERT_TRUE(rtcStateValid(state));
+    TEST_ASSERT_EQUAL_UINT32(RTC_STATE_MAGIC, state.magic);
+
+    // Power-on contents, a flipped bit, an older layout
+    SenderRtcState blank;
+    memset(&blank, 0, sizeof(blank));
+    TEST_ASSERT_FALSE(rtcStateValid(blank));
+
+    SenderRtcState flipped = state;
+    flipped.pingSeq ^= 0x10;
+    TEST_ASSERT_FALSE(rtcStateValid(flipped));
+
+    SenderRtcState older = state;
+    older.version = RTC_STATE_VERSION - 1;
+    TEST_ASSERT_FALSE(rtcStateValid(older));
+
+    // Resealing after an update is what the firmware does before each sleep
+    flipped.pingSeq = 70002;
+    sealRtcState(flipped);
+    TEST_ASSERT_TRUE(rtcStateValid(flipped));
+}
+
+void test_warm_restore_skips_reset_and_calibration() {
+    MockRadio radio;
+    TEST_ASSERT_EQUAL(RadioStatus::OK, radio.reinit(PROFILE));
+    const uint64_t coldUs = radio.getStats().busyUs;
+    TEST_ASSERT_EQUAL_UINT32(3, radio.getStats().calibrations);
+
+    // After deep sleep: same chip state, a fresh manager and driver
+    radio.resetStats();
+    RadioProfileManager manager(radio, fakeClock);
+    TEST_ASSERT_FALSE(manager.isKnown());
+    TEST_ASSERT_EQUAL(RadioStatus::OK, manager.restore(PROFILE));
+    TEST_ASSERT_TRUE(manager.isKnown());
+    TEST_ASSERT_EQUAL_UINT32(5, manager.getStats().writes);
+    TEST_ASSERT_EQUAL_UINT32(0, radio.getStats().calibrations);
+    TEST_ASSERT_EQUAL_UINT32(0, radio.getStats().resets);
+    const uint64_t warmUs = radio.getStats().busyUs;
+    TEST_ASSERT_TRUE(warmUs * 50 < coldUs);
+
+    // Known from here on: the same profile writes nothing
+    TEST_ASSERT_EQUAL(RadioStatus::OK, manager.apply(PROFILE));
+    TEST_ASSERT_EQUAL_UINT32(5, manager.getStats().writes);
+
+    // A failed setter stays unknown and is written again; for the frequency
+    // that includes the calibration, as after any failed hop
+    RadioProfileManager again(radio, fakeClock);
+    radio.failNextConfig(RadioStatus::ERR_UNKNOWN);
+    TEST_ASSERT_EQUAL(RadioStatus::ERR_UNKNOWN, again.restore(PROFILE));
+    TEST_ASSERT_FALSE(again.isKnown());
+    TEST_ASSERT_EQUAL(RadioStatus::OK, again.apply(PROFILE));
+    TEST_ASSERT_TRUE(again.isKnown());
+    TEST_ASSERT_EQUAL_UINT32(1, again.getStats().calibrations);
+
+    char msg[120];
+    snprintf(msg, sizeof(msg), "Radio init: begin() %lu us, warm restore %lu us (MockRadio timings)",
+             (unsigned long)coldUs, (unsigned long)warmUs);
+    TEST_MESSAGE(msg);
+}
+
+void test_airtime_budget_across_sleep() {
+    const AirtimeBudgetConfig config = { 10, 3600000 };    // 1 %
+    const size_t frameBytes = CONFIG_FRAME_BYTES;
+
+    // One sender that never sleeps, one that saves and restores around each sleep
+    AirtimeBudget awake(config);
+    int64_t savedTokens = AirtimeBudget(config).tokensUs();
+    uint64_t clockUs = 0;
+    const uint32_t sleepUs = 5000000;
+    uint32_t sent = 0;
+    for (int cycle = 0; cycle < 400; cycle++) {
+        AirtimeBudget woken(config);
+        woken.restore(savedTokens, sleepUs, 100);
+        const uint32_t awakeWait = awake.waitUs(frameBytes, static_cast<uint32_t>(clockUs));
+        const uint32_t wokenWait = woken.waitUs(frameBytes, 100);
+        // The restored level refills like the running one (the first cycle starts full in both)
+        TEST_ASSERT_EQUAL_UINT32(awakeWait, wokenWait);
+        if (wokenWait == 0) {
+            awake.onStart(frameBytes, static_cast<uint32_t>(clockUs));
+            woken.onStart(frameBytes, 100);
+            sent++;
+        }
+        savedTokens = woken.tokensUs();
+        clockUs += sleepUs;
+    }
+    // 1 % of 2000 s allows about 122 frames of 164 ms on top of a full bucket
+    TEST_ASSERT_TRUE(sent < 400);
+    TEST_ASSERT_TRUE(sent > 100);
+}
+
+void test_sender_cycle_report() {
+    const PowerProfile profile = RxPowerModel::defaultProfile();
+    const LoRaModulation sf9 = loraModulation(9, 125000);
+    const uint32_t pingUs = timeOnAirUs(sf9, PING_FRAME_BYTES);
+    const uint32_t configUs = timeOnAirUs(sf9, CONFIG_FRAME_BYTES);
+    const uint32_t periodMs = 60000;
+
+    MockRadio radio;
+    radio.reinit(PROFILE);
+    const uint32_t coldRadioUs = static_cast<uint32_t>(radio.getStats().busyUs);
+    radio.resetStats();
+    RadioProfileManager manager(radio, fakeClock);
+    manager.restore(PROFILE);
+    // Plus leaving warm sleep and the CRC, preamble and LDRO writes the driver needs
+    const uint32_t warmRadioUs = static_cast<uint32_t>(radio.getStats().busyUs) + 500 + 3 * 20;
+
+    // Today's setup() on every wake: 500 + 750 ms of delays, 220 ms of display
+    // bring-up, then six control-channel CONFIGs one airtime apart
+    SenderCycle today = { profile.mcuBootUs, 720000, coldRadioUs, 750000 + 6 * configUs, 6 * configUs,
+                          pingUs, 1000, periodMs };
+    // Deep-sleep cycle: restore RTC state, radio from warm sleep, one PING
+    SenderCycle warm = { profile.mcuBootUs, 2000, warmRadioUs, 0, 0, pingUs, 1000, periodMs };
+    SenderCycle cold = warm;
+    cold.radioInitUs = coldRadioUs;
+
+    const SenderCycleReport todayReport = senderCycleReport(today, profile);
+    const SenderCycleReport warmReport = senderCycleReport(warm, profile);
+    const SenderCycleReport coldReport = senderCycleReport(cold, profile);
+
+    char msg[200];
+    TEST_MESSAGE("One PING a minute at SF9/125 kHz, 3000 mAh:");
+    const struct { const char* name; const SenderCycleReport* report; } rows[] = {
+        { "setup() every wake      ", &todayReport },
+        { "deep sleep, radio begin()", &coldReport },
+        { "deep sleep, warm radio  ", &warmReport },
+    };
+    for (const auto& row : rows) {
+        snprintf(msg, sizeof(msg), "  %s: wake->TX %7.1f ms, awake %7.1f ms, %8.1f uC (%6.2f mJ) per cycle, "
+                 "%6.1f uA, %5.0f days",
+                 row.name, row.report->wakeToTxUs / 1000.0, row.report->awakeUs / 1000.0, row.report->chargeUc,
+                 row.report->energyMj, row.report->averageUa, row.report->batteryDays(3000.0f));
+        TEST_MESSAGE(msg);
+    }
+
+    TEST_ASSERT_TRUE(warmReport.wakeToTxUs < coldReport.wakeToTxUs);
+    TEST_ASSERT_TRUE(coldReport.wakeToTxUs < todayReport.wakeToTxUs / 10);
+    TEST_ASSERT_TRUE(warmReport.chargeUc < todayReport.chargeUc / 10);
+    // Boot dominates once the delays are gone; the radio still saves a share
+    TEST_ASSERT_TRUE(warmReport.chargeUc < coldReport.chargeUc);
+    // Sleeping floor: about 8.6 uA, so the average stays above it
+    TEST_ASSERT_TRUE(warmReport.averageUa > (profile.mcuDeepSleepMa + profile.radioSleepMa) * 1000.0f);
+}
+
+void process() {
+    RUN_TEST(test_rtc_state_seal_and_check);
+    RUN_TEST(test_warm_restore_skips_reset_and_calibration);
+    RUN_TEST(test_airtime_budget_across_sleep);
+    RUN_TEST(test_sender_cycle_report);
+}
+
+#ifdef UNIT_TEST
+int main(int argc, char **argv) {
+    UNITY_BEGIN();
+    process();
+    return UNITY_END();
+}
+#endif
@@ -0,0 +1,306 @@
+// Tests for delta firmware updates: patch generation, streaming apply, verification
+#include <unity.h>
+#include "../src/lora/delta_patch.h"
+#include "../src/lora/delta_encoder.h"
+#include "../src/lora/staged_update.h"
+#include "../src/lora/mock_update_backend.h"
+#include "../src/lora/frame_codec.h"
+#include "lora_test_support.h"
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <vector>
+
+using namespace LoRaLink;
+
+// The running app, held in RAM
+class VectorBaseImage : public IImageSource {
+public:
+    explicit VectorBaseImage(const std::vector<uint8_t>& image) : image_(image), reads_(0) {}
+
+    size_t size() const override { return image_.size(); }
+    bool read(size_t offset, uint8_t* data, size_t length) override {
+        reads_++;
+        if (offset + length > image_.size()) {
+            return false;
+        }
+        memcpy(data, image_.data() + offset, length);
+        return true;
+    }
+    uint32_t reads() const { return reads_; }
+
+private:
+    const std::vector<uint8_t>& image_;
+    uint32_t reads_;
+};
+
+// Code-like image: 60 opaque bytes then a 32-bit absolute pointer into the image
+static const uint32_t LOAD_ADDRESS = 0x42000000;
+
+static std::vector<uint8_t> makeFirmware(size_t size, uint32_t seed) {
+    std::vector<uint8_t> image = makeImage(size, seed);
+    for (size_t p = 60; p + 4 <= size; p += 64) {
+        seed = seed * 1664525u + 1013904223u;
+        Wire::putU32(image.data() + p, LOAD_ADDRESS + (seed >> 8) % size);
+    }
+    return image;
+}
+
+// What a rebuild with a slightly larger function does: bytes appear at one
+// point, everything after moves, and every pointer past it changes
+static std::vector<uint8_t> relink(const std::vector<uint8_t>& base, size_t at, size_t grow, uint32_t seed) {
+    std::vector<uint8_t> target(base.begin(), base.begin() + at);
+    std::vector<uint8_t> added = makeImage(grow, seed);
+    target.insert(target.end(), added.begin(), added.end());
+    target.insert(target.end(), base.begin() + at, base.end());
+    for (size_t p = 60; p + 4 <= base.size(); p += 64) {
+        const size_t moved = p < at ? p : p + grow;
+        const uint32_t pointer = Wire::getU32(base.data() + p);
+        if (pointer - LOAD_ADDRESS >= at) {
+            Wire::putU32(target.data() + moved, pointer + static_cast<uint32_t>(grow));
+        }
+    }
+    return target;
+}
+
+// Stream the patch through OtaReceiver in reverse chunk order
+static OtaResult deliver(OtaReceiver& ota, const std::vector<uint8_t>& patch) {
+    OtaResult r = ota.start(startFor(patch, OTA_START_FLAG_DELTA), 0);
+    if (r != OtaResult::OK) {
+        return r;
+    }
+    for (uint32_t i = ota.chunkCount(); i-- > 0;) {
+        const size_t offset = static_cast<size_t>(i) * CHUNK;
+        const size_t len = patch.size() - offset < CHUNK ? patch.size() - offset : CHUNK;
+        ota.onChunk(static_cast<uint16_t>(i), patch.data() + offset, len, 0);
+    }
+    return ota.finish();
+}
+
+static bool startsWith(const std::vector<uint8_t>& flash, const std::vector<uint8_t>& image) {
+    return flash.size() >= image.size() && std::equal(image.begin(), image.end(), flash.begin());
+}
+
+void test_start_flags_are_optional_on_the_wire() {
+    OtaStartInfo info = startFor(makeImage(1000, 1), OTA_START_FLAG_DELTA);
+    uint8_t payload[OTA_START_PAYLOAD_SIZE + 1];
+    TEST_ASSERT_EQUAL(OTA_START_PAYLOAD_SIZE + 1, encodeOtaStart(info, payload, sizeof(payload)));
+    TEST_ASSERT_EQUAL(0, encodeOtaStart(info, payload, OTA_START_PAYLOAD_SIZE));
+    OtaStartInfo decoded;
+    TEST_ASSERT_TRUE(decodeOtaStart(payload, OTA_START_PAYLOAD_SIZE + 1, decoded));
+    TEST_ASSERT_EQUAL_HEX8(OTA_START_FLAG_DELTA, decoded.flags);
+
+    // A full-image start is byte-for-byte what older firmware sends
+    info.flags = 0;
+    TEST_ASSERT_EQUAL(OTA_START_PAYLOAD_SIZE, encodeOtaStart(info, payload, sizeof(payload)));
+    decoded.flags = 0xAA;
+    TEST_ASSERT_TRUE(decodeOtaStart(payload, OTA_START_PAYLOAD_SIZE, decoded));
+    TEST_ASSERT_EQUAL_HEX8(0, decoded.flags);
+    TEST_ASSERT_FALSE(decodeOtaStart(payload, OTA_START_PAYLOAD_SIZE + 2, decoded));
+}
+
+void test_patch_rebuilds_edited_image() {
+    std::vector<uint8_t> base = makeImage(40000, 7);
+    std::vector<uint8_t> target = base;
+    target[100] ^= 0x5A;                                        // In place
+    target.insert(target.begin() + 9000, 300, 0xE7);            // Insertion
+    target.erase(target.begin() + 20000, target.begin() + 20500); // Deletion
+    std::vector<uint8_t> fresh = makeImage(1000, 9);
+    std::copy(fresh.begin(), fresh.end(), target.begin() + 30000); // Rewritten block
+
+    DeltaEncoder encoder;
+    std::vector<uint8_t> patch = encoder.encode(base.data(), base.size(), target.data(), target.size());
+    TEST_ASSERT_TRUE(isDeltaPatch(patch.data(), patch.size()));
+    TEST_ASSERT_TRUE(patch.size() < 2000);
+    TEST_ASSERT_TRUE(encoder.getStats().insertBytes >= 300);
+
+    MockUpdateBackend flash(64 * 1024);
+    VectorBaseImage running(base);
+    StagedUpdateBackend backend(flash, running);
+    backend.setFlags(OTA_START_FLAG_DELTA);
+    OtaReceiver ota(backend);
+    TEST_ASSERT_EQUAL(OtaResult::OK, deliver(ota, patch));
+    TEST_ASSERT_EQUAL(DeltaResult::OK, backend.lastDeltaResult());
+    TEST_ASSERT_TRUE(flash.isBootable());
+    TEST_ASSERT_TRUE(startsWith(flash.image(), target));
+
+    const DeltaStats& st = backend.applier().getStats();
+    TEST_ASSERT_EQUAL_UINT32(target.size(), st.copied + st.added + st.inserted);
+    TEST_ASSERT_EQUAL_UINT32(patch.size(), st.patchBytes);
+    TEST_ASSERT_EQUAL_UINT32(0, flash.getStats().rewrites);
+}
+
+void test_full_image_passes_through() {
+    std::vector<uint8_t> image = makeImage(5000, 3);
+    MockUpdateBackend flash(64 * 1024);
+    VectorBaseImage running(image);
+    StagedUpdateBackend backend(flash, running);
+    OtaReceiver ota(backend);
+    OtaStartInfo info = startFor(image);
+    TEST_ASSERT_EQUAL(OtaResult::OK, ota.start(info, 0));
+    for (uint32_t i = 0; i < ota.chunkCount(); ++i) {
+        const size_t offset = static_cast<size_t>(i) * CHUNK;
+        const size_t len = image.size() - offset < CHUNK ? image.size() - offset : CHUNK;
+        ota.onChunk(static_cast<uint16_t>(i), image.data() + offset, len, 0);
+    }
+    TEST_ASSERT_EQUAL(OtaResult::OK, ota.finish());
+    TEST_ASSERT_TRUE(flash.image() == image);
+    TEST_ASSERT_EQUAL(0, running.reads());
+}
+
+void test_applier_rejects_bad_patches() {
+    std::vector<uint8_t> base = makeImage(8000, 11);
+    std::vector<uint8_t> target = base;
+    target.insert(target.begin() + 4000, 64, 0x11);
+    DeltaEncoder encoder;
+    std::vector<uint8_t> patch = encoder.encode(base.data(), base.size(), target.data(), target.size());
+
+    // Wrong running image: nothing is written, nothing becomes bootable
+    std::vector<uint8_t> other = base;
+    other[7999] ^= 1;
+    MockUpdateBackend flash(32 * 1024);
+    VectorBaseImage wrongBase(other);
+    StagedUpdateBackend backend(flash, wrongBase);
+    backend.setFlags(OTA_START_FLAG_DELTA);
+    OtaReceiver ota(backend);
+    TEST_ASSERT_EQUAL(OtaResult::BACKEND_ERROR, deliver(ota, patch));
+    TEST_ASSERT_EQUAL(DeltaResult::BASE_MISMATCH, backend.lastDeltaResult());
+    TEST_ASSERT_FALSE(flash.isBootable());
+
+    // Target that would run into the staged patch
+    MockUpdateBackend small(8 * 1024);
+    VectorBaseImage running(base);
+    StagedUpdateBackend tight(small, running);
+    tight.setFlags(OTA_START_FLAG_DELTA);
+    OtaReceiver ota2(tight);
+    TEST_ASSERT_EQUAL(OtaResult::BACKEND_ERROR, deliver(ota2, patch));
+    TEST_ASSERT_EQUAL(DeltaResult::TOO_LARGE, tight.lastDeltaResult());
+
+    // Applied directly (no transport hash): damaged ops and damaged data
+    DeltaApplier applier;
+    MockUpdateBackend store(64 * 1024);
+    auto applyPatch = [&](const std::vector<uint8_t>& p) {
+        store.begin(64 * 1024);
+        store.write(32 * 1024, p.data(), p.size());
+        BackendReader reader(store, 32 * 1024, p.size());
+        return applier.apply(reader, running, store, 32 * 1024);
+    };
+    TEST_ASSERT_EQUAL(DeltaResult::OK, applyPatch(patch));
+
+    std::vector<uint8_t> truncated(patch.begin(), patch.end() - 1);
+    TEST_ASSERT_EQUAL(DeltaResult::CORRUPT, applyPatch(truncated));
+
+    std::vector<uint8_t> notPatch = patch;
+    notPatch[0] = 'X';
+    TEST_ASSERT_EQUAL(DeltaResult::BAD_HEADER, applyPatch(notPatch));
+
+    // COPY past the end of the base
+    std::vector<uint8_t> outOfRange(patch.begin(), patch.begin() + DELTA_HEADER_SIZE);
+    const uint8_t ops[] = { static_cast<uint8_t>(DeltaOp::COPY), 0x80, 0x02, 0xC0, 0x7C,
+                            static_cast<uint8_t>(DeltaOp::END) };   // 256 bytes at 7968
+    outOfRange.insert(outOfRange.end(), ops, ops + sizeof(ops));
+    TEST_ASSERT_EQUAL(DeltaResult::CORRUPT, applyPatch(outOfRange));
+
+    // A flipped literal byte gets through the op stream but not the target hash
+    std::vector<uint8_t> tampered = patch;
+    for (size_t i = patch.size() - 2; i > DELTA_HEADER_SIZE; --i) {
+        if (patch[i] == 0x11) {
+            tampered[i] ^= 0x01;
+            break;
+        }
+    }
+    TEST_ASSERT_EQUAL(DeltaResult::TARGET_MISMATCH, applyPatch(tampered));
+}
+
+static double chunkAirtimeSeconds(size_t bytes) {
+    // SF9, BW125, CR4/5: one full OTA_DATA frame per 200-byte chunk
+    const double frame = FRAME_OVERHEAD + OTA_CHUNK_HEADER_SIZE + CHUNK;
+    const double bits = 8.0 * frame - 4 * 9 + 28 + 16;
+    const double symbols = 8 + 4.25 + 8 + std::ceil(bits / (4 * 9)) * 5;
+    return std::ceil(bytes / static_cast<double>(CHUNK)) * symbols * 4.096e-3;
+}
+
+static void reportPair(const char* name, const std::vector<uint8_t>& base, const std::vector<uint8_t>& target,
+                       std::vector<uint8_t>& patchOut) {
+    DeltaEncoder encoder;
+    auto t0 = std::chrono::steady_clock::now();
+    patchOut = encoder.encode(base.data(), base.size(), target.data(), target.size());
+    auto t1 = std::chrono::steady_clock::now();
+
+    MockUpdateBackend flash(target.size() + patchOut.size() + 8192);
+    VectorBaseImage running(base);
+    StagedUpdateBackend backend(flash, running);
+    backend.setFlags(OTA_START_FLAG_DELTA);
+    OtaReceiver ota(backend);
+    auto t2 = std::chrono::steady_clock::now();
+    OtaResult r = deliver(ota, patchOut);
+    auto t3 = std::chrono::steady_clock::now();
+    TEST_ASSERT_EQUAL(OtaResult::OK, r);
+    TEST_ASSERT_TRUE(startsWith(flash.image(), target));
+
+    const DeltaEncodeStats& st = encoder.getStats();
+    char msg[220];
+    snprintf(msg, sizeof(msg),
+             "%s: %zu -> %zu bytes, patch %zu (%.1f%%) | copy %u add %u insert %u | airtime %.0f s vs %.0f s full",
+             name, base.size(), target.size(), patchOut.size(), 100.0 * patchOut.size() / target.size(),
+             (unsigned)st.copyBytes, (unsigned)st.addBytes, (unsigned)st.insertBytes,
+             chunkAirtimeSeconds(patchOut.size()), chunkAirtimeSeconds(target.size()));
+    TEST_MESSAGE(msg);
+    snprintf(msg, sizeof(msg), "%s: encode %.0f ms, receive + apply + verify %.0f ms (host)", name,
+             std::chrono::duration<double, std::milli>(t1 - t0).count(),
+             std::chrono::duration<double, std::milli>(t3 - t2).count());
+    TEST_MESSAGE(msg);
+}
+
+static bool loadFile(const char* path, std::vector<uint8_t>& data) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in) {
+        return false;
+    }
+    data.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    return !data.empty();
+}
+
+void test_delta_benchmark() {
+    std::vector<uint8_t> patch;
+
+    // 1 MB relinked with a function that grew by 600 bytes, plus a rewritten 2 KB routine
+    std::vector<uint8_t> base = makeFirmware(1024 * 1024, 21);
+    std::vector<uint8_t> target = relink(base, 300 * 1024, 600, 22);
+    std::vector<uint8_t> routine = makeImage(2048, 23);
+    std::copy(routine.begin(), routine.end(), target.begin() + 700 * 1024);
+    reportPair("relinked 1 MB", base, target, patch);
+    TEST_ASSERT_TRUE(patch.size() * 10 < target.size());
+
+    std::vector<uint8_t> sameBuild;
+    reportPair("identical", base, base, sameBuild);
+    TEST_ASSERT_TRUE(sameBuild.size() < 100);
+
+    // Real build pairs from `pio run -e sender -e receiver`, when present
+    std::vector<uint8_t> sender, receiver;
+    if (!loadFile(".pio/build/sender/firmware.bin", sender) ||
+        !loadFile(".pio/build/receiver/firmware.bin", receiver)) {
+        TEST_IGNORE_MESSAGE("no .pio/build/{sender,receiver}/firmware.bin; build both envs for the real pair");
+    }
+    reportPair("sender -> receiver build", sender, receiver, patch);
+    reportPair("receiver -> sender build", receiver, sender, patch);
+}
+
+void process() {
+    RUN_TEST(test_start_flags_are_optional_on_the_wire);
+    RUN_TEST(test_patch_rebuilds_edited_image);
+    RUN_TEST(test_full_image_passes_through);
+    RUN_TEST(test_applier_rejects_bad_patches);
+    RUN_TEST(test_delta_benchmark);
+}
+
+#ifdef UNIT_TEST
+int main(int argc, char **argv) {
+    UNITY_BEGIN();
+    process();
+    return UNITY_END();
+}
+#endif
@@ -0,0 +1,251 @@
+// Tests for the flash-backed firmware store the receiver serves LoRa OTA from
+#include <unity.h>
+#include "../src/lora/firmware_store.h"
+#include "../src/lora/file_flash_region.h"
+#include "../src/lora/ota_fec.h"
+#include "../src/lora/frame_codec.h"
+#include "lora_test_support.h"
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+using namespace LoRaLink;
+
+static const char* REGION_PATH = "/tmp/test_firmware_store.bin";
+static const size_t REGION_SIZE = 512 * 1024;
+
+static bool storeMatches(FirmwareStore& store, const std::vector<uint8_t>& image) {
+    std::vector<uint8_t> readBack(image.size());
+    return store.size() == image.size() && store.read(0, readBack.data(), readBack.size()) &&
+           readBack == image;
+}
+
+void setUp(void) {
+    remove(REGION_PATH);
+}
+
+void tearDown(void) {
+    remove(REGION_PATH);
+}
+
+void test_capture_survives_reboot() {
+    const std::vector<uint8_t> image = makeImage(150 * 1000 + 17, 1);
+    {
+        FileFlashRegion region(REGION_PATH, REGION_SIZE);
+        TEST_ASSERT_TRUE(region.isOpen());
+        FirmwareStore store(region);
+        TEST_ASSERT_FALSE(store.load());
+        TEST_ASSERT_EQUAL(0, store.size());
+
+        MemoryImage source(image.data(), image.size());
+        TEST_ASSERT_EQUAL(StoreResult::OK, store.capture(source, 0x00010203));
+        TEST_ASSERT_TRUE(store.hasImage());
+        TEST_ASSERT_TRUE(storeMatches(store, image));
+        TEST_ASSERT_EQUAL(1, store.getStats().captures);
+    }
+
+    // Power cycle: a fresh instance finds the image through the record alone
+    FileFlashRegion region(REGION_PATH, REGION_SIZE);
+    FirmwareStore store(region);
+    TEST_ASSERT_TRUE(store.load());
+    TEST_ASSERT_EQUAL(image.size(), store.info().size);
+    TEST_ASSERT_EQUAL_HEX32(0x00010203, store.info().version);
+    uint8_t digest[Sha256::DIGEST_SIZE];
+    Sha256::hash(image.data(), image.size(), digest);
+    TEST_ASSERT_EQUAL_MEMORY(digest, store.info().sha256, sizeof(digest));
+    TEST_ASSERT_TRUE(storeMatches(store, image));
+
+    // A smaller image replaces it; the tail of the old one must not leak in
+    const std::vector<uint8_t> smaller = makeImage(20000, 2);
+    MemoryImage source(smaller.data(), smaller.size());
+    TEST_ASSERT_EQUAL(StoreResult::OK, store.capture(source, 2));
+    TEST_ASSERT_TRUE(storeMatches(store, smaller));
+    uint8_t past[4];
+    TEST_ASSERT_FALSE(store.read(smaller.size() - 2, past, sizeof(past)));
+}
+
+void test_interrupted_capture_leaves_store_empty() {
+    const std::vector<uint8_t> image = makeImage(40000, 3);
+    {
+        FileFlashRegion region(REGION_PATH, REGION_SIZE);
+        FirmwareStore store(region);
+        MemoryImage source(image.data(), image.size());
+        TEST_ASSERT_EQUAL(StoreResult::OK, store.capture(source, 1));
+
+        // Reset halfway through the next capture: no commit() ever runs
+        TEST_ASSERT_EQUAL(StoreResult::OK, store.begin(image.size()));
+        TEST_ASSERT_FALSE(store.hasImage());
+        TEST_ASSERT_EQUAL(StoreResult::OK, store.append(image.data(), image.size() / 2));
+    }
+
+    FileFlashRegion region(REGION_PATH, REGION_SIZE);
+    FirmwareStore store(region);
+    TEST_ASSERT_FALSE(store.load());
+    TEST_ASSERT_EQUAL(0, store.size());
+}
+
+void test_rejects_wrong_sizes() {
+    FileFlashRegion region(REGION_PATH, REGION_SIZE);
+    FirmwareStore store(region);
+    TEST_ASSERT_EQUAL(REGION_SIZE - FLASH_SECTOR_SIZE, store.capacity());
+
+    TEST_ASSERT_EQUAL(StoreResult::TOO_LARGE, store.begin(store.capacity() + 1));
+    TEST_ASSERT_EQUAL(StoreResult::TOO_LARGE, store.begin(0));
+    uint8_t data[64] = {};
+    TEST_ASSERT_EQUAL(StoreResult::NOT_CAPTURING, store.append(data, sizeof(data)));
+
+    // More than announced
+    TEST_ASSERT_EQUAL(StoreResult::OK, store.begin(100));
+    TEST_ASSERT_EQUAL(StoreResult::OK, store.append(data, 64));
+    TEST_ASSERT_EQUAL(StoreResult::SIZE_MISMATCH, store.append(data, 64));
+    TEST_ASSERT_FALSE(store.isCapturing());
+
+    // Fewer than announced
+    TEST_ASSERT_EQUAL(StoreResult::OK, store.begin(100));
+    TEST_ASSERT_EQUAL(StoreResult::OK, store.append(data, 64));
+    TEST_ASSERT_EQUAL(StoreResult::SIZE_MISMATCH, store.commit(1));
+    TEST_ASSERT_FALSE(store.hasImage());
+    TEST_ASSERT_FALSE(store.load());
+    TEST_ASSERT_EQUAL(4, store.getStats().failures);
+}
+
+void test_flash_failures_and_corruption() {
+    const std::vector<uint8_t> image = makeImage(30000, 4);
+    FileFlashRegion region(REGION_PATH, REGION_SIZE);
+    FirmwareStore store(region);
+    MemoryImage source(image.data(), image.size());
+
+    region.failWriteAfter(10);
+    TEST_ASSERT_EQUAL(StoreResult::FLASH_ERROR, store.capture(source, 1));
+    TEST_ASSERT_FALSE(store.hasImage());
+    TEST_ASSERT_FALSE(store.isCapturing());
+    region.failWriteAfter(0);
+
+    TEST_ASSERT_EQUAL(StoreResult::OK, store.capture(source, 1));
+    TEST_ASSERT_TRUE(store.load());
+
+    // A bit cleared in the image body (NOR write over programmed data)
+    const uint8_t zero = 0;
+    TEST_ASSERT_TRUE(region.write(FirmwareStore::IMAGE_OFFSET + 12345, &zero, 1));
+    TEST_ASSERT_FALSE(store.load());
+    TEST_ASSERT_FALSE(store.hasImage());
+    uint8_t chunk[16];
+    TEST_ASSERT_FALSE(store.read(0, chunk, sizeof(chunk)));
+}
+
+void test_transfers_stream_from_store() {
+    const std::vector<uint8_t> image = makeImage(100 * 1000 + 3, 5);
+    FileFlashRegion region(REGION_PATH, REGION_SIZE);
+    FirmwareStore store(region);
+    MemoryImage source(image.data(), image.size());
+    TEST_ASSERT_EQUAL(StoreResult::OK, store.capture(source, 1));
+
+    // ARQ: chunk-by-chunk reads hash to the OTA_START digest
+    uint8_t digest[Sha256::DIGEST_SIZE];
+    TEST_ASSERT_TRUE(hashImage(store, digest));
+    TEST_ASSERT_EQUAL_MEMORY(store.info().sha256, digest, sizeof(digest));
+
+    // FEC: coded packets built from flash match those built from RAM
+    const FecLayout layout(static_cast<uint32_t>(image.size()), 200);
+    uint8_t fromRam[MAX_PAYLOAD_SIZE];
+    uint8_t fromFlash[MAX_PAYLOAD_SIZE];
+    for (uint16_t block = 0; block < layout.blockCount; ++block) {
+        const uint8_t chunks = layout.chunksInBlock(block);
+        for (uint16_t seq = 0; seq < chunks + 4; ++seq) {
+            const uint32_t mask = seq < chunks ? 1u << seq : fecRepairMask(block, seq, chunks);
+            const size_t ramLength = encodeCodedPacket(layout, image.data(), block, mask, fromRam, sizeof(fromRam));
+            const size_t flashLength = encodeCodedPacket(layout, store, block, mask, fromFlash, sizeof(fromFlash));
+            TEST_ASSERT_TRUE(ramLength > 0);
+            TEST_ASSERT_EQUAL(ramLength, flashLength);
+            TEST_ASSERT_EQUAL_MEMORY(fromRam, fromFlash, ramLength);
+        }
+    }
+
+    // A read error surfaces as "no packet", which the sender counts as a loss
+    FirmwareStore empty(region);
+    TEST_ASSERT_EQUAL(0, encodeCodedPacket(layout, empty, 0, 1, fromFlash, sizeof(fromFlash)));
+}
+
+// An app image whose description carries this version string
+static std::vector<uint8_t> makeAppImage(const char* version) {
+    std::vector<uint8_t> image = makeImage(4096, 8);
+    image[0] = ESP_IMAGE_MAGIC;
+    Wire::putU32(image.data() + ESP_APP_DESC_OFFSET, ESP_APP_DESC_MAGIC);
+    memset(image.data() + ESP_APP_VERSION_OFFSET, 0, ESP_APP_VERSION_SIZE);
+    memcpy(image.data() + ESP_APP_VERSION_OFFSET, version, strlen(version));
+    return image;
+}
+
+void test_version_comes_from_the_image() {
+    struct Case { const char* text; uint32_t version; };
+    const Case cases[] = {
+        { "1.0.0", 0x010000 }, { "v2.4.17", 0x020411 }, { "3.1", 0x030100 }, { "1.2.3-rc1", 0x010203 },
+        { "1a2b3c4", 0 }, { "abcdef0", 0 }, { "1.256.0", 0 }, { "", 0 }
+    };
+    for (const Case& c : cases) {
+        std::vector<uint8_t> image = makeAppImage(c.text);
+        MemoryImage source(image.data(), image.size());
+        TEST_ASSERT_EQUAL_HEX32(c.version, appImageVersion(source));
+    }
+
+    // No app description: unknown, not the running build's version
+    std::vector<uint8_t> image = makeAppImage("2.0.0");
+    image[ESP_APP_DESC_OFFSET] ^= 0xFF;
+    MemoryImage plain(image.data(), image.size());
+    TEST_ASSERT_EQUAL_HEX32(0, appImageVersion(plain));
+
+    // The store keeps what the image says
+    image = makeAppImage("2.0.0");
+    MemoryImage source(image.data(), image.size());
+    FileFlashRegion region(REGION_PATH, REGION_SIZE);
+    FirmwareStore store(region);
+    TEST_ASSERT_EQUAL(StoreResult::OK, store.capture(source, appImageVersion(source)));
+    FirmwareStore reloaded(region);
+    TEST_ASSERT_TRUE(reloaded.load());
+    TEST_ASSERT_EQUAL_HEX32(0x020000, reloaded.info().version);
+}
+
+void test_firmware_store_benchmark() {
+    const size_t imageSize = 480 * 1024;
+    const std::vector<uint8_t> image = makeImage(imageSize, 6);
+    FileFlashRegion region(REGION_PATH, REGION_SIZE);
+    FirmwareStore store(region);
+    MemoryImage source(image.data(), image.size());
+
+    const auto start = std::chrono::steady_clock::now();
+    TEST_ASSERT_EQUAL(StoreResult::OK, store.capture(source, 1));
+    const double captureMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    TEST_ASSERT_TRUE(storeMatches(store, image));
+
+    // One erase per sector touched, plus the record sector
+    const uint32_t sectors = static_cast<uint32_t>((imageSize + FLASH_SECTOR_SIZE - 1) / FLASH_SECTOR_SIZE) + 1;
+    TEST_ASSERT_EQUAL(sectors, store.getStats().sectorsErased);
+
+    char msg[200];
+    snprintf(msg, sizeof(msg), "capture %zu bytes: %.1f ms, %u sectors erased, %u bytes written",
+             imageSize, captureMs, store.getStats().sectorsErased, store.getStats().bytesWritten);
+    TEST_MESSAGE(msg);
+    snprintf(msg, sizeof(msg), "RAM: FirmwareStore %zu bytes for any image size (was a 65536-byte static buffer)",
+             sizeof(FirmwareStore));
+    TEST_MESSAGE(msg);
+    TEST_ASSERT_TRUE(sizeof(FirmwareStore) < 512);
+}
+
+void process() {
+    RUN_TEST(test_capture_survives_reboot);
+    RUN_TEST(test_interrupted_capture_leaves_store_empty);
+    RUN_TEST(test_rejects_wrong_sizes);
+    RUN_TEST(test_flash_failures_and_corruption);
+    RUN_TEST(test_transfers_stream_from_store);
+    RUN_TEST(test_version_comes_from_the_image);
+    RUN_TEST(test_firmware_store_benchmark);
+}
+
+#ifdef UNIT_TEST
+int main(int argc, char **argv) {
+    UNITY_BEGIN();
+    process();
+    return UNITY_END();
+}
+#endif
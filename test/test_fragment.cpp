@@ -0,0 +1,343 @@
+// Tests for message fragmentation: per-profile sizing, reassembly out of order, loss and timeouts, two nodes over MockRadios, and throughput
+#include <unity.h>
+#include "../src/lora/fragment.h"
+#include "lora_test_support.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+using namespace LoRaLink;
+
+// Every fragment payload of one message, in order
+static std::vector<std::vector<uint8_t>> split(uint16_t messageId, uint8_t kind, const std::vector<uint8_t>& message,
+                                               const FragmentPlan& plan) {
+    FragmentSender sender;
+    TEST_ASSERT_TRUE(sender.begin(messageId, kind, message.data(), message.size(), plan));
+    std::vector<std::vector<uint8_t>> fragments;
+    uint8_t payload[MAX_PAYLOAD_SIZE];
+    size_t len;
+    while ((len = sender.next(payload, sizeof(payload))) > 0) {
+        fragments.push_back(std::vector<uint8_t>(payload, payload + len));
+    }
+    TEST_ASSERT_FALSE(sender.isActive());
+    return fragments;
+}
+
+// Total airtime of a message cut into fragments of size bytes and a last one
+static uint32_t messageAirUs(const LoRaModulation& m, size_t length, size_t size) {
+    uint32_t total = 0;
+    for (size_t offset = 0; offset < length; offset += size) {
+        const size_t data = length - offset < size ? length - offset : size;
+        total += timeOnAirUs(m, FRAME_OVERHEAD + FRAGMENT_HEADER_SIZE + data);
+    }
+    return total;
+}
+
+struct Listener : public ILinkListener {
+    std::vector<std::vector<uint8_t>> messages;
+    std::vector<uint16_t> sources;
+    uint8_t lastKind = 0;
+
+    void onMessage(uint16_t nodeId, uint8_t kind, const uint8_t* data, size_t length) override {
+        messages.push_back(std::vector<uint8_t>(data, data + length));
+        sources.push_back(nodeId);
+        lastKind = kind;
+    }
+};
+
+// TestNode handing whole messages to a Listener
+struct Node : TestNode {
+    Listener events;
+
+    Node(uint16_t nodeId, bool sender, LinkLayerConfig config)
+        : TestNode(nodeId, sender, config)
+    {
+        link.setListener(&events);
+    }
+};
+
+void test_fragment_size_per_profile() {
+    // No cap: every fragment fills a frame
+    const LoRaModulation sf9 = modulationFor(9, 125.0f, 5);
+    TEST_ASSERT_EQUAL(MAX_PAYLOAD_SIZE - FRAGMENT_HEADER_SIZE, fragmentDataFor(sf9));
+    TEST_ASSERT_EQUAL(FRAGMENT_MAX_DATA, fragmentDataFor(modulationFor(12, 125.0f, 5)));
+
+    // 400 ms dwell: the largest fragment under the cap, shrinking with the SF
+    const uint32_t dwellUs = 400000;
+    size_t larger = FRAGMENT_MAX_DATA + 1;
+    for (int sf = 7; sf <= 10; sf++) {
+        const LoRaModulation m = modulationFor(sf, 125.0f, 5);
+        const size_t data = fragmentDataFor(m, dwellUs);
+        TEST_ASSERT_TRUE(data > 0);
+        TEST_ASSERT_TRUE(data <= larger);
+        TEST_ASSERT_TRUE(timeOnAirUs(m, FRAME_OVERHEAD + FRAGMENT_HEADER_SIZE + data) <= dwellUs);
+        if (data < FRAGMENT_MAX_DATA) {
+            TEST_ASSERT_TRUE(timeOnAirUs(m, FRAME_OVERHEAD + FRAGMENT_HEADER_SIZE + data + 1) > dwellUs);
+        }
+        larger = data;
+    }
+    TEST_ASSERT_TRUE(fragmentDataFor(modulationFor(10, 125.0f, 5), dwellUs) < FRAGMENT_MAX_DATA);
+    TEST_ASSERT_EQUAL(0, fragmentDataFor(modulationFor(12, 125.0f, 5), dwellUs));
+
+    // The plan never costs more airtime than full fragments plus a runt, or
+    // than an even split, and stays within maxData
+    FragmentPlan plan;
+    const LoRaModulation profiles[] = { sf9, modulationFor(7, 250.0f, 5), modulationFor(10, 125.0f, 5),
+                                        modulationFor(12, 125.0f, 5) };
+    uint32_t savedUs = 0;
+    for (const LoRaModulation& m : profiles) {
+        for (size_t maxData = 60; maxData <= FRAGMENT_MAX_DATA; maxData += 180) {
+            for (size_t length = 1; length <= FRAGMENT_MAX_MESSAGE; length += 13) {
+                TEST_ASSERT_TRUE(planFragments(length, maxData, m, plan));
+                const size_t fewest = (length + maxData - 1) / maxData;
+                const uint32_t greedy = messageAirUs(m, length, maxData);
+                TEST_ASSERT_TRUE(plan.size <= maxData);
+                TEST_ASSERT_TRUE(plan.count == fewest || plan.count == fewest + 1);
+                TEST_ASSERT_EQUAL_UINT32(messageAirUs(m, length, plan.size), plan.airUs);
+                TEST_ASSERT_TRUE(plan.airUs <= greedy);
+                TEST_ASSERT_TRUE(plan.airUs <= messageAirUs(m, length, (length + fewest - 1) / fewest));
+                savedUs += greedy - plan.airUs;
+            }
+        }
+    }
+    TEST_ASSERT_TRUE(savedUs > 0);
+    TEST_ASSERT_FALSE(planFragments(0, 240, sf9, plan));
+    TEST_ASSERT_FALSE(planFragments(FRAGMENT_MAX_MESSAGE + 1, 240, sf9, plan));
+    TEST_ASSERT_FALSE(planFragments(FRAGMENT_MAX_MESSAGE, 8, sf9, plan));      // More than 255 fragments
+    TEST_ASSERT_FALSE(planFragments(100, 0, sf9, plan));
+
+    // Fragment size is read off any fragment; ones that fit no size are refused
+    const std::vector<uint8_t> message = makeImage(481, 1);
+    TEST_ASSERT_TRUE(planFragments(message.size(), FRAGMENT_MAX_DATA, sf9, plan));
+    std::vector<std::vector<uint8_t>> fragments = split(7, 3, message, plan);
+    TEST_ASSERT_EQUAL(plan.count, fragments.size());
+    TEST_ASSERT_EQUAL(FRAGMENT_HEADER_SIZE + plan.size, fragments[0].size());
+    TEST_ASSERT_EQUAL(FRAGMENT_HEADER_SIZE + message.size() - (plan.count - 1) * plan.size, fragments.back().size());
+    FragmentHeader header;
+    const uint8_t* data;
+    size_t dataSize;
+    std::vector<uint8_t>& last = fragments.back();
+    TEST_ASSERT_TRUE(decodeFragment(last.data(), last.size(), header, data, dataSize));
+    TEST_ASSERT_EQUAL(plan.count - 1, header.index);
+    TEST_ASSERT_EQUAL(3, header.kind);
+    TEST_ASSERT_EQUAL(plan.size, fragmentStride(header, dataSize));
+    TEST_ASSERT_FALSE(decodeFragment(fragments[0].data(), 4, header, data, dataSize));
+    FragmentHeader odd = { 7, 3, 2, 3, 481 };
+    TEST_ASSERT_EQUAL(0, fragmentStride(odd, 160));     // 321 left for two fragments
+    TEST_ASSERT_EQUAL(161, fragmentStride(odd, 159));
+    odd.index = 0;
+    TEST_ASSERT_EQUAL(0, fragmentStride(odd, 100));     // Last would be longer than the rest
+    last[4] = 0;        // Count 0
+    TEST_ASSERT_FALSE(decodeFragment(last.data(), last.size(), header, data, dataSize));
+}
+
+void test_reassembly_out_of_order() {
+    FragmentReassembler reassembler;
+    const std::vector<uint8_t> first = makeImage(1500, 2);
+    const std::vector<uint8_t> second = makeImage(700, 3);
+    std::vector<std::vector<uint8_t>> a = split(40, 1, first, FragmentPlan{ 8, 188, 0 });
+    std::vector<std::vector<uint8_t>> b = split(40, 2, second, FragmentPlan{ 3, 240, 0 });
+    TEST_ASSERT_EQUAL(8, a.size());
+    TEST_ASSERT_EQUAL(3, b.size());
+
+    // Same message id from two sources, interleaved, backwards, with duplicates
+    uint32_t now = 1000;
+    std::vector<FragmentResult> results;
+    for (int i = 7; i >= 0; i--) {
+        if (i < 3) {
+            const FragmentResult result = reassembler.onFragment(0x0102, b[2 - i].data(), b[2 - i].size(), now += 50);
+            if (result == FragmentResult::COMPLETE) {
+                TEST_ASSERT_EQUAL(0x0102, reassembler.messageSource());
+                TEST_ASSERT_EQUAL(2, reassembler.messageKind());
+                TEST_ASSERT_EQUAL(second.size(), reassembler.messageLength());
+                TEST_ASSERT_EQUAL_MEMORY(second.data(), reassembler.message(), second.size());
+            }
+            results.push_back(result);
+        }
+        results.push_back(reassembler.onFragment(0x0101, a[i].data(), a[i].size(), now += 50));
+        if (i == 4) {
+            results.push_back(reassembler.onFragment(0x0101, a[6].data(), a[6].size(), now += 50));
+        }
+        TEST_ASSERT_EQUAL(i == 0 ? 0 : (i < 3 ? 2 : 1), reassembler.pending());
+    }
+    TEST_ASSERT_EQUAL(2, std::count(results.begin(), results.end(), FragmentResult::COMPLETE));
+    TEST_ASSERT_EQUAL(FragmentResult::COMPLETE, results.back());
+    TEST_ASSERT_EQUAL(0x0101, reassembler.messageSource());
+    TEST_ASSERT_EQUAL(1, reassembler.messageKind());
+    TEST_ASSERT_EQUAL_MEMORY(first.data(), reassembler.message(), first.size());
+    TEST_ASSERT_EQUAL(0, reassembler.pending());
+
+    // A late duplicate of a finished message is not delivered again
+    TEST_ASSERT_EQUAL(FragmentResult::DUPLICATE, reassembler.onFragment(0x0101, a[3].data(), a[3].size(), now += 50));
+    TEST_ASSERT_EQUAL(nullptr, reassembler.message());
+    const ReassemblyStats& stats = reassembler.getStats();
+    TEST_ASSERT_EQUAL_UINT32(11, stats.fragments);
+    TEST_ASSERT_EQUAL_UINT32(2, stats.duplicates);
+    TEST_ASSERT_EQUAL_UINT32(2, stats.completed);
+    TEST_ASSERT_EQUAL_UINT32(0, stats.invalid);
+}
+
+void test_loss_timeout_and_eviction() {
+    FragmentReassembler reassembler(5000);
+    const std::vector<uint8_t> message = makeImage(1000, 4);
+    std::vector<std::vector<uint8_t>> fragments = split(9, 0, message, FragmentPlan{ 5, 200, 0 });
+
+    // One fragment lost: held until the timeout, then dropped
+    uint32_t now = 0;
+    for (size_t i = 0; i < fragments.size(); i++) {
+        if (i != 2) {
+            TEST_ASSERT_EQUAL(FragmentResult::INCOMPLETE,
+                              reassembler.onFragment(0x0101, fragments[i].data(), fragments[i].size(), now += 100));
+        }
+    }
+    TEST_ASSERT_EQUAL(1, reassembler.pending());
+    TEST_ASSERT_EQUAL(0, reassembler.expire(now + 4999));
+    TEST_ASSERT_EQUAL(1, reassembler.expire(now + 5000));
+    TEST_ASSERT_EQUAL(0, reassembler.pending());
+    TEST_ASSERT_EQUAL_UINT32(1, reassembler.getStats().timedOut);
+
+    // The sender repeating the message inside the timeout fills the gap
+    now += 10000;
+    for (size_t i = 0; i < fragments.size(); i++) {
+        if (i != 2) {
+            reassembler.onFragment(0x0101, fragments[i].data(), fragments[i].size(), now += 100);
+        }
+    }
+    for (size_t i = 0; i < 3; i++) {
+        reassembler.onFragment(0x0101, fragments[i].data(), fragments[i].size(), now += 100);
+    }
+    TEST_ASSERT_EQUAL_UINT32(1, reassembler.getStats().completed);
+    TEST_ASSERT_EQUAL_UINT32(2, reassembler.getStats().duplicates);
+
+    // Every slot busy: the least recently active incomplete message gives way
+    reassembler.clear();
+    reassembler.resetStats();
+    for (uint16_t source = 1; source <= FragmentReassembler::SLOTS + 1; source++) {
+        reassembler.onFragment(source, fragments[0].data(), fragments[0].size(), now += 100);
+    }
+    TEST_ASSERT_EQUAL(FragmentReassembler::SLOTS, reassembler.pending());
+    TEST_ASSERT_EQUAL_UINT32(1, reassembler.getStats().evicted);
+    // Source 1 starts over; source 2 was the oldest left and makes room
+    TEST_ASSERT_EQUAL(FragmentResult::INCOMPLETE,
+                      reassembler.onFragment(1, fragments[1].data(), fragments[1].size(), now += 100));
+    TEST_ASSERT_EQUAL_UINT32(2, reassembler.getStats().evicted);
+    for (size_t i = 1; i < fragments.size(); i++) {
+        reassembler.onFragment(3, fragments[i].data(), fragments[i].size(), now += 100);
+    }
+    TEST_ASSERT_EQUAL(0x0003, reassembler.messageSource());
+    TEST_ASSERT_EQUAL_MEMORY(message.data(), reassembler.message(), message.size());
+
+    // Malformed and oversized fragments
+    uint8_t bogus[FRAGMENT_HEADER_SIZE + 4] = {};
+    TEST_ASSERT_EQUAL(FragmentResult::INVALID, reassembler.onFragment(1, bogus, sizeof(bogus), now));
+    FragmentHeader big = { 1, 0, 0, 9, static_cast<uint16_t>(FRAGMENT_MAX_MESSAGE + 1) };
+    uint8_t payload[MAX_PAYLOAD_SIZE];
+    const size_t len = encodeFragment(big, message.data(), 228, payload, sizeof(payload));
+    TEST_ASSERT_TRUE(len > 0);
+    TEST_ASSERT_EQUAL(FragmentResult::INVALID, reassembler.onFragment(1, payload, len, now));
+    TEST_ASSERT_EQUAL_UINT32(2, reassembler.getStats().invalid);
+}
+
+void test_two_node_message() {
+    g_nowUs = 1000000;
+    LinkLayerConfig config = LinkLayerConfig::defaultConfig();
+    config.pings = false;
+    config.adr = false;
+    LinkLayerConfig capped = config;
+    capped.fragmentMaxAirMs = 400;
+    Node sender(SENDER_ID, true, capped);
+    Node receiver(RECEIVER_ID, false, config);
+    Air air(sender, receiver);
+
+    // The sender's fragments stay under its 400 ms cap on SF9
+    const LoRaModulation sf9 = modulationFor(9, 125.0f, 5);
+    TEST_ASSERT_EQUAL(fragmentDataFor(sf9, 400000), sender.link.fragmentData());
+    TEST_ASSERT_EQUAL(FRAGMENT_MAX_DATA, receiver.link.fragmentData());
+    TEST_ASSERT_TRUE(receiver.link.reassembler().timeoutMs() >= config.reassemblyMinMs);
+
+    const std::vector<uint8_t> track = makeImage(1800, 5);
+    TEST_ASSERT_TRUE(sender.link.sendMessage(0x47, track.data(), track.size()));
+    TEST_ASSERT_FALSE(sender.link.sendMessage(0x47, track.data(), track.size()));
+    air.run(30000);
+    TEST_ASSERT_FALSE(sender.link.isSendingMessage());
+    TEST_ASSERT_TRUE(air.longestUs <= 400000);
+    TEST_ASSERT_EQUAL(1, receiver.events.messages.size());
+    TEST_ASSERT_EQUAL(SENDER_ID, receiver.events.sources[0]);
+    TEST_ASSERT_EQUAL(0x47, receiver.events.lastKind);
+    TEST_ASSERT_TRUE(receiver.events.messages[0] == track);
+    TEST_ASSERT_EQUAL_UINT32(0, receiver.link.getStats().unhandled);
+
+    // Receiver to sender, one fragment lost on air: dropped after the timeout
+    const std::vector<uint8_t> log = makeImage(1000, 6);
+    air.lose = [](int from, uint32_t frame) { return from == 1 && frame == 2; };
+    TEST_ASSERT_TRUE(receiver.link.sendMessage(0x10, log.data(), log.size()));
+    air.run(20000);
+    TEST_ASSERT_EQUAL(0, sender.events.messages.size());
+    TEST_ASSERT_EQUAL(0, sender.link.reassembler().pending());
+    TEST_ASSERT_EQUAL_UINT32(1, sender.link.reassembler().getStats().timedOut);
+
+    // Sent again as a new message, it arrives whole
+    air.lose = nullptr;
+    TEST_ASSERT_TRUE(receiver.link.sendMessage(0x10, log.data(), log.size()));
+    air.run(20000);
+    TEST_ASSERT_EQUAL(1, sender.events.messages.size());
+    TEST_ASSERT_EQUAL(RECEIVER_ID, sender.events.sources[0]);
+    TEST_ASSERT_TRUE(sender.events.messages[0] == log);
+}
+
+void test_fragment_throughput() {
+    // Plan, split and reassemble 2 KB messages from rotating sources in a shuffled order
+    const uint32_t messageCount = 100000;
+    const std::vector<uint8_t> message = makeImage(FRAGMENT_MAX_MESSAGE, 7);
+    const LoRaModulation sf9 = modulationFor(9, 125.0f, 5);
+    FragmentPlan plan;
+    FragmentSender sender;
+    FragmentReassembler reassembler;
+    std::vector<std::vector<uint8_t>> fragments;
+    uint8_t payload[MAX_PAYLOAD_SIZE];
+    uint32_t completed = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < messageCount; i++) {
+        TEST_ASSERT_TRUE(planFragments(message.size(), FRAGMENT_MAX_DATA, sf9, plan));
+        TEST_ASSERT_TRUE(sender.begin(static_cast<uint16_t>(i), 0, message.data(), message.size(), plan));
+        fragments.clear();
+        size_t len;
+        while ((len = sender.next(payload, sizeof(payload))) > 0) {
+            fragments.push_back(std::vector<uint8_t>(payload, payload + len));
+        }
+        std::rotate(fragments.begin(), fragments.begin() + (i % fragments.size()), fragments.end());
+        for (size_t f = 0; f < fragments.size(); f++) {
+            if (reassembler.onFragment(static_cast<uint16_t>(i % 3), fragments[f].data(), fragments[f].size(), i) ==
+                FragmentResult::COMPLETE) {
+                completed++;
+            }
+        }
+    }
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    TEST_ASSERT_EQUAL_UINT32(messageCount, completed);
+    TEST_ASSERT_EQUAL_MEMORY(message.data(), reassembler.message(), message.size());
+    char msg[160];
+    snprintf(msg, sizeof(msg), "Fragmentation: %u x %u-byte messages in %.2f s, %.1f MB/s",
+             messageCount, static_cast<unsigned>(message.size()), seconds,
+             messageCount * message.size() / seconds / 1e6);
+    TEST_MESSAGE(msg);
+}
+
+void process() {
+    RUN_TEST(test_fragment_size_per_profile);
+    RUN_TEST(test_reassembly_out_of_order);
+    RUN_TEST(test_loss_timeout_and_eviction);
+    RUN_TEST(test_two_node_message);
+    RUN_TEST(test_fragment_throughput);
+}
+
+#ifdef UNIT_TEST
+int main(int argc, char **argv) {
+    UNITY_BEGIN();
+    process();
+    return UNITY_END();
+}
+#endif
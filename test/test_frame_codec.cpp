@@ -0,0 +1,187 @@
+// Tests and native benchmark for the binary LoRa frame codec
+#include <unity.h>
+#include "../src/lora/frame_codec.h"
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+
+using namespace LoRaLink;
+
+// Legacy ASCII formats, kept here only for comparison
+static int legacyPing(char* out, size_t size, uint32_t seq) {
+    return snprintf(out, size, "PING seq=%lu", (unsigned long)seq);
+}
+
+static int legacyConfig(char* out, size_t size, const ConfigPayload& c) {
+    return snprintf(out, size, "CFG F=%.1f BW=%.0f SF=%d CR=%d TX=%d",
+                    c.freqMHz, c.bwKHz, c.sf, c.cr, c.txPower);
+}
+
+static const ConfigPayload kConfig = { 915.0f, 125.0f, 9, 5, 17 };
+
+void test_crc16_known_vector() {
+    // CRC-16/CCITT-FALSE check value for "123456789"
+    const uint8_t check[] = { '1', '2', '3', '4', '5', '6', '7', '8', '9' };
+    TEST_ASSERT_EQUAL_HEX16(0x29B1, crc16(check, sizeof(check)));
+}
+
+void test_ping_roundtrip() {
+    uint8_t buf[MAX_FRAME_SIZE];
+    size_t len = encodeFrame(FrameType::PING, 0xBEEF, 4242, nullptr, 0, buf, sizeof(buf));
+    TEST_ASSERT_EQUAL(FRAME_OVERHEAD, len);
+
+    FrameView frame;
+    TEST_ASSERT_EQUAL(DecodeResult::OK, decodeFrame(buf, len, frame));
+    TEST_ASSERT_EQUAL(FrameType::PING, frame.header.type);
+    TEST_ASSERT_EQUAL_UINT16(0xBEEF, frame.header.nodeId);
+    TEST_ASSERT_EQUAL_UINT16(4242, frame.header.sequence);
+    TEST_ASSERT_EQUAL(0, frame.payloadSize);
+}
+
+void test_config_roundtrip() {
+    const float bws[] = { 62.5f, 125.0f, 250.0f, 500.0f };
+    for (float bw : bws) {
+        for (uint8_t sf = 7; sf <= 12; ++sf) {
+            ConfigPayload in = { 868.1f, bw, sf, 8, 22 };
+            uint8_t payload[CONFIG_PAYLOAD_SIZE];
+            TEST_ASSERT_EQUAL(CONFIG_PAYLOAD_SIZE, encodeConfig(in, payload, sizeof(payload)));
+
+            uint8_t buf[MAX_FRAME_SIZE];
+            size_t len = encodeFrame(FrameType::CONFIG, 1, 7, payload, sizeof(payload), buf, sizeof(buf));
+            FrameView frame;
+            ConfigPayload out;
+            TEST_ASSERT_EQUAL(DecodeResult::OK, decodeFrame(buf, len, frame));
+            TEST_ASSERT_TRUE(decodeConfig(frame.payload, frame.payloadSize, out));
+            TEST_ASSERT_FLOAT_WITHIN(0.001f, in.freqMHz, out.freqMHz);
+            TEST_ASSERT_FLOAT_WITHIN(0.01f, in.bwKHz, out.bwKHz);
+            TEST_ASSERT_EQUAL_UINT8(in.sf, out.sf);
+            TEST_ASSERT_EQUAL_UINT8(in.cr, out.cr);
+            TEST_ASSERT_EQUAL_INT8(in.txPower, out.txPower);
+        }
+    }
+
+    // Negative TX power survives the signed byte
+    ConfigPayload low = { 915.0f, 125.0f, 7, 5, -9 };
+    uint8_t payload[CONFIG_PAYLOAD_SIZE];
+    ConfigPayload out;
+    encodeConfig(low, payload, sizeof(payload));
+    TEST_ASSERT_TRUE(decodeConfig(payload, sizeof(payload), out));
+    TEST_ASSERT_EQUAL_INT8(-9, out.txPower);
+}
+
+void test_decode_rejects_corruption() {
+    uint8_t payload[CONFIG_PAYLOAD_SIZE];
+    encodeConfig(kConfig, payload, sizeof(payload));
+    uint8_t buf[MAX_FRAME_SIZE];
+    size_t len = encodeFrame(FrameType::CONFIG, 1, 1, payload, sizeof(payload), buf, sizeof(buf));
+
+    FrameView frame;
+    TEST_ASSERT_EQUAL(DecodeResult::TOO_SHORT, decodeFrame(buf, FRAME_OVERHEAD - 1, frame));
+    TEST_ASSERT_EQUAL(DecodeResult::TOO_SHORT, decodeFrame(nullptr, len, frame));
+
+    // Every single-bit flip must be caught
+    for (size_t i = 1; i < len; ++i) {
+        for (int bit = 0; bit < 8; ++bit) {
+            buf[i] ^= (1 << bit);
+            TEST_ASSERT_EQUAL(DecodeResult::BAD_CRC, decodeFrame(buf, len, frame));
+            buf[i] ^= (1 << bit);
+        }
+    }
+
+    buf[0] = WIRE_VERSION + 1;
+    TEST_ASSERT_EQUAL(DecodeResult::BAD_VERSION, decodeFrame(buf, len, frame));
+
+    // Legacy ASCII frames are not mistaken for binary ones
+    char legacy[64];
+    int legacyLen = legacyConfig(legacy, sizeof(legacy), kConfig);
+    TEST_ASSERT_NOT_EQUAL(DecodeResult::OK,
+                          decodeFrame(reinterpret_cast<const uint8_t*>(legacy), legacyLen, frame));
+}
+
+void test_encode_rejects_bad_arguments() {
+    uint8_t buf[MAX_FRAME_SIZE];
+    uint8_t big[MAX_PAYLOAD_SIZE + 1] = {};
+    TEST_ASSERT_EQUAL(0, encodeFrame(FrameType::OTA_DATA, 1, 1, big, sizeof(big), buf, sizeof(buf)));
+    TEST_ASSERT_EQUAL(MAX_FRAME_SIZE,
+                      encodeFrame(FrameType::OTA_DATA, 1, 1, big, MAX_PAYLOAD_SIZE, buf, sizeof(buf)));
+    TEST_ASSERT_EQUAL(0, encodeFrame(FrameType::PING, 1, 1, nullptr, 0, buf, FRAME_OVERHEAD - 1));
+    TEST_ASSERT_EQUAL(0, encodeFrame(FrameType::PING, 1, 1, nullptr, 4, buf, sizeof(buf)));
+    TEST_ASSERT_EQUAL(0, encodeConfig(kConfig, buf, CONFIG_PAYLOAD_SIZE - 1));
+}
+
+// Bytes on air: binary frames must be strictly smaller than the ASCII ones
+void test_benchmark_bytes_on_air() {
+    char legacy[64];
+    uint8_t buf[MAX_FRAME_SIZE];
+    uint8_t payload[CONFIG_PAYLOAD_SIZE];
+
+    int asciiPing = legacyPing(legacy, sizeof(legacy), 123456);
+    int asciiCfg = legacyConfig(legacy, sizeof(legacy), kConfig);
+    size_t binPing = encodeFrame(FrameType::PING, 1, 57920, nullptr, 0, buf, sizeof(buf));
+    encodeConfig(kConfig, payload, sizeof(payload));
+    size_t binCfg = encodeFrame(FrameType::CONFIG, 1, 2, payload, sizeof(payload), buf, sizeof(buf));
+
+    char msg[128];
+    snprintf(msg, sizeof(msg), "PING bytes: ascii=%d binary=%u | CFG bytes: ascii=%d binary=%u",
+             asciiPing, (unsigned)binPing, asciiCfg, (unsigned)binCfg);
+    TEST_MESSAGE(msg);
+
+    TEST_ASSERT_LESS_THAN((size_t)asciiPing, binPing);
+    TEST_ASSERT_LESS_THAN((size_t)asciiCfg / 2, binCfg);
+}
+
+// Encode/decode cost compared with snprintf/sscanf
+void test_benchmark_codec_cost() {
+    const int iterations = 200000;
+    char legacy[64];
+    uint8_t buf[MAX_FRAME_SIZE];
+    uint8_t payload[CONFIG_PAYLOAD_SIZE];
+    volatile uint32_t sink = 0;
+
+    auto t0 = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; ++i) {
+        int n = legacyConfig(legacy, sizeof(legacy), kConfig);
+        float f, b; int sf, cr, tx;
+        sink += n + sscanf(legacy, "CFG F=%f BW=%f SF=%d CR=%d TX=%d", &f, &b, &sf, &cr, &tx);
+    }
+    auto t1 = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; ++i) {
+        size_t plen = encodeConfig(kConfig, payload, sizeof(payload));
+        size_t len = encodeFrame(FrameType::CONFIG, 1, static_cast<uint16_t>(i), payload, plen, buf, sizeof(buf));
+        FrameView frame;
+        ConfigPayload out;
+        if (decodeFrame(buf, len, frame) == DecodeResult::OK &&
+            decodeConfig(frame.payload, frame.payloadSize, out)) {
+            sink += out.sf;
+        }
+    }
+    auto t2 = std::chrono::steady_clock::now();
+
+    double asciiNs = std::chrono::duration<double, std::nano>(t1 - t0).count() / iterations;
+    double binaryNs = std::chrono::duration<double, std::nano>(t2 - t1).count() / iterations;
+    char msg[128];
+    snprintf(msg, sizeof(msg), "CFG encode+decode: ascii=%.0f ns binary=%.0f ns (%.1fx)",
+             asciiNs, binaryNs, asciiNs / binaryNs);
+    TEST_MESSAGE(msg);
+
+    TEST_ASSERT_TRUE(sink > 0);
+    TEST_ASSERT_TRUE(binaryNs < asciiNs);
+}
+
+void process() {
+    RUN_TEST(test_crc16_known_vector);
+    RUN_TEST(test_ping_roundtrip);
+    RUN_TEST(test_config_roundtrip);
+    RUN_TEST(test_decode_rejects_corruption);
+    RUN_TEST(test_encode_rejects_bad_arguments);
+    RUN_TEST(test_benchmark_bytes_on_air);
+    RUN_TEST(test_benchmark_codec_cost);
+}
+
+#ifdef UNIT_TEST
+int main(int argc, char **argv) {
+    UNITY_BEGIN();
+    process();
+    return UNITY_END();
+}
+#endif
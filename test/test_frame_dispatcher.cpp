@@ -0,0 +1,168 @@
+// Tests and native benchmark for the table-driven frame dispatcher
+#include <unity.h>
+#include "../src/lora/frame_dispatcher.h"
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+
+using namespace LoRaLink;
+
+static int g_calls[FrameDispatcher::TABLE_SIZE];
+static void* g_lastContext = nullptr;
+
+static void countingHandler(const FrameView& frame, const RxFrame&, void* context) {
+    g_calls[static_cast<uint8_t>(frame.header.type)]++;
+    g_lastContext = context;
+}
+
+static int g_fallbackCalls = 0;
+static void fallbackHandler(const FrameView&, const RxFrame&, void*) {
+    g_fallbackCalls++;
+}
+
+static void resetCounters() {
+    memset(g_calls, 0, sizeof(g_calls));
+    g_lastContext = nullptr;
+    g_fallbackCalls = 0;
+}
+
+static FrameView decoded(FrameType type, RxFrame& rx) {
+    rx.length = encodeFrame(type, 0x0001, 1, nullptr, 0, rx.data, sizeof(rx.data));
+    FrameView view;
+    TEST_ASSERT_EQUAL(DecodeResult::OK, decodeFrame(rx.data, rx.length, view));
+    return view;
+}
+
+void test_dispatch_routes_by_type_with_context() {
+    resetCounters();
+    FrameDispatcher dispatcher;
+    int cookie = 0;
+    dispatcher.on(FrameType::CONFIG, countingHandler, &cookie);
+    dispatcher.on(FrameType::PING, countingHandler);
+
+    RxFrame rx;
+    TEST_ASSERT_TRUE(dispatcher.dispatch(decoded(FrameType::CONFIG, rx), rx));
+    TEST_ASSERT_EQUAL(1, g_calls[static_cast<uint8_t>(FrameType::CONFIG)]);
+    TEST_ASSERT_EQUAL_PTR(&cookie, g_lastContext);
+
+    TEST_ASSERT_TRUE(dispatcher.dispatch(decoded(FrameType::PING, rx), rx));
+    TEST_ASSERT_EQUAL(1, g_calls[static_cast<uint8_t>(FrameType::PING)]);
+    TEST_ASSERT_EQUAL(2, dispatcher.getStats().dispatched);
+    TEST_ASSERT_EQUAL(2, dispatcher.registeredCount());
+}
+
+void test_unregistered_types_use_fallback_or_are_counted() {
+    resetCounters();
+    FrameDispatcher dispatcher;
+    RxFrame rx;
+
+    TEST_ASSERT_FALSE(dispatcher.dispatch(decoded(FrameType::OTA_END, rx), rx));
+    TEST_ASSERT_EQUAL(1, dispatcher.getStats().unhandled);
+
+    dispatcher.setFallback(fallbackHandler);
+    TEST_ASSERT_TRUE(dispatcher.dispatch(decoded(FrameType::OTA_END, rx), rx));
+    TEST_ASSERT_EQUAL(1, g_fallbackCalls);
+    TEST_ASSERT_EQUAL(1, dispatcher.getStats().fallback);
+
+    // A type byte this firmware has never heard of is routed the same way
+    FrameView unknown = decoded(FrameType::PING, rx);
+    unknown.header.type = static_cast<FrameType>(0xEE);
+    TEST_ASSERT_TRUE(dispatcher.dispatch(unknown, rx));
+    TEST_ASSERT_EQUAL(2, g_fallbackCalls);
+}
+
+void test_role_reregistration_replaces_table() {
+    resetCounters();
+    FrameDispatcher dispatcher;
+    dispatcher.on(FrameType::REQUEST_UPDATE, countingHandler);
+    TEST_ASSERT_TRUE(dispatcher.has(FrameType::REQUEST_UPDATE));
+
+    // Switch role: start from an empty table
+    dispatcher.clear();
+    dispatcher.on(FrameType::UPDATE_NOW, countingHandler);
+    TEST_ASSERT_FALSE(dispatcher.has(FrameType::REQUEST_UPDATE));
+    TEST_ASSERT_TRUE(dispatcher.has(FrameType::UPDATE_NOW));
+
+    RxFrame rx;
+    TEST_ASSERT_FALSE(dispatcher.dispatch(decoded(FrameType::REQUEST_UPDATE, rx), rx));
+    dispatcher.off(FrameType::UPDATE_NOW);
+    TEST_ASSERT_EQUAL(0, dispatcher.registeredCount());
+}
+
+// Legacy classifier: the startsWith() chain the receiver used on ASCII packets
+static volatile int g_sink = 0;
+
+static bool startsWith(const char* s, const char* prefix) {
+    return strncmp(s, prefix, strlen(prefix)) == 0;
+}
+
+static void legacyClassify(const char* rx) {
+    if (startsWith(rx, "CFG ")) {
+        g_sink = g_sink + 1;
+    } else if (startsWith(rx, "OTA_")) {
+        g_sink = g_sink + 2;
+    } else if (startsWith(rx, "FW_UPDATE_AVAILABLE") || startsWith(rx, "UPDATE_NOW")) {
+        g_sink = g_sink + 3;
+    } else if (startsWith(rx, "REQUEST_UPDATE")) {
+        g_sink = g_sink + 4;
+    } else if (startsWith(rx, "PING ")) {
+        g_sink = g_sink + 5;
+    } else {
+        g_sink = g_sink + 6;
+    }
+}
+
+static void sinkHandler(const FrameView& frame, const RxFrame&, void*) {
+    g_sink = g_sink + static_cast<uint8_t>(frame.header.type);
+}
+
+void test_benchmark_dispatch_cost() {
+    const int ITERATIONS = 200000;
+    // PING is the common case and sits at the end of the legacy chain
+    const char* legacyPackets[] = { "PING seq=42", "OTA_DATA:3:abcd", "CFG F=915.0 BW=125 SF=9 CR=5 TX=17" };
+    const FrameType types[] = { FrameType::PING, FrameType::OTA_DATA, FrameType::CONFIG };
+
+    FrameDispatcher dispatcher;
+    for (FrameType t : types) {
+        dispatcher.on(t, sinkHandler);
+    }
+    RxFrame rx;
+    FrameView views[3];
+    for (int i = 0; i < 3; ++i) {
+        views[i] = decoded(types[i], rx);
+    }
+
+    auto t0 = std::chrono::steady_clock::now();
+    for (int i = 0; i < ITERATIONS; ++i) {
+        legacyClassify(legacyPackets[i % 3]);
+    }
+    auto t1 = std::chrono::steady_clock::now();
+    for (int i = 0; i < ITERATIONS; ++i) {
+        dispatcher.dispatch(views[i % 3], rx);
+    }
+    auto t2 = std::chrono::steady_clock::now();
+
+    const double legacyNs = std::chrono::duration<double, std::nano>(t1 - t0).count() / ITERATIONS;
+    const double tableNs = std::chrono::duration<double, std::nano>(t2 - t1).count() / ITERATIONS;
+    char msg[128];
+    snprintf(msg, sizeof(msg), "Dispatch per frame: startsWith chain=%.1f ns | table=%.1f ns (%.1fx)",
+             legacyNs, tableNs, tableNs > 0 ? legacyNs / tableNs : 0.0);
+    TEST_MESSAGE(msg);
+
+    TEST_ASSERT_EQUAL(ITERATIONS, dispatcher.getStats().dispatched);
+}
+
+void process() {
+    RUN_TEST(test_dispatch_routes_by_type_with_context);
+    RUN_TEST(test_unregistered_types_use_fallback_or_are_counted);
+    RUN_TEST(test_role_reregistration_replaces_table);
+    RUN_TEST(test_benchmark_dispatch_cost);
+}
+
+#ifdef UNIT_TEST
+int main(int argc, char **argv) {
+    UNITY_BEGIN();
+    process();
+    return UNITY_END();
+}
+#endif
@@ -0,0 +1,245 @@
+// Tests for the fixed receive buffer pool and the heap fragmentation counters
+#include <unity.h>
+#include "../src/lora/frame_pool.h"
+#include "../src/lora/rx_engine.h"
+#include "../src/lora/mock_radio.h"
+#include "../src/lora/heap_monitor.h"
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <string>
+
+using namespace LoRaLink;
+
+// Count every heap allocation made by this test binary
+static size_t g_allocations = 0;
+
+void* operator new(size_t size) {
+    g_allocations++;
+    void* p = malloc(size ? size : 1);
+    if (p == nullptr) {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+void operator delete(void* p) noexcept {
+    free(p);
+}
+
+void operator delete(void* p, size_t) noexcept {
+    free(p);
+}
+
+static size_t makeFrame(uint16_t seq, uint8_t* out) {
+    return encodeFrame(FrameType::PING, 0x0001, seq, nullptr, 0, out, MAX_FRAME_SIZE);
+}
+
+void test_pool_acquire_release_and_exhaustion() {
+    FramePool pool;
+    RxFrame* held[FramePool::CAPACITY];
+    for (size_t i = 0; i < FramePool::CAPACITY; ++i) {
+        held[i] = pool.acquire();
+        TEST_ASSERT_NOT_NULL(held[i]);
+        TEST_ASSERT_TRUE(pool.owns(held[i]));
+    }
+    TEST_ASSERT_NULL(pool.acquire());
+    TEST_ASSERT_EQUAL(1, pool.getStats().exhausted);
+    TEST_ASSERT_EQUAL(FramePool::CAPACITY, pool.getStats().highWater);
+
+    // Foreign pointers never enter the free list
+    RxFrame outside;
+    pool.release(&outside);
+    pool.release(nullptr);
+    TEST_ASSERT_EQUAL(0, pool.available());
+
+    pool.release(held[3]);
+    TEST_ASSERT_EQUAL(1, pool.available());
+    TEST_ASSERT_EQUAL_PTR(held[3], pool.acquire());
+}
+
+void test_pool_double_release_is_ignored() {
+    FramePool pool;
+    RxFrame* a = pool.acquire();
+    RxFrame* b = pool.acquire();
+    RxFrame* c = pool.acquire();
+
+    // Released twice while others are still out: the buffer is free once
+    pool.release(b);
+    pool.release(b);
+    TEST_ASSERT_EQUAL(FramePool::CAPACITY - 2, pool.available());
+    TEST_ASSERT_EQUAL(1, pool.getStats().released);
+    TEST_ASSERT_EQUAL(1, pool.getStats().doubleReleases);
+
+    // Every buffer handed out from here on is distinct
+    RxFrame* held[FramePool::CAPACITY];
+    size_t count = 0;
+    RxFrame* frame;
+    while ((frame = pool.acquire()) != nullptr) {
+        TEST_ASSERT_TRUE(frame != a && frame != c);
+        for (size_t i = 0; i < count; ++i) {
+            TEST_ASSERT_TRUE(held[i] != frame);
+        }
+        held[count++] = frame;
+    }
+    TEST_ASSERT_EQUAL(FramePool::CAPACITY - 2, count);
+
+    // A buffer released, reacquired and released again is a normal cycle
+    pool.release(a);
+    TEST_ASSERT_EQUAL_PTR(a, pool.acquire());
+    pool.release(a);
+    TEST_ASSERT_EQUAL(1, pool.getStats().doubleReleases);
+}
+
+void test_engine_hands_out_the_buffer_the_radio_read_into() {
+    MockRadio radio;
+    FramePool pool;
+    RxEngine engine(radio, pool);
+    radio.setDio1Handler([&](uint32_t ts) { engine.onDio1(ts); });
+    engine.begin();
+
+    uint8_t buf[MAX_FRAME_SIZE];
+    size_t len = makeFrame(77, buf);
+    radio.deliver(buf, len, 1234);
+    TEST_ASSERT_EQUAL(1, engine.poll());
+    TEST_ASSERT_EQUAL(1, pool.inUse());
+
+    RxFrame* frame = engine.pop();
+    TEST_ASSERT_NOT_NULL(frame);
+    TEST_ASSERT_TRUE(pool.owns(frame));
+    TEST_ASSERT_EQUAL(len, frame->length);
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(buf, frame->data, len);
+    TEST_ASSERT_EQUAL_UINT32(1234, frame->timestampUs);
+
+    engine.release(frame);
+    TEST_ASSERT_EQUAL(0, pool.inUse());
+    TEST_ASSERT_NULL(engine.pop());
+}
+
+void test_exhausted_pool_drops_and_read_errors_return_buffers() {
+    MockRadio radio;
+    FramePool pool;
+    RxEngine engine(radio, pool);
+    radio.setDio1Handler([&](uint32_t ts) { engine.onDio1(ts); });
+    engine.begin();
+
+    // Handlers elsewhere hold all but one buffer
+    RxFrame* borrowed[FramePool::CAPACITY - 1];
+    for (size_t i = 0; i < FramePool::CAPACITY - 1; ++i) {
+        borrowed[i] = pool.acquire();
+    }
+
+    uint8_t buf[MAX_FRAME_SIZE];
+    radio.deliver(buf, makeFrame(1, buf), 10, -80.0f, 5.0f, true);
+    TEST_ASSERT_EQUAL(0, engine.poll());
+    TEST_ASSERT_EQUAL(1, engine.getStats().readErrors);
+    TEST_ASSERT_EQUAL(1, pool.available());
+
+    radio.deliver(buf, makeFrame(2, buf), 20);
+    TEST_ASSERT_EQUAL(1, engine.poll());
+    radio.deliver(buf, makeFrame(3, buf), 30);
+    TEST_ASSERT_EQUAL(0, engine.poll());
+    TEST_ASSERT_EQUAL(1, engine.getStats().queueDrops);
+    TEST_ASSERT_FALSE(radio.hasUnreadPacket());
+
+    // begin() hands queued buffers back
+    engine.begin();
+    TEST_ASSERT_EQUAL(1, pool.available());
+    for (size_t i = 0; i < FramePool::CAPACITY - 1; ++i) {
+        pool.release(borrowed[i]);
+    }
+    TEST_ASSERT_EQUAL(FramePool::CAPACITY, pool.available());
+}
+
+void test_heap_monitor_fragmentation_counters() {
+    HeapMonitor monitor;
+    HeapSnapshot s = monitor.record(200000, 180000, 100000);
+    TEST_ASSERT_EQUAL(50, s.fragmentationPct);
+    TEST_ASSERT_EQUAL(100000, monitor.getStats().baselineMaxAlloc);
+
+    monitor.record(200000, 180000, 100000);
+    TEST_ASSERT_EQUAL(0, monitor.getStats().largestBlockDrops);
+
+    s = monitor.record(190000, 170000, 38000);
+    TEST_ASSERT_EQUAL(80, s.fragmentationPct);
+    TEST_ASSERT_EQUAL(1, monitor.getStats().largestBlockDrops);
+    TEST_ASSERT_EQUAL(38000, monitor.getStats().lowestMaxAlloc);
+    TEST_ASSERT_EQUAL(80, monitor.getStats().worstFragmentationPct);
+    TEST_ASSERT_EQUAL(3, monitor.getStats().samples);
+
+    // sample() reads HardwareAbstraction::Memory
+    monitor.reset();
+    s = monitor.sample();
+    TEST_ASSERT_EQUAL(1, monitor.getStats().samples);
+    TEST_ASSERT_TRUE(s.maxAllocHeap <= s.freeHeap);
+}
+
+// Sustained traffic through the receive path: the legacy loop built a
+// String per packet (modelled with std::string), the pool path allocates nothing.
+void test_benchmark_hot_path_allocations() {
+    const int FRAMES = 20000;
+    MockRadio radio;
+    FramePool pool;
+    RxEngine engine(radio, pool);
+    radio.setDio1Handler([&](uint32_t ts) { engine.onDio1(ts); });
+    engine.begin();
+
+    uint8_t payload[120] = {};
+    uint8_t buf[MAX_FRAME_SIZE];
+    const size_t len = encodeFrame(FrameType::OTA_DATA, 0x0001, 1, payload, sizeof(payload), buf, sizeof(buf));
+    volatile size_t sink = 0;
+
+    size_t before = g_allocations;
+    for (int i = 0; i < FRAMES; ++i) {
+        std::string packet(reinterpret_cast<const char*>(buf), len);
+        if (packet.compare(0, 3, "CFG") == 0) {
+            sink = sink + 1;
+        }
+        std::string copy = packet.c_str();
+        sink = sink + copy.size();
+    }
+    const size_t legacyAllocs = g_allocations - before;
+
+    before = g_allocations;
+    for (int i = 0; i < FRAMES; ++i) {
+        radio.deliver(buf, len, static_cast<uint32_t>(i));
+        engine.poll();
+        RxFrame* frame;
+        while ((frame = engine.pop()) != nullptr) {
+            FrameView view;
+            if (decodeFrame(frame->data, frame->length, view) == DecodeResult::OK) {
+                sink = sink + view.payloadSize;
+            }
+            engine.release(frame);
+        }
+    }
+    const size_t poolAllocs = g_allocations - before;
+
+    char msg[160];
+    snprintf(msg, sizeof(msg),
+             "%d frames: String-per-packet heap allocs=%u | pool path heap allocs=%u (pool highWater=%u)",
+             FRAMES, (unsigned)legacyAllocs, (unsigned)poolAllocs, (unsigned)pool.getStats().highWater);
+    TEST_MESSAGE(msg);
+
+    TEST_ASSERT_EQUAL(0, poolAllocs);
+    TEST_ASSERT_GREATER_THAN(0, legacyAllocs);
+    TEST_ASSERT_EQUAL(FRAMES, engine.getStats().received);
+    TEST_ASSERT_EQUAL(0, pool.inUse());
+}
+
+void process() {
+    RUN_TEST(test_pool_acquire_release_and_exhaustion);
+    RUN_TEST(test_pool_double_release_is_ignored);
+    RUN_TEST(test_engine_hands_out_the_buffer_the_radio_read_into);
+    RUN_TEST(test_exhausted_pool_drops_and_read_errors_return_buffers);
+    RUN_TEST(test_heap_monitor_fragmentation_counters);
+    RUN_TEST(test_benchmark_hot_path_allocations);
+}
+
+#ifdef UNIT_TEST
+int main(int argc, char **argv) {
+    UNITY_BEGIN();
+    process();
+    return UNITY_END();
+}
+#endif
@@ -378,6 +378,32 @@ void test_power_sleep_not_initialized() {
     TEST_ASSERT_EQUAL(Result::SUCCESS, Power::wakeup()); // Always succeeds
 }
 
+void test_power_wakeup_pin() {
+    TEST_ASSERT_EQUAL(Result::SUCCESS, Power::setWakeupPin(14, GPIO::Level::LEVEL_HIGH));
+    TEST_ASSERT_EQUAL(Result::SUCCESS, Power::setWakeupPin(0, GPIO::Level::LEVEL_LOW));
+    TEST_ASSERT_EQUAL(Result::ERROR_INVALID_PARAMETER, Power::setWakeupPin(60, GPIO::Level::LEVEL_HIGH));
+
+    // Armed only inside sleep(LIGHT_SLEEP), so the pins keep their edge ISRs
+    TEST_ASSERT_FALSE(Power::isWakeupArmed(14));
+    TEST_ASSERT_EQUAL(Result::SUCCESS, Power::sleep(Power::Mode::LIGHT_SLEEP, 1));
+    TEST_ASSERT_FALSE(Power::isWakeupArmed(14));
+    TEST_ASSERT_FALSE(Power::isWakeupArmed(0));
+
+    // Re-registering a pin replaces it; the table holds four
+    TEST_ASSERT_EQUAL(Result::SUCCESS, Power::setWakeupPin(14, GPIO::Level::LEVEL_HIGH, 1));
+    TEST_ASSERT_EQUAL(Result::SUCCESS, Power::setWakeupPin(1, GPIO::Level::LEVEL_LOW));
+    TEST_ASSERT_EQUAL(Result::SUCCESS, Power::setWakeupPin(2, GPIO::Level::LEVEL_LOW));
+    TEST_ASSERT_EQUAL(Result::ERROR_INVALID_PARAMETER, Power::setWakeupPin(3, GPIO::Level::LEVEL_LOW));
+
+    deinitialize();
+    TEST_ASSERT_EQUAL(Result::ERROR_NOT_INITIALIZED, Power::setWakeupPin(14, GPIO::Level::LEVEL_HIGH));
+}
+
+void test_power_wake_cause() {
+    // Native builds never sleep
+    TEST_ASSERT_EQUAL(Power::WakeCause::POWER_ON, Power::getWakeCause());
+}
+
 void test_power_battery() {
     float voltage = Power::getBatteryVoltage();
     TEST_ASSERT_GREATER_OR_EQUAL(0.0f, voltage);
@@ -529,6 +555,8 @@ void process() {
     RUN_TEST(test_power_vext_control_not_initialized);
     RUN_TEST(test_power_sleep);
     RUN_TEST(test_power_sleep_not_initialized);
+    RUN_TEST(test_power_wakeup_pin);
+    RUN_TEST(test_power_wake_cause);
     RUN_TEST(test_power_battery);
 
     // Memory management tests
@@ -0,0 +1,391 @@
+// Tests for the link layer: receive path, two-node config commit, update request and OTA over MockRadios,
+// light sleep with DIO1 held high, and frame throughput
+#include <unity.h>
+#include "../src/lora/ota_arq.h"
+#include "../src/hardware/hardware_abstraction.h"
+#include "lora_test_support.h"
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+using namespace LoRaLink;
+
+struct Recorder : public ILinkListener {
+    std::vector<FrameType> frames;
+    uint32_t unhandled = 0;
+    uint32_t dropped = 0;
+    uint32_t readErrors = 0;
+    std::vector<ProfileSource> profileChanges;
+    std::vector<OtaEvent> otaEvents;
+    OtaResult lastOtaResult = OtaResult::OK;
+
+    void onFrame(const FrameView& frame, const RxFrame&, bool handled) override {
+        frames.push_back(frame.header.type);
+        unhandled += handled ? 0 : 1;
+    }
+    void onDropped(DecodeResult, size_t) override { dropped++; }
+    void onReadError() override { readErrors++; }
+    void onProfileChanged(const ConfigPayload&, ProfileSource source, int status) override {
+        TEST_ASSERT_EQUAL(RadioStatus::OK, status);
+        profileChanges.push_back(source);
+    }
+    void onOta(OtaEvent event, OtaResult result) override {
+        otaEvents.push_back(event);
+        lastOtaResult = result;
+    }
+};
+
+// TestNode reporting to a Recorder
+struct Node : TestNode {
+    Recorder events;
+
+    Node(uint16_t nodeId, bool sender, LinkLayerConfig config = LinkLayerConfig::defaultConfig())
+        : TestNode(nodeId, sender, config)
+    {
+        link.setListener(&events);
+    }
+};
+
+void test_receive_path() {
+    g_nowUs = 1000000;
+    LinkLayerConfig config = LinkLayerConfig::defaultConfig();
+    config.adr = false;
+    Node receiver(RECEIVER_ID, false, config);
+
+    // PINGs from two senders; 0x0102 skips two
+    for (uint16_t seq = 0; seq < 6; seq++) {
+        g_nowUs += 320000;
+        TEST_ASSERT_TRUE(receiver.hear(FrameType::PING, 0x0101, seq, nullptr, 0, -70.0f));
+        if (seq != 2 && seq != 3) {
+            TEST_ASSERT_TRUE(receiver.hear(FrameType::PING, 0x0102, seq, nullptr, 0, -100.0f));
+        }
+    }
+    TEST_ASSERT_EQUAL(2, receiver.link.linkTable().size());
+    TEST_ASSERT_EQUAL_UINT32(6, receiver.link.linkTable().find(0x0101)->frames);
+    TEST_ASSERT_EQUAL_UINT32(0, receiver.link.linkTable().find(0x0101)->missed);
+    TEST_ASSERT_EQUAL_UINT32(2, receiver.link.linkTable().find(0x0102)->missed);
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, -100.0f, receiver.link.lastRssi());
+
+    // Corrupt frames never reach dispatch
+    uint8_t garbage[8] = { 0xFF, 1, 2, 3, 4, 5, 6, 7 };
+    receiver.radio.deliver(garbage, sizeof(garbage), g_nowUs);
+    receiver.link.poll();
+    receiver.radio.deliver(garbage, sizeof(garbage), g_nowUs, -80.0f, 8.0f, true);
+    receiver.link.poll();
+    TEST_ASSERT_EQUAL_UINT32(1, receiver.events.dropped);
+    TEST_ASSERT_EQUAL_UINT32(1, receiver.events.readErrors);
+    TEST_ASSERT_EQUAL_UINT32(1, receiver.link.getStats().readErrors);
+
+    // A sender's frame type the receiver role has no handler for
+    receiver.hear(FrameType::TDMA_BEACON, 0x0101, 40);
+    TEST_ASSERT_EQUAL_UINT32(1, receiver.events.unhandled);
+
+    // REQUEST_UPDATE is answered once; the deliberate repeat is filtered
+    const uint32_t dispatched = static_cast<uint32_t>(receiver.events.frames.size());
+    TEST_ASSERT_TRUE(receiver.hear(FrameType::REQUEST_UPDATE, 0x0101, 41));
+    TEST_ASSERT_EQUAL(FrameType::UPDATE_ACK, receiver.finishTransmit());
+    TEST_ASSERT_EQUAL(FrameType::NO_FIRMWARE, receiver.finishTransmit());
+    TEST_ASSERT_TRUE(receiver.hear(FrameType::REQUEST_UPDATE, 0x0101, 41));
+    TEST_ASSERT_EQUAL(RadioMode::RECEIVE, receiver.radio.getMode());
+    TEST_ASSERT_EQUAL_UINT32(dispatched + 1, receiver.events.frames.size());
+    TEST_ASSERT_EQUAL_UINT32(1, receiver.link.getStats().repeats);
+    TEST_ASSERT_EQUAL_UINT32(13, receiver.link.getStats().frames);
+}
+
+void test_two_node_config_commit() {
+    g_nowUs = 1000000;
+    LinkLayerConfig config = LinkLayerConfig::defaultConfig();
+    config.adr = false;
+    Node sender(SENDER_ID, true, config);
+    Node receiver(RECEIVER_ID, false, config);
+    Air air(sender, receiver);
+
+    // The update notice goes out, the sender asks and hears there is nothing;
+    // the coordinator learns the receiver from it
+    TEST_ASSERT_TRUE(receiver.link.queueFrame(FrameType::FW_UPDATE_AVAILABLE, receiver.link.nextSequence(), TX_HIGH));
+    air.run(3000);
+    TEST_ASSERT_EQUAL(1, sender.link.coordinator().rosterSize(clockMs()));
+    TEST_ASSERT_TRUE(sender.link.getStats().pings > 0);
+    TEST_ASSERT_EQUAL_UINT32(sender.link.getStats().pings, receiver.link.linkTable().find(SENDER_ID)->frames);
+
+    TEST_ASSERT_TRUE(sender.link.startConfigChange(SF7_250));
+    TEST_ASSERT_FALSE(sender.link.startConfigChange(SF7_250));
+    air.run(10000);
+
+    TEST_ASSERT_EQUAL(7, sender.radio.profile().sf);
+    TEST_ASSERT_EQUAL(7, receiver.radio.profile().sf);
+    TEST_ASSERT_EQUAL_FLOAT(250.0f, receiver.link.profile().bwKHz);
+    TEST_ASSERT_EQUAL(1, sender.events.profileChanges.size());
+    TEST_ASSERT_EQUAL(ProfileSource::COMMIT, sender.events.profileChanges[0]);
+    TEST_ASSERT_EQUAL(1, receiver.events.profileChanges.size());
+    TEST_ASSERT_EQUAL(ProfileSource::PARTICIPANT, receiver.events.profileChanges[0]);
+    TEST_ASSERT_FALSE(sender.link.coordinator().isActive());
+
+    // PINGs carry on over the new profile
+    const uint32_t heard = receiver.link.linkTable().find(SENDER_ID)->frames;
+    air.run(3200);
+    TEST_ASSERT_TRUE(receiver.link.linkTable().find(SENDER_ID)->frames > heard);
+    TEST_ASSERT_EQUAL_UINT32(0, receiver.link.getStats().dropped);
+}
+
+void test_ota_out_of_order() {
+    g_nowUs = 1000000;
+    LinkLayerConfig config = LinkLayerConfig::defaultConfig();
+    config.pings = false;
+    Node sender(SENDER_ID, true, config);
+
+    const std::vector<uint8_t> image = makeImage(20 * CHUNK + 77, 11);
+    const uint16_t chunks = static_cast<uint16_t>((image.size() + CHUNK - 1) / CHUNK);
+    const OtaStartInfo info = startFor(image);
+
+    uint16_t seq = 0;
+    uint8_t payload[MAX_PAYLOAD_SIZE];
+    auto sendChunk = [&](uint16_t index) {
+        const size_t offset = static_cast<size_t>(index) * CHUNK;
+        const size_t len = image.size() - offset < CHUNK ? image.size() - offset : CHUNK;
+        Wire::putU16(payload, index);
+        memcpy(payload + OTA_CHUNK_HEADER_SIZE, image.data() + offset, len);
+        g_nowUs += 100000;
+        sender.hear(FrameType::OTA_DATA, RECEIVER_ID, seq++, payload, OTA_CHUNK_HEADER_SIZE + len);
+    };
+
+    // START is answered with a NACK; a repeat of it is not a restart
+    size_t len = encodeOtaStart(info, payload, sizeof(payload));
+    sender.hear(FrameType::OTA_START, RECEIVER_ID, seq++, payload, len);
+    TEST_ASSERT_EQUAL(FrameType::OTA_NACK, sender.finishTransmit());
+    sender.hear(FrameType::OTA_START, RECEIVER_ID, seq++, payload, len);
+    TEST_ASSERT_EQUAL(FrameType::OTA_NACK, sender.finishTransmit());
+    TEST_ASSERT_EQUAL(1, sender.events.otaEvents.front() == OtaEvent::STARTED ? 1 : 0);
+
+    // Backwards, every third chunk lost
+    for (int index = chunks - 1; index >= 0; index--) {
+        if (index % 3 != 1) {
+            sendChunk(static_cast<uint16_t>(index));
+        }
+    }
+    sender.hear(FrameType::OTA_END, RECEIVER_ID, seq++);
+    TEST_ASSERT_EQUAL(FrameType::OTA_NACK, sender.finishTransmit());
+    TEST_ASSERT_EQUAL(OtaEvent::ROUND_DONE, sender.events.otaEvents.back());
+    TEST_ASSERT_EQUAL_UINT32(chunks / 3, sender.link.ota().missingChunks());
+
+    // The retransmitted chunks complete the image, verified and bootable
+    for (uint16_t index = 1; index < chunks; index += 3) {
+        sendChunk(index);
+    }
+    TEST_ASSERT_EQUAL(OtaEvent::FINISHED, sender.events.otaEvents.back());
+    TEST_ASSERT_EQUAL(OtaResult::OK, sender.events.lastOtaResult);
+    TEST_ASSERT_TRUE(sender.flash.isBootable());
+    TEST_ASSERT_EQUAL_MEMORY(image.data(), sender.flash.image().data(), image.size());
+    TEST_ASSERT_FALSE(sender.link.isOtaBroadcast());
+}
+
+// Receiver application: answers REQUEST_UPDATE with a selective-repeat
+// transfer of its image, driven the way main.cpp drives otaSender
+struct Distributor : public Recorder {
+    LinkLayer* link = nullptr;
+    std::vector<uint8_t> image;
+    OtaStartInfo info = {};
+    OtaSender sender;
+    std::vector<uint16_t> requesters;
+
+    bool onUpdateRequest(uint16_t nodeId) override {
+        requesters.push_back(nodeId);
+        return sender.isActive() || sender.begin(info.imageSize, info.chunkSize, clockMs());
+    }
+    void onTxComplete(const TxResult& result) override {
+        if (result.type == FrameType::OTA_START || result.type == FrameType::OTA_DATA ||
+            result.type == FrameType::OTA_END) {
+            sender.onSent(clockMs());
+        }
+    }
+    static void onNack(const FrameView& frame, const RxFrame&, void* context) {
+        Distributor& self = *static_cast<Distributor*>(context);
+        self.sender.onNack(frame.payload, frame.payloadSize, clockMs());
+    }
+
+    void service() {
+        if (!sender.isActive() || link->txScheduler().isBusy()) {
+            return;
+        }
+        uint16_t index = 0;
+        uint8_t payload[MAX_PAYLOAD_SIZE];
+        size_t len = 0;
+        FrameType type;
+        switch (sender.next(clockMs(), index)) {
+            case OtaSendAction::START:
+                type = FrameType::OTA_START;
+                len = encodeOtaStart(info, payload, sizeof(payload));
+                break;
+            case OtaSendAction::CHUNK: {
+                const size_t offset = static_cast<size_t>(index) * info.chunkSize;
+                const size_t chunkLen = image.size() - offset < info.chunkSize ? image.size() - offset : info.chunkSize;
+                type = FrameType::OTA_DATA;
+                Wire::putU16(payload, index);
+                memcpy(payload + OTA_CHUNK_HEADER_SIZE, image.data() + offset, chunkLen);
+                len = OTA_CHUNK_HEADER_SIZE + chunkLen;
+                break;
+            }
+            case OtaSendAction::POLL:
+                type = FrameType::OTA_END;
+                break;
+            default:
+                return;
+        }
+        if (!link->queueFrame(type, link->nextSequence(), TX_LOW, payload, len)) {
+            sender.onSent(clockMs());
+        }
+    }
+};
+
+// Notice burst -> REQUEST_UPDATE -> UPDATE_ACK -> transfer. The sender
+// answers the burst once (the repeats share a sequence number) while the
+// receiver is still busy sending it, so only a retried request gets through
+void test_update_request_to_transfer() {
+    g_nowUs = 1000000;
+    LinkLayerConfig config = LinkLayerConfig::defaultConfig();
+    config.pings = false;
+    Node receiver(RECEIVER_ID, false, config);
+    Node sender(SENDER_ID, true, config);
+    Air air(receiver, sender);
+
+    Distributor app;
+    app.link = &receiver.link;
+    app.image = makeImage(16 * 100 + 33, 5);
+    app.info = startFor(app.image);
+    app.info.chunkSize = 100;
+    receiver.link.setListener(&app);
+    receiver.link.dispatcher().on(FrameType::OTA_NACK, Distributor::onNack, &app);
+
+    // Three rounds of the burst under one sequence number; the receiver
+    // hears nothing until it is done
+    const uint16_t noticeSeq = receiver.link.nextSequence();
+    for (int i = 0; i < 3; i++) {
+        TEST_ASSERT_TRUE(receiver.link.queueFrame(FrameType::FW_UPDATE_AVAILABLE, noticeSeq, TX_HIGH));
+        TEST_ASSERT_TRUE(receiver.link.queueFrame(FrameType::UPDATE_NOW, noticeSeq, TX_HIGH));
+    }
+    air.deafUntilUs[0] = g_nowUs + 3000000;
+    air.run(3000);
+    TEST_ASSERT_EQUAL_UINT32(6, air.frames[0]);
+    TEST_ASSERT_EQUAL_UINT32(1, sender.link.getStats().updateRequests);
+    TEST_ASSERT_TRUE(app.requesters.empty());
+
+    // The retry is heard and acknowledged, and the transfer starts
+    for (int step = 0; step < 10000 && app.requesters.empty(); step++) {
+        air.run(1);
+    }
+    TEST_ASSERT_EQUAL(1, app.requesters.size());
+    TEST_ASSERT_EQUAL_UINT16(SENDER_ID, app.requesters[0]);
+    TEST_ASSERT_EQUAL_UINT32(2, sender.link.getStats().updateRequests);
+
+    for (int step = 0; step < 60000 && (sender.events.otaEvents.empty() ||
+                                        sender.events.otaEvents.back() != OtaEvent::FINISHED); step++) {
+        app.service();
+        air.run(1);
+    }
+    TEST_ASSERT_EQUAL(OtaEvent::FINISHED, sender.events.otaEvents.back());
+    TEST_ASSERT_EQUAL(OtaResult::OK, sender.events.lastOtaResult);
+    TEST_ASSERT_TRUE(sender.flash.isBootable());
+    TEST_ASSERT_EQUAL_MEMORY(app.image.data(), sender.flash.image().data(), app.image.size());
+
+    // Answered: no more requests
+    for (int step = 0; step < 30000; step++) {
+        app.service();
+        air.run(1);
+    }
+    TEST_ASSERT_EQUAL(OtaSenderState::DONE, app.sender.getState());
+    TEST_ASSERT_EQUAL(1, app.requesters.size());
+    TEST_ASSERT_EQUAL_UINT32(2, sender.link.getStats().updateRequests);
+}
+
+// Receiver light sleep as main.cpp runs it. A frame lands while asleep:
+// the level wake swallows DIO1's edge and the line stays high until the
+// FIFO is read, so every loop pass sees it high
+void test_light_sleep_with_dio1_held_high() {
+    using namespace HardwareAbstraction;
+    const uint8_t dio1Pin = 14;
+    g_nowUs = 1000000;
+    Node receiver(RECEIVER_ID, false);
+    RxEngine& rx = receiver.link.rxEngine();
+    TEST_ASSERT_EQUAL(Result::SUCCESS, initialize());
+    TEST_ASSERT_EQUAL(Result::SUCCESS, Power::setWakeupPin(dio1Pin, GPIO::Level::LEVEL_HIGH, 1));  // RISING
+    TEST_ASSERT_FALSE(Power::isWakeupArmed(dio1Pin));
+
+    uint8_t frame[MAX_FRAME_SIZE];
+    const size_t len = encodeFrame(FrameType::PING, SENDER_ID, 1, nullptr, 0, frame, sizeof(frame));
+    receiver.radio.setDio1Handler(nullptr);
+    TEST_ASSERT_TRUE(receiver.radio.deliver(frame, len, g_nowUs));
+    TEST_ASSERT_EQUAL(Result::SUCCESS, Power::sleep(Power::Mode::LIGHT_SLEEP, 1000));
+    receiver.radio.setDio1Handler([&receiver](uint32_t timestampUs) { receiver.link.onDio1(timestampUs); });
+
+    // Awake with the pin back on its edge ISR; the wake check latches the
+    // frame once however often it runs before poll()
+    TEST_ASSERT_FALSE(Power::isWakeupArmed(dio1Pin));
+    for (int pass = 0; pass < 5; pass++) {
+        rx.onWake(receiver.radio.hasUnreadPacket(), g_nowUs);
+    }
+    receiver.link.poll();
+    TEST_ASSERT_EQUAL(1, receiver.events.frames.size());
+    TEST_ASSERT_EQUAL_UINT32(1, rx.getStats().interrupts);
+    TEST_ASSERT_EQUAL_UINT32(0, rx.getStats().overruns);
+
+    // DIO1 low once read; frames heard awake take the edge path alone
+    TEST_ASSERT_FALSE(receiver.radio.hasUnreadPacket());
+    rx.onWake(receiver.radio.hasUnreadPacket(), g_nowUs);
+    TEST_ASSERT_FALSE(rx.hasPendingIrq());
+    g_nowUs += 100000;
+    receiver.hear(FrameType::PING, SENDER_ID, 2);
+    rx.onWake(receiver.radio.hasUnreadPacket(), g_nowUs);
+    TEST_ASSERT_FALSE(rx.hasPendingIrq());
+    TEST_ASSERT_EQUAL(2, receiver.events.frames.size());
+    TEST_ASSERT_EQUAL_UINT32(2, rx.getStats().interrupts);
+    deinitialize();
+}
+
+void test_frame_throughput() {
+    g_nowUs = 1000000;
+    LinkLayerConfig config = LinkLayerConfig::defaultConfig();
+    config.adr = false;
+    Node receiver(RECEIVER_ID, false, config);
+
+    // PINGs from 32 senders, fewer than the link table evicts at: decode,
+    // link table, dispatch and listener per frame
+    const uint32_t frameCount = 1000000;
+    uint8_t frames[32][MAX_FRAME_SIZE];
+    size_t lengths[32];
+    auto start = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < frameCount; i++) {
+        const uint32_t node = i % 32;
+        lengths[node] = encodeFrame(FrameType::PING, static_cast<uint16_t>(0x0100 + node),
+                                    static_cast<uint16_t>(i / 32), nullptr, 0, frames[node], MAX_FRAME_SIZE);
+        g_nowUs += 20;
+        receiver.radio.deliver(frames[node], lengths[node], g_nowUs);
+        receiver.link.poll();
+    }
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    TEST_ASSERT_EQUAL_UINT32(frameCount, receiver.link.getStats().frames);
+    TEST_ASSERT_EQUAL(32, receiver.link.linkTable().size());
+    TEST_ASSERT_EQUAL_UINT32(0, receiver.link.linkTable().find(0x0100)->missed);
+    char msg[160];
+    snprintf(msg, sizeof(msg), "Link layer receive path: %u PINGs in %.2f s, %.0f frames/s, %.0f ns per frame",
+             frameCount, seconds, frameCount / seconds, seconds * 1e9 / frameCount);
+    TEST_MESSAGE(msg);
+}
+
+void process() {
+    RUN_TEST(test_receive_path);
+    RUN_TEST(test_two_node_config_commit);
+    RUN_TEST(test_ota_out_of_order);
+    RUN_TEST(test_update_request_to_transfer);
+    RUN_TEST(test_light_sleep_with_dio1_held_high);
+    RUN_TEST(test_frame_throughput);
+}
+
+#ifdef UNIT_TEST
+int main(int argc, char **argv) {
+    UNITY_BEGIN();
+    process();
+    return UNITY_END();
+}
+#endif
@@ -0,0 +1,180 @@
+// Tests for the receiver's per-node link table
+#include <unity.h>
+#include "../src/lora/link_table.h"
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+using namespace LoRaLink;
+
+void test_entries_track_each_node() {
+    LinkEntry slots[16];
+    LinkTable table(slots, 16);
+
+    for (uint16_t i = 0; i < 10; ++i) {
+        TEST_ASSERT_NOT_NULL(table.onFrame(0x1000 + i, -80.0f - i, 5.0f, 8, 100 + i));
+    }
+    TEST_ASSERT_EQUAL(10, table.size());
+    LinkEntry* entry = table.onFrame(0x1003, -83.0f, 5.0f, 24, 500);
+    TEST_ASSERT_EQUAL(10, table.size());
+    TEST_ASSERT_EQUAL_UINT32(2, entry->frames);
+    TEST_ASSERT_EQUAL_UINT32(32, entry->bytes);
+    TEST_ASSERT_EQUAL_UINT32(500, entry->lastSeenMs);
+
+    const LinkEntry* found = table.find(0x1007);
+    TEST_ASSERT_NOT_NULL(found);
+    TEST_ASSERT_EQUAL_FLOAT(-87.0f, found->rssi());
+    TEST_ASSERT_NULL(table.find(0x2000));
+
+    // EWMA moves 1/8 of the way per sample and settles on a new level
+    for (int i = 0; i < 60; ++i) {
+        entry = table.onFrame(0x1003, -100.0f, -2.5f, 8, 600 + i);
+    }
+    TEST_ASSERT_FLOAT_WITHIN(0.1f, -100.0f, entry->rssi());
+    TEST_ASSERT_FLOAT_WITHIN(0.1f, -2.5f, entry->snr());
+
+    size_t occupied = 0;
+    for (size_t i = 0; i < table.capacity(); ++i) {
+        occupied += table.slot(i) != nullptr ? 1 : 0;
+    }
+    TEST_ASSERT_EQUAL(10, occupied);
+}
+
+void test_loss_from_sequence_gaps() {
+    LinkEntry slots[8];
+    LinkTable table(slots, 8);
+
+    // Every fifth PING lost: 20 %
+    uint16_t seq = 65000;   // Runs across the wrap
+    for (int i = 0; i < 2000; ++i, ++seq) {
+        if (i % 5 == 4) {
+            continue;
+        }
+        LinkEntry* entry = table.onFrame(0x0042, -90.0f, 0.0f, 8, i);
+        table.onSequence(*entry, seq);
+    }
+    const LinkEntry* entry = table.find(0x0042);
+    TEST_ASSERT_EQUAL_UINT32(399, entry->missed);
+    TEST_ASSERT_FLOAT_WITHIN(0.05f, 0.2f, entry->loss());
+
+    // Loss clears again on a clean link
+    LinkEntry* live = const_cast<LinkEntry*>(entry);
+    for (int i = 0; i < 100; ++i, ++seq) {
+        table.onSequence(*live, seq);
+    }
+    TEST_ASSERT_TRUE(live->loss() < 0.01f);
+
+    // A duplicate changes nothing, a reboot (sequence back to 0) is not loss
+    const uint32_t missed = live->missed;
+    table.onSequence(*live, static_cast<uint16_t>(seq - 1));
+    table.onSequence(*live, 0);
+    table.onSequence(*live, 1);
+    TEST_ASSERT_EQUAL_UINT32(missed, live->missed);
+
+    // A long outage saturates instead of wrapping
+    table.onSequence(*live, 900);
+    TEST_ASSERT_TRUE(live->loss() > 0.85f);
+}
+
+void test_full_window_replaces_stalest() {
+    LinkEntry slots[8];
+    LinkTable table(slots, 8);
+
+    for (uint16_t i = 0; i < 8; ++i) {
+        table.onFrame(i, -80.0f, 5.0f, 8, 1000 + i);
+    }
+    TEST_ASSERT_EQUAL(8, table.size());
+    // Node 0 was heard first and not since; node 3 is refreshed
+    table.onFrame(3, -80.0f, 5.0f, 8, 2000);
+    table.onFrame(100, -70.0f, 6.0f, 8, 3000);
+    TEST_ASSERT_EQUAL(8, table.size());
+    TEST_ASSERT_EQUAL(1, table.getStats().evictions);
+    TEST_ASSERT_NULL(table.find(0));
+    TEST_ASSERT_NOT_NULL(table.find(3));
+    TEST_ASSERT_NOT_NULL(table.find(100));
+    TEST_ASSERT_EQUAL_UINT32(1, table.find(100)->frames);
+    TEST_ASSERT_TRUE(table.getStats().maxProbe <= LINK_PROBE_LIMIT);
+
+    table.clear();
+    TEST_ASSERT_EQUAL(0, table.size());
+    TEST_ASSERT_NULL(table.find(3));
+}
+
+void test_thousand_node_benchmark() {
+    const size_t nodes = 1000;
+    const size_t capacities[] = { 64, 1024, 2048 };
+    const int rounds = 200;
+    char msg[200];
+
+    TEST_MESSAGE("1000 senders, 200 PINGs each, 5% random loss:");
+    for (size_t capacity : capacities) {
+        std::vector<LinkEntry> slots(capacity);
+        LinkTable table(slots.data(), capacity);
+        std::vector<uint16_t> ids(nodes);
+        for (size_t n = 0; n < nodes; ++n) {
+            ids[n] = static_cast<uint16_t>(0x8000 + n * 37);     // Spread like efuse-derived ids
+        }
+
+        uint32_t lcg = 12345;
+        uint32_t now = 0;
+        size_t updates = 0;
+        const auto t0 = std::chrono::steady_clock::now();
+        for (int r = 0; r < rounds; ++r) {
+            for (size_t n = 0; n < nodes; ++n) {
+                lcg = lcg * 1664525u + 1013904223u;
+                if ((lcg >> 24) < 13) {
+                    continue;   // Lost
+                }
+                LinkEntry* entry = table.onFrame(ids[n], -90.0f + (lcg & 15), 3.0f, 8, now++);
+                table.onSequence(*entry, static_cast<uint16_t>(r));
+                updates++;
+            }
+        }
+        const auto t1 = std::chrono::steady_clock::now();
+        const double ns = std::chrono::duration<double, std::nano>(t1 - t0).count() / updates;
+
+        double lossSum = 0;
+        size_t tracked = 0;
+        for (size_t n = 0; n < nodes; ++n) {
+            const LinkEntry* entry = table.find(ids[n]);
+            if (entry != nullptr && entry->frames > 50) {
+                lossSum += static_cast<double>(entry->missed) / (entry->frames + entry->missed);
+                tracked++;
+            }
+        }
+        snprintf(msg, sizeof(msg),
+                 "  %4u slots: %6u bytes (%u per entry), %4u nodes held, %6.1f ns/update, max probe %u, "
+                 "avg probe %.2f, %u evictions, mean loss %.3f",
+                 (unsigned)capacity, (unsigned)table.memoryBytes(), (unsigned)sizeof(LinkEntry),
+                 (unsigned)table.size(), ns, (unsigned)table.getStats().maxProbe,
+                 static_cast<double>(table.getStats().probes) / table.getStats().updates,
+                 (unsigned)table.getStats().evictions, tracked ? lossSum / tracked : 0.0);
+        TEST_MESSAGE(msg);
+
+        TEST_ASSERT_TRUE(table.getStats().maxProbe <= LINK_PROBE_LIMIT);
+        if (capacity >= 2 * nodes) {
+            // Half full: an 8-slot window overflows only a handful of times
+            TEST_ASSERT_EQUAL(nodes, table.size());
+            TEST_ASSERT_TRUE(table.getStats().evictions <= nodes / 100);
+            TEST_ASSERT_FLOAT_WITHIN(0.01, 0.05, lossSum / tracked);
+        } else {
+            TEST_ASSERT_TRUE(table.size() <= capacity);
+        }
+    }
+}
+
+void process() {
+    RUN_TEST(test_entries_track_each_node);
+    RUN_TEST(test_loss_from_sequence_gaps);
+    RUN_TEST(test_full_window_replaces_stalest);
+    RUN_TEST(test_thousand_node_benchmark);
+}
+
+#ifdef UNIT_TEST
+int main(int argc, char **argv) {
+    UNITY_BEGIN();
+    process();
+    return UNITY_END();
+}
+#endif
@@ -0,0 +1,464 @@
+// Tests for CAD listen-before-talk and CAD wake-up, with a channel simulation
+#include <unity.h>
+#include "../src/lora/listen_before_talk.h"
+#include "../src/lora/tx_scheduler.h"
+#include "../src/lora/mock_radio.h"
+#include "lora_test_support.h"
+#include <cmath>
+#include <cstdio>
+#include <queue>
+#include <vector>
+
+using namespace LoRaLink;
+
+static const LoRaModulation SF9 = loraModulation(9, 125000);
+
+static size_t makeFrame(FrameType type, uint16_t seq, uint8_t* out) {
+    return encodeFrame(type, 0x0001, seq, nullptr, 0, out, MAX_FRAME_SIZE);
+}
+
+void test_backoff_window_grows_and_resets() {
+    ListenBeforeTalk lbt;
+    lbt.setModulation(SF9);
+    lbt.seed(7);
+    const LbtConfig config = ListenBeforeTalk::defaultConfig();
+    TEST_ASSERT_EQUAL_UINT32(cadTimeUs(SF9), lbt.cadUs());
+    TEST_ASSERT_EQUAL_UINT32(10240, lbt.cadUs());    // 2.5 symbols of 4.096 ms
+
+    uint32_t now = 1000;
+    TEST_ASSERT_TRUE(lbt.ready(now));
+    for (uint8_t attempt = 0; attempt + 1 < config.maxAttempts; ++attempt) {
+        TEST_ASSERT_TRUE(lbt.onBusy(now));
+        const uint8_t exp = config.minWindowExp + attempt < config.maxWindowExp
+                                ? config.minWindowExp + attempt : config.maxWindowExp;
+        const uint32_t waitUs = lbt.readyUs() - now;
+        TEST_ASSERT_TRUE(waitUs >= lbt.slotUs());
+        TEST_ASSERT_TRUE(waitUs <= (1u << exp) * lbt.slotUs());
+        TEST_ASSERT_FALSE(lbt.ready(lbt.readyUs() - 1));
+        now = lbt.readyUs();
+        TEST_ASSERT_TRUE(lbt.ready(now));
+    }
+    // Out of attempts: send regardless, window back to the start
+    TEST_ASSERT_FALSE(lbt.onBusy(now));
+    TEST_ASSERT_EQUAL_UINT32(1, lbt.getStats().forced);
+    TEST_ASSERT_TRUE(lbt.onBusy(now));
+    TEST_ASSERT_TRUE(lbt.readyUs() - now <= (1u << config.minWindowExp) * lbt.slotUs());
+
+    lbt.onClear();
+    TEST_ASSERT_EQUAL_UINT32(config.maxAttempts + 2, lbt.getStats().scans);
+    TEST_ASSERT_EQUAL_UINT32(1, lbt.getStats().clear);
+    TEST_ASSERT_EQUAL_UINT32(config.maxAttempts + 1, lbt.getStats().busy);
+}
+
+void test_scheduler_scans_before_each_frame() {
+    MockRadio radio;
+    FramePool pool;
+    RxEngine rx(radio, pool);
+    TxScheduler tx(radio);
+    ListenBeforeTalk lbt;
+    lbt.setModulation(SF9);
+    tx.attachReceiver(&rx);
+    tx.attachListenBeforeTalk(&lbt);
+    radio.setDio1Handler([&](uint32_t ts) {
+        tx.onDio1(ts);
+        rx.onDio1(ts);
+    });
+    rx.begin();
+
+    // Clear channel: CAD, then the frame
+    uint8_t buf[MAX_FRAME_SIZE];
+    TEST_ASSERT_TRUE(tx.enqueue(buf, makeFrame(FrameType::PING, 1, buf), Priority::NORMAL, 0));
+    TEST_ASSERT_EQUAL(RadioMode::CAD, radio.getMode());
+    TEST_ASSERT_TRUE(tx.isScanning());
+    TEST_ASSERT_FALSE(rx.isActive());
+    TEST_ASSERT_EQUAL(0, radio.getStats().transmits);
+    tx.poll(5000);
+    TEST_ASSERT_EQUAL(RadioMode::CAD, radio.getMode());     // No CadDone yet
+    TEST_ASSERT_TRUE(radio.completeChannelScan(false, 10240));
+    tx.poll(10300);
+    TEST_ASSERT_EQUAL(RadioMode::TRANSMIT, radio.getMode());
+    radio.completeTransmit(200000);
+    tx.poll(200100);
+    TEST_ASSERT_TRUE(rx.isActive());
+    TEST_ASSERT_EQUAL(1, tx.getStats().sent);
+
+    // Busy channel: back off listening, then scan again
+    tx.enqueue(buf, makeFrame(FrameType::PING, 2, buf), Priority::NORMAL, 300000);
+    radio.completeChannelScan(true, 310240);
+    tx.poll(310300);
+    TEST_ASSERT_FALSE(tx.isScanning());
+    TEST_ASSERT_TRUE(tx.isBusy());
+    TEST_ASSERT_TRUE(rx.isActive());
+    TEST_ASSERT_EQUAL(RadioMode::RECEIVE, radio.getMode());
+    TEST_ASSERT_EQUAL_UINT32(1, tx.getStats().deferred);
+    tx.poll(lbt.readyUs() - 1);
+    TEST_ASSERT_EQUAL(RadioMode::RECEIVE, radio.getMode());
+    tx.poll(lbt.readyUs());
+    TEST_ASSERT_EQUAL(RadioMode::CAD, radio.getMode());
+    radio.completeChannelScan(false, lbt.readyUs() + 10240);
+    tx.poll(lbt.readyUs() + 10300);
+    TEST_ASSERT_EQUAL(RadioMode::TRANSMIT, radio.getMode());
+    TEST_ASSERT_EQUAL_UINT16(2, Wire::getU16(radio.lastTransmit() + 4));
+    radio.completeTransmit(lbt.readyUs() + 200000);
+    tx.poll(lbt.readyUs() + 200100);
+
+    // Scheduled frames own the channel: no CAD
+    const uint32_t scansBefore = radio.getStats().scans;
+    tx.enqueue(buf, makeFrame(FrameType::TDMA_BEACON, 3, buf), Priority::CRITICAL, 2000000);
+    TEST_ASSERT_EQUAL(RadioMode::TRANSMIT, radio.getMode());
+    TEST_ASSERT_EQUAL_UINT32(scansBefore, radio.getStats().scans);
+    radio.completeTransmit(2200000);
+    tx.poll(2200100);
+
+    // A scan that never reports is given up on; the frame still goes out
+    tx.enqueue(buf, makeFrame(FrameType::PING, 4, buf), Priority::NORMAL, 3000000);
+    TEST_ASSERT_TRUE(tx.isScanning());
+    tx.poll(3000000 + 4 * lbt.cadUs() + 10001);
+    TEST_ASSERT_EQUAL(RadioMode::TRANSMIT, radio.getMode());
+    TEST_ASSERT_EQUAL_UINT32(3, lbt.getStats().scans);
+}
+
+// A sender with a 64-symbol preamble PINGs at random; the receiver sleeps
+// between CADs. A CAD hears a frame when it falls inside the preamble; the
+// frame is received when RX started with lockSymbols of preamble left.
+void test_cad_wake_catches_long_preambles() {
+    MockRadio radio;
+    FramePool pool;
+    RxEngine rx(radio, pool);
+    CadWake wake(radio, rx);
+    radio.setDio1Handler([&](uint32_t ts) {
+        wake.onDio1(ts);
+        rx.onDio1(ts);
+    });
+    rx.begin();
+
+    // The stock 8-symbol preamble leaves no room for a period
+    wake.setModulation(SF9);
+    TEST_ASSERT_FALSE(wake.begin(0));
+    TEST_ASSERT_TRUE(rx.isActive());
+    TEST_ASSERT_EQUAL(CadWakeState::OFF, wake.state());
+
+    const LoRaModulation longPreamble = loraModulation(9, 125000, 5, 64);
+    const uint32_t symbolUs = symbolTimeUs(9, 125000);
+    const uint32_t preambleUs = 64 * symbolUs;
+    const uint32_t frameUs = timeOnAirUs(longPreamble, PING_FRAME_BYTES);
+    wake.setModulation(longPreamble);
+    TEST_ASSERT_EQUAL_UINT32(preambleUs - cadTimeUs(SF9) - 4 * symbolUs - 12000, wake.periodUs());
+    TEST_ASSERT_TRUE(wake.begin(0));
+    TEST_ASSERT_EQUAL(RadioMode::SLEEP, radio.getMode());
+
+    TestRng rng(19);
+    const uint32_t endUs = 600000000;           // 10 min
+    uint32_t nextFrameUs = 1000000;
+    uint32_t frameStartUs = 0;
+    bool onAir = false;
+    uint32_t scanStartUs = 0;
+    uint32_t rxSinceUs = 0;
+    RadioMode lastMode = radio.getMode();
+    uint32_t sent = 0, received = 0;
+    uint8_t buf[MAX_FRAME_SIZE];
+    const size_t len = makeFrame(FrameType::PING, 0, buf);
+
+    for (uint32_t now = 0; now < endUs; now += 1000) {
+        if (radio.getMode() != lastMode) {
+            lastMode = radio.getMode();
+            if (lastMode == RadioMode::CAD) scanStartUs = now;
+            if (lastMode == RadioMode::RECEIVE) rxSinceUs = now;
+        }
+        if (!onAir && now >= nextFrameUs) {
+            onAir = true;
+            frameStartUs = now;
+            sent++;
+        }
+        if (radio.getMode() == RadioMode::CAD && now >= scanStartUs + cadTimeUs(SF9)) {
+            const bool heard = onAir && scanStartUs >= frameStartUs && now <= frameStartUs + preambleUs;
+            radio.completeChannelScan(heard, now);
+        }
+        if (onAir && now >= frameStartUs + frameUs) {
+            onAir = false;
+            const bool synced = radio.getMode() == RadioMode::RECEIVE &&
+                                rxSinceUs + 4 * symbolUs <= frameStartUs + preambleUs;
+            if (synced) {
+                radio.deliver(buf, len, now);
+            }
+            nextFrameUs = now + 2000000 + rng.next() % 8000000;
+        }
+        if (now % 10000 == 0) {                 // loop() pass
+            rx.poll();
+            RxFrame* frame;
+            while ((frame = rx.pop()) != nullptr) {
+                received++;
+                rx.release(frame);
+            }
+            wake.poll(now);
+        }
+    }
+
+    const CadWakeStats& s = wake.getStats();
+    const double total = static_cast<double>(s.sleepUs + s.scanUs + s.listenUs);
+    char msg[200];
+    snprintf(msg, sizeof(msg),
+             "CAD wake, SF9 64-symbol preamble: %.0f ms period, %lu/%lu frames, %lu scans, %lu idle wakes, "
+             "radio asleep %.1f%%, scanning %.1f%%, in RX %.1f%%",
+             wake.periodUs() / 1000.0, (unsigned long)received, (unsigned long)sent, (unsigned long)s.scans,
+             (unsigned long)s.idleWakes, s.sleepUs / total * 100, s.scanUs / total * 100, s.listenUs / total * 100);
+    TEST_MESSAGE(msg);
+    TEST_ASSERT_EQUAL_UINT32(sent, received);
+    TEST_ASSERT_EQUAL_UINT32(sent, s.wakes);
+    TEST_ASSERT_EQUAL_UINT32(0, s.idleWakes);
+    TEST_ASSERT_TRUE(s.sleepUs > 0.8 * total);
+
+    // RX resumed by the transmit path holds a listen window, then sleeps
+    TEST_ASSERT_TRUE(wake.begin(endUs));
+    rx.resume();
+    wake.poll(endUs + 1000);
+    TEST_ASSERT_EQUAL(CadWakeState::LISTEN, wake.state());
+    wake.poll(endUs + 1000 + wake.listenUs());
+    TEST_ASSERT_EQUAL(CadWakeState::SLEEP, wake.state());
+    TEST_ASSERT_FALSE(rx.isActive());
+
+    wake.end();
+    TEST_ASSERT_TRUE(rx.isActive());
+    TEST_ASSERT_EQUAL(RadioMode::RECEIVE, radio.getMode());
+}
+
+// --- Channel simulation --------------------------------------------------------
+//
+// n senders with Poisson traffic (CONFIG-sized frames, SF9/125 kHz) and one
+// receiver, everyone in range of everyone, no capture: any overlap loses
+// both frames. Every radio action waits for the next loop() pass (0-10 ms).
+// A CAD hears a frame whose preamble overlaps the scan 99% of the time and
+// a frame only in its payload 80% of the time (payload chirps are detected,
+// a little less reliably; AN1200.85). ALOHA sends as soon as it
+// can; LBT runs the real ListenBeforeTalk before each frame.
+
+namespace {
+    struct Frame {
+        uint64_t startUs;
+        uint64_t endUs;
+        bool collided;
+    };
+
+    enum class EventKind { ARRIVAL, ACCESS, SCAN_DONE, FRAME_END };
+
+    struct Event {
+        uint64_t atUs;
+        EventKind kind;
+        size_t index;
+        bool operator>(const Event& other) const { return atUs > other.atUs; }
+    };
+
+    struct SimReport {
+        uint32_t offered;
+        uint32_t sent;
+        uint32_t collided;
+        uint32_t dropped;           // Queue full
+        uint32_t forced;
+        uint64_t deliveredAirUs;
+        uint64_t delayUs;           // Arrival to TX end, delivered frames
+
+        double collisionRate() const { return sent ? static_cast<double>(collided) / sent : 0; }
+    };
+
+    class LbtSim {
+    public:
+        static constexpr size_t QUEUE_LIMIT = 8;
+
+        LbtSim(size_t nodes, double offeredLoad, bool lbt, uint32_t seed)
+            : rng_(seed), nodes_(nodes), lbt_(lbt), report_()
+        {
+            frameUs_ = timeOnAirUs(SF9, CONFIG_FRAME_BYTES);
+            preambleUs_ = (SF9.preamble + 4) * symbolTimeUs(9, 125000);
+            cadUs_ = cadTimeUs(SF9);
+            meanGapUs_ = frameUs_ * nodes / offeredLoad;
+            senders_.resize(nodes);
+            for (size_t i = 0; i < nodes; ++i) {
+                senders_[i].lbt.setModulation(SF9);
+                senders_[i].lbt.seed(seed * 131 + static_cast<uint32_t>(i) + 1);
+                schedule(arrivalGap(), EventKind::ARRIVAL, i);
+            }
+        }
+
+        SimReport run(uint64_t durationUs) {
+            while (!events_.empty() && events_.top().atUs < durationUs) {
+                const Event e = events_.top();
+                events_.pop();
+                Sender& s = senders_[e.index];
+                switch (e.kind) {
+                    case EventKind::ARRIVAL:
+                        report_.offered++;
+                        if (s.queue.size() < QUEUE_LIMIT) {
+                            s.queue.push(e.atUs);
+                            if (!s.active) {
+                                s.active = true;
+                                schedule(e.atUs + loopLatency(), EventKind::ACCESS, e.index);
+                            }
+                        } else {
+                            report_.dropped++;
+                        }
+                        schedule(e.atUs + arrivalGap(), EventKind::ARRIVAL, e.index);
+                        break;
+                    case EventKind::ACCESS:
+                        if (!lbt_) {
+                            transmit(e.index, e.atUs);
+                        } else {
+                            s.scanStartUs = e.atUs;
+                            schedule(e.atUs + cadUs_, EventKind::SCAN_DONE, e.index);
+                        }
+                        break;
+                    case EventKind::SCAN_DONE: {
+                        const uint64_t pollUs = e.atUs + loopLatency();
+                        if (!channelHeard(s.scanStartUs, e.atUs)) {
+                            s.lbt.onClear();
+                            transmit(e.index, pollUs + 1000);
+                        } else if (s.lbt.onBusy(static_cast<uint32_t>(pollUs))) {
+                            schedule(pollUs + (s.lbt.readyUs() - static_cast<uint32_t>(pollUs)) + loopLatency(),
+                                     EventKind::ACCESS, e.index);
+                        } else {
+                            report_.forced++;
+                            transmit(e.index, pollUs + 1000);
+                        }
+                        break;
+                    }
+                    case EventKind::FRAME_END:
+                        endFrame(e.index);
+                        break;
+                }
+            }
+            return report_;
+        }
+
+    private:
+        struct Sender {
+            std::queue<uint64_t> queue;  // Arrival times
+            bool active = false;         // Accessing the channel or on air
+            uint64_t scanStartUs = 0;
+            ListenBeforeTalk lbt;
+        };
+
+        TestRng rng_;
+        size_t nodes_;
+        bool lbt_;
+        uint32_t frameUs_;
+        uint32_t preambleUs_;
+        uint32_t cadUs_;
+        double meanGapUs_;
+        std::vector<Sender> senders_;
+        std::vector<Frame> frames_;
+        std::vector<size_t> owner_;
+        std::vector<size_t> onAir_;
+        std::priority_queue<Event, std::vector<Event>, std::greater<Event>> events_;
+        SimReport report_;
+
+        void schedule(uint64_t atUs, EventKind kind, size_t index) { events_.push(Event{ atUs, kind, index }); }
+        uint64_t loopLatency() { return rng_.next() % 10000; }
+        uint64_t arrivalGap() { return static_cast<uint64_t>(-meanGapUs_ * std::log(1.0 - rng_.uniform())); }
+
+        // Preamble overlap is heard 99% of the time, payload-only overlap 80%
+        bool channelHeard(uint64_t fromUs, uint64_t toUs) {
+            bool preamble = false, payload = false;
+            for (size_t i : onAir_) {
+                const Frame& f = frames_[i];
+                if (f.startUs >= toUs || f.endUs <= fromUs) continue;
+                if (f.startUs + preambleUs_ > fromUs) {
+                    preamble = true;
+                } else {
+                    payload = true;
+                }
+            }
+            if (preamble && rng_.next() % 100 < 99) return true;
+            return payload && rng_.next() % 100 < 80;
+        }
+
+        void transmit(size_t index, uint64_t startUs) {
+            Frame frame = { startUs, startUs + frameUs_, false };
+            for (size_t i : onAir_) {
+                if (frames_[i].endUs > startUs) {
+                    frames_[i].collided = true;
+                    frame.collided = true;
+                }
+            }
+            frames_.push_back(frame);
+            owner_.push_back(index);
+            onAir_.push_back(frames_.size() - 1);
+            schedule(frame.endUs, EventKind::FRAME_END, frames_.size() - 1);
+        }
+
+        void endFrame(size_t frameIndex) {
+            for (size_t i = 0; i < onAir_.size(); ++i) {
+                if (onAir_[i] == frameIndex) {
+                    onAir_.erase(onAir_.begin() + i);
+                    break;
+                }
+            }
+            const Frame& f = frames_[frameIndex];
+            const size_t index = owner_[frameIndex];
+            Sender& s = senders_[index];
+            report_.sent++;
+            if (f.collided) {
+                report_.collided++;
+            } else {
+                report_.deliveredAirUs += f.endUs - f.startUs;
+                report_.delayUs += f.endUs - s.queue.front();
+            }
+            s.queue.pop();
+            if (s.queue.empty()) {
+                s.active = false;
+            } else {
+                schedule(f.endUs + loopLatency(), EventKind::ACCESS, index);
+            }
+        }
+    };
+}
+
+void test_lbt_vs_aloha_simulation() {
+    const double loads[] = { 0.1, 0.2, 0.4, 0.8, 1.6 };
+    const size_t nodes = 20;
+    const uint64_t durationUs = 3600000000ull;  // 1 h
+    char msg[220];
+
+    snprintf(msg, sizeof(msg), "%u senders, SF9/125 kHz %u-byte frames (%lu ms), 1 h; offered load in frame "
+             "airtimes per airtime:", (unsigned)nodes, (unsigned)CONFIG_FRAME_BYTES,
+             (unsigned long)(timeOnAirUs(SF9, CONFIG_FRAME_BYTES) / 1000));
+    TEST_MESSAGE(msg);
+    for (double load : loads) {
+        const SimReport aloha = LbtSim(nodes, load, false, 11).run(durationUs);
+        const SimReport lbt = LbtSim(nodes, load, true, 11).run(durationUs);
+        const uint32_t alohaOk = aloha.sent - aloha.collided;
+        const uint32_t lbtOk = lbt.sent - lbt.collided;
+
+        snprintf(msg, sizeof(msg),
+                 "  G=%.1f | ALOHA %5.1f%% coll, goodput %4.1f%%, delay %5.0f ms | "
+                 "LBT %5.1f%% coll, goodput %4.1f%%, delay %5.0f ms, %lu forced, %lu queue drops",
+                 load, aloha.collisionRate() * 100, aloha.deliveredAirUs / (durationUs / 100.0),
+                 alohaOk ? aloha.delayUs / 1000.0 / alohaOk : 0.0,
+                 lbt.collisionRate() * 100, lbt.deliveredAirUs / (durationUs / 100.0),
+                 lbtOk ? lbt.delayUs / 1000.0 / lbtOk : 0.0, (unsigned long)lbt.forced,
+                 (unsigned long)lbt.dropped);
+        TEST_MESSAGE(msg);
+
+        // Past G=0.4 missed payloads and forced sends close the gap, but
+        // LBT still carries more traffic than ALOHA at every load
+        if (load <= 0.4) {
+            TEST_ASSERT_TRUE(lbt.collisionRate() < aloha.collisionRate() / 2);
+        } else {
+            TEST_ASSERT_TRUE(lbt.collisionRate() < aloha.collisionRate());
+        }
+        TEST_ASSERT_TRUE(lbt.deliveredAirUs >= aloha.deliveredAirUs);
+    }
+}
+
+void process() {
+    RUN_TEST(test_backoff_window_grows_and_resets);
+    RUN_TEST(test_scheduler_scans_before_each_frame);
+    RUN_TEST(test_cad_wake_catches_long_preambles);
+    RUN_TEST(test_lbt_vs_aloha_simulation);
+}
+
+#ifdef UNIT_TEST
+int main(int argc, char **argv) {
+    UNITY_BEGIN();
+    process();
+    return UNITY_END();
+}
+#endif
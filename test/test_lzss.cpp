@@ -0,0 +1,327 @@
+// Tests for LZSS-compressed OTA transfers: codec, streaming decode, staged apply
+#include <unity.h>
+#include "../src/lora/lzss.h"
+#include "../src/lora/delta_encoder.h"
+#include "../src/lora/staged_update.h"
+#include "../src/lora/mock_update_backend.h"
+#include "../src/lora/frame_codec.h"
+#include "lora_test_support.h"
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+using namespace LoRaLink;
+
+class VectorBaseImage : public IImageSource {
+public:
+    explicit VectorBaseImage(const std::vector<uint8_t>& image) : image_(image) {}
+
+    size_t size() const override { return image_.size(); }
+    bool read(size_t offset, uint8_t* data, size_t length) override {
+        if (offset + length > image_.size()) {
+            return false;
+        }
+        memcpy(data, image_.data() + offset, length);
+        return true;
+    }
+
+private:
+    const std::vector<uint8_t>& image_;
+};
+
+// Code-like data: a small vocabulary of instruction words with varying operands
+static std::vector<uint8_t> makeCodeLike(size_t size, uint32_t seed) {
+    static const uint8_t opcodes[][3] = {
+        { 0x36, 0x41, 0x00 }, { 0x1d, 0xf0, 0x00 }, { 0x0c, 0x02, 0x00 }, { 0x81, 0x00, 0x00 },
+        { 0xe0, 0x08, 0x00 }, { 0x22, 0xa0, 0x00 }, { 0x65, 0x00, 0x00 }, { 0x91, 0x00, 0x00 }
+    };
+    std::vector<uint8_t> data;
+    data.reserve(size);
+    while (data.size() < size) {
+        seed = seed * 1664525u + 1013904223u;
+        const uint8_t* op = opcodes[(seed >> 8) % 8];
+        data.push_back(op[0]);
+        data.push_back(op[1]);
+        data.push_back((seed >> 24) % 4 == 0 ? static_cast<uint8_t>(seed >> 16) : op[2]);
+    }
+    data.resize(size);
+    return data;
+}
+
+static std::vector<uint8_t> decodeAll(const std::vector<uint8_t>& packed, size_t size) {
+    LzssDecoder decoder;
+    std::vector<uint8_t> out(size);
+    size_t consumed;
+    const size_t n = decoder.decode(packed.data() + LZSS_HEADER_SIZE, packed.size() - LZSS_HEADER_SIZE,
+                                    consumed, out.data(), out.size());
+    out.resize(n);
+    return out;
+}
+
+// Stream the transfer through OtaReceiver in reverse chunk order
+static OtaResult deliver(OtaReceiver& ota, StagedUpdateBackend& backend, const std::vector<uint8_t>& transfer) {
+    const OtaStartInfo info = startFor(transfer, transferFlags(transfer.data(), transfer.size()));
+    backend.setFlags(info.flags);
+    OtaResult r = ota.start(info, 0);
+    if (r != OtaResult::OK) {
+        return r;
+    }
+    for (uint32_t i = ota.chunkCount(); i-- > 0;) {
+        const size_t offset = static_cast<size_t>(i) * CHUNK;
+        const size_t len = transfer.size() - offset < CHUNK ? transfer.size() - offset : CHUNK;
+        ota.onChunk(static_cast<uint16_t>(i), transfer.data() + offset, len, 0);
+    }
+    return ota.finish();
+}
+
+static bool startsWith(const std::vector<uint8_t>& flash, const std::vector<uint8_t>& image) {
+    return flash.size() >= image.size() && std::equal(image.begin(), image.end(), flash.begin());
+}
+
+void test_round_trip_shapes() {
+    LzssEncoder encoder;
+
+    std::vector<uint8_t> zeros(10000, 0);
+    std::vector<uint8_t> packed = encoder.compress(zeros.data(), zeros.size());
+    TEST_ASSERT_TRUE(isLzssStream(packed.data(), packed.size()));
+    TEST_ASSERT_TRUE(packed.size() < LZSS_HEADER_SIZE + zeros.size() / 8);
+    TEST_ASSERT_TRUE(decodeAll(packed, zeros.size()) == zeros);
+
+    // Incompressible data costs one tag bit per byte, no more
+    std::vector<uint8_t> noise = makeImage(5000, 1);
+    packed = encoder.compress(noise.data(), noise.size());
+    TEST_ASSERT_TRUE(packed.size() <= LZSS_HEADER_SIZE + noise.size() * 9 / 8 + 1);
+    TEST_ASSERT_TRUE(decodeAll(packed, noise.size()) == noise);
+
+    std::vector<uint8_t> code = makeCodeLike(20000, 2);
+    packed = encoder.compress(code.data(), code.size());
+    TEST_ASSERT_TRUE(packed.size() < code.size() * 3 / 4);
+    TEST_ASSERT_TRUE(decodeAll(packed, code.size()) == code);
+
+    LzssHeader header;
+    TEST_ASSERT_TRUE(decodeLzssHeader(packed.data(), packed.size(), header));
+    TEST_ASSERT_EQUAL_UINT32(code.size(), header.size);
+    TEST_ASSERT_FALSE(decodeLzssHeader(packed.data(), LZSS_HEADER_SIZE - 1, header));
+}
+
+void test_decoder_streams_in_any_split() {
+    std::vector<uint8_t> code = makeCodeLike(30000, 3);
+    LzssEncoder encoder;
+    std::vector<uint8_t> packed = encoder.compress(code.data(), code.size());
+
+    // One input byte at a time, seven output bytes at a time
+    LzssDecoder decoder;
+    std::vector<uint8_t> out;
+    size_t in = LZSS_HEADER_SIZE;
+    uint8_t piece[7];
+    while (out.size() < code.size()) {
+        size_t consumed;
+        const size_t want = code.size() - out.size() < sizeof(piece) ? code.size() - out.size() : sizeof(piece);
+        const size_t n = decoder.decode(packed.data() + in, in < packed.size() ? 1 : 0, consumed, piece, want);
+        in += consumed;
+        out.insert(out.end(), piece, piece + n);
+        TEST_ASSERT_TRUE(n > 0 || consumed > 0);
+    }
+    TEST_ASSERT_TRUE(out == code);
+}
+
+void test_staged_compressed_image() {
+    std::vector<uint8_t> image = makeCodeLike(60000, 4);
+    LzssEncoder encoder;
+    std::vector<uint8_t> packed = encoder.compress(image.data(), image.size());
+    TEST_ASSERT_EQUAL_HEX8(OTA_START_FLAG_LZSS, transferFlags(packed.data(), packed.size()));
+    TEST_ASSERT_EQUAL_HEX8(0, transferFlags(image.data(), image.size()));
+
+    MockUpdateBackend flash(128 * 1024);
+    VectorBaseImage running(image);
+    StagedUpdateBackend backend(flash, running);
+    OtaReceiver ota(backend);
+    TEST_ASSERT_EQUAL(OtaResult::OK, deliver(ota, backend, packed));
+    TEST_ASSERT_NULL(backend.failureReason());
+    TEST_ASSERT_TRUE(flash.isBootable());
+    TEST_ASSERT_TRUE(startsWith(flash.image(), image));
+    TEST_ASSERT_EQUAL_UINT32(0, flash.getStats().rewrites);
+}
+
+void test_compressed_patch() {
+    std::vector<uint8_t> base = makeCodeLike(50000, 5);
+    std::vector<uint8_t> target = base;
+    // New log strings: nothing like them in the base, but they compress
+    std::string added;
+    for (int i = 0; added.size() < 3000; ++i) {
+        added += "LoRa link " + std::to_string(i) + ": retry window exceeded, backing off\n";
+    }
+    target.insert(target.begin() + 20000, added.begin(), added.end());
+
+    DeltaEncoder delta;
+    std::vector<uint8_t> patch = delta.encode(base.data(), base.size(), target.data(), target.size());
+    LzssEncoder encoder;
+    std::vector<uint8_t> packed = encoder.compress(patch.data(), patch.size());
+    TEST_ASSERT_TRUE(packed.size() < patch.size());
+    TEST_ASSERT_EQUAL_HEX8(OTA_START_FLAG_LZSS | OTA_START_FLAG_DELTA, transferFlags(packed.data(), packed.size()));
+
+    MockUpdateBackend flash(128 * 1024);
+    VectorBaseImage running(base);
+    StagedUpdateBackend backend(flash, running);
+    OtaReceiver ota(backend);
+    TEST_ASSERT_EQUAL(OtaResult::OK, deliver(ota, backend, packed));
+    TEST_ASSERT_EQUAL(DeltaResult::OK, backend.lastDeltaResult());
+    TEST_ASSERT_TRUE(startsWith(flash.image(), target));
+    TEST_ASSERT_EQUAL_UINT32(patch.size(), backend.applier().getStats().patchBytes);
+}
+
+void test_rejects_bad_streams() {
+    std::vector<uint8_t> image = makeCodeLike(12000, 7);
+    LzssEncoder encoder;
+    std::vector<uint8_t> packed = encoder.compress(image.data(), image.size());
+
+    // Applied directly (no transport hash)
+    MockUpdateBackend store(64 * 1024);
+    LzssDecoder decoder;
+    LzssInflater inflater;
+    auto inflate = [&](const std::vector<uint8_t>& p, size_t limit) {
+        store.begin(64 * 1024);
+        store.write(32 * 1024, p.data(), p.size());
+        BackendReader reader(store, 32 * 1024, p.size());
+        LzssSource source(reader, decoder);
+        LzssResult r = source.begin();
+        return r == LzssResult::OK ? inflater.inflate(source, store, limit) : r;
+    };
+    TEST_ASSERT_EQUAL(LzssResult::OK, inflate(packed, 32 * 1024));
+    TEST_ASSERT_EQUAL(LzssResult::TOO_LARGE, inflate(packed, image.size() - 1));
+
+    std::vector<uint8_t> truncated(packed.begin(), packed.begin() + packed.size() / 2);
+    TEST_ASSERT_EQUAL(LzssResult::CORRUPT, inflate(truncated, 32 * 1024));
+
+    std::vector<uint8_t> notLzss = packed;
+    notLzss[0] = 'X';
+    TEST_ASSERT_EQUAL(LzssResult::BAD_HEADER, inflate(notLzss, 32 * 1024));
+
+    std::vector<uint8_t> flipped = packed;
+    flipped[packed.size() / 2] ^= 0x10;
+    const LzssResult r = inflate(flipped, 32 * 1024);
+    TEST_ASSERT_TRUE(r == LzssResult::TARGET_MISMATCH || r == LzssResult::CORRUPT);
+
+    // Through the backend a failed decode aborts and names the reason
+    MockUpdateBackend small(16 * 1024);
+    VectorBaseImage running(image);
+    StagedUpdateBackend tight(small, running);
+    OtaReceiver ota(tight);
+    TEST_ASSERT_EQUAL(OtaResult::BACKEND_ERROR, deliver(ota, tight, packed));
+    TEST_ASSERT_EQUAL(LzssResult::TOO_LARGE, tight.lastLzssResult());
+    TEST_ASSERT_EQUAL_STRING("TOO_LARGE", tight.failureReason());
+    TEST_ASSERT_FALSE(small.isBootable());
+}
+
+static double chunkAirtimeSeconds(size_t bytes) {
+    // SF9, BW125, CR4/5: one full OTA_DATA frame per 200-byte chunk
+    const double frame = FRAME_OVERHEAD + OTA_CHUNK_HEADER_SIZE + CHUNK;
+    const double bits = 8.0 * frame - 4 * 9 + 28 + 16;
+    const double symbols = 8 + 4.25 + 8 + std::ceil(bits / (4 * 9)) * 5;
+    return std::ceil(bytes / static_cast<double>(CHUNK)) * symbols * 4.096e-3;
+}
+
+static void reportImage(const char* name, const std::vector<uint8_t>& image) {
+    LzssEncoder encoder;
+    auto t0 = std::chrono::steady_clock::now();
+    std::vector<uint8_t> packed = encoder.compress(image.data(), image.size());
+    auto t1 = std::chrono::steady_clock::now();
+
+    // Decoder alone, into 256-byte blocks as the inflater writes them
+    LzssDecoder decoder;
+    std::vector<uint8_t> out(image.size());
+    size_t in = LZSS_HEADER_SIZE;
+    size_t produced = 0;
+    auto t2 = std::chrono::steady_clock::now();
+    while (produced < out.size()) {
+        size_t consumed;
+        const size_t want = out.size() - produced < 256 ? out.size() - produced : 256;
+        produced += decoder.decode(packed.data() + in, packed.size() - in, consumed, out.data() + produced, want);
+        in += consumed;
+    }
+    auto t3 = std::chrono::steady_clock::now();
+    TEST_ASSERT_TRUE(out == image);
+
+    // Whole receive path, raw vs compressed
+    MockUpdateBackend rawFlash(image.size() + packed.size() + 8192);
+    MockUpdateBackend lzssFlash(image.size() + packed.size() + 8192);
+    VectorBaseImage running(image);
+    StagedUpdateBackend rawBackend(rawFlash, running);
+    StagedUpdateBackend lzssBackend(lzssFlash, running);
+    OtaReceiver rawOta(rawBackend);
+    OtaReceiver lzssOta(lzssBackend);
+    auto t4 = std::chrono::steady_clock::now();
+    TEST_ASSERT_EQUAL(OtaResult::OK, deliver(rawOta, rawBackend, image));
+    auto t5 = std::chrono::steady_clock::now();
+    TEST_ASSERT_EQUAL(OtaResult::OK, deliver(lzssOta, lzssBackend, packed));
+    auto t6 = std::chrono::steady_clock::now();
+    TEST_ASSERT_TRUE(startsWith(lzssFlash.image(), image));
+
+    auto ms = [](std::chrono::steady_clock::time_point a, std::chrono::steady_clock::time_point b) {
+        return std::chrono::duration<double, std::milli>(b - a).count();
+    };
+    char msg[220];
+    snprintf(msg, sizeof(msg), "%s: %zu -> %zu bytes (%.1f%%) | airtime %.0f s vs %.0f s raw",
+             name, image.size(), packed.size(), 100.0 * packed.size() / image.size(),
+             chunkAirtimeSeconds(packed.size()), chunkAirtimeSeconds(image.size()));
+    TEST_MESSAGE(msg);
+    snprintf(msg, sizeof(msg), "%s: encode %.0f ms, decode %.0f MB/s, receive + verify %.0f ms raw vs %.0f ms lzss (host)",
+             name, ms(t0, t1), image.size() / 1e3 / ms(t2, t3), ms(t4, t5), ms(t5, t6));
+    TEST_MESSAGE(msg);
+}
+
+static bool loadFile(const char* path, std::vector<uint8_t>& data, size_t limit) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in) {
+        return false;
+    }
+    data.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    if (data.size() > limit) {
+        data.resize(limit);
+    }
+    return !data.empty();
+}
+
+void test_lzss_benchmark() {
+    // RAM the compressed path adds on top of OtaReceiver, all static or on the stack
+    char msg[220];
+    snprintf(msg, sizeof(msg), "peak RAM: decoder %zu + source %zu + reader %zu + inflater %zu = %zu bytes (raw path 0)",
+             sizeof(LzssDecoder), sizeof(LzssSource), sizeof(BackendReader), sizeof(LzssInflater),
+             sizeof(LzssDecoder) + sizeof(LzssSource) + sizeof(BackendReader) + sizeof(LzssInflater));
+    TEST_MESSAGE(msg);
+    TEST_ASSERT_TRUE(sizeof(LzssDecoder) < 2200);
+
+    reportImage("code-like 1 MB", makeCodeLike(1024 * 1024, 8));
+
+    // Real machine code: this test binary (x86/ARM, not Xtensa, but the same kind of content)
+    std::vector<uint8_t> image;
+    if (loadFile("/proc/self/exe", image, 1024 * 1024)) {
+        reportImage("host executable", image);
+    }
+    if (!loadFile(".pio/build/sender/firmware.bin", image, SIZE_MAX)) {
+        TEST_IGNORE_MESSAGE("no .pio/build/sender/firmware.bin; build the sender env for the real image");
+    }
+    reportImage("sender build", image);
+}
+
+void process() {
+    RUN_TEST(test_round_trip_shapes);
+    RUN_TEST(test_decoder_streams_in_any_split);
+    RUN_TEST(test_staged_compressed_image);
+    RUN_TEST(test_compressed_patch);
+    RUN_TEST(test_rejects_bad_streams);
+    RUN_TEST(test_lzss_benchmark);
+}
+
+#ifdef UNIT_TEST
+int main(int argc, char **argv) {
+    UNITY_BEGIN();
+    process();
+    return UNITY_END();
+}
+#endif
@@ -0,0 +1,161 @@
+// Tests for the multi-node network simulator: link budget, capture, repeatability and a dense-network sweep
+#include <unity.h>
+#include "../src/lora/net_sim.h"
+#include "../src/lora/listen_before_talk.h"
+#include <cmath>
+#include <cstdio>
+
+using namespace LoRaLink;
+
+static const LoRaModulation SF9 = loraModulation(9, 125000);
+
+static SimNodeConfig receiverAt(float x, float y) {
+    return SimNodeConfig{ SimRole::RECEIVER, x, y, 0, false, 0 };
+}
+
+static SimNodeConfig senderAt(float x, float y, uint32_t intervalMs, bool poisson = false, uint32_t bootMs = 0) {
+    return SimNodeConfig{ SimRole::SENDER, x, y, intervalMs, poisson, bootMs };
+}
+
+void test_link_budget_and_airtime() {
+    TEST_ASSERT_FLOAT_WITHIN(0.05f, -117.0f, noiseFloorDbm(125000, 6.0f));
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, -7.5f, demodulationSnrDb(7));
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, -20.0f, demodulationSnrDb(12));
+
+    NetSim sim(NetSimConfig::defaultConfig());
+    const size_t gateway = sim.addNode(receiverAt(0, 0));
+    const size_t nearNode = sim.addNode(senderAt(100, 0, 5000));
+    const size_t farNode = sim.addNode(senderAt(0, 2000, 5000, false, 2500));
+    const NetSimReport report = sim.run(300000);
+
+    // SF9 at 17 dBm reaches about 330 m on the default urban fit
+    TEST_ASSERT_FLOAT_WITHIN(0.1f, 127.41f + 20.8f * std::log10(2.5f), sim.pathLossDb(gateway, nearNode));
+    TEST_ASSERT_TRUE(17.0f - sim.pathLossDb(gateway, nearNode) > sim.sensitivityDbm());
+    TEST_ASSERT_TRUE(17.0f - sim.pathLossDb(gateway, farNode) < sim.sensitivityDbm());
+
+    // 60 PINGs each; only the near sender's arrive, all of them
+    TEST_ASSERT_EQUAL_UINT32(120, report.offered);
+    TEST_ASSERT_EQUAL_UINT32(120, report.sent);
+    TEST_ASSERT_EQUAL_UINT32(60, report.delivered);
+    TEST_ASSERT_EQUAL_UINT32(60, report.weak);
+    TEST_ASSERT_EQUAL_UINT32(0, report.collided);
+    TEST_ASSERT_EQUAL(1, sim.linkTable(gateway).size());
+    TEST_ASSERT_EQUAL_UINT32(60, sim.linkTable(gateway).find(0x0101)->frames);
+    TEST_ASSERT_EQUAL_UINT32(0, sim.linkTable(gateway).find(0x0101)->missed);
+
+    // Enqueue to dispatch: CAD, time on air and up to a loop pass on each side
+    const uint32_t frameUs = timeOnAirUs(SF9, PING_FRAME_BYTES);
+    TEST_ASSERT_EQUAL_UINT64(120ull * frameUs, report.airtimeUs);
+    TEST_ASSERT_TRUE(report.latencyP50Us >= frameUs + cadTimeUs(SF9));
+    TEST_ASSERT_TRUE(report.latencyMaxUs <= frameUs + cadTimeUs(SF9) + 3 * 10000);
+}
+
+void test_capture_effect() {
+    NetSimConfig config = NetSimConfig::defaultConfig();
+    config.lbt = false;     // Start both frames within one loop pass of each other
+
+    // Equal power: every pair is lost
+    NetSim even(config);
+    even.addNode(receiverAt(0, 0));
+    even.addNode(senderAt(150, 0, 4000));
+    even.addNode(senderAt(-150, 0, 4000));
+    const NetSimReport evenReport = even.run(120000);
+    TEST_ASSERT_EQUAL_UINT32(60, evenReport.sent);
+    TEST_ASSERT_EQUAL_UINT32(0, evenReport.delivered);
+    // The receiver locks onto the first frame of each pair and loses it to the second
+    TEST_ASSERT_EQUAL_UINT32(30, evenReport.collided);
+    TEST_ASSERT_EQUAL_UINT32(30, evenReport.busy);
+    TEST_ASSERT_EQUAL(0, even.linkTable(0).size());         // CRC errors never reach the link table
+
+    // 16 dB apart: the near frame survives when it starts first. When the far
+    // one does, the receiver stays on it and loses both.
+    NetSim uneven(config);
+    uneven.addNode(receiverAt(0, 0));
+    uneven.addNode(senderAt(50, 0, 4000));
+    uneven.addNode(senderAt(-300, 0, 4000));
+    const NetSimReport unevenReport = uneven.run(120000);
+    TEST_ASSERT_EQUAL_UINT32(60, unevenReport.sent);
+    TEST_ASSERT_EQUAL_UINT32(30, unevenReport.delivered + unevenReport.collided);
+    TEST_ASSERT_EQUAL_UINT32(30, unevenReport.busy);
+    TEST_ASSERT_TRUE(unevenReport.delivered >= 10);
+    const LinkEntry* nearLink = uneven.linkTable(0).find(0x0101);
+    TEST_ASSERT_NOT_NULL(nearLink);
+    TEST_ASSERT_EQUAL_UINT32(unevenReport.delivered, nearLink->frames);
+    TEST_ASSERT_NULL(uneven.linkTable(0).find(0x0102));
+}
+
+void test_same_seed_same_run() {
+    NetSimConfig config = NetSimConfig::defaultConfig();
+    config.shadowingDb = 6.0f;
+    NetSimReport reports[3];
+    const uint32_t seeds[3] = { 7, 7, 8 };
+    for (int i = 0; i < 3; i++) {
+        config.seed = seeds[i];
+        NetSim sim(config);
+        sim.addNode(receiverAt(0, 0));
+        sim.addSenders(30, 400.0f, 5000);
+        reports[i] = sim.run(300000);
+    }
+    TEST_ASSERT_EQUAL_MEMORY(&reports[0], &reports[1], sizeof(NetSimReport));
+    TEST_ASSERT_TRUE(reports[0].offered > 1000);
+    TEST_ASSERT_TRUE(reports[0].offered != reports[2].offered || reports[0].delivered != reports[2].delivered ||
+                     reports[0].latencyAvgUs != reports[2].latencyAvgUs);
+}
+
+void test_dense_network_report() {
+    const size_t counts[] = { 10, 25, 50, 100 };
+    NetSimReport aloha[4];
+    NetSimReport lbt[4];
+    TEST_MESSAGE("One gateway, senders within 300 m, Poisson PINGs every 10 s, SF9/125 kHz, 10 min:");
+    TEST_MESSAGE("  nodes  G     | ALOHA: PDR   coll  bps  p95 ms | LBT: PDR   coll  bps  p95 ms  deferred");
+    for (int i = 0; i < 4; i++) {
+        for (int withLbt = 0; withLbt < 2; withLbt++) {
+            NetSimConfig config = NetSimConfig::defaultConfig();
+            config.seed = 100 + i;
+            config.lbt = withLbt != 0;
+            NetSim sim(config);
+            sim.addNode(receiverAt(0, 0));
+            sim.addSenders(counts[i], 300.0f, 10000);
+            (withLbt ? lbt : aloha)[i] = sim.run(600000);
+        }
+        char msg[200];
+        snprintf(msg, sizeof(msg), "  %5u  %.2f  | %5.1f%% %5lu %5.0f %6.0f | %5.1f%% %5lu %5.0f %6.0f  %lu",
+                 (unsigned)counts[i], aloha[i].channelLoad(), aloha[i].deliveryRatio() * 100.0f,
+                 (unsigned long)aloha[i].collided, aloha[i].throughputBps(), aloha[i].latencyP95Us / 1000.0,
+                 lbt[i].deliveryRatio() * 100.0f, (unsigned long)lbt[i].collided, lbt[i].throughputBps(),
+                 lbt[i].latencyP95Us / 1000.0, (unsigned long)lbt[i].lbtDeferred);
+        TEST_MESSAGE(msg);
+    }
+
+    for (int i = 0; i < 4; i++) {
+        // Every frame at the gateway has one outcome; frames on air at the end have half of one
+        for (const NetSimReport* r : { &aloha[i], &lbt[i] }) {
+            TEST_ASSERT_UINT32_WITHIN(5, r->sent, r->delivered + r->collided + r->weak + r->busy + r->notListening +
+                                                      r->aborted);
+        }
+        TEST_ASSERT_TRUE(lbt[i].deliveryRatio() > aloha[i].deliveryRatio());
+        TEST_ASSERT_TRUE(lbt[i].latencyP95Us > aloha[i].latencyP95Us);
+        // Past G = 0.8 busy channels force frames out (see test_listen_before_talk)
+        if (aloha[i].channelLoad() < 0.8f) {
+            TEST_ASSERT_TRUE(lbt[i].collided < aloha[i].collided);
+        }
+        if (i > 0) {
+            TEST_ASSERT_TRUE(aloha[i].deliveryRatio() < aloha[i - 1].deliveryRatio());
+        }
+    }
+}
+
+void process() {
+    RUN_TEST(test_link_budget_and_airtime);
+    RUN_TEST(test_capture_effect);
+    RUN_TEST(test_same_seed_same_run);
+    RUN_TEST(test_dense_network_report);
+}
+
+#ifdef UNIT_TEST
+int main(int argc, char **argv) {
+    UNITY_BEGIN();
+    process();
+    return UNITY_END();
+}
+#endif
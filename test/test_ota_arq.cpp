@@ -0,0 +1,312 @@
+// Tests for the selective-repeat OTA ARQ over a simulated lossy channel
+#include <unity.h>
+#include "../src/lora/ota_arq.h"
+#include "../src/lora/mock_update_backend.h"
+#include "../src/lora/frame_codec.h"
+#include "lora_test_support.h"
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+using namespace LoRaLink;
+
+// Independent frame loss with a fixed seed
+struct LossyChannel {
+    uint32_t lossPerMille;
+    TestRng rng;
+    uint32_t airtimeUs;
+    uint32_t frames;
+
+    LossyChannel(uint32_t lossPerMille, uint32_t seed) : lossPerMille(lossPerMille), rng(seed), airtimeUs(0), frames(0) {}
+
+    bool deliver(size_t frameLength) {
+        airtimeUs += LoRaTest::airtimeUs(frameLength);
+        frames++;
+        return !rng.chance(lossPerMille);
+    }
+};
+
+struct TransferResult {
+    bool ok;
+    uint32_t airtimeUs;
+    uint32_t frames;
+};
+
+// Receiving node as main.cpp drives it: NACK on START and on every poll,
+// finish as soon as the last chunk lands
+static void replyNack(OtaReceiver& ota, OtaSender& sender, LossyChannel& channel, uint32_t nowMs) {
+    uint8_t payload[MAX_PAYLOAD_SIZE];
+    size_t len = encodeOtaNack(ota, payload, sizeof(payload));
+    if (len > 0 && channel.deliver(FRAME_OVERHEAD + len)) {
+        sender.onNack(payload, len, nowMs);
+    }
+}
+
+static TransferResult runArq(const std::vector<uint8_t>& image, uint32_t lossPerMille, uint32_t seed,
+                             OtaSender& sender) {
+    MockUpdateBackend backend;
+    OtaReceiver ota(backend);
+    LossyChannel channel(lossPerMille, seed);
+    const OtaStartInfo info = startFor(image);
+    uint32_t nowMs = 0;
+
+    sender.begin(info.imageSize, CHUNK, nowMs);
+    while (sender.isActive() && nowMs < 24u * 3600u * 1000u) {
+        uint16_t index = 0;
+        OtaSendAction action = sender.next(nowMs, index);
+        if (action == OtaSendAction::NONE) {
+            nowMs += 10;
+            continue;
+        }
+
+        size_t frameLength = FRAME_OVERHEAD;
+        if (action == OtaSendAction::START) {
+            frameLength += OTA_START_PAYLOAD_SIZE;
+        } else if (action == OtaSendAction::CHUNK) {
+            const size_t offset = static_cast<size_t>(index) * CHUNK;
+            frameLength += OTA_CHUNK_HEADER_SIZE + (image.size() - offset < CHUNK ? image.size() - offset : CHUNK);
+        }
+        const uint32_t air = airtimeUs(frameLength);
+        nowMs += air / 1000;
+        sender.onSent(nowMs, air);
+        if (!channel.deliver(frameLength)) {
+            continue;
+        }
+
+        if (action == OtaSendAction::START) {
+            if (!ota.isActive()) {
+                ota.start(info, nowMs);
+            }
+            replyNack(ota, sender, channel, nowMs);
+        } else if (action == OtaSendAction::CHUNK) {
+            const size_t offset = static_cast<size_t>(index) * CHUNK;
+            const size_t len = image.size() - offset < CHUNK ? image.size() - offset : CHUNK;
+            if (ota.onChunk(index, image.data() + offset, len, nowMs) == OtaResult::OK && ota.missingChunks() == 0) {
+                ota.finish();
+            }
+        } else {
+            replyNack(ota, sender, channel, nowMs);
+        }
+    }
+
+    TransferResult result = { sender.getState() == OtaSenderState::DONE && backend.image() == image,
+                              channel.airtimeUs, channel.frames };
+    return result;
+}
+
+// The pre-ARQ scheme: stream the whole image, start over if anything was lost
+static TransferResult runBlind(const std::vector<uint8_t>& image, uint32_t lossPerMille, uint32_t seed,
+                               uint32_t maxPasses) {
+    LossyChannel channel(lossPerMille, seed);
+    const uint32_t chunks = (image.size() + CHUNK - 1) / CHUNK;
+    for (uint32_t pass = 0; pass < maxPasses; ++pass) {
+        bool clean = channel.deliver(FRAME_OVERHEAD + OTA_START_PAYLOAD_SIZE);
+        for (uint32_t i = 0; i < chunks; ++i) {
+            const size_t offset = static_cast<size_t>(i) * CHUNK;
+            const size_t len = image.size() - offset < CHUNK ? image.size() - offset : CHUNK;
+            clean = channel.deliver(FRAME_OVERHEAD + OTA_CHUNK_HEADER_SIZE + len) && clean;
+        }
+        clean = channel.deliver(FRAME_OVERHEAD) && clean;
+        if (clean) {
+            TransferResult result = { true, channel.airtimeUs, channel.frames };
+            return result;
+        }
+    }
+    TransferResult result = { false, channel.airtimeUs, channel.frames };
+    return result;
+}
+
+void test_nack_encoding() {
+    std::vector<uint8_t> image = makeImage(100 * CHUNK, 1);
+    MockUpdateBackend backend;
+    OtaReceiver ota(backend);
+    uint8_t payload[MAX_PAYLOAD_SIZE];
+    TEST_ASSERT_EQUAL(0, encodeOtaNack(ota, payload, sizeof(payload)));     // No session
+
+    ota.start(startFor(image), 0);
+    for (uint32_t i = 0; i < 100; ++i) {
+        if (i != 3 && i != 12 && i < 40) {
+            ota.onChunk(static_cast<uint16_t>(i), image.data() + i * CHUNK, CHUNK, 0);
+        }
+    }
+
+    size_t len = encodeOtaNack(ota, payload, sizeof(payload));
+    OtaNack nack;
+    TEST_ASSERT_TRUE(decodeOtaNack(payload, len, nack));
+    TEST_ASSERT_EQUAL_UINT16(3, nack.base);
+    TEST_ASSERT_EQUAL_UINT16(62, nack.missing);
+    TEST_ASSERT_EQUAL(OtaNackStatus::RECEIVING, nack.status);
+    // Chunks 3..42 described; the all-missing tail is trimmed
+    TEST_ASSERT_EQUAL(5, nack.bitmapSize);
+    TEST_ASSERT_EQUAL_HEX8(0x01, nack.bitmap[0]);       // 3 missing, 4..10 present
+    TEST_ASSERT_EQUAL_HEX8(0x02, nack.bitmap[1]);       // 12 missing
+    TEST_ASSERT_EQUAL_HEX8(0xE0, nack.bitmap[4]);       // 40..42 missing
+
+    TEST_ASSERT_FALSE(decodeOtaNack(payload, 4, nack));
+    payload[4] = 9;
+    TEST_ASSERT_FALSE(decodeOtaNack(payload, len, nack));
+}
+
+void test_sender_retransmits_only_gaps() {
+    OtaSenderConfig config = OtaSender::defaultConfig();
+    config.windowChunks = 16;
+    OtaSender sender(config);
+    TEST_ASSERT_TRUE(sender.begin(16 * CHUNK, CHUNK, 0));
+
+    uint16_t index = 0;
+    TEST_ASSERT_EQUAL(OtaSendAction::START, sender.next(0, index));
+    TEST_ASSERT_EQUAL(OtaSendAction::NONE, sender.next(0, index));          // Not sent yet
+    sender.onSent(10);
+    TEST_ASSERT_EQUAL(OtaSendAction::NONE, sender.next(20, index));         // Waiting for the START NACK
+
+    uint8_t nack[OTA_NACK_HEADER_SIZE + 2] = { 0, 0, 16, 0, 0, 0xFF, 0xFF };
+    TEST_ASSERT_TRUE(sender.onNack(nack, OTA_NACK_HEADER_SIZE, 30));
+    TEST_ASSERT_EQUAL(OtaSenderState::SENDING, sender.getState());
+
+    for (uint16_t expected = 0; expected < 16; ++expected) {
+        TEST_ASSERT_EQUAL(OtaSendAction::CHUNK, sender.next(100, index));
+        TEST_ASSERT_EQUAL_UINT16(expected, index);
+        sender.onSent(100);
+    }
+    TEST_ASSERT_EQUAL(OtaSendAction::POLL, sender.next(100, index));
+    sender.onSent(100);
+
+    // Receiver lost 2 and 9: base 2, bitmap 2..17 with 16 and 17 past the end
+    uint8_t gaps[OTA_NACK_HEADER_SIZE + 2] = { 2, 0, 2, 0, 0, 0x81, 0xC0 };
+    TEST_ASSERT_TRUE(sender.onNack(gaps, sizeof(gaps), 200));
+    TEST_ASSERT_EQUAL_UINT32(14, sender.chunksAcked());
+    TEST_ASSERT_EQUAL_UINT32(2, sender.getStats().chunksLost);
+
+    TEST_ASSERT_EQUAL(OtaSendAction::CHUNK, sender.next(10000, index));
+    TEST_ASSERT_EQUAL_UINT16(2, index);
+    sender.onSent(10000);
+    TEST_ASSERT_EQUAL(OtaSendAction::CHUNK, sender.next(20000, index));
+    TEST_ASSERT_EQUAL_UINT16(9, index);
+    sender.onSent(20000);
+    TEST_ASSERT_EQUAL(OtaSendAction::POLL, sender.next(30000, index));
+    TEST_ASSERT_EQUAL_UINT32(2, sender.getStats().retransmits);
+
+    uint8_t done[OTA_NACK_HEADER_SIZE] = { 16, 0, 0, 0, 1 };
+    sender.onSent(30000);
+    sender.onNack(done, sizeof(done), 30100);
+    TEST_ASSERT_EQUAL(OtaSenderState::DONE, sender.getState());
+    TEST_ASSERT_EQUAL(100, sender.percent());
+}
+
+void test_unanswered_polls_give_up() {
+    OtaSenderConfig config = OtaSender::defaultConfig();
+    config.maxRetries = 3;
+    OtaSender sender(config);
+    sender.begin(1000, CHUNK, 0);
+
+    uint32_t nowMs = 0;
+    uint32_t starts = 0;
+    uint16_t index;
+    while (sender.isActive() && nowMs < 60000) {
+        if (sender.next(nowMs, index) == OtaSendAction::START) {
+            starts++;
+            sender.onSent(nowMs);
+        }
+        nowMs += 100;
+    }
+    TEST_ASSERT_EQUAL(OtaSenderState::FAILED, sender.getState());
+    TEST_ASSERT_EQUAL_UINT32(3, starts);
+    TEST_ASSERT_TRUE(nowMs >= 3 * config.replyTimeoutMs);
+}
+
+// Send every chunk the window allows, then the poll; returns the time after it
+static uint32_t drainWindow(OtaSender& sender, uint32_t nowMs) {
+    uint16_t index;
+    OtaSendAction action;
+    while ((action = sender.next(nowMs, index)) != OtaSendAction::POLL) {
+        if (action == OtaSendAction::CHUNK) {
+            sender.onSent(nowMs);
+        }
+        nowMs += 10;
+    }
+    sender.onSent(nowMs);
+    return nowMs;
+}
+
+void test_pacing_follows_measured_loss() {
+    OtaSenderConfig config = OtaSender::defaultConfig();
+    config.windowChunks = 10;
+    OtaSender sender(config);
+    sender.begin(1000 * CHUNK, CHUNK, 0);
+    uint16_t index;
+    sender.next(0, index);
+    sender.onSent(0);
+    uint8_t nack[OTA_NACK_HEADER_SIZE + 2] = { 0, 0, 0xE8, 0x03, 0, 0, 0 };
+    sender.onNack(nack, OTA_NACK_HEADER_SIZE, 0);
+    TEST_ASSERT_EQUAL_UINT32(0, sender.gapMs());
+
+    uint32_t nowMs = 0;
+    // Two rounds where every other chunk of the window is lost: the gap widens
+    for (int round = 0; round < 2; ++round) {
+        nowMs = drainWindow(sender, nowMs);
+        nack[5] = 0x55;     // 0, 2, 4, 6 and 8 missing
+        nack[6] = 0x01;
+        sender.onNack(nack, OTA_NACK_HEADER_SIZE + 2, nowMs);
+    }
+    const uint32_t widened = sender.gapMs();
+    TEST_ASSERT_TRUE(widened >= config.gapStepMs * 3);
+    TEST_ASSERT_TRUE(sender.lossPct() > config.highLossPct);
+
+    // Clean rounds: everything sent arrives and the gap comes back down
+    uint16_t base = 0;
+    for (int round = 0; round < 4; ++round) {
+        nowMs = drainWindow(sender, nowMs);
+        base += 10;
+        Wire::putU16(nack, base);
+        sender.onNack(nack, OTA_NACK_HEADER_SIZE, nowMs);
+    }
+    TEST_ASSERT_EQUAL_UINT32(40, sender.chunksAcked());
+    TEST_ASSERT_TRUE(sender.gapMs() < widened);
+}
+
+// Full transfers through the lossy channel, compared with blind full resends
+void test_arq_airtime_vs_blind_resend() {
+    static OtaSender sender;
+    char msg[200];
+
+    std::vector<uint8_t> small = makeImage(16 * 1024, 7);
+    const uint32_t lossLevels[] = { 20, 50 };
+    for (uint32_t loss : lossLevels) {
+        TransferResult arq = runArq(small, loss, 1234, sender);
+        TransferResult blind = runBlind(small, loss, 1234, 500);
+        TEST_ASSERT_TRUE(arq.ok);
+        TEST_ASSERT_TRUE(arq.airtimeUs < blind.airtimeUs);
+        snprintf(msg, sizeof(msg), "16 KB, %u.%u%% loss: ARQ %u frames %.1f s airtime | blind resend %u frames %.1f s%s",
+                 (unsigned)(loss / 10), (unsigned)(loss % 10), (unsigned)arq.frames, arq.airtimeUs / 1e6,
+                 (unsigned)blind.frames, blind.airtimeUs / 1e6, blind.ok ? "" : " (gave up after 500 passes)");
+        TEST_MESSAGE(msg);
+    }
+
+    // A real-sized image at 10% loss; blind resend would never finish
+    std::vector<uint8_t> large = makeImage(480 * 1024, 9);
+    const uint32_t chunks = (large.size() + CHUNK - 1) / CHUNK;
+    TransferResult arq = runArq(large, 100, 99, sender);
+    TEST_ASSERT_TRUE(arq.ok);
+    const OtaSenderStats& stats = sender.getStats();
+    TEST_ASSERT_EQUAL_UINT32(chunks, stats.chunksSent - stats.retransmits);
+    snprintf(msg, sizeof(msg), "480 KB, 10%% loss: %u chunks, %u retransmits, %u polls, %u NACKs, %.1f min airtime (%.2fx a lossless pass)",
+             (unsigned)chunks, (unsigned)stats.retransmits, (unsigned)stats.polls, (unsigned)stats.nacks,
+             arq.airtimeUs / 60e6, arq.airtimeUs / (double)runBlind(large, 0, 1, 1).airtimeUs);
+    TEST_MESSAGE(msg);
+}
+
+void process() {
+    RUN_TEST(test_nack_encoding);
+    RUN_TEST(test_sender_retransmits_only_gaps);
+    RUN_TEST(test_unanswered_polls_give_up);
+    RUN_TEST(test_pacing_follows_measured_loss);
+    RUN_TEST(test_arq_airtime_vs_blind_resend);
+}
+
+#ifdef UNIT_TEST
+int main(int argc, char **argv) {
+    UNITY_BEGIN();
+    process();
+    return UNITY_END();
+}
+#endif
@@ -0,0 +1,320 @@
+// Tests for erasure-coded OTA broadcast, including a many-node lossy simulation
+#include <unity.h>
+#include "../src/lora/ota_fec.h"
+#include "../src/lora/mock_update_backend.h"
+#include "lora_test_support.h"
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+using namespace LoRaLink;
+
+// Broadcasts run for minutes
+static const uint32_t BROADCAST_TIMEOUT_MS = 600000;
+
+void test_decoder_rebuilds_block_from_repairs_only() {
+    std::vector<uint8_t> image = makeImage(32 * CHUNK, 3);
+    FecLayout layout(static_cast<uint32_t>(image.size()), CHUNK);
+    TEST_ASSERT_EQUAL(1, layout.blockCount);
+    TEST_ASSERT_EQUAL(32, layout.chunksInBlock(0));
+
+    FecDecoder decoder;
+    decoder.begin(0, 32, CHUNK);
+    uint8_t packet[MAX_PAYLOAD_SIZE];
+    uint16_t seq = 32;
+    uint32_t sent = 0;
+    while (!decoder.isComplete() && sent < 64) {
+        uint32_t mask = fecRepairMask(0, seq++, 32);
+        TEST_ASSERT_EQUAL(OTA_CODED_HEADER_SIZE + CHUNK, encodeCodedPacket(layout, image.data(), 0, mask, packet, sizeof(packet)));
+        decoder.add(mask, packet + OTA_CODED_HEADER_SIZE);
+        sent++;
+    }
+    TEST_ASSERT_TRUE(decoder.isComplete());
+    TEST_ASSERT_TRUE(sent <= 32 + 6);
+    for (uint8_t i = 0; i < 32; ++i) {
+        TEST_ASSERT_EQUAL_UINT8_ARRAY(image.data() + i * CHUNK, decoder.chunk(i), CHUNK);
+    }
+
+    // Masks outside the block are rejected; a spanned packet is redundant
+    decoder.begin(0, 4, CHUNK);
+    TEST_ASSERT_EQUAL(FecAddResult::INVALID, decoder.add(0x10, packet));
+    TEST_ASSERT_EQUAL(FecAddResult::INNOVATIVE, decoder.add(0x3, packet));
+    TEST_ASSERT_EQUAL(FecAddResult::INNOVATIVE, decoder.add(0x1, packet));
+    TEST_ASSERT_EQUAL(FecAddResult::REDUNDANT, decoder.add(0x2, packet));
+    TEST_ASSERT_EQUAL(2, decoder.needed());
+}
+
+void test_receiver_writes_short_last_block() {
+    std::vector<uint8_t> image = makeImage(40 * CHUNK + 77, 5);   // Blocks of 32 and 9 chunks
+    FecLayout layout(static_cast<uint32_t>(image.size()), CHUNK);
+    TEST_ASSERT_EQUAL(2, layout.blockCount);
+    TEST_ASSERT_EQUAL(9, layout.chunksInBlock(1));
+
+    MockUpdateBackend backend(64 * 1024);
+    OtaReceiver ota(backend);
+    FecReceiver fec(ota, backend);
+    uint8_t packet[MAX_PAYLOAD_SIZE];
+    TEST_ASSERT_EQUAL(OtaResult::NOT_ACTIVE, fec.onCoded(packet, OTA_CODED_HEADER_SIZE + CHUNK, 0));
+    ota.start(startFor(image), 0);
+
+    // Block 0: every third source packet lost, repaired afterwards
+    for (uint16_t i = 0; i < 32; ++i) {
+        if (i % 3 != 0) {
+            size_t len = encodeCodedPacket(layout, image.data(), 0, 1u << i, packet, sizeof(packet));
+            TEST_ASSERT_EQUAL(OtaResult::OK, fec.onCoded(packet, len, 0));
+        }
+    }
+    TEST_ASSERT_EQUAL(11, fec.neededFor(0));
+    uint8_t need[OTA_BLOCK_NEED_SIZE];
+    TEST_ASSERT_EQUAL(OTA_BLOCK_NEED_SIZE, fec.encodeNeed(FEC_SWEEP_BLOCK, need, sizeof(need)));
+    TEST_ASSERT_EQUAL_UINT16(0, Wire::getU16(need));
+    TEST_ASSERT_EQUAL(11, need[2]);
+    for (uint16_t seq = 32; fec.neededFor(0) > 0; ++seq) {
+        size_t len = encodeCodedPacket(layout, image.data(), 0, fecRepairMask(0, seq, 32), packet, sizeof(packet));
+        fec.onCoded(packet, len, 0);
+    }
+
+    // Block 1 from repairs alone, including the zero-padded last chunk
+    for (uint16_t seq = 9; fec.neededFor(1) > 0; ++seq) {
+        size_t len = encodeCodedPacket(layout, image.data(), 1, fecRepairMask(1, seq, 9), packet, sizeof(packet));
+        fec.onCoded(packet, len, 0);
+    }
+    TEST_ASSERT_EQUAL(0, ota.missingChunks());
+    TEST_ASSERT_EQUAL(0, fec.encodeNeed(FEC_SWEEP_BLOCK, need, sizeof(need)));
+    TEST_ASSERT_EQUAL(OtaResult::OK, ota.finish());
+    TEST_ASSERT_TRUE(backend.image() == image);
+    TEST_ASSERT_EQUAL(2, fec.getStats().blocksDecoded);
+}
+
+void test_broadcaster_sequence() {
+    FecBroadcastConfig config = FecBroadcaster::defaultConfig();
+    config.redundancyPct = 25;
+    FecBroadcaster tx(config);
+    TEST_ASSERT_TRUE(tx.begin(40 * CHUNK, CHUNK, 0));
+    TEST_ASSERT_FALSE(tx.begin(40 * CHUNK, FEC_MAX_CHUNK + 1, 0));
+    tx.begin(40 * CHUNK, CHUNK, 0);
+
+    uint32_t nowMs = 0;
+    uint16_t block;
+    uint32_t mask;
+    for (int i = 0; i < config.startRepeats; ++i) {
+        TEST_ASSERT_EQUAL(FecAction::START, tx.next(nowMs, block, mask));
+        tx.onSent(nowMs);
+    }
+    // 32 source packets then 8 repairs, then the poll
+    for (int i = 0; i < 40; ++i) {
+        TEST_ASSERT_EQUAL(FecAction::CODED, tx.next(nowMs, block, mask));
+        TEST_ASSERT_EQUAL_UINT16(0, block);
+        if (i < 32) {
+            TEST_ASSERT_EQUAL_HEX32(1u << i, mask);
+        }
+        tx.onSent(nowMs);
+    }
+    TEST_ASSERT_EQUAL(FecAction::POLL, tx.next(nowMs, block, mask));
+    TEST_ASSERT_EQUAL_UINT16(0, block);
+    tx.onSent(nowMs);
+    TEST_ASSERT_EQUAL(FecAction::NONE, tx.next(nowMs + 100, block, mask));
+
+    // Two listeners short by 3 and 5: five more repairs for everyone
+    const uint8_t short3[] = { 0, 0, 3 };
+    const uint8_t short5[] = { 0, 0, 5 };
+    tx.onNeed(short3, sizeof(short3));
+    tx.onNeed(short5, sizeof(short5));
+    nowMs += config.pollSlotMs;
+    for (int i = 0; i < 5; ++i) {
+        TEST_ASSERT_EQUAL(FecAction::CODED, tx.next(nowMs, block, mask));
+        tx.onSent(nowMs);
+    }
+    TEST_ASSERT_EQUAL(FecAction::POLL, tx.next(nowMs, block, mask));
+    tx.onSent(nowMs);
+    TEST_ASSERT_TRUE(tx.redundancyPct() > 25);
+
+    // Quiet slot: block 1 (8 chunks)
+    nowMs += config.pollSlotMs;
+    TEST_ASSERT_EQUAL(FecAction::CODED, tx.next(nowMs, block, mask));
+    TEST_ASSERT_EQUAL_UINT16(1, block);
+    tx.onSent(nowMs);
+    while (tx.next(nowMs, block, mask) == FecAction::CODED) {
+        tx.onSent(nowMs);
+    }
+    tx.onSent(nowMs);
+    nowMs += config.pollSlotMs;
+
+    // Sweep: a listener that lost block 0 gets it revisited with fresh repairs
+    TEST_ASSERT_EQUAL(FecAction::START, tx.next(nowMs, block, mask));
+    tx.onSent(nowMs);
+    TEST_ASSERT_EQUAL(FecAction::POLL, tx.next(nowMs, block, mask));
+    TEST_ASSERT_EQUAL_UINT16(FEC_SWEEP_BLOCK, block);
+    tx.onSent(nowMs);
+    const uint8_t lostBlock[] = { 0, 0, 32 };
+    tx.onNeed(lostBlock, sizeof(lostBlock));
+    nowMs += config.pollSlotMs;
+    TEST_ASSERT_EQUAL(FecAction::CODED, tx.next(nowMs, block, mask));
+    TEST_ASSERT_EQUAL_UINT16(0, block);
+    TEST_ASSERT_TRUE((mask & (mask - 1)) != 0 || mask == 0);
+    TEST_ASSERT_EQUAL_UINT32(1, tx.getStats().blocksRevisited);
+    tx.cancel();
+    TEST_ASSERT_FALSE(tx.isActive());
+}
+
+// One listener in the simulation
+struct Node {
+    MockUpdateBackend backend;
+    OtaReceiver ota;
+    FecReceiver fec;
+    uint32_t lossPerMille;
+
+    explicit Node(uint32_t loss)
+        : backend(64 * 1024)
+        , ota(backend)
+        , fec(ota, backend)
+        , lossPerMille(loss)
+    {
+    }
+};
+
+struct BroadcastResult {
+    uint32_t airtimeUs;
+    uint32_t frames;
+    uint32_t completed;
+    double unicastFloorUs;      // Per-node delivery with perfect feedback
+};
+
+// Frames are lost independently per listener; every answer to a poll
+// costs its airtime (collisions are folded into the loss rate)
+static BroadcastResult simulateBroadcast(const std::vector<uint8_t>& image, const std::vector<uint32_t>& losses,
+                                         uint32_t seed) {
+    TestRng rng(seed);
+    OtaStartInfo info = startFor(image);
+    info.timeoutMs = BROADCAST_TIMEOUT_MS;
+    const FecLayout layout(info.imageSize, CHUNK);
+    std::vector<std::unique_ptr<Node>> nodes;
+    for (uint32_t loss : losses) {
+        nodes.emplace_back(new Node(loss));
+    }
+
+    FecBroadcaster tx;
+    tx.begin(info.imageSize, CHUNK, 0);
+    uint8_t startPayload[OTA_START_PAYLOAD_SIZE];
+    encodeOtaStart(info, startPayload, sizeof(startPayload));
+    uint8_t packet[MAX_PAYLOAD_SIZE];
+    uint32_t nowMs = 0;
+    uint32_t airtime = 0;
+    uint32_t frames = 0;
+
+    while (tx.isActive() && nowMs < 24u * 3600u * 1000u) {
+        uint16_t block = 0;
+        uint32_t mask = 0;
+        FecAction action = tx.next(nowMs, block, mask);
+        if (action == FecAction::NONE) {
+            nowMs += 50;
+            continue;
+        }
+
+        size_t frameLength = FRAME_OVERHEAD;
+        if (action == FecAction::START) {
+            frameLength += OTA_START_PAYLOAD_SIZE;
+        } else if (action == FecAction::CODED) {
+            frameLength += encodeCodedPacket(layout, image.data(), block, mask, packet, sizeof(packet));
+        } else {
+            frameLength += OTA_BLOCK_POLL_SIZE;
+        }
+        const uint32_t air = airtimeUs(frameLength);
+        airtime += air;
+        frames++;
+        nowMs += air / 1000;
+        tx.onSent(nowMs, air);
+
+        for (auto& node : nodes) {
+            if (rng.chance(node->lossPerMille)) {
+                continue;
+            }
+            if (action == FecAction::START) {
+                if (node->ota.getState() == OtaState::IDLE) {
+                    node->ota.start(info, nowMs);
+                }
+            } else if (action == FecAction::CODED) {
+                if (node->fec.onCoded(packet, frameLength - FRAME_OVERHEAD, nowMs) == OtaResult::OK &&
+                    node->ota.isActive() && node->ota.missingChunks() == 0) {
+                    node->ota.finish();
+                }
+            } else {
+                uint8_t need[OTA_BLOCK_NEED_SIZE];
+                size_t len = node->fec.encodeNeed(block, need, sizeof(need));
+                if (len > 0) {
+                    airtime += airtimeUs(FRAME_OVERHEAD + len);
+                    frames++;
+                    if (!rng.chance(node->lossPerMille)) {
+                        tx.onNeed(need, len);
+                    }
+                }
+            }
+        }
+    }
+
+    BroadcastResult result = { airtime, frames, 0, 0.0 };
+    const double chunkAir = airtimeUs(FRAME_OVERHEAD + OTA_CHUNK_HEADER_SIZE + CHUNK);
+    for (auto& node : nodes) {
+        if (node->ota.getState() == OtaState::COMPLETE && node->backend.image() == image) {
+            result.completed++;
+        }
+        result.unicastFloorUs += layout.chunkCount * chunkAir / (1.0 - node->lossPerMille / 1000.0);
+    }
+    return result;
+}
+
+void test_broadcast_scales_with_worst_link() {
+    std::vector<uint8_t> image = makeImage(16 * 1024, 11);
+    const uint32_t nodeCounts[] = { 1, 10, 50, 100 };
+    const uint32_t lossLevels[] = { 50, 100, 200 };
+    char msg[200];
+    uint32_t previousAirtime = 0;
+
+    for (uint32_t loss : lossLevels) {
+        for (uint32_t n : nodeCounts) {
+            std::vector<uint32_t> losses(n, loss);
+            BroadcastResult r = simulateBroadcast(image, losses, 1000 + n + loss);
+            snprintf(msg, sizeof(msg), "%3u nodes @ %2u%% loss: %4u frames, %6.1f s airtime, %3u/%u complete | per-node unicast >= %7.1f s",
+                     (unsigned)n, (unsigned)(loss / 10), (unsigned)r.frames, r.airtimeUs / 1e6,
+                     (unsigned)r.completed, (unsigned)n, r.unicastFloorUs / 1e6);
+            TEST_MESSAGE(msg);
+            TEST_ASSERT_EQUAL_UINT32(n, r.completed);
+            if (n >= 10) {
+                TEST_ASSERT_TRUE(r.airtimeUs < r.unicastFloorUs);
+            }
+            if (n == 1) {
+                previousAirtime = r.airtimeUs;
+            } else if (n == 100) {
+                // 100x the listeners, nowhere near 100x the airtime
+                TEST_ASSERT_TRUE(r.airtimeUs < previousAirtime * 4);
+            }
+        }
+    }
+
+    // Mixed links: 0..30% loss; the worst one sets the pace
+    std::vector<uint32_t> mixed;
+    for (uint32_t i = 0; i < 100; ++i) {
+        mixed.push_back((i * 300) / 99);
+    }
+    BroadcastResult r = simulateBroadcast(image, mixed, 77);
+    snprintf(msg, sizeof(msg), "100 nodes @ 0-30%% loss: %4u frames, %6.1f s airtime, %3u/100 complete | per-node unicast >= %7.1f s",
+             (unsigned)r.frames, r.airtimeUs / 1e6, (unsigned)r.completed, r.unicastFloorUs / 1e6);
+    TEST_MESSAGE(msg);
+    TEST_ASSERT_EQUAL_UINT32(100, r.completed);
+}
+
+void process() {
+    RUN_TEST(test_decoder_rebuilds_block_from_repairs_only);
+    RUN_TEST(test_receiver_writes_short_last_block);
+    RUN_TEST(test_broadcaster_sequence);
+    RUN_TEST(test_broadcast_scales_with_worst_link);
+}
+
+#ifdef UNIT_TEST
+int main(int argc, char **argv) {
+    UNITY_BEGIN();
+    process();
+    return UNITY_END();
+}
+#endif
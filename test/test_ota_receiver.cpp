@@ -0,0 +1,192 @@
+// Tests for the streaming LoRa OTA receiver against a RAM-backed update partition
+#include <unity.h>
+#include "../src/lora/ota_receiver.h"
+#include "../src/lora/mock_update_backend.h"
+#include "../src/lora/frame_codec.h"
+#include "lora_test_support.h"
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+using namespace LoRaLink;
+
+static OtaResult sendChunk(OtaReceiver& ota, const std::vector<uint8_t>& image, uint32_t index, uint32_t nowMs = 0) {
+    size_t offset = static_cast<size_t>(index) * CHUNK;
+    size_t len = image.size() - offset < CHUNK ? image.size() - offset : CHUNK;
+    return ota.onChunk(static_cast<uint16_t>(index), image.data() + offset, len, nowMs);
+}
+
+static void toHex(const uint8_t* digest, char* out) {
+    for (size_t i = 0; i < Sha256::DIGEST_SIZE; ++i) {
+        snprintf(out + i * 2, 3, "%02x", digest[i]);
+    }
+}
+
+void test_sha256_known_vectors() {
+    uint8_t digest[Sha256::DIGEST_SIZE];
+    char hex[Sha256::DIGEST_SIZE * 2 + 1];
+
+    Sha256::hash(reinterpret_cast<const uint8_t*>("abc"), 3, digest);
+    toHex(digest, hex);
+    TEST_ASSERT_EQUAL_STRING("ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad", hex);
+
+    Sha256::hash(nullptr, 0, digest);
+    toHex(digest, hex);
+    TEST_ASSERT_EQUAL_STRING("e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855", hex);
+
+    // Incremental updates across block boundaries match the one-shot digest
+    std::vector<uint8_t> data = makeImage(1000, 7);
+    uint8_t oneShot[Sha256::DIGEST_SIZE];
+    Sha256::hash(data.data(), data.size(), oneShot);
+    Sha256 sha;
+    for (size_t off = 0; off < data.size(); off += 37) {
+        sha.update(data.data() + off, data.size() - off < 37 ? data.size() - off : 37);
+    }
+    sha.finish(digest);
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(oneShot, digest, sizeof(digest));
+}
+
+void test_ota_start_payload_roundtrip() {
+    std::vector<uint8_t> image = makeImage(5000, 1);
+    OtaStartInfo info = startFor(image);
+    uint8_t payload[OTA_START_PAYLOAD_SIZE];
+    TEST_ASSERT_EQUAL(OTA_START_PAYLOAD_SIZE, encodeOtaStart(info, payload, sizeof(payload)));
+    TEST_ASSERT_TRUE(OTA_START_PAYLOAD_SIZE <= MAX_PAYLOAD_SIZE);
+
+    OtaStartInfo decoded;
+    TEST_ASSERT_TRUE(decodeOtaStart(payload, sizeof(payload), decoded));
+    TEST_ASSERT_EQUAL_UINT32(5000, decoded.imageSize);
+    TEST_ASSERT_EQUAL_UINT32(30000, decoded.timeoutMs);
+    TEST_ASSERT_EQUAL_UINT16(CHUNK, decoded.chunkSize);
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(info.sha256, decoded.sha256, Sha256::DIGEST_SIZE);
+    TEST_ASSERT_FALSE(decodeOtaStart(payload, 8, decoded));
+}
+
+// A multi-hundred-KB image streamed out of order with duplicates
+void test_streams_large_image_out_of_order() {
+    std::vector<uint8_t> image = makeImage(480 * 1024 + 77, 42);
+    MockUpdateBackend backend;
+    OtaReceiver ota(backend);
+    TEST_ASSERT_EQUAL(OtaResult::OK, ota.start(startFor(image), 0));
+    const uint32_t chunks = ota.chunkCount();
+    TEST_ASSERT_EQUAL_UINT32((image.size() + CHUNK - 1) / CHUNK, chunks);
+
+    // Evens first, then odds backwards, then a few repeats
+    for (uint32_t i = 0; i < chunks; i += 2) {
+        TEST_ASSERT_EQUAL(OtaResult::OK, sendChunk(ota, image, i));
+    }
+    TEST_ASSERT_EQUAL(OtaResult::INCOMPLETE, ota.finish());
+    TEST_ASSERT_EQUAL_UINT32(1, ota.nextMissing());
+    for (int32_t i = static_cast<int32_t>(chunks - 1); i >= 0; --i) {
+        if (i % 2 == 1) {
+            TEST_ASSERT_EQUAL(OtaResult::OK, sendChunk(ota, image, i));
+        }
+    }
+    TEST_ASSERT_EQUAL(OtaResult::DUPLICATE, sendChunk(ota, image, 5));
+    TEST_ASSERT_EQUAL(OtaResult::DUPLICATE, sendChunk(ota, image, chunks - 1));
+
+    TEST_ASSERT_EQUAL(100, ota.percent());
+    TEST_ASSERT_EQUAL(OtaResult::OK, ota.finish());
+    TEST_ASSERT_EQUAL(OtaState::COMPLETE, ota.getState());
+    TEST_ASSERT_TRUE(backend.isBootable());
+    TEST_ASSERT_EQUAL(0, backend.getStats().rewrites);
+    TEST_ASSERT_TRUE(backend.image() == image);
+    TEST_ASSERT_EQUAL(2, ota.getStats().duplicates);
+
+    char msg[160];
+    snprintf(msg, sizeof(msg), "%u-byte image: %u chunks, %u flash writes, receiver RAM %u bytes (image never buffered)",
+             (unsigned)image.size(), (unsigned)chunks, (unsigned)backend.getStats().writes,
+             (unsigned)sizeof(OtaReceiver));
+    TEST_MESSAGE(msg);
+    TEST_ASSERT_TRUE(sizeof(OtaReceiver) < 4096);
+}
+
+void test_rejects_bad_chunks() {
+    std::vector<uint8_t> image = makeImage(1050, 3);   // 5 x 200 + 50
+    MockUpdateBackend backend;
+    OtaReceiver ota(backend);
+    TEST_ASSERT_EQUAL(OtaResult::NOT_ACTIVE, sendChunk(ota, image, 0));
+    ota.start(startFor(image), 0);
+
+    uint8_t data[CHUNK] = {};
+    TEST_ASSERT_EQUAL(OtaResult::BAD_CHUNK, ota.onChunk(6, data, CHUNK, 0));        // past the end
+    TEST_ASSERT_EQUAL(OtaResult::BAD_CHUNK, ota.onChunk(0, data, CHUNK - 1, 0));    // short
+    TEST_ASSERT_EQUAL(OtaResult::BAD_CHUNK, ota.onChunk(5, data, CHUNK, 0));        // last chunk is 50 bytes
+    TEST_ASSERT_EQUAL(3, ota.getStats().rejected);
+    TEST_ASSERT_EQUAL(0, backend.getStats().writes);
+}
+
+void test_hash_mismatch_aborts() {
+    std::vector<uint8_t> image = makeImage(10000, 9);
+    MockUpdateBackend backend;
+    OtaReceiver ota(backend);
+    ota.start(startFor(image), 0);
+    for (uint32_t i = 0; i < ota.chunkCount(); ++i) {
+        sendChunk(ota, image, i);
+    }
+
+    backend.corrupt(4321);
+    TEST_ASSERT_EQUAL(OtaResult::HASH_MISMATCH, ota.finish());
+    TEST_ASSERT_EQUAL(OtaState::FAILED, ota.getState());
+    TEST_ASSERT_FALSE(backend.isBootable());
+    TEST_ASSERT_EQUAL(1, backend.getStats().aborts);
+}
+
+void test_start_validation_and_backend_errors() {
+    MockUpdateBackend backend(64 * 1024);
+    OtaReceiver ota(backend);
+    std::vector<uint8_t> image = makeImage(2000, 5);
+    OtaStartInfo info = startFor(image);
+
+    info.chunkSize = 0;
+    TEST_ASSERT_EQUAL(OtaResult::BAD_START, ota.start(info, 0));
+    info.chunkSize = MAX_PAYLOAD_SIZE;
+    TEST_ASSERT_EQUAL(OtaResult::BAD_START, ota.start(info, 0));
+    info.chunkSize = 1;
+    info.imageSize = OtaReceiver::MAX_CHUNKS + 1;
+    TEST_ASSERT_EQUAL(OtaResult::BAD_START, ota.start(info, 0));
+
+    // Image larger than the partition
+    info = startFor(image);
+    info.imageSize = 128 * 1024;
+    TEST_ASSERT_EQUAL(OtaResult::BACKEND_ERROR, ota.start(info, 0));
+
+    // A failed flash write leaves the chunk missing so a retry can fill it
+    ota.start(startFor(image), 0);
+    backend.failWriteAfter(1);
+    TEST_ASSERT_EQUAL(OtaResult::BACKEND_ERROR, sendChunk(ota, image, 3));
+    TEST_ASSERT_FALSE(ota.hasChunk(3));
+    TEST_ASSERT_EQUAL(OtaResult::OK, sendChunk(ota, image, 3));
+}
+
+void test_inactivity_timeout() {
+    std::vector<uint8_t> image = makeImage(2000, 11);
+    MockUpdateBackend backend;
+    OtaReceiver ota(backend);
+    ota.start(startFor(image), 1000);
+
+    // Each chunk pushes the deadline out
+    sendChunk(ota, image, 0, 25000);
+    TEST_ASSERT_FALSE(ota.checkTimeout(50000));
+    TEST_ASSERT_TRUE(ota.checkTimeout(55001));
+    TEST_ASSERT_FALSE(ota.isActive());
+    TEST_ASSERT_EQUAL(1, backend.getStats().aborts);
+}
+
+void process() {
+    RUN_TEST(test_sha256_known_vectors);
+    RUN_TEST(test_ota_start_payload_roundtrip);
+    RUN_TEST(test_streams_large_image_out_of_order);
+    RUN_TEST(test_rejects_bad_chunks);
+    RUN_TEST(test_hash_mismatch_aborts);
+    RUN_TEST(test_start_validation_and_backend_errors);
+    RUN_TEST(test_inactivity_timeout);
+}
+
+#ifdef UNIT_TEST
+int main(int argc, char **argv) {
+    UNITY_BEGIN();
+    process();
+    return UNITY_END();
+}
+#endif
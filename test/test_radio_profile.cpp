@@ -0,0 +1,223 @@
+// Tests for incremental radio reconfiguration against the mock radio's SPI command count
+#include <unity.h>
+#include "../src/lora/radio_profile.h"
+#include "../src/lora/mock_radio.h"
+#include <cstdio>
+
+using namespace LoRaLink;
+
+static const ConfigPayload DATA = { 915.0f, 125.0f, 9, 5, 17 };
+static const ConfigPayload CONTROL = { 915.0f, 125.0f, 9, 5, 17 };   // main.cpp defaults
+
+// The mock's modelled busy time is the clock, so latency is what the SX1262 would take
+static MockRadio* g_radio = nullptr;
+static uint32_t mockClockUs() {
+    return static_cast<uint32_t>(g_radio->getStats().busyUs);
+}
+
+// updateRadioSettings() before: all five setters, image calibrated every time
+static void applyAllSetters(MockRadio& radio, const ConfigPayload& p) {
+    radio.setFrequency(p.freqMHz, true);
+    radio.setBandwidth(p.bwKHz);
+    radio.setSpreadingFactor(p.sf);
+    radio.setCodingRate(p.cr);
+    radio.setOutputPower(p.txPower);
+}
+
+static void assertProfile(const ConfigPayload& expected, const ConfigPayload& actual) {
+    TEST_ASSERT_EQUAL_FLOAT(expected.freqMHz, actual.freqMHz);
+    TEST_ASSERT_EQUAL_FLOAT(expected.bwKHz, actual.bwKHz);
+    TEST_ASSERT_EQUAL(expected.sf, actual.sf);
+    TEST_ASSERT_EQUAL(expected.cr, actual.cr);
+    TEST_ASSERT_EQUAL(expected.txPower, actual.txPower);
+}
+
+void test_unchanged_profile_sends_nothing() {
+    MockRadio radio;
+    g_radio = &radio;
+    RadioProfileManager manager(radio, mockClockUs);
+    radio.reinit(DATA);
+    manager.assume(DATA);
+    radio.resetStats();
+
+    TEST_ASSERT_EQUAL(RadioStatus::OK, manager.apply(DATA));
+    TEST_ASSERT_EQUAL(0, radio.getStats().spiCommands);
+    TEST_ASSERT_EQUAL(1, manager.getStats().unchanged);
+    TEST_ASSERT_EQUAL(5, manager.getStats().skipped);
+    TEST_ASSERT_EQUAL_UINT32(0, manager.getStats().lastUs);
+}
+
+void test_single_parameter_change_is_one_command() {
+    MockRadio radio;
+    g_radio = &radio;
+    RadioProfileManager manager(radio, mockClockUs);
+    radio.reinit(DATA);
+    manager.assume(DATA);
+    radio.resetStats();
+
+    ConfigPayload next = DATA;
+    next.sf = 10;
+    TEST_ASSERT_EQUAL(RadioStatus::OK, manager.apply(next));
+    TEST_ASSERT_EQUAL(1, radio.getStats().spiCommands);
+    TEST_ASSERT_EQUAL(1, manager.getStats().writes);
+    assertProfile(next, radio.profile());
+
+    // TX power alone is RadioLib's four-command sequence, still no calibration
+    radio.resetStats();
+    next.txPower = 10;
+    TEST_ASSERT_EQUAL(RadioStatus::OK, manager.apply(next));
+    TEST_ASSERT_EQUAL(4, radio.getStats().spiCommands);
+    TEST_ASSERT_EQUAL(0, radio.getStats().calibrations);
+
+    // The five-setter path sends 9 commands and recalibrates for an SF change
+    radio.resetStats();
+    next.sf = 11;
+    applyAllSetters(radio, next);
+    TEST_ASSERT_EQUAL(9, radio.getStats().spiCommands);
+    TEST_ASSERT_EQUAL(1, radio.getStats().calibrations);
+}
+
+void test_image_calibration_only_when_band_changes() {
+    MockRadio radio;
+    g_radio = &radio;
+    RadioProfileManager manager(radio, mockClockUs);
+    radio.reinit(DATA);
+    manager.assume(DATA);
+    radio.resetStats();
+
+    // 915 -> 903.9 MHz stays in the 902-928 MHz calibration
+    ConfigPayload hop = DATA;
+    hop.freqMHz = 903.9f;
+    TEST_ASSERT_EQUAL(RadioStatus::OK, manager.apply(hop));
+    TEST_ASSERT_EQUAL(1, radio.getStats().spiCommands);
+    TEST_ASSERT_EQUAL(0, manager.getStats().calibrations);
+
+    // 868 MHz needs the 863-870 MHz image
+    hop.freqMHz = 868.1f;
+    TEST_ASSERT_EQUAL(RadioStatus::OK, manager.apply(hop));
+    TEST_ASSERT_EQUAL(1, manager.getStats().calibrations);
+    TEST_ASSERT_EQUAL(3, radio.getStats().spiCommands);
+    TEST_ASSERT_EQUAL(4, imageCalibrationBand(915.0f));
+    TEST_ASSERT_EQUAL(3, imageCalibrationBand(868.1f));
+    TEST_ASSERT_EQUAL(0, imageCalibrationBand(433.0f));
+}
+
+void test_failed_write_is_retried() {
+    MockRadio radio;
+    g_radio = &radio;
+    RadioProfileManager manager(radio, mockClockUs);
+    radio.reinit(DATA);
+    manager.assume(DATA);
+
+    ConfigPayload next = DATA;
+    next.bwKHz = 250.0f;
+    next.sf = 7;
+    radio.failNextConfig(-8);
+    TEST_ASSERT_EQUAL(-8, manager.apply(next));
+    TEST_ASSERT_FALSE(manager.isKnown());
+    TEST_ASSERT_EQUAL(1, manager.getStats().failures);
+
+    // Bandwidth again (its state is unknown) plus the SF that was never sent
+    radio.resetStats();
+    TEST_ASSERT_EQUAL(RadioStatus::OK, manager.apply(next));
+    TEST_ASSERT_TRUE(manager.isKnown());
+    TEST_ASSERT_EQUAL(2, radio.getStats().spiCommands);
+    assertProfile(next, radio.profile());
+
+    // After invalidate() everything is written, with image calibration
+    manager.invalidate();
+    radio.resetStats();
+    TEST_ASSERT_EQUAL(RadioStatus::OK, manager.apply(next));
+    TEST_ASSERT_EQUAL(9, radio.getStats().spiCommands);
+    TEST_ASSERT_EQUAL(1, radio.getStats().calibrations);
+}
+
+void test_switch_latency_benchmark() {
+    const ConfigPayload controls[] = {
+        CONTROL,                                // Default: control channel = data channel
+        { 923.3f, 125.0f, 9, 5, 17 },           // Separate channel, same band
+        { 923.3f, 125.0f, 12, 5, 17 },          // Separate channel and SF
+    };
+    const char* names[] = { "same channel", "other channel", "other channel, SF12" };
+    char msg[200];
+
+    TEST_MESSAGE("Control-channel round trip (data -> control -> data), SX1262 commands and modelled time:");
+    for (size_t i = 0; i < 3; ++i) {
+        MockRadio before;
+        before.reinit(DATA);
+        before.resetStats();
+        before.reinit(controls[i]);
+        before.reinit(DATA);
+
+        MockRadio radio;
+        g_radio = &radio;
+        RadioProfileManager manager(radio, mockClockUs);
+        radio.reinit(DATA);
+        manager.assume(DATA);
+        radio.resetStats();
+        TEST_ASSERT_EQUAL(RadioStatus::OK, manager.apply(controls[i]));
+        TEST_ASSERT_EQUAL(RadioStatus::OK, manager.apply(DATA));
+        assertProfile(DATA, radio.profile());
+
+        snprintf(msg, sizeof(msg), "  %-20s 2x begin(): %2lu cmds %6.2f ms | diff: %2lu cmds %5.2f ms (%lu us max)",
+                 names[i], (unsigned long)before.getStats().spiCommands, before.getStats().busyUs / 1000.0,
+                 (unsigned long)radio.getStats().spiCommands, radio.getStats().busyUs / 1000.0,
+                 (unsigned long)manager.getStats().maxUs);
+        TEST_MESSAGE(msg);
+        TEST_ASSERT_TRUE(radio.getStats().busyUs * 10 < before.getStats().busyUs);
+    }
+
+    // Every sfValues x bwValues profile pair, as the button and ADR switch them
+    const uint8_t sfs[] = { 7, 8, 9, 10, 11, 12 };
+    const float bws[] = { 62.5f, 125.0f, 250.0f, 500.0f };
+    uint64_t oldCommands = 0, newCommands = 0, oldUs = 0, newUs = 0;
+    uint32_t pairs = 0;
+    MockRadio radio;
+    g_radio = &radio;
+    RadioProfileManager manager(radio, mockClockUs);
+    for (uint8_t a : sfs) {
+        for (float abw : bws) {
+            for (uint8_t b : sfs) {
+                for (float bbw : bws) {
+                    const ConfigPayload from = { 915.0f, abw, a, 5, 17 };
+                    const ConfigPayload to = { 915.0f, bbw, b, 5, 17 };
+                    MockRadio before;
+                    before.reinit(from);
+                    before.resetStats();
+                    applyAllSetters(before, to);
+                    oldCommands += before.getStats().spiCommands;
+                    oldUs += before.getStats().busyUs;
+
+                    radio.reinit(from);
+                    manager.assume(from);
+                    radio.resetStats();
+                    manager.apply(to);
+                    newCommands += radio.getStats().spiCommands;
+                    newUs += radio.getStats().busyUs;
+                    pairs++;
+                }
+            }
+        }
+    }
+    snprintf(msg, sizeof(msg), "updateRadioSettings() over %lu SF/BW pairs: 5 setters %.1f cmds %.0f us | diff %.1f cmds %.0f us",
+             (unsigned long)pairs, static_cast<double>(oldCommands) / pairs, static_cast<double>(oldUs) / pairs,
+             static_cast<double>(newCommands) / pairs, static_cast<double>(newUs) / pairs);
+    TEST_MESSAGE(msg);
+    TEST_ASSERT_TRUE(newCommands * 4 < oldCommands);
+}
+
+void process() {
+    RUN_TEST(test_unchanged_profile_sends_nothing);
+    RUN_TEST(test_single_parameter_change_is_one_command);
+    RUN_TEST(test_image_calibration_only_when_band_changes);
+    RUN_TEST(test_failed_write_is_retried);
+    RUN_TEST(test_switch_latency_benchmark);
+}
+
+#ifdef UNIT_TEST
+int main(int argc, char **argv) {
+    UNITY_BEGIN();
+    process();
+    return UNITY_END();
+}
+#endif
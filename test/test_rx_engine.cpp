@@ -0,0 +1,247 @@
+// Tests for the interrupt-driven receive engine against the native mock radio
+#include <unity.h>
+#include "../src/lora/rx_engine.h"
+#include "../src/lora/mock_radio.h"
+#include <cstdio>
+#include <vector>
+
+using namespace LoRaLink;
+
+static size_t makeFrame(uint16_t seq, uint8_t* out) {
+    return encodeFrame(FrameType::PING, 0x0001, seq, nullptr, 0, out, MAX_FRAME_SIZE);
+}
+
+static uint16_t frameSeq(const RxFrame& rx) {
+    FrameView view;
+    TEST_ASSERT_EQUAL(DecodeResult::OK, decodeFrame(rx.data, rx.length, view));
+    return view.header.sequence;
+}
+
+void test_frames_are_queued_in_order_with_timestamps() {
+    MockRadio radio;
+    FramePool pool;
+    RxEngine engine(radio, pool);
+    radio.setDio1Handler([&](uint32_t ts) { engine.onDio1(ts); });
+    TEST_ASSERT_EQUAL(RadioStatus::OK, engine.begin());
+    TEST_ASSERT_EQUAL(RadioMode::RECEIVE, radio.getMode());
+
+    uint8_t buf[MAX_FRAME_SIZE];
+    for (uint16_t i = 0; i < 3; ++i) {
+        size_t len = makeFrame(i, buf);
+        TEST_ASSERT_TRUE(radio.deliver(buf, len, 1000 + i, -70.0f - i, 5.0f));
+        TEST_ASSERT_EQUAL(1, engine.poll());
+    }
+
+    TEST_ASSERT_EQUAL(3, engine.depth());
+    RxFrame rx;
+    for (uint16_t i = 0; i < 3; ++i) {
+        TEST_ASSERT_TRUE(engine.pop(rx));
+        TEST_ASSERT_EQUAL_UINT16(i, frameSeq(rx));
+        TEST_ASSERT_EQUAL_UINT32(1000 + i, rx.timestampUs);
+        TEST_ASSERT_FLOAT_WITHIN(0.01f, -70.0f - i, rx.rssi);
+    }
+    TEST_ASSERT_FALSE(engine.pop(rx));
+    TEST_ASSERT_EQUAL(3, engine.getStats().received);
+    TEST_ASSERT_EQUAL(0, engine.getStats().overruns);
+}
+
+void test_fifo_overrun_keeps_newest_frame() {
+    MockRadio radio;
+    FramePool pool;
+    RxEngine engine(radio, pool);
+    radio.setDio1Handler([&](uint32_t ts) { engine.onDio1(ts); });
+    engine.begin();
+
+    // Three frames land before the main loop gets to poll()
+    uint8_t buf[MAX_FRAME_SIZE];
+    for (uint16_t i = 0; i < 3; ++i) {
+        radio.deliver(buf, makeFrame(i, buf), 10 * i);
+    }
+
+    TEST_ASSERT_EQUAL(1, engine.poll());
+    RxFrame rx;
+    TEST_ASSERT_TRUE(engine.pop(rx));
+    TEST_ASSERT_EQUAL_UINT16(2, frameSeq(rx));
+    TEST_ASSERT_EQUAL_UINT32(20, rx.timestampUs);
+    TEST_ASSERT_EQUAL(3, engine.getStats().interrupts);
+    TEST_ASSERT_EQUAL(2, engine.getStats().overruns);
+}
+
+void test_queue_full_counts_drops() {
+    MockRadio radio;
+    FramePool pool;
+    RxEngine engine(radio, pool);
+    radio.setDio1Handler([&](uint32_t ts) { engine.onDio1(ts); });
+    engine.begin();
+
+    uint8_t buf[MAX_FRAME_SIZE];
+    for (uint16_t i = 0; i < RxEngine::QUEUE_DEPTH + 2; ++i) {
+        radio.deliver(buf, makeFrame(i, buf), i);
+        engine.poll();
+    }
+
+    TEST_ASSERT_EQUAL(RxEngine::QUEUE_DEPTH, engine.depth());
+    TEST_ASSERT_EQUAL(RxEngine::QUEUE_DEPTH, engine.getStats().highWater);
+    TEST_ASSERT_EQUAL(2, engine.getStats().queueDrops);
+    TEST_ASSERT_FALSE(radio.hasUnreadPacket());
+}
+
+void test_crc_error_counts_read_error() {
+    MockRadio radio;
+    FramePool pool;
+    RxEngine engine(radio, pool);
+    radio.setDio1Handler([&](uint32_t ts) { engine.onDio1(ts); });
+    engine.begin();
+
+    uint8_t buf[MAX_FRAME_SIZE];
+    radio.deliver(buf, makeFrame(1, buf), 5, -90.0f, -3.0f, true);
+    TEST_ASSERT_EQUAL(0, engine.poll());
+    TEST_ASSERT_EQUAL(1, engine.getStats().readErrors);
+    TEST_ASSERT_FALSE(engine.available());
+}
+
+void test_suspend_ignores_edges_and_resume_clears_stale_ones() {
+    MockRadio radio;
+    FramePool pool;
+    RxEngine engine(radio, pool);
+    radio.setDio1Handler([&](uint32_t ts) { engine.onDio1(ts); });
+    engine.begin();
+
+    // A TxDone edge while suspended must not be read as a frame
+    engine.suspend();
+    TEST_ASSERT_EQUAL(RadioMode::STANDBY, radio.getMode());
+    engine.onDio1(42);
+    engine.resume();
+    TEST_ASSERT_EQUAL(0, engine.poll());
+    TEST_ASSERT_EQUAL(0, engine.getStats().interrupts);
+
+    // Edge latched but engine resumed before poll(): stale edge is discarded
+    uint8_t buf[MAX_FRAME_SIZE];
+    radio.deliver(buf, makeFrame(7, buf), 100);
+    engine.resume();
+    TEST_ASSERT_EQUAL(0, engine.poll());
+}
+
+// Bursty traffic: legacy blocking receive() polling versus the DIO1 engine.
+// Timing constants model the receiver loop in main.cpp.
+namespace {
+    const uint32_t FRAME_AIRTIME_US = 72000;    // 16-byte frame at SF9/125 kHz
+    const uint32_t RX_WINDOW_US = 410000;       // receive() timeout (~100 symbols at SF9)
+    const uint32_t LOOP_OVERHEAD_US = 10000;    // delay(10) plus button/WiFi checks
+    const uint32_t OLED_REDRAW_US = 92000;      // full SSD1306 frame at 100 kHz I2C
+
+    std::vector<uint32_t> makeBurstyArrivals(uint32_t seed, int bursts) {
+        std::vector<uint32_t> out;
+        uint32_t t = 100000;
+        for (int b = 0; b < bursts; ++b) {
+            seed = seed * 1664525u + 1013904223u;
+            int size = 2 + (seed >> 28) % 4;            // 2..5 back-to-back frames
+            for (int i = 0; i < size; ++i) {
+                out.push_back(t + i * (FRAME_AIRTIME_US + 5000));
+            }
+            seed = seed * 1664525u + 1013904223u;
+            t += 1000000 + (seed >> 12) % 1000000;      // 1-2 s between bursts
+        }
+        return out;
+    }
+
+    uint32_t runLegacy(const std::vector<uint32_t>& arrivals) {
+        MockRadio radio;
+        uint8_t buf[MAX_FRAME_SIZE];
+        size_t len = makeFrame(0, buf);
+        uint32_t received = 0;
+        size_t next = 0;
+        uint32_t now = 0;
+        const uint32_t end = arrivals.back() + RX_WINDOW_US;
+
+        while (now < end) {
+            // Frames that finish while the loop is busy elsewhere are lost
+            while (next < arrivals.size() && arrivals[next] < now) {
+                radio.deliver(buf, len, arrivals[next++]);
+            }
+            radio.startReceive();
+            if (next < arrivals.size() && arrivals[next] < now + RX_WINDOW_US) {
+                now = arrivals[next];
+                radio.deliver(buf, len, arrivals[next++]);
+                size_t got = 0;
+                radio.readPacket(buf, sizeof(buf), got);
+                received++;
+                radio.standby();
+                now += OLED_REDRAW_US;
+            } else {
+                now += RX_WINDOW_US;
+                radio.standby();
+            }
+            now += LOOP_OVERHEAD_US;
+        }
+        return received;
+    }
+
+    uint32_t runEngine(const std::vector<uint32_t>& arrivals, RxStats& stats) {
+        MockRadio radio;
+        FramePool pool;
+        RxEngine engine(radio, pool);
+        radio.setDio1Handler([&](uint32_t ts) { engine.onDio1(ts); });
+        engine.begin();
+
+        uint8_t buf[MAX_FRAME_SIZE];
+        size_t len = makeFrame(0, buf);
+        uint32_t received = 0;
+        size_t next = 0;
+        uint32_t now = 0;
+        const uint32_t end = arrivals.back() + RX_WINDOW_US;
+
+        while (now < end) {
+            while (next < arrivals.size() && arrivals[next] <= now) {
+                radio.deliver(buf, len, arrivals[next++]);
+            }
+            engine.poll();
+            RxFrame rx;
+            while (engine.pop(rx)) {
+                received++;
+                now += OLED_REDRAW_US;
+            }
+            now += LOOP_OVERHEAD_US;
+        }
+        stats = engine.getStats();
+        return received;
+    }
+}
+
+void test_benchmark_bursty_drop_rate() {
+    std::vector<uint32_t> arrivals = makeBurstyArrivals(12345, 500);
+    RxStats stats;
+    uint32_t legacy = runLegacy(arrivals);
+    uint32_t irq = runEngine(arrivals, stats);
+
+    const float total = static_cast<float>(arrivals.size());
+    const float legacyDrop = 100.0f * (total - legacy) / total;
+    const float irqDrop = 100.0f * (total - irq) / total;
+
+    char msg[160];
+    snprintf(msg, sizeof(msg),
+             "%u frames in bursts: polling drop=%.1f%% | DIO1 engine drop=%.1f%% (overruns=%u queueDrops=%u highWater=%u)",
+             (unsigned)arrivals.size(), legacyDrop, irqDrop,
+             (unsigned)stats.overruns, (unsigned)stats.queueDrops, (unsigned)stats.highWater);
+    TEST_MESSAGE(msg);
+
+    TEST_ASSERT_EQUAL(arrivals.size(), irq + stats.overruns + stats.queueDrops);
+    TEST_ASSERT_LESS_THAN(legacyDrop, irqDrop);
+}
+
+void process() {
+    RUN_TEST(test_frames_are_queued_in_order_with_timestamps);
+    RUN_TEST(test_fifo_overrun_keeps_newest_frame);
+    RUN_TEST(test_queue_full_counts_drops);
+    RUN_TEST(test_crc_error_counts_read_error);
+    RUN_TEST(test_suspend_ignores_edges_and_resume_clears_stale_ones);
+    RUN_TEST(test_benchmark_bursty_drop_rate);
+}
+
+#ifdef UNIT_TEST
+int main(int argc, char **argv) {
+    UNITY_BEGIN();
+    process();
+    return UNITY_END();
+}
+#endif
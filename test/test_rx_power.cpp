@@ -0,0 +1,226 @@
+// Tests for the RX duty cycle schedule, its RxEngine re-arming and the receiver power model
+#include <unity.h>
+#include "../src/lora/rx_power.h"
+#include "../src/lora/rx_engine.h"
+#include "../src/lora/mock_radio.h"
+#include "lora_test_support.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+using namespace LoRaLink;
+
+// First window, counting from a cycle started at 0, that hears at least
+// minSymbols of a preamble over [startUs, endUs); -1 if none before endUs
+static int64_t detectingWindow(const RxDutyCycle& cycle, double startUs, double endUs, double needUs) {
+    const double period = cycle.periodUs();
+    for (int64_t k = static_cast<int64_t>(startUs / period) - 1; k * period < endUs; k++) {
+        const double from = std::max(startUs, static_cast<double>(k * period));
+        const double to = std::min(endUs, static_cast<double>(k * period + cycle.rxUs));
+        if (k >= 0 && to - from >= needUs) {
+            return k;
+        }
+    }
+    return -1;
+}
+
+void test_duty_cycle_catches_every_preamble() {
+    const uint8_t sfs[] = { 7, 9, 12 };
+    const uint16_t preambles[] = { 24, 32, 64, 128, 256 };
+    TestRng rng(3);
+    for (uint8_t sf : sfs) {
+        for (uint16_t preamble : preambles) {
+            const LoRaModulation modulation = loraModulation(sf, 125000, 5, preamble);
+            const double symbolUs = symbolTimeUs(sf, 125000);
+            const RxDutyCycle cycle = rxDutyCycleFor(modulation);
+            TEST_ASSERT_TRUE(cycle.sleepUs > 0);
+            TEST_ASSERT_TRUE(cycle.rxUs >= symbolUs * (RX_MIN_SYMBOLS + 1));
+            // A window that hears a preamble waits sleep + 2 rx for the sync word
+            TEST_ASSERT_TRUE(cycle.sleepUs + 2.0 * cycle.rxUs >= symbolUs * (preamble + 2));
+
+            for (int i = 0; i < 5000; i++) {
+                const double startUs = rng.uniform() * 20 * cycle.periodUs();
+                TEST_ASSERT_TRUE(detectingWindow(cycle, startUs, startUs + preamble * symbolUs,
+                                                 RX_MIN_SYMBOLS * symbolUs) >= 0);
+            }
+        }
+    }
+
+    // RadioLib's 8-symbol default is too short for any gap
+    TEST_ASSERT_EQUAL_UINT32(0, rxDutyCycleFor(loraModulation(9, 125000)).sleepUs);
+    TEST_ASSERT_EQUAL_UINT32(0, rxDutyCycleFor(loraModulation(9, 125000, 5, 16)).sleepUs);
+}
+
+void test_rx_engine_rearms_duty_cycle() {
+    MockRadio radio;
+    FramePool pool;
+    RxEngine rx(radio, pool);
+    radio.setDio1Handler([&](uint32_t ts) { rx.onDio1(ts); });
+
+    const RxDutyCycle cycle = rxDutyCycleFor(loraModulation(9, 125000, 5, 64));
+    rx.setDutyCycle(cycle.rxUs, cycle.sleepUs);
+    TEST_ASSERT_TRUE(rx.isDutyCycled());
+    TEST_ASSERT_EQUAL(RadioStatus::OK, rx.begin());
+    TEST_ASSERT_EQUAL(RadioMode::RECEIVE_DUTY_CYCLE, radio.getMode());
+    TEST_ASSERT_EQUAL_UINT32(cycle.rxUs, radio.dutyCycleRxUs());
+    TEST_ASSERT_EQUAL_UINT32(cycle.sleepUs, radio.dutyCycleSleepUs());
+    TEST_ASSERT_EQUAL_UINT32(0, radio.getStats().startReceiveCalls);
+
+    uint8_t frame[MAX_FRAME_SIZE];
+    const size_t len = encodeFrame(FrameType::PING, 0x0001, 1, nullptr, 0, frame, sizeof(frame));
+    TEST_ASSERT_TRUE(radio.deliver(frame, len, 1000));
+    TEST_ASSERT_TRUE(rx.hasPendingIrq());
+    // The radio stops after the packet; a second one before poll() is lost
+    TEST_ASSERT_EQUAL(RadioMode::STANDBY, radio.getMode());
+    TEST_ASSERT_FALSE(radio.deliver(frame, len, 2000));
+
+    TEST_ASSERT_EQUAL(1, rx.poll());
+    TEST_ASSERT_FALSE(rx.hasPendingIrq());
+    TEST_ASSERT_EQUAL(RadioMode::RECEIVE_DUTY_CYCLE, radio.getMode());
+    TEST_ASSERT_EQUAL_UINT32(2, radio.getStats().dutyCycleCalls);
+    RxFrame* got = rx.pop();
+    TEST_ASSERT_NOT_NULL(got);
+    rx.release(got);
+
+    // A CRC error re-arms too
+    TEST_ASSERT_TRUE(radio.deliver(frame, len, 3000, -80.0f, 8.0f, true));
+    TEST_ASSERT_EQUAL(0, rx.poll());
+    TEST_ASSERT_EQUAL_UINT32(1, rx.getStats().readErrors);
+    TEST_ASSERT_EQUAL(RadioMode::RECEIVE_DUTY_CYCLE, radio.getMode());
+
+    // Suspended: no re-arm; back to continuous RX once the duty cycle is cleared
+    rx.suspend();
+    TEST_ASSERT_EQUAL(RadioMode::STANDBY, radio.getMode());
+    rx.setDutyCycle(0, 0);
+    rx.resume();
+    TEST_ASSERT_EQUAL(RadioMode::RECEIVE, radio.getMode());
+    TEST_ASSERT_EQUAL_UINT32(3, radio.getStats().dutyCycleCalls);
+}
+
+// One receiver in RX duty cycle for a day, Poisson frames: radio time in RX
+// from the actual window grid, restarted by the MCU after each frame
+struct DutyCycleSimResult {
+    double rxUs;
+    double sleepUs;
+    uint32_t frames;
+    uint32_t missed;
+};
+
+static DutyCycleSimResult simulateDutyCycle(const LoRaModulation& modulation, size_t frameBytes,
+                                            double framesPerHour, const PowerProfile& profile,
+                                            double durationUs, uint32_t seed) {
+    const RxDutyCycle cycle = rxDutyCycleFor(modulation);
+    const double period = cycle.periodUs();
+    const double symbolUs = symbolTimeUs(modulation.sf, modulation.bwHz);
+    const double preambleUs = modulation.preamble * symbolUs;
+    const double airUs = timeOnAirUs(modulation, frameBytes);
+    const double rearmUs = profile.mcuWakeUs + profile.frameWorkUs;
+    TestRng rng(seed);
+
+    DutyCycleSimResult result = { 0, 0, 0, 0 };
+    double gridUs = 0;                  // Cycle (re)started here with an RX window
+    for (;;) {
+        const double startUs = gridUs - std::log(1.0 - rng.uniform()) * 3600e6 / framesPerHour;
+        if (startUs + airUs + rearmUs > durationUs) {
+            break;
+        }
+        result.frames++;
+        const int64_t k = detectingWindow(cycle, startUs - gridUs, startUs - gridUs + preambleUs,
+                                          RX_MIN_SYMBOLS * symbolUs);
+        if (k < 0) {
+            result.missed++;
+            continue;
+        }
+        // Whole cycles until the window that hears it, then RX to the re-arm
+        result.rxUs += k * static_cast<double>(cycle.rxUs);
+        result.sleepUs += k * (period - cycle.rxUs);
+        const double windowUs = gridUs + k * period;
+        result.rxUs += startUs + airUs + rearmUs - windowUs;
+        gridUs = startUs + airUs + rearmUs;
+    }
+    const double cycles = std::floor((durationUs - gridUs) / period);
+    result.rxUs += cycles * cycle.rxUs + std::min(static_cast<double>(cycle.rxUs), durationUs - gridUs - cycles * period);
+    result.sleepUs = durationUs - result.rxUs;
+    return result;
+}
+
+void test_power_model_matches_simulation() {
+    const RxPowerModel model;
+    const PowerProfile& profile = model.profile();
+    const uint16_t preambles[] = { 32, 64, 128 };
+    const double rates[] = { 6, 60, 600 };
+    const double durationUs = 24.0 * 3600e6;
+    char msg[200];
+
+    for (uint16_t preamble : preambles) {
+        for (double rate : rates) {
+            const LoRaModulation modulation = loraModulation(9, 125000, 5, preamble);
+            const DutyCycleSimResult sim = simulateDutyCycle(modulation, PING_FRAME_BYTES, rate, profile,
+                                                             durationUs, preamble + static_cast<uint32_t>(rate));
+            const double simMa = (sim.rxUs * profile.radioRxMa + sim.sleepUs * profile.radioSleepMa) / durationUs;
+            // Arrivals wait for the previous frame, so compare at the rate achieved
+            const float achieved = static_cast<float>(sim.frames * 3600e6 / durationUs);
+            const RxPowerReport report = model.dutyCycled(modulation, PING_FRAME_BYTES, achieved);
+
+            snprintf(msg, sizeof(msg), "SF9 %u-symbol preamble, %.0f frames/h: radio %.3f mA simulated, %.3f mA "
+                     "modelled, %lu/%lu frames heard",
+                     (unsigned)preamble, achieved, simMa, report.radioMa, (unsigned long)(sim.frames - sim.missed),
+                     (unsigned long)sim.frames);
+            TEST_MESSAGE(msg);
+            TEST_ASSERT_EQUAL_UINT32(0, sim.missed);
+            TEST_ASSERT_TRUE(std::fabs(simMa - report.radioMa) < 0.05 * simMa);
+        }
+    }
+}
+
+void test_power_report() {
+    const RxPowerModel model;
+    struct Case { uint8_t sf; uint16_t preamble; };
+    const Case cases[] = { { 7, 64 }, { 9, 32 }, { 9, 64 }, { 9, 128 }, { 12, 32 } };
+    const float framesPerHour = 60.0f;
+    const float batteryMah = 3000.0f;
+    char msg[220];
+
+    TEST_MESSAGE("One PING a minute, 3000 mAh; continuous RX uses RadioLib's 8-symbol preamble:");
+    for (const Case& c : cases) {
+        const RxPowerReport always = model.continuous(loraModulation(c.sf, 125000), PING_FRAME_BYTES,
+                                                      framesPerHour);
+        const LoRaModulation longPreamble = loraModulation(c.sf, 125000, 5, c.preamble);
+        const RxDutyCycle cycle = rxDutyCycleFor(longPreamble);
+        const RxPowerReport cycled = model.dutyCycled(longPreamble, PING_FRAME_BYTES, framesPerHour);
+
+        snprintf(msg, sizeof(msg),
+                 "  SF%u: continuous %.1f mA, %.1f days, worst %lu ms | duty cycle (%u sym, %lu/%lu ms) %.3f mA, "
+                 "%.0f days, worst %lu ms",
+                 (unsigned)c.sf, always.averageMa, always.batteryHours(batteryMah) / 24,
+                 (unsigned long)(always.worstLatencyUs / 1000), (unsigned)c.preamble,
+                 (unsigned long)(cycle.rxUs / 1000), (unsigned long)(cycle.sleepUs / 1000), cycled.averageMa,
+                 cycled.batteryHours(batteryMah) / 24, (unsigned long)(cycled.worstLatencyUs / 1000));
+        TEST_MESSAGE(msg);
+
+        TEST_ASSERT_TRUE(cycled.averageMa < always.averageMa / 20);
+        // The price is the longer preamble on every frame
+        TEST_ASSERT_EQUAL_UINT32(cycled.frameAirtimeUs + 3000, cycled.worstLatencyUs);
+        TEST_ASSERT_TRUE(cycled.worstLatencyUs > always.worstLatencyUs);
+    }
+
+    // Too short a preamble falls back to continuous RX
+    const RxPowerReport fallback = model.dutyCycled(loraModulation(9, 125000), PING_FRAME_BYTES, framesPerHour);
+    TEST_ASSERT_EQUAL_FLOAT(model.continuous(loraModulation(9, 125000), PING_FRAME_BYTES, framesPerHour).averageMa,
+                            fallback.averageMa);
+}
+
+void process() {
+    RUN_TEST(test_duty_cycle_catches_every_preamble);
+    RUN_TEST(test_rx_engine_rearms_duty_cycle);
+    RUN_TEST(test_power_model_matches_simulation);
+    RUN_TEST(test_power_report);
+}
+
+#ifdef UNIT_TEST
+int main(int argc, char **argv) {
+    UNITY_BEGIN();
+    process();
+    return UNITY_END();
+}
+#endif
@@ -0,0 +1,220 @@
+// Tests for the beacon-synchronised TDMA scheduler, with an ALOHA comparison
+#include <unity.h>
+#include "../src/lora/tdma.h"
+#include "../src/lora/airtime.h"
+#include "../src/lora/net_sim.h"
+#include <cstdio>
+
+using namespace LoRaLink;
+
+static const LoRaModulation SF9 = loraModulation(9, 125000);
+
+void test_guard_covers_jitter_and_drift() {
+    const TdmaConfig config = TdmaCoordinator::defaultConfig();
+
+    const TdmaTiming small = tdmaTiming(SF9, config, 10, 2);
+    TEST_ASSERT_EQUAL_UINT32(timeOnAirUs(SF9, PING_FRAME_BYTES), small.frameUs);
+    TEST_ASSERT_EQUAL_UINT32(small.frameUs + 2 * small.guardUs, small.slotUs);
+    TEST_ASSERT_EQUAL_UINT32(12u * small.slotUs, small.spanUs());
+
+    // Two crystals 20 ppm apart each way over a whole superframe
+    const uint64_t superframeUs = timeOnAirUs(SF9, FRAME_OVERHEAD + TDMA_BEACON_MAX_SIZE) + small.spanUs();
+    const uint64_t driftUs = superframeUs * 2 * config.driftPpm / 1000000u;
+    TEST_ASSERT_TRUE(small.guardUs >= config.jitterUs + config.turnaroundUs + driftUs);
+
+    // 200 slots: a 30 s superframe needs more guard, and still fits it
+    const TdmaTiming large = tdmaTiming(SF9, config, 202, 2);
+    const uint64_t largeDriftUs =
+        (timeOnAirUs(SF9, FRAME_OVERHEAD + TDMA_BEACON_MAX_SIZE) + static_cast<uint64_t>(large.spanUs())) *
+        2 * config.driftPpm / 1000000u;
+    TEST_ASSERT_TRUE(large.guardUs > small.guardUs);
+    TEST_ASSERT_TRUE(large.guardUs >= config.jitterUs + config.turnaroundUs + largeDriftUs);
+
+    // The guard scales with airtime only through the drift term
+    const TdmaTiming fast = tdmaTiming(loraModulation(7, 250000), config, 10, 2);
+    TEST_ASSERT_TRUE(fast.slotUs < small.slotUs);
+    TEST_ASSERT_TRUE(fast.guardUs >= config.jitterUs + config.turnaroundUs);
+}
+
+void test_coordinator_grants_and_releases_slots() {
+    TdmaConfig config = TdmaCoordinator::defaultConfig();
+    TdmaCoordinator coordinator(config);
+    uint8_t beacon[TDMA_BEACON_MAX_SIZE];
+    TdmaBeacon decoded;
+
+    coordinator.onJoin(0x1001);
+    coordinator.onJoin(0x1002);
+    coordinator.onJoin(0x1001);     // Repeat: same slot
+    TEST_ASSERT_EQUAL(2, coordinator.assigned());
+    TEST_ASSERT_EQUAL(0, coordinator.slotOf(0x1001));
+    TEST_ASSERT_EQUAL(1, coordinator.slotOf(0x1002));
+
+    size_t len = coordinator.encodeBeacon(beacon, sizeof(beacon));
+    TEST_ASSERT_TRUE(decodeTdmaBeacon(beacon, len, decoded));
+    TEST_ASSERT_EQUAL(1, decoded.cycle);
+    TEST_ASSERT_EQUAL(config.minSlots, decoded.slots);
+    TEST_ASSERT_EQUAL(2, decoded.grantCount);
+    TEST_ASSERT_EQUAL(2 * config.minJoinSlots, decoded.joinSlots);     // Joins arrived
+    uint16_t slot = 0;
+    TEST_ASSERT_TRUE(tdmaGrantFor(decoded, 0x1002, slot));
+    TEST_ASSERT_EQUAL(1, slot);
+    TEST_ASSERT_FALSE(tdmaGrantFor(decoded, 0x1003, slot));
+
+    // 0x1001 is heard in its slot and drops off the grant list
+    coordinator.onBeaconSent(1000000);
+    coordinator.onFrame(0x1001, 1000000 + decoded.guardUs + coordinator.timing().frameUs);
+    TEST_ASSERT_EQUAL_UINT32(1, coordinator.getStats().inSlot);
+    coordinator.onFrame(0x1002, 1000000 + 3 * decoded.slotUs - 1);
+    TEST_ASSERT_EQUAL_UINT32(1, coordinator.getStats().outOfSlot);
+    len = coordinator.encodeBeacon(beacon, sizeof(beacon));
+    TEST_ASSERT_TRUE(decodeTdmaBeacon(beacon, len, decoded));
+    TEST_ASSERT_EQUAL(0, decoded.grantCount);   // 0x1002 was heard too
+    TEST_ASSERT_EQUAL(config.minJoinSlots, decoded.joinSlots);
+
+    // Silent owners lose their slot after idleCycles superframes
+    for (uint16_t i = 0; i < config.idleCycles; ++i) {
+        coordinator.onFrame(0x1002, 0);
+        coordinator.encodeBeacon(beacon, sizeof(beacon));
+    }
+    TEST_ASSERT_EQUAL(-1, coordinator.slotOf(0x1001));
+    TEST_ASSERT_EQUAL(1, coordinator.slotOf(0x1002));
+    TEST_ASSERT_EQUAL_UINT32(1, coordinator.getStats().released);
+    coordinator.onJoin(0x1003);
+    TEST_ASSERT_EQUAL(0, coordinator.slotOf(0x1003));
+
+    // More grants than fit are spread over later beacons
+    for (uint16_t i = 0; i < 40; ++i) {
+        coordinator.onJoin(static_cast<uint16_t>(0x2000 + i));
+    }
+    len = coordinator.encodeBeacon(beacon, sizeof(beacon));
+    TEST_ASSERT_TRUE(decodeTdmaBeacon(beacon, len, decoded));
+    TEST_ASSERT_EQUAL(TDMA_MAX_GRANTS, decoded.grantCount);
+    TEST_ASSERT_EQUAL(42 + config.spareSlots, decoded.slots);     // Slots 0..41 taken
+    TEST_ASSERT_EQUAL(2 * config.minJoinSlots, decoded.joinSlots);
+}
+
+void test_node_joins_and_keeps_to_its_slot() {
+    TdmaCoordinator coordinator;
+    TdmaNode node;
+    node.setNodeId(0x0042);
+    uint8_t beacon[TDMA_BEACON_MAX_SIZE];
+    uint32_t now = 5000000;
+
+    // First beacon: no slot yet, so a join in one of the join slots
+    size_t len = coordinator.encodeBeacon(beacon, sizeof(beacon));
+    coordinator.onBeaconSent(now);
+    TEST_ASSERT_TRUE(node.onBeacon(beacon, len, now));
+    TEST_ASSERT_EQUAL(TdmaState::JOINING, node.state());
+    const TdmaTiming& t = coordinator.timing();
+    const uint32_t joinAt = node.nextWakeUs();
+    TEST_ASSERT_TRUE(joinAt >= now + t.slots * t.slotUs);
+    TEST_ASSERT_TRUE(joinAt < now + t.spanUs());
+    TEST_ASSERT_EQUAL(TdmaAction::NONE, node.poll(joinAt - 1));
+    TEST_ASSERT_EQUAL(TdmaAction::SEND_JOIN, node.poll(joinAt + 100));
+    TEST_ASSERT_EQUAL(TdmaAction::NONE, node.poll(joinAt + 200));
+    coordinator.onJoin(0x0042);
+
+    // Granted: data goes one guard into slot 0 of every superframe
+    now += t.spanUs() + 200000;
+    len = coordinator.encodeBeacon(beacon, sizeof(beacon));
+    coordinator.onBeaconSent(now);
+    TEST_ASSERT_TRUE(node.onBeacon(beacon, len, now));
+    TEST_ASSERT_EQUAL(TdmaState::SYNCED, node.state());
+    TEST_ASSERT_EQUAL(0, node.slot());
+    TEST_ASSERT_EQUAL_UINT32(now + coordinator.timing().guardUs, node.nextWakeUs());
+    TEST_ASSERT_EQUAL(TdmaAction::SEND_DATA, node.poll(node.nextWakeUs() + 5000));
+
+    // Polled too late: the slot is skipped rather than overrun
+    now += coordinator.timing().spanUs() + 200000;
+    len = coordinator.encodeBeacon(beacon, sizeof(beacon));
+    node.onBeacon(beacon, len, now);
+    TEST_ASSERT_EQUAL(TdmaAction::NONE, node.poll(node.nextWakeUs() + coordinator.timing().guardUs + 1));
+    TEST_ASSERT_EQUAL_UINT32(1, node.getStats().lateSlots);
+
+    // Three beacons missed: the node stops and listens
+    for (int i = 0; i < 3; ++i) {
+        TEST_ASSERT_EQUAL(TdmaState::SYNCED, node.state());
+        TEST_ASSERT_EQUAL(TdmaAction::NONE, node.poll(node.nextWakeUs()));
+    }
+    TEST_ASSERT_EQUAL(TdmaState::UNSYNCED, node.state());
+    TEST_ASSERT_EQUAL_UINT32(3, node.getStats().missedBeacons);
+    TEST_ASSERT_EQUAL_UINT32(1, node.getStats().syncLosses);
+    TEST_ASSERT_EQUAL(-1, node.slot());
+}
+
+// --- ALOHA against TDMA on the network simulator -------------------------------
+//
+// One receiver and n senders within 200 m on NetSim (net_sim.h): each node
+// is a LinkLayer on its own MockRadio, loop() every 10 ms at a random phase,
+// 6 dB capture, no listen-before-talk. Senders boot in the first 10 s.
+//
+// ALOHA-2s is the link layer's own PING pacing, as main.cpp runs today (the
+// 6.2% airtime share, 2 s at SF9/125 kHz). ALOHA-eq PINGs at the TDMA
+// superframe rate for the same offered load. TDMA attaches the
+// TdmaCoordinator and TdmaNodes as -D LORA_TDMA=1 does.
+
+static const uint32_t SIM_WARMUP_MS = 1200000;     // 20 min to join from a cold start
+static const uint32_t SIM_WINDOW_MS = 600000;      // 10 min measured
+
+static NetSimReport simulate(size_t senders, bool tdma, uint32_t intervalMs) {
+    NetSimConfig config = NetSimConfig::defaultConfig();   // One seed: every run has the same placement and boots
+    config.lbt = false;
+    config.tdma = tdma;
+    NetSim sim(config);
+    sim.addNode(SimNodeConfig{ SimRole::RECEIVER, 0.0f, 0.0f, 0, false, 0 });
+    sim.addSenders(senders, 200.0f, intervalMs, false, 10000);
+    return sim.run(SIM_WARMUP_MS + SIM_WINDOW_MS, SIM_WARMUP_MS);
+}
+
+// Share of the PINGs sent that did not arrive
+static float lostShare(const NetSimReport& report) {
+    return report.sent > 0 ? 1.0f - static_cast<float>(report.delivered) / report.sent : 0.0f;
+}
+
+void test_tdma_vs_aloha_simulation() {
+    const size_t counts[] = { 10, 20, 50, 100, 200 };
+    const uint32_t pingUs = timeOnAirUs(SF9, PING_FRAME_BYTES);
+    char msg[220];
+
+    TEST_MESSAGE("SF9/125 kHz PINGs, 10 min measured after 20 min warm-up; lost share of PINGs and");
+    TEST_MESSAGE("channel use (delivered PING airtime / time). ALOHA-2s is today's pacing, ALOHA-eq sends");
+    TEST_MESSAGE("at the TDMA superframe rate (same offered load):");
+    for (size_t n : counts) {
+        const NetSimReport tdma = simulate(n, true, 0);
+        const NetSimReport aloha = simulate(n, false, 0);
+        const NetSimReport equal = simulate(n, false, tdma.superframeUs / 1000);
+
+        snprintf(msg, sizeof(msg),
+                 "  %3u nodes | ALOHA-2s %5.1f%% lost, use %4.1f%% | ALOHA-eq %5.1f%% lost, use %4.1f%% | "
+                 "TDMA %4.1f%% lost, use %4.1f%% (+%3.1f%% beacons/joins), %5.1f s frame, joined %5.1f s",
+                 (unsigned)n, lostShare(aloha) * 100, aloha.channelUse(pingUs) * 100, lostShare(equal) * 100,
+                 equal.channelUse(pingUs) * 100, lostShare(tdma) * 100, tdma.channelUse(pingUs) * 100,
+                 100.0 * tdma.overheadAirtimeUs / tdma.durationUs, tdma.superframeUs / 1e6, tdma.syncedUs / 1e6);
+        TEST_MESSAGE(msg);
+
+        TEST_ASSERT_TRUE(tdma.syncedUs > 0 && tdma.syncedUs < SIM_WARMUP_MS * 1000ull);
+        TEST_ASSERT_EQUAL_UINT32(0, tdma.collided);
+        TEST_ASSERT_EQUAL_UINT32(0, tdma.busy);
+        TEST_ASSERT_EQUAL_UINT32(0, tdma.outOfSlot);
+        TEST_ASSERT_TRUE(tdma.delivered >= tdma.sent * 99 / 100);
+        TEST_ASSERT_TRUE(equal.collided + equal.busy > 0);
+        if (n >= 20) {
+            TEST_ASSERT_TRUE(tdma.delivered > aloha.delivered);
+        }
+    }
+}
+
+void process() {
+    RUN_TEST(test_guard_covers_jitter_and_drift);
+    RUN_TEST(test_coordinator_grants_and_releases_slots);
+    RUN_TEST(test_node_joins_and_keeps_to_its_slot);
+    RUN_TEST(test_tdma_vs_aloha_simulation);
+}
+
+#ifdef UNIT_TEST
+int main(int argc, char **argv) {
+    UNITY_BEGIN();
+    process();
+    return UNITY_END();
+}
+#endif
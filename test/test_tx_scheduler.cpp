@@ -0,0 +1,306 @@
+// Tests for the asynchronous priority transmit queue against the native mock radio
+#include <unity.h>
+#include "../src/lora/tx_scheduler.h"
+#include "../src/lora/mock_radio.h"
+#include <cstdio>
+#include <vector>
+
+using namespace LoRaLink;
+
+static size_t makeFrame(FrameType type, uint16_t seq, uint8_t* out, size_t payloadSize = 0) {
+    uint8_t payload[MAX_PAYLOAD_SIZE] = {};
+    return encodeFrame(type, 0x0001, seq, payload, payloadSize, out, MAX_FRAME_SIZE);
+}
+
+static uint16_t lastSentSeq(const MockRadio& radio) {
+    FrameView view;
+    TEST_ASSERT_EQUAL(DecodeResult::OK, decodeFrame(radio.lastTransmit(), radio.lastTransmitLength(), view));
+    return view.header.sequence;
+}
+
+void test_first_frame_starts_immediately() {
+    MockRadio radio;
+    TxScheduler tx(radio);
+    radio.setDio1Handler([&](uint32_t ts) { tx.onDio1(ts); });
+
+    uint8_t buf[MAX_FRAME_SIZE];
+    TEST_ASSERT_TRUE(tx.enqueue(buf, makeFrame(FrameType::PING, 5, buf), Priority::NORMAL, 100));
+    TEST_ASSERT_TRUE(tx.isTransmitting());
+    TEST_ASSERT_EQUAL(RadioMode::TRANSMIT, radio.getMode());
+    TEST_ASSERT_EQUAL_UINT16(5, lastSentSeq(radio));
+    TEST_ASSERT_EQUAL(0, tx.depth());
+
+    // Nothing changes until TxDone
+    tx.poll(200);
+    TEST_ASSERT_TRUE(tx.isTransmitting());
+
+    radio.completeTransmit(1500);
+    tx.poll(1600);
+    TEST_ASSERT_FALSE(tx.isBusy());
+    TEST_ASSERT_EQUAL(RadioMode::STANDBY, radio.getMode());
+    TEST_ASSERT_EQUAL(1, tx.getStats().sent);
+    TEST_ASSERT_EQUAL_UINT32(1400, tx.getStats().lastLatencyUs);
+}
+
+void test_higher_priority_goes_first_and_fifo_within_level() {
+    MockRadio radio;
+    TxScheduler tx(radio);
+    radio.setDio1Handler([&](uint32_t ts) { tx.onDio1(ts); });
+
+    std::vector<uint16_t> order;
+    radio.setTransmitHandler([&](const uint8_t* data, size_t length) {
+        FrameView view;
+        decodeFrame(data, length, view);
+        order.push_back(view.header.sequence);
+    });
+
+    uint8_t buf[MAX_FRAME_SIZE];
+    tx.enqueue(buf, makeFrame(FrameType::OTA_DATA, 1, buf, 200), Priority::LOW, 0);   // starts at once
+    tx.enqueue(buf, makeFrame(FrameType::OTA_DATA, 2, buf, 200), Priority::LOW, 0);
+    tx.enqueue(buf, makeFrame(FrameType::PING, 3, buf), Priority::NORMAL, 0);
+    tx.enqueue(buf, makeFrame(FrameType::OTA_DATA, 4, buf, 200), Priority::LOW, 0);
+    tx.enqueue(buf, makeFrame(FrameType::CONFIG, 5, buf, CONFIG_PAYLOAD_SIZE), Priority::HIGH, 0);
+    tx.enqueue(buf, makeFrame(FrameType::CONFIG, 6, buf, CONFIG_PAYLOAD_SIZE), Priority::HIGH, 0);
+    TEST_ASSERT_EQUAL(5, tx.depth());
+    TEST_ASSERT_EQUAL(5, tx.getStats().maxDepth);
+
+    uint32_t now = 0;
+    while (tx.isBusy()) {
+        now += 1000;
+        radio.completeTransmit(now);
+        tx.poll(now);
+    }
+
+    const uint16_t expected[] = {1, 5, 6, 3, 2, 4};
+    TEST_ASSERT_EQUAL(6, order.size());
+    TEST_ASSERT_EQUAL_UINT16_ARRAY(expected, order.data(), 6);
+    TEST_ASSERT_EQUAL(6, tx.getStats().sent);
+}
+
+void test_full_queue_rejects_and_counts_drops() {
+    MockRadio radio;
+    TxScheduler tx(radio);
+
+    uint8_t buf[MAX_FRAME_SIZE];
+    size_t len = makeFrame(FrameType::PING, 0, buf);
+    for (size_t i = 0; i < TxScheduler::CAPACITY; ++i) {
+        TEST_ASSERT_TRUE(tx.enqueue(buf, len, Priority::NORMAL, 0));
+    }
+    TEST_ASSERT_EQUAL(0, tx.freeSlots());
+    TEST_ASSERT_FALSE(tx.enqueue(buf, len, Priority::CRITICAL, 0));
+    TEST_ASSERT_EQUAL(1, tx.getStats().dropped);
+
+    // Oversized or empty frames are refused without touching the counters
+    TEST_ASSERT_FALSE(tx.enqueue(buf, 0, Priority::NORMAL, 0));
+    TEST_ASSERT_FALSE(tx.enqueue(nullptr, len, Priority::NORMAL, 0));
+    TEST_ASSERT_EQUAL(1, tx.getStats().dropped);
+}
+
+void test_receiver_is_suspended_for_the_burst_and_resumed_after() {
+    MockRadio radio;
+    FramePool pool;
+    RxEngine rx(radio, pool);
+    TxScheduler tx(radio);
+    tx.attachReceiver(&rx);
+    radio.setDio1Handler([&](uint32_t ts) {
+        tx.onDio1(ts);
+        rx.onDio1(ts);
+    });
+    rx.begin();
+
+    uint8_t buf[MAX_FRAME_SIZE];
+    size_t len = makeFrame(FrameType::UPDATE_ACK, 9, buf);
+    tx.enqueue(buf, len, Priority::HIGH, 0);
+    tx.enqueue(buf, len, Priority::HIGH, 0);
+    TEST_ASSERT_FALSE(rx.isActive());
+
+    // First TxDone: the second frame follows without reopening RX
+    radio.completeTransmit(10);
+    tx.poll(10);
+    TEST_ASSERT_FALSE(rx.isActive());
+    TEST_ASSERT_EQUAL(RadioMode::TRANSMIT, radio.getMode());
+
+    radio.completeTransmit(20);
+    tx.poll(20);
+    TEST_ASSERT_TRUE(rx.isActive());
+    TEST_ASSERT_EQUAL(RadioMode::RECEIVE, radio.getMode());
+
+    // TxDone edges were never mistaken for received frames
+    TEST_ASSERT_EQUAL(0, rx.poll());
+    TEST_ASSERT_EQUAL(0, rx.getStats().interrupts);
+}
+
+void test_start_failure_reports_and_moves_on() {
+    MockRadio radio;
+    TxScheduler tx(radio);
+    radio.setDio1Handler([&](uint32_t ts) { tx.onDio1(ts); });
+
+    std::vector<TxResult> results;
+    tx.setCompletionCallback([&](const TxResult& r) { results.push_back(r); });
+
+    uint8_t buf[MAX_FRAME_SIZE];
+    radio.failNextTransmit(RadioStatus::ERR_PACKET_TOO_LONG);
+    tx.enqueue(buf, makeFrame(FrameType::PING, 1, buf), Priority::NORMAL, 0);
+    TEST_ASSERT_FALSE(tx.isBusy());
+    TEST_ASSERT_EQUAL(1, results.size());
+    TEST_ASSERT_EQUAL(RadioStatus::ERR_PACKET_TOO_LONG, results[0].status);
+    TEST_ASSERT_EQUAL(FrameType::PING, results[0].type);
+    TEST_ASSERT_EQUAL_UINT16(1, results[0].sequence);
+    TEST_ASSERT_EQUAL(1, tx.getStats().failed);
+
+    // The freed slot is reusable and the next frame goes out normally
+    tx.enqueue(buf, makeFrame(FrameType::PING, 2, buf), Priority::NORMAL, 0);
+    radio.completeTransmit(500);
+    tx.poll(500);
+    TEST_ASSERT_EQUAL(2, results.size());
+    TEST_ASSERT_EQUAL(RadioStatus::OK, results[1].status);
+    TEST_ASSERT_EQUAL_UINT32(500, results[1].latencyUs);
+}
+
+void test_missing_tx_done_times_out() {
+    MockRadio radio;
+    TxScheduler tx(radio);
+
+    uint8_t buf[MAX_FRAME_SIZE];
+    tx.enqueue(buf, makeFrame(FrameType::PING, 1, buf), Priority::NORMAL, 1000);
+    tx.poll(1000 + TxScheduler::TX_TIMEOUT_US);
+    TEST_ASSERT_TRUE(tx.isTransmitting());
+    tx.poll(1001 + TxScheduler::TX_TIMEOUT_US);
+    TEST_ASSERT_FALSE(tx.isBusy());
+    TEST_ASSERT_EQUAL(1, tx.getStats().failed);
+    TEST_ASSERT_EQUAL(RadioMode::STANDBY, radio.getMode());
+}
+
+void test_edge_while_idle_is_ignored() {
+    MockRadio radio;
+    TxScheduler tx(radio);
+
+    // An RxDone edge with nothing in flight must not complete a later frame
+    tx.onDio1(5);
+    uint8_t buf[MAX_FRAME_SIZE];
+    tx.enqueue(buf, makeFrame(FrameType::PING, 1, buf), Priority::NORMAL, 10);
+    tx.poll(20);
+    TEST_ASSERT_TRUE(tx.isTransmitting());
+}
+
+// Sender loop at SF12: blocking transmit() versus the async queue.
+// Workload is the PING cadence plus an OTA burst; timing models main.cpp.
+namespace {
+    const uint32_t PING_AIRTIME_US = 991000;    // 8-byte frame, SF12/125 kHz, CR 4/5
+    const uint32_t CHUNK_AIRTIME_US = 7545000;  // 210-byte OTA chunk at SF12
+    const uint32_t LOOP_STEP_US = 10000;        // loop() body incl. button/OLED work
+    const uint32_t PING_PERIOD_US = 2000000;
+    const uint32_t RUN_US = 60000000;
+    const int OTA_CHUNKS = 4;
+
+    struct LoopResult {
+        uint32_t maxStallUs;    // Longest gap between updateButton() calls
+        uint32_t frames;
+    };
+
+    LoopResult runBlocking() {
+        LoopResult r = {};
+        uint32_t now = 0;
+        uint32_t lastPing = 0;
+        int chunks = OTA_CHUNKS;
+        while (now < RUN_US) {
+            uint32_t before = now;
+            if (chunks > 0) {
+                now += CHUNK_AIRTIME_US;    // transmit() + delay(50)
+                now += 50000;
+                chunks--;
+                r.frames++;
+            }
+            if (now - lastPing >= PING_PERIOD_US) {
+                now += PING_AIRTIME_US;
+                lastPing = now;
+                r.frames++;
+            }
+            now += LOOP_STEP_US;
+            if (now - before > r.maxStallUs) r.maxStallUs = now - before;
+        }
+        return r;
+    }
+
+    LoopResult runAsync(TxStats& stats) {
+        MockRadio radio;
+        TxScheduler tx(radio);
+        radio.setDio1Handler([&](uint32_t ts) { tx.onDio1(ts); });
+
+        LoopResult r = {};
+        uint32_t now = 0;
+        uint32_t doneAt = 0;
+        radio.setTransmitHandler([&](const uint8_t*, size_t length) {
+            doneAt = now + (length > 100 ? CHUNK_AIRTIME_US : PING_AIRTIME_US);
+        });
+
+        uint8_t ping[MAX_FRAME_SIZE];
+        uint8_t chunk[MAX_FRAME_SIZE];
+        size_t chunkLen = makeFrame(FrameType::OTA_DATA, 0, chunk, 202);
+        uint32_t lastPing = 0;
+        uint16_t pingSeq = 0;
+        int chunks = OTA_CHUNKS;
+
+        while (now < RUN_US) {
+            uint32_t before = now;
+            if (tx.isTransmitting() && now >= doneAt) {
+                radio.completeTransmit(now);
+            }
+            tx.poll(now);
+
+            // OTA stream keeps a few slots free, as serviceLoraOtaStream() does
+            while (chunks > 0 && tx.freeSlots() > 4) {
+                tx.enqueue(chunk, chunkLen, Priority::LOW, now);
+                chunks--;
+            }
+            if (now - lastPing >= PING_PERIOD_US) {
+                tx.enqueue(ping, makeFrame(FrameType::PING, pingSeq++, ping), Priority::NORMAL, now);
+                lastPing = now;
+            }
+            now += LOOP_STEP_US;
+            if (now - before > r.maxStallUs) r.maxStallUs = now - before;
+        }
+        stats = tx.getStats();
+        r.frames = stats.sent;
+        return r;
+    }
+}
+
+void test_benchmark_loop_stall_blocking_vs_async() {
+    TxStats stats;
+    LoopResult blocking = runBlocking();
+    LoopResult async = runAsync(stats);
+
+    char msg[200];
+    snprintf(msg, sizeof(msg),
+             "SF12 sender loop: blocking max stall=%lums (%u frames) | async max stall=%lums "
+             "(sent=%u maxDepth=%u avgLatency=%lums maxLatency=%lums)",
+             (unsigned long)(blocking.maxStallUs / 1000), (unsigned)blocking.frames,
+             (unsigned long)(async.maxStallUs / 1000), (unsigned)stats.sent, (unsigned)stats.maxDepth,
+             (unsigned long)(stats.averageLatencyUs() / 1000), (unsigned long)(stats.maxLatencyUs / 1000));
+    TEST_MESSAGE(msg);
+
+    TEST_ASSERT_EQUAL_UINT32(LOOP_STEP_US, async.maxStallUs);
+    TEST_ASSERT_GREATER_THAN(CHUNK_AIRTIME_US, blocking.maxStallUs);
+    TEST_ASSERT_EQUAL(0, stats.dropped);
+    TEST_ASSERT_EQUAL(0, stats.failed);
+}
+
+void process() {
+    RUN_TEST(test_first_frame_starts_immediately);
+    RUN_TEST(test_higher_priority_goes_first_and_fifo_within_level);
+    RUN_TEST(test_full_queue_rejects_and_counts_drops);
+    RUN_TEST(test_receiver_is_suspended_for_the_burst_and_resumed_after);
+    RUN_TEST(test_start_failure_reports_and_moves_on);
+    RUN_TEST(test_missing_tx_done_times_out);
+    RUN_TEST(test_edge_while_idle_is_ignored);
+    RUN_TEST(test_benchmark_loop_stall_blocking_vs_async);
+}
+
+#ifdef UNIT_TEST
+int main(int argc, char **argv) {
+    UNITY_BEGIN();
+    process();
+    return UNITY_END();
+}
+#endif